@@ -647,6 +647,55 @@ static int raspi_cli_run_script (raspi_cli_hif_t *hif, char *script, bool atcmd_
 				}
 			}
 		}
+		else if (memcmp(cmd, "FILE", 4) == 0) /* FILE <file_path> */
+		{
+			argc = raspi_cli_parse_params(cmd + 4, argv, 1, ' ');
+
+			if (argc == 1)
+			{
+				char file_data[ATCMD_DATA_LEN_MAX];
+				char *file_path;
+				FILE *file_fp;
+				int file_len = 0;
+				int ret = 0;
+
+				if (argv[0][0] == '/')
+					file_path = argv[0];
+				else
+				{
+					file_path = malloc(strlen(script_path) + strlen(argv[0]) + 2);
+					if (!file_path)
+						goto error_exit;
+
+					sprintf(file_path, "%s/%s", script_path, argv[0]);
+				}
+
+				file_fp = fopen(file_path, "r");
+				if (!file_fp)
+				{
+					log_info("FILE: %s, %s\n", file_path, strerror(errno));
+					if (file_path != argv[0])
+						free(file_path);
+					goto error_exit;
+				}
+
+				while (ret >= 0 && (i = fread(file_data, 1, sizeof(file_data), file_fp)) > 0)
+				{
+					ret = nrc_atcmd_send_data(file_data, i);
+					file_len += i;
+				}
+
+				fclose(file_fp);
+
+				log_info("FILE: %s, %d\n", file_path, file_len);
+
+				if (file_path != argv[0])
+					free(file_path);
+
+				if (ret < 0)
+					goto error_exit;
+			}
+		}
 		else if (memcmp(cmd, "CALL", 4) == 0) /* CALL <script_name> */
 		{
 			argc = raspi_cli_parse_params(cmd + 4, argv, 1, ' ');
@@ -0,0 +1,259 @@
+/*
+ * Host benchmark for the cJSON allocation modes.
+ *
+ * Parses and prints a few telemetry-sized documents with the heap, arena
+ * and in-situ parsers and with the buffered and streaming printers, and
+ * reports heap allocations per document, peak heap/arena use and MB/s.
+ * The output of every mode is checked against plain cJSON_Parse/Print.
+ *
+ *   gcc -O2 -DCJSON_HOST_BUILD -o cjson_bench bench.c cJSON.c -lm
+ *   ./cjson_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+
+static const char *payloads[][2] = {
+	{ "sensor",
+	  "{\"device\":\"nrc7292-00:11:22:33:44:55\",\"seq\":18234,\"ts\":1697712345,"
+	  "\"temperature\":23.57,\"humidity\":41.2,\"pressure\":1013.25,\"battery\":3.71,"
+	  "\"rssi\":-67,\"snr\":18,\"status\":\"ok\"}" },
+	{ "shadow",
+	  "{\"state\":{\"reported\":{\"temperature\":21.5,\"humidity\":48,\"led\":true,"
+	  "\"fw\":\"1.7.0\",\"interval\":60,\"location\":{\"lat\":37.3861,\"lon\":-122.0839}},"
+	  "\"desired\":{\"interval\":30,\"led\":false}},\"metadata\":{\"reported\":"
+	  "{\"temperature\":{\"timestamp\":1697712345},\"humidity\":{\"timestamp\":1697712345}}},"
+	  "\"version\":4711,\"timestamp\":1697712346,\"clientToken\":\"sensor01-2fa3\"}" },
+	{ "batch",
+	  "{\"device\":\"sensor01\",\"unit\":\"C\",\"samples\":[{\"t\":0,\"v\":21.5},{\"t\":10,\"v\":21.6},"
+	  "{\"t\":20,\"v\":21.6},{\"t\":30,\"v\":21.7},{\"t\":40,\"v\":21.9},{\"t\":50,\"v\":22.0},"
+	  "{\"t\":60,\"v\":22.1},{\"t\":70,\"v\":22.1},{\"t\":80,\"v\":22.3},{\"t\":90,\"v\":22.2}],"
+	  "\"tags\":[\"greenhouse\",\"north\",\"row\\t3\",\"caf\\u00e9\"],\"ok\":true,\"err\":null}" },
+	{ "fota",
+	  "{\"version\":\"1.7.1\",\"crc\":\"3fa85f64\",\"fw_name\":\"/fw/nrc7292_standalone_xip_1.7.1.bin\","
+	  "\"force\":\"0\"}" },
+};
+
+/* Heap accounting through cJSON_InitHooks, the size lives in front of each block */
+static size_t n_alloc, cur_bytes, peak_bytes, base_bytes;
+
+static void *count_malloc(size_t sz)
+{
+	size_t *p = malloc(sz + sizeof(size_t));
+	if (!p)
+		return NULL;
+	*p = sz;
+	n_alloc++;
+	cur_bytes += sz;
+	if (cur_bytes > peak_bytes)
+		peak_bytes = cur_bytes;
+	return p + 1;
+}
+
+static void count_free(void *ptr)
+{
+	size_t *p = ptr;
+	if (!p)
+		return;
+	cur_bytes -= p[-1];
+	free(p - 1);
+}
+
+static void reset_counters(void)
+{
+	n_alloc = 0;
+	base_bytes = peak_bytes = cur_bytes;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct sink {
+	char buf[4096];
+	size_t len;
+};
+
+static int sink_write(void *ctx, const char *data, size_t len)
+{
+	struct sink *s = ctx;
+	if (s->len + len >= sizeof(s->buf))
+		return -1;
+	memcpy(s->buf + s->len, data, len);
+	s->len += len;
+	return 0;
+}
+
+static int null_write(void *ctx, const char *data, size_t len)
+{
+	(void)ctx; (void)data; (void)len;
+	return 0;
+}
+
+static void report(const char *name, const char *mode, size_t bytes, int iters,
+				   double secs, size_t peak, size_t arena_peak)
+{
+	printf("%-8s %-16s %8.1f %10.2f %10zu %10zu\n", name, mode,
+		   (double)n_alloc / iters, bytes * (double)iters / secs / 1e6,
+		   peak - base_bytes, arena_peak);
+}
+
+static int check(const char *name, const char *what, const char *got, const char *want)
+{
+	if (got && want && !strcmp(got, want))
+		return 0;
+	printf("MISMATCH %s %s:\n  got  %s\n  want %s\n", name, what,
+		   got ? got : "(null)", want ? want : "(null)");
+	return 1;
+}
+
+/* References to arena items live on the heap and go with their container */
+static int check_references(const char *name, const char *json)
+{
+	char arena_buf[8192];
+	cJSON_Arena arena;
+	cJSON *doc, *array, *object;
+	size_t before = cur_bytes;
+
+	cJSON_ArenaInit(&arena, arena_buf, sizeof(arena_buf));
+	doc = cJSON_ParseArena(&arena, json);
+	array = cJSON_CreateArray();
+	object = cJSON_CreateObject();
+	cJSON_AddItemReferenceToArray(array, doc->child);
+	cJSON_AddItemReferenceToObject(object, "doc", doc);
+	cJSON_Delete(array);
+	cJSON_Delete(object);
+	cJSON_ArenaReset(&arena);
+
+	if (cur_bytes == before)
+		return 0;
+	printf("LEAK %s references: %zu bytes\n", name, cur_bytes - before);
+	return 1;
+}
+
+static int bench_payload(const char *name, const char *json, int iters)
+{
+	size_t len = strlen(json);
+	char *copy = malloc(len + 1);
+	char arena_buf[8192];
+	char chunk[256];
+	cJSON_Arena arena;
+	struct sink sink;
+	cJSON *ref, *doc;
+	char *want, *want_fmt, *out;
+	double t;
+	int i, fails = 0;
+
+	/* reference output and correctness of every mode */
+	ref = cJSON_Parse(json);
+	want = cJSON_PrintUnformatted(ref);
+	want_fmt = cJSON_Print(ref);
+
+	cJSON_ArenaInit(&arena, arena_buf, sizeof(arena_buf));
+	doc = cJSON_ParseArena(&arena, json);
+	out = cJSON_PrintUnformatted(doc);
+	fails += check(name, "arena", out, want);
+	count_free(out);
+	cJSON_Delete(doc);
+	cJSON_ArenaReset(&arena);
+
+	memcpy(copy, json, len + 1);
+	doc = cJSON_ParseInSitu(&arena, copy);
+	out = cJSON_PrintUnformatted(doc);
+	fails += check(name, "in-situ", out, want);
+	count_free(out);
+	cJSON_ArenaReset(&arena);
+
+	memcpy(copy, json, len + 1);
+	doc = cJSON_ParseInSitu(NULL, copy);
+	out = cJSON_PrintUnformatted(doc);
+	fails += check(name, "in-situ heap", out, want);
+	count_free(out);
+	cJSON_Delete(doc);
+
+	sink.len = 0;
+	cJSON_PrintStream(ref, 0, chunk, 7, sink_write, &sink);
+	sink.buf[sink.len] = '\0';
+	fails += check(name, "stream", sink.buf, want);
+	sink.len = 0;
+	cJSON_PrintStream(ref, 1, chunk, sizeof(chunk), sink_write, &sink);
+	sink.buf[sink.len] = '\0';
+	fails += check(name, "stream fmt", sink.buf, want_fmt);
+	fails += check_references(name, json);
+
+	/* parse */
+	reset_counters();
+	t = now();
+	for (i = 0; i < iters; i++) {
+		doc = cJSON_Parse(json);
+		cJSON_Delete(doc);
+	}
+	report(name, "parse heap", len, iters, now() - t, peak_bytes, 0);
+
+	reset_counters();
+	arena.peak = 0;
+	t = now();
+	for (i = 0; i < iters; i++) {
+		doc = cJSON_ParseArena(&arena, json);
+		cJSON_ArenaReset(&arena);
+	}
+	report(name, "parse arena", len, iters, now() - t, peak_bytes, arena.peak);
+
+	reset_counters();
+	arena.peak = 0;
+	t = now();
+	for (i = 0; i < iters; i++) {
+		memcpy(copy, json, len + 1);
+		doc = cJSON_ParseInSitu(&arena, copy);
+		cJSON_ArenaReset(&arena);
+	}
+	report(name, "parse in-situ", len, iters, now() - t, peak_bytes, arena.peak);
+
+	/* print */
+	reset_counters();
+	t = now();
+	for (i = 0; i < iters; i++)
+		count_free(cJSON_PrintUnformatted(ref));
+	report(name, "print", strlen(want), iters, now() - t, peak_bytes, 0);
+
+	reset_counters();
+	t = now();
+	for (i = 0; i < iters; i++)
+		count_free(cJSON_PrintBuffered(ref, 256, 0));
+	report(name, "print buffered", strlen(want), iters, now() - t, peak_bytes, 0);
+
+	reset_counters();
+	t = now();
+	for (i = 0; i < iters; i++)
+		cJSON_PrintStream(ref, 0, chunk, sizeof(chunk), null_write, NULL);
+	report(name, "print stream", strlen(want), iters, now() - t, peak_bytes, 0);
+
+	count_free(want);
+	count_free(want_fmt);
+	cJSON_Delete(ref);
+	free(copy);
+	return fails;
+}
+
+int main(int argc, char **argv)
+{
+	cJSON_Hooks hooks = { count_malloc, count_free };
+	int iters = argc > 1 ? atoi(argv[1]) : 100000;
+	int fails = 0;
+	size_t i;
+
+	cJSON_InitHooks(&hooks);
+
+	printf("%-8s %-16s %8s %10s %10s %10s\n",
+		   "payload", "mode", "allocs", "MB/s", "heap peak", "arena peak");
+	for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++)
+		fails += bench_payload(payloads[i][0], payloads[i][1], iters);
+
+	return fails ? 1 : 0;
+}
@@ -31,7 +31,12 @@
 #include <limits.h>
 #include <ctype.h>
 #include "cJSON.h"
+#ifdef CJSON_HOST_BUILD
+#define pvPortMalloc malloc
+#define vPortFree free
+#else
 #include "FreeRTOS.h"
+#endif
 
 /* Determine the number of bits that an integer has using the preprocessor */
 #if INT_MAX == 32767
@@ -125,6 +130,95 @@ static cJSON *cJSON_New_Item(void)
     return node;
 }
 
+/* Arena blocks are aligned for the doubles in cJSON. */
+#define ARENA_ALIGN(x) (((x) + sizeof(double) - 1) & ~(sizeof(double) - 1))
+
+int cJSON_ArenaInit(cJSON_Arena *arena, void *buffer, size_t size)
+{
+    arena->owned = 0;
+    if (!buffer)
+    {
+        buffer = cJSON_malloc(size);
+        if (!buffer)
+        {
+            arena->buffer = NULL;
+            arena->size = arena->used = arena->peak = 0;
+            return 0;
+        }
+        arena->owned = 1;
+    }
+    arena->buffer = (char*)buffer;
+    arena->size = size;
+    arena->used = 0;
+    arena->peak = 0;
+
+    return 1;
+}
+
+void cJSON_ArenaReset(cJSON_Arena *arena)
+{
+    arena->used = 0;
+}
+
+void cJSON_ArenaFree(cJSON_Arena *arena)
+{
+    if (arena->owned)
+    {
+        cJSON_free(arena->buffer);
+    }
+    arena->buffer = NULL;
+    arena->size = arena->used = 0;
+    arena->owned = 0;
+}
+
+static void *arena_alloc(cJSON_Arena *arena, size_t sz)
+{
+    /* the buffer itself may not be aligned, so align the address */
+    size_t start = ARENA_ALIGN((size_t)(arena->buffer + arena->used)) - (size_t)arena->buffer;
+    if ((start > arena->size) || (sz > arena->size - start))
+    {
+        return NULL;
+    }
+    arena->used = start + sz;
+    if (arena->used > arena->peak)
+    {
+        arena->peak = arena->used;
+    }
+
+    return arena->buffer + start;
+}
+
+/* Where a parse puts its nodes and strings. */
+typedef struct
+{
+    cJSON_Arena *arena;
+    /* unescape strings inside the input and point at them */
+    bool in_situ;
+    const char **ep;
+} parse_context;
+
+/* Constructor used by the parser. */
+static cJSON *parse_new_item(const parse_context *ctx)
+{
+    cJSON *node = NULL;
+    if (!ctx->arena)
+    {
+        return cJSON_New_Item();
+    }
+
+    node = (cJSON*)arena_alloc(ctx->arena, sizeof(cJSON));
+    if (node)
+    {
+        memset(node, '\0', sizeof(cJSON));
+        node->type = cJSON_IsArena;
+    }
+
+    return node;
+}
+
+/* Flags that survive the parser setting the type of an item. */
+#define PARSE_KEEP_FLAGS (cJSON_IsArena | cJSON_StringIsConst)
+
 /* Delete a cJSON structure. */
 void cJSON_Delete(cJSON *c)
 {
@@ -144,7 +238,11 @@ void cJSON_Delete(cJSON *c)
         {
             cJSON_free(c->string);
         }
-        cJSON_free(c);
+        /* arena items are released with their arena */
+        if (!(c->type & cJSON_IsArena))
+        {
+            cJSON_free(c);
+        }
         c = next;
     }
 }
@@ -214,7 +312,7 @@ static const char *parse_number(cJSON *item, const char *num)
 
     item->valuedouble = n;
     item->valueint = (int)n;
-    item->type = cJSON_Number;
+    item->type = cJSON_Number | (item->type & PARSE_KEEP_FLAGS);
 
     return num;
 }
@@ -296,77 +394,73 @@ static int update(const printbuffer *p)
     return p->offset + strlen(str);
 }
 
-/* Render the number nicely from the given item into a string. */
-static char *print_number(const cJSON *item, printbuffer *p)
+/* Space print_number needs for the number in item, terminator included. */
+static int number_length(const cJSON *item)
+{
+    double d = item->valuedouble;
+    if (d == 0)
+    {
+        return 2;
+    }
+    /* value is an int */
+    if ((fabs(((double)item->valueint) - d) <= DBL_EPSILON) && (d <= INT_MAX) && (d >= INT_MIN))
+    {
+        /* 2^64+1 can be represented in 21 chars. */
+        return 21;
+    }
+    /* This is a nice tradeoff. */
+    return 64;
+}
+
+/* Write the number in item to str, which holds number_length(item) bytes. */
+static void format_number(const cJSON *item, char *str)
 {
-    char *str = NULL;
     double d = item->valuedouble;
     /* special case for 0. */
     if (d == 0)
     {
-        if (p)
-        {
-            str = ensure(p, 2);
-        }
-        else
-        {
-            str = (char*)cJSON_malloc(2);
-        }
-        if (str)
-        {
-            strcpy(str,"0");
-        }
+        strcpy(str,"0");
     }
     /* value is an int */
     else if ((fabs(((double)item->valueint) - d) <= DBL_EPSILON) && (d <= INT_MAX) && (d >= INT_MIN))
     {
-        if (p)
-        {
-            str = ensure(p, 21);
-        }
-        else
-        {
-            /* 2^64+1 can be represented in 21 chars. */
-            str = (char*)cJSON_malloc(21);
-        }
-        if (str)
-        {
-            sprintf(str, "%d", item->valueint);
-        }
+        sprintf(str, "%d", item->valueint);
+    }
+    /* This checks for NaN and Infinity */
+    else if ((d * 0) != 0)
+    {
+        sprintf(str, "null");
+    }
+    else if ((fabs(floor(d) - d) <= DBL_EPSILON) && (fabs(d) < 1.0e60))
+    {
+        sprintf(str, "%.0f", d);
+    }
+    else if ((fabs(d) < 1.0e-6) || (fabs(d) > 1.0e9))
+    {
+        sprintf(str, "%e", d);
     }
-    /* value is a floating point number */
     else
     {
-        if (p)
-        {
-            /* This is a nice tradeoff. */
-            str = ensure(p, 64);
-        }
-        else
-        {
-            /* This is a nice tradeoff. */
-            str=(char*)cJSON_malloc(64);
-        }
-        if (str)
-        {
-            /* This checks for NaN and Infinity */
-            if ((d * 0) != 0)
-            {
-                sprintf(str, "null");
-            }
-            else if ((fabs(floor(d) - d) <= DBL_EPSILON) && (fabs(d) < 1.0e60))
-            {
-                sprintf(str, "%.0f", d);
-            }
-            else if ((fabs(d) < 1.0e-6) || (fabs(d) > 1.0e9))
-            {
-                sprintf(str, "%e", d);
-            }
-            else
-            {
-                sprintf(str, "%f", d);
-            }
-        }
+        sprintf(str, "%f", d);
+    }
+}
+
+/* Render the number nicely from the given item into a string. */
+static char *print_number(const cJSON *item, printbuffer *p)
+{
+    char *str = NULL;
+    int len = number_length(item);
+    if (p)
+    {
+        str = ensure(p, len);
+    }
+    else
+    {
+        str = (char*)cJSON_malloc(len);
+    }
+    if (str)
+    {
+        format_number(item, str);
     }
     return str;
 }
@@ -470,8 +564,9 @@ static const unsigned char firstByteMark[7] =
 };
 
 /* Parse the input text into an unescaped cstring, and populate item. */
-static const char *parse_string(cJSON *item, const char *str, const char **ep)
+static const char *parse_string(cJSON *item, const char *str, const parse_context *ctx)
 {
+    const char **ep = ctx->ep;
     const char *ptr = str + 1;
     const char *end_ptr =str + 1;
     char *ptr2 = NULL;
@@ -501,14 +596,31 @@ static const char *parse_string(cJSON *item, const char *str, const char **ep)
         }
     }
 
-    /* This is at most how long we need for the string, roughly. */
-    out = (char*)cJSON_malloc(len + 1);
+    if (ctx->in_situ)
+    {
+        /* unescaping never grows the text, so it is done over the input itself */
+        out = (char*)str + 1;
+    }
+    else if (ctx->arena)
+    {
+        out = (char*)arena_alloc(ctx->arena, len + 1);
+    }
+    else
+    {
+        /* This is at most how long we need for the string, roughly. */
+        out = (char*)cJSON_malloc(len + 1);
+    }
     if (!out)
     {
         return NULL;
     }
     item->valuestring = out; /* assign here so out will be deleted during cJSON_Delete() later */
-    item->type = cJSON_String;
+    item->type = cJSON_String | (item->type & PARSE_KEEP_FLAGS);
+    if (ctx->in_situ || ctx->arena)
+    {
+        /* the string is not ours to free */
+        item->type |= cJSON_IsReference;
+    }
 
     ptr = str + 1;
     ptr2 = out;
@@ -637,11 +749,12 @@ static const char *parse_string(cJSON *item, const char *str, const char **ep)
             ptr++;
         }
     }
-    *ptr2 = '\0';
+    /* step over the closing quote before the terminator may overwrite it */
     if (*ptr == '\"')
     {
         ptr++;
     }
+    *ptr2 = '\0';
 
     return ptr;
 }
@@ -798,11 +911,11 @@ static char *print_string(const cJSON *item, printbuffer *p)
 }
 
 /* Predeclare these prototypes. */
-static const char *parse_value(cJSON *item, const char *value, const char **ep);
+static const char *parse_value(cJSON *item, const char *value, const parse_context *ctx);
 static char *print_value(const cJSON *item, int depth, bool fmt, printbuffer *p);
-static const char *parse_array(cJSON *item, const char *value, const char **ep);
+static const char *parse_array(cJSON *item, const char *value, const parse_context *ctx);
 static char *print_array(const cJSON *item, int depth, bool fmt, printbuffer *p);
-static const char *parse_object(cJSON *item, const char *value, const char **ep);
+static const char *parse_object(cJSON *item, const char *value, const parse_context *ctx);
 static char *print_object(const cJSON *item, int depth, bool fmt, printbuffer *p);
 
 /* Utility to jump whitespace and cr/lf */
@@ -817,24 +930,23 @@ static const char *skip(const char *in)
 }
 
 /* Parse an object - create a new root, and populate. */
-cJSON *cJSON_ParseWithOpts(const char *value, const char **return_parse_end, bool require_null_terminated)
+static cJSON *parse_root(const char *value, const char **return_parse_end, bool require_null_terminated, const parse_context *ctx)
 {
     const char *end = NULL;
-    /* use global error pointer if no specific one was given */
-    const char **ep = return_parse_end ? return_parse_end : &global_ep;
-    cJSON *c = cJSON_New_Item();
+    const char **ep = ctx->ep;
+    size_t mark = ctx->arena ? ctx->arena->used : 0;
+    cJSON *c = parse_new_item(ctx);
     *ep = NULL;
     if (!c) /* memory fail */
     {
         return NULL;
     }
 
-    end = parse_value(c, skip(value), ep);
+    end = parse_value(c, skip(value), ctx);
     if (!end)
     {
         /* parse failure. ep is set. */
-        cJSON_Delete(c);
-        return NULL;
+        goto fail;
     }
 
     /* if we require null-terminated JSON without appended garbage, skip and then check for a null terminator */
@@ -843,9 +955,8 @@ cJSON *cJSON_ParseWithOpts(const char *value, const char **return_parse_end, boo
         end = skip(end);
         if (*end)
         {
-            cJSON_Delete(c);
             *ep = end;
-            return NULL;
+            goto fail;
         }
     }
     if (return_parse_end)
@@ -854,6 +965,51 @@ cJSON *cJSON_ParseWithOpts(const char *value, const char **return_parse_end, boo
     }
 
     return c;
+
+fail:
+    cJSON_Delete(c);
+    if (ctx->arena)
+    {
+        /* give back what the failed parse took */
+        ctx->arena->used = mark;
+    }
+    return NULL;
+}
+
+cJSON *cJSON_ParseWithOpts(const char *value, const char **return_parse_end, bool require_null_terminated)
+{
+    parse_context ctx;
+    ctx.arena = NULL;
+    ctx.in_situ = false;
+    /* use global error pointer if no specific one was given */
+    ctx.ep = return_parse_end ? return_parse_end : &global_ep;
+
+    return parse_root(value, return_parse_end, require_null_terminated, &ctx);
+}
+
+cJSON *cJSON_ParseArenaWithOpts(cJSON_Arena *arena, const char *value, const char **return_parse_end, bool require_null_terminated, bool in_situ)
+{
+    parse_context ctx;
+    ctx.arena = arena;
+    ctx.in_situ = in_situ;
+    ctx.ep = return_parse_end ? return_parse_end : &global_ep;
+
+    return parse_root(value, return_parse_end, require_null_terminated, &ctx);
+}
+
+cJSON *cJSON_ParseArena(cJSON_Arena *arena, const char *value)
+{
+    if (!arena)
+    {
+        return NULL;
+    }
+
+    return cJSON_ParseArenaWithOpts(arena, value, 0, 0, 0);
+}
+
+cJSON *cJSON_ParseInSitu(cJSON_Arena *arena, char *value)
+{
+    return cJSON_ParseArenaWithOpts(arena, value, 0, 0, 1);
 }
 
 /* Default options for cJSON_Parse */
@@ -887,9 +1043,215 @@ char *cJSON_PrintBuffered(const cJSON *item, int prebuffer, bool fmt)
     return print_value(item, 0, fmt, &p);
 }
 
+/* Output state of cJSON_PrintStream. */
+typedef struct
+{
+    char *chunk;
+    size_t size;
+    size_t used;
+    int total;
+    cJSON_WriteCallback write;
+    void *ctx;
+    bool failed;
+} printstream;
+
+static void stream_flush(printstream *s)
+{
+    if (s->used && !s->failed)
+    {
+        if (s->write(s->ctx, s->chunk, s->used) != 0)
+        {
+            s->failed = true;
+        }
+    }
+    s->used = 0;
+}
+
+static void stream_put(printstream *s, const char *data, size_t len)
+{
+    size_t n = 0;
+    s->total += len;
+    while (len && !s->failed)
+    {
+        if (s->used == s->size)
+        {
+            stream_flush(s);
+        }
+        n = s->size - s->used;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(s->chunk + s->used, data, n);
+        s->used += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void stream_putc(printstream *s, char c)
+{
+    stream_put(s, &c, 1);
+}
+
+static void stream_tabs(printstream *s, int depth)
+{
+    while (depth-- > 0)
+    {
+        stream_putc(s, '\t');
+    }
+}
+
+/* Same escaping as print_string_ptr, unescaped runs are copied in one go. */
+static void stream_string(printstream *s, const char *str)
+{
+    const char *run = str;
+    char esc[7];
+
+    if (!str)
+    {
+        stream_put(s, "\"\"", 2);
+        return;
+    }
+
+    stream_putc(s, '\"');
+    for (; *str; str++)
+    {
+        unsigned char token = *str;
+        if ((token > 31) && (token != '\"') && (token != '\\'))
+        {
+            continue;
+        }
+        stream_put(s, run, str - run);
+        run = str + 1;
+        esc[0] = '\\';
+        switch (token)
+        {
+            case '\\':
+            case '\"':
+                esc[1] = token;
+                break;
+            case '\b':
+                esc[1] = 'b';
+                break;
+            case '\f':
+                esc[1] = 'f';
+                break;
+            case '\n':
+                esc[1] = 'n';
+                break;
+            case '\r':
+                esc[1] = 'r';
+                break;
+            case '\t':
+                esc[1] = 't';
+                break;
+            default:
+                /* escape and print as unicode codepoint */
+                sprintf(esc + 1, "u%04x", token);
+                stream_put(s, esc, 6);
+                continue;
+        }
+        stream_put(s, esc, 2);
+    }
+    stream_put(s, run, str - run);
+    stream_putc(s, '\"');
+}
+
+/* Same layout as print_value. */
+static void stream_value(printstream *s, const cJSON *item, int depth, bool fmt)
+{
+    char num[64];
+    cJSON *child = NULL;
+
+    switch ((item->type) & 0xFF)
+    {
+        case cJSON_NULL:
+            stream_put(s, "null", 4);
+            break;
+        case cJSON_False:
+            stream_put(s, "false", 5);
+            break;
+        case cJSON_True:
+            stream_put(s, "true", 4);
+            break;
+        case cJSON_Number:
+            format_number(item, num);
+            stream_put(s, num, strlen(num));
+            break;
+        case cJSON_String:
+            stream_string(s, item->valuestring);
+            break;
+        case cJSON_Array:
+            stream_putc(s, '[');
+            for (child = item->child; child && !s->failed; child = child->next)
+            {
+                stream_value(s, child, depth + 1, fmt);
+                if (child->next)
+                {
+                    stream_put(s, ", ", fmt ? 2 : 1);
+                }
+            }
+            stream_putc(s, ']');
+            break;
+        case cJSON_Object:
+            stream_putc(s, '{');
+            if (fmt)
+            {
+                stream_putc(s, '\n');
+            }
+            for (child = item->child; child && !s->failed; child = child->next)
+            {
+                if (fmt)
+                {
+                    stream_tabs(s, depth + 1);
+                }
+                stream_string(s, child->string);
+                stream_put(s, ":\t", fmt ? 2 : 1);
+                stream_value(s, child, depth + 1, fmt);
+                if (child->next)
+                {
+                    stream_putc(s, ',');
+                }
+                if (fmt)
+                {
+                    stream_putc(s, '\n');
+                }
+            }
+            if (fmt)
+            {
+                stream_tabs(s, depth);
+            }
+            stream_putc(s, '}');
+            break;
+    }
+}
+
+int cJSON_PrintStream(const cJSON *item, bool fmt, char *chunk, size_t chunk_size, cJSON_WriteCallback write, void *ctx)
+{
+    printstream s;
+
+    if (!item || !chunk || !chunk_size || !write)
+    {
+        return -1;
+    }
+    s.chunk = chunk;
+    s.size = chunk_size;
+    s.used = 0;
+    s.total = 0;
+    s.write = write;
+    s.ctx = ctx;
+    s.failed = false;
+
+    stream_value(&s, item, 0, fmt);
+    stream_flush(&s);
+
+    return s.failed ? -1 : s.total;
+}
+
 
 /* Parser core - when encountering text, process appropriately. */
-static const char *parse_value(cJSON *item, const char *value, const char **ep)
+static const char *parse_value(cJSON *item, const char *value, const parse_context *ctx)
 {
     if (!value)
     {
@@ -900,23 +1262,23 @@ static const char *parse_value(cJSON *item, const char *value, const char **ep)
     /* parse the different types of values */
     if (!strncmp(value, "null", 4))
     {
-        item->type = cJSON_NULL;
+        item->type = cJSON_NULL | (item->type & PARSE_KEEP_FLAGS);
         return value + 4;
     }
     if (!strncmp(value, "false", 5))
     {
-        item->type = cJSON_False;
+        item->type = cJSON_False | (item->type & PARSE_KEEP_FLAGS);
         return value + 5;
     }
     if (!strncmp(value, "true", 4))
     {
-        item->type = cJSON_True;
+        item->type = cJSON_True | (item->type & PARSE_KEEP_FLAGS);
         item->valueint = 1;
         return value + 4;
     }
     if (*value == '\"')
     {
-        return parse_string(item, value, ep);
+        return parse_string(item, value, ctx);
     }
     if ((*value == '-') || ((*value >= '0') && (*value <= '9')))
     {
@@ -924,15 +1286,15 @@ static const char *parse_value(cJSON *item, const char *value, const char **ep)
     }
     if (*value == '[')
     {
-        return parse_array(item, value, ep);
+        return parse_array(item, value, ctx);
     }
     if (*value == '{')
     {
-        return parse_object(item, value, ep);
+        return parse_object(item, value, ctx);
     }
 
     /* failure. */
-    *ep = value;
+    *ctx->ep = value;
     return NULL;
 }
 
@@ -1016,17 +1378,17 @@ static char *print_value(const cJSON *item, int depth, bool fmt, printbuffer *p)
 }
 
 /* Build an array from input text. */
-static const char *parse_array(cJSON *item,const char *value,const char **ep)
+static const char *parse_array(cJSON *item,const char *value,const parse_context *ctx)
 {
     cJSON *child = NULL;
     if (*value != '[')
     {
         /* not an array! */
-        *ep = value;
+        *ctx->ep = value;
         return NULL;
     }
 
-    item->type = cJSON_Array;
+    item->type = cJSON_Array | (item->type & PARSE_KEEP_FLAGS);
     value = skip(value + 1);
     if (*value == ']')
     {
@@ -1034,14 +1396,14 @@ static const char *parse_array(cJSON *item,const char *value,const char **ep)
         return value + 1;
     }
 
-    item->child = child = cJSON_New_Item();
+    item->child = child = parse_new_item(ctx);
     if (!item->child)
     {
         /* memory fail */
         return NULL;
     }
     /* skip any spacing, get the value. */
-    value = skip(parse_value(child, skip(value), ep));
+    value = skip(parse_value(child, skip(value), ctx));
     if (!value)
     {
         return NULL;
@@ -1051,7 +1413,7 @@ static const char *parse_array(cJSON *item,const char *value,const char **ep)
     while (*value == ',')
     {
         cJSON *new_item = NULL;
-        if (!(new_item = cJSON_New_Item()))
+        if (!(new_item = parse_new_item(ctx)))
         {
             /* memory fail */
             return NULL;
@@ -1062,7 +1424,7 @@ static const char *parse_array(cJSON *item,const char *value,const char **ep)
         child = new_item;
 
         /* go to the next comma */
-        value = skip(parse_value(child, skip(value + 1), ep));
+        value = skip(parse_value(child, skip(value + 1), ctx));
         if (!value)
         {
             /* memory fail */
@@ -1077,7 +1439,7 @@ static const char *parse_array(cJSON *item,const char *value,const char **ep)
     }
 
     /* malformed. */
-    *ep = value;
+    *ctx->ep = value;
 
     return NULL;
 }
@@ -1249,17 +1611,28 @@ static char *print_array(const cJSON *item, int depth, bool fmt, printbuffer *p)
 }
 
 /* Build an object from the text. */
-static const char *parse_object(cJSON *item, const char *value, const char **ep)
+/* Turn the string just parsed into the key of item. */
+static void parse_use_as_key(cJSON *item)
+{
+    item->string = item->valuestring;
+    item->valuestring = NULL;
+    if (item->type & cJSON_IsReference)
+    {
+        item->type = (item->type & ~cJSON_IsReference) | cJSON_StringIsConst;
+    }
+}
+
+static const char *parse_object(cJSON *item, const char *value, const parse_context *ctx)
 {
     cJSON *child = NULL;
     if (*value != '{')
     {
         /* not an object! */
-        *ep = value;
+        *ctx->ep = value;
         return NULL;
     }
 
-    item->type = cJSON_Object;
+    item->type = cJSON_Object | (item->type & PARSE_KEEP_FLAGS);
     value = skip(value + 1);
     if (*value == '}')
     {
@@ -1267,30 +1640,29 @@ static const char *parse_object(cJSON *item, const char *value, const char **ep)
         return value + 1;
     }
 
-    child = cJSON_New_Item();
+    child = parse_new_item(ctx);
     item->child = child;
     if (!item->child)
     {
         return NULL;
     }
     /* parse first key */
-    value = skip(parse_string(child, skip(value), ep));
+    value = skip(parse_string(child, skip(value), ctx));
     if (!value)
     {
         return NULL;
     }
     /* use string as key, not value */
-    child->string = child->valuestring;
-    child->valuestring = NULL;
+    parse_use_as_key(child);
 
     if (*value != ':')
     {
         /* invalid object. */
-        *ep = value;
+        *ctx->ep = value;
         return NULL;
     }
     /* skip any spacing, get the value. */
-    value = skip(parse_value(child, skip(value + 1), ep));
+    value = skip(parse_value(child, skip(value + 1), ctx));
     if (!value)
     {
         return NULL;
@@ -1299,7 +1671,7 @@ static const char *parse_object(cJSON *item, const char *value, const char **ep)
     while (*value == ',')
     {
         cJSON *new_item = NULL;
-        if (!(new_item = cJSON_New_Item()))
+        if (!(new_item = parse_new_item(ctx)))
         {
             /* memory fail */
             return NULL;
@@ -1309,24 +1681,23 @@ static const char *parse_object(cJSON *item, const char *value, const char **ep)
         new_item->prev = child;
 
         child = new_item;
-        value = skip(parse_string(child, skip(value + 1), ep));
+        value = skip(parse_string(child, skip(value + 1), ctx));
         if (!value)
         {
             return NULL;
         }
 
         /* use string as key, not value */
-        child->string = child->valuestring;
-        child->valuestring = NULL;
+        parse_use_as_key(child);
 
         if (*value != ':')
         {
             /* invalid object. */
-            *ep = value;
+            *ctx->ep = value;
             return NULL;
         }
         /* skip any spacing, get the value. */
-        value = skip(parse_value(child, skip(value + 1), ep));
+        value = skip(parse_value(child, skip(value + 1), ctx));
         if (!value)
         {
             return NULL;
@@ -1339,7 +1710,7 @@ static const char *parse_object(cJSON *item, const char *value, const char **ep)
     }
 
     /* malformed */
-    *ep = value;
+    *ctx->ep = value;
     return NULL;
 }
 
@@ -1675,7 +2046,8 @@ static cJSON *create_reference(const cJSON *item)
     }
     memcpy(ref, item, sizeof(cJSON));
     ref->string = NULL;
-    ref->type |= cJSON_IsReference;
+    /* the reference itself is on the heap, even for an arena item */
+    ref->type = (item->type & ~cJSON_IsArena) | cJSON_IsReference;
     ref->next = ref->prev = NULL;
     return ref;
 }
@@ -1712,11 +2084,12 @@ void   cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
     }
 
     /* free old key and set new one */
-    if (item->string)
+    if (!(item->type & cJSON_StringIsConst) && item->string)
     {
         cJSON_free(item->string);
     }
     item->string = cJSON_strdup(string);
+    item->type &= ~cJSON_StringIsConst;
 
     cJSON_AddItemToArray(object,item);
 }
@@ -1881,6 +2254,7 @@ void cJSON_ReplaceItemInObject(cJSON *object, const char *string, cJSON *newitem
         }
 
         newitem->string = cJSON_strdup(string);
+        newitem->type &= ~cJSON_StringIsConst;
         cJSON_ReplaceItemInArray(object, i, newitem);
     }
 }
@@ -2115,7 +2489,7 @@ cJSON *cJSON_Duplicate(const cJSON *item, bool recurse)
         return NULL;
     }
     /* Copy over all vars */
-    newitem->type = item->type & (~cJSON_IsReference);
+    newitem->type = item->type & ~(cJSON_IsReference | cJSON_IsArena | cJSON_StringIsConst);
     newitem->valueint = item->valueint;
     newitem->valuedouble = item->valuedouble;
     if (item->valuestring)
@@ -41,6 +41,7 @@ extern "C"
 
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
+#define cJSON_IsArena 1024
 
 /* The cJSON structure: */
 typedef struct cJSON
@@ -74,6 +75,28 @@ typedef struct cJSON_Hooks
 /* Supply malloc, realloc and free functions to cJSON */
 extern void cJSON_InitHooks(cJSON_Hooks* hooks);
 
+/* A contiguous block that parsed nodes and strings are carved from, so that a whole document is released at once. */
+typedef struct cJSON_Arena
+{
+    char *buffer;
+    size_t size;
+    /* Bytes handed out so far, and the most ever handed out since init. */
+    size_t used;
+    size_t peak;
+    /* Set when the buffer was allocated by cJSON_ArenaInit. */
+    int owned;
+} cJSON_Arena;
+
+/* Set up an arena over buffer, or over size bytes taken from the heap when buffer is NULL. Returns 0 on allocation failure. */
+extern int cJSON_ArenaInit(cJSON_Arena *arena, void *buffer, size_t size);
+/* Drop every document parsed into the arena. Their cJSON pointers must not be used afterwards. */
+extern void cJSON_ArenaReset(cJSON_Arena *arena);
+/* Reset the arena and give back the heap buffer, if cJSON_ArenaInit allocated it. */
+extern void cJSON_ArenaFree(cJSON_Arena *arena);
+
+/* Callback used by cJSON_PrintStream to hand over each chunk of output. Return 0 to continue, anything else aborts printing. */
+typedef int (*cJSON_WriteCallback)(void *ctx, const char *data, size_t len);
+
 
 /* Supply a block of JSON, and this returns a cJSON object you can interrogate. Call cJSON_Delete when finished. */
 extern cJSON *cJSON_Parse(const char *value);
@@ -83,6 +106,10 @@ extern char  *cJSON_Print(const cJSON *item);
 extern char  *cJSON_PrintUnformatted(const cJSON *item);
 /* Render a cJSON entity to text using a buffered strategy. prebuffer is a guess at the final size. guessing well reduces reallocation. fmt=0 gives unformatted, =1 gives formatted */
 extern char *cJSON_PrintBuffered(const cJSON *item, int prebuffer, int fmt);
+/* Render a cJSON entity through a callback, chunk_size bytes at a time from the caller supplied chunk buffer, without building the
+whole text in memory. Output is the same as cJSON_Print (fmt=1) or cJSON_PrintUnformatted (fmt=0). Returns the number of bytes
+written, or -1 if the callback failed. */
+extern int cJSON_PrintStream(const cJSON *item, int fmt, char *chunk, size_t chunk_size, cJSON_WriteCallback write, void *ctx);
 /* Delete a cJSON entity and all subentities. */
 extern void   cJSON_Delete(cJSON *c);
 
@@ -141,6 +168,16 @@ The item->next and ->prev pointers are always zero on return from Duplicate. */
 /* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error. If not, then cJSON_GetErrorPtr() does the job. */
 extern cJSON *cJSON_ParseWithOpts(const char *value, const char **return_parse_end, int require_null_terminated);
 
+/* Parse into an arena instead of the heap: nodes and strings come from arena, and the document is released with
+cJSON_ArenaReset()/cJSON_ArenaFree(). Parsing fails if the arena runs out. cJSON_Delete() on the result is allowed but only
+frees items that were added to it from the heap afterwards. */
+extern cJSON *cJSON_ParseArena(cJSON_Arena *arena, const char *value);
+/* Parse in place: strings are unescaped inside value and referenced from the tree instead of being copied, so value is
+modified and must outlive the result. Nodes come from arena, or from the heap when arena is NULL. */
+extern cJSON *cJSON_ParseInSitu(cJSON_Arena *arena, char *value);
+/* Arena/in-situ variant of cJSON_ParseWithOpts. value must be writable when in_situ is set. */
+extern cJSON *cJSON_ParseArenaWithOpts(cJSON_Arena *arena, const char *value, const char **return_parse_end, int require_null_terminated, int in_situ);
+
 extern void cJSON_Minify(char *json);
 
 /* Macros for creating things quickly. */
@@ -0,0 +1,571 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __NRC_COAP_H__
+#define __NRC_COAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * CoAP (RFC 7252) over UDP, or DTLS with a pre-shared key, for reports and
+ * downloads that do not need a TCP connection: a confirmable report is one
+ * datagram and its acknowledgement, a non-confirmable one with No-Response
+ * (RFC 7967) a single datagram.
+ *
+ * An endpoint (coap_ctx_t) is a UDP socket. A client endpoint talks to one
+ * server: coap_request() sends a request and waits for its response,
+ * retransmitting a confirmable request, and moves payloads larger than a
+ * block in blocks (RFC 7959). coap_observe() registers for notifications
+ * (RFC 7641), delivered by coap_poll(). A server endpoint serves the
+ * resources added with coap_server_add_resource() from coap_poll().
+ *
+ * The calls of an endpoint are blocking and must be made from one task.
+ * Handlers and callbacks run in that task and must not call coap_request().
+ */
+
+/* Transmission parameters (RFC 7252, 4.8) */
+#ifndef COAP_ACK_TIMEOUT_MS
+#define COAP_ACK_TIMEOUT_MS		2000
+#endif
+/* ACK_RANDOM_FACTOR 1.5, as the percentage added at most */
+#ifndef COAP_ACK_RANDOM_PERCENT
+#define COAP_ACK_RANDOM_PERCENT	50
+#endif
+#ifndef COAP_MAX_RETRANSMIT
+#define COAP_MAX_RETRANSMIT		4
+#endif
+/* How long to wait for a separate or a non-confirmable response */
+#ifndef COAP_RESPONSE_TIMEOUT_MS
+#define COAP_RESPONSE_TIMEOUT_MS	10000
+#endif
+
+/* Largest block (szx 6); a datagram carries a block and the header */
+#ifndef COAP_MAX_BLOCK_SIZE
+#define COAP_MAX_BLOCK_SIZE		1024
+#endif
+#define COAP_MAX_PDU_SIZE		(COAP_MAX_BLOCK_SIZE + 128)
+
+#ifndef COAP_MAX_OPTIONS
+#define COAP_MAX_OPTIONS		16
+#endif
+/* Storage for the values of the options added to a message */
+#ifndef COAP_OPTION_BUF_SIZE
+#define COAP_OPTION_BUF_SIZE	96
+#endif
+
+#ifndef COAP_MAX_OBSERVE
+#define COAP_MAX_OBSERVE		2		/* observations of a client */
+#endif
+#ifndef COAP_MAX_RESOURCES
+#define COAP_MAX_RESOURCES		8
+#endif
+#ifndef COAP_MAX_OBSERVERS
+#define COAP_MAX_OBSERVERS		4		/* observers of a server */
+#endif
+/* Every n-th notification is confirmable, to find observers gone away */
+#ifndef COAP_NOTIFY_CON_INTERVAL
+#define COAP_NOTIFY_CON_INTERVAL	8
+#endif
+
+#define COAP_DEFAULT_PORT		5683
+#define COAPS_DEFAULT_PORT		5684
+
+/** Return values of the CoAP API */
+typedef enum {
+	COAP_RET_ERROR_BLOCK = -12,		/**< Block-wise transfer out of order or changed */
+	COAP_RET_ERROR_DTLS = -11,		/**< DTLS handshake or record failure */
+	COAP_RET_ERROR_RESET = -10,		/**< The peer rejected the message with a reset */
+	COAP_RET_ERROR_TIMEOUT = -9,	/**< No acknowledgement or response */
+	COAP_RET_ERROR_FULL = -8,		/**< No free observation, resource or observer */
+	COAP_RET_ERROR_BUF_SIZE = -7,	/**< Message or payload does not fit */
+	COAP_RET_ERROR_FORMAT = -6,		/**< Malformed message */
+	COAP_RET_ERROR_ALLOC_FAIL = -5,	/**< Memory allocation fail */
+	COAP_RET_ERROR_SOCKET = -4,		/**< Socket creation, bind, send or receive fail */
+	COAP_RET_ERROR_RESOLVING_DNS = -3,	/**< Cannot resolve the hostname */
+	COAP_RET_ERROR_INVALID = -2,	/**< Invalid argument */
+	COAP_RET_ERROR = -1,			/**< Other error */
+	COAP_RET_OK = 0,				/**< Success */
+} coap_ret_e;
+
+/** Message types */
+enum {
+	COAP_TYPE_CON = 0,
+	COAP_TYPE_NON = 1,
+	COAP_TYPE_ACK = 2,
+	COAP_TYPE_RST = 3,
+};
+
+/** Codes: class.detail, e.g. COAP_CODE(2, 5) for 2.05 Content */
+#define COAP_CODE(c, d)		((uint8_t)(((c) << 5) | (d)))
+#define COAP_CODE_CLASS(code)	((code) >> 5)
+#define COAP_CODE_DETAIL(code)	((code) & 0x1f)
+
+enum {
+	COAP_CODE_EMPTY = 0,
+	COAP_METHOD_GET = 1,
+	COAP_METHOD_POST = 2,
+	COAP_METHOD_PUT = 3,
+	COAP_METHOD_DELETE = 4,
+	COAP_CODE_CREATED = COAP_CODE(2, 1),
+	COAP_CODE_DELETED = COAP_CODE(2, 2),
+	COAP_CODE_VALID = COAP_CODE(2, 3),
+	COAP_CODE_CHANGED = COAP_CODE(2, 4),
+	COAP_CODE_CONTENT = COAP_CODE(2, 5),
+	COAP_CODE_CONTINUE = COAP_CODE(2, 31),
+	COAP_CODE_BAD_REQUEST = COAP_CODE(4, 0),
+	COAP_CODE_BAD_OPTION = COAP_CODE(4, 2),
+	COAP_CODE_NOT_FOUND = COAP_CODE(4, 4),
+	COAP_CODE_METHOD_NOT_ALLOWED = COAP_CODE(4, 5),
+	COAP_CODE_REQUEST_ENTITY_INCOMPLETE = COAP_CODE(4, 8),
+	COAP_CODE_REQUEST_ENTITY_TOO_LARGE = COAP_CODE(4, 13),
+	COAP_CODE_INTERNAL_ERROR = COAP_CODE(5, 0),
+	COAP_CODE_SERVICE_UNAVAILABLE = COAP_CODE(5, 3),
+};
+
+/** Option numbers */
+enum {
+	COAP_OPTION_IF_MATCH = 1,
+	COAP_OPTION_URI_HOST = 3,
+	COAP_OPTION_ETAG = 4,
+	COAP_OPTION_IF_NONE_MATCH = 5,
+	COAP_OPTION_OBSERVE = 6,
+	COAP_OPTION_URI_PORT = 7,
+	COAP_OPTION_LOCATION_PATH = 8,
+	COAP_OPTION_URI_PATH = 11,
+	COAP_OPTION_CONTENT_FORMAT = 12,
+	COAP_OPTION_MAX_AGE = 14,
+	COAP_OPTION_URI_QUERY = 15,
+	COAP_OPTION_ACCEPT = 17,
+	COAP_OPTION_LOCATION_QUERY = 20,
+	COAP_OPTION_BLOCK2 = 23,
+	COAP_OPTION_BLOCK1 = 27,
+	COAP_OPTION_SIZE2 = 28,
+	COAP_OPTION_SIZE1 = 60,
+	COAP_OPTION_NO_RESPONSE = 258,
+};
+
+/** Content formats */
+enum {
+	COAP_FORMAT_NONE = -1,
+	COAP_FORMAT_TEXT = 0,
+	COAP_FORMAT_LINK = 40,
+	COAP_FORMAT_OCTET = 42,
+	COAP_FORMAT_JSON = 50,
+	COAP_FORMAT_CBOR = 60,
+};
+
+/** No-Response (RFC 7967): classes of responses not wanted */
+#define COAP_NO_RESPONSE_2XX	0x02
+#define COAP_NO_RESPONSE_4XX	0x08
+#define COAP_NO_RESPONSE_5XX	0x10
+
+/** An option, its value in the datagram decoded or in the message */
+typedef struct {
+	uint16_t num;
+	uint16_t len;
+	const uint8_t *val;
+} coap_option_t;
+
+/** A message. The options are kept sorted by number. */
+typedef struct {
+	uint8_t type;
+	uint8_t code;
+	uint16_t mid;
+	uint8_t token_len;
+	uint8_t token[8];
+	uint8_t num_options;
+	coap_option_t options[COAP_MAX_OPTIONS];
+	const uint8_t *payload;
+	size_t payload_len;
+	/* values of the options added by coap_msg_add_option() */
+	uint16_t opt_buf_len;
+	uint8_t opt_buf[COAP_OPTION_BUF_SIZE];
+} coap_msg_t;
+
+/** Block1 and Block2 option (RFC 7959): block num of 16 << szx bytes */
+typedef struct {
+	uint32_t num;
+	uint8_t more;
+	uint8_t szx;
+} coap_block_t;
+
+#define COAP_BLOCK_SIZE(szx)	(16U << (szx))
+
+/*********************************************************************
+ * @fn coap_msg_init
+ *
+ * @brief Start a message without token, options or payload
+ **********************************************************************/
+void coap_msg_init(coap_msg_t *msg, uint8_t type, uint8_t code, uint16_t mid);
+
+/*********************************************************************
+ * @fn coap_msg_set_token
+ *
+ * @brief Set the token, 0 to 8 bytes
+ *
+ * @return COAP_RET_OK, COAP_RET_ERROR_INVALID if longer
+ **********************************************************************/
+int coap_msg_set_token(coap_msg_t *msg, const uint8_t *token, uint8_t len);
+
+/*********************************************************************
+ * @fn coap_msg_add_option
+ *
+ * @brief Add an option, its value copied into the message. Options of
+ *        the same number keep the order they were added in.
+ *
+ * @return COAP_RET_OK, COAP_RET_ERROR_BUF_SIZE when the message has no
+ *         room left
+ **********************************************************************/
+int coap_msg_add_option(coap_msg_t *msg, uint16_t num, const void *val, size_t len);
+
+/*********************************************************************
+ * @fn coap_msg_add_option_uint
+ *
+ * @brief Add an option of uint format, in the fewest bytes
+ **********************************************************************/
+int coap_msg_add_option_uint(coap_msg_t *msg, uint16_t num, uint32_t val);
+
+/*********************************************************************
+ * @fn coap_msg_add_uri_path
+ *
+ * @brief Add a Uri-Path option for each segment of a path ("a/b/c");
+ *        leading, trailing and double slashes are skipped
+ **********************************************************************/
+int coap_msg_add_uri_path(coap_msg_t *msg, const char *path);
+
+/*********************************************************************
+ * @fn coap_msg_add_uri_query
+ *
+ * @brief Add a Uri-Query option for each argument of "k=v&k2=v2"
+ **********************************************************************/
+int coap_msg_add_uri_query(coap_msg_t *msg, const char *query);
+
+/*********************************************************************
+ * @fn coap_msg_add_block
+ *
+ * @brief Add a Block1 or Block2 option
+ **********************************************************************/
+int coap_msg_add_block(coap_msg_t *msg, uint16_t num, const coap_block_t *block);
+
+/*********************************************************************
+ * @fn coap_msg_remove_option
+ *
+ * @brief Remove all the options of a number
+ **********************************************************************/
+void coap_msg_remove_option(coap_msg_t *msg, uint16_t num);
+
+/*********************************************************************
+ * @fn coap_msg_find_option
+ *
+ * @brief Find an option
+ *
+ * @param after: NULL for the first option of the number, or the option
+ *               found before to get the next one
+ *
+ * @return the option, NULL if there is none (left)
+ **********************************************************************/
+const coap_option_t *coap_msg_find_option(const coap_msg_t *msg, uint16_t num,
+										  const coap_option_t *after);
+
+/*********************************************************************
+ * @fn coap_option_uint
+ *
+ * @brief The value of an option of uint format
+ **********************************************************************/
+uint32_t coap_option_uint(const coap_option_t *opt);
+
+/*********************************************************************
+ * @fn coap_msg_get_block
+ *
+ * @brief Get a Block1 or Block2 option
+ *
+ * @return 1 if the message has it, 0 if not, COAP_RET_ERROR_FORMAT if
+ *         it is invalid
+ **********************************************************************/
+int coap_msg_get_block(const coap_msg_t *msg, uint16_t num, coap_block_t *block);
+
+/*********************************************************************
+ * @fn coap_msg_get_uri_path
+ *
+ * @brief The Uri-Path options of a request joined with '/', without a
+ *        leading slash
+ *
+ * @return the length, COAP_RET_ERROR_BUF_SIZE if it does not fit
+ **********************************************************************/
+int coap_msg_get_uri_path(const coap_msg_t *msg, char *buf, size_t size);
+
+/*********************************************************************
+ * @fn coap_msg_get_content_format
+ *
+ * @brief The Content-Format option, COAP_FORMAT_NONE if absent
+ **********************************************************************/
+int coap_msg_get_content_format(const coap_msg_t *msg);
+
+/*********************************************************************
+ * @fn coap_msg_encode
+ *
+ * @brief Write a message in the format of a datagram
+ *
+ * @return the length, COAP_RET_ERROR_BUF_SIZE if it does not fit in
+ *         size bytes
+ **********************************************************************/
+int coap_msg_encode(const coap_msg_t *msg, uint8_t *buf, size_t size);
+
+/*********************************************************************
+ * @fn coap_msg_decode
+ *
+ * @brief Parse a datagram. The options and the payload point into buf,
+ *        which must outlive the message.
+ *
+ * @return COAP_RET_OK, COAP_RET_ERROR_FORMAT if malformed,
+ *         COAP_RET_ERROR_BUF_SIZE if it has more than COAP_MAX_OPTIONS
+ **********************************************************************/
+int coap_msg_decode(coap_msg_t *msg, const uint8_t *buf, size_t len);
+
+/** An endpoint */
+typedef struct coap_ctx coap_ctx_t;
+
+/** Pre-shared key of a DTLS client (TLS_PSK_WITH_AES_128_CCM_8, RFC 7252 9.1.3.1) */
+typedef struct {
+	const uint8_t *key;
+	size_t key_len;
+	const char *identity;
+} coap_psk_t;
+
+/** Counters of an endpoint, on the UDP payloads: DTLS records when secured */
+typedef struct {
+	uint32_t tx_datagrams;
+	uint32_t tx_bytes;
+	uint32_t rx_datagrams;
+	uint32_t rx_bytes;
+	uint32_t retransmissions;
+	uint32_t handshakes;			/* DTLS handshakes */
+	uint32_t handshake_bytes;		/* sent and received by them */
+} coap_stats_t;
+
+/** A request of coap_request() */
+typedef struct {
+	uint8_t method;				/**< COAP_METHOD_GET ... */
+	uint8_t confirmable;		/**< 1: CON, retransmitted until acknowledged, 0: NON */
+	uint8_t no_response;		/**< COAP_NO_RESPONSE_*: classes not waited for */
+	const char *path;			/**< "sensors/temp", NULL for none */
+	const char *query;			/**< "k=v&k2=v2", NULL for none */
+	int content_format;			/**< COAP_FORMAT_*, COAP_FORMAT_NONE for none */
+	const uint8_t *payload;		/**< sent in Block1 blocks when larger than a block */
+	size_t payload_len;
+} coap_req_t;
+
+/*********************************************************************
+ * @brief Data callback: a part of the response payload, as the blocks
+ *        of a block-wise response arrive
+ *
+ * @param offset: offset of data in the payload
+ *
+ * @param last: 1 for the last part
+ *
+ * @return 0 to go on, another value to stop the transfer:
+ *         coap_request() returns COAP_RET_ERROR
+ **********************************************************************/
+typedef int (*coap_data_cb_t)(void *arg, uint32_t offset, const uint8_t *data, size_t len, int last);
+
+/** The response of coap_request() */
+typedef struct {
+	uint8_t code;				/**< COAP_CODE_*, 0 if not waited for (no_response) */
+	int content_format;			/**< COAP_FORMAT_*, COAP_FORMAT_NONE for none */
+	uint8_t *buf;				/**< payload, if not NULL; truncated to buf_size */
+	size_t buf_size;
+	size_t len;					/**< payload length, all blocks */
+	coap_data_cb_t data_cb;		/**< if not NULL, called with each block */
+	void *arg;
+} coap_resp_t;
+
+/*********************************************************************
+ * @brief Notification callback of coap_observe()
+ *
+ * @param code: code of the notification, e.g. COAP_CODE_CONTENT. A code
+ *              other than 2.xx ends the observation.
+ *
+ * @param seq: the Observe sequence number, -1 for the last notification
+ **********************************************************************/
+typedef void (*coap_notify_cb_t)(void *arg, uint8_t code, int32_t seq,
+								 const uint8_t *payload, size_t len);
+
+/*********************************************************************
+ * @brief Resource handler of a server
+ *
+ * @param req: the request. A block of a Block1 transfer has the Block1
+ *             option (coap_msg_get_block()); the handler keeps the data
+ *             of each block, the acknowledgement with 2.31 Continue is
+ *             made for it.
+ *
+ * @param resp: the response, of COAP_CODE_CONTENT and no payload on
+ *              entry. The payload may be larger than a block, e.g. a
+ *              firmware image: the block the client asks for is sent.
+ *              It must stay valid after the handler returns, until the
+ *              next call of the handler.
+ *
+ * @return 0, or a COAP_CODE_* to respond with that code and no payload
+ **********************************************************************/
+typedef int (*coap_handler_t)(void *arg, const coap_msg_t *req, coap_msg_t *resp);
+
+/*********************************************************************
+ * @fn coap_client_open
+ *
+ * @brief Open a client endpoint to a server. With a PSK, the DTLS
+ *        handshake is made here.
+ *
+ * @param host: name or address of the server
+ *
+ * @param port: 0 for COAP_DEFAULT_PORT, or COAPS_DEFAULT_PORT with DTLS
+ *
+ * @param psk: NULL for CoAP over UDP
+ *
+ * @param ret: if not NULL, the coap_ret_e of a failure
+ *
+ * @return the endpoint, NULL on failure
+ **********************************************************************/
+coap_ctx_t *coap_client_open(const char *host, int port, const coap_psk_t *psk, int *ret);
+
+/*********************************************************************
+ * @fn coap_server_open
+ *
+ * @brief Open a server endpoint, CoAP over UDP
+ *
+ * @param port: 0 for COAP_DEFAULT_PORT
+ *
+ * @return the endpoint, NULL on failure
+ **********************************************************************/
+coap_ctx_t *coap_server_open(int port);
+
+/*********************************************************************
+ * @fn coap_close
+ *
+ * @brief Close an endpoint: end the DTLS session, close the socket and
+ *        free it. Observations are dropped without telling the server.
+ **********************************************************************/
+void coap_close(coap_ctx_t *ctx);
+
+/*********************************************************************
+ * @fn coap_set_block_size
+ *
+ * @brief Set the block size of block-wise transfers, 16 to
+ *        COAP_MAX_BLOCK_SIZE (default), a power of two. Smaller blocks
+ *        take fewer MAC fragments to send at a low MCS.
+ **********************************************************************/
+int coap_set_block_size(coap_ctx_t *ctx, size_t size);
+
+/*********************************************************************
+ * @fn coap_request
+ *
+ * @brief Send a request and wait for its response
+ *
+ * @param req: the request. A payload larger than a block is sent in
+ *             Block1 blocks, each waiting for the response to the one
+ *             before.
+ *
+ * @param resp: the response. A response with a Block2 option is
+ *              fetched up to its last block. May be NULL.
+ *
+ * @return COAP_RET_OK when a response came (see resp->code), or when
+ *         none was waited for; coap_ret_e error otherwise
+ **********************************************************************/
+int coap_request(coap_ctx_t *ctx, const coap_req_t *req, coap_resp_t *resp);
+
+/*********************************************************************
+ * @fn coap_observe
+ *
+ * @brief Observe a resource: GET it with the Observe option and call cb
+ *        with the response, then with each notification coap_poll()
+ *        receives. A notification should fit in a block.
+ *
+ * @param req: the GET request, confirmable or not. Its strings and
+ *             payload must stay valid until the observation ends.
+ *
+ * @return the handle of the observation (>= 0), or coap_ret_e.
+ *         COAP_RET_ERROR when the server does not keep the client as
+ *         an observer: cb got the response as a last notification.
+ **********************************************************************/
+int coap_observe(coap_ctx_t *ctx, const coap_req_t *req, coap_notify_cb_t cb, void *arg);
+
+/*********************************************************************
+ * @fn coap_observe_cancel
+ *
+ * @brief Cancel an observation, telling the server with a GET with the
+ *        Observe option 1, deregister (RFC 7641, 3.6)
+ **********************************************************************/
+int coap_observe_cancel(coap_ctx_t *ctx, int handle);
+
+/*********************************************************************
+ * @fn coap_server_add_resource
+ *
+ * @brief Serve a resource
+ *
+ * @param path: the Uri-Path, "a/b"; must stay valid
+ *
+ * @param observable: 1 if clients may observe it, see coap_notify()
+ *
+ * @return the resource id (>= 0), or coap_ret_e
+ **********************************************************************/
+int coap_server_add_resource(coap_ctx_t *ctx, const char *path, coap_handler_t handler,
+							 void *arg, int observable);
+
+/*********************************************************************
+ * @fn coap_notify
+ *
+ * @brief Tell the observers of a resource it changed: its handler is
+ *        called for each one and the response sent as a notification
+ *
+ * @return the number of observers notified
+ **********************************************************************/
+int coap_notify(coap_ctx_t *ctx, int resource);
+
+/*********************************************************************
+ * @fn coap_poll
+ *
+ * @brief Receive for up to timeout_ms: requests of a server endpoint,
+ *        notifications of a client one; retransmit confirmable
+ *        notifications not acknowledged yet
+ *
+ * @return the number of messages handled, or coap_ret_e
+ **********************************************************************/
+int coap_poll(coap_ctx_t *ctx, uint32_t timeout_ms);
+
+/*********************************************************************
+ * @fn coap_get_stats
+ *
+ * @brief The counters of an endpoint since it was opened
+ **********************************************************************/
+void coap_get_stats(const coap_ctx_t *ctx, coap_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NRC_COAP_H__ */
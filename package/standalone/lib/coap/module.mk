@@ -0,0 +1,13 @@
+COAP_SRC	= $(COAP_BASE)/src
+
+INCLUDE	+= -I$(COAP_BASE)/include
+
+VPATH	+= $(COAP_SRC)
+
+DEFINE	+= -DSUPPORT_COAP
+
+CSRCS	+= \
+	nrc_coap.c \
+	nrc_coap_dtls.c \
+	nrc_coap_msg.c \
+	nrc_coap_server.c
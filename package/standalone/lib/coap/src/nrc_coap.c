@@ -0,0 +1,724 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lwip/netdb.h"
+#include "lwip/errno.h"
+
+#include "nrc_coap_internal.h"
+
+/* the exchange of a request is over: a response, or an acknowledgement
+   when no response is waited for */
+#define COAP_EXCHANGE_RESPONSE	1
+#define COAP_EXCHANGE_ACK		0
+
+static int coap_time_before(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+uint32_t coap_ack_timeout(void)
+{
+	/* ACK_TIMEOUT to ACK_TIMEOUT * ACK_RANDOM_FACTOR */
+	return COAP_ACK_TIMEOUT_MS +
+		(uint32_t)rand() % (COAP_ACK_TIMEOUT_MS * COAP_ACK_RANDOM_PERCENT / 100 + 1);
+}
+
+int coap_peer_equal(const coap_peer_t *a, const coap_peer_t *b)
+{
+	const struct sockaddr *sa = (const struct sockaddr *)&a->addr;
+
+	if (a->len != b->len || sa->sa_family != ((const struct sockaddr *)&b->addr)->sa_family)
+		return 0;
+	if (sa->sa_family == AF_INET) {
+		const struct sockaddr_in *a4 = (const struct sockaddr_in *)&a->addr;
+		const struct sockaddr_in *b4 = (const struct sockaddr_in *)&b->addr;
+
+		return a4->sin_port == b4->sin_port && a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+	}
+	return memcmp(&a->addr, &b->addr, a->len) == 0;
+}
+
+int coap_sock_send(coap_ctx_t *ctx, const coap_peer_t *to, const uint8_t *buf, size_t len)
+{
+	int ret;
+
+	/* a client socket is connected to its server */
+	if (to == NULL)
+		ret = send(ctx->sock, buf, len, 0);
+	else
+		ret = sendto(ctx->sock, buf, len, 0, (const struct sockaddr *)&to->addr, to->len);
+	if (ret < 0) {
+		COAP_LOGE("send failed (%d)", errno);
+		return COAP_RET_ERROR_SOCKET;
+	}
+	ctx->stats.tx_datagrams++;
+	ctx->stats.tx_bytes += ret;
+	return ret;
+}
+
+int coap_sock_recv(coap_ctx_t *ctx, coap_peer_t *from, uint8_t *buf, size_t size,
+				   uint32_t timeout_ms)
+{
+	struct timeval tv;
+	fd_set fds;
+	int ret;
+
+	FD_ZERO(&fds);
+	FD_SET(ctx->sock, &fds);
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	ret = select(ctx->sock + 1, &fds, NULL, NULL, &tv);
+	if (ret == 0)
+		return 0;
+	if (ret < 0)
+		return COAP_RET_ERROR_SOCKET;
+
+	from->len = sizeof(from->addr);
+	ret = recvfrom(ctx->sock, buf, size, 0, (struct sockaddr *)&from->addr, &from->len);
+	if (ret < 0) {
+		COAP_LOGE("recv failed (%d)", errno);
+		return COAP_RET_ERROR_SOCKET;
+	}
+	ctx->stats.rx_datagrams++;
+	ctx->stats.rx_bytes += ret;
+	/* an empty datagram is not a message */
+	return ret > 0 ? ret : COAP_RET_ERROR_FORMAT;
+}
+
+static int coap_transport_send(coap_ctx_t *ctx, const coap_peer_t *to, const uint8_t *buf,
+							   size_t len)
+{
+#if defined(SUPPORT_MBEDTLS)
+	if (ctx->dtls != NULL)
+		return coap_dtls_send(ctx, buf, len);
+#endif
+	return coap_sock_send(ctx, ctx->server ? to : NULL, buf, len);
+}
+
+int coap_send_empty(coap_ctx_t *ctx, const coap_peer_t *to, uint8_t type, uint16_t mid)
+{
+	/* not through tx_buf, which may hold a request to retransmit */
+	uint8_t buf[4] = { (1 << 6) | (type << 4), COAP_CODE_EMPTY, mid >> 8, mid & 0xff };
+
+	return coap_transport_send(ctx, to, buf, sizeof(buf));
+}
+
+/* Receive a message into ctx->rx: 1, 0 on timeout, or coap_ret_e */
+static int coap_recv_msg(coap_ctx_t *ctx, uint32_t timeout_ms)
+{
+	int len;
+
+#if defined(SUPPORT_MBEDTLS)
+	if (ctx->dtls != NULL) {
+		len = coap_dtls_recv(ctx, ctx->rx_buf, sizeof(ctx->rx_buf), timeout_ms);
+		ctx->rx_peer = ctx->peer;
+	} else
+#endif
+	len = coap_sock_recv(ctx, &ctx->rx_peer, ctx->rx_buf, sizeof(ctx->rx_buf), timeout_ms);
+	if (len <= 0)
+		return len;
+
+	/* a client socket only receives from its server */
+	if (coap_msg_decode(&ctx->rx, ctx->rx_buf, len) != COAP_RET_OK) {
+		COAP_LOGD("malformed message of %d bytes dropped", len);
+		if (len >= 4 && (ctx->rx_buf[0] >> 6) == 1 && ((ctx->rx_buf[0] >> 4) & 3) == COAP_TYPE_CON)
+			coap_send_empty(ctx, &ctx->rx_peer, COAP_TYPE_RST,
+							(ctx->rx_buf[2] << 8) | ctx->rx_buf[3]);
+		return 0;
+	}
+	return 1;
+}
+
+static void coap_new_token(coap_ctx_t *ctx, uint8_t *token)
+{
+	uint32_t t = ctx->token++;
+
+	token[0] = t >> 24;
+	token[1] = t >> 16;
+	token[2] = t >> 8;
+	token[3] = t;
+}
+
+static int coap_token_equal(const coap_msg_t *msg, const uint8_t *token)
+{
+	return msg->token_len == COAP_TOKEN_LEN && memcmp(msg->token, token, COAP_TOKEN_LEN) == 0;
+}
+
+/*
+ * Notifications (RFC 7641, 3.4): a number newer than the last one, in the
+ * 2^23 window of the 24-bit sequence, or a notification coming more than
+ * 128 seconds after it
+ */
+static int coap_observe_fresh(const struct coap_observation *obs, uint32_t seq, uint32_t now)
+{
+	uint32_t v1 = obs->seq, v2 = seq;
+
+	return (v1 < v2 && v2 - v1 < (1UL << 23)) ||
+		   (v1 > v2 && v1 - v2 > (1UL << 23)) ||
+		   (uint32_t)(now - obs->time) > COAP_OBSERVE_FRESH_MS;
+}
+
+/* A notification, or a response nobody waits for */
+static void coap_client_handle(coap_ctx_t *ctx)
+{
+	coap_msg_t *msg = &ctx->rx;
+	const coap_option_t *opt;
+	struct coap_observation *obs = NULL;
+	uint32_t now = sys_now();
+	int i;
+
+	if (msg->code == COAP_CODE_EMPTY || COAP_CODE_CLASS(msg->code) == 0) {
+		/* a late ACK, a ping or a request: a client serves nothing */
+		if (msg->type == COAP_TYPE_CON)
+			coap_send_empty(ctx, &ctx->rx_peer, COAP_TYPE_RST, msg->mid);
+		return;
+	}
+	if (msg->type == COAP_TYPE_ACK || msg->type == COAP_TYPE_RST)
+		return;
+
+	for (i = 0; i < COAP_MAX_OBSERVE; i++) {
+		if (ctx->obs[i].used && coap_token_equal(msg, ctx->obs[i].token)) {
+			obs = &ctx->obs[i];
+			break;
+		}
+	}
+	if (obs == NULL) {
+		/* ends the observation of the server (RFC 7641, 3.6) */
+		coap_send_empty(ctx, &ctx->rx_peer, COAP_TYPE_RST, msg->mid);
+		return;
+	}
+	if (msg->type == COAP_TYPE_CON)
+		coap_send_empty(ctx, &ctx->rx_peer, COAP_TYPE_ACK, msg->mid);
+
+	opt = coap_msg_find_option(msg, COAP_OPTION_OBSERVE, NULL);
+	if (opt == NULL || COAP_CODE_CLASS(msg->code) != 2) {
+		obs->used = 0;
+		obs->cb(obs->arg, msg->code, -1, msg->payload, msg->payload_len);
+		return;
+	}
+	if (!coap_observe_fresh(obs, coap_option_uint(opt), now)) {
+		COAP_LOGD("notification %u older than %u dropped", coap_option_uint(opt), obs->seq);
+		return;
+	}
+	obs->seq = coap_option_uint(opt);
+	obs->time = now;
+	obs->cb(obs->arg, msg->code, obs->seq, msg->payload, msg->payload_len);
+}
+
+static void coap_handle(coap_ctx_t *ctx)
+{
+	if (ctx->server != NULL)
+		coap_server_handle(ctx);
+	else
+		coap_client_handle(ctx);
+}
+
+/*
+ * Send the request in ctx->tx and wait for its response, retransmitting a
+ * confirmable request with exponential back-off (RFC 7252, 4.2). The
+ * response is left in ctx->rx.
+ */
+static int coap_exchange(coap_ctx_t *ctx, int wait_response)
+{
+	const coap_msg_t *req = &ctx->tx;
+	uint32_t timeout = coap_ack_timeout();
+	uint32_t deadline;
+	int retries = 0, acked = 0;
+	int len, ret;
+
+	len = coap_msg_encode(req, ctx->tx_buf, sizeof(ctx->tx_buf));
+	if (len < 0)
+		return len;
+	ret = coap_transport_send(ctx, NULL, ctx->tx_buf, len);
+	if (ret < 0)
+		return ret;
+	if (req->type == COAP_TYPE_NON) {
+		if (!wait_response)
+			return COAP_EXCHANGE_ACK;
+		acked = 1;
+		timeout = COAP_RESPONSE_TIMEOUT_MS;
+	}
+	deadline = sys_now() + timeout;
+
+	for (;;) {
+		uint32_t now = sys_now();
+		coap_msg_t *msg = &ctx->rx;
+
+		if (!coap_time_before(now, deadline)) {
+			if (acked || retries == COAP_MAX_RETRANSMIT)
+				return COAP_RET_ERROR_TIMEOUT;
+			retries++;
+			timeout *= 2;
+			deadline = now + timeout;
+			ctx->stats.retransmissions++;
+			COAP_LOGD("retransmission %d of mid %u", retries, req->mid);
+			ret = coap_transport_send(ctx, NULL, ctx->tx_buf, len);
+			if (ret < 0)
+				return ret;
+			continue;
+		}
+
+		ret = coap_recv_msg(ctx, deadline - now);
+		if (ret < 0)
+			return ret;
+		if (ret == 0)
+			continue;
+
+		if ((msg->type == COAP_TYPE_ACK || msg->type == COAP_TYPE_RST) && msg->mid == req->mid) {
+			if (msg->type == COAP_TYPE_RST)
+				return COAP_RET_ERROR_RESET;
+			if (msg->code != COAP_CODE_EMPTY) {
+				/* piggybacked */
+				if (coap_token_equal(msg, req->token))
+					return COAP_EXCHANGE_RESPONSE;
+				continue;
+			}
+			if (!wait_response)
+				return COAP_EXCHANGE_ACK;
+			/* a separate response follows */
+			acked = 1;
+			deadline = sys_now() + COAP_RESPONSE_TIMEOUT_MS;
+			continue;
+		}
+		if ((msg->type == COAP_TYPE_CON || msg->type == COAP_TYPE_NON) &&
+			COAP_CODE_CLASS(msg->code) >= 2 && coap_token_equal(msg, req->token)) {
+			if (msg->type == COAP_TYPE_CON)
+				coap_send_empty(ctx, NULL, COAP_TYPE_ACK, msg->mid);
+			return COAP_EXCHANGE_RESPONSE;
+		}
+		coap_handle(ctx);
+	}
+}
+
+/* The options of a request, without block options */
+static int coap_build_request(coap_ctx_t *ctx, const coap_req_t *req, const uint8_t *token)
+{
+	coap_msg_t *msg = &ctx->tx;
+	int ret;
+
+	coap_msg_init(msg, req->confirmable ? COAP_TYPE_CON : COAP_TYPE_NON, req->method, ctx->mid++);
+	coap_msg_set_token(msg, token, COAP_TOKEN_LEN);
+	if (req->path != NULL && (ret = coap_msg_add_uri_path(msg, req->path)) != COAP_RET_OK)
+		return ret;
+	if (req->query != NULL && (ret = coap_msg_add_uri_query(msg, req->query)) != COAP_RET_OK)
+		return ret;
+	if (req->content_format != COAP_FORMAT_NONE && req->payload_len > 0 &&
+		(ret = coap_msg_add_option_uint(msg, COAP_OPTION_CONTENT_FORMAT, req->content_format)) != COAP_RET_OK)
+		return ret;
+	if (req->no_response != 0 &&
+		(ret = coap_msg_add_option_uint(msg, COAP_OPTION_NO_RESPONSE, req->no_response)) != COAP_RET_OK)
+		return ret;
+	return COAP_RET_OK;
+}
+
+static int coap_resp_data(coap_resp_t *resp, uint32_t offset, const uint8_t *data, size_t len,
+						  int last)
+{
+	if (resp->buf != NULL && offset < resp->buf_size)
+		memcpy(resp->buf + offset, data, (len < resp->buf_size - offset) ? len : resp->buf_size - offset);
+	resp->len = offset + len;
+	if (resp->data_cb != NULL && resp->data_cb(resp->arg, offset, data, len, last) != 0)
+		return COAP_RET_ERROR;
+	return COAP_RET_OK;
+}
+
+/* Payload of ctx->rx and the next Block2 blocks of the response */
+static int coap_fetch_blocks(coap_ctx_t *ctx, const coap_req_t *req, const uint8_t *token,
+							 coap_resp_t *resp)
+{
+	uint8_t etag[8];
+	int etag_len = -1;
+	uint32_t offset = 0;
+	coap_block_t b2;
+	coap_req_t next = *req;
+	int ret;
+
+	/* the next requests have no payload, a POST after Block1 as well
+	   (RFC 7959, 3.3) */
+	next.payload = NULL;
+	next.payload_len = 0;
+
+	for (;;) {
+		const coap_msg_t *msg = &ctx->rx;
+		const coap_option_t *opt = coap_msg_find_option(msg, COAP_OPTION_ETAG, NULL);
+
+		resp->code = msg->code;
+		resp->content_format = coap_msg_get_content_format(msg);
+		ret = coap_msg_get_block(msg, COAP_OPTION_BLOCK2, &b2);
+		if (ret < 0)
+			return ret;
+		if (ret == 0 || COAP_CODE_CLASS(msg->code) != 2)
+			return coap_resp_data(resp, offset, msg->payload, msg->payload_len, 1);
+
+		/* the representation must not change under the transfer */
+		if (b2.num * COAP_BLOCK_SIZE(b2.szx) != offset ||
+			(b2.more && msg->payload_len != COAP_BLOCK_SIZE(b2.szx)))
+			return COAP_RET_ERROR_BLOCK;
+		if (etag_len < 0) {
+			etag_len = opt ? opt->len : 0;
+			if (opt != NULL)
+				memcpy(etag, opt->val, opt->len < sizeof(etag) ? opt->len : sizeof(etag));
+		} else if ((opt ? opt->len : 0) != etag_len ||
+				   (opt != NULL && memcmp(etag, opt->val, etag_len) != 0)) {
+			return COAP_RET_ERROR_BLOCK;
+		}
+
+		ret = coap_resp_data(resp, offset, msg->payload, msg->payload_len, !b2.more);
+		if (ret != COAP_RET_OK || !b2.more)
+			return ret;
+		offset += msg->payload_len;
+
+		b2.num++;
+		b2.more = 0;
+		if ((ret = coap_build_request(ctx, &next, token)) != COAP_RET_OK ||
+			(ret = coap_msg_add_block(&ctx->tx, COAP_OPTION_BLOCK2, &b2)) != COAP_RET_OK)
+			return ret;
+		ret = coap_exchange(ctx, 1);
+		if (ret < 0)
+			return ret;
+	}
+}
+
+int coap_request(coap_ctx_t *ctx, const coap_req_t *req, coap_resp_t *resp)
+{
+	uint8_t token[COAP_TOKEN_LEN];
+	coap_resp_t none;
+	coap_block_t b1 = { 0, 0, ctx->szx };
+	size_t sent = 0;
+	int wait_response;
+	int ret;
+
+	if (ctx == NULL || req == NULL)
+		return COAP_RET_ERROR_INVALID;
+	if (resp == NULL) {
+		memset(&none, 0, sizeof(none));
+		resp = &none;
+	}
+	resp->code = 0;
+	resp->content_format = COAP_FORMAT_NONE;
+	resp->len = 0;
+	wait_response = !(req->no_response & COAP_NO_RESPONSE_2XX);
+
+	coap_new_token(ctx, token);
+	for (;;) {
+		size_t block = COAP_BLOCK_SIZE(b1.szx);
+		size_t len = req->payload_len - sent;
+
+		if ((ret = coap_build_request(ctx, req, token)) != COAP_RET_OK)
+			return ret;
+		if (req->payload_len > COAP_BLOCK_SIZE(ctx->szx)) {
+			/* Block1, the size with the first block (RFC 7959, 4) */
+			b1.num = sent / block;
+			b1.more = len > block;
+			if (b1.more)
+				len = block;
+			if ((ret = coap_msg_add_block(&ctx->tx, COAP_OPTION_BLOCK1, &b1)) != COAP_RET_OK ||
+				(sent == 0 &&
+				 (ret = coap_msg_add_option_uint(&ctx->tx, COAP_OPTION_SIZE1, req->payload_len)) != COAP_RET_OK))
+				return ret;
+		} else if (req->method == COAP_METHOD_GET && ctx->szx < 6) {
+			/* ask for smaller blocks from the first one */
+			coap_block_t b2 = { 0, 0, ctx->szx };
+
+			if ((ret = coap_msg_add_block(&ctx->tx, COAP_OPTION_BLOCK2, &b2)) != COAP_RET_OK)
+				return ret;
+		}
+		ctx->tx.payload = req->payload + sent;
+		ctx->tx.payload_len = len;
+		/* the blocks before the last one are answered with 2.31 Continue */
+		if (b1.more)
+			coap_msg_remove_option(&ctx->tx, COAP_OPTION_NO_RESPONSE);
+
+		ret = coap_exchange(ctx, wait_response || b1.more);
+		if (ret < 0)
+			return ret;
+		if (ret == COAP_EXCHANGE_ACK)
+			return COAP_RET_OK;
+		if (!b1.more || ctx->rx.code != COAP_CODE_CONTINUE)
+			break;
+
+		/* the server may ask for smaller blocks */
+		sent += len;
+		if (coap_msg_get_block(&ctx->rx, COAP_OPTION_BLOCK1, &b1) == 1 && b1.szx < ctx->szx) {
+			COAP_LOGD("block1 size %u asked", COAP_BLOCK_SIZE(b1.szx));
+		} else {
+			b1.szx = ctx->szx;
+		}
+		if (sent % COAP_BLOCK_SIZE(b1.szx) != 0)
+			return COAP_RET_ERROR_BLOCK;
+	}
+
+	return coap_fetch_blocks(ctx, req, token, resp);
+}
+
+int coap_observe(coap_ctx_t *ctx, const coap_req_t *req, coap_notify_cb_t cb, void *arg)
+{
+	struct coap_observation *obs = NULL;
+	const coap_option_t *opt;
+	int i, ret;
+
+	if (ctx == NULL || req == NULL || cb == NULL || req->method != COAP_METHOD_GET)
+		return COAP_RET_ERROR_INVALID;
+	for (i = 0; i < COAP_MAX_OBSERVE; i++) {
+		if (!ctx->obs[i].used) {
+			obs = &ctx->obs[i];
+			break;
+		}
+	}
+	if (obs == NULL)
+		return COAP_RET_ERROR_FULL;
+
+	coap_new_token(ctx, obs->token);
+	if ((ret = coap_build_request(ctx, req, obs->token)) != COAP_RET_OK ||
+		(ret = coap_msg_add_option_uint(&ctx->tx, COAP_OPTION_OBSERVE, 0)) != COAP_RET_OK)
+		return ret;
+	ret = coap_exchange(ctx, 1);
+	if (ret < 0)
+		return ret;
+
+	opt = coap_msg_find_option(&ctx->rx, COAP_OPTION_OBSERVE, NULL);
+	if (opt == NULL || COAP_CODE_CLASS(ctx->rx.code) != 2) {
+		cb(arg, ctx->rx.code, -1, ctx->rx.payload, ctx->rx.payload_len);
+		return COAP_RET_ERROR;
+	}
+	obs->used = 1;
+	obs->seq = coap_option_uint(opt);
+	obs->time = sys_now();
+	obs->req = *req;
+	obs->cb = cb;
+	obs->arg = arg;
+	cb(arg, ctx->rx.code, obs->seq, ctx->rx.payload, ctx->rx.payload_len);
+	return i;
+}
+
+int coap_observe_cancel(coap_ctx_t *ctx, int handle)
+{
+	struct coap_observation *obs;
+	int ret;
+
+	if (ctx == NULL || handle < 0 || handle >= COAP_MAX_OBSERVE || !ctx->obs[handle].used)
+		return COAP_RET_ERROR_INVALID;
+	obs = &ctx->obs[handle];
+	obs->used = 0;
+
+	if ((ret = coap_build_request(ctx, &obs->req, obs->token)) != COAP_RET_OK ||
+		(ret = coap_msg_add_option_uint(&ctx->tx, COAP_OPTION_OBSERVE, 1)) != COAP_RET_OK)
+		return ret;
+	ret = coap_exchange(ctx, 1);
+	return ret < 0 ? ret : COAP_RET_OK;
+}
+
+int coap_poll(coap_ctx_t *ctx, uint32_t timeout_ms)
+{
+	uint32_t deadline = sys_now() + timeout_ms;
+	int handled = 0;
+	int ret;
+
+	if (ctx == NULL)
+		return COAP_RET_ERROR_INVALID;
+	for (;;) {
+		uint32_t now = sys_now();
+		uint32_t wait = coap_time_before(now, deadline) ? deadline - now : 0;
+
+		if (ctx->server != NULL) {
+			uint32_t next = coap_server_timer(ctx);
+
+			if (next < wait)
+				wait = next;
+		}
+		ret = coap_recv_msg(ctx, wait);
+		if (ret < 0)
+			return ret;
+		if (ret > 0) {
+			coap_handle(ctx);
+			handled++;
+		} else if (!coap_time_before(sys_now(), deadline)) {
+			return handled;
+		}
+	}
+}
+
+static coap_ctx_t *coap_ctx_alloc(void)
+{
+	coap_ctx_t *ctx = (coap_ctx_t *)nrc_mem_malloc(sizeof(coap_ctx_t));
+
+	if (ctx == NULL)
+		return NULL;
+	memset(ctx, 0, sizeof(coap_ctx_t));
+	ctx->sock = -1;
+	ctx->mid = rand();
+	ctx->token = ((uint32_t)rand() << 16) ^ rand();
+	coap_set_block_size(ctx, COAP_MAX_BLOCK_SIZE);
+	return ctx;
+}
+
+static int coap_resolve(const char *host, int port, coap_peer_t *peer)
+{
+	struct addrinfo hints, *result = NULL, *res;
+	int ret = COAP_RET_ERROR_RESOLVING_DNS;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL)
+		return ret;
+
+	/* prefer ip4 addresses */
+	for (res = result; res != NULL; res = res->ai_next) {
+		if (res->ai_family == AF_INET)
+			break;
+	}
+	if (res == NULL)
+		res = result;
+	if (res->ai_addrlen <= sizeof(peer->addr)) {
+		memcpy(&peer->addr, res->ai_addr, res->ai_addrlen);
+		peer->len = res->ai_addrlen;
+		if (res->ai_family == AF_INET)
+			((struct sockaddr_in *)&peer->addr)->sin_port = htons(port);
+#if defined(CONFIG_IPV6) || !defined(SUPPORT_LWIP)
+		else if (res->ai_family == AF_INET6)
+			((struct sockaddr_in6 *)&peer->addr)->sin6_port = htons(port);
+#endif
+		ret = COAP_RET_OK;
+	}
+	freeaddrinfo(result);
+	return ret;
+}
+
+coap_ctx_t *coap_client_open(const char *host, int port, const coap_psk_t *psk, int *ret)
+{
+	coap_ctx_t *ctx;
+	int err;
+
+	if (host == NULL) {
+		err = COAP_RET_ERROR_INVALID;
+		goto fail_ret;
+	}
+	if (port == 0)
+		port = psk ? COAPS_DEFAULT_PORT : COAP_DEFAULT_PORT;
+#if !defined(SUPPORT_MBEDTLS)
+	if (psk != NULL) {
+		err = COAP_RET_ERROR_INVALID;
+		goto fail_ret;
+	}
+#endif
+
+	ctx = coap_ctx_alloc();
+	if (ctx == NULL) {
+		err = COAP_RET_ERROR_ALLOC_FAIL;
+		goto fail_ret;
+	}
+	err = coap_resolve(host, port, &ctx->peer);
+	if (err != COAP_RET_OK) {
+		COAP_LOGE("cannot resolve %s", host);
+		goto fail;
+	}
+	ctx->sock = socket(((struct sockaddr *)&ctx->peer.addr)->sa_family, SOCK_DGRAM, 0);
+	if (ctx->sock < 0 ||
+		connect(ctx->sock, (struct sockaddr *)&ctx->peer.addr, ctx->peer.len) < 0) {
+		COAP_LOGE("socket to %s:%d failed", host, port);
+		err = COAP_RET_ERROR_SOCKET;
+		goto fail;
+	}
+#if defined(SUPPORT_MBEDTLS)
+	if (psk != NULL && (err = coap_dtls_connect(ctx, host, port, psk)) != COAP_RET_OK)
+		goto fail;
+#endif
+	if (ret != NULL)
+		*ret = COAP_RET_OK;
+	return ctx;
+
+fail:
+	coap_close(ctx);
+fail_ret:
+	if (ret != NULL)
+		*ret = err;
+	return NULL;
+}
+
+coap_ctx_t *coap_server_open(int port)
+{
+	struct sockaddr_in addr;
+	coap_ctx_t *ctx;
+
+	ctx = coap_ctx_alloc();
+	if (ctx == NULL)
+		return NULL;
+	if (coap_server_init(ctx) != COAP_RET_OK)
+		goto fail;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port ? port : COAP_DEFAULT_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	ctx->sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (ctx->sock < 0 || bind(ctx->sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		COAP_LOGE("bind to port %d failed", port);
+		goto fail;
+	}
+	return ctx;
+
+fail:
+	coap_close(ctx);
+	return NULL;
+}
+
+void coap_close(coap_ctx_t *ctx)
+{
+	if (ctx == NULL)
+		return;
+#if defined(SUPPORT_MBEDTLS)
+	if (ctx->dtls != NULL)
+		coap_dtls_close(ctx);
+#endif
+	if (ctx->server != NULL)
+		coap_server_free(ctx);
+	if (ctx->sock >= 0)
+		close(ctx->sock);
+	nrc_mem_free(ctx);
+}
+
+int coap_set_block_size(coap_ctx_t *ctx, size_t size)
+{
+	uint8_t szx;
+
+	if (ctx == NULL)
+		return COAP_RET_ERROR_INVALID;
+	for (szx = 0; szx <= 6; szx++) {
+		if (COAP_BLOCK_SIZE(szx) == size && size <= COAP_MAX_BLOCK_SIZE) {
+			ctx->szx = szx;
+			return COAP_RET_OK;
+		}
+	}
+	return COAP_RET_ERROR_INVALID;
+}
+
+void coap_get_stats(const coap_ctx_t *ctx, coap_stats_t *stats)
+{
+	*stats = ctx->stats;
+}
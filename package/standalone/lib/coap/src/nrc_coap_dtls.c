@@ -0,0 +1,231 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * DTLS client of a CoAP endpoint, PreSharedKey mode of RFC 7252, 9.1.3.1:
+ * TLS_PSK_WITH_AES_128_CCM_8 on the UDP socket of the endpoint. The records
+ * of the handshake and of the messages go through coap_sock_send() and
+ * coap_sock_recv(), and are counted in the stats of the endpoint.
+ */
+
+#if defined(SUPPORT_MBEDTLS)
+
+#include <string.h>
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/timing.h"
+#include "tls_session_cache.h"
+
+#include "nrc_coap_internal.h"
+
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+
+struct coap_dtls {
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_config conf;
+	mbedtls_entropy_context entropy;
+	mbedtls_ctr_drbg_context ctr_drbg;
+	mbedtls_timing_delay_context timer;
+	uint8_t handshake;
+};
+
+static const int coap_dtls_ciphersuites[] = {
+	MBEDTLS_TLS_PSK_WITH_AES_128_CCM_8,
+	0
+};
+
+static int coap_dtls_bio_send(void *arg, const unsigned char *buf, size_t len)
+{
+	coap_ctx_t *ctx = (coap_ctx_t *)arg;
+	int ret = coap_sock_send(ctx, NULL, buf, len);
+
+	if (ret < 0)
+		return MBEDTLS_ERR_NET_SEND_FAILED;
+	if (ctx->dtls->handshake)
+		ctx->stats.handshake_bytes += ret;
+	return ret;
+}
+
+static int coap_dtls_bio_recv(void *arg, unsigned char *buf, size_t len, uint32_t timeout)
+{
+	coap_ctx_t *ctx = (coap_ctx_t *)arg;
+	coap_peer_t from;
+	int ret;
+
+	ret = coap_sock_recv(ctx, &from, buf, len, timeout);
+	if (ret == 0)
+		return MBEDTLS_ERR_SSL_TIMEOUT;
+	if (ret < 0)
+		return MBEDTLS_ERR_NET_RECV_FAILED;
+	if (ctx->dtls->handshake)
+		ctx->stats.handshake_bytes += ret;
+	return ret;
+}
+
+int coap_dtls_connect(coap_ctx_t *ctx, const char *host, int port, const coap_psk_t *psk)
+{
+	struct coap_dtls *dtls;
+	int ret;
+
+	dtls = (struct coap_dtls *)nrc_mem_malloc(sizeof(struct coap_dtls));
+	if (dtls == NULL)
+		return COAP_RET_ERROR_ALLOC_FAIL;
+	memset(dtls, 0, sizeof(struct coap_dtls));
+	ctx->dtls = dtls;
+
+	mbedtls_ssl_init(&dtls->ssl);
+	mbedtls_ssl_config_init(&dtls->conf);
+	mbedtls_entropy_init(&dtls->entropy);
+	mbedtls_ctr_drbg_init(&dtls->ctr_drbg);
+
+	if ((ret = mbedtls_ctr_drbg_seed(&dtls->ctr_drbg, mbedtls_entropy_func, &dtls->entropy,
+									 (const unsigned char *)"coap", 4)) != 0) {
+		COAP_LOGE("mbedtls_ctr_drbg_seed returned -0x%x", -ret);
+		goto fail;
+	}
+	if ((ret = mbedtls_ssl_config_defaults(&dtls->conf, MBEDTLS_SSL_IS_CLIENT,
+										   MBEDTLS_SSL_TRANSPORT_DATAGRAM,
+										   MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+		COAP_LOGE("mbedtls_ssl_config_defaults returned -0x%x", -ret);
+		goto fail;
+	}
+	mbedtls_ssl_conf_rng(&dtls->conf, mbedtls_ctr_drbg_random, &dtls->ctr_drbg);
+	mbedtls_ssl_conf_ciphersuites(&dtls->conf, coap_dtls_ciphersuites);
+	if ((ret = mbedtls_ssl_conf_psk(&dtls->conf, psk->key, psk->key_len,
+									(const unsigned char *)psk->identity,
+									strlen(psk->identity))) != 0) {
+		COAP_LOGE("mbedtls_ssl_conf_psk returned -0x%x", -ret);
+		goto fail;
+	}
+	/* the retransmission timer of CoAP for the flights of the handshake */
+	mbedtls_ssl_conf_handshake_timeout(&dtls->conf, COAP_ACK_TIMEOUT_MS,
+									   COAP_ACK_TIMEOUT_MS << COAP_MAX_RETRANSMIT);
+	mbedtls_ssl_conf_read_timeout(&dtls->conf, COAP_ACK_TIMEOUT_MS);
+
+	if ((ret = mbedtls_ssl_setup(&dtls->ssl, &dtls->conf)) != 0) {
+		COAP_LOGE("mbedtls_ssl_setup returned -0x%x", -ret);
+		goto fail;
+	}
+	mbedtls_ssl_set_bio(&dtls->ssl, ctx, coap_dtls_bio_send, NULL, coap_dtls_bio_recv);
+	mbedtls_ssl_set_timer_cb(&dtls->ssl, &dtls->timer, mbedtls_timing_set_delay,
+							 mbedtls_timing_get_delay);
+#if defined(NRC_TLS_SESSION_CACHE)
+	tls_session_cache_set(&dtls->ssl, host, port);
+#endif
+
+	dtls->handshake = 1;
+	ctx->stats.handshakes++;
+	while ((ret = mbedtls_ssl_handshake(&dtls->ssl)) != 0) {
+		if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+			COAP_LOGE("DTLS handshake with %s:%d returned -0x%x", host, port, -ret);
+#if defined(NRC_TLS_SESSION_CACHE)
+			tls_session_cache_remove(host, port);
+#endif
+			goto fail;
+		}
+	}
+	dtls->handshake = 0;
+#if defined(NRC_TLS_SESSION_CACHE)
+	if (tls_session_cache_update(&dtls->ssl, host, port))
+		COAP_LOGD("DTLS session resumed");
+#endif
+	return COAP_RET_OK;
+
+fail:
+	coap_dtls_close(ctx);
+	return COAP_RET_ERROR_DTLS;
+}
+
+int coap_dtls_send(coap_ctx_t *ctx, const uint8_t *buf, size_t len)
+{
+	int ret;
+
+	do {
+		ret = mbedtls_ssl_write(&ctx->dtls->ssl, buf, len);
+	} while (ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+	if (ret < 0) {
+		COAP_LOGE("mbedtls_ssl_write returned -0x%x", -ret);
+		return COAP_RET_ERROR_DTLS;
+	}
+	return ret;
+}
+
+int coap_dtls_recv(coap_ctx_t *ctx, uint8_t *buf, size_t size, uint32_t timeout_ms)
+{
+	int ret;
+
+	/* a read timeout of 0 waits forever */
+	mbedtls_ssl_conf_read_timeout(&ctx->dtls->conf, timeout_ms ? timeout_ms : 1);
+	ret = mbedtls_ssl_read(&ctx->dtls->ssl, buf, size);
+	if (ret > 0)
+		return ret;
+	if (ret == MBEDTLS_ERR_SSL_TIMEOUT || ret == MBEDTLS_ERR_SSL_WANT_READ)
+		return 0;
+	COAP_LOGE("mbedtls_ssl_read returned -0x%x", -ret);
+	return COAP_RET_ERROR_DTLS;
+}
+
+void coap_dtls_close(coap_ctx_t *ctx)
+{
+	struct coap_dtls *dtls = ctx->dtls;
+
+	if (!dtls->handshake)
+		mbedtls_ssl_close_notify(&dtls->ssl);
+	mbedtls_ssl_free(&dtls->ssl);
+	mbedtls_ssl_config_free(&dtls->conf);
+	mbedtls_ctr_drbg_free(&dtls->ctr_drbg);
+	mbedtls_entropy_free(&dtls->entropy);
+	nrc_mem_free(dtls);
+	ctx->dtls = NULL;
+}
+
+#else
+
+int coap_dtls_connect(coap_ctx_t *ctx, const char *host, int port, const coap_psk_t *psk)
+{
+	COAP_LOGE("DTLS is not enabled in mbedTLS");
+	return COAP_RET_ERROR_DTLS;
+}
+
+int coap_dtls_send(coap_ctx_t *ctx, const uint8_t *buf, size_t len)
+{
+	return COAP_RET_ERROR_DTLS;
+}
+
+int coap_dtls_recv(coap_ctx_t *ctx, uint8_t *buf, size_t size, uint32_t timeout_ms)
+{
+	return COAP_RET_ERROR_DTLS;
+}
+
+void coap_dtls_close(coap_ctx_t *ctx)
+{
+}
+
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
+
+#endif /* SUPPORT_MBEDTLS */
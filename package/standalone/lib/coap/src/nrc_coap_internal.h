@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __NRC_COAP_INTERNAL_H__
+#define __NRC_COAP_INTERNAL_H__
+
+#include "nrc_sdk.h"
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+
+#include "nrc_coap.h"
+
+//#define COAP_DEBUG
+
+#define COAP_LOGE(format, ...) nrc_usr_print("[COAP] " format "\n", ##__VA_ARGS__)
+#if defined(COAP_DEBUG)
+#define COAP_LOGD(format, ...) nrc_usr_print("[COAP] " format "\n", ##__VA_ARGS__)
+#else
+#define COAP_LOGD(format, ...) do { } while (0)
+#endif
+
+#define COAP_TOKEN_LEN		4
+
+/* RFC 7641, 3.4: a notification older than this is fresh whatever its number */
+#define COAP_OBSERVE_FRESH_MS	(128 * 1000)
+
+typedef struct {
+	struct sockaddr_storage addr;
+	socklen_t len;
+} coap_peer_t;
+
+/* An observation of a client */
+struct coap_observation {
+	uint8_t used;
+	uint8_t token[COAP_TOKEN_LEN];
+	uint32_t seq;
+	uint32_t time;
+	coap_req_t req;
+	coap_notify_cb_t cb;
+	void *arg;
+};
+
+struct coap_server;
+struct coap_dtls;
+
+struct coap_ctx {
+	int sock;
+	coap_peer_t peer;				/* the server of a client */
+	uint16_t mid;
+	uint32_t token;
+	uint8_t szx;					/* block size */
+	coap_stats_t stats;
+
+	struct coap_dtls *dtls;			/* NULL over UDP */
+	struct coap_server *server;		/* NULL for a client */
+	struct coap_observation obs[COAP_MAX_OBSERVE];
+
+	coap_msg_t tx;
+	coap_msg_t rx;
+	coap_peer_t rx_peer;
+	uint8_t tx_buf[COAP_MAX_PDU_SIZE];
+	uint8_t rx_buf[COAP_MAX_PDU_SIZE];
+};
+
+/* nrc_coap.c */
+int coap_sock_send(coap_ctx_t *ctx, const coap_peer_t *to, const uint8_t *buf, size_t len);
+int coap_sock_recv(coap_ctx_t *ctx, coap_peer_t *from, uint8_t *buf, size_t size,
+				   uint32_t timeout_ms);
+int coap_send_empty(coap_ctx_t *ctx, const coap_peer_t *to, uint8_t type, uint16_t mid);
+int coap_peer_equal(const coap_peer_t *a, const coap_peer_t *b);
+uint32_t coap_ack_timeout(void);
+
+/* nrc_coap_server.c */
+int coap_server_init(coap_ctx_t *ctx);
+/* a request, or an ACK or RST for a notification in ctx->rx */
+void coap_server_handle(coap_ctx_t *ctx);
+/* retransmit the confirmable notification, return the ms to the next one */
+uint32_t coap_server_timer(coap_ctx_t *ctx);
+void coap_server_free(coap_ctx_t *ctx);
+
+/* nrc_coap_dtls.c */
+#if defined(SUPPORT_MBEDTLS)
+int coap_dtls_connect(coap_ctx_t *ctx, const char *host, int port, const coap_psk_t *psk);
+int coap_dtls_send(coap_ctx_t *ctx, const uint8_t *buf, size_t len);
+int coap_dtls_recv(coap_ctx_t *ctx, uint8_t *buf, size_t size, uint32_t timeout_ms);
+void coap_dtls_close(coap_ctx_t *ctx);
+#endif
+
+#endif /* __NRC_COAP_INTERNAL_H__ */
@@ -0,0 +1,346 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Message format of RFC 7252, section 3:
+ *
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |Ver| T |  TKL  |      Code     |          Message ID           |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |   Token (if any, TKL bytes) ...
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |   Options (if any) ...
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |1 1 1 1 1 1 1 1|    Payload (if any) ...
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *
+ * An option is the delta to the number of the one before and its length,
+ * 4 bits each, extended by 1 byte (13) or 2 bytes (14).
+ */
+
+#include <string.h>
+
+#include "nrc_coap.h"
+
+#define COAP_VERSION		1
+#define COAP_PAYLOAD_MARKER	0xff
+
+void coap_msg_init(coap_msg_t *msg, uint8_t type, uint8_t code, uint16_t mid)
+{
+	memset(msg, 0, offsetof(coap_msg_t, opt_buf));
+	msg->type = type;
+	msg->code = code;
+	msg->mid = mid;
+}
+
+int coap_msg_set_token(coap_msg_t *msg, const uint8_t *token, uint8_t len)
+{
+	if (len > sizeof(msg->token))
+		return COAP_RET_ERROR_INVALID;
+	memcpy(msg->token, token, len);
+	msg->token_len = len;
+	return COAP_RET_OK;
+}
+
+int coap_msg_add_option(coap_msg_t *msg, uint16_t num, const void *val, size_t len)
+{
+	int i;
+
+	if (msg->num_options >= COAP_MAX_OPTIONS ||
+		len > sizeof(msg->opt_buf) - msg->opt_buf_len)
+		return COAP_RET_ERROR_BUF_SIZE;
+
+	/* after the options of the same number */
+	for (i = msg->num_options; i > 0 && msg->options[i - 1].num > num; i--)
+		msg->options[i] = msg->options[i - 1];
+
+	memcpy(msg->opt_buf + msg->opt_buf_len, val, len);
+	msg->options[i].num = num;
+	msg->options[i].len = len;
+	msg->options[i].val = msg->opt_buf + msg->opt_buf_len;
+	msg->opt_buf_len += len;
+	msg->num_options++;
+	return COAP_RET_OK;
+}
+
+int coap_msg_add_option_uint(coap_msg_t *msg, uint16_t num, uint32_t val)
+{
+	uint8_t buf[4];
+	int len = 0;
+	int shift;
+
+	for (shift = 24; shift >= 0; shift -= 8) {
+		if (len > 0 || (val >> shift) != 0)
+			buf[len++] = val >> shift;
+	}
+	return coap_msg_add_option(msg, num, buf, len);
+}
+
+static int coap_msg_add_segments(coap_msg_t *msg, uint16_t num, const char *str, char sep)
+{
+	const char *end;
+	int ret;
+
+	while (*str != '\0') {
+		end = strchr(str, sep);
+		if (end == NULL)
+			end = str + strlen(str);
+		if (end > str) {
+			ret = coap_msg_add_option(msg, num, str, end - str);
+			if (ret != COAP_RET_OK)
+				return ret;
+		}
+		str = (*end == '\0') ? end : end + 1;
+	}
+	return COAP_RET_OK;
+}
+
+int coap_msg_add_uri_path(coap_msg_t *msg, const char *path)
+{
+	return coap_msg_add_segments(msg, COAP_OPTION_URI_PATH, path, '/');
+}
+
+int coap_msg_add_uri_query(coap_msg_t *msg, const char *query)
+{
+	return coap_msg_add_segments(msg, COAP_OPTION_URI_QUERY, query, '&');
+}
+
+int coap_msg_add_block(coap_msg_t *msg, uint16_t num, const coap_block_t *block)
+{
+	if (block->szx > 6 || block->num >= (1U << 20))
+		return COAP_RET_ERROR_INVALID;
+	return coap_msg_add_option_uint(msg, num,
+			(block->num << 4) | (block->more ? 0x08 : 0) | block->szx);
+}
+
+void coap_msg_remove_option(coap_msg_t *msg, uint16_t num)
+{
+	int i, n = 0;
+
+	/* the values stay in opt_buf until the message is initialized again */
+	for (i = 0; i < msg->num_options; i++) {
+		if (msg->options[i].num != num)
+			msg->options[n++] = msg->options[i];
+	}
+	msg->num_options = n;
+}
+
+const coap_option_t *coap_msg_find_option(const coap_msg_t *msg, uint16_t num,
+										  const coap_option_t *after)
+{
+	const coap_option_t *opt = after ? after + 1 : msg->options;
+	const coap_option_t *end = msg->options + msg->num_options;
+
+	for (; opt < end; opt++) {
+		if (opt->num == num)
+			return opt;
+		if (opt->num > num)
+			break;
+	}
+	return NULL;
+}
+
+uint32_t coap_option_uint(const coap_option_t *opt)
+{
+	uint32_t val = 0;
+	int i;
+
+	for (i = 0; i < opt->len && i < 4; i++)
+		val = (val << 8) | opt->val[i];
+	return val;
+}
+
+int coap_msg_get_block(const coap_msg_t *msg, uint16_t num, coap_block_t *block)
+{
+	const coap_option_t *opt = coap_msg_find_option(msg, num, NULL);
+	uint32_t val;
+
+	if (opt == NULL)
+		return 0;
+	if (opt->len > 3)
+		return COAP_RET_ERROR_FORMAT;
+	val = coap_option_uint(opt);
+	if ((val & 0x07) == 7)
+		return COAP_RET_ERROR_FORMAT;
+	block->num = val >> 4;
+	block->more = (val >> 3) & 1;
+	block->szx = val & 0x07;
+	return 1;
+}
+
+int coap_msg_get_uri_path(const coap_msg_t *msg, char *buf, size_t size)
+{
+	const coap_option_t *opt = NULL;
+	size_t len = 0;
+
+	if (size == 0)
+		return COAP_RET_ERROR_BUF_SIZE;
+	while ((opt = coap_msg_find_option(msg, COAP_OPTION_URI_PATH, opt)) != NULL) {
+		if (len + (len > 0) + opt->len >= size)
+			return COAP_RET_ERROR_BUF_SIZE;
+		if (len > 0)
+			buf[len++] = '/';
+		memcpy(buf + len, opt->val, opt->len);
+		len += opt->len;
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+int coap_msg_get_content_format(const coap_msg_t *msg)
+{
+	const coap_option_t *opt = coap_msg_find_option(msg, COAP_OPTION_CONTENT_FORMAT, NULL);
+
+	return opt ? (int)coap_option_uint(opt) : COAP_FORMAT_NONE;
+}
+
+/* the 4-bit field of a delta or a length and its extension */
+static int coap_opt_field(uint32_t val, uint8_t *nibble, uint8_t *ext)
+{
+	if (val < 13) {
+		*nibble = val;
+		return 0;
+	}
+	if (val < 269) {
+		*nibble = 13;
+		ext[0] = val - 13;
+		return 1;
+	}
+	*nibble = 14;
+	ext[0] = (val - 269) >> 8;
+	ext[1] = (val - 269) & 0xff;
+	return 2;
+}
+
+int coap_msg_encode(const coap_msg_t *msg, uint8_t *buf, size_t size)
+{
+	uint16_t last = 0;
+	size_t pos;
+	int i;
+
+	if (size < 4U + msg->token_len)
+		return COAP_RET_ERROR_BUF_SIZE;
+	buf[0] = (COAP_VERSION << 6) | ((msg->type & 3) << 4) | msg->token_len;
+	buf[1] = msg->code;
+	buf[2] = msg->mid >> 8;
+	buf[3] = msg->mid & 0xff;
+	memcpy(buf + 4, msg->token, msg->token_len);
+	pos = 4 + msg->token_len;
+
+	for (i = 0; i < msg->num_options; i++) {
+		const coap_option_t *opt = &msg->options[i];
+		uint8_t delta, len, ext[4];
+		int n;
+
+		n = coap_opt_field(opt->num - last, &delta, ext);
+		n += coap_opt_field(opt->len, &len, ext + n);
+		if (pos + 1 + n + opt->len > size)
+			return COAP_RET_ERROR_BUF_SIZE;
+		buf[pos++] = (delta << 4) | len;
+		memcpy(buf + pos, ext, n);
+		pos += n;
+		memcpy(buf + pos, opt->val, opt->len);
+		pos += opt->len;
+		last = opt->num;
+	}
+
+	if (msg->payload_len > 0) {
+		if (pos + 1 + msg->payload_len > size)
+			return COAP_RET_ERROR_BUF_SIZE;
+		buf[pos++] = COAP_PAYLOAD_MARKER;
+		memcpy(buf + pos, msg->payload, msg->payload_len);
+		pos += msg->payload_len;
+	}
+	return pos;
+}
+
+/* the value of a 4-bit field and its extension at *pos */
+static int coap_opt_value(uint8_t nibble, const uint8_t *buf, size_t len, size_t *pos,
+						  uint32_t *val)
+{
+	if (nibble < 13) {
+		*val = nibble;
+	} else if (nibble == 13) {
+		if (*pos + 1 > len)
+			return -1;
+		*val = buf[*pos] + 13;
+		*pos += 1;
+	} else if (nibble == 14) {
+		if (*pos + 2 > len)
+			return -1;
+		*val = ((buf[*pos] << 8) | buf[*pos + 1]) + 269;
+		*pos += 2;
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+int coap_msg_decode(coap_msg_t *msg, const uint8_t *buf, size_t len)
+{
+	uint32_t num = 0;
+	size_t pos;
+
+	if (len < 4 || (buf[0] >> 6) != COAP_VERSION || (buf[0] & 0x0f) > 8)
+		return COAP_RET_ERROR_FORMAT;
+	coap_msg_init(msg, (buf[0] >> 4) & 3, buf[1], (buf[2] << 8) | buf[3]);
+	msg->token_len = buf[0] & 0x0f;
+	pos = 4 + msg->token_len;
+	if (pos > len)
+		return COAP_RET_ERROR_FORMAT;
+	memcpy(msg->token, buf + 4, msg->token_len);
+
+	/* an empty message is the header only */
+	if (msg->code == COAP_CODE_EMPTY && len != 4)
+		return COAP_RET_ERROR_FORMAT;
+
+	while (pos < len) {
+		uint32_t delta, optlen;
+		uint8_t b = buf[pos++];
+
+		if (b == COAP_PAYLOAD_MARKER) {
+			if (pos == len)
+				return COAP_RET_ERROR_FORMAT;
+			msg->payload = buf + pos;
+			msg->payload_len = len - pos;
+			break;
+		}
+		if (coap_opt_value(b >> 4, buf, len, &pos, &delta) != 0 ||
+			coap_opt_value(b & 0x0f, buf, len, &pos, &optlen) != 0 ||
+			pos + optlen > len || num + delta > 0xffff)
+			return COAP_RET_ERROR_FORMAT;
+		if (msg->num_options >= COAP_MAX_OPTIONS)
+			return COAP_RET_ERROR_BUF_SIZE;
+		num += delta;
+		msg->options[msg->num_options].num = num;
+		msg->options[msg->num_options].len = optlen;
+		msg->options[msg->num_options].val = buf + pos;
+		msg->num_options++;
+		pos += optlen;
+	}
+	return COAP_RET_OK;
+}
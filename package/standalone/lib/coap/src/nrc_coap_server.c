@@ -0,0 +1,479 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Server endpoint: resources, their observers (RFC 7641) and block-wise
+ * responses (RFC 7959)
+ */
+
+#include <string.h>
+
+#include "nrc_coap_internal.h"
+
+#define COAP_MAX_PATH	64
+
+struct coap_resource {
+	const char *path;
+	coap_handler_t handler;
+	void *arg;
+	uint8_t observable;
+	uint8_t changed;				/* coap_notify() from a handler */
+	uint32_t seq;					/* Observe number of the last notification */
+};
+
+struct coap_observer {
+	int8_t resource;				/* -1 when free */
+	uint8_t token_len;
+	uint8_t token[8];
+	uint16_t mid;					/* of the last notification */
+	uint32_t count;
+	coap_peer_t peer;
+};
+
+struct coap_server {
+	struct coap_resource res[COAP_MAX_RESOURCES];
+	int num_res;
+	struct coap_observer observers[COAP_MAX_OBSERVERS];
+	uint8_t in_handler;
+
+	/* the last response to a confirmable request, sent again for a
+	   duplicate (RFC 7252, 4.5) */
+	coap_peer_t last_peer;
+	uint16_t last_mid;
+	int last_len;
+	uint8_t last_buf[COAP_MAX_PDU_SIZE];
+
+	/* the confirmable notification waiting for its ACK */
+	int pending;					/* observer, -1 for none */
+	int pending_len;
+	int pending_retries;
+	uint32_t pending_timeout;
+	uint32_t pending_deadline;
+	uint8_t pending_buf[COAP_MAX_PDU_SIZE];
+
+	/* the GET a notification answers */
+	coap_msg_t notify_req;
+};
+
+int coap_server_init(coap_ctx_t *ctx)
+{
+	struct coap_server *s;
+	int i;
+
+	s = (struct coap_server *)nrc_mem_malloc(sizeof(struct coap_server));
+	if (s == NULL)
+		return COAP_RET_ERROR_ALLOC_FAIL;
+	memset(s, 0, sizeof(struct coap_server));
+	for (i = 0; i < COAP_MAX_OBSERVERS; i++)
+		s->observers[i].resource = -1;
+	s->pending = -1;
+	ctx->server = s;
+	return COAP_RET_OK;
+}
+
+void coap_server_free(coap_ctx_t *ctx)
+{
+	nrc_mem_free(ctx->server);
+	ctx->server = NULL;
+}
+
+int coap_server_add_resource(coap_ctx_t *ctx, const char *path, coap_handler_t handler,
+							 void *arg, int observable)
+{
+	struct coap_server *s;
+	struct coap_resource *r;
+
+	if (ctx == NULL || ctx->server == NULL || path == NULL || handler == NULL)
+		return COAP_RET_ERROR_INVALID;
+	s = ctx->server;
+	if (s->num_res == COAP_MAX_RESOURCES)
+		return COAP_RET_ERROR_FULL;
+
+	while (*path == '/')
+		path++;
+	r = &s->res[s->num_res];
+	r->path = path;
+	r->handler = handler;
+	r->arg = arg;
+	r->observable = observable;
+	return s->num_res++;
+}
+
+static int coap_find_resource(struct coap_server *s, const coap_msg_t *req)
+{
+	char path[COAP_MAX_PATH];
+	int i;
+
+	if (coap_msg_get_uri_path(req, path, sizeof(path)) < 0)
+		return -1;
+	for (i = 0; i < s->num_res; i++) {
+		if (strcmp(s->res[i].path, path) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/* The critical options (odd numbers) a request may have */
+static int coap_options_supported(const coap_msg_t *req)
+{
+	int i;
+
+	for (i = 0; i < req->num_options; i++) {
+		switch (req->options[i].num) {
+		case COAP_OPTION_URI_HOST:
+		case COAP_OPTION_URI_PORT:
+		case COAP_OPTION_URI_PATH:
+		case COAP_OPTION_URI_QUERY:
+		case COAP_OPTION_ACCEPT:
+		case COAP_OPTION_BLOCK2:
+		case COAP_OPTION_BLOCK1:
+			break;
+		default:
+			if (req->options[i].num & 1)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+static void coap_observer_free(struct coap_server *s, struct coap_observer *ob)
+{
+	if (s->pending == ob - s->observers)
+		s->pending = -1;
+	ob->resource = -1;
+}
+
+static struct coap_observer *coap_observer_find(struct coap_server *s, const coap_peer_t *peer,
+												const coap_msg_t *req)
+{
+	int i;
+
+	for (i = 0; i < COAP_MAX_OBSERVERS; i++) {
+		struct coap_observer *ob = &s->observers[i];
+
+		if (ob->resource >= 0 && ob->token_len == req->token_len &&
+			memcmp(ob->token, req->token, req->token_len) == 0 &&
+			coap_peer_equal(&ob->peer, peer))
+			return ob;
+	}
+	return NULL;
+}
+
+/* Observe 0 registers the client, 1 deregisters it (RFC 7641, 2) */
+static struct coap_observer *coap_observe_request(struct coap_server *s, const coap_peer_t *peer,
+												  const coap_msg_t *req, int res)
+{
+	const coap_option_t *opt = coap_msg_find_option(req, COAP_OPTION_OBSERVE, NULL);
+	struct coap_observer *ob;
+	int i;
+
+	if (opt == NULL || req->code != COAP_METHOD_GET)
+		return NULL;
+	ob = coap_observer_find(s, peer, req);
+	if (coap_option_uint(opt) != 0) {
+		if (ob != NULL)
+			coap_observer_free(s, ob);
+		return NULL;
+	}
+	if (ob != NULL || res < 0 || !s->res[res].observable)
+		return ob;
+
+	for (i = 0; i < COAP_MAX_OBSERVERS; i++) {
+		ob = &s->observers[i];
+		if (ob->resource < 0) {
+			ob->resource = res;
+			ob->token_len = req->token_len;
+			memcpy(ob->token, req->token, req->token_len);
+			ob->peer = *peer;
+			ob->count = 0;
+			return ob;
+		}
+	}
+	/* answered without the Observe option */
+	COAP_LOGD("no free observer");
+	return NULL;
+}
+
+/*
+ * The response to req in ctx->tx and its datagram in ctx->tx_buf: the code
+ * and payload of the handler, with the block of the payload asked for
+ * (RFC 7959, 2.4), the acknowledgement of a Block1 block, and the Observe
+ * number for an observer.
+ */
+static int coap_respond(coap_ctx_t *ctx, const coap_msg_t *req, int res,
+						const struct coap_observer *ob, uint8_t type, uint16_t mid)
+{
+	struct coap_server *s = ctx->server;
+	coap_msg_t *resp = &ctx->tx;
+	coap_block_t block;
+	int ret;
+
+	coap_msg_init(resp, type, COAP_CODE_CONTENT, mid);
+	coap_msg_set_token(resp, req->token, req->token_len);
+
+	if (!coap_options_supported(req)) {
+		resp->code = COAP_CODE_BAD_OPTION;
+	} else if (res < 0) {
+		resp->code = COAP_CODE_NOT_FOUND;
+	} else {
+		s->in_handler = 1;
+		ret = s->res[res].handler(s->res[res].arg, req, resp);
+		s->in_handler = 0;
+		if (ret != 0) {
+			resp->code = ret;
+			resp->payload = NULL;
+			resp->payload_len = 0;
+		}
+	}
+
+	if (COAP_CODE_CLASS(resp->code) == 2 &&
+		coap_msg_get_block(req, COAP_OPTION_BLOCK1, &block) == 1) {
+		coap_msg_add_block(resp, COAP_OPTION_BLOCK1, &block);
+		if (block.more)
+			resp->code = COAP_CODE_CONTINUE;
+	}
+
+	if (COAP_CODE_CLASS(resp->code) == 2 && resp->payload_len > 0) {
+		int asked;
+
+		block.num = 0;
+		block.szx = ctx->szx;
+		asked = coap_msg_get_block(req, COAP_OPTION_BLOCK2, &block);
+		if (block.szx > ctx->szx) {
+			/* a larger block asked for: the same offset in our blocks */
+			block.num <<= block.szx - ctx->szx;
+			block.szx = ctx->szx;
+		}
+		if (asked == 1 || resp->payload_len > COAP_BLOCK_SIZE(block.szx)) {
+			size_t size = COAP_BLOCK_SIZE(block.szx);
+			size_t offset = block.num * size;
+
+			if (offset >= resp->payload_len) {
+				resp->code = COAP_CODE_BAD_OPTION;
+				resp->payload = NULL;
+				resp->payload_len = 0;
+			} else {
+				block.more = resp->payload_len - offset > size;
+				coap_msg_add_block(resp, COAP_OPTION_BLOCK2, &block);
+				if (block.num == 0)
+					coap_msg_add_option_uint(resp, COAP_OPTION_SIZE2, resp->payload_len);
+				resp->payload += offset;
+				resp->payload_len = block.more ? size : resp->payload_len - offset;
+			}
+		}
+	}
+
+	if (ob != NULL && COAP_CODE_CLASS(resp->code) == 2)
+		coap_msg_add_option_uint(resp, COAP_OPTION_OBSERVE, s->res[res].seq & 0xffffff);
+
+	return coap_msg_encode(resp, ctx->tx_buf, sizeof(ctx->tx_buf));
+}
+
+/* No-Response (RFC 7967): the classes of responses the client does not want */
+static int coap_response_suppressed(const coap_msg_t *req, uint8_t code)
+{
+	const coap_option_t *opt = coap_msg_find_option(req, COAP_OPTION_NO_RESPONSE, NULL);
+
+	return opt != NULL && (coap_option_uint(opt) & (1 << (COAP_CODE_CLASS(code) - 1)));
+}
+
+static void coap_server_send(coap_ctx_t *ctx, const coap_peer_t *peer, const coap_msg_t *req,
+							 const uint8_t *buf, int len)
+{
+	struct coap_server *s = ctx->server;
+
+	if (len < 0)
+		return;
+	coap_sock_send(ctx, peer, buf, len);
+	if (req->type == COAP_TYPE_CON) {
+		s->last_peer = *peer;
+		s->last_mid = req->mid;
+		s->last_len = len;
+		memcpy(s->last_buf, buf, len);
+	}
+}
+
+static int coap_notify_resource(coap_ctx_t *ctx, int res)
+{
+	struct coap_server *s = ctx->server;
+	struct coap_resource *r = &s->res[res];
+	coap_msg_t *req = &s->notify_req;
+	int i, n = 0;
+
+	r->seq++;
+	for (i = 0; i < COAP_MAX_OBSERVERS; i++) {
+		struct coap_observer *ob = &s->observers[i];
+		int con, len;
+
+		if (ob->resource != res)
+			continue;
+		coap_msg_init(req, COAP_TYPE_NON, COAP_METHOD_GET, 0);
+		coap_msg_set_token(req, ob->token, ob->token_len);
+		coap_msg_add_uri_path(req, r->path);
+
+		/* one confirmable notification at a time */
+		con = (++ob->count % COAP_NOTIFY_CON_INTERVAL) == 0 && s->pending < 0;
+		ob->mid = ctx->mid++;
+		len = coap_respond(ctx, req, res, ob, con ? COAP_TYPE_CON : COAP_TYPE_NON, ob->mid);
+		if (len < 0)
+			continue;
+		coap_sock_send(ctx, &ob->peer, ctx->tx_buf, len);
+		n++;
+
+		if (COAP_CODE_CLASS(ctx->tx.code) != 2) {
+			/* the last notification */
+			coap_observer_free(s, ob);
+		} else if (con) {
+			s->pending = i;
+			s->pending_len = len;
+			memcpy(s->pending_buf, ctx->tx_buf, len);
+			s->pending_retries = 0;
+			s->pending_timeout = coap_ack_timeout();
+			s->pending_deadline = sys_now() + s->pending_timeout;
+		}
+	}
+	return n;
+}
+
+int coap_notify(coap_ctx_t *ctx, int resource)
+{
+	struct coap_server *s;
+	int i, n = 0;
+
+	if (ctx == NULL || ctx->server == NULL || resource < 0 || resource >= ctx->server->num_res)
+		return COAP_RET_ERROR_INVALID;
+	s = ctx->server;
+	if (!s->in_handler)
+		return coap_notify_resource(ctx, resource);
+
+	/* after the response to the request being handled */
+	s->res[resource].changed = 1;
+	for (i = 0; i < COAP_MAX_OBSERVERS; i++) {
+		if (s->observers[i].resource == resource)
+			n++;
+	}
+	return n;
+}
+
+static void coap_server_request(coap_ctx_t *ctx)
+{
+	struct coap_server *s = ctx->server;
+	const coap_msg_t *req = &ctx->rx;
+	const coap_peer_t *peer = &ctx->rx_peer;
+	struct coap_observer *ob;
+	int res, len, i;
+
+	if (req->type == COAP_TYPE_CON && s->last_len > 0 && s->last_mid == req->mid &&
+		coap_peer_equal(&s->last_peer, peer)) {
+		COAP_LOGD("duplicate of mid %u", req->mid);
+		coap_sock_send(ctx, peer, s->last_buf, s->last_len);
+		return;
+	}
+
+	res = coap_find_resource(s, req);
+	ob = coap_observe_request(s, peer, req, res);
+	/* piggybacked on the ACK of a confirmable request */
+	if (req->type == COAP_TYPE_CON)
+		len = coap_respond(ctx, req, res, ob, COAP_TYPE_ACK, req->mid);
+	else
+		len = coap_respond(ctx, req, res, ob, COAP_TYPE_NON, ctx->mid++);
+	if (ob != NULL && COAP_CODE_CLASS(ctx->tx.code) != 2)
+		coap_observer_free(s, ob);
+
+	if (!coap_response_suppressed(req, ctx->tx.code)) {
+		coap_server_send(ctx, peer, req, ctx->tx_buf, len);
+	} else if (req->type == COAP_TYPE_CON) {
+		uint8_t ack[4] = { (1 << 6) | (COAP_TYPE_ACK << 4), COAP_CODE_EMPTY,
+						   req->mid >> 8, req->mid & 0xff };
+
+		coap_server_send(ctx, peer, req, ack, sizeof(ack));
+	}
+
+	for (i = 0; i < s->num_res; i++) {
+		if (s->res[i].changed) {
+			s->res[i].changed = 0;
+			coap_notify_resource(ctx, i);
+		}
+	}
+}
+
+void coap_server_handle(coap_ctx_t *ctx)
+{
+	struct coap_server *s = ctx->server;
+	const coap_msg_t *msg = &ctx->rx;
+	int i;
+
+	if (msg->code != COAP_CODE_EMPTY && COAP_CODE_CLASS(msg->code) == 0) {
+		if (msg->type == COAP_TYPE_CON || msg->type == COAP_TYPE_NON)
+			coap_server_request(ctx);
+		return;
+	}
+
+	switch (msg->type) {
+	case COAP_TYPE_ACK:
+		if (s->pending >= 0 && s->observers[s->pending].mid == msg->mid &&
+			coap_peer_equal(&s->observers[s->pending].peer, &ctx->rx_peer))
+			s->pending = -1;
+		break;
+	case COAP_TYPE_RST:
+		/* the client forgot the observation (RFC 7641, 3.6) */
+		for (i = 0; i < COAP_MAX_OBSERVERS; i++) {
+			struct coap_observer *ob = &s->observers[i];
+
+			if (ob->resource >= 0 && ob->mid == msg->mid && coap_peer_equal(&ob->peer, &ctx->rx_peer))
+				coap_observer_free(s, ob);
+		}
+		break;
+	case COAP_TYPE_CON:
+		/* a ping, or a response: a server sends no request */
+		coap_send_empty(ctx, &ctx->rx_peer, COAP_TYPE_RST, msg->mid);
+		break;
+	default:
+		break;
+	}
+}
+
+uint32_t coap_server_timer(coap_ctx_t *ctx)
+{
+	struct coap_server *s = ctx->server;
+	uint32_t now = sys_now();
+
+	if (s->pending < 0)
+		return UINT32_MAX;
+	if ((int32_t)(s->pending_deadline - now) > 0)
+		return s->pending_deadline - now;
+
+	if (s->pending_retries == COAP_MAX_RETRANSMIT) {
+		COAP_LOGD("observer %d gone", s->pending);
+		coap_observer_free(s, &s->observers[s->pending]);
+		return UINT32_MAX;
+	}
+	s->pending_retries++;
+	s->pending_timeout *= 2;
+	s->pending_deadline = now + s->pending_timeout;
+	ctx->stats.retransmissions++;
+	coap_sock_send(ctx, &s->observers[s->pending].peer, s->pending_buf, s->pending_len);
+	return s->pending_timeout;
+}
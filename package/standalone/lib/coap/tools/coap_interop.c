@@ -0,0 +1,1172 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Interop test of lib/coap, built for the host (see interop.sh), against
+ * coap_server.py on 127.0.0.1:5683, and the bytes on air of a report of
+ * sample_coap next to the ones of sample_mqtt.
+ *
+ * The Python server has no DTLS: a thread here is a DTLS-PSK server on 5684
+ * relaying the records to it, as a CoAP proxy would. Another one is an MQTT
+ * broker with the certificates of sample_mqtt, on 8883 (TLS) and 1883.
+ * The bytes on air are the IPv4 packets captured on lo, with TCP headers
+ * counted without their options as the ones of lwIP; the capture needs
+ * CAP_NET_RAW, without it only the UDP and TCP payloads are reported.
+ *
+ *   ./coap_interop [reports]           tests, then the bytes of each report
+ *   ./coap_interop serve [port]        lib/coap as a server, for
+ *                                      coap_server.py --probe
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_cookie.h"
+#include "mbedtls/timing.h"
+#include "mbedtls/x509_crt.h"
+#include "tls_session_cache.h"
+
+#include "MQTTPacket.h"
+
+#include "nrc_coap.h"
+#include "lwip/sys.h"
+
+#define HOST			"127.0.0.1"
+#define COAP_PORT		5683
+#define COAPS_PORT		5684
+#define MQTTS_PORT		8883
+#define MQTT_PORT		1883
+
+#define REPORT_PATH		"halow/11ah/coap/sample/mytopic"
+#define MQTT_TOPIC		"halow/11ah/mqtt/sample/mytopic"
+#define MQTT_CLIENT_ID	"nrc_11ah_mqtt_test"
+#define CERTS			"../../../sdk/apps/sample_mqtt/certs/"
+
+#define PSK_IDENTITY	"nrc_11ah_coap_test"
+static const uint8_t psk_key[16] = {
+	0x4e, 0x52, 0x43, 0x2d, 0x31, 0x31, 0x61, 0x68,
+	0x2d, 0x63, 0x6f, 0x61, 0x70, 0x2d, 0x70, 0x73,
+};
+static const coap_psk_t psk = { psk_key, sizeof(psk_key), PSK_IDENTITY };
+
+static const int psk_ciphersuites[] = { MBEDTLS_TLS_PSK_WITH_AES_128_CCM_8, 0 };
+
+static int failures;
+
+/* zlib.crc32() of coap_server.py */
+static uint32_t crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	int k;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		for (k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+static void check(int ok, const char *name)
+{
+	printf("%s %s\n", ok ? "PASS" : "FAIL", name);
+	if (!ok)
+		failures++;
+}
+
+static void rng_init(mbedtls_entropy_context *entropy, mbedtls_ctr_drbg_context *ctr_drbg)
+{
+	mbedtls_entropy_init(entropy);
+	mbedtls_ctr_drbg_init(ctr_drbg);
+	if (mbedtls_ctr_drbg_seed(ctr_drbg, mbedtls_entropy_func, entropy, NULL, 0) != 0) {
+		fprintf(stderr, "mbedtls_ctr_drbg_seed failed\n");
+		exit(2);
+	}
+}
+
+/* capture --------------------------------------------------------------- */
+
+typedef struct {
+	uint64_t bytes;			/* IPv4 packets, TCP headers of 20 bytes */
+	uint32_t packets;
+	uint64_t payload;		/* UDP payloads, or TCP stream bytes */
+} air_t;
+
+static struct {
+	uint8_t proto;
+	uint16_t port;
+	air_t air;
+} cap_ports[] = {
+	{ IPPROTO_UDP, COAP_PORT, { 0 } },
+	{ IPPROTO_UDP, COAPS_PORT, { 0 } },
+	{ IPPROTO_TCP, MQTTS_PORT, { 0 } },
+	{ IPPROTO_TCP, MQTT_PORT, { 0 } },
+};
+
+static pthread_mutex_t cap_lock = PTHREAD_MUTEX_INITIALIZER;
+static int cap_on;
+
+/* UDP payload bytes of the CoAP endpoints */
+static uint64_t coap_payload(const coap_ctx_t *ctx)
+{
+	coap_stats_t st;
+
+	coap_get_stats(ctx, &st);
+	return (uint64_t)st.tx_bytes + st.rx_bytes;
+}
+
+static void cap_count(const uint8_t *ip, size_t len)
+{
+	size_t ihl, tot, l4;
+	uint16_t sport, dport;
+	unsigned int i;
+
+	if (len < 20 || ip[0] >> 4 != 4)
+		return;
+	ihl = (ip[0] & 0xf) * 4;
+	tot = (ip[2] << 8) | ip[3];
+	if (len < ihl + 14 || tot > len)
+		return;
+	sport = (ip[ihl] << 8) | ip[ihl + 1];
+	dport = (ip[ihl + 2] << 8) | ip[ihl + 3];
+	l4 = ip[9] == IPPROTO_TCP ? (ip[ihl + 12] >> 4) * 4 : 8;
+
+	pthread_mutex_lock(&cap_lock);
+	for (i = 0; i < sizeof(cap_ports) / sizeof(cap_ports[0]); i++) {
+		if (cap_ports[i].proto != ip[9] ||
+			(cap_ports[i].port != sport && cap_ports[i].port != dport))
+			continue;
+		cap_ports[i].air.packets++;
+		cap_ports[i].air.bytes += tot - (ip[9] == IPPROTO_TCP ? l4 - 20 : 0);
+		cap_ports[i].air.payload += tot - ihl - l4;
+		break;
+	}
+	pthread_mutex_unlock(&cap_lock);
+}
+
+static void *cap_thread(void *arg)
+{
+	int fd = (int)(intptr_t)arg;
+	static uint8_t buf[65536];
+	struct sockaddr_ll sll;
+	socklen_t sll_len;
+	ssize_t n;
+
+	for (;;) {
+		sll_len = sizeof(sll);
+		n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&sll, &sll_len);
+		if (n < 0)
+			break;
+		/* lo shows each packet sent and received */
+		if (sll.sll_pkttype == PACKET_OUTGOING)
+			continue;
+		cap_count(buf, n);
+	}
+	return NULL;
+}
+
+static void cap_start(void)
+{
+	struct sockaddr_ll sll;
+	pthread_t t;
+	int fd;
+
+	fd = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_IP));
+	if (fd < 0) {
+		printf("no capture on lo (%s): payload bytes only\n", strerror(errno));
+		return;
+	}
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_IP);
+	sll.sll_ifindex = if_nametoindex("lo");
+	if (bind(fd, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
+		printf("no capture on lo (%s): payload bytes only\n", strerror(errno));
+		close(fd);
+		return;
+	}
+	pthread_create(&t, NULL, cap_thread, (void *)(intptr_t)fd);
+	pthread_detach(t);
+	cap_on = 1;
+}
+
+/* the counters of a port, once the packets in flight are in */
+static air_t cap_mark(uint8_t proto, uint16_t port)
+{
+	air_t air = { 0 };
+	unsigned int i;
+
+	usleep(300 * 1000);
+	pthread_mutex_lock(&cap_lock);
+	for (i = 0; i < sizeof(cap_ports) / sizeof(cap_ports[0]); i++)
+		if (cap_ports[i].proto == proto && cap_ports[i].port == port)
+			air = cap_ports[i].air;
+	pthread_mutex_unlock(&cap_lock);
+	return air;
+}
+
+static air_t air_diff(air_t a, air_t b, int n)
+{
+	air_t d;
+
+	d.bytes = (b.bytes - a.bytes) / n;
+	d.packets = (b.packets - a.packets + n / 2) / n;
+	d.payload = (b.payload - a.payload) / n;
+	return d;
+}
+
+/* DTLS-PSK relay to coap_server.py --------------------------------------- */
+
+static void *dtls_relay_thread(void *arg)
+{
+	mbedtls_net_context listen_fd, client_fd;
+	mbedtls_entropy_context entropy;
+	mbedtls_ctr_drbg_context ctr_drbg;
+	mbedtls_ssl_config conf;
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_cookie_ctx cookie;
+	mbedtls_ssl_cache_context cache;
+	mbedtls_timing_delay_context timer;
+	struct sockaddr_in up_addr;
+	unsigned char ip[16];
+	size_t ip_len;
+	uint8_t buf[2048];
+	int up, ret;
+
+	mbedtls_net_init(&listen_fd);
+	mbedtls_net_init(&client_fd);
+	mbedtls_ssl_config_init(&conf);
+	mbedtls_ssl_init(&ssl);
+	mbedtls_ssl_cookie_init(&cookie);
+	mbedtls_ssl_cache_init(&cache);
+	rng_init(&entropy, &ctr_drbg);
+
+	up = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&up_addr, 0, sizeof(up_addr));
+	up_addr.sin_family = AF_INET;
+	up_addr.sin_port = htons(COAP_PORT);
+	up_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	connect(up, (struct sockaddr *)&up_addr, sizeof(up_addr));
+
+	mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_DATAGRAM,
+								MBEDTLS_SSL_PRESET_DEFAULT);
+	mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+	mbedtls_ssl_conf_ciphersuites(&conf, psk_ciphersuites);
+	mbedtls_ssl_conf_psk(&conf, psk.key, psk.key_len, (const unsigned char *)psk.identity,
+						 strlen(psk.identity));
+	mbedtls_ssl_cookie_setup(&cookie, mbedtls_ctr_drbg_random, &ctr_drbg);
+	mbedtls_ssl_conf_dtls_cookies(&conf, mbedtls_ssl_cookie_write, mbedtls_ssl_cookie_check,
+								  &cookie);
+	mbedtls_ssl_conf_session_cache(&conf, &cache, mbedtls_ssl_cache_get, mbedtls_ssl_cache_set);
+	mbedtls_ssl_conf_read_timeout(&conf, 2000);
+	mbedtls_ssl_setup(&ssl, &conf);
+	mbedtls_ssl_set_timer_cb(&ssl, &timer, mbedtls_timing_set_delay, mbedtls_timing_get_delay);
+
+	if ((ret = mbedtls_net_bind(&listen_fd, HOST, "5684", MBEDTLS_NET_PROTO_UDP)) != 0) {
+		fprintf(stderr, "DTLS relay: bind 5684 returned -0x%x\n", -ret);
+		return NULL;
+	}
+
+	for (;;) {
+		mbedtls_net_free(&client_fd);
+		mbedtls_ssl_session_reset(&ssl);
+		if (mbedtls_net_accept(&listen_fd, &client_fd, ip, sizeof(ip), &ip_len) != 0)
+			continue;
+		mbedtls_ssl_set_client_transport_id(&ssl, ip, ip_len);
+		mbedtls_ssl_set_bio(&ssl, &client_fd, mbedtls_net_send, mbedtls_net_recv,
+							mbedtls_net_recv_timeout);
+		while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+			/* the ClientHello with the cookie comes on the socket of the client */
+			if (ret == MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED) {
+				mbedtls_ssl_session_reset(&ssl);
+				mbedtls_ssl_set_client_transport_id(&ssl, ip, ip_len);
+			} else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+				break;
+			}
+		}
+		if (ret != 0)
+			continue;
+
+		/* until close_notify, or a ClientHello of another client */
+		for (;;) {
+			fd_set fds;
+			int maxfd = client_fd.fd > up ? client_fd.fd : up;
+
+			if (listen_fd.fd > maxfd)
+				maxfd = listen_fd.fd;
+			FD_ZERO(&fds);
+			FD_SET(client_fd.fd, &fds);
+			FD_SET(listen_fd.fd, &fds);
+			FD_SET(up, &fds);
+			if (mbedtls_ssl_check_pending(&ssl) == 0 &&
+				select(maxfd + 1, &fds, NULL, NULL, NULL) < 0)
+				break;
+			if (mbedtls_ssl_check_pending(&ssl) || FD_ISSET(client_fd.fd, &fds)) {
+				ret = mbedtls_ssl_read(&ssl, buf, sizeof(buf));
+				if (ret > 0)
+					send(up, buf, ret, 0);
+				else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_TIMEOUT)
+					break;
+			}
+			if (FD_ISSET(up, &fds)) {
+				ret = recv(up, buf, sizeof(buf), 0);
+				if (ret > 0)
+					mbedtls_ssl_write(&ssl, buf, ret);
+			}
+			if (FD_ISSET(listen_fd.fd, &fds))
+				break;
+		}
+		if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
+			mbedtls_ssl_close_notify(&ssl);
+	}
+	return NULL;
+}
+
+/* MQTT ------------------------------------------------------------------- */
+
+typedef struct {
+	int fd;
+	mbedtls_ssl_context *ssl;		/* NULL over TCP */
+	uint64_t bytes;					/* TCP stream bytes, both ways */
+} conn_t;
+
+static int conn_bio_send(void *arg, const unsigned char *buf, size_t len)
+{
+	conn_t *c = (conn_t *)arg;
+	ssize_t n = send(c->fd, buf, len, MSG_NOSIGNAL);
+
+	if (n < 0)
+		return MBEDTLS_ERR_NET_SEND_FAILED;
+	c->bytes += n;
+	return n;
+}
+
+static int conn_bio_recv(void *arg, unsigned char *buf, size_t len)
+{
+	conn_t *c = (conn_t *)arg;
+	ssize_t n = recv(c->fd, buf, len, 0);
+
+	if (n < 0)
+		return MBEDTLS_ERR_NET_RECV_FAILED;
+	c->bytes += n;
+	return n;
+}
+
+static int conn_write(conn_t *c, const uint8_t *buf, size_t len)
+{
+	size_t off = 0;
+	int ret;
+
+	while (off < len) {
+		if (c->ssl)
+			ret = mbedtls_ssl_write(c->ssl, buf + off, len - off);
+		else
+			ret = conn_bio_send(c, buf + off, len - off);
+		if (ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+			continue;
+		if (ret <= 0)
+			return -1;
+		off += ret;
+	}
+	return 0;
+}
+
+static int conn_read(conn_t *c, uint8_t *buf, size_t len)
+{
+	size_t off = 0;
+	int ret;
+
+	while (off < len) {
+		if (c->ssl)
+			ret = mbedtls_ssl_read(c->ssl, buf + off, len - off);
+		else
+			ret = conn_bio_recv(c, buf + off, len - off);
+		if (ret == MBEDTLS_ERR_SSL_WANT_READ)
+			continue;
+		if (ret <= 0)
+			return -1;
+		off += ret;
+	}
+	return 0;
+}
+
+/* a packet: fixed header byte, remaining length, body of up to size bytes */
+static int mqtt_read_packet(conn_t *c, uint8_t *hdr, uint8_t *body, size_t size, size_t *len)
+{
+	uint8_t b;
+	size_t rem = 0;
+	int shift = 0;
+
+	if (conn_read(c, hdr, 1) < 0)
+		return -1;
+	do {
+		if (conn_read(c, &b, 1) < 0 || shift > 21)
+			return -1;
+		rem |= (size_t)(b & 0x7f) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	if (rem > size || conn_read(c, body, rem) < 0)
+		return -1;
+	*len = rem;
+	return 0;
+}
+
+static int tcp_listen(int port)
+{
+	struct sockaddr_in addr;
+	int fd, on = 1, mss = 1460;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	/* the MSS of an lwIP station rather than the one of lo */
+	setsockopt(fd, IPPROTO_TCP, TCP_MAXSEG, &mss, sizeof(mss));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+		fprintf(stderr, "MQTT broker: port %d: %s\n", port, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* The broker of the sample: CONNACK, PUBACK, SUBACK, PINGRESP */
+static void *mqtt_broker_thread(void *arg)
+{
+	int tls = (int)(intptr_t)arg;
+	mbedtls_entropy_context entropy;
+	mbedtls_ctr_drbg_context ctr_drbg;
+	mbedtls_x509_crt ca, crt;
+	mbedtls_pk_context key;
+	mbedtls_ssl_config conf;
+	mbedtls_ssl_cache_context cache;
+	mbedtls_ssl_context ssl;
+	uint8_t hdr, body[512], out[8];
+	size_t len;
+	int lfd, ret;
+
+	lfd = tcp_listen(tls ? MQTTS_PORT : MQTT_PORT);
+	if (lfd < 0)
+		return NULL;
+
+	if (tls) {
+		rng_init(&entropy, &ctr_drbg);
+		mbedtls_x509_crt_init(&ca);
+		mbedtls_x509_crt_init(&crt);
+		mbedtls_pk_init(&key);
+		mbedtls_ssl_config_init(&conf);
+		mbedtls_ssl_cache_init(&cache);
+		mbedtls_ssl_init(&ssl);
+		if (mbedtls_x509_crt_parse_file(&ca, CERTS "ca.crt") != 0 ||
+			mbedtls_x509_crt_parse_file(&crt, CERTS "broker.crt") != 0 ||
+			mbedtls_pk_parse_keyfile(&key, CERTS "broker.key", NULL) != 0) {
+			fprintf(stderr, "MQTT broker: cannot load " CERTS "\n");
+			return NULL;
+		}
+		mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+									MBEDTLS_SSL_PRESET_DEFAULT);
+		mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+		mbedtls_ssl_conf_ca_chain(&conf, &ca, NULL);
+		mbedtls_ssl_conf_own_cert(&conf, &crt, &key);
+		/* require_certificate of mosquitto-tls.conf; the certificates in the tree expired */
+		mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+		mbedtls_ssl_conf_session_cache(&conf, &cache, mbedtls_ssl_cache_get,
+									   mbedtls_ssl_cache_set);
+		mbedtls_ssl_setup(&ssl, &conf);
+	}
+
+	for (;;) {
+		conn_t c = { -1, NULL, 0 };
+
+		c.fd = accept(lfd, NULL, NULL);
+		if (c.fd < 0)
+			continue;
+		if (tls) {
+			mbedtls_ssl_session_reset(&ssl);
+			mbedtls_ssl_set_bio(&ssl, &c, conn_bio_send, conn_bio_recv, NULL);
+			while ((ret = mbedtls_ssl_handshake(&ssl)) == MBEDTLS_ERR_SSL_WANT_READ ||
+				   ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+				;
+			if (ret != 0) {
+				close(c.fd);
+				continue;
+			}
+			c.ssl = &ssl;
+		}
+		while (mqtt_read_packet(&c, &hdr, body, sizeof(body), &len) == 0) {
+			switch (hdr >> 4) {
+			case CONNECT:
+				out[0] = CONNACK << 4; out[1] = 2; out[2] = 0; out[3] = 0;
+				conn_write(&c, out, 4);
+				continue;
+			case PUBLISH:
+				if (((hdr >> 1) & 3) == 1 && len >= 4) {
+					size_t id = 2 + ((body[0] << 8) | body[1]);
+
+					out[0] = PUBACK << 4; out[1] = 2;
+					out[2] = body[id]; out[3] = body[id + 1];
+					conn_write(&c, out, 4);
+				}
+				continue;
+			case SUBSCRIBE:
+				out[0] = SUBACK << 4; out[1] = 3; out[2] = body[0]; out[3] = body[1]; out[4] = 1;
+				conn_write(&c, out, 5);
+				continue;
+			case PINGREQ:
+				out[0] = PINGRESP << 4; out[1] = 0;
+				conn_write(&c, out, 2);
+				continue;
+			default:
+				break;
+			}
+			break;
+		}
+		/* after DISCONNECT, the close_notify of the client */
+		if (c.ssl) {
+			conn_read(&c, body, 1);
+			mbedtls_ssl_close_notify(&ssl);
+		}
+		close(c.fd);
+	}
+	return NULL;
+}
+
+typedef struct {
+	conn_t c;
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_config conf;
+	int tls;
+	int resumed;
+} mqtt_client_t;
+
+static mbedtls_entropy_context cli_entropy;
+static mbedtls_ctr_drbg_context cli_ctr_drbg;
+static mbedtls_x509_crt cli_ca, cli_crt;
+static mbedtls_pk_context cli_key;
+
+static void mqtt_client_certs(void)
+{
+	rng_init(&cli_entropy, &cli_ctr_drbg);
+	mbedtls_x509_crt_init(&cli_ca);
+	mbedtls_x509_crt_init(&cli_crt);
+	mbedtls_pk_init(&cli_key);
+	if (mbedtls_x509_crt_parse_file(&cli_ca, CERTS "ca.crt") != 0 ||
+		mbedtls_x509_crt_parse_file(&cli_crt, CERTS "sample_mqtt.crt") != 0 ||
+		mbedtls_pk_parse_keyfile(&cli_key, CERTS "sample_mqtt.key", "") != 0) {
+		fprintf(stderr, "cannot load " CERTS "\n");
+		exit(2);
+	}
+}
+
+/* NetworkConnect(TLS) and MQTTConnect of sample_mqtt */
+static int mqtt_open(mqtt_client_t *m, int tls)
+{
+	MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+	struct sockaddr_in addr;
+	uint8_t buf[128], hdr;
+	size_t len;
+	int port = tls ? MQTTS_PORT : MQTT_PORT;
+	int on = 1, mss = 1460, ret;
+
+	memset(m, 0, sizeof(*m));
+	m->tls = tls;
+	m->c.fd = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(m->c.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	setsockopt(m->c.fd, IPPROTO_TCP, TCP_MAXSEG, &mss, sizeof(mss));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(m->c.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		goto fail;
+
+	if (tls) {
+		mbedtls_ssl_init(&m->ssl);
+		mbedtls_ssl_config_init(&m->conf);
+		mbedtls_ssl_config_defaults(&m->conf, MBEDTLS_SSL_IS_CLIENT,
+									MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+		mbedtls_ssl_conf_rng(&m->conf, mbedtls_ctr_drbg_random, &cli_ctr_drbg);
+		mbedtls_ssl_conf_ca_chain(&m->conf, &cli_ca, NULL);
+		mbedtls_ssl_conf_own_cert(&m->conf, &cli_crt, &cli_key);
+		mbedtls_ssl_conf_authmode(&m->conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+		mbedtls_ssl_setup(&m->ssl, &m->conf);
+		mbedtls_ssl_set_bio(&m->ssl, &m->c, conn_bio_send, conn_bio_recv, NULL);
+		tls_session_cache_set(&m->ssl, HOST, port);
+		while ((ret = mbedtls_ssl_handshake(&m->ssl)) == MBEDTLS_ERR_SSL_WANT_READ ||
+			   ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+			;
+		if (ret != 0) {
+			fprintf(stderr, "MQTT TLS handshake returned -0x%x\n", -ret);
+			tls_session_cache_remove(HOST, port);
+			goto fail;
+		}
+		m->resumed = tls_session_cache_update(&m->ssl, HOST, port);
+		m->c.ssl = &m->ssl;
+	}
+
+	data.MQTTVersion = 3;
+	data.clientID.cstring = MQTT_CLIENT_ID;
+	len = MQTTSerialize_connect(buf, sizeof(buf), &data);
+	if (conn_write(&m->c, buf, len) < 0 ||
+		mqtt_read_packet(&m->c, &hdr, buf, sizeof(buf), &len) < 0 ||
+		hdr >> 4 != CONNACK || buf[1] != 0)
+		goto fail;
+	return 0;
+
+fail:
+	close(m->c.fd);
+	if (tls) {
+		mbedtls_ssl_free(&m->ssl);
+		mbedtls_ssl_config_free(&m->conf);
+	}
+	return -1;
+}
+
+/* MQTTPublish of "message count n", QoS 1 */
+static int mqtt_report(mqtt_client_t *m, int n)
+{
+	MQTTString topic = MQTTString_initializer;
+	char payload[35];
+	uint8_t buf[128], hdr;
+	size_t len;
+
+	topic.cstring = MQTT_TOPIC;
+	sprintf(payload, "message count %d", n);
+	len = MQTTSerialize_publish(buf, sizeof(buf), 0, 1, 0, n & 0xffff ? n & 0xffff : 1, topic,
+								(unsigned char *)payload, strlen(payload));
+	if (conn_write(&m->c, buf, len) < 0 ||
+		mqtt_read_packet(&m->c, &hdr, buf, sizeof(buf), &len) < 0 || hdr >> 4 != PUBACK)
+		return -1;
+	return 0;
+}
+
+static void mqtt_close(mqtt_client_t *m)
+{
+	uint8_t buf[2];
+
+	MQTTSerialize_disconnect(buf, sizeof(buf));
+	conn_write(&m->c, buf, 2);
+	if (m->tls) {
+		mbedtls_ssl_close_notify(&m->ssl);
+		mbedtls_ssl_free(&m->ssl);
+		mbedtls_ssl_config_free(&m->conf);
+	}
+	close(m->c.fd);
+}
+
+/* CoAP tests ------------------------------------------------------------- */
+
+static int coap_report(coap_ctx_t *ctx, int n, int confirmable, int no_response)
+{
+	char payload[35];
+	coap_req_t req;
+	coap_resp_t resp;
+	int ret;
+
+	sprintf(payload, "message count %d", n);
+	memset(&req, 0, sizeof(req));
+	req.method = COAP_METHOD_POST;
+	req.confirmable = confirmable;
+	req.no_response = no_response ? COAP_NO_RESPONSE_2XX : 0;
+	req.path = REPORT_PATH;
+	req.content_format = COAP_FORMAT_TEXT;
+	req.payload = (const uint8_t *)payload;
+	req.payload_len = strlen(payload);
+	memset(&resp, 0, sizeof(resp));
+	ret = coap_request(ctx, &req, &resp);
+	if (ret != COAP_RET_OK)
+		return ret;
+	if (no_response)
+		return resp.code == 0 ? 0 : -1;
+	return resp.code == COAP_CODE_CHANGED ? 0 : -1;
+}
+
+static int coap_get(coap_ctx_t *ctx, const char *path, coap_resp_t *resp)
+{
+	coap_req_t req;
+
+	memset(&req, 0, sizeof(req));
+	req.method = COAP_METHOD_GET;
+	req.confirmable = 1;
+	req.path = path;
+	req.content_format = COAP_FORMAT_NONE;
+	return coap_request(ctx, &req, resp);
+}
+
+/* the fw resource of coap_server.py */
+static uint8_t fw_byte(uint32_t i)
+{
+	return (uint8_t)(i * 7 + (i >> 8));
+}
+
+typedef struct {
+	uint32_t crc;
+	uint32_t next;
+	int bad;
+	int calls;
+} fw_check_t;
+
+static int fw_data(void *arg, uint32_t offset, const uint8_t *data, size_t len, int last)
+{
+	fw_check_t *fw = (fw_check_t *)arg;
+	size_t i;
+
+	fw->calls++;
+	if (offset != fw->next)
+		fw->bad = 1;
+	for (i = 0; i < len; i++)
+		if (data[i] != fw_byte(offset + i))
+			fw->bad = 1;
+	fw->crc = crc32(fw->crc, data, len);
+	fw->next = offset + len;
+	return 0;
+}
+
+static int fw_get(coap_ctx_t *ctx, size_t block, uint32_t fw_size)
+{
+	fw_check_t fw = { 0 };
+	coap_resp_t resp;
+	int ret;
+
+	coap_set_block_size(ctx, block);
+	memset(&resp, 0, sizeof(resp));
+	resp.data_cb = fw_data;
+	resp.arg = &fw;
+	ret = coap_get(ctx, "fw", &resp);
+	coap_set_block_size(ctx, COAP_MAX_BLOCK_SIZE);
+	return ret == COAP_RET_OK && resp.code == COAP_CODE_CONTENT &&
+		   resp.content_format == COAP_FORMAT_OCTET && resp.len == fw_size &&
+		   fw.next == fw_size && !fw.bad && fw.calls == (int)((fw_size + block - 1) / block);
+}
+
+typedef struct {
+	int count;
+	int last;
+	char payload[64];
+} notify_t;
+
+static void notified(void *arg, uint8_t code, int32_t seq, const uint8_t *payload, size_t len)
+{
+	notify_t *n = (notify_t *)arg;
+
+	n->count++;
+	n->last = seq < 0;
+	if (len >= sizeof(n->payload))
+		len = sizeof(n->payload) - 1;
+	memcpy(n->payload, payload, len);
+	n->payload[len] = '\0';
+}
+
+static void coap_tests(coap_ctx_t *ctx, const char *name)
+{
+	char title[96], buf[256];
+	coap_resp_t resp;
+	coap_req_t req;
+	notify_t n;
+	int i, h;
+
+	snprintf(title, sizeof(title), "%s: CON report", name);
+	check(coap_report(ctx, 1, 1, 0) == 0, title);
+	snprintf(title, sizeof(title), "%s: NON report", name);
+	check(coap_report(ctx, 2, 0, 0) == 0, title);
+	snprintf(title, sizeof(title), "%s: NON report, No-Response", name);
+	check(coap_report(ctx, 3, 0, 1) == 0, title);
+
+	memset(&resp, 0, sizeof(resp));
+	resp.buf = (uint8_t *)buf;
+	resp.buf_size = sizeof(buf) - 1;
+	snprintf(title, sizeof(title), "%s: GET the report", name);
+	check(coap_get(ctx, REPORT_PATH, &resp) == COAP_RET_OK && resp.code == COAP_CODE_CONTENT &&
+		  resp.len == 15 && memcmp(buf, "message count 3", 15) == 0, title);
+
+	memset(&resp, 0, sizeof(resp));
+	resp.buf = (uint8_t *)buf;
+	resp.buf_size = sizeof(buf) - 1;
+	snprintf(title, sizeof(title), "%s: GET .well-known/core", name);
+	check(coap_get(ctx, ".well-known/core", &resp) == COAP_RET_OK &&
+		  resp.content_format == COAP_FORMAT_LINK && resp.len > 0 &&
+		  memcmp(buf, "</" REPORT_PATH ">;obs", 7 + strlen(REPORT_PATH)) == 0, title);
+
+	snprintf(title, sizeof(title), "%s: Block2 fw, 1024-byte blocks", name);
+	check(fw_get(ctx, 1024, 65536), title);
+	snprintf(title, sizeof(title), "%s: Block2 fw, 256-byte blocks", name);
+	check(fw_get(ctx, 256, 65536), title);
+
+	{
+		static uint8_t up[5000];
+		char expect[32];
+
+		for (i = 0; i < (int)sizeof(up); i++)
+			up[i] = (uint8_t)(i * 13);
+		snprintf(expect, sizeof(expect), "%d %08x", (int)sizeof(up),
+				 crc32(0, up, sizeof(up)));
+		memset(&req, 0, sizeof(req));
+		req.method = COAP_METHOD_POST;
+		req.confirmable = 1;
+		req.path = "upload";
+		req.content_format = COAP_FORMAT_OCTET;
+		req.payload = up;
+		req.payload_len = sizeof(up);
+		memset(&resp, 0, sizeof(resp));
+		resp.buf = (uint8_t *)buf;
+		resp.buf_size = sizeof(buf) - 1;
+		snprintf(title, sizeof(title), "%s: Block1 upload, server blocks of 512", name);
+		check(coap_request(ctx, &req, &resp) == COAP_RET_OK && resp.code == COAP_CODE_CHANGED &&
+			  resp.len == strlen(expect) && memcmp(buf, expect, resp.len) == 0, title);
+	}
+
+	memset(&n, 0, sizeof(n));
+	memset(&req, 0, sizeof(req));
+	req.method = COAP_METHOD_GET;
+	req.confirmable = 1;
+	req.path = REPORT_PATH;
+	req.content_format = COAP_FORMAT_NONE;
+	h = coap_observe(ctx, &req, notified, &n);
+	snprintf(title, sizeof(title), "%s: observe", name);
+	check(h >= 0 && n.count == 1, title);
+	if (h >= 0) {
+		/* notifications 4 and 8 of coap_server.py are confirmable */
+		for (i = 0; i < 8; i++)
+			coap_report(ctx, 10 + i, 1, 0);
+		for (i = 0; i < 5 && n.count < 9; i++)
+			coap_poll(ctx, 200);
+		snprintf(title, sizeof(title), "%s: observe, 8 notifications", name);
+		check(n.count == 9 && strcmp(n.payload, "message count 17") == 0, title);
+		snprintf(title, sizeof(title), "%s: observe, deregister", name);
+		check(coap_observe_cancel(ctx, h) == COAP_RET_OK, title);
+		coap_report(ctx, 18, 1, 0);
+		coap_poll(ctx, 300);
+		snprintf(title, sizeof(title), "%s: observe, no notification after it", name);
+		check(n.count == 9, title);
+	}
+
+	memset(&resp, 0, sizeof(resp));
+	resp.buf = (uint8_t *)buf;
+	resp.buf_size = sizeof(buf) - 1;
+	snprintf(title, sizeof(title), "%s: separate response", name);
+	check(coap_get(ctx, "slow", &resp) == COAP_RET_OK && resp.code == COAP_CODE_CONTENT &&
+		  resp.len == 4 && memcmp(buf, "slow", 4) == 0, title);
+
+	memset(&resp, 0, sizeof(resp));
+	snprintf(title, sizeof(title), "%s: 4.04", name);
+	check(coap_get(ctx, "nothing/here", &resp) == COAP_RET_OK &&
+		  resp.code == COAP_CODE_NOT_FOUND, title);
+}
+
+/* bytes on air ----------------------------------------------------------- */
+
+static void air_print(const char *name, int ok, air_t air)
+{
+	if (!ok)
+		printf("  %-48s   failed\n", name);
+	else if (cap_on)
+		printf("  %-48s %7llu %7u %9llu\n", name, (unsigned long long)air.bytes, air.packets,
+			   (unsigned long long)air.payload);
+	else
+		printf("  %-48s %7s %7s %9llu\n", name, "-", "-", (unsigned long long)air.payload);
+}
+
+/* per report over an open session, then per session of one report */
+static void air_coap(int reports, const coap_psk_t *key, int confirmable, int no_response,
+					 const char *name)
+{
+	int port = key ? COAPS_PORT : COAP_PORT;
+	coap_ctx_t *ctx;
+	air_t a = { 0 }, b;
+	char title[64];
+	int i, ok = 1;
+
+	ctx = coap_client_open(HOST, port, key, NULL);
+	if (ctx == NULL) {
+		air_print(name, 0, a);
+		return;
+	}
+	a = cap_mark(IPPROTO_UDP, port);
+	a.payload = coap_payload(ctx);
+	for (i = 0; i < reports; i++)
+		ok &= coap_report(ctx, i + 1, confirmable, no_response) == 0;
+	b = cap_mark(IPPROTO_UDP, port);
+	b.payload = coap_payload(ctx);
+	coap_close(ctx);
+	air_print(name, ok, air_diff(a, b, reports));
+
+	if (!confirmable)
+		return;
+	for (i = 0; i < (key ? 2 : 1); i++) {
+		uint64_t payload = 0;
+
+		/* the first DTLS session makes a full handshake, the second resumes it */
+		if (key && i == 0)
+			tls_session_cache_remove(HOST, port);
+		a = cap_mark(IPPROTO_UDP, port);
+		ctx = coap_client_open(HOST, port, key, NULL);
+		ok = ctx && coap_report(ctx, 1, confirmable, no_response) == 0;
+		if (ctx) {
+			payload = coap_payload(ctx);
+			coap_close(ctx);
+		}
+		b = cap_mark(IPPROTO_UDP, port);
+		a.payload = 0;
+		b.payload = payload;
+		snprintf(title, sizeof(title), "%s, wake-up%s", name,
+				 key ? (i ? " (resumed)" : " (full)") : "");
+		air_print(title, ok, air_diff(a, b, 1));
+	}
+}
+
+static void air_mqtt(int reports, int tls, const char *name)
+{
+	int port = tls ? MQTTS_PORT : MQTT_PORT;
+	mqtt_client_t m;
+	air_t a = { 0 }, b;
+	char title[64];
+	int i, ok = 1;
+
+	if (mqtt_open(&m, tls) < 0) {
+		air_print(name, 0, a);
+		return;
+	}
+	a = cap_mark(IPPROTO_TCP, port);
+	a.payload = m.c.bytes;
+	for (i = 0; i < reports; i++)
+		ok &= mqtt_report(&m, i + 1) == 0;
+	b = cap_mark(IPPROTO_TCP, port);
+	b.payload = m.c.bytes;
+	mqtt_close(&m);
+	air_print(name, ok, air_diff(a, b, reports));
+
+	for (i = 0; i < (tls ? 2 : 1); i++) {
+		uint64_t bytes = 0;
+
+		if (tls && i == 0)
+			tls_session_cache_remove(HOST, port);
+		a = cap_mark(IPPROTO_TCP, port);
+		ok = mqtt_open(&m, tls) == 0;
+		if (ok) {
+			ok = mqtt_report(&m, 1) == 0 && (!tls || m.resumed == i);
+			mqtt_close(&m);
+			bytes = m.c.bytes;
+		}
+		b = cap_mark(IPPROTO_TCP, port);
+		a.payload = 0;
+		b.payload = bytes;
+		snprintf(title, sizeof(title), "%s, wake-up%s", name,
+				 tls ? (i ? " (resumed)" : " (full)") : "");
+		air_print(title, ok, air_diff(a, b, 1));
+	}
+}
+
+/* lib/coap as a server, for coap_server.py --probe ----------------------- */
+
+static uint8_t blob[3000];
+static char counter_buf[16];
+static int counter;
+static uint8_t upload_buf[4096];
+static size_t upload_len;
+static char upload_resp[32];
+
+static int res_hello(void *arg, const coap_msg_t *req, coap_msg_t *resp)
+{
+	if (req->code != COAP_METHOD_GET)
+		return COAP_CODE_METHOD_NOT_ALLOWED;
+	coap_msg_add_option_uint(resp, COAP_OPTION_CONTENT_FORMAT, COAP_FORMAT_TEXT);
+	resp->payload = (const uint8_t *)"hello";
+	resp->payload_len = 5;
+	return 0;
+}
+
+static int res_blob(void *arg, const coap_msg_t *req, coap_msg_t *resp)
+{
+	if (req->code != COAP_METHOD_GET)
+		return COAP_CODE_METHOD_NOT_ALLOWED;
+	coap_msg_add_option_uint(resp, COAP_OPTION_CONTENT_FORMAT, COAP_FORMAT_OCTET);
+	resp->payload = blob;
+	resp->payload_len = sizeof(blob);
+	return 0;
+}
+
+static int res_counter(void *arg, const coap_msg_t *req, coap_msg_t *resp)
+{
+	if (req->code != COAP_METHOD_GET)
+		return COAP_CODE_METHOD_NOT_ALLOWED;
+	snprintf(counter_buf, sizeof(counter_buf), "%d", counter);
+	coap_msg_add_option_uint(resp, COAP_OPTION_CONTENT_FORMAT, COAP_FORMAT_TEXT);
+	resp->payload = (const uint8_t *)counter_buf;
+	resp->payload_len = strlen(counter_buf);
+	return 0;
+}
+
+static int res_upload(void *arg, const coap_msg_t *req, coap_msg_t *resp)
+{
+	coap_block_t b1;
+	int ret;
+
+	if (req->code != COAP_METHOD_POST && req->code != COAP_METHOD_PUT)
+		return COAP_CODE_METHOD_NOT_ALLOWED;
+	ret = coap_msg_get_block(req, COAP_OPTION_BLOCK1, &b1);
+	if (ret < 0)
+		return COAP_CODE_BAD_OPTION;
+	if (ret == 0) {
+		b1.num = 0;
+		b1.more = 0;
+		b1.szx = 0;
+		upload_len = 0;
+	} else if (b1.num == 0) {
+		upload_len = 0;
+	} else if (b1.num * COAP_BLOCK_SIZE(b1.szx) != upload_len) {
+		return COAP_CODE_REQUEST_ENTITY_INCOMPLETE;
+	}
+	if (upload_len + req->payload_len > sizeof(upload_buf))
+		return COAP_CODE_REQUEST_ENTITY_TOO_LARGE;
+	memcpy(upload_buf + upload_len, req->payload, req->payload_len);
+	upload_len += req->payload_len;
+	if (b1.more)
+		return 0;
+	snprintf(upload_resp, sizeof(upload_resp), "%u %08x", (unsigned int)upload_len,
+			 crc32(0, upload_buf, upload_len));
+	resp->code = COAP_CODE_CHANGED;
+	resp->payload = (const uint8_t *)upload_resp;
+	resp->payload_len = strlen(upload_resp);
+	return 0;
+}
+
+static int serve(int port)
+{
+	coap_ctx_t *ctx;
+	uint32_t next;
+	int res, i;
+
+	for (i = 0; i < (int)sizeof(blob); i++)
+		blob[i] = (uint8_t)(i * 7 + (i >> 8));
+	ctx = coap_server_open(port);
+	if (ctx == NULL)
+		return 1;
+	coap_server_add_resource(ctx, "hello", res_hello, NULL, 0);
+	coap_server_add_resource(ctx, "blob", res_blob, NULL, 0);
+	coap_server_add_resource(ctx, "upload", res_upload, NULL, 0);
+	res = coap_server_add_resource(ctx, "counter", res_counter, NULL, 1);
+	printf("coap://0.0.0.0:%d\n", port);
+	fflush(stdout);
+
+	next = sys_now() + 200;
+	for (;;) {
+		coap_poll(ctx, 50);
+		if ((int32_t)(sys_now() - next) >= 0) {
+			counter++;
+			coap_notify(ctx, res);
+			next += 200;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t t;
+	coap_ctx_t *ctx;
+	int reports = 20;
+	int ret;
+
+	if (argc > 1 && strcmp(argv[1], "serve") == 0)
+		return serve(argc > 2 ? atoi(argv[2]) : 5685);
+	if (argc > 1)
+		reports = atoi(argv[1]);
+	if (reports < 1)
+		reports = 1;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	mqtt_client_certs();
+	cap_start();
+	pthread_create(&t, NULL, dtls_relay_thread, NULL);
+	pthread_create(&t, NULL, mqtt_broker_thread, (void *)(intptr_t)1);
+	pthread_create(&t, NULL, mqtt_broker_thread, (void *)(intptr_t)0);
+	usleep(200 * 1000);
+
+	ctx = coap_client_open(HOST, COAP_PORT, NULL, &ret);
+	check(ctx != NULL, "coap: open");
+	if (ctx) {
+		coap_tests(ctx, "coap");
+		coap_close(ctx);
+	}
+	ctx = coap_client_open(HOST, COAPS_PORT, &psk, &ret);
+	check(ctx != NULL, "coaps: DTLS-PSK handshake");
+	if (ctx) {
+		coap_stats_t full, resumed;
+
+		coap_get_stats(ctx, &full);
+		coap_tests(ctx, "coaps");
+		coap_close(ctx);
+		ctx = coap_client_open(HOST, COAPS_PORT, &psk, &ret);
+		if (ctx) {
+			coap_get_stats(ctx, &resumed);
+			coap_close(ctx);
+		}
+		check(ctx != NULL && resumed.handshake_bytes < full.handshake_bytes,
+			  "coaps: resumed handshake");
+	}
+	{
+		static const uint8_t bad_key[16] = { 1 };
+		coap_psk_t bad = { bad_key, sizeof(bad_key), PSK_IDENTITY };
+
+		tls_session_cache_remove(HOST, COAPS_PORT);
+		ctx = coap_client_open(HOST, COAPS_PORT, &bad, &ret);
+		check(ctx == NULL && ret == COAP_RET_ERROR_DTLS, "coaps: wrong PSK refused");
+		if (ctx)
+			coap_close(ctx);
+	}
+
+	printf("\nbytes of a report of \"message count N\" (%d reports), "
+		   "IPv4 on air, TCP headers without options\n", reports);
+	printf("  %-48s %7s %7s %9s\n", "", "bytes", "packets", "UDP/TCP");
+	air_coap(reports, NULL, 1, 0, "CoAP CON");
+	air_coap(reports, NULL, 0, 1, "CoAP NON, No-Response");
+	air_coap(reports, &psk, 1, 0, "CoAP CON, DTLS-PSK");
+	air_mqtt(reports, 1, "MQTT QoS 1, TLS (sample_mqtt)");
+	air_mqtt(reports, 0, "MQTT QoS 1, TCP");
+
+	printf("\n%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,543 @@
+#!/usr/bin/env python3
+"""
+CoAP server for the interop test of lib/coap (coap_interop.c), on the Python
+standard library only: RFC 7252 messages, confirmable and non-confirmable,
+with duplicate detection and separate responses; block-wise transfers
+(RFC 7959), observe (RFC 7641) and No-Response (RFC 7967).
+
+Resources:
+  halow/11ah/coap/sample/mytopic  POST/PUT a report, GET the last one;
+                                  observable, each report is notified
+  fw                              GET a firmware image, block-wise (--fw-size)
+  upload                          POST/PUT block-wise; 2.04 with "<length>
+                                  <crc32>" of what was received
+  slow                            GET, answered by a separate response
+  .well-known/core                GET the resources
+
+With --probe, a client of the resources of "coap_interop serve" instead:
+hello, blob (block-wise), upload (Block1) and counter (observable).
+
+    ./coap_server.py [--port 5683] [--block1-size 512] [-v]
+    ./coap_server.py --probe 127.0.0.1:5685
+"""
+
+import argparse
+import os
+import select
+import socket
+import struct
+import sys
+import time
+import zlib
+
+CON, NON, ACK, RST = range(4)
+
+GET, POST, PUT, DELETE = 1, 2, 3, 4
+CREATED, CHANGED, CONTENT, CONTINUE = 0x41, 0x44, 0x45, 0x5F
+BAD_REQUEST, BAD_OPTION, NOT_FOUND, METHOD_NOT_ALLOWED = 0x80, 0x82, 0x84, 0x85
+INCOMPLETE = 0x88
+
+OBSERVE, URI_PATH, CONTENT_FORMAT, ETAG = 6, 11, 12, 4
+BLOCK2, BLOCK1, SIZE2, SIZE1, NO_RESPONSE = 23, 27, 28, 60, 258
+# critical options the server understands
+KNOWN_CRITICAL = {3, 7, 11, 15, 17, 23, 27}
+
+ACK_TIMEOUT = 2.0
+MAX_RETRANSMIT = 4
+EXCHANGE_LIFETIME = 247.0
+NOTIFY_CON_INTERVAL = 4
+MAX_BLOCK_SZX = 6
+
+REPORT_PATH = "halow/11ah/coap/sample/mytopic"
+
+
+class Message:
+    def __init__(self, mtype=CON, code=0, mid=0, token=b"", options=None, payload=b""):
+        self.type = mtype
+        self.code = code
+        self.mid = mid
+        self.token = token
+        self.options = options or []  # (number, bytes), sorted when encoded
+        self.payload = payload
+
+    def opt(self, num):
+        for n, v in self.options:
+            if n == num:
+                return v
+        return None
+
+    def opt_uint(self, num):
+        v = self.opt(num)
+        return None if v is None else int.from_bytes(v, "big")
+
+    def path(self):
+        return "/".join(v.decode() for n, v in self.options if n == URI_PATH)
+
+    def add_uint(self, num, val):
+        self.options.append((num, val.to_bytes((val.bit_length() + 7) // 8, "big")))
+
+    def block(self, num):
+        v = self.opt_uint(num)
+        if v is None:
+            return None
+        return v >> 4, (v >> 3) & 1, v & 7
+
+    def add_block(self, num, bnum, more, szx):
+        self.add_uint(num, (bnum << 4) | (more << 3) | szx)
+
+
+def _ext(v):
+    if v < 13:
+        return v, b""
+    if v < 269:
+        return 13, bytes([v - 13])
+    return 14, struct.pack("!H", v - 269)
+
+
+def encode(m):
+    out = bytearray([(1 << 6) | (m.type << 4) | len(m.token), m.code]) + struct.pack("!H", m.mid)
+    out += m.token
+    last = 0
+    for num, val in sorted(m.options, key=lambda o: o[0]):
+        d, dext = _ext(num - last)
+        l, lext = _ext(len(val))
+        out += bytes([(d << 4) | l]) + dext + lext + val
+        last = num
+    if m.payload:
+        out += b"\xff" + m.payload
+    return bytes(out)
+
+
+def decode(data):
+    if len(data) < 4 or data[0] >> 6 != 1 or data[0] & 0xF > 8:
+        raise ValueError("header")
+    tkl = data[0] & 0xF
+    m = Message((data[0] >> 4) & 3, data[1], struct.unpack("!H", data[2:4])[0], data[4:4 + tkl])
+    pos, num = 4 + tkl, 0
+    if pos > len(data):
+        raise ValueError("token")
+    while pos < len(data):
+        b = data[pos]
+        pos += 1
+        if b == 0xFF:
+            if pos == len(data):
+                raise ValueError("payload marker")
+            m.payload = data[pos:]
+            break
+        vals = []
+        for nib in (b >> 4, b & 0xF):
+            if nib == 13:
+                vals.append(data[pos] + 13)
+                pos += 1
+            elif nib == 14:
+                vals.append(struct.unpack("!H", data[pos:pos + 2])[0] + 269)
+                pos += 2
+            elif nib == 15:
+                raise ValueError("option")
+            else:
+                vals.append(nib)
+        num += vals[0]
+        if pos + vals[1] > len(data):
+            raise ValueError("option length")
+        m.options.append((num, data[pos:pos + vals[1]]))
+        pos += vals[1]
+    return m
+
+
+class Server:
+    def __init__(self, port, fw_size, block1_szx, verbose):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(("0.0.0.0", port))
+        self.verbose = verbose
+        self.mid = int.from_bytes(os.urandom(2), "big")
+        self.fw = bytes((i * 7 + (i >> 8)) & 0xFF for i in range(fw_size))
+        self.fw_etag = struct.pack("!I", zlib.crc32(self.fw))
+        self.block1_szx = block1_szx
+        self.report = b""
+        self.seq = 0
+        self.observers = {}  # (addr, token) -> [count, mid of the last notification]
+        self.uploads = {}  # (addr, path) -> bytearray
+        self.responses = {}  # (addr, mid) -> (expiry, datagram)
+        self.pending = []  # [deadline, timeout, retries, addr, datagram, mid, key]
+        self.timers = []  # [deadline, callable]
+
+    def log(self, fmt, *args):
+        if self.verbose:
+            print(fmt % args, flush=True)
+
+    def next_mid(self):
+        self.mid = (self.mid + 1) & 0xFFFF
+        return self.mid
+
+    def send(self, addr, m, key=None):
+        data = encode(m)
+        self.sock.sendto(data, addr)
+        if m.type == CON:
+            self.pending.append([time.monotonic() + ACK_TIMEOUT, ACK_TIMEOUT, 0, addr, data, m.mid, key])
+        return data
+
+    # resources ------------------------------------------------------------
+
+    def res_report(self, addr, req, resp):
+        if req.code in (POST, PUT):
+            self.report = req.payload
+            resp.code = CHANGED
+            self.timers.append([0, self.notify])
+            return
+        if req.code != GET:
+            resp.code = METHOD_NOT_ALLOWED
+            return
+        resp.add_uint(CONTENT_FORMAT, 0)
+        resp.payload = self.report
+
+    def res_fw(self, addr, req, resp):
+        if req.code != GET:
+            resp.code = METHOD_NOT_ALLOWED
+            return
+        resp.options.append((ETAG, self.fw_etag))
+        resp.add_uint(CONTENT_FORMAT, 42)
+        resp.payload = self.fw
+
+    def res_upload(self, addr, req, resp):
+        if req.code not in (POST, PUT):
+            resp.code = METHOD_NOT_ALLOWED
+            return
+        key = (addr, req.path())
+        b1 = req.block(BLOCK1)
+        if b1 is None:
+            data = req.payload
+        else:
+            num, more, szx = b1
+            buf = self.uploads.setdefault(key, bytearray())
+            if num == 0:
+                del buf[:]
+            if num * (16 << szx) != len(buf):
+                resp.code = INCOMPLETE
+                return
+            buf += req.payload
+            resp.add_block(BLOCK1, num, more, min(szx, self.block1_szx))
+            if more:
+                resp.code = CONTINUE
+                return
+            data = bytes(self.uploads.pop(key))
+        resp.code = CHANGED
+        resp.payload = b"%d %08x" % (len(data), zlib.crc32(data))
+
+    def res_slow(self, addr, req, resp):
+        resp.payload = b"slow"
+        return "separate"
+
+    def res_core(self, addr, req, resp):
+        resp.add_uint(CONTENT_FORMAT, 40)
+        resp.payload = b"</%s>;obs,</fw>;sz=%d,</upload>,</slow>" % (REPORT_PATH.encode(), len(self.fw))
+
+    # messages -------------------------------------------------------------
+
+    def resource(self, path):
+        return {
+            REPORT_PATH: self.res_report,
+            "fw": self.res_fw,
+            "upload": self.res_upload,
+            "slow": self.res_slow,
+            ".well-known/core": self.res_core,
+        }.get(path)
+
+    def block2(self, req, resp):
+        """The block of the payload asked for, or the first one"""
+        b2 = req.block(BLOCK2)
+        num, szx = (b2[0], b2[2]) if b2 else (0, MAX_BLOCK_SZX)
+        if szx > MAX_BLOCK_SZX:
+            num <<= szx - MAX_BLOCK_SZX
+            szx = MAX_BLOCK_SZX
+        size = 16 << szx
+        if b2 is None and len(resp.payload) <= size:
+            return
+        off = num * size
+        if off >= len(resp.payload):
+            resp.code, resp.payload = BAD_OPTION, b""
+            return
+        more = int(len(resp.payload) > off + size)
+        resp.add_block(BLOCK2, num, more, szx)
+        if num == 0:
+            resp.add_uint(SIZE2, len(resp.payload))
+        resp.payload = resp.payload[off:off + size]
+
+    def handle_request(self, addr, req):
+        dup = self.responses.get((addr, req.mid))
+        if dup is not None:
+            self.log("%s duplicate mid %d", addr, req.mid)
+            if req.type == CON:
+                self.sock.sendto(dup[1], addr)
+            return
+
+        resp = Message(ACK if req.type == CON else NON, CONTENT,
+                       req.mid if req.type == CON else self.next_mid(), req.token)
+        path = req.path()
+        handler = self.resource(path)
+        obs = req.opt_uint(OBSERVE)
+        separate = None
+        if any(n & 1 and n not in KNOWN_CRITICAL for n, _ in req.options):
+            resp.code = BAD_OPTION
+        elif handler is None:
+            resp.code = NOT_FOUND
+        else:
+            separate = handler(addr, req, resp)
+            if resp.code >> 5 == 2 and resp.code != CONTINUE:
+                self.block2(req, resp)
+
+        key = (addr, req.token)
+        if obs is not None and path == REPORT_PATH and req.code == GET:
+            if obs == 0 and resp.code >> 5 == 2:
+                self.observers.setdefault(key, [0, None])
+                resp.add_uint(OBSERVE, self.seq)
+                self.log("%s observes %s", addr, path)
+            else:
+                self.observers.pop(key, None)
+
+        nr = req.opt_uint(NO_RESPONSE) or 0
+        suppressed = nr & (1 << ((resp.code >> 5) - 1))
+
+        if separate:
+            ack = Message(ACK, 0, req.mid)
+            if req.type == CON:
+                self.sock.sendto(encode(ack), addr)
+                self.responses[(addr, req.mid)] = (time.monotonic() + EXCHANGE_LIFETIME, encode(ack))
+            resp.type, resp.mid = req.type, self.next_mid()
+            self.timers.append([time.monotonic() + 0.3, lambda: self.send(addr, resp)])
+            return
+
+        if suppressed:
+            data = encode(Message(ACK, 0, req.mid)) if req.type == CON else None
+        else:
+            data = encode(resp)
+        if data is not None:
+            self.sock.sendto(data, addr)
+            self.responses[(addr, req.mid)] = (time.monotonic() + EXCHANGE_LIFETIME, data)
+        self.log("%s %d.%02d %s %dB -> %d.%02d %dB%s", addr, req.code >> 5, req.code & 31, path,
+                 len(req.payload), resp.code >> 5, resp.code & 31, len(resp.payload),
+                 " (suppressed)" if suppressed else "")
+
+    def notify(self):
+        self.seq = (self.seq + 1) & 0xFFFFFF
+        for key, ob in list(self.observers.items()):
+            addr, token = key
+            ob[0] += 1
+            con = ob[0] % NOTIFY_CON_INTERVAL == 0
+            m = Message(CON if con else NON, CONTENT, self.next_mid(), token)
+            m.add_uint(OBSERVE, self.seq)
+            m.add_uint(CONTENT_FORMAT, 0)
+            m.payload = self.report
+            ob[1] = m.mid
+            self.send(addr, m, key)
+
+    def handle(self, addr, data):
+        try:
+            m = decode(data)
+        except (ValueError, IndexError):
+            self.log("%s malformed %s", addr, data.hex())
+            if len(data) >= 4 and data[0] >> 6 == 1 and (data[0] >> 4) & 3 == CON:
+                self.sock.sendto(encode(Message(RST, 0, struct.unpack("!H", data[2:4])[0])), addr)
+            return
+        if m.type in (ACK, RST):
+            for p in list(self.pending):
+                if p[3] == addr and p[5] == m.mid:
+                    self.pending.remove(p)
+                    if m.type == RST and p[6] is not None:
+                        self.observers.pop(p[6], None)
+            if m.type == RST:
+                for key, ob in list(self.observers.items()):
+                    if key[0] == addr and ob[1] == m.mid:
+                        self.log("%s cancels by reset", addr)
+                        del self.observers[key]
+            return
+        if m.code == 0 or m.code >> 5 != 0:
+            # a ping, or a response: the server sends no request
+            if m.type == CON:
+                self.sock.sendto(encode(Message(RST, 0, m.mid)), addr)
+            return
+        self.handle_request(addr, m)
+
+    def run(self):
+        while True:
+            now = time.monotonic()
+            for t in [t for t in self.timers if t[0] <= now]:
+                self.timers.remove(t)
+                t[1]()
+            for p in [p for p in self.pending if p[0] <= now]:
+                if p[2] == MAX_RETRANSMIT:
+                    self.pending.remove(p)
+                    if p[6] is not None:
+                        self.observers.pop(p[6], None)
+                    continue
+                p[2] += 1
+                p[1] *= 2
+                p[0] = now + p[1]
+                self.sock.sendto(p[4], p[3])
+            self.responses = {k: v for k, v in self.responses.items() if v[0] > now}
+            deadlines = [t[0] for t in self.timers] + [p[0] for p in self.pending]
+            wait = max(0.0, min(deadlines) - now) if deadlines else 1.0
+            if select.select([self.sock], [], [], wait)[0]:
+                data, addr = self.sock.recvfrom(2048)
+                self.handle(addr, data)
+
+
+class Probe:
+    """A client of the resources of "coap_interop serve" (lib/coap as a server)"""
+
+    BLOB = bytes((i * 7 + (i >> 8)) & 0xFF for i in range(3000))
+
+    def __init__(self, addr):
+        self.addr = addr
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.connect(addr)
+        self.mid = int.from_bytes(os.urandom(2), "big")
+        self.token = 0
+        self.failures = 0
+
+    def check(self, ok, name):
+        print("%s %s" % ("PASS" if ok else "FAIL", name), flush=True)
+        if not ok:
+            self.failures += 1
+
+    def recv(self, timeout):
+        if not select.select([self.sock], [], [], timeout)[0]:
+            return None
+        return decode(self.sock.recv(2048))
+
+    def request(self, code, path, mtype=CON, options=(), payload=b""):
+        """The response: piggybacked, separate or NON; None without one"""
+        self.mid = (self.mid + 1) & 0xFFFF
+        self.token += 1
+        req = Message(mtype, code, self.mid, struct.pack("!I", self.token), list(options), payload)
+        for seg in path.split("/"):
+            req.options.append((URI_PATH, seg.encode()))
+        data = encode(req)
+        self.sock.send(data)
+        deadline = time.monotonic() + 2.0
+        while time.monotonic() < deadline:
+            m = self.recv(deadline - time.monotonic())
+            if m is None:
+                break
+            if m.token != req.token:
+                continue
+            if m.type == CON:
+                self.sock.send(encode(Message(ACK, 0, m.mid)))
+            return m
+        return None
+
+    def blockwise(self, path, szx):
+        body, num = b"", 0
+        while True:
+            opts = [(BLOCK2, ((num << 4) | szx).to_bytes(2, "big"))] if num or szx < 6 else []
+            m = self.request(GET, path, options=opts)
+            if m is None or m.code != CONTENT:
+                return None, num
+            b2 = m.block(BLOCK2)
+            if b2 is None:
+                return body + m.payload, num + 1
+            if b2[0] != num or len(body) != num * (16 << b2[2]):
+                return None, num
+            body += m.payload
+            num += 1
+            if not b2[1]:
+                return body, num
+
+    def run(self):
+        m = self.request(GET, "hello")
+        self.check(m is not None and m.type == ACK and m.code == CONTENT and
+                   m.payload == b"hello" and m.opt_uint(CONTENT_FORMAT) == 0, "GET hello")
+        m = self.request(GET, "hello", mtype=NON)
+        self.check(m is not None and m.type == NON and m.payload == b"hello", "NON GET hello")
+
+        dup = encode(Message(CON, GET, (self.mid + 1) & 0xFFFF, b"dup!",
+                             [(URI_PATH, b"hello")]))
+        self.mid = (self.mid + 1) & 0xFFFF
+        self.sock.send(dup)
+        first = self.recv(1.0)
+        self.sock.send(dup)
+        second = self.recv(1.0)
+        self.check(first is not None and second is not None and
+                   encode(first) == encode(second), "duplicate CON, same response")
+
+        for szx in (6, 2):
+            body, blocks = self.blockwise("blob", szx)
+            self.check(body == self.BLOB and blocks == -(-len(self.BLOB) // (16 << szx)),
+                       "Block2 blob, %d-byte blocks" % (16 << szx))
+
+        data = bytes((i * 13) & 0xFF for i in range(2500))
+        szx, num, m = 4, 0, None
+        while num * (16 << szx) < len(data):
+            off = num * (16 << szx)
+            more = int(off + (16 << szx) < len(data))
+            opts = [(BLOCK1, ((num << 4) | (more << 3) | szx).to_bytes(2, "big"))]
+            m = self.request(POST, "upload", options=opts, payload=data[off:off + (16 << szx)])
+            if m is None or m.code != (CONTINUE if more else CHANGED):
+                break
+            num += 1
+        self.check(m is not None and m.code == CHANGED and
+                   m.payload == b"%d %08x" % (len(data), zlib.crc32(data)),
+                   "Block1 upload, 256-byte blocks")
+
+        m = self.request(POST, "upload", mtype=CON, options=[(NO_RESPONSE, b"\x02")],
+                         payload=b"x")
+        self.check(m is None, "No-Response, empty ACK only")
+
+        m = self.request(GET, "hello", options=[(9, b"x")])
+        self.check(m is not None and m.code == BAD_OPTION, "unknown critical option, 4.02")
+        m = self.request(GET, "nothing/here")
+        self.check(m is not None and m.code == NOT_FOUND, "4.04")
+
+        m = self.request(GET, "counter", options=[(OBSERVE, b"")])
+        token = struct.pack("!I", self.token)
+        self.check(m is not None and m.code == CONTENT and m.opt(OBSERVE) is not None, "observe")
+        seqs, cons = [], 0
+        deadline = time.monotonic() + 3.0
+        while len(seqs) < 10 and time.monotonic() < deadline:
+            n = self.recv(deadline - time.monotonic())
+            if n is None or n.token != token:
+                continue
+            seqs.append(n.opt_uint(OBSERVE))
+            if n.type == CON:
+                cons += 1
+                self.sock.send(encode(Message(ACK, 0, n.mid)))
+        self.check(len(seqs) == 10 and seqs == sorted(seqs) and cons >= 1,
+                   "observe, 10 notifications, CON ones acknowledged")
+        # reset the next notification: the server forgets the observer
+        n = self.recv(1.0)
+        if n is not None:
+            self.sock.send(encode(Message(RST, 0, n.mid)))
+        time.sleep(0.3)
+        while self.recv(0) is not None:
+            pass
+        self.check(n is not None and self.recv(1.0) is None, "observe, cancelled by reset")
+        return self.failures == 0
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    p.add_argument("--port", type=int, default=5683)
+    p.add_argument("--fw-size", type=int, default=65536, help="bytes of the fw resource")
+    p.add_argument("--block1-size", type=int, default=512,
+                   help="largest Block1 block accepted, 16 to 1024")
+    p.add_argument("-v", "--verbose", action="store_true")
+    p.add_argument("--probe", metavar="HOST:PORT", help="test coap_interop serve")
+    args = p.parse_args()
+
+    if args.probe:
+        host, port = args.probe.rsplit(":", 1)
+        sys.exit(0 if Probe((host, int(port))).run() else 1)
+
+    szx = args.block1_size.bit_length() - 5
+    if not 0 <= szx <= MAX_BLOCK_SZX or 16 << szx != args.block1_size:
+        p.error("--block1-size must be a power of two, 16 to 1024")
+    server = Server(args.port, args.fw_size, szx, args.verbose)
+    print("coap://0.0.0.0:%d" % args.port, flush=True)
+    try:
+        server.run()
+    except KeyboardInterrupt:
+        sys.exit(0)
+
+
+if __name__ == "__main__":
+    main()
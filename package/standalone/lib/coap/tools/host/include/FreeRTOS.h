@@ -0,0 +1,16 @@
+/*
+ * Host build of lib/coap (tools/coap_interop.c): the FreeRTOS types of
+ * lib/mbedtls/port/tls_session_cache.c, used by one thread.
+ */
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+#define configTICK_RATE_HZ	1000
+#define portMAX_DELAY		((TickType_t)0xffffffffUL)
+#define pdTRUE				1
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,9 @@
+/*
+ * Host build of lib/coap (tools/coap_interop.c): errno of the host.
+ */
+#ifndef LWIP_HDR_ERRNO_H
+#define LWIP_HDR_ERRNO_H
+
+#include <errno.h>
+
+#endif /* LWIP_HDR_ERRNO_H */
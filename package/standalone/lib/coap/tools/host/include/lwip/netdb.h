@@ -0,0 +1,9 @@
+/*
+ * Host build of lib/coap (tools/coap_interop.c): getaddrinfo() of the host.
+ */
+#ifndef LWIP_HDR_NETDB_H
+#define LWIP_HDR_NETDB_H
+
+#include <netdb.h>
+
+#endif /* LWIP_HDR_NETDB_H */
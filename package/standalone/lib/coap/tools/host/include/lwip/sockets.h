@@ -0,0 +1,14 @@
+/*
+ * Host build of lib/coap (tools/coap_interop.c): the BSD sockets of the
+ * host for the lwIP socket API.
+ */
+#ifndef LWIP_HDR_SOCKETS_H
+#define LWIP_HDR_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif /* LWIP_HDR_SOCKETS_H */
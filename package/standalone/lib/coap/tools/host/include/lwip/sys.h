@@ -0,0 +1,19 @@
+/*
+ * Host build of lib/coap (tools/coap_interop.c): sys_now() of the lwIP
+ * port, milliseconds of the monotonic clock.
+ */
+#ifndef LWIP_HDR_SYS_H
+#define LWIP_HDR_SYS_H
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint32_t sys_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+#endif /* LWIP_HDR_SYS_H */
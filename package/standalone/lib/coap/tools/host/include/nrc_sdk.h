@@ -0,0 +1,15 @@
+/*
+ * Host build of lib/coap (tools/coap_interop.c): the memory and print
+ * functions of the SDK.
+ */
+#ifndef __NRC_SDK_H__
+#define __NRC_SDK_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define nrc_mem_malloc	malloc
+#define nrc_mem_free	free
+#define nrc_usr_print	printf
+
+#endif /* __NRC_SDK_H__ */
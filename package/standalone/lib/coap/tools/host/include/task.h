@@ -0,0 +1,15 @@
+/*
+ * Host build of lib/coap (tools/coap_interop.c): the tick count, in ms,
+ * of one thread.
+ */
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "FreeRTOS.h"
+#include "lwip/sys.h"
+
+#define xTaskGetTickCount()	((TickType_t)sys_now())
+#define vTaskSuspendAll()
+#define xTaskResumeAll()	((void)0)
+
+#endif /* INC_TASK_H */
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Builds tools/coap_interop.c for the host with lib/coap, the session cache
+# of lib/mbedtls/port and the MQTTPacket serializer of sample_mqtt, then
+# runs it against coap_server.py, and coap_server.py --probe against
+# lib/coap as a server.
+#
+#   ./interop.sh [reports]          default: 20 reports per measurement
+#
+# Needs the host build of mbedTLS (lib/mbedtls/tools/host/build.sh), in
+# $MBEDTLS (default: /tmp/nrc-mbedtls-host). Run as root for the bytes on
+# air: they are captured on lo.
+
+set -e
+
+TOOLS=$(cd "$(dirname "$0")" && pwd)
+LIB=$TOOLS/../..
+MBEDTLS=${MBEDTLS:-/tmp/nrc-mbedtls-host}
+PAHO=$LIB/paho.mqtt/MQTTPacket/src
+PYTHON=${PYTHON:-python3}
+BIN=${BIN:-/tmp/coap_interop}
+
+[ -f "$MBEDTLS/library/libmbedtls.a" ] || "$LIB/mbedtls/tools/host/build.sh" "$MBEDTLS"
+
+cc -O2 -Wall -Wno-unused-parameter -Wno-sign-compare \
+	-DSUPPORT_MBEDTLS -DNRC_TLS_SESSION_CACHE \
+	-I"$TOOLS/host/include" -I"$TOOLS/../include" -I"$LIB/mbedtls/port/include" \
+	-I"$LIB/mbedtls/tools/host/include" -I"$MBEDTLS/include" -I"$PAHO" \
+	-o "$BIN" "$TOOLS/coap_interop.c" "$TOOLS"/../src/*.c \
+	"$LIB/mbedtls/port/tls_session_cache.c" \
+	"$PAHO/MQTTPacket.c" "$PAHO/MQTTConnectClient.c" "$PAHO/MQTTSerializePublish.c" \
+	-L"$MBEDTLS/library" -lmbedtls -lmbedx509 -lmbedcrypto -lpthread
+
+cd "$TOOLS"
+$PYTHON coap_server.py > /dev/null &
+SERVER=$!
+"$BIN" serve 5685 > /dev/null &
+LIBSERVER=$!
+trap 'kill $SERVER $LIBSERVER 2> /dev/null' EXIT
+sleep 1
+
+status=0
+"$BIN" "$@" || status=1
+echo
+$PYTHON coap_server.py --probe 127.0.0.1:5685 || status=1
+exit $status
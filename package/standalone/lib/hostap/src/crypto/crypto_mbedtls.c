@@ -123,6 +123,139 @@ int hmac_sha1(const u8 *key, size_t key_len, const u8 *data, size_t data_len,
 	wpa_printf(MSG_ERROR, TAG "%s\n", __func__);
 	return hmac_sha1_vector(key, key_len, 1, &data, &data_len, mac);
 }
+
+#ifndef CONFIG_USE_HW_SECURITY_ACC_SHA
+/*
+ * mbedtls_pkcs5_pbkdf2_hmac() restarts the HMAC for every iteration, which
+ * compresses the ipad and opad key blocks again each time: 4 SHA-1
+ * compressions per iteration. The key blocks only depend on the passphrase,
+ * so their states are computed once here and every iteration runs one
+ * compression for the inner and one for the outer hash over a single
+ * padded block holding the previous 20 octet digest.
+ *
+ * The accelerated SHA-1 (sha1_hw.c) keeps its chaining state in the engine
+ * rather than in the context, so it stays on the generic path below.
+ */
+static int pbkdf2_sha1_pad(mbedtls_sha1_context *ctx, const u8 *key,
+			   size_t key_len, u8 pad)
+{
+	u8 block[64];
+	size_t i;
+	int ret;
+
+	os_memset(block, pad, sizeof(block));
+	for (i = 0; i < key_len; i++)
+		block[i] ^= key[i];
+	ret = mbedtls_sha1_starts_ret(ctx);
+	if (ret == 0)
+		ret = mbedtls_sha1_update_ret(ctx, block, sizeof(block));
+	forced_memzero(block, sizeof(block));
+	return ret;
+}
+
+
+/* Replaces the digest at the start of block with its hash under key */
+static int pbkdf2_sha1_block(const mbedtls_sha1_context *key,
+			     mbedtls_sha1_context *ctx, u8 block[64])
+{
+	int i, ret;
+
+	os_memcpy(ctx->state, key->state, sizeof(ctx->state));
+	ret = mbedtls_internal_sha1_process(ctx, block);
+	for (i = 0; i < 5; i++)
+		WPA_PUT_BE32(block + 4 * i, ctx->state[i]);
+	return ret;
+}
+
+
+static int pbkdf2_sha1_f(const mbedtls_sha1_context *inner,
+			 const mbedtls_sha1_context *outer, const u8 *ssid,
+			 size_t ssid_len, int iterations, unsigned int count,
+			 u8 *digest)
+{
+	mbedtls_sha1_context ctx;
+	u8 block[64], count_buf[4];
+	int i, j, ret;
+
+	/* U1 = PRF(P, S || i) */
+	WPA_PUT_BE32(count_buf, count);
+	mbedtls_sha1_init(&ctx);
+	mbedtls_sha1_clone(&ctx, inner);
+	ret = mbedtls_sha1_update_ret(&ctx, ssid, ssid_len);
+	if (ret == 0)
+		ret = mbedtls_sha1_update_ret(&ctx, count_buf, 4);
+	if (ret == 0)
+		ret = mbedtls_sha1_finish_ret(&ctx, block);
+
+	/* SHA-1 padding of a 20 octet message following the key block */
+	os_memset(block + SHA1_MAC_LEN, 0, sizeof(block) - SHA1_MAC_LEN);
+	block[SHA1_MAC_LEN] = 0x80;
+	WPA_PUT_BE16(block + 62, (64 + SHA1_MAC_LEN) * 8);
+
+	if (ret == 0)
+		ret = pbkdf2_sha1_block(outer, &ctx, block);
+	os_memcpy(digest, block, SHA1_MAC_LEN);
+
+	/* Uc = PRF(P, Uc-1) */
+	for (i = 1; i < iterations && ret == 0; i++) {
+		ret = pbkdf2_sha1_block(inner, &ctx, block);
+		if (ret == 0)
+			ret = pbkdf2_sha1_block(outer, &ctx, block);
+		for (j = 0; j < SHA1_MAC_LEN; j++)
+			digest[j] ^= block[j];
+	}
+
+	forced_memzero(block, sizeof(block));
+	mbedtls_sha1_free(&ctx);
+	return ret;
+}
+
+
+int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
+		int iterations, u8 *buf, size_t buflen)
+{
+	mbedtls_sha1_context inner, outer;
+	const u8 *key = (const u8 *) passphrase;
+	size_t key_len = os_strlen(passphrase), plen;
+	u8 tk[SHA1_MAC_LEN], digest[SHA1_MAC_LEN];
+	unsigned int count = 0;
+	int res = 0;
+	uint32_t B_T, A_T;
+
+	A("[pbkdf2_sha1] Enter TSF : %d\n", B_T=TSF);
+	if (key_len > 64) {
+		if (sha1_vector(1, &key, &key_len, tk))
+			return -1;
+		key = tk;
+		key_len = SHA1_MAC_LEN;
+	}
+
+	mbedtls_sha1_init(&inner);
+	mbedtls_sha1_init(&outer);
+	res = pbkdf2_sha1_pad(&inner, key, key_len, 0x36);
+	if (res == 0)
+		res = pbkdf2_sha1_pad(&outer, key, key_len, 0x5c);
+
+	while (res == 0 && buflen > 0) {
+		count++;
+		res = pbkdf2_sha1_f(&inner, &outer, ssid, ssid_len, iterations,
+				    count, digest);
+		plen = buflen > SHA1_MAC_LEN ? SHA1_MAC_LEN : buflen;
+		os_memcpy(buf, digest, plen);
+		buf += plen;
+		buflen -= plen;
+	}
+
+	mbedtls_sha1_free(&inner);
+	mbedtls_sha1_free(&outer);
+	forced_memzero(tk, sizeof(tk));
+	forced_memzero(digest, sizeof(digest));
+	A("[pbkdf2_sha1] Exit  TSF : %d\n", A_T=TSF);
+	A("[pbkdf2_sha1] op time   : %d, count : %d\n", A_T-B_T, count);
+
+	return res == 0 ? 0 : -1;
+}
+#else /* CONFIG_USE_HW_SECURITY_ACC_SHA */
 int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 		int iterations, u8 *buf, size_t buflen)
 {
@@ -147,6 +280,7 @@ int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 
 	return res == 0 ? 0 : -1;
 }
+#endif /* CONFIG_USE_HW_SECURITY_ACC_SHA */
 
 
 int des_encrypt(const u8 *clear, const u8 *key, u8 *cypher)
@@ -10,6 +10,119 @@
 
 #include "common.h"
 #include "sha1.h"
+#ifdef CONFIG_INTERNAL_SHA1
+#include "sha1_i.h"
+#include "crypto.h"
+
+/*
+ * All HMAC-SHA1 operations in the PBKDF2 chain are keyed with the
+ * passphrase, so the compressions of the ipad and opad key blocks are the
+ * same for every iteration. They are done once, leaving one compression
+ * for the inner and one for the outer hash per iteration, each over a
+ * 20 octet message that fits in a single padded block.
+ */
+struct pbkdf2_sha1_key {
+	u32 inner[5];
+	u32 outer[5];
+};
+
+static void pbkdf2_sha1_pad(u32 state[5], const u8 *key, size_t key_len,
+			    u8 pad)
+{
+	u8 block[64];
+	size_t i;
+
+	os_memset(block, pad, sizeof(block));
+	for (i = 0; i < key_len; i++)
+		block[i] ^= key[i];
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+	state[4] = 0xC3D2E1F0;
+	SHA1Transform(state, block);
+	forced_memzero(block, sizeof(block));
+}
+
+
+static int pbkdf2_sha1_key(struct pbkdf2_sha1_key *key,
+			   const char *passphrase)
+{
+	const u8 *k = (const u8 *) passphrase;
+	size_t k_len = os_strlen(passphrase);
+	u8 tk[SHA1_MAC_LEN];
+
+	/* if key is longer than 64 bytes reset it to key = SHA1(key) */
+	if (k_len > 64) {
+		if (sha1_vector(1, &k, &k_len, tk))
+			return -1;
+		k = tk;
+		k_len = SHA1_MAC_LEN;
+	}
+
+	pbkdf2_sha1_pad(key->inner, k, k_len, 0x36);
+	pbkdf2_sha1_pad(key->outer, k, k_len, 0x5c);
+	forced_memzero(tk, sizeof(tk));
+	return 0;
+}
+
+
+/* Replaces the digest at the start of block with its hash under state */
+static void pbkdf2_sha1_block(const u32 state[5], u8 block[64])
+{
+	u32 s[5];
+	int i;
+
+	os_memcpy(s, state, sizeof(s));
+	SHA1Transform(s, block);
+	for (i = 0; i < 5; i++)
+		WPA_PUT_BE32(block + 4 * i, s[i]);
+}
+
+
+static int pbkdf2_sha1_f(const struct pbkdf2_sha1_key *key, const u8 *ssid,
+			 size_t ssid_len, int iterations, unsigned int count,
+			 u8 *digest)
+{
+	struct SHA1Context ctx;
+	u8 block[64];
+	unsigned char count_buf[4];
+	int i, j;
+
+	/* F(P, S, c, i) = U1 xor U2 xor ... Uc
+	 * U1 = PRF(P, S || i)
+	 * U2 = PRF(P, U1)
+	 * Uc = PRF(P, Uc-1)
+	 */
+
+	WPA_PUT_BE32(count_buf, count);
+	os_memcpy(ctx.state, key->inner, sizeof(ctx.state));
+	ctx.count[0] = 64 * 8;
+	ctx.count[1] = 0;
+	SHA1Update(&ctx, ssid, ssid_len);
+	SHA1Update(&ctx, count_buf, 4);
+	SHA1Final(block, &ctx);
+
+	/* SHA-1 padding of a 20 octet message following the key block */
+	os_memset(block + SHA1_MAC_LEN, 0, sizeof(block) - SHA1_MAC_LEN);
+	block[SHA1_MAC_LEN] = 0x80;
+	WPA_PUT_BE16(block + 62, (64 + SHA1_MAC_LEN) * 8);
+
+	pbkdf2_sha1_block(key->outer, block);
+	os_memcpy(digest, block, SHA1_MAC_LEN);
+
+	for (i = 1; i < iterations; i++) {
+		pbkdf2_sha1_block(key->inner, block);
+		pbkdf2_sha1_block(key->outer, block);
+		for (j = 0; j < SHA1_MAC_LEN; j++)
+			digest[j] ^= block[j];
+	}
+
+	forced_memzero(block, sizeof(block));
+	return 0;
+}
+
+#else /* CONFIG_INTERNAL_SHA1 */
 
 static int pbkdf2_sha1_f(const char *passphrase, const u8 *ssid,
 			 size_t ssid_len, int iterations, unsigned int count,
@@ -54,6 +167,8 @@ static int pbkdf2_sha1_f(const char *passphrase, const u8 *ssid,
 	return 0;
 }
 
+#endif /* CONFIG_INTERNAL_SHA1 */
+
 
 /**
  * pbkdf2_sha1 - SHA1-based key derivation function (PBKDF2) for IEEE 802.11i
@@ -76,17 +191,34 @@ int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 	unsigned char *pos = buf;
 	size_t left = buflen, plen;
 	unsigned char digest[SHA1_MAC_LEN];
+#ifdef CONFIG_INTERNAL_SHA1
+	struct pbkdf2_sha1_key key;
+
+	if (pbkdf2_sha1_key(&key, passphrase))
+		return -1;
+#endif /* CONFIG_INTERNAL_SHA1 */
 
 	while (left > 0) {
 		count++;
+#ifdef CONFIG_INTERNAL_SHA1
+		if (pbkdf2_sha1_f(&key, ssid, ssid_len, iterations,
+				  count, digest)) {
+			forced_memzero(&key, sizeof(key));
+			return -1;
+		}
+#else /* CONFIG_INTERNAL_SHA1 */
 		if (pbkdf2_sha1_f(passphrase, ssid, ssid_len, iterations,
 				  count, digest))
 			return -1;
+#endif /* CONFIG_INTERNAL_SHA1 */
 		plen = left > SHA1_MAC_LEN ? SHA1_MAC_LEN : left;
 		os_memcpy(pos, digest, plen);
 		pos += plen;
 		left -= plen;
 	}
 
+#ifdef CONFIG_INTERNAL_SHA1
+	forced_memzero(&key, sizeof(key));
+#endif /* CONFIG_INTERNAL_SHA1 */
 	return 0;
 }
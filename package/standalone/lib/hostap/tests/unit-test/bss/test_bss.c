@@ -0,0 +1,457 @@
+/*
+ * BSS table unit test and benchmark
+ *
+ * Replays scan results of a dense site (500 APs and mesh relays, some sharing
+ * an SSID, varying IE sizes and signal levels) into the BSS table of
+ * wpa_supplicant. After every round each entry must be found by
+ * wpa_bss_get() and wpa_bss_get_bssid() exactly as a walk of the list finds
+ * it. Reports time per round, heap allocations per round and the heap held
+ * by the table.
+ *
+ * test_bss is built with CONFIG_BSS_INDEX and also checks that a memory
+ * budget is kept by evicting the least recently updated entries, test_bss_list
+ * is the list-only table for comparison:
+ *
+ *   make run
+ */
+
+#include <malloc.h>
+#include <time.h>
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "common/ieee802_11_defs.h"
+#include "common/ieee802_11_common.h"
+#include "drivers/driver.h"
+#include "wpa_supplicant_i.h"
+#include "config.h"
+#include "scan.h"
+#include "bss.h"
+
+#define NUM_AP		500
+#define NUM_ROUNDS	20
+
+/* Heap accounting through the linker's --wrap */
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t n, size_t size);
+void * __real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static size_t n_alloc, cur_bytes;
+
+static void account(void *ptr)
+{
+	if (!ptr)
+		return;
+	n_alloc++;
+	cur_bytes += malloc_usable_size(ptr);
+}
+
+void * __wrap_malloc(size_t size)
+{
+	void *p = __real_malloc(size);
+	account(p);
+	return p;
+}
+
+void * __wrap_calloc(size_t n, size_t size)
+{
+	void *p = __real_calloc(n, size);
+	account(p);
+	return p;
+}
+
+void * __wrap_realloc(void *ptr, size_t size)
+{
+	void *p;
+
+	if (ptr)
+		cur_bytes -= malloc_usable_size(ptr);
+	p = __real_realloc(ptr, size);
+	if (p)
+		account(p);
+	else if (ptr)
+		cur_bytes += malloc_usable_size(ptr);
+	return p;
+}
+
+void __wrap_free(void *ptr)
+{
+	if (ptr)
+		cur_bytes -= malloc_usable_size(ptr);
+	__real_free(ptr);
+}
+
+
+/* What bss.c needs from the rest of wpa_supplicant */
+
+int wpa_supplicant_filter_bssid_match(struct wpa_supplicant *wpa_s,
+				      const u8 *bssid)
+{
+	return 1;
+}
+
+struct wpa_radio_work * radio_work_pending(struct wpa_supplicant *wpa_s,
+					   const char *type)
+{
+	return NULL;
+}
+
+void wpas_notify_bss_added(struct wpa_supplicant *wpa_s, u8 bssid[],
+			   unsigned int id) {}
+void wpas_notify_bss_removed(struct wpa_supplicant *wpa_s, u8 bssid[],
+			     unsigned int id) {}
+void wpas_notify_bss_freq_changed(struct wpa_supplicant *wpa_s,
+				  unsigned int id) {}
+void wpas_notify_bss_signal_changed(struct wpa_supplicant *wpa_s,
+				    unsigned int id) {}
+void wpas_notify_bss_privacy_changed(struct wpa_supplicant *wpa_s,
+				     unsigned int id) {}
+void wpas_notify_bss_mode_changed(struct wpa_supplicant *wpa_s,
+				  unsigned int id) {}
+void wpas_notify_bss_wpaie_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id) {}
+void wpas_notify_bss_rsnie_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id) {}
+void wpas_notify_bss_wps_changed(struct wpa_supplicant *wpa_s,
+				 unsigned int id) {}
+void wpas_notify_bss_ies_changed(struct wpa_supplicant *wpa_s,
+				 unsigned int id) {}
+void wpas_notify_bss_rates_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id) {}
+void wpas_notify_bss_seen(struct wpa_supplicant *wpa_s, unsigned int id) {}
+
+const u8 * wpa_scan_get_ie(const struct wpa_scan_res *res, u8 ie)
+{
+	return get_ie((const u8 *) (res + 1), res->ie_len, ie);
+}
+
+const u8 * wpa_scan_get_vendor_ie(const struct wpa_scan_res *res,
+				  u32 vendor_type)
+{
+	const struct element *elem;
+
+	for_each_element_id(elem, WLAN_EID_VENDOR_SPECIFIC,
+			    (const u8 *) (res + 1), res->ie_len) {
+		if (elem->datalen >= 4 &&
+		    vendor_type == WPA_GET_BE32(elem->data))
+			return &elem->id;
+	}
+	return NULL;
+}
+
+struct wpabuf * wpa_scan_get_vendor_ie_multi(const struct wpa_scan_res *res,
+					     u32 vendor_type)
+{
+	const struct element *elem;
+	struct wpabuf *buf = NULL;
+
+	for_each_element_id(elem, WLAN_EID_VENDOR_SPECIFIC,
+			    (const u8 *) (res + 1), res->ie_len) {
+		if (elem->datalen < 4 ||
+		    vendor_type != WPA_GET_BE32(elem->data))
+			continue;
+		if (wpabuf_resize(&buf, elem->datalen - 4) == 0)
+			wpabuf_put_data(buf, elem->data + 4, elem->datalen - 4);
+	}
+	return buf;
+}
+
+
+static struct wpa_supplicant wpa_s;
+static struct wpa_config conf;
+static struct wpa_scan_res *results[NUM_AP];
+static u32 seed = 1;
+
+static u32 rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u8 * add_ie(u8 *pos, u8 id, const void *data, size_t len)
+{
+	*pos++ = id;
+	*pos++ = len;
+	os_memcpy(pos, data, len);
+	return pos + len;
+}
+
+/*
+ * Scan result of AP i in a round: the same Probe Response and Beacon IEs,
+ * an SSID shared by every tenth AP (mesh relays), and a vendor IE whose size
+ * grows every few rounds for some APs.
+ */
+static struct wpa_scan_res * make_result(int i, int round)
+{
+	static const u8 rsn[] = {
+		0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f,
+		0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x08, 0xc0, 0x00
+	};
+	u8 ies[2 * 1024], filler[255], *pos = ies;
+	struct wpa_scan_res *res;
+	char ssid[SSID_MAX_LEN];
+	size_t len, ssid_len;
+	int vendor;
+
+	if (i % 10 == 0)
+		ssid_len = os_snprintf(ssid, sizeof(ssid), "halow-mesh");
+	else
+		ssid_len = os_snprintf(ssid, sizeof(ssid), "halow-%03d", i);
+	pos = add_ie(pos, WLAN_EID_SSID, ssid, ssid_len);
+	pos = add_ie(pos, WLAN_EID_RSN, rsn, sizeof(rsn));
+
+	/* 60..250 octets of vendor IEs, up to 700 for one AP in twenty */
+	vendor = 60 + (i * 37) % 190;
+	if (i % 20 == 0)
+		vendor += 450;
+	if (i % 7 == 0)
+		vendor += (round / 4) * 8;
+	os_memset(filler, i, sizeof(filler));
+	WPA_PUT_BE24(filler, OUI_WFA);
+	while (vendor > 0) {
+		size_t n = vendor > 255 ? 255 : vendor;
+
+		filler[3] = n;
+		pos = add_ie(pos, WLAN_EID_VENDOR_SPECIFIC, filler, n);
+		vendor -= n;
+	}
+
+	len = pos - ies;
+	res = os_zalloc(sizeof(*res) + 2 * len);
+	if (!res)
+		return NULL;
+	res->bssid[0] = 0x02;
+	res->bssid[1] = 0x13;
+	res->bssid[2] = 0x9c;
+	WPA_PUT_BE24(&res->bssid[3], 0x010000 + i * 3);
+	res->freq = 9035 + 10 * (i % 26);
+	res->beacon_int = 100;
+	res->caps = IEEE80211_CAP_ESS | IEEE80211_CAP_PRIVACY;
+	res->level = -40 - (int) (rnd() % 50);
+	res->ie_len = len;
+	res->beacon_ie_len = len;
+	os_memcpy(res + 1, ies, len);
+	os_memcpy((u8 *) (res + 1) + len, ies, len);
+	return res;
+}
+
+static struct wpa_bss * list_get(const u8 *bssid, const u8 *ssid,
+				 size_t ssid_len)
+{
+	struct wpa_bss *bss;
+
+	dl_list_for_each(bss, &wpa_s.bss, struct wpa_bss, list) {
+		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
+		    bss->ssid_len == ssid_len &&
+		    os_memcmp(bss->ssid, ssid, ssid_len) == 0)
+			return bss;
+	}
+	return NULL;
+}
+
+static struct wpa_bss * list_get_bssid(const u8 *bssid)
+{
+	struct wpa_bss *bss;
+
+	dl_list_for_each_reverse(bss, &wpa_s.bss, struct wpa_bss, list) {
+		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0)
+			return bss;
+	}
+	return NULL;
+}
+
+/* Lookups must find what a walk of the list finds */
+static int check_lookups(void)
+{
+	struct wpa_bss *bss;
+	const u8 *ssid;
+	size_t n = 0;
+	int i, fails = 0;
+
+	dl_list_for_each(bss, &wpa_s.bss, struct wpa_bss, list) {
+		if (wpa_bss_get(&wpa_s, bss->bssid, bss->ssid,
+				bss->ssid_len) != bss)
+			fails++;
+		if (wpa_bss_get_bssid(&wpa_s, bss->bssid) !=
+		    list_get_bssid(bss->bssid))
+			fails++;
+		if (wpa_bss_get_id(&wpa_s, bss->id) != bss)
+			fails++;
+		n++;
+	}
+	if (n != wpa_s.num_bss)
+		fails++;
+
+	for (i = 0; i < NUM_AP; i++) {
+		ssid = wpa_scan_get_ie(results[i], WLAN_EID_SSID);
+		if (wpa_bss_get(&wpa_s, results[i]->bssid, ssid + 2,
+				ssid[1]) !=
+		    list_get(results[i]->bssid, ssid + 2, ssid[1]))
+			fails++;
+	}
+
+	return fails;
+}
+
+/* Replays rounds of scan results, each AP being seen in 90% of the rounds */
+static int replay(int rounds, const char *name)
+{
+	struct os_reltime fetch_time;
+	struct wpa_bss_mem_stats stats;
+	size_t allocs = 0, held;
+	double t, elapsed = 0;
+	int round, i, fails = 0;
+
+	for (round = 0; round < rounds; round++) {
+		int order[NUM_AP];
+
+		for (i = 0; i < NUM_AP; i++) {
+			os_free(results[i]);
+			results[i] = make_result(i, round);
+			order[i] = i;
+		}
+		for (i = NUM_AP - 1; i > 0; i--) {
+			int j = rnd() % (i + 1), tmp = order[i];
+
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+
+		n_alloc = 0;
+		t = now();
+		os_get_reltime(&fetch_time);
+		wpa_bss_update_start(&wpa_s);
+		for (i = 0; i < NUM_AP; i++) {
+			if (rnd() % 10 == 0)
+				continue;
+			wpa_bss_update_scan_res(&wpa_s, results[order[i]],
+						&fetch_time);
+		}
+		wpa_bss_update_end(&wpa_s, NULL, 1);
+		elapsed += now() - t;
+		allocs += n_alloc;
+
+		fails += check_lookups();
+		if (wpa_bss_get_mem_stats(&wpa_s, &stats) == 0 &&
+		    stats.used > stats.budget) {
+			printf("round %d: %zu octets over a budget of %zu\n",
+			       round, stats.used, stats.budget);
+			fails++;
+		}
+	}
+
+	/* everything but the scan results */
+	held = cur_bytes;
+	for (i = 0; i < NUM_AP; i++)
+		held -= malloc_usable_size(results[i]);
+
+	printf("%-16s %8zu %12.1f %12.1f %10zu", name, wpa_s.num_bss,
+	       elapsed / rounds * 1e6, (double) allocs / rounds, held);
+	if (wpa_bss_get_mem_stats(&wpa_s, &stats) == 0)
+		printf("   pooled %u heap %u spare %u evicted %u",
+		       stats.pooled, stats.heap, stats.spare, stats.evicted);
+	printf("\n");
+	return fails;
+}
+
+/* An entry whose IEs outgrow its slot stays within a budget the table fills */
+static int grow(void)
+{
+	struct os_reltime fetch_time;
+	struct wpa_bss_mem_stats stats;
+	struct wpa_bss *bss;
+	struct wpa_scan_res *res;
+	int fails = 0, i;
+
+	if (wpa_bss_get_mem_stats(&wpa_s, &stats) < 0)
+		return 0;
+	wpa_bss_set_mem_budget(&wpa_s, stats.used);
+
+	/* an AP still in the table, with 800 more octets of vendor IEs */
+	for (i = 0; i < NUM_AP; i += 7) {
+		if (wpa_bss_get_bssid(&wpa_s, results[i]->bssid))
+			break;
+	}
+	if (i >= NUM_AP)
+		return 0;
+	res = make_result(i, 400);
+	os_get_reltime(&fetch_time);
+	wpa_bss_update_start(&wpa_s);
+	wpa_bss_update_scan_res(&wpa_s, res, &fetch_time);
+	wpa_bss_update_end(&wpa_s, NULL, 1);
+
+	wpa_bss_get_mem_stats(&wpa_s, &stats);
+	if (stats.used > stats.budget) {
+		printf("grow: %zu octets over a budget of %zu\n",
+		       stats.used, stats.budget);
+		fails++;
+	}
+	bss = wpa_bss_get_bssid(&wpa_s, res->bssid);
+	if (!bss || bss->ie_len != res->ie_len) {
+		printf("grow: IEs not updated\n");
+		fails++;
+	}
+	os_free(res);
+	return fails;
+}
+
+int main(int argc, char **argv)
+{
+	struct wpa_bss_mem_stats stats;
+	int fails = 0, i;
+
+	conf.bss_max_count = 1000;
+	conf.bss_expiration_scan_count = 2;
+	wpa_s.conf = &conf;
+	if (wpa_bss_init(&wpa_s) < 0)
+		return 1;
+
+	printf("%d APs, %d rounds\n\n", NUM_AP, NUM_ROUNDS);
+	printf("%-16s %8s %12s %12s %10s\n", "table", "entries", "us/round",
+	       "allocs/round", "heap");
+
+	/* unbounded, every AP fits */
+	wpa_bss_set_mem_budget(&wpa_s, 1024 * 1024);
+	fails += replay(NUM_ROUNDS, "unbounded");
+
+	/* a budget below what 500 APs need, the oldest updates go first */
+	if (wpa_bss_get_mem_stats(&wpa_s, &stats) == 0) {
+		wpa_bss_set_mem_budget(&wpa_s, stats.used / 2);
+		fails += replay(NUM_ROUNDS, "half budget");
+		wpa_bss_get_mem_stats(&wpa_s, &stats);
+		if (stats.evicted == 0 || wpa_s.num_bss >= NUM_AP) {
+			printf("budget: nothing evicted\n");
+			fails++;
+		}
+		fails += grow();
+	}
+
+	wpa_bss_flush(&wpa_s);
+	if (wpa_s.num_bss != 0 || !dl_list_empty(&wpa_s.bss)) {
+		printf("flush: %zu entries left\n", wpa_s.num_bss);
+		fails++;
+	}
+	wpa_bss_deinit(&wpa_s);
+
+	for (i = 0; i < NUM_AP; i++)
+		os_free(results[i]);
+	os_free(wpa_s.last_scan_res);
+
+	if (cur_bytes != 0) {
+		printf("leak: %zu octets\n", cur_bytes);
+		fails++;
+	}
+
+	printf("\n%s\n", fails ? "FAIL" : "PASS");
+	return fails ? 1 : 0;
+}
@@ -1363,6 +1363,7 @@ endif
 endif
 SHA1WPA_SUPP_CSRCS += $(WPA_SUPP_ROOT)/src/crypto/sha1-prf.c
 ifdef CONFIG_INTERNAL_SHA1
+CFLAGS += -DCONFIG_INTERNAL_SHA1
 SHA1WPA_SUPP_CSRCS += $(WPA_SUPP_ROOT)/src/crypto/sha1-internal.c
 ifdef NEED_FIPS186_2_PRF
 SHA1WPA_SUPP_CSRCS += $(WPA_SUPP_ROOT)/src/crypto/fips_prf_internal.c
@@ -1824,3 +1825,7 @@ endif
 ifdef CONFIG_SCAN_IGNORE
 CFLAGS += -DCONFIG_SCAN_IGNORE
 endif
+
+ifdef CONFIG_BSS_INDEX
+CFLAGS += -DCONFIG_BSS_INDEX
+endif
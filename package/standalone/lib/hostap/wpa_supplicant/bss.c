@@ -183,6 +183,312 @@ static void wpa_bss_anqp_free(struct wpa_bss_anqp *anqp)
 }
 
 
+/*
+ * BSS entries are allocated with a slot header in front of struct wpa_bss so
+ * that the layout of struct wpa_bss and struct wpa_supplicant stays as is.
+ * With CONFIG_BSS_INDEX, the header links the entry into a BSSID hash and
+ * entries whose IEs fit in BSS_SLOT_IE_LEN octets get a slot of one of
+ * BSS_SLOT_CLASSES sizes (BSS_SLOT_IE_LEN, half of it, ...). Slots are
+ * recycled through small spare lists and IE updates are copied in place as
+ * long as they fit, instead of reallocating the entry.
+ */
+struct wpa_bss_slot {
+	/* Next entry in the same hash bucket or in the spare slot list */
+	struct wpa_bss_slot *next;
+	/* Allocation size including this header */
+	size_t size;
+	struct wpa_bss bss;
+};
+
+#define wpa_bss_to_slot(b) dl_list_entry((b), struct wpa_bss_slot, bss)
+
+#ifdef CONFIG_BSS_INDEX
+
+#ifndef BSS_INDEX_BUCKETS
+#define BSS_INDEX_BUCKETS 64
+#endif /* BSS_INDEX_BUCKETS */
+
+#ifndef BSS_SLOT_IE_LEN
+#define BSS_SLOT_IE_LEN 512
+#endif /* BSS_SLOT_IE_LEN */
+
+#ifndef BSS_SLOT_CLASSES
+#define BSS_SLOT_CLASSES 2
+#endif /* BSS_SLOT_CLASSES */
+
+#ifndef BSS_SLOT_SPARE
+#define BSS_SLOT_SPARE 4
+#endif /* BSS_SLOT_SPARE */
+
+#ifndef BSS_MEM_BUDGET
+#define BSS_MEM_BUDGET (48 * 1024)
+#endif /* BSS_MEM_BUDGET */
+
+#define BSS_SLOT_SIZE(c) (sizeof(struct wpa_bss_slot) + \
+			  (BSS_SLOT_IE_LEN >> (BSS_SLOT_CLASSES - 1 - (c))))
+
+struct wpa_bss_index {
+	struct wpa_bss_index *next;
+	struct wpa_supplicant *wpa_s;
+	struct wpa_bss_slot *hash[BSS_INDEX_BUCKETS];
+	struct wpa_bss_slot *spare[BSS_SLOT_CLASSES];
+	unsigned int num_spare[BSS_SLOT_CLASSES];
+	unsigned int num_pooled;
+	unsigned int num_heap;
+	unsigned int evicted;
+	size_t mem;
+	size_t budget;
+};
+
+static struct wpa_bss_index *bss_indexes;
+
+
+static struct wpa_bss_index * wpa_bss_index_get(struct wpa_supplicant *wpa_s)
+{
+	struct wpa_bss_index *index;
+
+	for (index = bss_indexes; index; index = index->next) {
+		if (index->wpa_s == wpa_s)
+			return index;
+	}
+	return NULL;
+}
+
+
+static unsigned int wpa_bss_hash(const u8 *bssid)
+{
+	u32 h = WPA_GET_BE24(bssid + 3) ^ (WPA_GET_BE24(bssid) << 5);
+
+	return (h * 0x9e3779b1) >> 26 & (BSS_INDEX_BUCKETS - 1);
+}
+
+
+static void wpa_bss_index_link(struct wpa_bss_index *index,
+			       struct wpa_bss_slot *slot)
+{
+	struct wpa_bss_slot **head = &index->hash[wpa_bss_hash(slot->bss.bssid)];
+
+	slot->next = *head;
+	*head = slot;
+}
+
+
+static void wpa_bss_index_unlink(struct wpa_bss_index *index,
+				 struct wpa_bss_slot *slot)
+{
+	struct wpa_bss_slot **pos = &index->hash[wpa_bss_hash(slot->bss.bssid)];
+
+	for (; *pos; pos = &(*pos)->next) {
+		if (*pos == slot) {
+			*pos = slot->next;
+			break;
+		}
+	}
+	slot->next = NULL;
+}
+
+
+/* Slot class of an allocation, -1 for one sized to fit its IEs */
+static int wpa_bss_slot_class(size_t size)
+{
+	int c;
+
+	for (c = 0; c < BSS_SLOT_CLASSES; c++) {
+		if (size == BSS_SLOT_SIZE(c))
+			return c;
+	}
+	return -1;
+}
+
+
+static void wpa_bss_spare_flush(struct wpa_bss_index *index)
+{
+	struct wpa_bss_slot *slot;
+	int c;
+
+	for (c = 0; c < BSS_SLOT_CLASSES; c++) {
+		while ((slot = index->spare[c]) != NULL) {
+			index->spare[c] = slot->next;
+			os_free(slot);
+		}
+		index->num_spare[c] = 0;
+	}
+}
+
+
+/* Whether adding an entry of size octets keeps the table within its budget */
+static int wpa_bss_mem_fits(struct wpa_bss_index *index, size_t size)
+{
+	return index->mem + size <= index->budget;
+}
+
+#endif /* CONFIG_BSS_INDEX */
+
+
+static size_t wpa_bss_alloc_size(size_t ies_len)
+{
+#ifdef CONFIG_BSS_INDEX
+	int c;
+
+	for (c = 0; c < BSS_SLOT_CLASSES; c++) {
+		if (sizeof(struct wpa_bss_slot) + ies_len <= BSS_SLOT_SIZE(c))
+			return BSS_SLOT_SIZE(c);
+	}
+#endif /* CONFIG_BSS_INDEX */
+	return sizeof(struct wpa_bss_slot) + ies_len;
+}
+
+
+/* Allocates a zeroed entry with room for ies_len octets of IEs */
+static struct wpa_bss * wpa_bss_alloc(struct wpa_supplicant *wpa_s,
+				      size_t ies_len)
+{
+	size_t size = wpa_bss_alloc_size(ies_len);
+	struct wpa_bss_slot *slot = NULL;
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index = wpa_bss_index_get(wpa_s);
+	int c = wpa_bss_slot_class(size);
+
+	if (index && c >= 0 && index->spare[c]) {
+		slot = index->spare[c];
+		index->spare[c] = slot->next;
+		index->num_spare[c]--;
+		os_memset(slot, 0, size);
+	}
+#endif /* CONFIG_BSS_INDEX */
+
+	if (!slot)
+		slot = os_zalloc(size);
+	if (!slot)
+		return NULL;
+	slot->size = size;
+
+#ifdef CONFIG_BSS_INDEX
+	if (index) {
+		index->mem += size;
+		if (c >= 0)
+			index->num_pooled++;
+		else
+			index->num_heap++;
+	}
+#endif /* CONFIG_BSS_INDEX */
+
+	return &slot->bss;
+}
+
+
+/* Releases an entry that is no longer linked to any list or hash bucket */
+static void wpa_bss_free(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
+{
+	struct wpa_bss_slot *slot = wpa_bss_to_slot(bss);
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index = wpa_bss_index_get(wpa_s);
+	int c = wpa_bss_slot_class(slot->size);
+
+	if (index) {
+		index->mem -= slot->size;
+		if (c >= 0)
+			index->num_pooled--;
+		else
+			index->num_heap--;
+
+		if (c >= 0 && index->num_spare[c] < BSS_SLOT_SPARE) {
+			slot->next = index->spare[c];
+			index->spare[c] = slot;
+			index->num_spare[c]++;
+			return;
+		}
+	}
+#endif /* CONFIG_BSS_INDEX */
+
+	os_free(slot);
+}
+
+
+/* Number of IE octets that fit in the allocation of an entry */
+static size_t wpa_bss_ies_room(const struct wpa_bss *bss)
+{
+	const struct wpa_bss_slot *slot =
+		dl_list_entry(bss, const struct wpa_bss_slot, bss);
+
+	return slot->size - sizeof(struct wpa_bss_slot);
+}
+
+
+static void wpa_bss_index_add(struct wpa_supplicant *wpa_s,
+			      struct wpa_bss *bss)
+{
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index = wpa_bss_index_get(wpa_s);
+
+	if (index)
+		wpa_bss_index_link(index, wpa_bss_to_slot(bss));
+#endif /* CONFIG_BSS_INDEX */
+}
+
+
+static void wpa_bss_index_del(struct wpa_supplicant *wpa_s,
+			      struct wpa_bss *bss)
+{
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index = wpa_bss_index_get(wpa_s);
+
+	if (index)
+		wpa_bss_index_unlink(index, wpa_bss_to_slot(bss));
+#endif /* CONFIG_BSS_INDEX */
+}
+
+
+/**
+ * wpa_bss_set_mem_budget - Set the memory budget of the BSS table
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @budget: Octets the BSS entries may use, 0 for the default
+ *
+ * When adding an entry would exceed the budget, the least recently updated
+ * entries are removed first, preferring ones that match no configured
+ * network. bss_max_count still applies on top of this.
+ */
+void wpa_bss_set_mem_budget(struct wpa_supplicant *wpa_s, size_t budget)
+{
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index = wpa_bss_index_get(wpa_s);
+
+	if (index)
+		index->budget = budget ? budget : BSS_MEM_BUDGET;
+#endif /* CONFIG_BSS_INDEX */
+}
+
+
+/**
+ * wpa_bss_get_mem_stats - Get memory use of the BSS table
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @stats: Buffer for the statistics
+ * Returns: 0 on success, -1 if the table is not indexed
+ */
+int wpa_bss_get_mem_stats(struct wpa_supplicant *wpa_s,
+			  struct wpa_bss_mem_stats *stats)
+{
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index = wpa_bss_index_get(wpa_s);
+	int c;
+
+	if (index) {
+		stats->used = index->mem;
+		stats->budget = index->budget;
+		stats->pooled = index->num_pooled;
+		stats->heap = index->num_heap;
+		stats->spare = 0;
+		for (c = 0; c < BSS_SLOT_CLASSES; c++)
+			stats->spare += index->num_spare[c];
+		stats->evicted = index->evicted;
+		return 0;
+	}
+#endif /* CONFIG_BSS_INDEX */
+	os_memset(stats, 0, sizeof(*stats));
+	return -1;
+}
+
+
 static void wpa_bss_update_pending_connect(struct wpa_supplicant *wpa_s,
 					   struct wpa_bss *old_bss,
 					   struct wpa_bss *new_bss)
@@ -227,13 +533,14 @@ void wpa_bss_remove(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	wpa_bss_update_pending_connect(wpa_s, bss, NULL);
 	dl_list_del(&bss->list);
 	dl_list_del(&bss->list_id);
+	wpa_bss_index_del(wpa_s, bss);
 	wpa_s->num_bss--;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Remove id %u BSSID " MACSTR
 		" SSID '%s' due to %s", bss->id, MAC2STR(bss->bssid),
 		wpa_ssid_txt(bss->ssid, bss->ssid_len), reason);
 	wpas_notify_bss_removed(wpa_s, bss->bssid, bss->id);
 	wpa_bss_anqp_free(bss->anqp);
-	os_free(bss);
+	wpa_bss_free(wpa_s, bss);
 }
 
 
@@ -249,8 +556,27 @@ struct wpa_bss * wpa_bss_get(struct wpa_supplicant *wpa_s, const u8 *bssid,
 			     const u8 *ssid, size_t ssid_len)
 {
 	struct wpa_bss *bss;
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index;
+	struct wpa_bss_slot *slot;
+#endif /* CONFIG_BSS_INDEX */
+
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
+#ifdef CONFIG_BSS_INDEX
+	index = wpa_bss_index_get(wpa_s);
+	if (index) {
+		for (slot = index->hash[wpa_bss_hash(bssid)]; slot;
+		     slot = slot->next) {
+			bss = &slot->bss;
+			if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
+			    bss->ssid_len == ssid_len &&
+			    os_memcmp(bss->ssid, ssid, ssid_len) == 0)
+				return bss;
+		}
+		return NULL;
+	}
+#endif /* CONFIG_BSS_INDEX */
 	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
 		    bss->ssid_len == ssid_len &&
@@ -441,8 +767,16 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 {
 	struct wpa_bss *bss;
 	char extra[50];
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index = wpa_bss_index_get(wpa_s);
+	size_t size = wpa_bss_alloc_size(res->ie_len + res->beacon_ie_len);
+
+	while (index && !wpa_bss_mem_fits(index, size) &&
+	       wpa_bss_remove_oldest(wpa_s) == 0)
+		index->evicted++;
+#endif /* CONFIG_BSS_INDEX */
 
-	bss = os_zalloc(sizeof(*bss) + res->ie_len + res->beacon_ie_len);
+	bss = wpa_bss_alloc(wpa_s, res->ie_len + res->beacon_ie_len);
 	if (bss == NULL)
 		return NULL;
 	bss->id = wpa_s->bss_next_id++;
@@ -465,6 +799,7 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
 	dl_list_add_tail(&wpa_s->bss_id, &bss->list_id);
+	wpa_bss_index_add(wpa_s, bss);
 	wpa_s->num_bss++;
 	if (!is_zero_ether_addr(bss->hessid))
 		os_snprintf(extra, sizeof(extra), " HESSID " MACSTR,
@@ -659,8 +994,9 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	bss->scan_miss_count = 0;
 	bss->last_update_idx = wpa_s->bss_update_idx;
 	wpa_bss_copy_res(bss, res, fetch_time);
-	/* Move the entry to the end of the list */
+	/* Move the entry to the end of the list and the front of its bucket */
 	dl_list_del(&bss->list);
+	wpa_bss_index_del(wpa_s, bss);
 #ifdef CONFIG_P2P
 	if (wpa_bss_get_vendor_ie(bss, P2P_IE_VENDOR_TYPE) &&
 	    !wpa_scan_get_vendor_ie(res, P2P_IE_VENDOR_TYPE)) {
@@ -677,19 +1013,36 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 			MAC2STR(bss->bssid));
 	} else
 #endif /* CONFIG_P2P */
-	if (bss->ie_len + bss->beacon_ie_len >=
-	    res->ie_len + res->beacon_ie_len) {
+	if (wpa_bss_ies_room(bss) >= res->ie_len + res->beacon_ie_len) {
 		os_memcpy(bss->ies, res + 1, res->ie_len + res->beacon_ie_len);
 		bss->ie_len = res->ie_len;
 		bss->beacon_ie_len = res->beacon_ie_len;
 	} else {
 		struct wpa_bss *nbss;
-		struct dl_list *prev = bss->list_id.prev;
+		struct dl_list *prev;
+#ifdef CONFIG_BSS_INDEX
+		struct wpa_bss_index *index = wpa_bss_index_get(wpa_s);
+		size_t size = wpa_bss_alloc_size(res->ie_len +
+						 res->beacon_ie_len);
+
+		/*
+		 * The old entry is freed only once copied, so the new one has
+		 * to fit next to it. This entry is off the list and is not
+		 * evicted.
+		 */
+		while (index && !wpa_bss_mem_fits(index, size) &&
+		       wpa_bss_remove_oldest(wpa_s) == 0)
+			index->evicted++;
+#endif /* CONFIG_BSS_INDEX */
+
+		prev = bss->list_id.prev;
 		dl_list_del(&bss->list_id);
-		nbss = os_realloc(bss, sizeof(*bss) + res->ie_len +
-				  res->beacon_ie_len);
+		nbss = wpa_bss_alloc(wpa_s, res->ie_len + res->beacon_ie_len);
 		if (nbss) {
 			unsigned int i;
+
+			os_memcpy(nbss, bss, sizeof(*bss));
+			wpa_bss_free(wpa_s, bss);
 			for (i = 0; i < wpa_s->last_scan_res_used; i++) {
 				if (wpa_s->last_scan_res[i] == bss) {
 					wpa_s->last_scan_res[i] = nbss;
@@ -710,6 +1063,7 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	if (changes & WPA_BSS_IES_CHANGED_FLAG)
 		wpa_bss_set_hessid(bss);
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
+	wpa_bss_index_add(wpa_s, bss);
 
 	notify_bss_changes(wpa_s, changes, bss);
 
@@ -960,6 +1314,19 @@ void wpa_bss_flush_by_age(struct wpa_supplicant *wpa_s, int age)
  */
 int wpa_bss_init(struct wpa_supplicant *wpa_s)
 {
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index;
+
+	if (!wpa_bss_index_get(wpa_s)) {
+		index = os_zalloc(sizeof(*index));
+		if (index == NULL)
+			return -1;
+		index->wpa_s = wpa_s;
+		index->budget = BSS_MEM_BUDGET;
+		index->next = bss_indexes;
+		bss_indexes = index;
+	}
+#endif /* CONFIG_BSS_INDEX */
 	dl_list_init(&wpa_s->bss);
 	dl_list_init(&wpa_s->bss_id);
 	return 0;
@@ -993,7 +1360,24 @@ void wpa_bss_flush(struct wpa_supplicant *wpa_s)
  */
 void wpa_bss_deinit(struct wpa_supplicant *wpa_s)
 {
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index **pos, *index;
+#endif /* CONFIG_BSS_INDEX */
+
 	wpa_bss_flush(wpa_s);
+
+#ifdef CONFIG_BSS_INDEX
+	/* Entries still in use are freed to the heap once removed */
+	for (pos = &bss_indexes; *pos; pos = &(*pos)->next) {
+		index = *pos;
+		if (index->wpa_s == wpa_s) {
+			*pos = index->next;
+			wpa_bss_spare_flush(index);
+			os_free(index);
+			break;
+		}
+	}
+#endif /* CONFIG_BSS_INDEX */
 }
 
 
@@ -1007,8 +1391,25 @@ struct wpa_bss * wpa_bss_get_bssid(struct wpa_supplicant *wpa_s,
 				   const u8 *bssid)
 {
 	struct wpa_bss *bss;
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index;
+	struct wpa_bss_slot *slot;
+#endif /* CONFIG_BSS_INDEX */
+
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
+#ifdef CONFIG_BSS_INDEX
+	/* Buckets are ordered like the list in reverse, last updated first */
+	index = wpa_bss_index_get(wpa_s);
+	if (index) {
+		for (slot = index->hash[wpa_bss_hash(bssid)]; slot;
+		     slot = slot->next) {
+			if (os_memcmp(slot->bss.bssid, bssid, ETH_ALEN) == 0)
+				return &slot->bss;
+		}
+		return NULL;
+	}
+#endif /* CONFIG_BSS_INDEX */
 	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0)
 			return bss;
@@ -1032,8 +1433,29 @@ struct wpa_bss * wpa_bss_get_bssid_latest(struct wpa_supplicant *wpa_s,
 					  const u8 *bssid)
 {
 	struct wpa_bss *bss, *found = NULL;
+#ifdef CONFIG_BSS_INDEX
+	struct wpa_bss_index *index;
+	struct wpa_bss_slot *slot;
+#endif /* CONFIG_BSS_INDEX */
+
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
+#ifdef CONFIG_BSS_INDEX
+	index = wpa_bss_index_get(wpa_s);
+	if (index) {
+		for (slot = index->hash[wpa_bss_hash(bssid)]; slot;
+		     slot = slot->next) {
+			bss = &slot->bss;
+			if (os_memcmp(bss->bssid, bssid, ETH_ALEN) != 0)
+				continue;
+			if (found == NULL ||
+			    os_reltime_before(&found->last_update,
+					      &bss->last_update))
+				found = bss;
+		}
+		return found;
+	}
+#endif /* CONFIG_BSS_INDEX */
 	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) != 0)
 			continue;
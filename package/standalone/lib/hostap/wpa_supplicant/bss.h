@@ -125,6 +125,24 @@ struct wpa_bss {
 	u8 ies[];
 };
 
+/**
+ * struct wpa_bss_mem_stats - Memory use of the BSS table
+ */
+struct wpa_bss_mem_stats {
+	/** Octets allocated for BSS entries */
+	size_t used;
+	/** Octets the entries may use before the oldest ones are evicted */
+	size_t budget;
+	/** Entries in fixed size pool slots */
+	unsigned int pooled;
+	/** Entries whose IEs did not fit in a pool slot */
+	unsigned int heap;
+	/** Free pool slots kept for reuse */
+	unsigned int spare;
+	/** Entries removed to stay within the budget */
+	unsigned int evicted;
+};
+
 static inline const u8 * wpa_bss_ie_ptr(const struct wpa_bss *bss)
 {
 	return bss->ies;
@@ -144,6 +162,9 @@ int wpa_bss_init(struct wpa_supplicant *wpa_s);
 void wpa_bss_deinit(struct wpa_supplicant *wpa_s);
 void wpa_bss_flush(struct wpa_supplicant *wpa_s);
 void wpa_bss_flush_by_age(struct wpa_supplicant *wpa_s, int age);
+void wpa_bss_set_mem_budget(struct wpa_supplicant *wpa_s, size_t budget);
+int wpa_bss_get_mem_stats(struct wpa_supplicant *wpa_s,
+			  struct wpa_bss_mem_stats *stats);
 struct wpa_bss * wpa_bss_get(struct wpa_supplicant *wpa_s, const u8 *bssid,
 			     const u8 *ssid, size_t ssid_len);
 struct wpa_bss * wpa_bss_get_bssid(struct wpa_supplicant *wpa_s,
@@ -2,6 +2,7 @@
 #include "utils/common.h"
 #include "config.h"
 #include "wpa_supplicant_i.h"
+#include "bss.h"
 #include "ctrl_iface.h"
 #include "ctrl_iface_freeRTOS.h"
 #include "system_common.h"
@@ -28,6 +29,9 @@ static void wpa_printf(int level, const char *fmt, ...)
 
 struct ctrl_iface_priv {
 	struct wpa_supplicant *wpa_s;
+	bool conn_timing;
+	struct os_reltime conn_phase;
+	ctrl_iface_conn_time_t conn_time;
 };
 
 struct ctrl_iface_global_priv {
@@ -47,6 +51,17 @@ static struct wpa_supplicant *wpa_get_wpa_from_vif(int vif_id)
 	return global_ctrl_if->ctrl_if[vif_id]->wpa_s;
 }
 
+static struct ctrl_iface_priv *wpa_get_priv_from_wpa(struct wpa_supplicant *wpa_s)
+{
+	int i;
+
+	for (i = 0 ; global_ctrl_if && i < NRC_WPA_NUM_INTERFACES ; i++) {
+		if (global_ctrl_if->ctrl_if[i] && global_ctrl_if->ctrl_if[i]->wpa_s == wpa_s)
+			return global_ctrl_if->ctrl_if[i];
+	}
+	return NULL;
+}
+
 /***********************************************************************************************************/
 
 static SemaphoreHandle_t g_ctrl_if_lock = NULL;
@@ -334,6 +349,84 @@ void CTRL_IFACE_RESP_FREE (ctrl_iface_resp_t *resp)
 
 /***********************************************************************************************************/
 
+/*
+ * Connection phase timing. wpas_conn_time_start() is called right before a
+ * connection is requested, then every state change charges the time since
+ * the previous one to the phase being left until WPA_COMPLETED is reached.
+ */
+void wpas_conn_time_start(int vif_id)
+{
+	struct ctrl_iface_priv *priv;
+
+	if (vif_id < 0 || vif_id >= NRC_WPA_NUM_INTERFACES ||
+	    !global_ctrl_if || !global_ctrl_if->ctrl_if[vif_id])
+		return;
+
+	priv = global_ctrl_if->ctrl_if[vif_id];
+	os_memset(&priv->conn_time, 0, sizeof(priv->conn_time));
+	os_get_reltime(&priv->conn_phase);
+	priv->conn_timing = true;
+}
+
+bool wpas_conn_time_get(int vif_id, ctrl_iface_conn_time_t *time)
+{
+	if (vif_id < 0 || vif_id >= NRC_WPA_NUM_INTERFACES ||
+	    !global_ctrl_if || !global_ctrl_if->ctrl_if[vif_id])
+		return false;
+
+	*time = global_ctrl_if->ctrl_if[vif_id]->conn_time;
+	return time->done;
+}
+
+void wpas_conn_time_update(struct wpa_supplicant *wpa_s, int old_state, int new_state)
+{
+	struct ctrl_iface_priv *priv = wpa_get_priv_from_wpa(wpa_s);
+	ctrl_iface_conn_time_t *t;
+	struct os_reltime now, diff;
+	uint32_t ms;
+
+	if (!priv || !priv->conn_timing)
+		return;
+
+	t = &priv->conn_time;
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &priv->conn_phase, &diff);
+	priv->conn_phase = now;
+	ms = diff.sec * 1000 + diff.usec / 1000;
+
+	switch (old_state) {
+	case WPA_DISCONNECTED:
+	case WPA_INACTIVE:
+	case WPA_SCANNING:
+		t->scan_ms += ms;
+		break;
+	case WPA_AUTHENTICATING:
+		t->auth_ms += ms;
+		break;
+	case WPA_ASSOCIATING:
+		t->assoc_ms += ms;
+		break;
+	case WPA_ASSOCIATED:
+	case WPA_4WAY_HANDSHAKE:
+	case WPA_GROUP_HANDSHAKE:
+		t->key_ms += ms;
+		break;
+	default:
+		break;
+	}
+
+	if (new_state == WPA_SCANNING)
+		t->scans++;
+	else if (new_state == WPA_COMPLETED) {
+		if (wpa_s->current_bss)
+			t->beacon_int = wpa_s->current_bss->beacon_int;
+		t->done = true;
+		priv->conn_timing = false;
+	}
+}
+
+/***********************************************************************************************************/
+
 struct ctrl_iface_priv* wpa_supplicant_ctrl_iface_init(struct wpa_supplicant *wpa_s)
 {
 	struct ctrl_iface_priv* priv = NULL;
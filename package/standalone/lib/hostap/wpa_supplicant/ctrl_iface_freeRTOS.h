@@ -34,6 +34,18 @@ typedef struct
 #endif
 } ctrl_iface_recovery_t;
 
+/* Time spent in each phase of the last connection attempt */
+typedef struct
+{
+	uint32_t scan_ms;	/* scanning, including the waits between scans */
+	uint32_t auth_ms;	/* 0 if the driver authenticates within assoc */
+	uint32_t assoc_ms;
+	uint32_t key_ms;	/* 4-way and group handshakes */
+	uint16_t beacon_int;	/* of the BSS joined, in TU */
+	uint8_t scans;
+	bool done;
+} ctrl_iface_conn_time_t;
+
 int ctrl_iface_receive(int vif_id, char *cmd);
 int wpa_cmd_receive(int vif_id, int argc, char *argv[]);
 struct wpa_global * wpas_global_init(void);
@@ -45,6 +57,9 @@ int wpas_config_set(int vif_id, const char *name, char *value);
 int wpas_config_global_get(int vif_id, const char *name, char *buf, size_t buflen);
 int wpas_config_global_set(int vif_id, const char *name, char *value);
 void nrc_ps_get_rconf(ctrl_iface_recovery_t *config);
+void wpas_conn_time_start(int vif_id);
+bool wpas_conn_time_get(int vif_id, ctrl_iface_conn_time_t *time);
+void wpas_conn_time_update(struct wpa_supplicant *wpa_s, int old_state, int new_state);
 
 ctrl_iface_resp_t *ctrl_iface_receive_response(int vif_id, const char *fmt, ...);
 bool CTRL_IFACE_RESP_OK (ctrl_iface_resp_t *resp);
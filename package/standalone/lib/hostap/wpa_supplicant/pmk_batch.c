@@ -0,0 +1,664 @@
+/*
+ * WPA Supplicant - batch PMK generator for fleet provisioning
+ *
+ * Computes the WPA2-PSK PMK of every device in a manifest on the host and
+ * writes one NVS image per device for the USER_CONFIG_1 partition, so the
+ * devices find wifi_pmk in NVS and never run the 4096 PBKDF2-SHA1 iterations
+ * themselves. The manifest has one "device,ssid,passphrase[,country]" line
+ * per device; empty lines and lines starting with '#' are skipped.
+ *
+ * PMKs are computed several at a time, one per SIMD lane: 8 lanes with AVX2,
+ * 4 with SSE2 or any other 128-bit vector unit, each lane running the
+ * PBKDF2 chain of one (passphrase, ssid, block) with the HMAC key states
+ * precomputed. With -b it benchmarks PMKs/s of PBKDF2 with hmac_sha1() per
+ * iteration, of pbkdf2_sha1() with the cached key states, and of the lanes,
+ * checking all of them against each other and the IEEE 802.11 test vectors.
+ *
+ *   gcc -O3 -I../src -I../src/utils -DCONFIG_INTERNAL_SHA1 -DCONFIG_CRYPTO_INTERNAL \
+ *       -o pmk_batch pmk_batch.c ../src/crypto/sha1-pbkdf2.c ../src/crypto/sha1.c \
+ *       ../src/crypto/sha1-internal.c ../src/utils/common.c ../src/utils/os_unix.c \
+ *       ../src/utils/wpa_debug.c
+ *   ./pmk_batch [-o outdir] manifest.csv
+ *   ./pmk_batch -b [pmks]
+ *
+ * The images are flashed at USER_CONFIG_1: 0x3F7000 on 4 MB flash, 0xFA000
+ * on 2 MB flash.
+ */
+
+#include "includes.h"
+#include <time.h>
+
+#include "common.h"
+#include "crypto/sha1.h"
+#include "crypto/sha1_i.h"
+
+#define PMK_LEN			32
+#define PMK_ITERATIONS		4096
+#define PMK_MAX_LANES		8
+
+/* NVS layout of lib/nvs_flash, see nvs_page.hpp and nvs_types.hpp */
+#define NVS_PAGE_SIZE		4096
+#define NVS_PAGES		4
+#define NVS_ENTRY_SIZE		32
+#define NVS_ENTRY_COUNT		126
+#define NVS_ENTRY_TABLE_OFFSET	32
+#define NVS_ENTRY_DATA_OFFSET	64
+#define NVS_PAGE_ACTIVE		0xfffffffe
+#define NVS_VERSION		0xfd
+#define NVS_TYPE_U8		0x01
+#define NVS_TYPE_STR		0x21
+#define NVS_CHUNK_ANY		0xff
+#define NVS_KEY_SIZE		16
+#define NVS_NAMESPACE		"namespace"	/* NVS_DEFAULT_NAMESPACE */
+
+#define WIFI_SEC_WPA2		1
+
+
+struct pmk_job {
+	u32 inner[5];		/* state after the ipad key block */
+	u32 outer[5];		/* state after the opad key block */
+	u32 u[5];		/* U1, then Uc */
+	u32 t[5];		/* U1 xor ... xor Uc */
+};
+
+struct device {
+	char name[64];
+	char ssid[33];
+	char passphrase[64];
+	char country[3];
+	u8 pmk[PMK_LEN];
+	struct pmk_job job[2];	/* T1 and T2 of the PMK */
+};
+
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/* The PBKDF2 of sha1-pbkdf2.c before the key states were cached */
+static int pbkdf2_sha1_hmac(const char *passphrase, const u8 *ssid,
+			    size_t ssid_len, int iterations, u8 *buf,
+			    size_t buflen)
+{
+	unsigned int count = 0;
+	size_t passphrase_len = os_strlen(passphrase), plen;
+	u8 tmp[SHA1_MAC_LEN], digest[SHA1_MAC_LEN], count_buf[4];
+	const u8 *addr[2] = { ssid, count_buf };
+	size_t len[2] = { ssid_len, 4 };
+	int i, j;
+
+	while (buflen > 0) {
+		WPA_PUT_BE32(count_buf, ++count);
+		if (hmac_sha1_vector((const u8 *) passphrase, passphrase_len,
+				     2, addr, len, tmp))
+			return -1;
+		os_memcpy(digest, tmp, SHA1_MAC_LEN);
+		for (i = 1; i < iterations; i++) {
+			if (hmac_sha1((const u8 *) passphrase, passphrase_len,
+				      tmp, SHA1_MAC_LEN, tmp))
+				return -1;
+			for (j = 0; j < SHA1_MAC_LEN; j++)
+				digest[j] ^= tmp[j];
+		}
+		plen = buflen > SHA1_MAC_LEN ? SHA1_MAC_LEN : buflen;
+		os_memcpy(buf, digest, plen);
+		buf += plen;
+		buflen -= plen;
+	}
+	return 0;
+}
+
+
+static void sha1_key_state(u32 state[5], const char *passphrase, u8 pad)
+{
+	u8 block[64];
+	size_t i, len = os_strlen(passphrase);
+
+	os_memset(block, pad, sizeof(block));
+	for (i = 0; i < len; i++)
+		block[i] ^= passphrase[i];
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+	state[4] = 0xC3D2E1F0;
+	SHA1Transform(state, block);
+}
+
+
+/* Key states and U1 of block count of the PMK, the lanes do the rest */
+static void pmk_job_init(struct pmk_job *job, const char *passphrase,
+			 const char *ssid, unsigned int count)
+{
+	struct SHA1Context ctx;
+	u8 count_buf[4], digest[SHA1_MAC_LEN];
+	int i;
+
+	sha1_key_state(job->inner, passphrase, 0x36);
+	sha1_key_state(job->outer, passphrase, 0x5c);
+
+	WPA_PUT_BE32(count_buf, count);
+	os_memcpy(ctx.state, job->inner, sizeof(ctx.state));
+	ctx.count[0] = 64 * 8;
+	ctx.count[1] = 0;
+	SHA1Update(&ctx, ssid, os_strlen(ssid));
+	SHA1Update(&ctx, count_buf, 4);
+	SHA1Final(digest, &ctx);
+
+	os_memcpy(ctx.state, job->outer, sizeof(ctx.state));
+	ctx.count[0] = 64 * 8;
+	ctx.count[1] = 0;
+	SHA1Update(&ctx, digest, SHA1_MAC_LEN);
+	SHA1Final(digest, &ctx);
+
+	for (i = 0; i < 5; i++)
+		job->u[i] = job->t[i] = WPA_GET_BE32(digest + 4 * i);
+}
+
+
+/*
+ * SHA-1 compression of the 20 octet message in w[0..4], following a key
+ * block, on as many lanes as the vector type has. The GCC vector
+ * extensions compile this to SSE2 or AVX2 on x86 and NEON on ARM, and to
+ * plain scalar code elsewhere.
+ */
+#define VROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define SHA1_ROUND(f, k, i) do {					\
+		if ((i) >= 16)						\
+			w[(i) & 15] = VROL(w[((i) + 13) & 15] ^		\
+					   w[((i) + 8) & 15] ^		\
+					   w[((i) + 2) & 15] ^		\
+					   w[(i) & 15], 1);		\
+		t = VROL(a, 5) + (f) + e + (k) + w[(i) & 15];		\
+		e = d;							\
+		d = c;							\
+		c = VROL(b, 30);					\
+		b = a;							\
+		a = t;							\
+	} while (0)
+
+#define SHA1_COMPRESS(vec, state, msg, out) do {			\
+		vec w[16], a, b, c, d, e, t, zero = { 0 };		\
+		int i;							\
+		for (i = 0; i < 5; i++)					\
+			w[i] = (msg)[i];				\
+		w[5] = zero + 0x80000000;				\
+		for (i = 6; i < 15; i++)				\
+			w[i] = zero;					\
+		w[15] = zero + (64 + SHA1_MAC_LEN) * 8;			\
+		a = (state)[0];						\
+		b = (state)[1];						\
+		c = (state)[2];						\
+		d = (state)[3];						\
+		e = (state)[4];						\
+		for (i = 0; i < 20; i++)				\
+			SHA1_ROUND((b & (c ^ d)) ^ d, 0x5A827999, i);	\
+		for (; i < 40; i++)					\
+			SHA1_ROUND(b ^ c ^ d, 0x6ED9EBA1, i);		\
+		for (; i < 60; i++)					\
+			SHA1_ROUND((b & c) | (d & (b | c)), 0x8F1BBCDC, i); \
+		for (; i < 80; i++)					\
+			SHA1_ROUND(b ^ c ^ d, 0xCA62C1D6, i);		\
+		(out)[0] = (state)[0] + a;				\
+		(out)[1] = (state)[1] + b;				\
+		(out)[2] = (state)[2] + c;				\
+		(out)[3] = (state)[3] + d;				\
+		(out)[4] = (state)[4] + e;				\
+	} while (0)
+
+/* Lanes are transposed through plain arrays, as vec[k][l] == word[k][l] */
+#define PMK_LANES(name, vec, lanes, target)				\
+target static void name(struct pmk_job **job, int iterations)		\
+{									\
+	u32 words[4][5][lanes];						\
+	vec inner[5], outer[5], u[5], x[5];				\
+	int n, k, l;							\
+									\
+	for (k = 0; k < 5; k++)						\
+		for (l = 0; l < (lanes); l++) {				\
+			words[0][k][l] = job[l]->inner[k];		\
+			words[1][k][l] = job[l]->outer[k];		\
+			words[2][k][l] = job[l]->u[k];			\
+			words[3][k][l] = job[l]->t[k];			\
+		}							\
+	os_memcpy(inner, words[0], sizeof(inner));			\
+	os_memcpy(outer, words[1], sizeof(outer));			\
+	os_memcpy(u, words[2], sizeof(u));				\
+	os_memcpy(x, words[3], sizeof(x));				\
+	for (n = 1; n < iterations; n++) {				\
+		SHA1_COMPRESS(vec, inner, u, u);			\
+		SHA1_COMPRESS(vec, outer, u, u);			\
+		for (k = 0; k < 5; k++)					\
+			x[k] ^= u[k];					\
+	}								\
+	os_memcpy(words[2], u, sizeof(u));				\
+	os_memcpy(words[3], x, sizeof(x));				\
+	for (k = 0; k < 5; k++)						\
+		for (l = 0; l < (lanes); l++) {				\
+			job[l]->u[k] = words[2][k][l];			\
+			job[l]->t[k] = words[3][k][l];			\
+		}							\
+}
+
+typedef u32 u32x4 __attribute__((vector_size(16)));
+PMK_LANES(pmk_lanes4, u32x4, 4, )
+
+#if defined(__x86_64__) || defined(__i386__)
+typedef u32 u32x8 __attribute__((vector_size(32)));
+PMK_LANES(pmk_lanes8, u32x8, 8, __attribute__((target("avx2"))))
+#endif
+
+
+static int pmk_lanes(int force)
+{
+	if (force)
+		return force;
+#if defined(__x86_64__) || defined(__i386__)
+	if (__builtin_cpu_supports("avx2"))
+		return 8;
+#endif
+	return 4;
+}
+
+
+/* Runs all jobs through the widest lanes, padding the last batch */
+static void pmk_run_jobs(struct pmk_job **jobs, int n, int lanes)
+{
+	struct pmk_job spare[PMK_MAX_LANES], *batch[PMK_MAX_LANES];
+	int i, l;
+
+	for (i = 0; i < n; i += lanes) {
+		for (l = 0; l < lanes; l++) {
+			if (i + l < n) {
+				batch[l] = jobs[i + l];
+			} else {
+				spare[l] = *jobs[i];
+				batch[l] = &spare[l];
+			}
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		if (lanes == 8) {
+			pmk_lanes8(batch, PMK_ITERATIONS);
+			continue;
+		}
+#endif
+		pmk_lanes4(batch, PMK_ITERATIONS);
+	}
+}
+
+
+static void pmk_generate(struct device *dev, int n, int lanes)
+{
+	struct pmk_job **jobs = os_malloc(2 * n * sizeof(*jobs));
+	int i, k;
+
+	for (i = 0; i < n; i++) {
+		for (k = 0; k < 2; k++) {
+			pmk_job_init(&dev[i].job[k], dev[i].passphrase,
+				     dev[i].ssid, k + 1);
+			jobs[2 * i + k] = &dev[i].job[k];
+		}
+	}
+	pmk_run_jobs(jobs, 2 * n, lanes);
+	for (i = 0; i < n; i++) {
+		for (k = 0; k < 5; k++) {
+			WPA_PUT_BE32(dev[i].pmk + 4 * k, dev[i].job[0].t[k]);
+			if (k < 3)
+				WPA_PUT_BE32(dev[i].pmk + SHA1_MAC_LEN + 4 * k,
+					     dev[i].job[1].t[k]);
+		}
+	}
+	os_free(jobs);
+}
+
+
+static u32 crc32(const u8 *data, size_t len)
+{
+	u32 crc = 0xffffffff;
+	int k;
+
+	while (len--) {
+		crc ^= *data++;
+		for (k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+
+struct nvs_image {
+	u8 flash[NVS_PAGES * NVS_PAGE_SIZE];
+	int entry;
+};
+
+
+static void nvs_image_init(struct nvs_image *img)
+{
+	u8 *page = img->flash;
+
+	os_memset(img->flash, 0xff, sizeof(img->flash));
+	WPA_PUT_LE32(page, NVS_PAGE_ACTIVE);
+	WPA_PUT_LE32(page + 4, 0);		/* sequence number */
+	page[8] = NVS_VERSION;
+	WPA_PUT_LE32(page + 28, crc32(page + 4, 24));
+	img->entry = 0;
+}
+
+
+/* Writes an item and its data entries, marking all of them written */
+static int nvs_image_item(struct nvs_image *img, u8 ns, u8 type,
+			  const char *key, const u8 *data, const u8 *extra,
+			  size_t extra_len)
+{
+	u8 *page = img->flash;
+	u8 *item = page + NVS_ENTRY_DATA_OFFSET + img->entry * NVS_ENTRY_SIZE;
+	int span = 1 + (extra_len + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE;
+	int i;
+
+	if (os_strlen(key) >= NVS_KEY_SIZE ||
+	    img->entry + span > NVS_ENTRY_COUNT)
+		return -1;
+
+	item[0] = ns;
+	item[1] = type;
+	item[2] = span;
+	item[3] = NVS_CHUNK_ANY;
+	os_memset(item + 8, 0, NVS_KEY_SIZE);
+	os_memcpy(item + 8, key, os_strlen(key));
+	os_memcpy(item + 24, data, 8);
+	/* lib/nvs_flash covers only the data field by the item CRC */
+	WPA_PUT_LE32(item + 4, crc32(item + 24, 8));
+	os_memcpy(item + NVS_ENTRY_SIZE, extra, extra_len);
+
+	for (i = img->entry; i < img->entry + span; i++) {
+		u8 *word = page + NVS_ENTRY_TABLE_OFFSET + i / 16 * 4;
+
+		/* EMPTY 0b11 -> WRITTEN 0b10 */
+		WPA_PUT_LE32(word, WPA_GET_LE32(word) & ~(1 << (i % 16 * 2)));
+	}
+	img->entry += span;
+	return 0;
+}
+
+
+static int nvs_image_u8(struct nvs_image *img, u8 ns, const char *key,
+			u8 value)
+{
+	u8 data[8];
+
+	os_memset(data, 0xff, sizeof(data));
+	data[0] = value;
+	return nvs_image_item(img, ns, NVS_TYPE_U8, key, data, NULL, 0);
+}
+
+
+static int nvs_image_str(struct nvs_image *img, u8 ns, const char *key,
+			 const char *value)
+{
+	size_t size = os_strlen(value) + 1;
+	u8 data[8];
+
+	WPA_PUT_LE16(data, size);
+	WPA_PUT_LE16(data + 2, 0xffff);
+	WPA_PUT_LE32(data + 4, crc32((const u8 *) value, size));
+	return nvs_image_item(img, ns, NVS_TYPE_STR, key, data,
+			      (const u8 *) value, size);
+}
+
+
+/* The keys of sdk/apps/wifi_common/nvs_config.h for a WPA2-PSK station */
+static int write_image(const struct device *dev, const char *dir)
+{
+	struct nvs_image *img = os_malloc(sizeof(*img));
+	char path[512], pmk[2 * PMK_LEN + 1];
+	FILE *f;
+	int ret = 0;
+
+	wpa_snprintf_hex(pmk, sizeof(pmk), dev->pmk, PMK_LEN);
+	nvs_image_init(img);
+	ret |= nvs_image_u8(img, 0, NVS_NAMESPACE, 1);
+	ret |= nvs_image_u8(img, 1, "cfg_written", 1);
+	ret |= nvs_image_str(img, 1, "ssid", dev->ssid);
+	ret |= nvs_image_u8(img, 1, "wifi_security", WIFI_SEC_WPA2);
+	ret |= nvs_image_str(img, 1, "wifi_password", dev->passphrase);
+	ret |= nvs_image_str(img, 1, "wifi_pmk", pmk);
+	ret |= nvs_image_str(img, 1, "wifi_pmk_ssid", dev->ssid);
+	ret |= nvs_image_str(img, 1, "wifi_pmk_pw", dev->passphrase);
+	if (dev->country[0])
+		ret |= nvs_image_str(img, 1, "country", dev->country);
+
+	os_snprintf(path, sizeof(path), "%s/%s.bin", dir, dev->name);
+	f = fopen(path, "wb");
+	if (ret || !f || fwrite(img->flash, sizeof(img->flash), 1, f) != 1) {
+		fprintf(stderr, "%s: can't write %s\n", dev->name, path);
+		ret = -1;
+	}
+	if (f)
+		fclose(f);
+	os_free(img);
+	return ret;
+}
+
+
+static int parse_device(struct device *dev, char *line, int lineno)
+{
+	char *field[4] = { NULL, NULL, NULL, NULL }, *pos = line;
+	size_t len;
+	int n = 0;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	while (n < 4 && pos) {
+		field[n++] = pos;
+		pos = os_strchr(pos, ',');
+		if (pos)
+			*pos++ = '\0';
+	}
+	if (n < 3 || pos) {
+		fprintf(stderr, "line %d: expected device,ssid,passphrase[,country]\n",
+			lineno);
+		return -1;
+	}
+
+	os_memset(dev, 0, sizeof(*dev));
+	len = os_strlen(field[2]);
+	if (!field[0][0] || os_strchr(field[0], '/') ||
+	    os_strlen(field[0]) >= sizeof(dev->name) ||
+	    !field[1][0] || os_strlen(field[1]) >= sizeof(dev->ssid) ||
+	    len < 8 || len > 63 || has_ctrl_char((u8 *) field[2], len) ||
+	    (field[3] && os_strlen(field[3]) != 2)) {
+		fprintf(stderr, "line %d: invalid device, SSID, passphrase (8..63 characters) or country\n",
+			lineno);
+		return -1;
+	}
+	os_strlcpy(dev->name, field[0], sizeof(dev->name));
+	os_strlcpy(dev->ssid, field[1], sizeof(dev->ssid));
+	os_strlcpy(dev->passphrase, field[2], sizeof(dev->passphrase));
+	if (field[3])
+		os_strlcpy(dev->country, field[3], sizeof(dev->country));
+	return 0;
+}
+
+
+static int provision(const char *manifest, const char *dir, int lanes)
+{
+	struct device *dev = NULL;
+	char line[256], pmk[2 * PMK_LEN + 1];
+	int n = 0, size = 0, lineno = 0, i, fails = 0;
+	FILE *f = fopen(manifest, "r");
+	double t;
+
+	if (!f) {
+		fprintf(stderr, "can't open %s\n", manifest);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		lineno++;
+		if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+			continue;
+		if (n == size) {
+			size = size ? 2 * size : 64;
+			dev = os_realloc_array(dev, size, sizeof(*dev));
+		}
+		if (parse_device(&dev[n], line, lineno) == 0)
+			n++;
+		else
+			fails++;
+	}
+	fclose(f);
+
+	t = now();
+	pmk_generate(dev, n, lanes);
+	t = now() - t;
+
+	for (i = 0; i < n; i++) {
+		wpa_snprintf_hex(pmk, sizeof(pmk), dev[i].pmk, PMK_LEN);
+		printf("%s\t%s\t%s\n", dev[i].name, dev[i].ssid, pmk);
+		fails += write_image(&dev[i], dir) != 0;
+	}
+	fprintf(stderr, "# %d PMKs in %.3f s on %d lanes, %d errors\n",
+		n, t, lanes, fails);
+	os_free(dev);
+	return fails ? 1 : 0;
+}
+
+
+static const struct {
+	const char *passphrase, *ssid, *pmk;
+} vectors[] = {
+	/* IEEE Std 802.11-2016, J.4.2 */
+	{ "password", "IEEE",
+	  "f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e" },
+	{ "ThisIsAPassword", "ThisIsASSID",
+	  "0dc0d6eb90555ed6419756b9a15ec3e3209b63df707dd508d14581f8982721af" },
+	{ "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", "ZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZ",
+	  "becb93866bb8c3832cb777c2f559807c8c59afcb6eae734885001300a981cc62" },
+};
+
+
+static int bench(int n)
+{
+	struct device *dev = os_calloc(n, sizeof(*dev));
+	u8 (*ref)[PMK_LEN] = os_calloc(n, PMK_LEN);
+	u8 pmk[PMK_LEN], expect[PMK_LEN];
+	int i, v, lanes[] = { 4, 8 }, fails = 0;
+	double t, base;
+
+	for (i = 0; i < n; i++) {
+		v = i % ARRAY_SIZE(vectors);
+		if (i < (int) ARRAY_SIZE(vectors)) {
+			os_strlcpy(dev[i].ssid, vectors[v].ssid, sizeof(dev[i].ssid));
+			os_strlcpy(dev[i].passphrase, vectors[v].passphrase,
+				   sizeof(dev[i].passphrase));
+		} else {
+			os_snprintf(dev[i].ssid, sizeof(dev[i].ssid), "halow-%d", i % 7);
+			os_snprintf(dev[i].passphrase, sizeof(dev[i].passphrase),
+				    "fleet-passphrase-%08x", i * 2654435761u);
+		}
+	}
+
+	printf("%-34s %10s %8s\n", "PBKDF2-SHA1, 4096 iterations", "PMKs/s", "speedup");
+
+	t = now();
+	for (i = 0; i < n; i++)
+		pbkdf2_sha1_hmac(dev[i].passphrase, (u8 *) dev[i].ssid,
+				 os_strlen(dev[i].ssid), PMK_ITERATIONS, ref[i], PMK_LEN);
+	base = n / (now() - t);
+	printf("%-34s %10.1f %8.2f\n", "hmac_sha1() per iteration", base, 1.0);
+
+	for (v = 0; v < (int) ARRAY_SIZE(vectors) && v < n; v++) {
+		hexstr2bin(vectors[v].pmk, expect, PMK_LEN);
+		if (os_memcmp(ref[v], expect, PMK_LEN) != 0) {
+			printf("MISMATCH test vector %d\n", v);
+			fails++;
+		}
+	}
+
+	t = now();
+	for (i = 0; i < n; i++) {
+		pbkdf2_sha1(dev[i].passphrase, (u8 *) dev[i].ssid,
+			    os_strlen(dev[i].ssid), PMK_ITERATIONS, pmk, PMK_LEN);
+		if (os_memcmp(pmk, ref[i], PMK_LEN) != 0) {
+			printf("MISMATCH pbkdf2_sha1() PMK %d\n", i);
+			fails++;
+		}
+	}
+	t = n / (now() - t);
+	printf("%-34s %10.1f %8.2f\n", "pbkdf2_sha1(), cached key states", t, t / base);
+
+	for (v = 0; v < (int) ARRAY_SIZE(lanes); v++) {
+		char name[64];
+
+		if (lanes[v] == 8 && pmk_lanes(0) < 8)
+			continue;
+		for (i = 0; i < n; i++)
+			os_memset(dev[i].pmk, 0, PMK_LEN);
+		t = now();
+		pmk_generate(dev, n, lanes[v]);
+		t = n / (now() - t);
+		for (i = 0; i < n; i++) {
+			if (os_memcmp(dev[i].pmk, ref[i], PMK_LEN) != 0) {
+				printf("MISMATCH %d lanes PMK %d\n", lanes[v], i);
+				fails++;
+			}
+		}
+		os_snprintf(name, sizeof(name), "%d lanes, cached key states", lanes[v]);
+		printf("%-34s %10.1f %8.2f\n", name, t, t / base);
+	}
+
+	os_free(dev);
+	os_free(ref);
+	return fails ? 1 : 0;
+}
+
+
+static void usage(void)
+{
+	printf("usage: pmk_batch [-o <outdir>] [-l <4|8>] <manifest.csv>\n"
+	       "       pmk_batch -b [pmks]\n"
+	       "\nmanifest lines: device,ssid,passphrase[,country]\n"
+	       "writes <outdir>/<device>.bin, an NVS image of the USER_CONFIG_1 "
+	       "partition\n(0x3F7000 on 4 MB flash, 0xFA000 on 2 MB flash), "
+	       "and prints device, SSID and PMK\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	const char *dir = ".";
+	int c, lanes = 0;
+
+	while ((c = getopt(argc, argv, "bhl:o:")) != -1) {
+		switch (c) {
+		case 'b':
+			return bench(optind < argc ? atoi(argv[optind]) : 64);
+		case 'l':
+			lanes = atoi(optarg);
+			if (lanes != 4 && lanes != 8) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'o':
+			dir = optarg;
+			break;
+		default:
+			usage();
+			return c == 'h' ? 0 : 1;
+		}
+	}
+	if (optind >= argc) {
+		usage();
+		return 1;
+	}
+	if (lanes == 8 && pmk_lanes(0) < 8) {
+		fprintf(stderr, "8 lanes need AVX2\n");
+		return 1;
+	}
+	return provision(argv[optind], dir, pmk_lanes(lanes));
+}
@@ -126,6 +126,9 @@ static void wpa_bss_tmp_disallow_timeout(void *eloop_ctx, void *timeout_ctx);
 #if defined(CONFIG_FILS) && defined(IEEE8021X_EAPOL)
 static void wpas_update_fils_connect_params(struct wpa_supplicant *wpa_s);
 #endif /* CONFIG_FILS && IEEE8021X_EAPOL */
+#if defined(NRC_WPA_SUPP)
+#include "ctrl_iface_freeRTOS.h"
+#endif
 #ifdef CONFIG_OWE
 #if defined(NRC_WPA_SUPP)
 #include "driver_nrc_ps.h"
@@ -948,6 +951,11 @@ void wpa_supplicant_set_state(struct wpa_supplicant *wpa_s,
 		wpas_notify_roam_complete(wpa_s);
 	}
 
+#if defined(NRC_WPA_SUPP)
+	if (state != old_state)
+		wpas_conn_time_update(wpa_s, old_state, state);
+#endif /* NRC_WPA_SUPP */
+
 	if (state == WPA_INTERFACE_DISABLED) {
 		/* Assure normal scan when interface is restored */
 		wpa_s->normal_scans = 0;
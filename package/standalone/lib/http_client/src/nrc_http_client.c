@@ -67,6 +67,9 @@ typedef struct {
 #include "mbedtls/entropy.h"
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/debug.h"
+#include "tls_session_cache.h"
+#include "tls_cert_store.h"
+#include "tls_max_frag.h"
 
 typedef struct {
 	mbedtls_ssl_context ssl_ctx;        /* mbedtls ssl context */
@@ -75,9 +78,15 @@ typedef struct {
 	mbedtls_entropy_context entropy;
 	mbedtls_ctr_drbg_context ctr_drbg;
 	mbedtls_x509_crt_profile profile;
+#if defined(NRC_TLS_CERT_STORE)
+	mbedtls_x509_crt *cacert;           /* shared, see tls_cert_store.h */
+	mbedtls_x509_crt *clicert;
+	mbedtls_pk_context *pkey;
+#else
 	mbedtls_x509_crt cacert;
 	mbedtls_x509_crt clicert;
 	mbedtls_pk_context pkey;
+#endif
 } http_ssl_t;
 
 /** This macro defines the deault HTTPS port.  */
@@ -293,6 +302,7 @@ static int httpc_ssl_conn(con_handle_t *handle, http_info_t *info, ssl_certs_t *
 	const char *pers = "httpc_ssl";
 	http_ssl_t *http_ssl = NULL;
 	uint32_t flags;
+	int resume = 0;
 	int ret = 0;
 
 	http_ssl = (http_ssl_t*)nrc_mem_malloc(sizeof(http_ssl_t));
@@ -315,9 +325,11 @@ static int httpc_ssl_conn(con_handle_t *handle, http_info_t *info, ssl_certs_t *
 	mbedtls_net_init( &http_ssl->net_ctx );
 	mbedtls_ssl_init( &http_ssl->ssl_ctx );
 	mbedtls_ssl_config_init( &http_ssl->ssl_conf );
+#if !defined(NRC_TLS_CERT_STORE)
 	mbedtls_x509_crt_init( &http_ssl->cacert );
 	mbedtls_x509_crt_init( &http_ssl->clicert );
 	mbedtls_pk_init( &http_ssl->pkey );
+#endif
 	mbedtls_ctr_drbg_init( &http_ssl->ctr_drbg );
 
 	HTTPC_LOGD( "  . Seeding the random number generator..." );
@@ -334,6 +346,41 @@ static int httpc_ssl_conn(con_handle_t *handle, http_info_t *info, ssl_certs_t *
 	/*
 	 * 0. Initialize certificates
 	 */
+#if defined(NRC_TLS_CERT_STORE)
+	/* parsed by the first connection, shared with the others */
+	HTTPC_LOGD( "  . Loading the CA root certificate ..." );
+
+	http_ssl->cacert = tls_cert_store_get_crt( (const unsigned char *) certs->ca_cert,
+											   certs->ca_cert_length, &ret );
+	if( http_ssl->cacert == NULL ) {
+		HTTPC_LOGE(" failed\n  !  mbedtls_x509_crt_parse returned -0x%x while parsing root cert", -ret);
+		goto exit;
+	}
+
+	HTTPC_LOGD( " ok" );
+
+	HTTPC_LOGD( "  . Loading the Client certificate ..." );
+
+	http_ssl->clicert = tls_cert_store_get_crt( (const unsigned char *) certs->client_cert,
+												certs->client_cert_length, &ret );
+	if( http_ssl->clicert == NULL ) {
+		HTTPC_LOGE(" failed\n  !  mbedtls_x509_crt_parse returned -0x%x while parsing device cert", -ret);
+		goto exit;
+	}
+
+	HTTPC_LOGD( " ok" );
+
+	HTTPC_LOGD( "  . Loading the Client private key ..." );
+
+	http_ssl->pkey = tls_cert_store_get_key( (const unsigned char *) certs->client_pk,
+											 certs->client_pk_length, NULL, 0, &ret );
+	if( http_ssl->pkey == NULL ) {
+		HTTPC_LOGE(" failed\n  !  mbedtls_pk_parse_key returned -0x%x while parsing private key\n\n", -ret);
+		goto exit;
+	}
+
+	HTTPC_LOGD( " ok" );
+#else
 	HTTPC_LOGD( "  . Loading the CA root certificate ..." );
 
 	ret = mbedtls_x509_crt_parse( &http_ssl->cacert, (const unsigned char *) certs->ca_cert,
@@ -366,6 +413,7 @@ static int httpc_ssl_conn(con_handle_t *handle, http_info_t *info, ssl_certs_t *
 	}
 
 	HTTPC_LOGD( " ok (%d skipped)", ret );
+#endif /* NRC_TLS_CERT_STORE */
 
 	/*
 	 * 1. Start the connection
@@ -398,11 +446,20 @@ static int httpc_ssl_conn(con_handle_t *handle, http_info_t *info, ssl_certs_t *
 	/* OPTIONAL is not optimal for security,
 	 * but makes interop easier in this simplified example */
 	mbedtls_ssl_conf_authmode( &http_ssl->ssl_conf, MBEDTLS_SSL_VERIFY_OPTIONAL );
+#if defined(NRC_TLS_CERT_STORE)
+	mbedtls_ssl_conf_ca_chain( &http_ssl->ssl_conf, http_ssl->cacert, NULL );
+	mbedtls_ssl_conf_own_cert( &http_ssl->ssl_conf, http_ssl->clicert, http_ssl->pkey);
+#else
 	mbedtls_ssl_conf_ca_chain( &http_ssl->ssl_conf, &http_ssl->cacert, NULL );
 	mbedtls_ssl_conf_own_cert( &http_ssl->ssl_conf, &http_ssl->clicert, &http_ssl->pkey);
+#endif
 	mbedtls_ssl_conf_rng( &http_ssl->ssl_conf, mbedtls_ctr_drbg_random, &http_ssl->ctr_drbg );
 	mbedtls_ssl_conf_dbg( &http_ssl->ssl_conf, httpc_debug, stdout );
 	mbedtls_ssl_conf_read_timeout( &http_ssl->ssl_conf, HTTP_SSL_READ_TIMEOUT);
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+	/* the record size set with tls_max_frag_set() */
+	tls_max_frag_conf( &http_ssl->ssl_conf );
+#endif
 
 	HTTPC_LOGD( "  . Setting up SSL..." );
 	if( ( ret = mbedtls_ssl_setup( &http_ssl->ssl_ctx, &http_ssl->ssl_conf ) ) != 0 ) {
@@ -422,30 +479,52 @@ static int httpc_ssl_conn(con_handle_t *handle, http_info_t *info, ssl_certs_t *
 
 	mbedtls_ssl_set_bio( &http_ssl->ssl_ctx, &http_ssl->net_ctx, mbedtls_net_send, mbedtls_net_recv, mbedtls_net_recv_timeout );
 
+#if defined(NRC_TLS_SESSION_CACHE)
+	/* resume the last session with this server, if any */
+	resume = ( tls_session_cache_set( &http_ssl->ssl_ctx, info->host, atoi( info->port ) ) == 0 );
+#endif
+
 	/*
 	 * 4. Handshake
 	 */
-	HTTPC_LOGD( "  . Performing the SSL/TLS handshake..." );
+	HTTPC_LOGD( "  . Performing the SSL/TLS handshake%s...", resume ? " (resuming)" : "" );
 
 	while( ( ret = mbedtls_ssl_handshake( &http_ssl->ssl_ctx ) ) != 0 ) {
 		if( ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE ) {
 			HTTPC_LOGE(" failed\n  ! mbedtls_ssl_handshake returned -0x%x\n", -ret );
+#if defined(NRC_TLS_SESSION_CACHE)
+			if( resume )
+				tls_session_cache_remove( info->host, atoi( info->port ) );
+#endif
 			goto exit;
 		}
 	}
 
 	HTTPC_LOGD( " ok\n    [ Protocol is %s ]\n    [ Ciphersuite is %s ]",
 			mbedtls_ssl_get_version( &http_ssl->ssl_ctx ),
-			mbedtls_ssl_get_ciphersuite( &http_ssl->ssl_ctx ));
+			mbedtls_ssl_get_ciphersuite( &http_ssl->ssl_ctx ) );
 
 	/*
 	 * 5. Verify the server certificate
 	 */
+	flags = mbedtls_ssl_get_verify_result( &http_ssl->ssl_ctx );
+
+#if defined(NRC_TLS_SESSION_CACHE)
+	/* VERIFY_OPTIONAL lets the handshake through: only a server that
+	 * passed the check gets its session kept and resumed */
+	if( flags != 0 ) {
+		tls_session_cache_remove( info->host, atoi( info->port ) );
+	} else {
+		resume = tls_session_cache_update( &http_ssl->ssl_ctx, info->host, atoi( info->port ) );
+		HTTPC_LOGD( "    [ Session %s ]", resume ? "resumed" : "established" );
+	}
+#endif
+
 #ifdef VERIFY_SERVER_CERT
 	HTTPC_LOGD( "  . Verifying peer X.509 certificate..." );
 
 	/* In real life, we probably want to bail out when ret != 0 */
-	if( ( flags = mbedtls_ssl_get_verify_result( &http_ssl->ssl_ctx ) ) != 0 ) {
+	if( flags != 0 ) {
 		char vrfy_buf[512];
 
 		HTTPC_LOGE(" failed" );
@@ -472,9 +551,15 @@ static int httpc_ssl_close(con_handle_t *ssl_handle)
 
 	mbedtls_net_free( &http_ssl->net_ctx );
 
+#if defined(NRC_TLS_CERT_STORE)
+	tls_cert_store_put_crt( http_ssl->cacert );
+	tls_cert_store_put_crt( http_ssl->clicert );
+	tls_cert_store_put_key( http_ssl->pkey );
+#else
 	mbedtls_x509_crt_free( &http_ssl->cacert );
 	mbedtls_x509_crt_free( &http_ssl->clicert );
 	mbedtls_pk_free( &http_ssl->pkey );
+#endif
 	mbedtls_ssl_free( &http_ssl->ssl_ctx );
 	mbedtls_ssl_config_free( &http_ssl->ssl_conf );
 	mbedtls_ctr_drbg_free( &http_ssl->ctr_drbg );
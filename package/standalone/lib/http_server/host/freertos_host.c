@@ -0,0 +1,231 @@
+/*
+ * Host build of the http_server component: tasks, queues and
+ * counting semaphores of FreeRTOS over POSIX threads, and strlcpy()
+ * which newlib has and glibc lacks
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+struct QueueDefinition {
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+	UBaseType_t length;
+	UBaseType_t item_size;
+	UBaseType_t count;
+	UBaseType_t head;
+	uint8_t *items;
+};
+
+struct task_start {
+	TaskFunction_t code;
+	void *param;
+};
+
+static pthread_mutex_t critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static void *task_entry(void *arg)
+{
+	struct task_start start = *(struct task_start *) arg;
+
+	free(arg);
+	start.code(start.param);
+	return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack_depth,
+		       void *param, UBaseType_t priority, TaskHandle_t *created)
+{
+	struct task_start *start = malloc(sizeof(*start));
+	pthread_attr_t attr;
+	pthread_t thread;
+	int ret;
+
+	if (!start)
+		return pdFAIL;
+	start->code = code;
+	start->param = param;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	ret = pthread_create(&thread, &attr, task_entry, start);
+	pthread_attr_destroy(&attr);
+	if (ret != 0) {
+		free(start);
+		return pdFAIL;
+	}
+	if (created)
+		*created = (TaskHandle_t) thread;
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	/* Only self delete is supported */
+	pthread_exit(NULL);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return (TaskHandle_t) pthread_self();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	usleep((useconds_t) ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (TickType_t) (ts.tv_sec * 1000 + ts.tv_nsec / 1000000) / portTICK_PERIOD_MS;
+}
+
+void vTaskEnterCritical(void)
+{
+	pthread_mutex_lock(&critical);
+}
+
+void vTaskExitCritical(void)
+{
+	pthread_mutex_unlock(&critical);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+	QueueHandle_t q = calloc(1, sizeof(*q));
+
+	if (!q)
+		return NULL;
+	if (item_size) {
+		q->items = malloc(length * item_size);
+		if (!q->items) {
+			free(q);
+			return NULL;
+		}
+	}
+	q->length = length;
+	q->item_size = item_size;
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->not_empty, NULL);
+	pthread_cond_init(&q->not_full, NULL);
+	return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+	pthread_cond_destroy(&q->not_full);
+	pthread_cond_destroy(&q->not_empty);
+	pthread_mutex_destroy(&q->lock);
+	free(q->items);
+	free(q);
+}
+
+/* Waits for an item (or a free slot if full) for up to wait ticks, called locked */
+static int queue_wait(QueueHandle_t q, pthread_cond_t *cond, TickType_t wait, int full)
+{
+	struct timespec deadline;
+
+	if (wait != portMAX_DELAY) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += wait * portTICK_PERIOD_MS / 1000;
+		deadline.tv_nsec += (long) (wait * portTICK_PERIOD_MS % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	while (full ? q->count == q->length : q->count == 0) {
+		if (wait == 0)
+			return 0;
+		if (wait == portMAX_DELAY)
+			pthread_cond_wait(cond, &q->lock);
+		else if (pthread_cond_timedwait(cond, &q->lock, &deadline) != 0)
+			return !(full ? q->count == q->length : q->count == 0);
+	}
+	return 1;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+	pthread_mutex_lock(&q->lock);
+	if (!queue_wait(q, &q->not_full, wait, 1)) {
+		pthread_mutex_unlock(&q->lock);
+		return pdFALSE;
+	}
+	if (q->item_size)
+		memcpy(q->items + (q->head + q->count) % q->length * q->item_size, item, q->item_size);
+	q->count++;
+	pthread_cond_signal(&q->not_empty);
+	pthread_mutex_unlock(&q->lock);
+	return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+	pthread_mutex_lock(&q->lock);
+	if (!queue_wait(q, &q->not_empty, wait, 0)) {
+		pthread_mutex_unlock(&q->lock);
+		return pdFALSE;
+	}
+	if (q->item_size)
+		memcpy(item, q->items + q->head * q->item_size, q->item_size);
+	q->head = (q->head + 1) % q->length;
+	q->count--;
+	pthread_cond_signal(&q->not_full);
+	pthread_mutex_unlock(&q->lock);
+	return pdTRUE;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+	UBaseType_t spaces;
+
+	pthread_mutex_lock(&q->lock);
+	spaces = q->length - q->count;
+	pthread_mutex_unlock(&q->lock);
+	return spaces;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+	UBaseType_t count;
+
+	pthread_mutex_lock(&q->lock);
+	count = q->count;
+	pthread_mutex_unlock(&q->lock);
+	return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+	QueueHandle_t q = xQueueCreate(max, 0);
+
+	if (q)
+		q->count = initial;
+	return q;
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+	size_t len = strlen(src);
+
+	if (size) {
+		size_t n = len < size - 1 ? len : size - 1;
+		memcpy(dst, src, n);
+		dst[n] = '\0';
+	}
+	return len;
+}
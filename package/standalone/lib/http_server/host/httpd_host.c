@@ -0,0 +1,102 @@
+/*
+ * Host build of the http_server component serving a few endpoints, to
+ * be loaded with loadgen (or script/httpd_loadgen.py):
+ *
+ *   GET /hello   short response from the server task
+ *   GET /slow    response after a 5 ms wait, on an async worker if any
+ *
+ *   ./httpd_host [-p port] [-n sessions] [-b recv_buf_size]
+ *                [-q max_pipelined_reqs] [-w async_workers]
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <esp_http_server.h>
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig)
+{
+	stop = 1;
+}
+
+static esp_err_t hello_handler(httpd_req_t *req)
+{
+	httpd_resp_set_type(req, "text/plain");
+	return httpd_resp_send(req, "Hello World!", HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t slow_handler(httpd_req_t *req)
+{
+	/* Stands in for a sensor read or a flash access */
+	usleep(5000);
+	httpd_resp_set_type(req, "text/plain");
+	return httpd_resp_send(req, "Hello slowly!", HTTPD_RESP_USE_STRLEN);
+}
+
+int main(int argc, char *argv[])
+{
+	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+	httpd_handle_t server = NULL;
+	int opt;
+
+	config.server_port = 8080;
+	config.max_open_sockets = 40;
+	config.backlog_conn = 32;
+	config.lru_purge_enable = true;
+
+	while ((opt = getopt(argc, argv, "p:n:b:q:w:")) != -1) {
+		switch (opt) {
+		case 'p':
+			config.server_port = atoi(optarg);
+			break;
+		case 'n':
+			config.max_open_sockets = atoi(optarg);
+			break;
+		case 'b':
+			config.recv_buf_size = atoi(optarg);
+			break;
+		case 'q':
+			config.max_pipelined_reqs = atoi(optarg);
+			break;
+		case 'w':
+			config.async_workers = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-p port] [-n sessions] [-b recv_buf_size] "
+				"[-q max_pipelined_reqs] [-w async_workers]\n", argv[0]);
+			return 1;
+		}
+	}
+	config.ctrl_port = config.server_port + 1;
+
+	const httpd_uri_t uris[] = {
+		{ .uri = "/hello", .method = HTTP_GET, .handler = hello_handler },
+		{ .uri = "/slow", .method = HTTP_GET, .handler = slow_handler, .is_async = true },
+	};
+
+	if (httpd_start(&server, &config) != ESP_OK) {
+		fprintf(stderr, "httpd_start failed\n");
+		return 1;
+	}
+	for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+		httpd_register_uri_handler(server, &uris[i]);
+	}
+	printf("listening on port %d, %d sessions, recv_buf_size %d, %d pipelined, %d async workers\n",
+	       config.server_port, config.max_open_sockets, config.recv_buf_size,
+	       config.max_pipelined_reqs, config.async_workers);
+	fflush(stdout);
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	signal(SIGPIPE, SIG_IGN);
+	while (!stop) {
+		pause();
+	}
+
+	httpd_stop(server);
+	return 0;
+}
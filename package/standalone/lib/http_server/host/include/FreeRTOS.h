@@ -0,0 +1,35 @@
+/*
+ * Host build of the http_server component: the subset of the FreeRTOS
+ * API the server uses, implemented over POSIX threads in freertos_host.c
+ */
+
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE			((BaseType_t) 0)
+#define pdTRUE			((BaseType_t) 1)
+#define pdPASS			pdTRUE
+#define pdFAIL			pdFALSE
+
+#define portMAX_DELAY		((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS	((TickType_t) 1)
+#define pdMS_TO_TICKS(ms)	((TickType_t) (ms))
+
+#define tskIDLE_PRIORITY	((UBaseType_t) 0)
+#define configMAX_PRIORITIES	32
+#define NRC_TASK_PRIORITY	(configMAX_PRIORITIES - 2)
+#define configASSERT(x)		do { if (!(x)) abort(); } while (0)
+
+#define pvPortMalloc		malloc
+#define vPortFree		free
+#define pvPortCalloc		calloc
+
+#endif /* _HOST_FREERTOS_H_ */
@@ -0,0 +1,34 @@
+/*
+ * Host build of the http_server component: the lwIP socket API
+ * is the BSD one, so the host sockets stand in for it
+ */
+
+#ifndef _HOST_LWIP_SOCKETS_H_
+#define _HOST_LWIP_SOCKETS_H_
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+
+/* TCP sockets, 10 or 20 in lwipopts.h of the device.
+ * The host has plenty, so load tests are not capped by it */
+#ifndef MEMP_NUM_TCP_PCB
+#define MEMP_NUM_TCP_PCB	256
+#endif
+
+#ifndef CONFIG_LWIP_UDP_RECVMBOX_SIZE
+#define CONFIG_LWIP_UDP_RECVMBOX_SIZE	6
+#endif
+
+/* newlib has it, glibc only from 2.38 */
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+#endif /* _HOST_LWIP_SOCKETS_H_ */
@@ -0,0 +1,15 @@
+#ifndef _HOST_SEMPHR_H_
+#define _HOST_SEMPHR_H_
+
+#include "queue.h"
+
+/* Counting semaphores are queues of zero sized items, as in FreeRTOS */
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+#define xSemaphoreCreateBinary()	xSemaphoreCreateCounting(1, 0)
+#define xSemaphoreTake(s, wait)		xQueueReceive((s), NULL, (wait))
+#define xSemaphoreGive(s)		xQueueSend((s), NULL, 0)
+#define vSemaphoreDelete(s)		vQueueDelete(s)
+
+#endif /* _HOST_SEMPHR_H_ */
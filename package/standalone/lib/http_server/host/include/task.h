@@ -0,0 +1,22 @@
+#ifndef _HOST_TASK_H_
+#define _HOST_TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack_depth,
+		       void *param, UBaseType_t priority, TaskHandle_t *created);
+void vTaskDelete(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+/* One process wide lock stands in for disabling interrupts */
+void vTaskEnterCritical(void);
+void vTaskExitCritical(void);
+#define taskENTER_CRITICAL()	vTaskEnterCritical()
+#define taskEXIT_CRITICAL()	vTaskExitCritical()
+
+#endif /* _HOST_TASK_H_ */
@@ -0,0 +1,34 @@
+/*
+ * Host build of the http_server component: the trace macros of
+ * lib/modem/inc/util/util_trace.h, printing errors only unless
+ * HTTPD_HOST_VERBOSE is defined
+ */
+
+#ifndef _HOST_UTIL_TRACE_H_
+#define _HOST_UTIL_TRACE_H_
+
+#include <stdio.h>
+
+enum {
+	TT_SDK_HTTPD,
+};
+
+#define xPRINT(x, ...)		\
+do {					\
+	(void) (x);			\
+	fprintf(stderr, __VA_ARGS__);	\
+	fputc('\n', stderr);		\
+} while (0)
+
+#define E(x, ...)		xPRINT(x, __VA_ARGS__)
+#if defined(HTTPD_HOST_VERBOSE)
+#define I(x, ...)		xPRINT(x, __VA_ARGS__)
+#define V(x, ...)		xPRINT(x, __VA_ARGS__)
+#else
+#define I(x, ...)		do{ (void) (x); }while(0)
+#define V(x, ...)		do{ (void) (x); }while(0)
+#endif
+#define W			I
+#define D			V
+
+#endif /* _HOST_UTIL_TRACE_H_ */
@@ -0,0 +1,272 @@
+/*
+ * Keep-alive HTTP/1.1 load generator in the manner of wrk, the C
+ * counterpart of script/httpd_loadgen.py for when the generator must
+ * not be the bottleneck (such as on the same host as httpd_host).
+ *
+ * Every connection sends `-P` requests back to back, waits for all of
+ * their responses and starts over. Requests/s and the latency of each
+ * response from the time its batch was sent are reported per level of
+ * concurrency.
+ *
+ *   ./loadgen [-c 1,8,32] [-d seconds] [-P pipeline] host port path
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CONNS	256
+#define RX_BUF_SIZE	4096
+
+struct conn {
+	int fd;
+	double sent;		/* time the current batch was sent */
+	int outstanding;	/* responses of the batch not yet read */
+	size_t rx_len;
+	char rx[RX_BUF_SIZE];
+};
+
+struct stats {
+	double *lat;
+	size_t count;
+	size_t size;
+	unsigned errors;
+};
+
+static struct sockaddr_in server;
+static char request[512];
+static size_t request_len;
+static int pipeline = 1;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void record(struct stats *st, double lat)
+{
+	if (st->count == st->size) {
+		st->size = st->size ? st->size * 2 : 65536;
+		st->lat = realloc(st->lat, st->size * sizeof(double));
+		if (!st->lat) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	st->lat[st->count++] = lat;
+}
+
+static int send_batch(struct conn *c)
+{
+	for (int i = 0; i < pipeline; i++) {
+		if (send(c->fd, request, request_len, MSG_NOSIGNAL) != (ssize_t) request_len) {
+			return -1;
+		}
+	}
+	c->sent = now();
+	c->outstanding = pipeline;
+	return 0;
+}
+
+static int conn_open(struct conn *c, int epfd)
+{
+	struct epoll_event ev = { .events = EPOLLIN };
+	int one = 1;
+
+	c->fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (c->fd < 0 || connect(c->fd, (struct sockaddr *) &server, sizeof(server)) < 0) {
+		if (c->fd >= 0) {
+			close(c->fd);
+		}
+		c->fd = -1;
+		return -1;
+	}
+	setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	c->rx_len = 0;
+	ev.data.ptr = c;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev);
+	return send_batch(c);
+}
+
+static void conn_close(struct conn *c)
+{
+	if (c->fd >= 0) {
+		close(c->fd);
+	}
+	c->fd = -1;
+}
+
+/* Length of the complete response at the start of buf, 0 if there is none yet */
+static size_t response_len(const char *buf, size_t len)
+{
+	const char *end = memmem(buf, len, "\r\n\r\n", 4);
+	size_t hdr_len, body_len = 0;
+
+	if (!end) {
+		return 0;
+	}
+	hdr_len = end - buf + 4;
+	for (const char *p = buf; p && p < end; ) {
+		if (strncasecmp(p, "Content-Length:", 15) == 0) {
+			body_len = strtoul(p + 15, NULL, 10);
+		}
+		p = memchr(p, '\n', end - p);
+		if (p) {
+			p++;
+		}
+	}
+	return hdr_len + body_len <= len ? hdr_len + body_len : 0;
+}
+
+/* Reads what the server sent, returns -1 if the connection is to be reopened */
+static int conn_read(struct conn *c, struct stats *st)
+{
+	ssize_t n = recv(c->fd, c->rx + c->rx_len, sizeof(c->rx) - c->rx_len, 0);
+	size_t len;
+
+	if (n <= 0) {
+		return -1;
+	}
+	c->rx_len += n;
+
+	while ((len = response_len(c->rx, c->rx_len)) > 0) {
+		if (strncmp(c->rx, "HTTP/1.1 200", 12) != 0) {
+			st->errors++;
+		}
+		record(st, now() - c->sent);
+		memmove(c->rx, c->rx + len, c->rx_len - len);
+		c->rx_len -= len;
+		if (--c->outstanding == 0 && send_batch(c) < 0) {
+			return -1;
+		}
+	}
+	return c->rx_len < sizeof(c->rx) ? 0 : -1;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile(struct stats *st, double p)
+{
+	if (!st->count) {
+		return 0;
+	}
+	return st->lat[(size_t) (p / 100 * (st->count - 1) + 0.5)];
+}
+
+static void run(int nconns, double duration)
+{
+	static struct conn conns[MAX_CONNS];
+	struct epoll_event events[64];
+	struct stats st = { 0 };
+	int epfd = epoll_create1(0);
+	double start, deadline, elapsed;
+
+	for (int i = 0; i < nconns; i++) {
+		if (conn_open(&conns[i], epfd) < 0) {
+			st.errors++;
+		}
+	}
+	start = now();
+	deadline = start + duration;
+
+	while (now() < deadline) {
+		int n = epoll_wait(epfd, events, 64, 100);
+
+		for (int i = 0; i < n; i++) {
+			struct conn *c = events[i].data.ptr;
+
+			if (conn_read(c, &st) < 0) {
+				st.errors++;
+				conn_close(c);
+				conn_open(c, epfd);
+			}
+		}
+		/* Connections refused or failed earlier */
+		for (int i = 0; i < nconns; i++) {
+			if (conns[i].fd < 0 && conn_open(&conns[i], epfd) < 0) {
+				conn_close(&conns[i]);
+			}
+		}
+	}
+	elapsed = now() - start;
+
+	for (int i = 0; i < nconns; i++) {
+		conn_close(&conns[i]);
+	}
+	close(epfd);
+
+	qsort(st.lat, st.count, sizeof(double), cmp_double);
+	printf("%5d %10.1f %10.2f %10.2f %10.2f %7u\n", nconns, st.count / elapsed,
+	       percentile(&st, 50) * 1000, percentile(&st, 99) * 1000,
+	       st.count ? st.lat[st.count - 1] * 1000 : 0.0, st.errors);
+	fflush(stdout);
+	free(st.lat);
+}
+
+int main(int argc, char *argv[])
+{
+	char levels[64] = "1,8,32";
+	double duration = 10;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:d:P:")) != -1) {
+		switch (opt) {
+		case 'c':
+			snprintf(levels, sizeof(levels), "%s", optarg);
+			break;
+		case 'd':
+			duration = atof(optarg);
+			break;
+		case 'P':
+			pipeline = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind != 3 || pipeline < 1) {
+		goto usage;
+	}
+
+	server.sin_family = AF_INET;
+	server.sin_port = htons(atoi(argv[optind + 1]));
+	if (inet_pton(AF_INET, argv[optind], &server.sin_addr) != 1) {
+		goto usage;
+	}
+	request_len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n",
+			       argv[optind + 2], argv[optind]);
+
+	printf("%5s %10s %10s %10s %10s %7s\n",
+	       "conns", "req/s", "p50(ms)", "p99(ms)", "max(ms)", "errors");
+	for (char *tok = strtok(levels, ","); tok; tok = strtok(NULL, ",")) {
+		int nconns = atoi(tok);
+
+		if (nconns < 1 || nconns > MAX_CONNS) {
+			goto usage;
+		}
+		run(nconns, duration);
+	}
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-c 1,8,32] [-d seconds] [-P pipeline] host port path\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,217 @@
+/*
+ * Host benchmark of httpd_find_uri_handler(): the compiled URI router
+ * against the linear scan over the registered templates.
+ *
+ * The linear scan is the code path httpd_find_uri_handler() takes for a
+ * custom uri_match_fn, so it is measured on a second server registered
+ * with a matcher that only forwards to httpd_uri_match_wildcard() or
+ * httpd_uri_match_path_params(). Both servers must find the same handler
+ * and error for every request before anything is timed.
+ *
+ *   ./router_bench [lookups per request]
+ */
+
+#include <time.h>
+
+/* For the static httpd_find_uri_handler() */
+#include "httpd_uri.c"
+
+static const char *resources[] = {
+	"sta", "ap", "scan", "wps", "dhcp", "dns", "ntp", "ota",
+	"log", "gpio", "adc", "i2c", "uart", "mqtt", "coap", "sensor",
+};
+
+#define NUM_RESOURCES		(sizeof(resources) / sizeof(resources[0]))
+#define MAX_TEMPLATES		(4 * NUM_RESOURCES + 4)
+#define MAX_REQUESTS		(5 * NUM_RESOURCES + 4)
+
+struct request {
+	char uri[48];
+	httpd_method_t method;
+};
+
+static bool match_wildcard(const char *template, const char *uri, size_t len)
+{
+	return httpd_uri_match_wildcard(template, uri, len);
+}
+
+static bool match_path_params(const char *template, const char *uri, size_t len)
+{
+	return httpd_uri_match_path_params(template, uri, len);
+}
+
+static esp_err_t handler(httpd_req_t *r)
+{
+	return ESP_OK;
+}
+
+static struct httpd_data *server_new(httpd_uri_match_func_t match_fn)
+{
+	struct httpd_data *hd = calloc(1, sizeof(struct httpd_data));
+	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+
+	config.max_uri_handlers = MAX_TEMPLATES;
+	config.uri_match_fn = match_fn;
+	hd->config = config;
+	hd->hd_calls = calloc(config.max_uri_handlers, sizeof(httpd_uri_t *));
+	return hd;
+}
+
+static void server_free(struct httpd_data *hd)
+{
+	httpd_unregister_all_uri_handlers(hd);
+	free(hd->hd_calls);
+	free(hd);
+}
+
+static void server_register(struct httpd_data *hd, const char *uri, httpd_method_t method)
+{
+	httpd_uri_t h = {
+		.uri = uri,
+		.method = method,
+		.handler = handler,
+	};
+
+	if (httpd_register_uri_handler(hd, &h) != ESP_OK) {
+		printf("failed to register %s\n", uri);
+		exit(1);
+	}
+}
+
+/* Four templates per resource and four for static content, registered the
+ * way an application would: the most specific template of a path first */
+static int templates_register(struct httpd_data *hd, int nres, bool params)
+{
+	static char uris[MAX_TEMPLATES][48];
+	int n = 0;
+
+	for (int i = 0; i < nres; i++) {
+		snprintf(uris[n], sizeof(uris[n]), "/api/%s", resources[i]);
+		server_register(hd, uris[n++], HTTP_GET);
+		snprintf(uris[n], sizeof(uris[n]), "/api/%s", resources[i]);
+		server_register(hd, uris[n++], HTTP_POST);
+		snprintf(uris[n], sizeof(uris[n]), params ? "/api/%s/{id}" : "/api/%s/*", resources[i]);
+		server_register(hd, uris[n++], HTTP_GET);
+		snprintf(uris[n], sizeof(uris[n]), params ? "/api/%s/{id}" : "/api/%s/*", resources[i]);
+		server_register(hd, uris[n++], HTTP_DELETE);
+	}
+	server_register(hd, "/", HTTP_GET);
+	server_register(hd, "/index.html", HTTP_GET);
+	server_register(hd, "/favicon.ico", HTTP_GET);
+	server_register(hd, "/static/*", HTTP_GET);
+	return n + 4;
+}
+
+/* Hits spread over the templates, a 405 per resource and two 404s */
+static int requests_init(struct request *req, int nres)
+{
+	int n = 0;
+
+	for (int i = 0; i < nres; i++) {
+		snprintf(req[n].uri, sizeof(req[n].uri), "/api/%s", resources[i]);
+		req[n++].method = HTTP_GET;
+		snprintf(req[n].uri, sizeof(req[n].uri), "/api/%s", resources[i]);
+		req[n++].method = HTTP_POST;
+		snprintf(req[n].uri, sizeof(req[n].uri), "/api/%s/17", resources[i]);
+		req[n++].method = HTTP_GET;
+		snprintf(req[n].uri, sizeof(req[n].uri), "/api/%s/17", resources[i]);
+		req[n++].method = HTTP_DELETE;
+		snprintf(req[n].uri, sizeof(req[n].uri), "/api/%s", resources[i]);
+		req[n++].method = HTTP_PUT;
+	}
+	strcpy(req[n].uri, "/index.html");
+	req[n++].method = HTTP_GET;
+	strcpy(req[n].uri, "/static/js/app.js");
+	req[n++].method = HTTP_GET;
+	strcpy(req[n].uri, "/apix/sta");
+	req[n++].method = HTTP_GET;
+	strcpy(req[n].uri, "/cgi-bin/status");
+	req[n++].method = HTTP_GET;
+	return n;
+}
+
+static bool same_result(struct httpd_data *a, struct httpd_data *b, const struct request *r)
+{
+	httpd_err_code_t err_a, err_b;
+	httpd_uri_t *ha = httpd_find_uri_handler(a, r->uri, strlen(r->uri), r->method, &err_a);
+	httpd_uri_t *hb = httpd_find_uri_handler(b, r->uri, strlen(r->uri), r->method, &err_b);
+
+	if (err_a != err_b || !ha != !hb ||
+	    (ha && (strcmp(ha->uri, hb->uri) != 0 || ha->method != hb->method))) {
+		printf("%s %s: router %s (%d), linear %s (%d)\n",
+		       http_method_str(r->method), r->uri,
+		       ha ? ha->uri : "-", err_a, hb ? hb->uri : "-", err_b);
+		return false;
+	}
+	return true;
+}
+
+/* Nanoseconds per lookup, over rounds of all the requests */
+static double time_lookups(struct httpd_data *hd, const struct request *req, int nreq, int rounds)
+{
+	struct timespec start, end;
+	size_t len[MAX_REQUESTS];
+	volatile uintptr_t sink = 0;
+
+	for (int i = 0; i < nreq; i++) {
+		len[i] = strlen(req[i].uri);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int k = 0; k < rounds; k++) {
+		for (int i = 0; i < nreq; i++) {
+			sink += (uintptr_t) httpd_find_uri_handler(hd, req[i].uri, len[i], req[i].method, NULL);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+	       ((double) rounds * nreq);
+}
+
+int main(int argc, char *argv[])
+{
+	const int lookups = argc > 1 ? atoi(argv[1]) : 200000;
+	static const struct {
+		const char *name;
+		httpd_uri_match_func_t router, linear;
+		bool params;
+	} modes[] = {
+		{ "wildcard", httpd_uri_match_wildcard, match_wildcard, false },
+		{ "params", httpd_uri_match_path_params, match_path_params, true },
+	};
+	int rc = 0;
+
+	printf("%-9s %9s %8s %11s %11s %8s\n",
+	       "matcher", "templates", "requests", "router(ns)", "linear(ns)", "speedup");
+
+	for (int m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+		for (int nres = 2; nres <= NUM_RESOURCES; nres *= 2) {
+			struct httpd_data *router = server_new(modes[m].router);
+			struct httpd_data *linear = server_new(modes[m].linear);
+			struct request req[MAX_REQUESTS];
+			int ntpl, nreq, rounds;
+
+			ntpl = templates_register(router, nres, modes[m].params);
+			templates_register(linear, nres, modes[m].params);
+			nreq = requests_init(req, nres);
+
+			for (int i = 0; i < nreq; i++) {
+				if (!same_result(router, linear, &req[i])) {
+					rc = 1;
+				}
+			}
+
+			rounds = lookups / nreq + 1;
+			double t_router = time_lookups(router, req, nreq, rounds);
+			double t_linear = time_lookups(linear, req, nreq, rounds);
+
+			printf("%-9s %9d %8d %11.1f %11.1f %7.1fx\n", modes[m].name,
+			       ntpl, nreq, t_router, t_linear, t_linear / t_router);
+
+			server_free(router);
+			server_free(linear);
+		}
+	}
+	return rc;
+}
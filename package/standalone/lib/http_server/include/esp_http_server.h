@@ -21,6 +21,7 @@ extern "C" {
 #endif
 
 #define HTTPD_DEF_CTRL_PORT         (32768)    /*!< HTTP Server control socket port*/
+#define HTTPD_DEF_RECV_BUF_SIZE     (128)      /*!< HTTP Server per session receive buffer size */
 
 /*
 note: esp_https_server.h includes a customized copy of this
@@ -38,6 +39,11 @@ initializer that should be kept in sync
         .lru_purge_enable   = false,                    \
         .recv_wait_timeout  = 5,                        \
         .send_wait_timeout  = 5,                        \
+        .recv_buf_size      = HTTPD_DEF_RECV_BUF_SIZE,  \
+        .max_pipelined_reqs = 4,                        \
+        .async_workers      = 0,                        \
+        .async_stack_size   = 4096,                     \
+        .async_queue_len    = 4,                        \
         .global_user_ctx = NULL,                        \
         .global_user_ctx_free_fn = NULL,                \
         .global_transport_ctx = NULL,                   \
@@ -162,6 +168,33 @@ typedef struct httpd_config {
     uint16_t    recv_wait_timeout;  /*!< Timeout for recv function (in seconds)*/
     uint16_t    send_wait_timeout;  /*!< Timeout for send function (in seconds)*/
 
+    /**
+     * Size of the block read from a session socket in one turn of request
+     * parsing, which is also the size of the per session buffer holding
+     * data received ahead of the current request (e.g. pipelined requests).
+     * Larger values need fewer recv() calls per request at the cost of
+     * max_open_sockets * recv_buf_size bytes of heap. Limited to the
+     * request header/URI scratch buffer size.
+     */
+    uint16_t    recv_buf_size;
+
+    /**
+     * Maximum number of requests served back to back on one session before
+     * returning to select(). Requests a keep-alive client pipelines on the
+     * connection are then answered without a select() round per request,
+     * while a single busy client still can't starve the others.
+     */
+    uint16_t    max_pipelined_reqs;
+
+    /**
+     * Number of worker tasks running the handlers registered with
+     * `is_async` set, so that long handlers don't hold up the server task.
+     * With 0 no workers are created and such handlers run inline.
+     */
+    uint16_t    async_workers;
+    size_t      async_stack_size;   /*!< Stack size of each async worker task */
+    uint16_t    async_queue_len;    /*!< Requests waiting for a worker before handlers are run inline */
+
     /**
      * Global user context.
      *
@@ -242,6 +275,12 @@ typedef struct httpd_config {
      * Available options are:
      *     1) NULL : Internally do basic matching using `strncmp()`
      *     2) `httpd_uri_match_wildcard()` : URI wildcard matcher
+     *     3) `httpd_uri_match_path_params()` : URI wildcard matcher
+     *        with "{name}" path parameters
+     *
+     * With CONFIG_HTTPD_URI_ROUTER the above options are served by a
+     * prefix tree compiled at registration, so lookup cost no longer
+     * grows with the number of handlers.
      *
      * Users can implement their own matching functions (See description
      * of the `httpd_uri_match_func_t` function prototype)
@@ -408,6 +447,14 @@ typedef struct httpd_uri {
      */
     void *user_ctx;
 
+    /**
+     * Flag for running the handler on one of the async worker tasks
+     * (see async_workers of httpd_config_t) instead of the server task.
+     * The session is not polled for further requests until the handler
+     * returns.
+     */
+    bool is_async;
+
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     /**
      * Flag for indicating a WebSocket endpoint.
@@ -999,6 +1046,51 @@ esp_err_t httpd_req_get_cookie_val(httpd_req_t *req, const char *cookie_name, ch
  */
 bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto);
 
+/**
+ * @brief Test if a URI matches the given template with path parameters.
+ *
+ * Same as httpd_uri_match_wildcard(), and in addition a "{name}" segment
+ * matches any non-empty path segment. A parameter must span a whole
+ * segment, and the value is available to the handler through
+ * httpd_req_get_path_param().
+ *
+ * Example:
+ *   - /api/sta/{mac} matches /api/sta/0a:1b:2c:3d:4e:5f, but not /api/sta/ or /api/sta/x/y
+ *   - /api/sta/{mac}/\* (sans the backslash) matches /api/sta/x/rssi and /api/sta/x/
+ *
+ * @param[in] uri_template   URI template (pattern)
+ * @param[in] uri_to_match   URI to be matched
+ * @param[in] match_upto     how many characters of the URI buffer to test
+ *                          (there may be trailing query string etc.)
+ *
+ * @return true if a match was found
+ */
+bool httpd_uri_match_path_params(const char *uri_template, const char *uri_to_match, size_t match_upto);
+
+/**
+ * @brief   Get the value of a path parameter of the matched URI template
+ *
+ * @note
+ *  - This API is supposed to be called only from the context of
+ *    a URI handler where httpd_req_t* request pointer is valid, and
+ *    only when the server uses httpd_uri_match_path_params().
+ *  - If output size is greater than input, then the value is truncated,
+ *    accompanied by truncation error as return value.
+ *
+ * @param[in]  r        The request being responded to
+ * @param[in]  name     Name of the parameter, as in "{name}" of the template
+ * @param[out] val      Pointer to the buffer into which the value will be copied if the parameter is found
+ * @param[in]  val_size Size of the user buffer "val"
+ *
+ * @return
+ *  - ESP_OK : Parameter found and value string copied
+ *  - ESP_ERR_NOT_FOUND          : Parameter not found in the template
+ *  - ESP_ERR_INVALID_ARG        : Null arguments
+ *  - ESP_ERR_HTTPD_INVALID_REQ  : Invalid HTTP request pointer
+ *  - ESP_ERR_HTTPD_RESULT_TRUNC : Value string truncated
+ */
+esp_err_t httpd_req_get_path_param(httpd_req_t *r, const char *name, char *val, size_t val_size);
+
 /**
  * @brief   API to send a complete HTTP response.
  *
@@ -1569,6 +1661,40 @@ typedef void (*httpd_work_fn_t)(void *arg);
  */
 esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg);
 
+/**
+ * @brief   Start an asynchronous request. This function can be called
+ *          in a request handler to get a request copy that can be used
+ *          on another task, e.g. a worker of the application's own.
+ *
+ * @note    The session is not polled for further requests until
+ *          httpd_req_async_handler_complete() is called for the copy.
+ *          Handlers registered with `is_async` set get this done by the
+ *          server's own workers.
+ *
+ * @param[in]  r     The request to create an async copy of
+ * @param[out] out   A newly allocated request which can be used on another task
+ *
+ * @return
+ *  - ESP_OK              : async request object created
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ *  - ESP_ERR_NO_MEM      : Failed to allocate the request copy
+ */
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out);
+
+/**
+ * @brief   Mark an asynchronous request as completed. This will
+ *          - purge the request body the handler left unread
+ *          - free the request memory
+ *          - let the server poll the session for further requests
+ *
+ * @param[in] r   The request to mark async work as completed
+ *
+ * @return
+ *  - ESP_OK              : async request was marked completed
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ */
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r);
+
 /** End of Group Work Queue
  * @}
  */
@@ -1,6 +1,7 @@
 DEFINE	+= -DCONFIG_HTTPD_WS_SUPPORT
 DEFINE	+= -DCONFIG_LOG_DEFAULT_LEVEL=0
 DEFINE	+= -DCONFIG_HTTPD_VALIDATE_REQ
+DEFINE	+= -DCONFIG_HTTPD_URI_ROUTER
 
 HTTP_SERVER_SRC     = $(HTTP_SERVER_BASE)/src
 HTTP_SERVER_PORT    = $(HTTP_SERVER_SRC)/port
@@ -19,6 +20,8 @@ CSRCS += \
 	httpd_sess.c \
 	httpd_parse.c \
 	httpd_uri.c \
+	httpd_router.c \
+	httpd_async.c \
 	httpd_txrx.c \
 	httpd_main.c \
 	ctrl_sock.c
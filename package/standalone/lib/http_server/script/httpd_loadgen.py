@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+#
+# Keep-alive HTTP/1.1 load generator for the http_server component.
+#
+# Each client keeps one connection open and sends `--pipeline` requests
+# back to back before reading the responses, so both the per connection
+# turnaround and pipelining on the server can be measured. Requests/s and
+# latency percentiles are reported for every concurrency level.
+#
+#   python3 httpd_loadgen.py 192.168.200.1 --path /hello -c 1 8 32 -d 10
+#
+
+import argparse
+import asyncio
+import time
+
+
+def percentile(samples, p):
+    if not samples:
+        return 0.0
+    samples = sorted(samples)
+    k = min(len(samples) - 1, int(round(p / 100.0 * (len(samples) - 1))))
+    return samples[k]
+
+
+async def read_response(reader):
+    """Reads one response, returns False if the server closed the connection"""
+    status = await reader.readline()
+    if not status:
+        return False
+    length = 0
+    chunked = False
+    while True:
+        line = await reader.readline()
+        if line in (b'\r\n', b'\n', b''):
+            break
+        name, _, value = line.decode('latin-1').partition(':')
+        name = name.strip().lower()
+        if name == 'content-length':
+            length = int(value.strip())
+        elif name == 'transfer-encoding' and 'chunked' in value.lower():
+            chunked = True
+    if chunked:
+        while True:
+            size = int((await reader.readline()).split(b';')[0], 16)
+            await reader.readexactly(size + 2)
+            if size == 0:
+                break
+    elif length:
+        await reader.readexactly(length)
+    return True
+
+
+async def client(args, deadline, latencies, errors):
+    request = ('GET {} HTTP/1.1\r\nHost: {}\r\n\r\n'.format(args.path, args.host)).encode()
+    writer = None
+    while time.monotonic() < deadline:
+        try:
+            if writer is None:
+                reader, writer = await asyncio.open_connection(args.host, args.port)
+            start = time.monotonic()
+            writer.write(request * args.pipeline)
+            await writer.drain()
+            for _ in range(args.pipeline):
+                if not await asyncio.wait_for(read_response(reader), args.timeout):
+                    raise ConnectionError('closed by server')
+                latencies.append(time.monotonic() - start)
+        except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError, ValueError):
+            errors[0] += 1
+            if writer is not None:
+                writer.close()
+            writer = None
+            await asyncio.sleep(0.1)
+    if writer is not None:
+        writer.close()
+
+
+async def run(args, concurrency):
+    latencies = []
+    errors = [0]
+    start = time.monotonic()
+    deadline = start + args.duration
+    await asyncio.gather(*(client(args, deadline, latencies, errors)
+                           for _ in range(concurrency)))
+    elapsed = time.monotonic() - start
+    print('{:>5} {:>10.1f} {:>10.2f} {:>10.2f} {:>10.2f} {:>7}'.format(
+        concurrency, len(latencies) / elapsed,
+        percentile(latencies, 50) * 1000,
+        percentile(latencies, 99) * 1000,
+        max(latencies, default=0) * 1000,
+        errors[0]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='http_server load generator')
+    parser.add_argument('host')
+    parser.add_argument('-p', '--port', type=int, default=80)
+    parser.add_argument('--path', default='/')
+    parser.add_argument('-c', '--concurrency', type=int, nargs='+', default=[1, 8, 32])
+    parser.add_argument('-d', '--duration', type=float, default=10.0, help='seconds per level')
+    parser.add_argument('--pipeline', type=int, default=1, help='requests in flight per connection')
+    parser.add_argument('--timeout', type=float, default=10.0)
+    args = parser.parse_args()
+
+    print('{:>5} {:>10} {:>10} {:>10} {:>10} {:>7}'.format(
+        'conns', 'req/s', 'p50(ms)', 'p99(ms)', 'max(ms)', 'errors'))
+    for concurrency in args.concurrency:
+        asyncio.run(run(args, concurrency))
+
+
+if __name__ == '__main__':
+    main()
@@ -14,15 +14,17 @@
 
 #include <esp_http_server.h>
 #include "osal.h"
+#include <queue.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* Size of request data block/chunk (not to be confused with chunked encoded data)
- * that is received and parsed in one turn of the parsing process. This should not
- * exceed the scratch buffer size and should at least be 8 bytes */
-#define PARSER_BLOCK_SIZE  128
+ * that is received and parsed in one turn of the parsing process is set by
+ * recv_buf_size of the server configuration. This should not exceed the scratch
+ * buffer size and should at least be 8 bytes */
+#define PARSER_BLOCK_SIZE_MIN  8
 
 /* Calculate the maximum size needed for the scratch buffer */
 #define HTTPD_SCRATCH_BUF  MAX(HTTPD_MAX_REQ_HDR_LEN, HTTPD_MAX_URI_LEN)
@@ -59,8 +61,9 @@ struct sock_db {
     httpd_pending_func_t pending_fn;        /*!< Pending function for this socket */
     uint64_t lru_counter;                   /*!< LRU Counter indicating when the socket was last used */
     bool lru_socket;                        /*!< Flag indicating LRU socket */
-    char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
+    char *pending_data;                     /*!< Buffer for pending data to be received (recv_buf_size bytes) */
     size_t pending_len;                     /*!< Length of pending data to be received */
+    bool for_async_req;                     /*!< A request of this socket is being handled asynchronously */
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     bool ws_handshake_done;                 /*!< True if it has done WebSocket handshake (if this socket is a valid WS) */
     bool ws_close;                          /*!< Set to true to close the socket later (when WS Close frame received) */
@@ -88,6 +91,7 @@ struct httpd_req_aux {
         const char *value;
     } *resp_hdrs;                                   /*!< Additional headers in response packet */
     struct http_parser_url url_parse_res;           /*!< URL parsing result, used for retrieving URL elements */
+    const httpd_uri_t *uri_handler;                 /*!< URI handler matched for this request, used for retrieving path parameters */
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     bool ws_handshake_detect;                       /*!< WebSocket handshake detection flag */
     httpd_ws_type_t ws_type;                        /*!< WebSocket frame type */
@@ -110,14 +114,23 @@ struct httpd_data {
     int msg_fd;                             /*!< Ctrl message sender FD */
     struct thread_data hd_td;               /*!< Information for the HTTPD thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
+    char *hd_sd_bufs;                       /*!< Pending data buffers of the socket database */
     int hd_sd_active_count;                 /*!< The number of the active sockets */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
+    int hd_calls_count;                     /*!< The number of the registered URI handlers */
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    struct httpd_route_node *hd_router;     /*!< Compiled URI router over hd_calls */
+    uint32_t hd_router_seq;                 /*!< Registration sequence for the router */
+#endif
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
     uint64_t lru_counter;                   /*!< LRU counter */
 
     /* Array of registered error handler functions */
     httpd_err_handler_func_t *err_handler_fns;
+
+    QueueHandle_t async_queue;              /*!< Requests waiting for an async worker */
+    int async_running;                      /*!< The number of the running async workers */
 };
 
 /******************* Group : Session Management ********************/
@@ -257,6 +270,19 @@ bool httpd_is_sess_available(struct httpd_data *hd);
  */
 bool httpd_sess_pending(struct httpd_data *hd, struct sock_db *session);
 
+/**
+ * @brief   Checks if the next request of a session can be read right away,
+ *          i.e. there is pending data (see httpd_sess_pending()) or data
+ *          already queued on the socket. Used to serve pipelined requests
+ *          without waiting for select().
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] session Session
+ *
+ * @return True if there is data to read
+ */
+bool httpd_sess_readable(struct httpd_data *hd, struct sock_db *session);
+
 /**
  * @brief   Removes the least recently used client from the session
  *
@@ -309,6 +335,67 @@ esp_err_t httpd_uri(struct httpd_data *hd);
  */
 void httpd_unregister_all_uri_handlers(struct httpd_data *hd);
 
+#ifdef CONFIG_HTTPD_URI_ROUTER
+/**
+ * @brief   Checks if the configured URI matcher can be served by the
+ *          compiled router, i.e. it is NULL, httpd_uri_match_wildcard()
+ *          or httpd_uri_match_path_params(). Custom matchers fall back
+ *          to the linear scan over all registered handlers.
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return True if the router is used for this instance
+ */
+bool httpd_router_enabled(struct httpd_data *hd);
+
+/**
+ * @brief   Adds a registered URI handler to the router
+ *
+ * @param[in] hd   Server instance data
+ * @param[in] uri  URI handler, as stored in hd_calls
+ *
+ * @return
+ *  - ESP_OK                  : on success
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : if a router node could not be allocated
+ */
+esp_err_t httpd_router_insert(struct httpd_data *hd, httpd_uri_t *uri);
+
+/**
+ * @brief   Removes a URI handler from the router, pruning unused nodes
+ *
+ * @param[in] hd   Server instance data
+ * @param[in] uri  URI handler, as stored in hd_calls
+ */
+void httpd_router_remove(struct httpd_data *hd, const httpd_uri_t *uri);
+
+/**
+ * @brief   Looks up the handler for a request path
+ *
+ * When several templates match, the handler registered first is
+ * returned, same as the linear scan.
+ *
+ * @param[in]  hd      Server instance data
+ * @param[in]  uri     Request path
+ * @param[in]  uri_len Length of the request path
+ * @param[in]  method  Request method
+ * @param[out] err     HTTPD_404_NOT_FOUND or HTTPD_405_METHOD_NOT_ALLOWED if
+ *                     no handler was found, 0 otherwise (may be NULL)
+ *
+ * @return Matching URI handler or NULL
+ */
+httpd_uri_t *httpd_router_find(struct httpd_data *hd,
+                               const char *uri, size_t uri_len,
+                               httpd_method_t method,
+                               httpd_err_code_t *err);
+
+/**
+ * @brief   Frees all router nodes
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_router_free(struct httpd_data *hd);
+#endif /* CONFIG_HTTPD_URI_ROUTER */
+
 /**
  * @brief   Validates the request to prevent users from calling APIs, that are to
  *          be called only inside a URI handler, outside the handler context
@@ -330,6 +417,38 @@ bool httpd_validate_req_ptr(httpd_req_t *r);
 #define httpd_valid_req(r)  true
 #endif
 
+/**
+ * @brief   Starts the async worker tasks, if any are configured
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - ESP_OK               : on success
+ *  - ESP_ERR_HTTPD_TASK   : if a worker could not be started
+ */
+esp_err_t httpd_async_start(struct httpd_data *hd);
+
+/**
+ * @brief   Stops the async worker tasks and waits for them to exit
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_async_stop(struct httpd_data *hd);
+
+/**
+ * @brief   Hands a request over to the async workers
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] req      The request being processed by the server task
+ * @param[in] handler  Handler to be run by the worker
+ *
+ * @return
+ *  - ESP_OK   : request queued, the worker completes it
+ *  - ESP_FAIL : no worker available, run the handler inline
+ */
+esp_err_t httpd_async_dispatch(struct httpd_data *hd, httpd_req_t *req,
+                               esp_err_t (*handler)(httpd_req_t *r));
+
 /** End of Group : URI Handling
  * @}
  */
@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include <util_trace.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const int TAG = TT_SDK_HTTPD;
+
+/* Item of the async worker queue, a NULL request stops the worker */
+struct httpd_async_req {
+    httpd_req_t *req;
+    esp_err_t (*handler)(httpd_req_t *r);
+};
+
+static void httpd_req_async_free(httpd_req_t *r)
+{
+    struct httpd_req_aux *ra = r->aux;
+
+    free(ra->resp_hdrs);
+    free(ra);
+    free(r);
+}
+
+/* Hands the session back to the server task, which alone updates the
+ * LRU counters and, woken up by this control message, adds the session
+ * back to the select() set */
+static void httpd_async_done(void *arg)
+{
+    struct sock_db    *sd = (struct sock_db *) arg;
+    struct httpd_data *hd = (struct httpd_data *) sd->handle;
+
+    sd->lru_counter = ++hd->lru_counter;
+    sd->for_async_req = false;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+    if (r == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data    *hd = (struct httpd_data *) r->handle;
+    struct httpd_req_aux *ra = r->aux;
+
+    httpd_req_t *async = malloc(sizeof(httpd_req_t));
+    struct httpd_req_aux *async_aux = malloc(sizeof(struct httpd_req_aux));
+    struct resp_hdr *resp_hdrs = calloc(hd->config.max_resp_headers, sizeof(struct resp_hdr));
+    if (!async || !async_aux || !resp_hdrs) {
+        E(TAG, LOG_FMT("Failed to allocate memory for async request"));
+        free(resp_hdrs);
+        free(async_aux);
+        free(async);
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* The scratch buffer holding the headers and the
+     * pending response headers go along with the copy */
+    memcpy(async, r, sizeof(httpd_req_t));
+    memcpy(async_aux, ra, sizeof(struct httpd_req_aux));
+    memcpy(resp_hdrs, ra->resp_hdrs, hd->config.max_resp_headers * sizeof(struct resp_hdr));
+    async_aux->resp_hdrs = resp_hdrs;
+    async->aux = async_aux;
+
+    /* The session is owned by the copy until completion */
+    ra->sd->for_async_req = true;
+
+    *out = async;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+    if (r == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data    *hd = (struct httpd_data *) r->handle;
+    struct httpd_req_aux *ra = r->aux;
+    struct sock_db       *sd = ra->sd;
+
+    /* Finish off reading what the handler left of the body, so that
+     * the next request on the session starts on a clean stream */
+    while (ra->remaining_len) {
+        char dummy[32];
+        int recv_len = MIN(sizeof(dummy), ra->remaining_len);
+        recv_len = httpd_req_recv(r, dummy, recv_len);
+        if (recv_len <= 0) {
+            httpd_sess_trigger_close_(hd, sd);
+            break;
+        }
+        V(TAG, LOG_FMT("purging data size : %d bytes"), recv_len);
+    }
+
+    /* Keep the session context the handler may have changed */
+    if (!r->ignore_sess_ctx_changes && sd->ctx != r->sess_ctx) {
+        httpd_sess_free_ctx(&sd->ctx, sd->free_ctx);
+        sd->ctx = r->sess_ctx;
+        sd->free_ctx = r->free_ctx;
+    }
+
+    httpd_req_async_free(r);
+
+    if (httpd_queue_work(hd, httpd_async_done, sd) != ESP_OK) {
+        /* Left out of the LRU order, the session is
+         * still served after the next select() */
+        sd->for_async_req = false;
+    }
+    return ESP_OK;
+}
+
+static void httpd_async_worker(void *arg)
+{
+    struct httpd_data *hd = (struct httpd_data *) arg;
+    struct httpd_async_req work;
+
+    V(TAG, LOG_FMT("async worker started"));
+    while (xQueueReceive(hd->async_queue, &work, portMAX_DELAY) == pdTRUE) {
+        if (!work.req) {
+            break;
+        }
+
+        struct httpd_req_aux *ra = work.req->aux;
+        if (work.handler(work.req) != ESP_OK) {
+            /* Handler returns error, this socket should be closed
+             * and what is left of the request is of no interest */
+            E(TAG, LOG_FMT("async uri handler execution failed"));
+            ra->remaining_len = 0;
+            httpd_sess_trigger_close_(hd, ra->sd);
+        }
+        httpd_req_async_handler_complete(work.req);
+    }
+
+    V(TAG, LOG_FMT("async worker exiting"));
+    taskENTER_CRITICAL();
+    hd->async_running--;
+    taskEXIT_CRITICAL();
+    httpd_os_thread_delete();
+}
+
+esp_err_t httpd_async_start(struct httpd_data *hd)
+{
+    if (!hd->config.async_workers) {
+        return ESP_OK;
+    }
+
+    hd->async_queue = xQueueCreate(MAX(hd->config.async_queue_len, 1),
+                                   sizeof(struct httpd_async_req));
+    if (!hd->async_queue) {
+        E(TAG, LOG_FMT("Failed to create async request queue"));
+        return ESP_ERR_HTTPD_TASK;
+    }
+
+    for (int i = 0; i < hd->config.async_workers; i++) {
+        othread_t handle;
+        if (httpd_os_thread_create(&handle, "httpd_async",
+                                   hd->config.async_stack_size,
+                                   hd->config.task_priority,
+                                   httpd_async_worker, hd) != ESP_OK) {
+            E(TAG, LOG_FMT("Failed to launch async worker %d"), i);
+            httpd_async_stop(hd);
+            return ESP_ERR_HTTPD_TASK;
+        }
+        taskENTER_CRITICAL();
+        hd->async_running++;
+        taskEXIT_CRITICAL();
+    }
+    return ESP_OK;
+}
+
+void httpd_async_stop(struct httpd_data *hd)
+{
+    struct httpd_async_req stop = { .req = NULL };
+
+    if (!hd->async_queue) {
+        return;
+    }
+
+    /* Workers drain the requests queued before the stop items */
+    for (int i = hd->async_running; i > 0; i--) {
+        xQueueSend(hd->async_queue, &stop, portMAX_DELAY);
+    }
+    while (hd->async_running) {
+        httpd_os_thread_sleep(100);
+    }
+    vQueueDelete(hd->async_queue);
+    hd->async_queue = NULL;
+}
+
+esp_err_t httpd_async_dispatch(struct httpd_data *hd, httpd_req_t *req,
+                               esp_err_t (*handler)(httpd_req_t *r))
+{
+    struct httpd_async_req work = { .handler = handler };
+
+    /* Only the server task queues requests, so a free
+     * slot seen here can't be taken by anyone else */
+    if (!hd->async_queue || uxQueueSpacesAvailable(hd->async_queue) == 0) {
+        return ESP_FAIL;
+    }
+
+    if (httpd_req_async_handler_begin(req, &work.req) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    if (xQueueSend(hd->async_queue, &work, 0) != pdTRUE) {
+        ((struct httpd_req_aux *) req->aux)->sd->for_async_req = false;
+        httpd_req_async_free(work.req);
+        return ESP_FAIL;
+    }
+    V(TAG, LOG_FMT("queued async request for %s"), req->uri);
+    return ESP_OK;
+}
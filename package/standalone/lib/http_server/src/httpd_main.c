@@ -72,6 +72,14 @@ static esp_err_t httpd_accept_conn(struct httpd_data *hd, int listen_fd)
         goto exit;
     }
 
+    /* Responses leave in one send each (see httpd_resp_send()), Nagle's
+     * algorithm would only hold the responses to pipelined requests, and
+     * error messages before a close, until the client's delayed ACK */
+    int nodelay = 1;
+    if (setsockopt(new_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) < 0) {
+        E(TAG, LOG_FMT("error in setsockopt TCP_NODELAY (%d)"), errno);
+    }
+
     if (hd->config.keep_alive_enable) {
         int keep_alive_enable = 1;
         int keep_alive_idle = hd->config.keep_alive_idle ? hd->config.keep_alive_idle : DEFAULT_KEEP_ALIVE_IDLE;
@@ -231,11 +239,24 @@ static int httpd_process_session(struct sock_db *session, void *context)
     process_session_context_t *ctx = (process_session_context_t *)context;
     int fd = session->fd;
 
+    if (session->for_async_req) {
+        return 1;
+    }
+
     if (FD_ISSET(fd, ctx->fdset) || httpd_sess_pending(ctx->hd, session)) {
-        V(TAG, LOG_FMT("processing socket %d"), fd);
-        if (httpd_sess_process(ctx->hd, session) != ESP_OK) {
-            httpd_sess_delete(ctx->hd, session); // Delete session
-        }
+        /* Serve the requests a keep-alive client has already queued on
+         * the connection back to back, bounded so that other sessions
+         * are not starved */
+        unsigned served = 0;
+        do {
+            V(TAG, LOG_FMT("processing socket %d"), fd);
+            if (httpd_sess_process(ctx->hd, session) != ESP_OK) {
+                httpd_sess_delete(ctx->hd, session); // Delete session
+                break;
+            }
+        } while (++served < ctx->hd->config.max_pipelined_reqs &&
+                 session->fd == fd && !session->for_async_req &&
+                 httpd_sess_readable(ctx->hd, session));
     }
     return 1;
 }
@@ -399,6 +420,18 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
         E(TAG, LOG_FMT("Failed to allocate memory for HTTP server instance"));
         return NULL;
     }
+
+    /* Save the configuration for this instance, receive
+     * buffers can't be larger than the scratch buffer */
+    hd->config = *config;
+    if (hd->config.recv_buf_size == 0) {
+        hd->config.recv_buf_size = HTTPD_DEF_RECV_BUF_SIZE;
+    }
+    hd->config.recv_buf_size = MIN(MAX(hd->config.recv_buf_size, PARSER_BLOCK_SIZE_MIN), HTTPD_SCRATCH_BUF);
+    if (hd->config.max_pipelined_reqs == 0) {
+        hd->config.max_pipelined_reqs = 1;
+    }
+
     hd->hd_calls = calloc(config->max_uri_handlers, sizeof(httpd_uri_t *));
     if (!hd->hd_calls) {
         E(TAG, LOG_FMT("Failed to allocate memory for HTTP URI handlers"));
@@ -412,10 +445,19 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
         free(hd);
         return NULL;
     }
+    hd->hd_sd_bufs = malloc(config->max_open_sockets * hd->config.recv_buf_size);
+    if (!hd->hd_sd_bufs) {
+        E(TAG, LOG_FMT("Failed to allocate memory for HTTP session buffers"));
+        free(hd->hd_sd);
+        free(hd->hd_calls);
+        free(hd);
+        return NULL;
+    }
     struct httpd_req_aux *ra = &hd->hd_req_aux;
     ra->resp_hdrs = calloc(config->max_resp_headers, sizeof(struct resp_hdr));
     if (!ra->resp_hdrs) {
         E(TAG, LOG_FMT("Failed to allocate memory for HTTP response headers"));
+        free(hd->hd_sd_bufs);
         free(hd->hd_sd);
         free(hd->hd_calls);
         free(hd);
@@ -425,13 +467,12 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
     if (!hd->err_handler_fns) {
         E(TAG, LOG_FMT("Failed to allocate memory for HTTP error handlers"));
         free(ra->resp_hdrs);
+        free(hd->hd_sd_bufs);
         free(hd->hd_sd);
         free(hd->hd_calls);
         free(hd);
         return NULL;
     }
-    /* Save the configuration for this instance */
-    hd->config = *config;
     return hd;
 }
 
@@ -441,6 +482,7 @@ static void httpd_delete(struct httpd_data *hd)
     /* Free memory of httpd instance data */
     free(hd->err_handler_fns);
     free(ra->resp_hdrs);
+    free(hd->hd_sd_bufs);
     free(hd->hd_sd);
 
     /* Free registered URI handlers */
@@ -496,11 +538,19 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
     }
 
     httpd_sess_init(hd);
+    if (httpd_async_start(hd) != ESP_OK) {
+        close(hd->msg_fd);
+        cs_free_ctrl_sock(hd->ctrl_fd);
+        close(hd->listen_fd);
+        httpd_delete(hd);
+        return ESP_ERR_HTTPD_TASK;
+    }
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd) != ESP_OK) {
         /* Failed to launch task */
+        httpd_async_stop(hd);
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
@@ -517,6 +567,10 @@ esp_err_t httpd_stop(httpd_handle_t handle)
         return ESP_ERR_INVALID_ARG;
     }
 
+    /* Let the async workers finish the requests they own first,
+     * completing them still needs the server task running */
+    httpd_async_stop(hd);
+
     struct httpd_ctrl_data msg;
     memset(&msg, 0, sizeof(msg));
     msg.hc_msg = HTTPD_CTRL_SHUTDOWN;
@@ -628,7 +628,7 @@ static esp_err_t httpd_parse_req(struct httpd_data *hd)
     offset = 0;
     do {
         /* Read block into scratch buffer */
-        if ((blk_len = read_block(r, offset, PARSER_BLOCK_SIZE)) < 0) {
+        if ((blk_len = read_block(r, offset, hd->config.recv_buf_size)) < 0) {
             if (blk_len == HTTPD_SOCK_ERR_TIMEOUT) {
                 /* Retry read in case of non-fatal timeout error.
                  * read_block() ensures that the timeout error is
@@ -682,6 +682,7 @@ static void init_req_aux(struct httpd_req_aux *ra, httpd_config_t *config)
     ra->first_chunk_sent = 0;
     ra->req_hdrs_count = 0;
     ra->resp_hdrs_count = 0;
+    ra->uri_handler = NULL;
 #if CONFIG_HTTPD_WS_SUPPORT
     ra->ws_handshake_detect = false;
 #endif
@@ -798,6 +799,13 @@ esp_err_t httpd_req_delete(struct httpd_data *hd)
     httpd_req_t *r = &hd->hd_req;
     struct httpd_req_aux *ra = r->aux;
 
+    /* The body of a request handed over to an async worker
+     * is left for the worker, see httpd_req_async_handler_complete() */
+    if (ra->sd->for_async_req) {
+        httpd_req_cleanup(r);
+        return ESP_OK;
+    }
+
     /* Finish off reading any pending/leftover data */
     while (ra->remaining_len) {
         /* Any length small enough not to overload the stack, but large
@@ -839,6 +847,11 @@ bool httpd_validate_req_ptr(httpd_req_t *r)
             if (httpd_os_thread_handle() == hd->hd_td.handle) {
                 return true;
             }
+            /* Or this is a request copy made for an async handler */
+            struct httpd_req_aux *ra = r->aux;
+            if (r != &hd->hd_req && ra && ra->sd && ra->sd->for_async_req) {
+                return true;
+            }
         }
     }
     return false;
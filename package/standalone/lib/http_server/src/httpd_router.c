@@ -0,0 +1,445 @@
+/*
+ * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include <util_trace.h>
+#include <esp_err.h>
+#include <http_parser.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+#ifdef CONFIG_HTTPD_URI_ROUTER
+
+static const int TAG = TT_SDK_HTTPD;
+
+/* Every registered handler is hung off one or two trie nodes (two when the
+ * template ends with the optional '?' character). The sequence number
+ * records the order of registration, so that when several templates match
+ * a request the router picks the same handler the linear scan would */
+struct httpd_route_entry {
+    struct httpd_route_entry *next;
+    httpd_uri_t              *uri;
+    uint32_t                  seq;
+};
+
+/**
+ * @brief   Node of the compiled URI router
+ *
+ * Literal path characters are stored on the edges of a radix tree, i.e. the
+ * label of a node is the run of characters consumed when moving from the
+ * parent into it, and siblings never share their first character. A path
+ * parameter ("{name}") is a dedicated child consuming one whole segment.
+ */
+struct httpd_route_node {
+    char                     *label;    /*!< Literal characters on the edge into this node */
+    uint16_t                  label_len;
+    struct httpd_route_node  *children; /*!< Literal children, distinct first character */
+    struct httpd_route_node  *next;     /*!< Next sibling */
+    struct httpd_route_node  *param;    /*!< Child consuming one "{name}" segment */
+    struct httpd_route_entry *exact;    /*!< Handlers ending exactly at this node */
+    struct httpd_route_entry *tail;     /*!< Handlers ending with '*' at this node */
+};
+
+/* Key derived from a URI template, following the rules of
+ * httpd_uri_match_wildcard() for the trailing '?' and '*' */
+struct httpd_route_key {
+    const char *tpl;
+    size_t      mand_len;   /*!< Length of the mandatory part of the template */
+    bool        quest;      /*!< tpl[mand_len] is an optional character */
+    bool        asterisk;   /*!< Anything may follow */
+    bool        params;     /*!< "{name}" segments are path parameters */
+};
+
+struct httpd_route_ctx {
+    const char                     *uri;
+    size_t                          len;
+    httpd_method_t                  method;
+    const struct httpd_route_entry *best;
+    bool                            matched;
+};
+
+static struct httpd_route_node *httpd_route_node_new(const char *label, size_t label_len)
+{
+    struct httpd_route_node *node = calloc(1, sizeof(struct httpd_route_node));
+    if (!node) {
+        return NULL;
+    }
+    if (label_len) {
+        node->label = malloc(label_len);
+        if (!node->label) {
+            free(node);
+            return NULL;
+        }
+        memcpy(node->label, label, label_len);
+        node->label_len = label_len;
+    }
+    return node;
+}
+
+static void httpd_route_node_free(struct httpd_route_node *node)
+{
+    struct httpd_route_entry *e, *n;
+
+    while (node->children) {
+        struct httpd_route_node *child = node->children;
+        node->children = child->next;
+        httpd_route_node_free(child);
+    }
+    if (node->param) {
+        httpd_route_node_free(node->param);
+    }
+    for (e = node->exact; e; e = n) {
+        n = e->next;
+        free(e);
+    }
+    for (e = node->tail; e; e = n) {
+        n = e->next;
+        free(e);
+    }
+    free(node->label);
+    free(node);
+}
+
+static bool httpd_route_node_empty(const struct httpd_route_node *node)
+{
+    return !node->children && !node->param && !node->exact && !node->tail;
+}
+
+static struct httpd_route_node *httpd_route_child(const struct httpd_route_node *node, char c)
+{
+    struct httpd_route_node *child;
+
+    for (child = node->children; child; child = child->next) {
+        if (child->label[0] == c) {
+            break;
+        }
+    }
+    return child;
+}
+
+/* Split the key out of a template, returns false if the
+ * template can never match anything (such as "?") */
+static bool httpd_route_key_init(struct httpd_data *hd, const char *tpl,
+                                 struct httpd_route_key *key)
+{
+    const size_t tpl_len = strlen(tpl);
+
+    memset(key, 0, sizeof(*key));
+    key->tpl = tpl;
+    key->mand_len = tpl_len;
+
+    if (hd->config.uri_match_fn == NULL) {
+        return true;
+    }
+
+    const char last = (const char) (tpl_len > 0 ? tpl[tpl_len - 1] : 0);
+    const char prevlast = (const char) (tpl_len > 1 ? tpl[tpl_len - 2] : 0);
+    key->asterisk = last == '*' || (prevlast == '*' && last == '?');
+    key->quest = last == '?' || (prevlast == '?' && last == '*');
+    key->params = hd->config.uri_match_fn == httpd_uri_match_path_params;
+
+    if (tpl_len < key->asterisk + key->quest*2) {
+        return false;
+    }
+    key->mand_len -= key->asterisk + key->quest*2;
+    return true;
+}
+
+/* Walk (and if requested, grow) the trie along tpl[0..len) */
+static struct httpd_route_node *httpd_route_walk(struct httpd_route_node *node,
+                                                 const struct httpd_route_key *key,
+                                                 size_t len, bool create)
+{
+    const char *s = key->tpl;
+    size_t pos = 0;
+
+    while (node && pos < len) {
+        if (key->params && s[pos] == '{') {
+            const char *end = memchr(s + pos, '}', len - pos);
+            if (!end) {
+                return NULL;
+            }
+            if (!node->param && create) {
+                node->param = httpd_route_node_new(NULL, 0);
+            }
+            node = node->param;
+            pos = end - s + 1;
+            continue;
+        }
+
+        /* Literal run up to the next parameter or the end of the key */
+        size_t run = len - pos;
+        if (key->params) {
+            const char *brace = memchr(s + pos, '{', run);
+            if (brace) {
+                run = brace - (s + pos);
+            }
+        }
+
+        while (node && run) {
+            struct httpd_route_node *child = httpd_route_child(node, s[pos]);
+            if (!child) {
+                if (!create) {
+                    return NULL;
+                }
+                child = httpd_route_node_new(s + pos, run);
+                if (!child) {
+                    return NULL;
+                }
+                child->next = node->children;
+                node->children = child;
+                pos += run;
+                run = 0;
+                node = child;
+                break;
+            }
+
+            size_t common = 0;
+            while (common < child->label_len && common < run &&
+                   child->label[common] == s[pos + common]) {
+                common++;
+            }
+
+            if (common < child->label_len) {
+                if (!create) {
+                    return NULL;
+                }
+                /* Split the edge, the new node takes the common part */
+                struct httpd_route_node *mid = httpd_route_node_new(child->label, common);
+                char *rest = malloc(child->label_len - common);
+                if (!mid || !rest) {
+                    if (mid) {
+                        httpd_route_node_free(mid);
+                    }
+                    free(rest);
+                    return NULL;
+                }
+                memcpy(rest, child->label + common, child->label_len - common);
+                free(child->label);
+                child->label = rest;
+                child->label_len -= common;
+
+                struct httpd_route_node **link = &node->children;
+                while (*link != child) {
+                    link = &(*link)->next;
+                }
+                mid->next = child->next;
+                child->next = NULL;
+                mid->children = child;
+                *link = mid;
+                child = mid;
+            }
+            pos += common;
+            run -= common;
+            node = child;
+        }
+    }
+    return node;
+}
+
+static esp_err_t httpd_route_add(struct httpd_route_node *root,
+                                 const struct httpd_route_key *key, size_t len,
+                                 bool tail, httpd_uri_t *uri, uint32_t seq)
+{
+    struct httpd_route_node *node = httpd_route_walk(root, key, len, true);
+    if (!node) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
+    struct httpd_route_entry *e = malloc(sizeof(struct httpd_route_entry));
+    if (!e) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    e->uri = uri;
+    e->seq = seq;
+
+    /* Keep the list ordered by registration so the first
+     * method match found is also the one to report */
+    struct httpd_route_entry **link = tail ? &node->tail : &node->exact;
+    while (*link && (*link)->seq < seq) {
+        link = &(*link)->next;
+    }
+    e->next = *link;
+    *link = e;
+    return ESP_OK;
+}
+
+/* Unlink the entries of uri below node, pruning emptied nodes
+ * on the way back. Returns true if node itself is now empty */
+static bool httpd_route_del(struct httpd_route_node *node,
+                            const struct httpd_route_key *key,
+                            size_t pos, size_t len, bool tail,
+                            const httpd_uri_t *uri)
+{
+    const char *s = key->tpl;
+
+    if (pos == len) {
+        struct httpd_route_entry **link = tail ? &node->tail : &node->exact;
+        while (*link) {
+            if ((*link)->uri == uri) {
+                struct httpd_route_entry *e = *link;
+                *link = e->next;
+                free(e);
+                break;
+            }
+            link = &(*link)->next;
+        }
+    } else if (key->params && s[pos] == '{') {
+        const char *end = memchr(s + pos, '}', len - pos);
+        if (end && node->param &&
+            httpd_route_del(node->param, key, end - s + 1, len, tail, uri)) {
+            httpd_route_node_free(node->param);
+            node->param = NULL;
+        }
+    } else {
+        struct httpd_route_node *child = httpd_route_child(node, s[pos]);
+        if (child && child->label_len <= len - pos &&
+            memcmp(child->label, s + pos, child->label_len) == 0 &&
+            httpd_route_del(child, key, pos + child->label_len, len, tail, uri)) {
+            struct httpd_route_node **link = &node->children;
+            while (*link != child) {
+                link = &(*link)->next;
+            }
+            *link = child->next;
+            child->next = NULL;
+            httpd_route_node_free(child);
+        }
+    }
+    return httpd_route_node_empty(node);
+}
+
+static void httpd_route_consider(struct httpd_route_ctx *ctx,
+                                 const struct httpd_route_entry *e)
+{
+    for (; e; e = e->next) {
+        ctx->matched = true;
+        if (e->uri->method == ctx->method) {
+            if (!ctx->best || e->seq < ctx->best->seq) {
+                ctx->best = e;
+            }
+            /* Lists are ordered, nothing later can win */
+            return;
+        }
+    }
+}
+
+static void httpd_route_search(const struct httpd_route_node *node,
+                               struct httpd_route_ctx *ctx, size_t pos)
+{
+    /* Trailing asterisk matches whatever is left, including nothing */
+    httpd_route_consider(ctx, node->tail);
+
+    if (pos == ctx->len) {
+        httpd_route_consider(ctx, node->exact);
+        return;
+    }
+
+    const struct httpd_route_node *child = httpd_route_child(node, ctx->uri[pos]);
+    if (child && child->label_len <= ctx->len - pos &&
+        memcmp(child->label, ctx->uri + pos, child->label_len) == 0) {
+        httpd_route_search(child, ctx, pos + child->label_len);
+    }
+
+    if (node->param) {
+        size_t end = pos;
+        while (end < ctx->len && ctx->uri[end] != '/') {
+            end++;
+        }
+        if (end > pos) {
+            httpd_route_search(node->param, ctx, end);
+        }
+    }
+}
+
+bool httpd_router_enabled(struct httpd_data *hd)
+{
+    return hd->config.uri_match_fn == NULL ||
+           hd->config.uri_match_fn == httpd_uri_match_wildcard ||
+           hd->config.uri_match_fn == httpd_uri_match_path_params;
+}
+
+esp_err_t httpd_router_insert(struct httpd_data *hd, httpd_uri_t *uri)
+{
+    struct httpd_route_key key;
+    esp_err_t ret;
+
+    if (!httpd_route_key_init(hd, uri->uri, &key)) {
+        /* Never matches, same as the linear matcher */
+        return ESP_OK;
+    }
+
+    if (!hd->hd_router) {
+        hd->hd_router = httpd_route_node_new(NULL, 0);
+        if (!hd->hd_router) {
+            return ESP_ERR_HTTPD_ALLOC_MEM;
+        }
+    }
+
+    const uint32_t seq = hd->hd_router_seq++;
+
+    /* Mandatory part alone, then with the optional character */
+    ret = httpd_route_add(hd->hd_router, &key, key.mand_len,
+                          key.asterisk && !key.quest, uri, seq);
+    if (ret == ESP_OK && key.quest) {
+        ret = httpd_route_add(hd->hd_router, &key, key.mand_len + 1,
+                              key.asterisk, uri, seq);
+    }
+    if (ret != ESP_OK) {
+        httpd_router_remove(hd, uri);
+    }
+    V(TAG, LOG_FMT("route %s (seq %u) %s"), uri->uri, seq, ret == ESP_OK ? "added" : "failed");
+    return ret;
+}
+
+void httpd_router_remove(struct httpd_data *hd, const httpd_uri_t *uri)
+{
+    struct httpd_route_key key;
+
+    if (!hd->hd_router || !httpd_route_key_init(hd, uri->uri, &key)) {
+        return;
+    }
+
+    httpd_route_del(hd->hd_router, &key, 0, key.mand_len,
+                    key.asterisk && !key.quest, uri);
+    if (key.quest) {
+        httpd_route_del(hd->hd_router, &key, 0, key.mand_len + 1,
+                        key.asterisk, uri);
+    }
+}
+
+httpd_uri_t *httpd_router_find(struct httpd_data *hd,
+                               const char *uri, size_t uri_len,
+                               httpd_method_t method,
+                               httpd_err_code_t *err)
+{
+    struct httpd_route_ctx ctx = {
+        .uri    = uri,
+        .len    = uri_len,
+        .method = method,
+    };
+
+    if (hd->hd_router) {
+        httpd_route_search(hd->hd_router, &ctx, 0);
+    }
+
+    if (err) {
+        *err = ctx.best ? 0 :
+               ctx.matched ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND;
+    }
+    return ctx.best ? ctx.best->uri : NULL;
+}
+
+void httpd_router_free(struct httpd_data *hd)
+{
+    if (hd->hd_router) {
+        httpd_route_node_free(hd->hd_router);
+        hd->hd_router = NULL;
+    }
+    hd->hd_router_seq = 0;
+}
+
+#endif /* CONFIG_HTTPD_URI_ROUTER */
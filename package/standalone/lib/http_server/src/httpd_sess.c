@@ -86,7 +86,8 @@ static int enum_function(struct sock_db *session, void *context)
         break;
     // Set descriptor
     case HTTPD_TASK_SET_DESCRIPTOR:
-        if (session->fd != -1) {
+        /* Sessions owned by an async handler are not polled until it completes */
+        if (session->fd != -1 && !session->for_async_req) {
             FD_SET(session->fd, ctx->fdset);
             if (session->fd > ctx->max_fd) {
                 ctx->max_fd = session->fd;
@@ -106,8 +107,8 @@ static int enum_function(struct sock_db *session, void *context)
         if (session->fd == -1) {
             return 0;
         }
-        // Check/update lowest lru
-        if (session->lru_counter < ctx->lru_counter) {
+        // Check/update lowest lru, sessions busy with an async request can't be purged
+        if (!session->for_async_req && session->lru_counter < ctx->lru_counter) {
             ctx->lru_counter = session->lru_counter;
             ctx->session = session;
         }
@@ -198,6 +199,7 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
 
     // Clear session data
     memset(session, 0, sizeof (struct sock_db));
+    session->pending_data = hd->hd_sd_bufs + (session - hd->hd_sd) * hd->config.recv_buf_size;
     session->fd = newfd;
     session->handle = (httpd_handle_t) hd;
     session->send_fn = httpd_default_send;
@@ -407,6 +409,22 @@ bool httpd_sess_pending(struct httpd_data *hd, struct sock_db *session)
     return (session->pending_len != 0);
 }
 
+bool httpd_sess_readable(struct httpd_data *hd, struct sock_db *session)
+{
+    if (httpd_sess_pending(hd, session)) {
+        return true;
+    }
+    // Data queued on the socket can only be peeked at for plain sockets,
+    // transports overriding recv report their buffers through pending_fn
+    if (session->recv_fn == httpd_default_recv) {
+        int avail = 0;
+        if (ioctl(session->fd, FIONREAD, &avail) == 0 && avail > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /* This MUST return ESP_OK on successful execution. If any other
  * value is returned, everything related to this socket will be
  * cleaned up and the socket will be closed.
@@ -80,10 +80,51 @@ static esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
     return ESP_OK;
 }
 
+/* Appends to the response assembled in the scratch buffer, sending what
+ * is buffered first if there is no room left. A response going out in a
+ * single send is not held back by Nagle's algorithm until the client's
+ * delayed ACK, as the last of several small sends would be */
+static esp_err_t httpd_resp_buffer(httpd_req_t *r, size_t *len,
+                                   const char *buf, size_t buf_len)
+{
+    struct httpd_req_aux *ra = r->aux;
+
+    if (*len + buf_len > sizeof(ra->scratch)) {
+        if (*len && httpd_send_all(r, ra->scratch, *len) != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+        *len = 0;
+        if (buf_len > sizeof(ra->scratch)) {
+            return httpd_send_all(r, buf, buf_len) == ESP_OK ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+        }
+    }
+    memcpy(ra->scratch + *len, buf, buf_len);
+    *len += buf_len;
+    return ESP_OK;
+}
+
+/* Appends the headers set with httpd_resp_set_hdr() and the
+ * end of the header section to the essential headers */
+static esp_err_t httpd_resp_buffer_hdrs(httpd_req_t *r, size_t *len)
+{
+    struct httpd_req_aux *ra = r->aux;
+
+    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
+        if (httpd_resp_buffer(r, len, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK ||
+            httpd_resp_buffer(r, len, ": ", 2) != ESP_OK ||
+            httpd_resp_buffer(r, len, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK ||
+            httpd_resp_buffer(r, len, "\r\n", 2) != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+    }
+    return httpd_resp_buffer(r, len, "\r\n", 2);
+}
+
 static size_t httpd_recv_pending(httpd_req_t *r, char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
-    size_t offset = sizeof(ra->sd->pending_data) - ra->sd->pending_len;
+    struct httpd_data *hd = (struct httpd_data *) r->handle;
+    size_t offset = hd->config.recv_buf_size - ra->sd->pending_len;
 
     /* buf_len must not be greater than remaining_len */
     buf_len = MIN(ra->sd->pending_len, buf_len);
@@ -143,12 +184,13 @@ int httpd_recv(httpd_req_t *r, char *buf, size_t buf_len)
 size_t httpd_unrecv(struct httpd_req *r, const char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
+    struct httpd_data *hd = (struct httpd_data *) r->handle;
     /* Truncate if external buf_len is greater than pending_data buffer size */
-    ra->sd->pending_len = MIN(sizeof(ra->sd->pending_data), buf_len);
+    ra->sd->pending_len = MIN(hd->config.recv_buf_size, buf_len);
 
     /* Copy data into internal pending_data buffer with the exact offset
      * such that it is right aligned inside the buffer */
-    size_t offset = sizeof(ra->sd->pending_data) - ra->sd->pending_len;
+    size_t offset = hd->config.recv_buf_size - ra->sd->pending_len;
     memcpy(ra->sd->pending_data + offset, buf, ra->sd->pending_len);
     V(TAG, LOG_FMT("length = %d"), ra->sd->pending_len);
     return ra->sd->pending_len;
@@ -235,8 +277,7 @@ esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
 
     struct httpd_req_aux *ra = r->aux;
     const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
+    size_t len;
 
     if (buf_len == HTTPD_RESP_USE_STRLEN) {
         buf_len = strlen(buf);
@@ -250,43 +291,22 @@ esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
                  ra->status, ra->content_type, buf_len) >= sizeof(ra->scratch)) {
         return ESP_ERR_HTTPD_RESP_HDR;
     }
+    len = strlen(ra->scratch);
 
-    /* Sending essential headers */
-    if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
+    /* Additional headers based on set_header, then the content */
+    if (httpd_resp_buffer_hdrs(r, &len) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
-
-    /* Sending additional headers based on set_header */
-    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-        /* Send header field */
-        if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send ': ' */
-        if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send header value */
-        if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send CR + LF */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
+    if (buf && buf_len) {
+        if (httpd_resp_buffer(r, &len, buf, buf_len) != ESP_OK) {
             return ESP_ERR_HTTPD_RESP_SEND;
         }
     }
 
-    /* End header section */
-    if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
+    /* Sending what is left buffered */
+    if (len && httpd_send_all(r, ra->scratch, len) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
-
-    /* Sending content */
-    if (buf && buf_len) {
-        if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-    }
     return ESP_OK;
 }
 
@@ -306,8 +326,7 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len
 
     struct httpd_req_aux *ra = r->aux;
     const char *httpd_chunked_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
+    size_t len = 0;
 
     /* Request headers are no longer available */
     ra->req_hdrs_count = 0;
@@ -318,57 +337,36 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len
                      ra->status, ra->content_type) >= sizeof(ra->scratch)) {
             return ESP_ERR_HTTPD_RESP_HDR;
         }
+        len = strlen(ra->scratch);
 
-        /* Sending essential headers */
-        if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-
-        /* Sending additional headers based on set_header */
-        for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-            /* Send header field */
-            if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send ': ' */
-            if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send header value */
-            if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send CR + LF */
-            if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-        }
-
-        /* End header section */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
+        /* Additional headers based on set_header */
+        if (httpd_resp_buffer_hdrs(r, &len) != ESP_OK) {
             return ESP_ERR_HTTPD_RESP_SEND;
         }
         ra->first_chunk_sent = true;
     }
 
-    /* Sending chunked content */
+    /* Chunked content, sent along with the headers if it fits */
     char len_str[10];
     snprintf(len_str, sizeof(len_str), "%lx\r\n", (long)buf_len);
-    if (httpd_send_all(r, len_str, strlen(len_str)) != ESP_OK) {
+    if (httpd_resp_buffer(r, &len, len_str, strlen(len_str)) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
 
     if (buf) {
-        if (httpd_send_all(r, buf, (size_t) buf_len) != ESP_OK) {
+        if (httpd_resp_buffer(r, &len, buf, (size_t) buf_len) != ESP_OK) {
             return ESP_ERR_HTTPD_RESP_SEND;
         }
     }
 
     /* Indicate end of chunk */
-    if (httpd_send_all(r, "\r\n", strlen("\r\n")) != ESP_OK) {
+    if (httpd_resp_buffer(r, &len, "\r\n", 2) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
 
+    if (len && httpd_send_all(r, ra->scratch, len) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
     return ESP_OK;
 }
 
@@ -437,35 +435,9 @@ esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const ch
     httpd_resp_set_status(req, status);
     httpd_resp_set_type(req, HTTPD_TYPE_TEXT);
 
-#ifdef CONFIG_HTTPD_ERR_RESP_NO_DELAY
-    /* Use TCP_NODELAY option to force socket to send data in buffer
-     * This ensures that the error message is sent before the socket
-     * is closed */
-    struct httpd_req_aux *ra = req->aux;
-    int nodelay = 1;
-    if (setsockopt(ra->sd->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) < 0) {
-        /* If failed to turn on TCP_NODELAY, throw warning and continue */
-        E(TAG, LOG_FMT("error calling setsockopt : %d"), errno);
-        nodelay = 0;
-    }
-#endif
-
     /* Send HTTP error message */
     ret = httpd_resp_send(req, msg, HTTPD_RESP_USE_STRLEN);
 
-#ifdef CONFIG_HTTPD_ERR_RESP_NO_DELAY
-    /* If TCP_NODELAY was set successfully above, time to disable it */
-    if (nodelay == 1) {
-        nodelay = 0;
-        if (setsockopt(ra->sd->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) < 0) {
-            /* If failed to turn off TCP_NODELAY, throw error and
-             * return failure to signal for socket closure */
-            E(TAG, LOG_FMT("error calling setsockopt : %d"), errno);
-            return ESP_ERR_INVALID_STATE;
-        }
-    }
-#endif
-
     return ret;
 }
 
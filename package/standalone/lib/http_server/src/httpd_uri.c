@@ -79,6 +79,94 @@ bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
     }
 }
 
+/* Match template (without trailing '?' and '*') against the start of the URI,
+ * where each "{name}" consumes one non-empty path segment. On success the
+ * number of URI characters consumed is returned through 'consumed' */
+static bool httpd_uri_match_segments(const char *template, size_t tpl_len,
+                                     const char *uri, size_t len, size_t *consumed)
+{
+    size_t t = 0, u = 0;
+
+    while (t < tpl_len) {
+        if (template[t] == '{') {
+            const char *end = memchr(template + t, '}', tpl_len - t);
+            if (!end) {
+                return false;
+            }
+            const size_t start = u;
+            while (u < len && uri[u] != '/') {
+                u++;
+            }
+            if (u == start) {
+                /* parameter can't be empty */
+                return false;
+            }
+            t = end - template + 1;
+        } else {
+            if (u >= len || template[t] != uri[u]) {
+                return false;
+            }
+            t++;
+            u++;
+        }
+    }
+    *consumed = u;
+    return true;
+}
+
+bool httpd_uri_match_path_params(const char *template, const char *uri, size_t len)
+{
+    const size_t tpl_len = strlen(template);
+    size_t exact_match_chars = tpl_len;
+    size_t matched;
+
+    /* Trailing question mark and asterisk work as in httpd_uri_match_wildcard() */
+    const char last = (const char) (tpl_len > 0 ? template[tpl_len - 1] : 0);
+    const char prevlast = (const char) (tpl_len > 1 ? template[tpl_len - 2] : 0);
+    const bool asterisk = last == '*' || (prevlast == '*' && last == '?');
+    const bool quest = last == '?' || (prevlast == '?' && last == '*');
+
+    if (exact_match_chars < asterisk + quest*2) {
+        return false;
+    }
+    exact_match_chars -= asterisk + quest*2;
+
+    if (!httpd_uri_match_segments(template, exact_match_chars, uri, len, &matched)) {
+        return false;
+    }
+
+    if (!quest) {
+        return asterisk || matched == len;
+    }
+    if (len > matched && template[exact_match_chars] != uri[matched]) {
+        /* the optional character is present, but different */
+        return false;
+    }
+    return asterisk || len <= matched + 1;
+}
+
+/* Path parameters must span a whole segment, i.e. "/sta/{mac}/rssi"
+ * or "/sta/{mac}" but not "/sta-{mac}" or "/sta/{mac}.json" */
+static bool httpd_uri_path_params_valid(const char *template)
+{
+    const char *p = template;
+
+    while ((p = strchr(p, '{')) != NULL) {
+        if (p != template && p[-1] != '/') {
+            return false;
+        }
+        const char *end = strpbrk(p + 1, "{}/");
+        if (!end || *end != '}' || end == p + 1) {
+            return false;
+        }
+        p = end + 1;
+        if (*p != '\0' && *p != '/' && strcmp(p, "*") != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /* Find handler with matching URI and method, and set
  * appropriate error code if URI or method not found */
 static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
@@ -86,6 +174,12 @@ static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
                                            httpd_method_t method,
                                            httpd_err_code_t *err)
 {
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    if (httpd_router_enabled(hd)) {
+        return httpd_router_find(hd, uri, uri_len, method, err);
+    }
+#endif
+
     if (err) {
         *err = HTTPD_404_NOT_FOUND;
     }
@@ -131,6 +225,12 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
 
     struct httpd_data *hd = (struct httpd_data *) handle;
 
+    if (hd->config.uri_match_fn == httpd_uri_match_path_params &&
+        !httpd_uri_path_params_valid(uri_handler->uri)) {
+        E(TAG, LOG_FMT("invalid path parameter in %s"), uri_handler->uri);
+        return ESP_ERR_INVALID_ARG;
+    }
+
     /* Make sure another handler with matching URI and method
      * is not already registered. This will also catch cases
      * when a registered URI wildcard pattern already accounts
@@ -143,42 +243,56 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
         return ESP_ERR_HTTPD_HANDLER_EXISTS;
     }
 
-    for (int i = 0; i < hd->config.max_uri_handlers; i++) {
-        if (hd->hd_calls[i] == NULL) {
-            hd->hd_calls[i] = malloc(sizeof(httpd_uri_t));
-            if (hd->hd_calls[i] == NULL) {
-                /* Failed to allocate memory */
-                return ESP_ERR_HTTPD_ALLOC_MEM;
-            }
+    /* Handlers are kept packed at the start of the array */
+    int i = hd->hd_calls_count;
+    if (i >= hd->config.max_uri_handlers) {
+        E(TAG, LOG_FMT("no slots left for registering handler"));
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
 
-            /* Copy URI string */
-            hd->hd_calls[i]->uri = strdup(uri_handler->uri);
-            if (hd->hd_calls[i]->uri == NULL) {
-                /* Failed to allocate memory */
-                free(hd->hd_calls[i]);
-                return ESP_ERR_HTTPD_ALLOC_MEM;
-            }
+    hd->hd_calls[i] = malloc(sizeof(httpd_uri_t));
+    if (hd->hd_calls[i] == NULL) {
+        /* Failed to allocate memory */
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
+    /* Copy URI string */
+    hd->hd_calls[i]->uri = strdup(uri_handler->uri);
+    if (hd->hd_calls[i]->uri == NULL) {
+        /* Failed to allocate memory */
+        free(hd->hd_calls[i]);
+        hd->hd_calls[i] = NULL;
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
 
-            /* Copy remaining members */
-            hd->hd_calls[i]->method   = uri_handler->method;
-            hd->hd_calls[i]->handler  = uri_handler->handler;
-            hd->hd_calls[i]->user_ctx = uri_handler->user_ctx;
+    /* Copy remaining members */
+    hd->hd_calls[i]->method   = uri_handler->method;
+    hd->hd_calls[i]->handler  = uri_handler->handler;
+    hd->hd_calls[i]->user_ctx = uri_handler->user_ctx;
+    hd->hd_calls[i]->is_async = uri_handler->is_async;
 #ifdef CONFIG_HTTPD_WS_SUPPORT
-            hd->hd_calls[i]->is_websocket = uri_handler->is_websocket;
-            hd->hd_calls[i]->handle_ws_control_frames = uri_handler->handle_ws_control_frames;
-            if (uri_handler->supported_subprotocol) {
-                hd->hd_calls[i]->supported_subprotocol = strdup(uri_handler->supported_subprotocol);
-            } else {
-                hd->hd_calls[i]->supported_subprotocol = NULL;
-            }
+    hd->hd_calls[i]->is_websocket = uri_handler->is_websocket;
+    hd->hd_calls[i]->handle_ws_control_frames = uri_handler->handle_ws_control_frames;
+    if (uri_handler->supported_subprotocol) {
+        hd->hd_calls[i]->supported_subprotocol = strdup(uri_handler->supported_subprotocol);
+    } else {
+        hd->hd_calls[i]->supported_subprotocol = NULL;
+    }
 #endif
-            V(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
-            return ESP_OK;
-        }
-        V(TAG, LOG_FMT("[%d] exists %s"), i, hd->hd_calls[i]->uri);
+
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    if (httpd_router_enabled(hd) &&
+        httpd_router_insert(hd, hd->hd_calls[i]) != ESP_OK) {
+        E(TAG, LOG_FMT("failed to add route for %s"), uri_handler->uri);
+        free((char*)hd->hd_calls[i]->uri);
+        free(hd->hd_calls[i]);
+        hd->hd_calls[i] = NULL;
+        return ESP_ERR_HTTPD_ALLOC_MEM;
     }
-    E(TAG, LOG_FMT("no slots left for registering handler"));
-    return ESP_ERR_HTTPD_HANDLERS_FULL;
+#endif
+    hd->hd_calls_count++;
+    V(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
+    return ESP_OK;
 }
 
 esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
@@ -197,9 +311,13 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
             (strcmp(hd->hd_calls[i]->uri, uri) == 0)) {  // Then match URI string
             V(TAG, LOG_FMT("[%d] removing %s"), i, hd->hd_calls[i]->uri);
 
+#ifdef CONFIG_HTTPD_URI_ROUTER
+            httpd_router_remove(hd, hd->hd_calls[i]);
+#endif
             free((char*)hd->hd_calls[i]->uri);
             free(hd->hd_calls[i]);
             hd->hd_calls[i] = NULL;
+            hd->hd_calls_count--;
 
             /* Shift the remaining non null handlers in the array
              * forward by 1 so that order of insertion is maintained */
@@ -235,6 +353,9 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
         if (strcmp(hd->hd_calls[i]->uri, uri) == 0) {   // Match URI strings
             V(TAG, LOG_FMT("[%d] removing %s"), i, uri);
 
+#ifdef CONFIG_HTTPD_URI_ROUTER
+            httpd_router_remove(hd, hd->hd_calls[i]);
+#endif
             free((char*)hd->hd_calls[i]->uri);
             free(hd->hd_calls[i]);
             hd->hd_calls[i] = NULL;
@@ -251,6 +372,7 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
     for (int k = (i - j); k < i; k++) {
         hd->hd_calls[k] = NULL;
     }
+    hd->hd_calls_count -= j;
 
     if (!found) {
         E(TAG, LOG_FMT("no handler found for URI %s"), uri);
@@ -270,6 +392,65 @@ void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
         free(hd->hd_calls[i]);
         hd->hd_calls[i] = NULL;
     }
+    hd->hd_calls_count = 0;
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    httpd_router_free(hd);
+#endif
+}
+
+esp_err_t httpd_req_get_path_param(httpd_req_t *r, const char *name, char *val, size_t val_size)
+{
+    if (r == NULL || name == NULL || val == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct httpd_data      *hd  = (struct httpd_data *) r->handle;
+    struct httpd_req_aux   *ra  = r->aux;
+    struct http_parser_url *res = &ra->url_parse_res;
+
+    if (hd->config.uri_match_fn != httpd_uri_match_path_params ||
+        ra->uri_handler == NULL || !(res->field_set & (1 << UF_PATH))) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const char  *tpl  = ra->uri_handler->uri;
+    const char  *path = r->uri + res->field_data[UF_PATH].off;
+    const size_t len  = res->field_data[UF_PATH].len;
+    const size_t name_len = strlen(name);
+    size_t u = 0;
+
+    /* The handler template already matched, so literal characters
+     * can be skipped in step and only the parameters measured */
+    for (const char *t = tpl; *t && *t != '*' && *t != '?' && u < len; ) {
+        if (*t != '{') {
+            t++;
+            u++;
+            continue;
+        }
+
+        const char *end = strchr(t, '}');
+        const size_t start = u;
+        while (u < len && path[u] != '/') {
+            u++;
+        }
+        if ((size_t)(end - t - 1) == name_len && strncmp(t + 1, name, name_len) == 0) {
+            /* Minimum required buffer len for keeping
+             * null terminated value string */
+            size_t min_buf_len = u - start + 1;
+
+            strlcpy(val, path + start, MIN(val_size, min_buf_len));
+            if (val_size < min_buf_len) {
+                return ESP_ERR_HTTPD_RESULT_TRUNC;
+            }
+            return ESP_OK;
+        }
+        t = end + 1;
+    }
+    return ESP_ERR_NOT_FOUND;
 }
 
 esp_err_t httpd_uri(struct httpd_data *hd)
@@ -306,6 +487,7 @@ esp_err_t httpd_uri(struct httpd_data *hd)
 
     /* Attach user context data (passed during URI registration) into request */
     req->user_ctx = uri->user_ctx;
+    hd->hd_req_aux.uri_handler = uri;
 
     /* Final step for a WebSocket handshake verification */
 #ifdef CONFIG_HTTPD_WS_SUPPORT
@@ -324,6 +506,12 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     }
 #endif
 
+    /* Long handlers may run on an async worker, which then owns the
+     * session. Without a free worker the handler is run right here */
+    if (uri->is_async && httpd_async_dispatch(hd, req, uri->handler) == ESP_OK) {
+        return ESP_OK;
+    }
+
     /* Invoke handler */
     if (uri->handler(req) != ESP_OK) {
         /* Handler returns error, this socket should be closed */
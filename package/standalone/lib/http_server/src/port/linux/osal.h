@@ -0,0 +1,63 @@
+/*
+ * SPDX-FileCopyrightText: 2018-2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _OSAL_H_
+#define _OSAL_H_
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OS_SUCCESS ESP_OK
+#define OS_FAIL    ESP_FAIL
+
+/* Host build (see host/), tasks are plain POSIX threads */
+typedef pthread_t othread_t;
+
+static inline int httpd_os_thread_create(othread_t *thread,
+                                 const char *name, uint16_t stacksize, int prio,
+                                 void (*thread_routine)(void *arg), void *arg)
+{
+    pthread_attr_t attr;
+    int ret;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    ret = pthread_create(thread, &attr, (void *(*)(void *)) thread_routine, arg);
+    pthread_attr_destroy(&attr);
+    if (ret == 0) {
+        return OS_SUCCESS;
+    }
+    return OS_FAIL;
+}
+
+/* Only self delete is supported */
+static inline void httpd_os_thread_delete(void)
+{
+    pthread_exit(NULL);
+}
+
+static inline void httpd_os_thread_sleep(int msecs)
+{
+    usleep(msecs * 1000);
+}
+
+static inline othread_t httpd_os_thread_handle(void)
+{
+    return pthread_self();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ! _OSAL_H_ */
@@ -1,4 +1,3 @@
 #define CONFIG_HTTPD_MAX_REQ_HDR_LEN 512
 #define CONFIG_HTTPD_MAX_URI_LEN 512
-#define CONFIG_HTTPD_ERR_RESP_NO_DELAY 1
 #define CONFIG_HTTPD_PURGE_BUF_LEN 32
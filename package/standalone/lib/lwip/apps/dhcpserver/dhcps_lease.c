@@ -0,0 +1,422 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+
+#include "dhcps_lease.h"
+
+#include <string.h>
+
+#if LWIP_IPV4 && LWIP_DHCPS
+
+#define LEASE_NONE		0xffff
+
+#define LEASE_FREE		0
+#define LEASE_OFFERED	1
+#define LEASE_BOUND		2
+
+#define LEASE_WORDS		((DHCPS_MAX_LEASE + 31) / 32)
+
+#if (DHCPS_LEASE_BUCKETS & (DHCPS_LEASE_BUCKETS - 1)) != 0
+#error "DHCPS_LEASE_BUCKETS must be a power of 2"
+#endif
+
+struct lease {
+	u8_t mac[6];
+	u8_t state;
+	u16_t hash_next;
+	u16_t wheel_next;
+	u16_t wheel_prev;
+	u32_t expiry;
+};
+
+/* Lease i holds address lease_start + i */
+static struct lease leases[DHCPS_MAX_LEASE];
+static u32_t lease_used[LEASE_WORDS];
+static u16_t lease_hash[DHCPS_LEASE_BUCKETS];
+static u16_t lease_wheel[DHCPS_LEASE_WHEEL];
+static u32_t lease_dirty[(DHCPS_LEASE_CHUNKS + 31) / 32];
+static u32_t lease_start;		/* host order */
+static u16_t lease_num;
+static u16_t lease_inuse;
+static u16_t lease_cursor;		/* where the search for a free address starts */
+static u32_t lease_clock;		/* last second expired */
+
+static u16_t lease_bucket(const u8_t *mac)
+{
+	u32_t h = ((u32_t)mac[2] << 24) | ((u32_t)mac[3] << 16) | ((u32_t)mac[4] << 8) | mac[5];
+
+	h ^= ((u32_t)mac[0] << 8) | mac[1];
+	h *= 2654435761UL;
+	return (u16_t)((h ^ (h >> 16)) & (DHCPS_LEASE_BUCKETS - 1));
+}
+
+static u16_t lease_lookup(const u8_t *mac)
+{
+	u16_t i = lease_hash[lease_bucket(mac)];
+
+	while (i != LEASE_NONE && memcmp(leases[i].mac, mac, 6) != 0)
+		i = leases[i].hash_next;
+	return i;
+}
+
+static void lease_mark_dirty(u16_t i)
+{
+	u16_t chunk = i / DHCPS_LEASE_CHUNK;
+
+	lease_dirty[chunk / 32] |= 1UL << (chunk % 32);
+}
+
+static void lease_wheel_add(u16_t i, u32_t expiry)
+{
+	u16_t slot = expiry % DHCPS_LEASE_WHEEL;
+	struct lease *l = &leases[i];
+
+	l->expiry = expiry;
+	l->wheel_prev = LEASE_NONE;
+	l->wheel_next = lease_wheel[slot];
+	if (l->wheel_next != LEASE_NONE)
+		leases[l->wheel_next].wheel_prev = i;
+	lease_wheel[slot] = i;
+}
+
+static void lease_wheel_del(u16_t i)
+{
+	struct lease *l = &leases[i];
+
+	if (l->wheel_prev != LEASE_NONE)
+		leases[l->wheel_prev].wheel_next = l->wheel_next;
+	else
+		lease_wheel[l->expiry % DHCPS_LEASE_WHEEL] = l->wheel_next;
+	if (l->wheel_next != LEASE_NONE)
+		leases[l->wheel_next].wheel_prev = l->wheel_prev;
+}
+
+static void lease_alloc(u16_t i, const u8_t *mac, u8_t state, u32_t expiry)
+{
+	struct lease *l = &leases[i];
+	u16_t b = lease_bucket(mac);
+
+	memcpy(l->mac, mac, 6);
+	l->state = state;
+	l->hash_next = lease_hash[b];
+	lease_hash[b] = i;
+	lease_wheel_add(i, expiry);
+	lease_used[i / 32] |= 1UL << (i % 32);
+	lease_inuse++;
+}
+
+static void lease_free(u16_t i)
+{
+	struct lease *l = &leases[i];
+	u16_t *p = &lease_hash[lease_bucket(l->mac)];
+
+	while (*p != i)
+		p = &leases[*p].hash_next;
+	*p = l->hash_next;
+
+	lease_wheel_del(i);
+	if (l->state == LEASE_BOUND)
+		lease_mark_dirty(i);
+	l->state = LEASE_FREE;
+	lease_used[i / 32] &= ~(1UL << (i % 32));
+	lease_inuse--;
+}
+
+static bool lease_is_used(u16_t i)
+{
+	return (lease_used[i / 32] >> (i % 32)) & 1;
+}
+
+/* First free address from the cursor on, so that a released address is
+   not handed out again at once */
+static u16_t lease_find_free(void)
+{
+	u16_t words = (lease_num + 31) / 32;
+	u16_t w = lease_cursor / 32;
+	u16_t n;
+
+	for (n = 0; n <= words; n++, w = (w + 1) % words) {
+		u32_t free = ~lease_used[w];
+		u16_t i;
+
+		/* the first word from the cursor, the last one only up to lease_num */
+		if (n == 0)
+			free &= ~0UL << (lease_cursor % 32);
+		if (w == words - 1 && lease_num % 32)
+			free &= (1UL << (lease_num % 32)) - 1;
+		if (free == 0)
+			continue;
+		i = w * 32 + __builtin_ctz(free);
+		lease_cursor = (i + 1) % lease_num;
+		return i;
+	}
+	return LEASE_NONE;
+}
+
+/* The lease of the first non-empty wheel slot that expires first */
+static u16_t lease_find_oldest(void)
+{
+	u16_t best = LEASE_NONE;
+	u16_t n, i;
+
+	for (n = 1; n <= DHCPS_LEASE_WHEEL && best == LEASE_NONE; n++) {
+		i = lease_wheel[(lease_clock + n) % DHCPS_LEASE_WHEEL];
+		for (; i != LEASE_NONE; i = leases[i].wheel_next) {
+			if (best == LEASE_NONE || (s32_t)(leases[i].expiry - leases[best].expiry) < 0)
+				best = i;
+		}
+	}
+	return best;
+}
+
+static u16_t lease_offset(const ip4_addr_t *ip)
+{
+	u32_t off = lwip_ntohl(ip4_addr_get_u32(ip)) - lease_start;
+
+	return off < lease_num ? (u16_t)off : LEASE_NONE;
+}
+
+static void lease_addr(u16_t i, ip4_addr_t *ip)
+{
+	ip4_addr_set_u32(ip, lwip_htonl(lease_start + i));
+}
+
+void dhcps_lease_table_init(const ip4_addr_t *start, u16_t num)
+{
+	memset(leases, 0, sizeof(leases));
+	memset(lease_used, 0, sizeof(lease_used));
+	memset(lease_hash, 0xff, sizeof(lease_hash));
+	memset(lease_wheel, 0xff, sizeof(lease_wheel));
+	memset(lease_dirty, 0, sizeof(lease_dirty));
+	lease_start = lwip_ntohl(ip4_addr_get_u32(start));
+	lease_num = LWIP_MIN(num, DHCPS_MAX_LEASE);
+	lease_inuse = 0;
+	lease_cursor = 0;
+}
+
+int dhcps_lease_offer(const u8_t *mac, ip4_addr_t *ip, u32_t now)
+{
+	u16_t i = lease_lookup(mac);
+
+	if (i != LEASE_NONE) {
+		if (leases[i].state == LEASE_OFFERED) {
+			lease_wheel_del(i);
+			lease_wheel_add(i, now + DHCPS_OFFER_SECS);
+		}
+		lease_addr(i, ip);
+		return DHCPS_LEASE_OK;
+	}
+
+	if (lease_num == 0)
+		return DHCPS_LEASE_FULL;
+	i = lease_find_free();
+	if (i == LEASE_NONE) {
+		i = lease_find_oldest();
+		if (i == LEASE_NONE)
+			return DHCPS_LEASE_FULL;
+		lease_free(i);
+	}
+	lease_alloc(i, mac, LEASE_OFFERED, now + DHCPS_OFFER_SECS);
+	lease_addr(i, ip);
+	return DHCPS_LEASE_OK;
+}
+
+int dhcps_lease_bind(const u8_t *mac, const ip4_addr_t *ip, u32_t now, u32_t secs)
+{
+	u16_t off = lease_offset(ip);
+	u16_t i = lease_lookup(mac);
+
+	if (secs == 0)
+		secs = 1;
+
+	if (i != LEASE_NONE) {
+		if (i != off)
+			return DHCPS_LEASE_WRONG;
+		if (leases[i].state != LEASE_BOUND) {
+			leases[i].state = LEASE_BOUND;
+			lease_mark_dirty(i);
+		}
+		lease_wheel_del(i);
+		lease_wheel_add(i, now + secs);
+		return DHCPS_LEASE_OK;
+	}
+
+	if (off == LEASE_NONE || lease_is_used(off))
+		return DHCPS_LEASE_WRONG;
+	lease_alloc(off, mac, LEASE_BOUND, now + secs);
+	lease_mark_dirty(off);
+	return DHCPS_LEASE_OK;
+}
+
+void dhcps_lease_release(const u8_t *mac)
+{
+	u16_t i = lease_lookup(mac);
+
+	if (i != LEASE_NONE)
+		lease_free(i);
+}
+
+bool dhcps_lease_find(const u8_t *mac, ip4_addr_t *ip)
+{
+	u16_t i = lease_lookup(mac);
+
+	if (i == LEASE_NONE)
+		return false;
+	lease_addr(i, ip);
+	return true;
+}
+
+void dhcps_lease_tick(u32_t now)
+{
+	u32_t steps = now - lease_clock;
+	u16_t i, next;
+
+	if (steps > DHCPS_LEASE_WHEEL)
+		steps = DHCPS_LEASE_WHEEL;
+
+	while (steps--) {
+		lease_clock = now - steps;
+		for (i = lease_wheel[lease_clock % DHCPS_LEASE_WHEEL]; i != LEASE_NONE; i = next) {
+			next = leases[i].wheel_next;
+			/* later rounds of the wheel stay */
+			if ((s32_t)(leases[i].expiry - now) <= 0)
+				lease_free(i);
+		}
+	}
+	lease_clock = now;
+}
+
+u16_t dhcps_lease_count(void)
+{
+	return lease_inuse;
+}
+
+static void lease_view(u16_t i, struct dhcps_pool *pool, u32_t now)
+{
+	const struct lease *l = &leases[i];
+
+	lease_addr(i, &pool->ip);
+	memcpy(pool->mac, l->mac, 6);
+	pool->lease_timer = (s32_t)(l->expiry - now) > 0 ? l->expiry - now : 0;
+	pool->bound = l->state == LEASE_BOUND;
+}
+
+void dhcps_lease_foreach(void (*fn)(const struct dhcps_pool *lease, void *arg), void *arg,
+						 u32_t now)
+{
+	struct dhcps_pool pool;
+	u16_t i;
+
+	for (i = 0; i < lease_num; i++) {
+		if (lease_is_used(i)) {
+			lease_view(i, &pool, now);
+			fn(&pool, arg);
+		}
+	}
+}
+
+int dhcps_lease_dirty(int from)
+{
+	int chunk;
+
+	for (chunk = LWIP_MAX(from, 0); chunk < DHCPS_LEASE_CHUNKS; chunk++) {
+		if ((lease_dirty[chunk / 32] >> (chunk % 32)) & 1)
+			return chunk;
+	}
+	return -1;
+}
+
+static void put_le32(u8_t *p, u32_t v)
+{
+	p[0] = (u8_t)v;
+	p[1] = (u8_t)(v >> 8);
+	p[2] = (u8_t)(v >> 16);
+	p[3] = (u8_t)(v >> 24);
+}
+
+static u32_t get_le32(const u8_t *p)
+{
+	return p[0] | ((u32_t)p[1] << 8) | ((u32_t)p[2] << 16) | ((u32_t)p[3] << 24);
+}
+
+size_t dhcps_lease_save(int chunk, u8_t *buf, u32_t now)
+{
+	struct dhcps_pool pool;
+	u8_t *rec = buf + 2;
+	u16_t i, end;
+	u8_t count = 0;
+
+	lease_dirty[chunk / 32] &= ~(1UL << (chunk % 32));
+
+	end = LWIP_MIN((chunk + 1) * DHCPS_LEASE_CHUNK, lease_num);
+	for (i = chunk * DHCPS_LEASE_CHUNK; i < end; i++) {
+		if (!lease_is_used(i) || leases[i].state != LEASE_BOUND)
+			continue;
+		lease_view(i, &pool, now);
+		memcpy(rec, pool.mac, 6);
+		memcpy(rec + 6, &pool.ip.addr, 4);
+		put_le32(rec + 10, pool.lease_timer);
+		rec += DHCPS_LEASE_RECORD;
+		count++;
+	}
+
+	buf[0] = DHCPS_LEASE_VERSION;
+	buf[1] = count;
+	return rec - buf;
+}
+
+int dhcps_lease_restore(int chunk, const u8_t *buf, size_t len, u32_t now)
+{
+	const u8_t *rec = buf + 2;
+	int restored = 0;
+	u8_t n;
+
+	if (len < 2 || buf[0] != DHCPS_LEASE_VERSION || len < 2 + buf[1] * DHCPS_LEASE_RECORD)
+		return -1;
+
+	for (n = 0; n < buf[1]; n++, rec += DHCPS_LEASE_RECORD) {
+		ip4_addr_t ip;
+		u32_t secs = get_le32(rec + 10);
+		u16_t i;
+
+		memcpy(&ip.addr, rec + 6, 4);
+		i = lease_offset(&ip);
+		if (i == LEASE_NONE || secs == 0 || lease_is_used(i) || lease_lookup(rec) != LEASE_NONE)
+			continue;
+		lease_alloc(i, rec, LEASE_BOUND, now + secs);
+		restored++;
+		/* the pool moved, the lease is saved with another chunk now */
+		if (i / DHCPS_LEASE_CHUNK != chunk) {
+			lease_mark_dirty(i);
+			if (chunk >= 0 && chunk < DHCPS_LEASE_CHUNKS)
+				lease_dirty[chunk / 32] |= 1UL << (chunk % 32);
+		}
+	}
+	return restored;
+}
+
+#endif /* LWIP_IPV4 && LWIP_DHCPS */
@@ -34,90 +34,122 @@ static struct udp_pcb* pcb_dhcps = NULL;
 static ip_addr_t broadcast_dhcps;
 static ip4_addr_t server_address;
 static ip4_addr_t client_address;//added
-static ip4_addr_t client_address_plus;
 
 static struct dhcps_lease dhcps_lease;
-static list_node* plist = NULL;
 static u8_t offer = 0xFF;
-static bool renew = false;
 #define DHCPS_LEASE_TIME_DEF	(120)
 u32_t dhcps_lease_time = DHCPS_LEASE_TIME_DEF;  //minute
 
 static struct netif *softap_if = NULL; // SOFTAP_IF network interface
 
+#ifdef NRC_LWIP
+#define DHCPS_PCB(netif)	((netif)->dhcps_pcb)
+#else
+/* struct netif of plain lwIP (unit tests) has no dhcps_pcb */
+#define DHCPS_PCB(netif)	(pcb_dhcps)
+#endif
+
+/* Seconds counted by dhcps_coarse_tmr(), the clock of the lease table */
+static u32_t dhcps_clock;
+
+#if defined(SUPPORT_NVS_FLASH) && DHCPS_LEASE_PERSIST
+#include "nvs.h"
+
+/* Chunk n of the lease table is saved under "dhcps_l<n>" */
+#define DHCPS_NVS_KEY	"dhcps_l%d"
+
+static u16_t dhcps_changes;
+static u32_t dhcps_changed_at;
+
 /******************************************************************************
- * FunctionName : node_insert_to_list
- * Description  : insert the node to the list
- * Parameters   : phead -- the head node of the list
- *                pinsert -- the insert node of the list
+ * FunctionName : dhcps_lease_load
+ * Description  : restore the leases saved before a restart
+ * Parameters   : none
  * Returns      : none
 *******************************************************************************/
-void node_insert_to_list(list_node** phead, list_node* pinsert)
+static void dhcps_lease_load(void)
 {
-	list_node* plist = NULL;
-	struct dhcps_pool* pdhcps_pool = NULL;
-	struct dhcps_pool* pdhcps_node = NULL;
+	static u8_t buf[DHCPS_LEASE_CHUNK_SIZE];
+	nvs_handle_t handle;
+	char key[NVS_KEY_NAME_MAX_SIZE];
+	int chunk, restored = 0;
 
-	if (*phead == NULL) {
-		*phead = pinsert;
-	} else {
-		plist = *phead;
-		pdhcps_node = pinsert->pnode;
-		pdhcps_pool = plist->pnode;
-
-		if (pdhcps_node->ip.addr < pdhcps_pool->ip.addr) {
-			pinsert->pnext = plist;
-			*phead = pinsert;
-		} else {
-			while (plist->pnext != NULL) {
-				pdhcps_pool = plist->pnext->pnode;
-
-				if (pdhcps_node->ip.addr < pdhcps_pool->ip.addr) {
-					pinsert->pnext = plist->pnext;
-					plist->pnext = pinsert;
-					break;
-				}
-				plist = plist->pnext;
-			}
+	if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READONLY, &handle) != NVS_OK)
+		return;
 
-			if (plist->pnext == NULL) {
-				plist->pnext = pinsert;
-			}
-		}
+	for (chunk = 0; chunk < DHCPS_LEASE_CHUNKS; chunk++) {
+		size_t len = sizeof(buf);
+		int n;
+
+		snprintf(key, sizeof(key), DHCPS_NVS_KEY, chunk);
+		if (nvs_get_blob(handle, key, buf, &len) != NVS_OK)
+			continue;
+		n = dhcps_lease_restore(chunk, buf, len, dhcps_clock);
+		if (n > 0)
+			restored += n;
 	}
+	nvs_close(handle);
+
+	dhcps_changes = 0;
+	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: %d leases restored\n", restored));
 }
 
 /******************************************************************************
- * FunctionName : node_delete_from_list
- * Description  : remove the node from list
- * Parameters   : phead -- the head node of the list
- *                pdelete -- the remove node of the list
+ * FunctionName : dhcps_lease_flush
+ * Description  : save the chunks of the lease table that changed, once
+ *                DHCPS_LEASE_SAVE_BATCH leases changed or the first change
+ *                is DHCPS_LEASE_SAVE_SECS old
+ * Parameters   : force -- save whatever changed
  * Returns      : none
 *******************************************************************************/
-void node_remove_from_list(list_node** phead, list_node* pdelete)
+static void dhcps_lease_flush(bool force)
 {
-	list_node* plist = NULL;
+	static u8_t buf[DHCPS_LEASE_CHUNK_SIZE];
+	nvs_handle_t handle;
+	char key[NVS_KEY_NAME_MAX_SIZE];
+	int chunk;
+
+	if (dhcps_lease_dirty(0) < 0) {
+		/* renewals only */
+		dhcps_changes = 0;
+		return;
+	}
+	if (!force && dhcps_changes < DHCPS_LEASE_SAVE_BATCH &&
+		dhcps_clock - dhcps_changed_at < DHCPS_LEASE_SAVE_SECS)
+		return;
 
-	plist = *phead;
+	if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &handle) != NVS_OK)
+		return;
 
-	if (plist == NULL) {
-		*phead = NULL;
-	} else {
-		if (plist == pdelete) {
-			*phead = plist->pnext;
-			pdelete->pnext = NULL;
-		} else {
-			while (plist != NULL) {
-				if (plist->pnext == pdelete) {
-					plist->pnext = pdelete->pnext;
-					pdelete->pnext = NULL;
-				}
-				plist = plist->pnext;
-			}
-		}
+	for (chunk = dhcps_lease_dirty(0); chunk >= 0; chunk = dhcps_lease_dirty(chunk + 1)) {
+		size_t len = dhcps_lease_save(chunk, buf, dhcps_clock);
+		nvs_err_t err;
+
+		snprintf(key, sizeof(key), DHCPS_NVS_KEY, chunk);
+		if (buf[1] == 0)
+			err = nvs_erase_key(handle, key);
+		else
+			err = nvs_set_blob(handle, key, buf, len);
+		if (err != NVS_OK && err != NVS_ERR_NVS_NOT_FOUND)
+			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: saving %s failed %d\n", key, err));
 	}
+	nvs_commit(handle);
+	nvs_close(handle);
+
+	dhcps_changes = 0;
 }
 
+static void dhcps_lease_changed(void)
+{
+	if (dhcps_changes++ == 0)
+		dhcps_changed_at = dhcps_clock;
+}
+#else
+#define dhcps_lease_load()			do {} while (0)
+#define dhcps_lease_flush(force)	do {} while (0)
+#define dhcps_lease_changed()		do {} while (0)
+#endif /* SUPPORT_NVS_FLASH && DHCPS_LEASE_PERSIST */
+
 /******************************************************************************
  * FunctionName : add_msg_type
  * Description  : add TYPE option of DHCP message
@@ -141,25 +173,18 @@ static u8_t* add_msg_type(u8_t* optptr, u8_t type)
 *******************************************************************************/
 static u8_t* add_offer_options(u8_t* optptr)
 {
-	ip4_addr_t ipadd;
+	ip4_addr_t ipadd, mask, bcast;
 
 	ipadd.addr = *((u32_t*) &server_address);
+	mask.addr = ip_2_ip4(&softap_if->netmask)->addr;
+	bcast.addr = ipadd.addr | ~mask.addr;
 
-#ifdef USE_CLASS_B_NET
 	*optptr++ = DHCP_OPTION_SUBNET_MASK;
 	*optptr++ = 4;  //length
-	*optptr++ = 255;
-	*optptr++ = 240;
-	*optptr++ = 0;
-	*optptr++ = 0;
-#else
-	*optptr++ = DHCP_OPTION_SUBNET_MASK;
-	*optptr++ = 4;
-	*optptr++ = 255;
-	*optptr++ = 255;
-	*optptr++ = 255;
-	*optptr++ = 0;
-#endif
+	*optptr++ = ip4_addr1(&mask);
+	*optptr++ = ip4_addr2(&mask);
+	*optptr++ = ip4_addr3(&mask);
+	*optptr++ = ip4_addr4(&mask);
 
 	*optptr++ = DHCP_OPTION_LEASE_TIME;
 	*optptr++ = 4;
@@ -199,21 +224,12 @@ static u8_t* add_offer_options(u8_t* optptr)
 	*optptr++ = ip4_addr4(&ipadd);
 #endif
 
-#ifdef CLASS_B_NET
 	*optptr++ = DHCP_OPTION_BROADCAST_ADDRESS;
 	*optptr++ = 4;
-	*optptr++ = ip4_addr1(&ipadd);
-	*optptr++ = 255;
-	*optptr++ = 255;
-	*optptr++ = 255;
-#else
-	*optptr++ = DHCP_OPTION_BROADCAST_ADDRESS;
-	*optptr++ = 4;
-	*optptr++ = ip4_addr1(&ipadd);
-	*optptr++ = ip4_addr2(&ipadd);
-	*optptr++ = ip4_addr3(&ipadd);
-	*optptr++ = 255;
-#endif
+	*optptr++ = ip4_addr1(&bcast);
+	*optptr++ = ip4_addr2(&bcast);
+	*optptr++ = ip4_addr3(&bcast);
+	*optptr++ = ip4_addr4(&bcast);
 
 	*optptr++ = DHCP_OPTION_INTERFACE_MTU;
 	*optptr++ = 2;
@@ -317,9 +333,8 @@ static void send_offer(struct dhcps_msg* m)
 
 	p = pbuf_alloc(PBUF_TRANSPORT, sizeof(struct dhcps_msg), PBUF_RAM);
 
-	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("udhcp: send_offer>>p->ref = %d\n", p->ref));
-
 	if (p != NULL) {
+		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("udhcp: send_offer>>p->ref = %d\n", p->ref));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_offer>>pbuf_alloc succeed\n"));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_offer>>p->tot_len = %d\n", p->tot_len));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_offer>>p->len = %d\n", p->len));
@@ -376,9 +391,9 @@ static void send_nak(struct dhcps_msg* m)
 	end = add_end(end);
 
 	p = pbuf_alloc(PBUF_TRANSPORT, sizeof(struct dhcps_msg), PBUF_RAM);
-	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("udhcp: send_nak>>p->ref = %d\n", p->ref));
 
 	if (p != NULL) {
+		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("udhcp: send_nak>>p->ref = %d\n", p->ref));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_nak>>pbuf_alloc succeed\n"));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_nak>>p->tot_len = %d\n", p->tot_len));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_nak>>p->len = %d\n", p->len));
@@ -433,9 +448,9 @@ static void send_ack(struct dhcps_msg* m)
 	end = add_end(end);
 
 	p = pbuf_alloc(PBUF_TRANSPORT, sizeof(struct dhcps_msg), PBUF_RAM);
-	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("udhcp: send_ack>>p->ref = %d\n", p->ref));
 
 	if (p != NULL) {
+		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("udhcp: send_ack>>p->ref = %d\n", p->ref));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_ack>>pbuf_alloc succeed\n"));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_ack>>p->tot_len = %d\n", p->tot_len));
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: send_ack>>p->len = %d\n", p->len));
@@ -475,213 +490,110 @@ static void send_ack(struct dhcps_msg* m)
  * Description  : parse DHCP message options
  * Parameters   : optptr -- DHCP message option info
  *                len -- DHCP message option length
- * Returns      : none
+ *                req -- requested address, any if none
+ *                server -- server identifier, any if none
+ * Returns      : DHCP message type, 0 if none
 *******************************************************************************/
-static u8_t parse_options(u8_t* optptr, s16_t len)
+static u8_t parse_options(u8_t* optptr, s16_t len, ip4_addr_t *req, ip4_addr_t *server)
 {
-	ip4_addr_t client;
-	bool is_dhcp_parse_end = false;
-	struct dhcps_state s;
-
-	client.addr = *((uint32_t*) &client_address);
-
 	u8_t* end = optptr + len;
-	u16_t type = 0;
+	u8_t type = 0;
 
-	s.state = DHCPS_STATE_IDLE;
+	ip4_addr_set_any(req);
+	ip4_addr_set_any(server);
 
-	while (optptr < end) {
+	while (optptr + 1 < end && *optptr != DHCP_OPTION_END) {
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: (s16_t)*optptr = %d\n", (s16_t)*optptr));
 
-		switch ((s16_t) *optptr) {
+		if (*optptr == 0) {	/* pad */
+			optptr++;
+			continue;
+		}
+		if (optptr + 2 + optptr[1] > end)
+			break;
 
+		switch (*optptr) {
 			case DHCP_OPTION_MSG_TYPE:	//53
 				type = *(optptr + 2);
 				break;
 
 			case DHCP_OPTION_REQ_IPADDR://50
-				if (memcmp((char*) &client.addr, (char*) optptr + 2, 4) == 0) {
-					LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCP_OPTION_REQ_IPADDR = 0 ok\n"));
-					s.state = DHCPS_STATE_ACK;
-				} else {
-					LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCP_OPTION_REQ_IPADDR != 0 err\n"));
-					s.state = DHCPS_STATE_NAK;
-				}
-
+				if (optptr[1] == 4)
+					memcpy(&req->addr, optptr + 2, 4);
 				break;
 
-				case DHCP_OPTION_END: {
-					is_dhcp_parse_end = true;
-				}
+			case DHCP_OPTION_SERVER_ID://54
+				if (optptr[1] == 4)
+					memcpy(&server->addr, optptr + 2, 4);
 				break;
 		}
 
-		if (is_dhcp_parse_end) {
-			break;
-		}
-
 		optptr += optptr[1] + 2;
 	}
 
-	switch (type) {
-
-		case DHCPDISCOVER://1
-			s.state = DHCPS_STATE_OFFER;
-			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCPD_STATE_OFFER\n"));
-			break;
-
-		case DHCPREQUEST://3
-			if (!(s.state == DHCPS_STATE_ACK || s.state == DHCPS_STATE_NAK)) {
-				if (renew == true) {
-					s.state = DHCPS_STATE_ACK;
-				} else {
-					s.state = DHCPS_STATE_NAK;
-				}
-
-				LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCPD_STATE_NAK\n"));
-			}
-
-			break;
-
-		case DHCPDECLINE://4
-			s.state = DHCPS_STATE_IDLE;
-			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCPD_STATE_IDLE\n"));
-			break;
-
-		case DHCPRELEASE://7
-			s.state = DHCPS_STATE_RELEASE;
-			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCPD_STATE_IDLE\n"));
-			break;
-	}
-	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: return s.state = %d\n", s.state));
-
-	return s.state;
+	return type;
 }
 
 /******************************************************************************
  * FunctionName : parse_msg
- * Description  : parse DHCP message from netif
+ * Description  : parse DHCP message from netif and update the lease table
  * Parameters   : m -- DHCP message info
  *                len -- DHCP message length
- * Returns      : DHCP message type
+ * Returns      : DHCP server state
 *******************************************************************************/
 static s16_t parse_msg(struct dhcps_msg* m, u16_t len)
 {
-	u32_t lease_timer = (dhcps_lease_time * 60) / DHCPS_COARSE_TIMER_SECS;
-
-	if (memcmp((char*)m->options,
-	&magic_cookie,
-	sizeof(magic_cookie)) == 0) {
-		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: len = %d\n", len));
-
-		ip4_addr_t addr_tmp;
-
-		struct dhcps_pool* pdhcps_pool = NULL;
-		list_node* pnode = NULL;
-		list_node* pback_node = NULL;
-		ip4_addr_t first_address;
-		bool flag = false;
-
-		first_address.addr = dhcps_lease.start_ip.addr;
-		client_address.addr = client_address_plus.addr;
-		renew = false;
-
-		if (plist != NULL) {
-			for (pback_node = plist; pback_node != NULL; pback_node = pback_node->pnext) {
-				pdhcps_pool = pback_node->pnode;
-
-				if (memcmp(pdhcps_pool->mac, m->chaddr, sizeof(pdhcps_pool->mac)) == 0) {
-					if (memcmp(&pdhcps_pool->ip.addr, m->ciaddr, sizeof(pdhcps_pool->ip.addr)) == 0) {
-						renew = true;
-					}
-
-					client_address.addr = pdhcps_pool->ip.addr;
-					pdhcps_pool->lease_timer = lease_timer;
-					pnode = pback_node;
-					goto POOL_CHECK;
-				} else if (pdhcps_pool->ip.addr == client_address_plus.addr) {
-					addr_tmp.addr = htonl(client_address_plus.addr);
-					addr_tmp.addr++;
-					client_address_plus.addr = htonl(addr_tmp.addr);
-					client_address.addr = client_address_plus.addr;
-				}
+	ip4_addr_t req, server;
+	u8_t type;
 
-				if (flag == false) { // search the fisrt unused ip
-					if (first_address.addr < pdhcps_pool->ip.addr) {
-						flag = true;
-					} else {
-						addr_tmp.addr = htonl(first_address.addr);
-						addr_tmp.addr++;
-						first_address.addr = htonl(addr_tmp.addr);
-					}
-				}
-			}
-		} else {
-			client_address.addr = dhcps_lease.start_ip.addr;
-		}
+	if (memcmp((char*)m->options, &magic_cookie, sizeof(magic_cookie)) != 0)
+		return 0;
 
-		if (client_address_plus.addr > dhcps_lease.end_ip.addr) {
-			client_address.addr = first_address.addr;
-		}
+	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: len = %d\n", len));
 
-		if (client_address.addr > dhcps_lease.end_ip.addr) {
-			client_address_plus.addr = dhcps_lease.start_ip.addr;
-			pdhcps_pool = NULL;
-			pnode = NULL;
-		} else {
-			pdhcps_pool = (struct dhcps_pool*)mem_malloc(sizeof(struct dhcps_pool));
-			pdhcps_pool->ip.addr = client_address.addr;
-			memcpy(pdhcps_pool->mac, m->chaddr, sizeof(pdhcps_pool->mac));
-			pdhcps_pool->lease_timer = lease_timer;
-			pnode = (list_node*)mem_malloc(sizeof(list_node));
-			pnode->pnode = pdhcps_pool;
-			pnode->pnext = NULL;
-			node_insert_to_list(&plist, pnode);
-
-			if (client_address.addr == dhcps_lease.end_ip.addr) {
-				client_address_plus.addr = dhcps_lease.start_ip.addr;
-			} else {
-				addr_tmp.addr = htonl(client_address.addr);
-				addr_tmp.addr++;
-				client_address_plus.addr = htonl(addr_tmp.addr);
-			}
-		}
-
-		POOL_CHECK:
+	type = parse_options(&m->options[4], len, &req, &server);
 
-		if ((client_address.addr > dhcps_lease.end_ip.addr) ){//|| (ip_addr_isany(&client_address))) {
-			if (pnode != NULL) {
-				node_remove_from_list(&plist, pnode);
-				mem_free(pnode);
-				pnode = NULL;
+	switch (type) {
+		case DHCPDISCOVER://1
+			if (dhcps_lease_offer(m->chaddr, &client_address, dhcps_clock) != DHCPS_LEASE_OK) {
+				LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: no address left\n"));
+				return DHCPS_STATE_IDLE;
 			}
+			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCPD_STATE_OFFER\n"));
+			return DHCPS_STATE_OFFER;
 
-			if (pdhcps_pool != NULL) {
-				mem_free(pdhcps_pool);
-				pdhcps_pool = NULL;
+		case DHCPREQUEST://3
+			if (!ip4_addr_isany_val(server) && !ip4_addr_cmp(&server, &server_address)) {
+				/* the client took the offer of another server */
+				dhcps_lease_release(m->chaddr);
+				return DHCPS_STATE_IDLE;
 			}
+			/* no requested address when renewing or rebinding */
+			if (ip4_addr_isany_val(req))
+				memcpy(&req.addr, m->ciaddr, sizeof(req.addr));
+			client_address.addr = req.addr;
 
-			return 4;
-		}
-
-		s16_t ret = parse_options(&m->options[4], len);;
+			if (dhcps_lease_bind(m->chaddr, &req, dhcps_clock, dhcps_lease_time * 60) != DHCPS_LEASE_OK) {
+				LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCPD_STATE_NAK\n"));
+				return DHCPS_STATE_NAK;
+			}
+			dhcps_lease_changed();
+			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: client_address.addr = %x\n", client_address.addr));
+			return DHCPS_STATE_ACK;
 
-		if (ret == DHCPS_STATE_RELEASE) {
+		case DHCPDECLINE://4
+		case DHCPRELEASE://7
+			dhcps_lease_release(m->chaddr);
+			dhcps_lease_changed();
 			memset(&client_address, 0x0, sizeof(client_address));
-		}
-#if 0
-		if (wifi_softap_set_station_info(m->chaddr, &client_address) == false) {
-			return 0;
-		}
-#endif
-		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: xid changed\n"));
-		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: client_address.addr = %x\n", client_address.addr));
-		return ret;
+			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: DHCPD_STATE_IDLE\n"));
+			return type == DHCPRELEASE ? DHCPS_STATE_RELEASE : DHCPS_STATE_IDLE;
 	}
 
-	return 0;
+	return DHCPS_STATE_IDLE;
 }
 
+
 /******************************************************************************
  * FunctionName : handle_dhcp
  * Description  : If an incoming DHCP message is in response to us, then trigger the state machine
@@ -699,11 +611,7 @@ static void handle_dhcp(void* arg,
                         u16_t port)
 {
 	struct dhcps_msg* pmsg_dhcps = NULL;
-	s16_t tlen;
-	u16_t i;
-	u16_t dhcps_msg_cnt = 0;
-	u8_t* p_dhcps_msg = NULL;
-	u8_t* data;
+	u16_t tlen;
 
 	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> receive a packet\n"));
 
@@ -711,50 +619,27 @@ static void handle_dhcp(void* arg,
 		return;
 	}
 
-	pmsg_dhcps = (struct dhcps_msg*)mem_malloc(sizeof(struct dhcps_msg));
-
-	if (NULL == pmsg_dhcps) {
+	/* the fixed header and the magic cookie at least */
+	if (p->tot_len < DHCP_MSG_LEN + sizeof(magic_cookie)) {
 		pbuf_free(p);
 		return;
 	}
 
-	p_dhcps_msg = (u8_t*)pmsg_dhcps;
-	tlen = p->tot_len;
-	data = p->payload;
-
-	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> p->tot_len = %d\n", tlen));
-	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> p->len = %d\n", p->len));
+	pmsg_dhcps = (struct dhcps_msg*)mem_malloc(sizeof(struct dhcps_msg));
 
-	for (i = 0; i < p->len; i++) {
-		p_dhcps_msg[dhcps_msg_cnt++] = data[i];
-#if DHCPS_DEBUG_DATA
-		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("%02x ", data[i]));
-		if ((i + 1) % 16 == 0) {
-			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("\n"));
-		}
-#endif
+	if (NULL == pmsg_dhcps) {
+		pbuf_free(p);
+		return;
 	}
 
-	if (p->next != NULL) {
-		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> p->next != NULL\n"));
-		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> p->next->tot_len = %d\n", p->next->tot_len));
-		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> p->next->len = %d\n", p->next->len));
+	/* options past the end of struct dhcps_msg are not looked at */
+	tlen = LWIP_MIN(p->tot_len, sizeof(struct dhcps_msg));
+	pbuf_copy_partial(p, pmsg_dhcps, tlen, 0);
 
-		data = p->next->payload;
-
-		for (i = 0; i < p->next->len; i++) {
-			p_dhcps_msg[dhcps_msg_cnt++] = data[i];
-#if DHCPS_DEBUG_DATA
-			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("%02x ", data[i]));
-			if ((i + 1) % 16 == 0) {
-				LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("\n"));
-			}
-#endif
-		}
-	}
+	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> p->tot_len = %d\n", p->tot_len));
 	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> parse_msg(p)\n"));
 
-	switch (parse_msg(pmsg_dhcps, tlen - 240)) {
+	switch (parse_msg(pmsg_dhcps, tlen - DHCP_MSG_LEN - sizeof(magic_cookie))) {
 
 		case DHCPS_STATE_OFFER:
 			LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps: handle_dhcp-> DHCPD_STATE_OFFER\n"));
@@ -781,53 +666,67 @@ static void handle_dhcp(void* arg,
 	pmsg_dhcps = NULL;
 }
 
+/******************************************************************************
+ * FunctionName : dhcps_lease_in_subnet
+ * Description  : check a lease range against the address of the soft AP
+ * Parameters   : start, end -- the range, host order
+ *                ip, mask -- address and netmask of the soft AP, host order
+ * Returns      : true if the range is usable
+*******************************************************************************/
+static bool dhcps_lease_in_subnet(u32_t start, u32_t end, u32_t ip, u32_t mask)
+{
+	/*config ip information can't contain local ip*/
+	if ((start <= ip) && (ip <= end))
+		return false;
+
+	/*config ip information must be in the same segment as the local ip*/
+	if (((start & mask) != (ip & mask)) || ((end & mask) != (ip & mask)))
+		return false;
+
+	/*and not the network or broadcast address*/
+	if ((start & ~mask) == 0 || (end & ~mask) == ~mask)
+		return false;
+
+	return start <= end && end - start < DHCPS_MAX_LEASE;
+}
+
 /******************************************************************************
  * FunctionName : wifi_softap_init_dhcps_lease
  * Description  : init ip lease from start to end for station
  * Parameters   : ip -- The current ip addr
+ *                netmask -- The current netmask
  * Returns      : none
 *******************************************************************************/
-static void wifi_softap_init_dhcps_lease(u32_t ip)
+static void wifi_softap_init_dhcps_lease(u32_t ip, u32_t netmask)
 {
-	u32_t softap_ip = 0, local_ip = 0;
-	u32_t start_ip = 0;
-	u32_t end_ip = 0;
+	u32_t softap_ip = htonl(ip);
+	u32_t mask = htonl(netmask);
+	u32_t host = softap_ip & ~mask;
+	u32_t hosts = ~mask - 1;		/* without the network and broadcast addresses */
+	u32_t num;
 
 	if (dhcps_lease.enable == true) {
-		softap_ip = htonl(ip);
-		start_ip = htonl(dhcps_lease.start_ip.addr);
-		end_ip = htonl(dhcps_lease.end_ip.addr);
-
-		/*config ip information can't contain local ip*/
-		if ((start_ip <= softap_ip) && (softap_ip <= end_ip)) {
+		if (!dhcps_lease_in_subnet(htonl(dhcps_lease.start_ip.addr), htonl(dhcps_lease.end_ip.addr),
+								   softap_ip, mask)) {
 			dhcps_lease.enable = false;
-		} else {
-			/*config ip information must be in the same segment as the local ip*/
-			softap_ip >>= 8;
-
-			if (((start_ip >> 8 != softap_ip) || (end_ip >> 8 != softap_ip))
-			|| (end_ip - start_ip > DHCPS_MAX_LEASE)) {
-				dhcps_lease.enable = false;
-			}
 		}
 	}
 
 	if (dhcps_lease.enable == false) {
-		local_ip = softap_ip = htonl(ip);
-		softap_ip &= 0xFFFFFF00;
-		local_ip &= 0xFF;
-
-		if (local_ip >= 0x80) {
-			local_ip -= DHCPS_MAX_LEASE;
-		} else {
-			local_ip ++;
-		}
+		/* the addresses after the local ip, or before it in the upper half of the subnet */
+		num = LWIP_MIN(DHCPS_MAX_LEASE, hosts - 1);
 
 		bzero(&dhcps_lease, sizeof(dhcps_lease));
-		dhcps_lease.start_ip.addr = softap_ip | local_ip;
-		dhcps_lease.end_ip.addr = softap_ip | (local_ip + DHCPS_MAX_LEASE - 1);
-		dhcps_lease.start_ip.addr = htonl(dhcps_lease.start_ip.addr);
-		dhcps_lease.end_ip.addr = htonl(dhcps_lease.end_ip.addr);
+		if (host > (hosts + 1) / 2)
+			host = host > num ? host - num : 1;
+		else
+			host = host + 1;
+		num = LWIP_MIN(num, hosts - host + 1);
+		if (host <= (softap_ip & ~mask) && (softap_ip & ~mask) < host + num)
+			num = (softap_ip & ~mask) - host;
+
+		dhcps_lease.start_ip.addr = htonl((softap_ip & mask) | host);
+		dhcps_lease.end_ip.addr = htonl((softap_ip & mask) | (host + num - 1));
 	}
 
 }
@@ -841,8 +740,8 @@ static void wifi_softap_init_dhcps_lease(u32_t ip)
 *******************************************************************************/
 void dhcps_start(struct ip_info* info, struct netif *net_if)
 {
-	if (net_if->dhcps_pcb != NULL) {
-		udp_remove(net_if->dhcps_pcb);
+	if (DHCPS_PCB(net_if) != NULL) {
+		udp_remove(DHCPS_PCB(net_if));
 	}
 
 	pcb_dhcps = udp_new();
@@ -851,13 +750,15 @@ void dhcps_start(struct ip_info* info, struct netif *net_if)
 		LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps_start(): could not obtain pcb\n"));
 	}
 
-	net_if->dhcps_pcb = pcb_dhcps;
+	DHCPS_PCB(net_if) = pcb_dhcps;
 
 	IP_ADDR4(&broadcast_dhcps, 255, 255, 255, 255);
 
 	server_address.addr = ip_2_ip4(&info->ip)->addr;
-	wifi_softap_init_dhcps_lease(server_address.addr);
-	client_address_plus.addr = dhcps_lease.start_ip.addr;
+	wifi_softap_init_dhcps_lease(server_address.addr, ip_2_ip4(&info->netmask)->addr);
+	dhcps_lease_table_init(&dhcps_lease.start_ip,
+						   htonl(dhcps_lease.end_ip.addr) - htonl(dhcps_lease.start_ip.addr) + 1);
+	dhcps_lease_load();
 	udp_bind(pcb_dhcps, IP_ADDR_ANY, DHCPS_SERVER_PORT);
 	udp_recv(pcb_dhcps, handle_dhcp, NULL);
 	LWIP_DEBUGF(DHCPS_DEBUG | LWIP_DBG_TRACE, ("dhcps:dhcps_start->udp_recv function Set a receive callback handle_dhcp for UDP_PCB pcb_dhcps\n"));
@@ -875,33 +776,19 @@ void dhcps_stop(void)
 {
 	udp_disconnect(pcb_dhcps);
 
-	if (softap_if->dhcps_pcb != NULL) {
-		udp_remove(softap_if->dhcps_pcb);
-		softap_if->dhcps_pcb = NULL;
+	if (DHCPS_PCB(softap_if) != NULL) {
+		udp_remove(DHCPS_PCB(softap_if));
+		DHCPS_PCB(softap_if) = NULL;
 	}
 
-	list_node* pnode = NULL;
-	list_node* pback_node = NULL;
-	pnode = plist;
-
-	while (pnode != NULL) {
-		pback_node = pnode;
-		pnode = pback_node->pnext;
-		node_remove_from_list(&plist, pback_node);
-		mem_free(pback_node->pnode);
-		pback_node->pnode = NULL;
-		mem_free(pback_node);
-		pback_node = NULL;
-	}
+	dhcps_lease_flush(true);
+	dhcps_lease_table_init(&dhcps_lease.start_ip, 0);
 	softap_if = NULL;
 }
 
 bool wifi_softap_set_dhcps_lease(struct dhcps_lease* please)
 {
 	struct ip_info info;
-	u32_t softap_ip = 0;
-	u32_t start_ip = 0;
-	u32_t end_ip = 0;
 	int softap_if_id =0;
 
 	u8_t opmode = wifi_get_opmode();
@@ -917,23 +804,9 @@ bool wifi_softap_set_dhcps_lease(struct dhcps_lease* please)
 	if (please->enable) {
 		bzero(&info, sizeof(struct ip_info));
 		wifi_get_ip_info(softap_if_id, &info);
-		softap_ip = htonl(ip_2_ip4(&info.ip)->addr);
-		start_ip = htonl(please->start_ip.addr);
-		end_ip = htonl(please->end_ip.addr);
 
-		/*config ip information can't contain local ip*/
-		if ((start_ip <= softap_ip) && (softap_ip <= end_ip)) {
-			return false;
-		}
-
-		/*config ip information must be in the same segment as the local ip*/
-		softap_ip >>= 8;
-
-		if ((start_ip >> 8 != softap_ip)|| (end_ip >> 8 != softap_ip)) {
-			return false;
-		}
-
-		if (end_ip - start_ip > DHCPS_MAX_LEASE) {
+		if (!dhcps_lease_in_subnet(htonl(please->start_ip.addr), htonl(please->end_ip.addr),
+								   htonl(ip_2_ip4(&info.ip)->addr), htonl(ip_2_ip4(&info.netmask)->addr))) {
 			return false;
 		}
 		bzero(&dhcps_lease, sizeof(dhcps_lease));
@@ -945,6 +818,7 @@ bool wifi_softap_set_dhcps_lease(struct dhcps_lease* please)
 	return true;
 }
 
+
 /******************************************************************************
  * FunctionName : wifi_softap_get_dhcps_lease
  * Description  : get the lease information of DHCP server
@@ -975,42 +849,6 @@ bool wifi_softap_get_dhcps_lease(struct dhcps_lease* please)
 	return true;
 }
 
-/******************************************************************************
- * FunctionName : kill_oldest_dhcps_pool
- * Description  : remove the oldest node from list
- * Parameters   : none
- * Returns      : none
-*******************************************************************************/
-static void kill_oldest_dhcps_pool(void)
-{
-	list_node* pre = NULL, *p = NULL;
-	list_node* minpre = NULL, *minp = NULL;
-	struct dhcps_pool* pdhcps_pool = NULL, *pmin_pool = NULL;
-	pre = plist;
-	p = pre->pnext;
-	minpre = pre;
-	minp = p;
-
-	while (p != NULL) {
-		pdhcps_pool = p->pnode;
-		pmin_pool = minp->pnode;
-
-		if (pdhcps_pool->lease_timer < pmin_pool->lease_timer) {
-			minp = p;
-			minpre = pre;
-		}
-
-		pre = p;
-		p = p->pnext;
-	}
-
-	minpre->pnext = minp->pnext;
-	mem_free(minp->pnode);
-	minp->pnode = NULL;
-	mem_free(minp);
-	minp = NULL;
-}
-
 /******************************************************************************
  * FunctionName : dhcps_coarse_tmr
  * Description  : the lease time count
@@ -1019,35 +857,18 @@ static void kill_oldest_dhcps_pool(void)
 *******************************************************************************/
 void dhcps_coarse_tmr(void)
 {
-	u8_t num_dhcps_pool = 0;
-	list_node* pback_node = NULL;
-	list_node* pnode = NULL;
-	struct dhcps_pool* pdhcps_pool = NULL;
-	pnode = plist;
-
-	while (pnode != NULL) {
-		pdhcps_pool = pnode->pnode;
-		pdhcps_pool->lease_timer --;
-
-		if (pdhcps_pool->lease_timer == 0) {
-			pback_node = pnode;
-			pnode = pback_node->pnext;
-			node_remove_from_list(&plist, pback_node);
-			mem_free(pback_node->pnode);
-			pback_node->pnode = NULL;
-			mem_free(pback_node);
-			pback_node = NULL;
-		} else {
-			pnode = pnode ->pnext;
-			num_dhcps_pool ++;
-		}
-	}
+	u16_t count = dhcps_lease_count();
 
-	if (num_dhcps_pool >= MAX_STATION_NUM) {
-		kill_oldest_dhcps_pool();
-	}
+	dhcps_clock += DHCPS_COARSE_TIMER_SECS;
+	dhcps_lease_tick(dhcps_clock);
+
+	if (dhcps_lease_count() != count)
+		dhcps_lease_changed();
+	if (softap_if != NULL)
+		dhcps_lease_flush(false);
 }
 
+
 bool wifi_softap_set_dhcps_offer_option(u8_t level, void* optarg)
 {
 	bool offer_flag = true;
@@ -1117,48 +938,37 @@ u32_t wifi_softap_get_dhcps_lease_time(void) // minute
 
 bool dhcps_get_ip (u8_t *mac, ip4_addr_t *ip)
 {
-	struct dhcps_pool *pdhcps_pool = NULL;
-	list_node *pnode = plist;
-
-	while (pnode != NULL) {
-		pdhcps_pool = pnode->pnode;
-		if (memcmp(pdhcps_pool->mac, mac, 6) == 0) {
-			memcpy(ip, &pdhcps_pool->ip, sizeof(ip4_addr_t));
-			return true;
-		}
-
-		pnode = pnode->pnext;
-	}
+	return dhcps_lease_find(mac, ip);
+}
 
-	return false;
+static void dhcps_status_lease(const struct dhcps_pool *pdhcps_pool, void *arg)
+{
+	int *num_dhcps_pool = arg;
+
+	A("[%2d] MAC address : " MACSTR "\t", *num_dhcps_pool, MAC2STR(pdhcps_pool->mac));
+	A("ip address : %"U16_F".%"U16_F".%"U16_F".%"U16_F"%s\n",
+		ip4_addr1_16(&pdhcps_pool->ip), ip4_addr2_16(&pdhcps_pool->ip),
+		ip4_addr3_16(&pdhcps_pool->ip), ip4_addr4_16(&pdhcps_pool->ip),
+		pdhcps_pool->bound ? "" : " (offered)");
+	(*num_dhcps_pool)++;
 }
 
 int dhcps_status(void)
 {
-	u8_t num_dhcps_pool = 0;
-	list_node* pback_node = NULL;
-	list_node* pnode = NULL;
-	struct dhcps_pool* pdhcps_pool = NULL;
-	pnode = plist;
+	int num_dhcps_pool = 0;
+
 	A("\n-------------------------- DHCP Server Status ------------------------------\n");
 	A(" DHCP Server:%s   \tInterface:%d\n",
 	  wifi_softap_dhcps_status()== DHCP_STARTED ? "On":"Off", (dhcps_get_interface())->num);
-	A(" Lease Time:%d(min)\tMax Lease Number:%d\n", dhcps_lease_time, DHCPS_MAX_LEASE);
-	while (pnode != NULL) {
-		pdhcps_pool = pnode->pnode;
-		A("[%2d] MAC address : " MACSTR "\t", num_dhcps_pool, MAC2STR(pdhcps_pool->mac));
-		A("ip address : %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
-			ip4_addr1_16(&pdhcps_pool->ip), ip4_addr2_16(&pdhcps_pool->ip),
-			ip4_addr3_16(&pdhcps_pool->ip), ip4_addr4_16(&pdhcps_pool->ip));
-
-		pnode = pnode ->pnext;
-		num_dhcps_pool ++;
-	}
+	A(" Lease Time:%d(min)\tMax Lease Number:%d\n", dhcps_lease_time,
+	  (int)(htonl(dhcps_lease.end_ip.addr) - htonl(dhcps_lease.start_ip.addr) + 1));
+	dhcps_lease_foreach(dhcps_status_lease, &num_dhcps_pool, dhcps_clock);
 	A("----------------------------------------------------------------------------\n");
 
 	return 0;
 }
 
+
 struct netif *dhcps_get_interface(void)
 {
 	return softap_if;
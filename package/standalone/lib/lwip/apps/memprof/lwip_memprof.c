@@ -0,0 +1,138 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "lwip/sys.h"
+
+#include "lwip_memprof.h"
+
+#include <stdio.h>
+
+#if LWIP_MEMPROF && LWIP_STATS && MEM_STATS && MEMP_STATS
+
+/* The pool names as in MEMP_<name>, the host tool maps them to options */
+static const char *const memprof_names[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name, num, size, desc) #name,
+#include "lwip/priv/memp_std.h"
+};
+
+static u32_t memprof_start;
+
+static void memprof_read(struct lwip_memprof_pool *p, const struct stats_mem *s)
+{
+	p->used = s->used;
+	p->max = s->max;
+	p->err = s->err;
+}
+
+static void memprof_clear(struct stats_mem *s)
+{
+	s->max = s->used;
+	s->err = 0;
+}
+
+void lwip_memprof_get(struct lwip_memprof *prof)
+{
+	int i;
+	SYS_ARCH_DECL_PROTECT(old_level);
+
+	prof->heap.name = "MEM_SIZE";
+	prof->heap.size = 1;
+	prof->heap.num = MEM_SIZE;
+
+	for (i = 0; i < MEMP_MAX; i++) {
+		prof->pool[i].name = memprof_names[i];
+		prof->pool[i].size = memp_pools[i]->size;
+		prof->pool[i].num = memp_pools[i]->num;
+	}
+
+	SYS_ARCH_PROTECT(old_level);
+	prof->window_ms = sys_now() - memprof_start;
+	memprof_read(&prof->heap, &lwip_stats.mem);
+	for (i = 0; i < MEMP_MAX; i++)
+		memprof_read(&prof->pool[i], lwip_stats.memp[i]);
+	SYS_ARCH_UNPROTECT(old_level);
+}
+
+void lwip_memprof_reset(void)
+{
+	int i;
+	SYS_ARCH_DECL_PROTECT(old_level);
+
+	SYS_ARCH_PROTECT(old_level);
+	memprof_start = sys_now();
+	memprof_clear(&lwip_stats.mem);
+	for (i = 0; i < MEMP_MAX; i++)
+		memprof_clear(lwip_stats.memp[i]);
+	SYS_ARCH_UNPROTECT(old_level);
+}
+
+void lwip_memprof_dump(lwip_memprof_out_fn out, void *arg)
+{
+	/* too large for the stack of the console task */
+	static struct lwip_memprof prof;
+	char line[80];
+	int i;
+
+	lwip_memprof_get(&prof);
+
+	snprintf(line, sizeof(line), "LWIPPROF %d %lu", LWIP_MEMPROF_VERSION,
+			 (unsigned long)prof.window_ms);
+	out(line, arg);
+
+#define MEMPROF_CONF(opt) \
+	snprintf(line, sizeof(line), "CONF " #opt " %lu", (unsigned long)(opt)); \
+	out(line, arg)
+
+	MEMPROF_CONF(MEM_ALIGNMENT);
+	MEMPROF_CONF(PBUF_POOL_BUFSIZE);
+#if LWIP_TCP
+	MEMPROF_CONF(TCP_MSS);
+	MEMPROF_CONF(TCP_WND);
+	MEMPROF_CONF(TCP_SND_BUF);
+	MEMPROF_CONF(TCP_SND_QUEUELEN);
+#endif
+#undef MEMPROF_CONF
+
+	snprintf(line, sizeof(line), "HEAP %lu %lu %lu %lu", (unsigned long)prof.heap.num,
+			 (unsigned long)prof.heap.used, (unsigned long)prof.heap.max,
+			 (unsigned long)prof.heap.err);
+	out(line, arg);
+
+	for (i = 0; i < MEMP_MAX; i++) {
+		snprintf(line, sizeof(line), "POOL %s %lu %lu %lu %lu %lu", prof.pool[i].name,
+				 (unsigned long)prof.pool[i].size, (unsigned long)prof.pool[i].num,
+				 (unsigned long)prof.pool[i].used, (unsigned long)prof.pool[i].max,
+				 (unsigned long)prof.pool[i].err);
+		out(line, arg);
+	}
+
+	out("END", arg);
+}
+
+#endif /* LWIP_MEMPROF && LWIP_STATS && MEM_STATS && MEMP_STATS */
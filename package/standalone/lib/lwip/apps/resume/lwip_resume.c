@@ -0,0 +1,356 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/dhcp.h"
+#include "lwip/dns.h"
+#include "lwip/etharp.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/iana.h"
+#include "lwip/udp.h"
+
+#include "lwip_resume.h"
+
+#include <string.h>
+
+#if LWIP_RESUME && LWIP_IPV4 && LWIP_UDP
+
+/*
+ * Layout of version 1. Integers are little-endian, addresses are kept in
+ * network order as they are in ip4_addr_t.
+ *
+ *   0  'L' 'R'          magic
+ *   2  version
+ *   3  flags            RESUME_FLAG_*
+ *   4  length           of the whole snapshot
+ *   6  checksum         inet_chksum of bytes 8..length
+ *   8  hwaddr[6]
+ *  14  ip, netmask, gw
+ *  26  dns[2]
+ *  34  dhcp server, t0, t1, t2 (seconds left)
+ *  50  n_arp, n_udp
+ *  52  n_arp * { ip, mac[6] }
+ *      n_udp * { local ip, local port, remote ip, remote port }
+ */
+#define RESUME_MAGIC0		'L'
+#define RESUME_MAGIC1		'R'
+#define RESUME_HDR_LEN		8
+#define RESUME_FIXED_LEN	52
+#define RESUME_ARP_LEN		10
+#define RESUME_UDP_LEN		12
+#define RESUME_DNS_MAX		2
+
+#define RESUME_FLAG_DHCP	0x01
+
+struct resume_udp {
+	ip4_addr_t local_ip;
+	ip4_addr_t remote_ip;
+	u16_t local_port;
+	u16_t remote_port;
+};
+
+static struct resume_udp resume_udp[LWIP_RESUME_UDP_MAX];
+static u8_t resume_udp_num;
+
+static u8_t *put_u16(u8_t *p, u16_t v)
+{
+	p[0] = (u8_t)v;
+	p[1] = (u8_t)(v >> 8);
+	return p + 2;
+}
+
+static u8_t *put_u32(u8_t *p, u32_t v)
+{
+	p = put_u16(p, (u16_t)v);
+	return put_u16(p, (u16_t)(v >> 16));
+}
+
+static u8_t *put_ip4(u8_t *p, const ip4_addr_t *addr)
+{
+	u32_t v = ip4_addr_get_u32(addr);
+
+	memcpy(p, &v, 4);
+	return p + 4;
+}
+
+static u16_t get_u16(const u8_t *p)
+{
+	return (u16_t)(p[0] | (p[1] << 8));
+}
+
+static u32_t get_u32(const u8_t *p)
+{
+	return get_u16(p) | ((u32_t)get_u16(p + 2) << 16);
+}
+
+static void get_ip4(const u8_t *p, ip4_addr_t *addr)
+{
+	u32_t v;
+
+	memcpy(&v, p, 4);
+	ip4_addr_set_u32(addr, v);
+}
+
+static u8_t save_arp(struct netif *netif, u8_t *p, u8_t max)
+{
+	const ip4_addr_t *gw = netif_ip4_gw(netif);
+	ip4_addr_t *ip;
+	struct netif *entry_netif;
+	struct eth_addr *eth;
+	u8_t n = 0;
+	int pass;
+	size_t i;
+
+	/* the gateway first, it carries nearly all the traffic */
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < ARP_TABLE_SIZE && n < max; i++) {
+			if (!etharp_get_entry(i, &ip, &entry_netif, &eth) || entry_netif != netif)
+				continue;
+			if (ip4_addr_cmp(ip, gw) != (pass == 0))
+				continue;
+			p = put_ip4(p, ip);
+			memcpy(p, eth->addr, ETH_HWADDR_LEN);
+			p += ETH_HWADDR_LEN;
+			n++;
+		}
+	}
+
+	return n;
+}
+
+static u8_t save_udp(struct netif *netif, u8_t *p, u8_t max)
+{
+	struct udp_pcb *pcb;
+	u8_t n = 0;
+
+	for (pcb = udp_pcbs; pcb && n < max; pcb = pcb->next) {
+		if (!(pcb->flags & UDP_FLAGS_CONNECTED) || !IP_IS_V4_VAL(pcb->remote_ip))
+			continue;
+		if (pcb->netif_idx != NETIF_NO_INDEX && pcb->netif_idx != netif_get_index(netif))
+			continue;
+#if LWIP_DHCP
+		if (pcb->local_port == LWIP_IANA_PORT_DHCP_CLIENT)
+			continue;
+#endif
+		p = put_ip4(p, ip_2_ip4(&pcb->local_ip));
+		p = put_u16(p, pcb->local_port);
+		p = put_ip4(p, ip_2_ip4(&pcb->remote_ip));
+		p = put_u16(p, pcb->remote_port);
+		n++;
+	}
+
+	return n;
+}
+
+int lwip_resume_save(struct netif *netif, u8_t *buf, u16_t len)
+{
+	ip4_addr_t dns[RESUME_DNS_MAX];
+	u8_t flags = 0;
+	u8_t *p;
+	u16_t total;
+#if LWIP_DNS
+	int i;
+#endif
+#if LWIP_DHCP
+	struct dhcp_lease lease;
+#endif
+
+	LWIP_ASSERT_CORE_LOCKED();
+
+	if (!netif || !buf || len < LWIP_RESUME_SIZE_MAX)
+		return ERR_ARG;
+	if (ip4_addr_isany_val(*netif_ip4_addr(netif)) || netif->hwaddr_len != ETH_HWADDR_LEN)
+		return ERR_VAL;
+
+	memset(buf, 0, RESUME_FIXED_LEN);
+	memset(dns, 0, sizeof(dns));
+#if LWIP_DNS
+	for (i = 0; i < RESUME_DNS_MAX && i < DNS_MAX_SERVERS; i++) {
+		const ip_addr_t *server = dns_getserver((u8_t)i);
+
+		if (IP_IS_V4(server))
+			ip4_addr_copy(dns[i], *ip_2_ip4(server));
+	}
+#endif
+
+	p = buf + RESUME_HDR_LEN;
+	memcpy(p, netif->hwaddr, ETH_HWADDR_LEN);
+	p += ETH_HWADDR_LEN;
+	p = put_ip4(p, netif_ip4_addr(netif));
+	p = put_ip4(p, netif_ip4_netmask(netif));
+	p = put_ip4(p, netif_ip4_gw(netif));
+	p = put_ip4(p, &dns[0]);
+	p = put_ip4(p, &dns[1]);
+
+#if LWIP_DHCP
+	if (dhcp_get_lease(netif, &lease) == ERR_OK) {
+		flags |= RESUME_FLAG_DHCP;
+		p = put_ip4(p, &lease.server);
+		p = put_u32(p, lease.t0_lease);
+		p = put_u32(p, lease.t1_renew);
+		p = put_u32(p, lease.t2_rebind);
+	}
+#endif
+
+	p = buf + RESUME_FIXED_LEN;
+	buf[50] = save_arp(netif, p, LWIP_RESUME_ARP_MAX);
+	p += buf[50] * RESUME_ARP_LEN;
+	buf[51] = save_udp(netif, p, LWIP_RESUME_UDP_MAX);
+	p += buf[51] * RESUME_UDP_LEN;
+	total = (u16_t)(p - buf);
+
+	buf[0] = RESUME_MAGIC0;
+	buf[1] = RESUME_MAGIC1;
+	buf[2] = LWIP_RESUME_VERSION;
+	buf[3] = flags;
+	put_u16(buf + 4, total);
+	put_u16(buf + 6, inet_chksum(buf + RESUME_HDR_LEN, total - RESUME_HDR_LEN));
+
+	return total;
+}
+
+static int resume_valid(struct netif *netif, const u8_t *buf, u16_t len)
+{
+	u16_t total;
+
+	if (len < RESUME_FIXED_LEN || buf[0] != RESUME_MAGIC0 || buf[1] != RESUME_MAGIC1)
+		return 0;
+	if (buf[2] != LWIP_RESUME_VERSION)
+		return 0;
+
+	total = get_u16(buf + 4);
+	if (total < RESUME_FIXED_LEN || total > len ||
+		buf[50] > LWIP_RESUME_ARP_MAX || buf[51] > LWIP_RESUME_UDP_MAX ||
+		total != RESUME_FIXED_LEN + buf[50] * RESUME_ARP_LEN + buf[51] * RESUME_UDP_LEN)
+		return 0;
+	if (get_u16(buf + 6) != inet_chksum(buf + RESUME_HDR_LEN, total - RESUME_HDR_LEN))
+		return 0;
+
+	return netif->hwaddr_len == ETH_HWADDR_LEN &&
+		   memcmp(buf + RESUME_HDR_LEN, netif->hwaddr, ETH_HWADDR_LEN) == 0;
+}
+
+err_t lwip_resume_restore(struct netif *netif, const u8_t *buf, u16_t len, u32_t elapsed,
+						  struct lwip_resume_info *info)
+{
+	ip4_addr_t ip, netmask, gw, addr;
+	struct eth_addr eth;
+	const u8_t *p;
+	u8_t i;
+	err_t err = ERR_OK;
+
+	LWIP_ASSERT_CORE_LOCKED();
+
+	if (info)
+		memset(info, 0, sizeof(*info));
+	resume_udp_num = 0;
+
+	if (!netif || !buf || !netif_is_up(netif))
+		return ERR_ARG;
+	if (!resume_valid(netif, buf, len))
+		return ERR_VAL;
+
+	get_ip4(buf + 14, &ip);
+	get_ip4(buf + 18, &netmask);
+	get_ip4(buf + 22, &gw);
+
+	if (buf[3] & RESUME_FLAG_DHCP) {
+#if LWIP_DHCP
+		struct dhcp_lease lease;
+
+		ip4_addr_copy(lease.ip_addr, ip);
+		ip4_addr_copy(lease.netmask, netmask);
+		ip4_addr_copy(lease.gw, gw);
+		get_ip4(buf + 34, &lease.server);
+		lease.t0_lease = get_u32(buf + 38);
+		lease.t1_renew = get_u32(buf + 42);
+		lease.t2_rebind = get_u32(buf + 46);
+
+		err = dhcp_restore_lease(netif, &lease, elapsed);
+		if (err != ERR_OK)
+			return err;
+		if (info) {
+			info->dhcp = 1;
+			info->lease_left = lease.t0_lease == 0xffffffffUL ?
+							   lease.t0_lease : lease.t0_lease - elapsed;
+		}
+#else
+		return ERR_VAL;
+#endif
+	} else {
+		netif_set_addr(netif, &ip, &netmask, &gw);
+	}
+
+#if LWIP_DNS
+	for (i = 0; i < RESUME_DNS_MAX && i < DNS_MAX_SERVERS; i++) {
+		ip_addr_t server;
+
+		get_ip4(buf + 26 + i * 4, &addr);
+		if (ip4_addr_isany_val(addr))
+			continue;
+		ip_addr_copy_from_ip4(server, addr);
+		dns_setserver(i, &server);
+	}
+#endif
+
+	p = buf + RESUME_FIXED_LEN;
+	for (i = 0; i < buf[50]; i++, p += RESUME_ARP_LEN) {
+		get_ip4(p, &addr);
+		memcpy(eth.addr, p + 4, ETH_HWADDR_LEN);
+		if (etharp_restore_entry(netif, &addr, &eth) == ERR_OK && info)
+			info->arp++;
+	}
+
+	for (i = 0; i < buf[51]; i++, p += RESUME_UDP_LEN) {
+		struct resume_udp *u = &resume_udp[resume_udp_num++];
+
+		get_ip4(p, &u->local_ip);
+		u->local_port = get_u16(p + 4);
+		get_ip4(p + 6, &u->remote_ip);
+		u->remote_port = get_u16(p + 10);
+	}
+	if (info)
+		info->udp = resume_udp_num;
+
+	return ERR_OK;
+}
+
+u16_t lwip_resume_udp_port(const ip_addr_t *remote_ip, u16_t remote_port)
+{
+	u8_t i;
+
+	if (!remote_ip || !IP_IS_V4(remote_ip))
+		return 0;
+
+	for (i = 0; i < resume_udp_num; i++) {
+		if (resume_udp[i].remote_port == remote_port &&
+			ip4_addr_cmp(&resume_udp[i].remote_ip, ip_2_ip4(remote_ip)))
+			return resume_udp[i].local_port;
+	}
+
+	return 0;
+}
+
+#endif /* LWIP_RESUME && LWIP_IPV4 && LWIP_UDP */
@@ -0,0 +1,269 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __DHCPS_LEASE_H__
+#define __DHCPS_LEASE_H__
+
+/*
+ * Lease table of the DHCP server (dhcpserver.c).
+ *
+ * Address start + i of the pool is held by lease i of a preallocated
+ * table, so that a bitmap of the leases in use is also the bitmap of the
+ * addresses in use. A client is looked up by MAC address in a hash table
+ * chained through the leases, and each lease is on a timer wheel slot by
+ * expiry, so that lookups, renewals and expiries do not depend on the
+ * number of clients.
+ *
+ * Times are in seconds of a clock given by the caller, dhcps_coarse_tmr()
+ * for the server.
+ *
+ * Bound leases can be saved and restored in chunks of
+ * DHCPS_LEASE_CHUNK addresses; a chunk is marked dirty when a lease of it
+ * is bound to a new client, released or expires, not when it is renewed.
+ * A chunk is saved as:
+ *
+ *   u8 version, u8 count, then per lease: u8 mac[6], u32 ip (network order),
+ *   u32 seconds left (little endian)
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lwip/opt.h"
+#include "lwip/ip4_addr.h"
+
+/* Addresses handed out, up to an address per AID of the soft AP */
+#ifndef DHCPS_MAX_LEASE
+#define DHCPS_MAX_LEASE			100
+#endif
+
+#define DHCPS_LEASE_LIMIT		2007
+
+#if DHCPS_MAX_LEASE > DHCPS_LEASE_LIMIT
+#error "DHCPS_MAX_LEASE is over the 2007 stations of a soft AP"
+#endif
+
+/* MAC hash buckets, a power of 2 */
+#ifndef DHCPS_LEASE_BUCKETS
+#if DHCPS_MAX_LEASE > 512
+#define DHCPS_LEASE_BUCKETS		1024
+#elif DHCPS_MAX_LEASE > 128
+#define DHCPS_LEASE_BUCKETS		256
+#else
+#define DHCPS_LEASE_BUCKETS		64
+#endif
+#endif
+
+/* Timer wheel slots, of a second each */
+#ifndef DHCPS_LEASE_WHEEL
+#define DHCPS_LEASE_WHEEL		256
+#endif
+
+/* How long an offered address is kept for the REQUEST */
+#ifndef DHCPS_OFFER_SECS
+#define DHCPS_OFFER_SECS		60
+#endif
+
+/* Addresses per saved chunk */
+#ifndef DHCPS_LEASE_CHUNK
+#define DHCPS_LEASE_CHUNK		64
+#endif
+
+/*
+ * dhcpserver.c saves the dirty chunks to NVS (SUPPORT_NVS_FLASH) once
+ * DHCPS_LEASE_SAVE_BATCH leases changed or DHCPS_LEASE_SAVE_SECS after
+ * the first change, and when it stops
+ */
+#ifndef DHCPS_LEASE_PERSIST
+#define DHCPS_LEASE_PERSIST		1
+#endif
+
+#ifndef DHCPS_LEASE_SAVE_BATCH
+#define DHCPS_LEASE_SAVE_BATCH	16
+#endif
+
+#ifndef DHCPS_LEASE_SAVE_SECS
+#define DHCPS_LEASE_SAVE_SECS	30
+#endif
+
+#define DHCPS_LEASE_CHUNKS	((DHCPS_MAX_LEASE + DHCPS_LEASE_CHUNK - 1) / DHCPS_LEASE_CHUNK)
+#define DHCPS_LEASE_RECORD		14
+#define DHCPS_LEASE_CHUNK_SIZE	(2 + DHCPS_LEASE_CHUNK * DHCPS_LEASE_RECORD)
+#define DHCPS_LEASE_VERSION		1
+
+enum dhcps_lease_result {
+	DHCPS_LEASE_OK = 0,
+	DHCPS_LEASE_FULL = -1,		/* no address left */
+	DHCPS_LEASE_WRONG = -2,		/* address not for this client */
+};
+
+struct dhcps_pool {
+	ip4_addr_t ip;
+	u8_t mac[6];
+	u32_t lease_timer;			/* seconds left */
+	bool bound;					/* false while offered */
+};
+
+/*********************************************************************
+ * @fn dhcps_lease_table_init
+ *
+ * @brief Empty the table and set the pool
+ *
+ * @param start: first address
+ *
+ * @param num: addresses, up to DHCPS_MAX_LEASE
+ *
+ * @return none
+ **********************************************************************/
+void dhcps_lease_table_init(const ip4_addr_t *start, u16_t num);
+
+/*********************************************************************
+ * @fn dhcps_lease_offer
+ *
+ * @brief Address for a DISCOVER: the one the client has, else a free one,
+ *        else the one expiring first. A new address is held for
+ *        DHCPS_OFFER_SECS.
+ *
+ * @param mac
+ *
+ * @param ip: address offered
+ *
+ * @param now: seconds
+ *
+ * @return DHCPS_LEASE_OK, DHCPS_LEASE_FULL
+ **********************************************************************/
+int dhcps_lease_offer(const u8_t *mac, ip4_addr_t *ip, u32_t now);
+
+/*********************************************************************
+ * @fn dhcps_lease_bind
+ *
+ * @brief Bind or renew for a REQUEST. A client without a lease gets the
+ *        address it asks for if it is free, as after a restart of the AP.
+ *
+ * @param mac
+ *
+ * @param ip: address requested
+ *
+ * @param now, secs: lease from now for secs seconds
+ *
+ * @return DHCPS_LEASE_OK, DHCPS_LEASE_WRONG for a NAK
+ **********************************************************************/
+int dhcps_lease_bind(const u8_t *mac, const ip4_addr_t *ip, u32_t now, u32_t secs);
+
+/*********************************************************************
+ * @fn dhcps_lease_release
+ *
+ * @brief Free the address of a client, on RELEASE or DECLINE
+ *
+ * @return none
+ **********************************************************************/
+void dhcps_lease_release(const u8_t *mac);
+
+/*********************************************************************
+ * @fn dhcps_lease_find
+ *
+ * @brief Address of a client
+ *
+ * @return true if the client has a lease
+ **********************************************************************/
+bool dhcps_lease_find(const u8_t *mac, ip4_addr_t *ip);
+
+/*********************************************************************
+ * @fn dhcps_lease_tick
+ *
+ * @brief Expire the leases due, to be called every second
+ *
+ * @param now: seconds
+ *
+ * @return none
+ **********************************************************************/
+void dhcps_lease_tick(u32_t now);
+
+/*********************************************************************
+ * @fn dhcps_lease_count
+ *
+ * @brief Leases in use, offered or bound
+ *
+ * @return count
+ **********************************************************************/
+u16_t dhcps_lease_count(void);
+
+/*********************************************************************
+ * @fn dhcps_lease_foreach
+ *
+ * @brief Call fn for each lease in use, by address
+ *
+ * @param fn, arg
+ *
+ * @param now: seconds, for lease_timer
+ *
+ * @return none
+ **********************************************************************/
+void dhcps_lease_foreach(void (*fn)(const struct dhcps_pool *lease, void *arg), void *arg,
+						 u32_t now);
+
+/*********************************************************************
+ * @fn dhcps_lease_dirty
+ *
+ * @brief Next chunk to save
+ *
+ * @param from: first chunk to look at
+ *
+ * @return chunk, -1 if none is dirty
+ **********************************************************************/
+int dhcps_lease_dirty(int from);
+
+/*********************************************************************
+ * @fn dhcps_lease_save
+ *
+ * @brief Bound leases of a chunk, and mark it clean
+ *
+ * @param chunk
+ *
+ * @param buf: DHCPS_LEASE_CHUNK_SIZE bytes
+ *
+ * @param now: seconds
+ *
+ * @return bytes written to buf
+ **********************************************************************/
+size_t dhcps_lease_save(int chunk, u8_t *buf, u32_t now);
+
+/*********************************************************************
+ * @fn dhcps_lease_restore
+ *
+ * @brief Bind the leases of a saved chunk that are in the pool, and
+ *        whose address and client are free
+ *
+ * @param chunk: the chunk saved, marked dirty if the pool moved since
+ *
+ * @param buf, len
+ *
+ * @param now: seconds
+ *
+ * @return leases restored, -1 if buf is not a chunk
+ **********************************************************************/
+int dhcps_lease_restore(int chunk, const u8_t *buf, size_t len, u32_t now);
+
+#endif /* __DHCPS_LEASE_H__ */
@@ -7,6 +7,7 @@
 
 #include "nrc_lwip.h"
 #include "lwip/ip_addr.h"
+#include "dhcps_lease.h"
 #if 0
 struct ip_info {
 	ip_addr_t ip;      /**< IP address */
@@ -47,24 +48,12 @@ enum dhcps_offer_option {
 };
 #endif
 
-struct dhcps_pool {
-	ip4_addr_t ip;
-	u8_t mac[6];
-	u32_t lease_timer;
-};
-
-typedef struct _list_node {
-	void* pnode;
-	struct _list_node* pnext;
-} list_node;
-
 extern u32_t dhcps_lease_time;
 #define DHCPS_COARSE_TIMER_SECS  1
 /** period (in milliseconds) of the application calling dhcps_coarse_tmr() */
 #define DHCPS_COARSE_TIMER_MSECS (DHCPS_COARSE_TIMER_SECS * 1000UL)
 
 #define DHCPS_LEASE_TIMER  dhcps_lease_time  //0x05A0
-#define DHCPS_MAX_LEASE 0x64
 #define BOOTP_BROADCAST 0x8000
 
 #define DHCP_REPLY          2
@@ -96,8 +85,6 @@ extern u32_t dhcps_lease_time;
 #define DHCP_OPTION_REQ_LIST     55
 #define DHCP_OPTION_END         255
 
-#define MAX_STATION_NUM      75
-
 #define DHCPS_STATE_OFFER 1
 #define DHCPS_STATE_DECLINE 2
 #define DHCPS_STATE_ACK 3
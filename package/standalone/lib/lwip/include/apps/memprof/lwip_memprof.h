@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __LWIP_MEMPROF_H__
+#define __LWIP_MEMPROF_H__
+
+/*
+ * High-water marks and allocation failures of the lwIP heap and of each
+ * memp pool, read from the MEM_STATS and MEMP_STATS counters of lwip_stats.
+ *
+ * lwip_memprof_reset() starts a measurement window: the high-water marks
+ * drop to what is in use and the failures to 0. After the workload has run,
+ * lwip_memprof_dump() prints a profile:
+ *
+ *   LWIPPROF <version> <ms since the reset>
+ *   CONF <option> <value>                           TCP and pbuf settings
+ *   HEAP <MEM_SIZE> <used> <max> <err>
+ *   POOL <name> <element size> <num> <used> <max> <err>
+ *   END
+ *
+ * lib/lwip/tools/lwip_memprof.py merges profiles into a lwipopts_tuned.h
+ * that lwipopts.h includes when LWIP_TUNED_OPTS names it.
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_MEMPROF && LWIP_STATS && MEM_STATS && MEMP_STATS
+
+#include "lwip/memp.h"
+
+#define LWIP_MEMPROF_VERSION	1
+
+struct lwip_memprof_pool {
+	const char *name;		/* MEMP_<name>, or MEM_SIZE for the heap */
+	u32_t size;				/* element size, 1 for the heap */
+	u32_t num;				/* elements, bytes for the heap */
+	u32_t used;
+	u32_t max;
+	u32_t err;
+};
+
+struct lwip_memprof {
+	u32_t window_ms;		/* since lwip_memprof_reset() */
+	struct lwip_memprof_pool heap;
+	struct lwip_memprof_pool pool[MEMP_MAX];
+};
+
+/* Called with each line of the profile, without the line end */
+typedef void (*lwip_memprof_out_fn)(const char *line, void *arg);
+
+/*********************************************************************
+ * @fn lwip_memprof_get
+ *
+ * @brief Read the counters of the heap and of every pool
+ *
+ * @param prof
+ *
+ * @return none
+ **********************************************************************/
+void lwip_memprof_get(struct lwip_memprof *prof);
+
+/*********************************************************************
+ * @fn lwip_memprof_reset
+ *
+ * @brief Start a new window: high-water marks to the current use,
+ *        failures to 0
+ *
+ * @return none
+ **********************************************************************/
+void lwip_memprof_reset(void);
+
+/*********************************************************************
+ * @fn lwip_memprof_dump
+ *
+ * @brief Print the profile for lib/lwip/tools/lwip_memprof.py
+ *
+ * @param out, arg: line output
+ *
+ * @return none
+ **********************************************************************/
+void lwip_memprof_dump(lwip_memprof_out_fn out, void *arg);
+
+#endif /* LWIP_MEMPROF && LWIP_STATS && MEM_STATS && MEMP_STATS */
+
+#endif /* __LWIP_MEMPROF_H__ */
@@ -0,0 +1,119 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __LWIP_RESUME_H__
+#define __LWIP_RESUME_H__
+
+/*
+ * Warm resume: the IPv4 state of a netif is serialized before a deep sleep
+ * and put back on wakeup, so that the first packet does not wait for DHCP
+ * or ARP. The snapshot holds the address, the DHCP lease, the DNS servers,
+ * the ARP entries of the gateway and other neighbours, and the local ports
+ * of the open UDP PCBs.
+ *
+ * The snapshot is a versioned little-endian byte stream with a checksum.
+ * A snapshot of another version, for another netif or damaged in any way is
+ * rejected and the caller falls back to DHCP.
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_RESUME && LWIP_IPV4 && LWIP_UDP
+
+#include "lwip/netif.h"
+#include "lwip/ip_addr.h"
+
+#define LWIP_RESUME_VERSION	1
+
+#ifndef LWIP_RESUME_ARP_MAX
+#define LWIP_RESUME_ARP_MAX	2
+#endif
+
+#ifndef LWIP_RESUME_UDP_MAX
+#define LWIP_RESUME_UDP_MAX	4
+#endif
+
+/* Largest snapshot of this version */
+#define LWIP_RESUME_SIZE_MAX	(52 + LWIP_RESUME_ARP_MAX * 10 + LWIP_RESUME_UDP_MAX * 12)
+
+/* Result of a restore */
+struct lwip_resume_info {
+	u8_t dhcp;		/* a DHCP lease was bound */
+	u8_t arp;		/* ARP entries restored */
+	u8_t udp;		/* UDP bindings available to lwip_resume_udp_port() */
+	u32_t lease_left;	/* seconds, 0xffffffff for infinite */
+};
+
+/*********************************************************************
+ * @fn lwip_resume_save
+ *
+ * @brief Serialize the IPv4 state of a netif. Call with the core locked.
+ *
+ * @param netif
+ *
+ * @param buf: at least LWIP_RESUME_SIZE_MAX bytes
+ *
+ * @param len: size of buf
+ *
+ * @return Length of the snapshot, or a negative err_t
+ **********************************************************************/
+int lwip_resume_save(struct netif *netif, u8_t *buf, u16_t len);
+
+/*********************************************************************
+ * @fn lwip_resume_restore
+ *
+ * @brief Put a snapshot back on a netif that is up. Call with the core
+ *        locked.
+ *
+ * @param netif
+ *
+ * @param buf, len: the snapshot
+ *
+ * @param elapsed: seconds since lwip_resume_save()
+ *
+ * @param info: what was restored, may be NULL
+ *
+ * @return ERR_OK, ERR_VAL if the snapshot is not usable, ERR_TIMEOUT if
+ *         the lease has expired, ERR_MEM
+ **********************************************************************/
+err_t lwip_resume_restore(struct netif *netif, const u8_t *buf, u16_t len, u32_t elapsed,
+						  struct lwip_resume_info *info);
+
+/*********************************************************************
+ * @fn lwip_resume_udp_port
+ *
+ * @brief Local port a connected UDP PCB talking to a peer was bound to
+ *        before the sleep. Binding the new PCB to it keeps the flow the
+ *        peer, or a NAT on the way, already knows.
+ *
+ * @param remote_ip, remote_port: the peer
+ *
+ * @return The local port, 0 if none was saved
+ **********************************************************************/
+u16_t lwip_resume_udp_port(const ip_addr_t *remote_ip, u16_t remote_port);
+
+#endif /* LWIP_RESUME && LWIP_IPV4 && LWIP_UDP */
+
+#endif /* __LWIP_RESUME_H__ */
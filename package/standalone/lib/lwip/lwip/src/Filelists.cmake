@@ -50,6 +50,8 @@ set(lwipcore_SRCS
     ${LWIP_DIR}/src/core/tcp.c
     ${LWIP_DIR}/src/core/tcp_in.c
     ${LWIP_DIR}/src/core/tcp_out.c
+    ${LWIP_DIR}/src/core/tcp_sack.c
+    ${LWIP_DIR}/src/core/tcp_cc.c
     ${LWIP_DIR}/src/core/timeouts.c
     ${LWIP_DIR}/src/core/udp.c
 )
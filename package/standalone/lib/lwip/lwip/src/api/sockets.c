@@ -3121,6 +3121,13 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
           LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, TCP_QUICKACK) = %d\n",
                                       s, *(int *)optval));
           break;
+#if LWIP_TCP_CC
+        case TCP_CONGESTION:
+          *(int *)optval = (int)tcp_get_cc(sock->conn->pcb.tcp);
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, TCP_CONGESTION) = %d\n",
+                                      s, *(int *)optval));
+          break;
+#endif /* LWIP_TCP_CC */
 
 #if LWIP_TCP_KEEPALIVE
         case TCP_KEEPIDLE:
@@ -3607,6 +3614,16 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
           sock->conn->pcb.tcp->quickack = (uint8_t)((*(const int *)optval) > 0 ? (*(const int *)optval) : 0);
           LWIP_DEBUGF(SOCKETS_DEBUG, ("(TCP_QUICKACK) value: %d", (*(const int *)optval)));
           break;
+#if LWIP_TCP_CC
+        case TCP_CONGESTION:
+          if ((*(const int *)optval) < 0 || (*(const int *)optval) >= TCP_CC_NUM ||
+              tcp_set_cc(sock->conn->pcb.tcp, (u8_t)(*(const int *)optval)) != ERR_OK) {
+            err = EINVAL;
+          }
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, TCP_CONGESTION) -> %d\n",
+                                      s, (*(const int *)optval)));
+          break;
+#endif /* LWIP_TCP_CC */
 
 
 #if LWIP_TCP_KEEPALIVE
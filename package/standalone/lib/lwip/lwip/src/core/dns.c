@@ -213,7 +213,8 @@ typedef enum {
   DNS_STATE_UNUSED           = 0,
   DNS_STATE_NEW              = 1,
   DNS_STATE_ASKING           = 2,
-  DNS_STATE_DONE             = 3
+  DNS_STATE_DONE             = 3,
+  DNS_STATE_FAILED           = 4  /* NXDOMAIN, kept for DNS_NEG_TTL */
 } dns_state_enum_t;
 
 /** DNS table entry */
@@ -226,6 +227,10 @@ struct dns_table_entry {
   u8_t  tmr;
   u8_t  retries;
   u8_t  seqno;
+#if DNS_PREFETCH_TTL
+  /* asked again, ipaddr still answers */
+  u8_t  prefetch;
+#endif
 #if ((LWIP_DNS_SECURE & LWIP_DNS_SECURE_RAND_SRC_PORT) != 0)
   u8_t pcb_idx;
 #endif
@@ -285,6 +290,9 @@ static err_t dns_lookup_local(const char *hostname, ip_addr_t *addr LWIP_DNS_ADD
 static void dns_recv(void *s, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
 static void dns_check_entries(void);
 static void dns_call_found(u8_t idx, ip_addr_t *addr);
+#if DNS_PREFETCH_TTL
+static void dns_prefetch(u8_t idx);
+#endif
 
 /*-----------------------------------------------------------------------------
  * Globals
@@ -596,7 +604,8 @@ dns_local_addhost(const char *hostname, const ip_addr_t *addr)
  * @param addr the hostname's IP address, as u32_t (instead of ip_addr_t to
  *         better check for failure: != IPADDR_NONE) or IPADDR_NONE if the hostname
  *         was not found in the cached dns_table.
- * @return ERR_OK if found, ERR_ARG if not found
+ * @return ERR_OK if found, ERR_VAL if known not to exist (DNS_NEG_TTL),
+ *         ERR_ARG if not found
  */
 static err_t
 dns_lookup(const char *name, ip_addr_t *addr LWIP_DNS_ADDRTYPE_ARG(u8_t dns_addrtype))
@@ -615,7 +624,19 @@ dns_lookup(const char *name, ip_addr_t *addr LWIP_DNS_ADDRTYPE_ARG(u8_t dns_addr
 
   /* Walk through name list, return entry if found. If not, return NULL. */
   for (i = 0; i < DNS_TABLE_SIZE; ++i) {
-    if ((dns_table[i].state == DNS_STATE_DONE) &&
+#if DNS_NEG_TTL
+    /* NXDOMAIN is about the name, whatever the address type */
+    if ((dns_table[i].state == DNS_STATE_FAILED) &&
+        (lwip_strnicmp(name, dns_table[i].name, sizeof(dns_table[i].name)) == 0)) {
+      LWIP_DEBUGF(DNS_DEBUG, ("dns_lookup: \"%s\": does not exist\n", name));
+      return ERR_VAL;
+    }
+#endif /* DNS_NEG_TTL */
+    if (((dns_table[i].state == DNS_STATE_DONE)
+#if DNS_PREFETCH_TTL
+         || (dns_table[i].prefetch && (dns_table[i].state != DNS_STATE_UNUSED))
+#endif /* DNS_PREFETCH_TTL */
+        ) &&
         (lwip_strnicmp(name, dns_table[i].name, sizeof(dns_table[i].name)) == 0) &&
         LWIP_DNS_ADDRTYPE_MATCH_IP(dns_addrtype, dns_table[i].ipaddr)) {
       LWIP_DEBUGF(DNS_DEBUG, ("dns_lookup: \"%s\": found = ", name));
@@ -624,6 +645,11 @@ dns_lookup(const char *name, ip_addr_t *addr LWIP_DNS_ADDRTYPE_ARG(u8_t dns_addr
       if (addr) {
         ip_addr_copy(*addr, dns_table[i].ipaddr);
       }
+#if DNS_PREFETCH_TTL
+      if ((dns_table[i].state == DNS_STATE_DONE) && (dns_table[i].ttl <= DNS_PREFETCH_TTL)) {
+        dns_prefetch(i);
+      }
+#endif /* DNS_PREFETCH_TTL */
       return ERR_OK;
     }
   }
@@ -1085,6 +1111,9 @@ dns_check_entry(u8_t i)
             dns_call_found(i, NULL);
             /* flush this entry */
             entry->state = DNS_STATE_UNUSED;
+#if DNS_PREFETCH_TTL
+            entry->prefetch = 0;
+#endif
             break;
           }
         } else {
@@ -1101,6 +1130,7 @@ dns_check_entry(u8_t i)
       }
       break;
     case DNS_STATE_DONE:
+    case DNS_STATE_FAILED:
       /* if the time to live is nul */
       if ((entry->ttl == 0) || (--entry->ttl == 0)) {
         LWIP_DEBUGF(DNS_DEBUG, ("dns_check_entry: \"%s\": flush\n", entry->name));
@@ -1117,6 +1147,38 @@ dns_check_entry(u8_t i)
   }
 }
 
+#if DNS_PREFETCH_TTL
+/**
+ * Ask again for a cached name about to expire. The entry goes on answering
+ * lookups with its address until the response comes, and is flushed as
+ * usual if none comes.
+ *
+ * @param idx dns table index of the entry
+ */
+static void
+dns_prefetch(u8_t idx)
+{
+  struct dns_table_entry *entry = &dns_table[idx];
+
+#if LWIP_DNS_SUPPORT_MDNS_QUERIES
+  if (entry->is_mdns) {
+    return;
+  }
+#endif /* LWIP_DNS_SUPPORT_MDNS_QUERIES */
+#if ((LWIP_DNS_SECURE & LWIP_DNS_SECURE_RAND_SRC_PORT) != 0)
+  entry->pcb_idx = dns_alloc_pcb();
+  if (entry->pcb_idx >= DNS_MAX_SOURCE_PORTS) {
+    /* try again with the next lookup */
+    return;
+  }
+#endif
+  LWIP_DEBUGF(DNS_DEBUG, ("dns_prefetch: \"%s\": %"U32_F" s left\n", entry->name, entry->ttl));
+  entry->prefetch = 1;
+  entry->state = DNS_STATE_NEW;
+  dns_check_entry(idx);
+}
+#endif /* DNS_PREFETCH_TTL */
+
 /**
  * Call dns_check_entry for each entry in dns_table - check all entries.
  */
@@ -1139,6 +1201,9 @@ dns_correct_response(u8_t idx, u32_t ttl)
   struct dns_table_entry *entry = &dns_table[idx];
 
   entry->state = DNS_STATE_DONE;
+#if DNS_PREFETCH_TTL
+  entry->prefetch = 0;
+#endif
 
   LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": response = ", entry->name));
   ip_addr_debug_print_val(DNS_DEBUG, entry->ipaddr);
@@ -1351,6 +1416,20 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr,
         pbuf_free(p);
         dns_call_found(i, NULL);
         dns_table[i].state = DNS_STATE_UNUSED;
+#if DNS_PREFETCH_TTL
+        dns_table[i].prefetch = 0;
+#endif
+#if DNS_NEG_TTL
+        /* remember names that do not exist (RFC 2308) */
+        if ((hdr.flags2 & DNS_FLAG2_ERR_MASK) == DNS_FLAG2_ERR_NAME
+#if LWIP_DNS_SUPPORT_MDNS_QUERIES
+            && !entry->is_mdns
+#endif /* LWIP_DNS_SUPPORT_MDNS_QUERIES */
+           ) {
+          dns_table[i].state = DNS_STATE_FAILED;
+          dns_table[i].ttl = DNS_NEG_TTL;
+        }
+#endif /* DNS_NEG_TTL */
         return;
       }
     }
@@ -1421,7 +1500,7 @@ dns_enqueue(const char *name, size_t hostnamelen, dns_found_callback found,
       break;
     }
     /* check if this is the oldest completed entry */
-    if (entry->state == DNS_STATE_DONE) {
+    if ((entry->state == DNS_STATE_DONE) || (entry->state == DNS_STATE_FAILED)) {
       u8_t age = (u8_t)(dns_seqno - entry->seqno);
       if (age > lseq) {
         lseq = age;
@@ -1432,7 +1511,8 @@ dns_enqueue(const char *name, size_t hostnamelen, dns_found_callback found,
 
   /* if we don't have found an unused entry, use the oldest completed one */
   if (i == DNS_TABLE_SIZE) {
-    if ((lseqi >= DNS_TABLE_SIZE) || (dns_table[lseqi].state != DNS_STATE_DONE)) {
+    if ((lseqi >= DNS_TABLE_SIZE) ||
+        ((dns_table[lseqi].state != DNS_STATE_DONE) && (dns_table[lseqi].state != DNS_STATE_FAILED))) {
       /* no entry can be used now, table is full */
       LWIP_DEBUGF(DNS_DEBUG, ("dns_enqueue: \"%s\": DNS entries table is full\n", name));
       return ERR_MEM;
@@ -1469,6 +1549,9 @@ dns_enqueue(const char *name, size_t hostnamelen, dns_found_callback found,
   /* fill the entry */
   entry->state = DNS_STATE_NEW;
   entry->seqno = dns_seqno;
+#if DNS_PREFETCH_TTL
+  entry->prefetch = 0;
+#endif
   LWIP_DNS_SET_ADDRTYPE(entry->reqaddrtype, dns_addrtype);
   LWIP_DNS_SET_ADDRTYPE(req->reqaddrtype, dns_addrtype);
   req->found = found;
@@ -1513,6 +1596,8 @@ dns_enqueue(const char *name, size_t hostnamelen, dns_found_callback found,
  * - ERR_INPROGRESS enqueue a request to be sent to the DNS server
  *   for resolution if no errors are present.
  * - ERR_ARG: dns client not initialized or invalid hostname
+ * - ERR_VAL: the server reported the name does not exist a short while
+ *   ago (DNS_NEG_TTL), or no server is set
  *
  * @param hostname the hostname that is to be queried
  * @param addr pointer to a ip_addr_t where to store the address if it is already
@@ -1548,6 +1633,7 @@ dns_gethostbyname_addrtype(const char *hostname, ip_addr_t *addr, dns_found_call
                            void *callback_arg, u8_t dns_addrtype)
 {
   size_t hostnamelen;
+  err_t err;
 #if LWIP_DNS_SUPPORT_MDNS_QUERIES
   u8_t is_mdns;
 #endif
@@ -1587,8 +1673,10 @@ dns_gethostbyname_addrtype(const char *hostname, ip_addr_t *addr, dns_found_call
     }
   }
   /* already have this address cached? */
-  if (dns_lookup(hostname, addr LWIP_DNS_ADDRTYPE_ARG(dns_addrtype)) == ERR_OK) {
-    return ERR_OK;
+  err = dns_lookup(hostname, addr LWIP_DNS_ADDRTYPE_ARG(dns_addrtype));
+  if (err != ERR_ARG) {
+    /* found, or known not to exist */
+    return err;
   }
 #if LWIP_IPV4 && LWIP_IPV6
   if ((dns_addrtype == LWIP_DNS_ADDRTYPE_IPV4_IPV6) || (dns_addrtype == LWIP_DNS_ADDRTYPE_IPV6_IPV4)) {
@@ -1628,4 +1716,211 @@ dns_gethostbyname_addrtype(const char *hostname, ip_addr_t *addr, dns_found_call
                      LWIP_DNS_ISMDNS_ARG(is_mdns));
 }
 
+#if LWIP_RESUME
+/* names of up to DNS_MAX_NAME_LENGTH - 1 chars are saved with a u8_t length */
+#if DNS_MAX_NAME_LENGTH > 256
+#error DNS_MAX_NAME_LENGTH must be at most 256 for dns_cache_save()
+#endif
+
+/**
+ * Serialize the resolved names, the most recently asked first, as many as
+ * fit in buf, so that they can be restored after a deep sleep:
+ *   u8 DNS_CACHE_VERSION, u8 count, then per name:
+ *   u8 name length, name, u8 4 or 6, address, u32 seconds left (little endian)
+ *
+ * @param buf buffer to write to
+ * @param len size of buf
+ * @return length written, or ERR_BUF if buf is too small for the header
+ */
+int
+dns_cache_save(u8_t *buf, u16_t len)
+{
+  u8_t order[DNS_TABLE_SIZE];
+  u8_t i, j, n = 0, count = 0;
+  u16_t pos = 2;
+
+  if (len < 2) {
+    return ERR_BUF;
+  }
+
+  /* by age, youngest first */
+  for (i = 0; i < DNS_TABLE_SIZE; i++) {
+    if ((dns_table[i].state != DNS_STATE_DONE) || (dns_table[i].ttl == 0)) {
+      continue;
+    }
+    for (j = n; (j > 0) &&
+         ((u8_t)(dns_seqno - dns_table[order[j - 1]].seqno) > (u8_t)(dns_seqno - dns_table[i].seqno)); j--) {
+      order[j] = order[j - 1];
+    }
+    order[j] = i;
+    n++;
+  }
+
+  for (j = 0; j < n; j++) {
+    struct dns_table_entry *entry = &dns_table[order[j]];
+    u8_t namelen = (u8_t)strlen(entry->name);
+    u8_t addrlen = 4;
+    u32_t ttl = entry->ttl;
+
+#if LWIP_IPV6
+    if (IP_IS_V6_VAL(entry->ipaddr)) {
+      addrlen = 16;
+    }
+#endif /* LWIP_IPV6 */
+    if (pos + 1 + namelen + 1 + addrlen + 4 > len) {
+      break;
+    }
+    buf[pos++] = namelen;
+    MEMCPY(&buf[pos], entry->name, namelen);
+    pos = (u16_t)(pos + namelen);
+    buf[pos++] = (addrlen == 4) ? 4 : 6;
+#if LWIP_IPV6
+    if (addrlen == 16) {
+      MEMCPY(&buf[pos], ip_2_ip6(&entry->ipaddr)->addr, 16);
+    } else
+#endif /* LWIP_IPV6 */
+    {
+#if LWIP_IPV4
+      MEMCPY(&buf[pos], &ip_2_ip4(&entry->ipaddr)->addr, 4);
+#endif /* LWIP_IPV4 */
+    }
+    pos = (u16_t)(pos + addrlen);
+    buf[pos++] = (u8_t)ttl;
+    buf[pos++] = (u8_t)(ttl >> 8);
+    buf[pos++] = (u8_t)(ttl >> 16);
+    buf[pos++] = (u8_t)(ttl >> 24);
+    count++;
+  }
+
+  buf[0] = DNS_CACHE_VERSION;
+  buf[1] = count;
+  return pos;
+}
+
+/**
+ * Read a name serialized by dns_cache_save()
+ *
+ * @return ERR_OK, ERR_VAL if the record is not complete
+ */
+static err_t
+dns_cache_record(const u8_t *buf, u16_t len, u16_t *pos, const char **name, u8_t *namelen,
+                 ip_addr_t *ipaddr, u32_t *ttl)
+{
+  u16_t i = *pos;
+  u16_t n;
+  u8_t addrlen;
+
+  if (i + 1 > len) {
+    return ERR_VAL;
+  }
+  /* wider than the u8_t of the record, for the 256 of the default */
+  n = buf[i++];
+  if ((n == 0) || (n >= DNS_MAX_NAME_LENGTH) || (i + n + 1 > len)) {
+    return ERR_VAL;
+  }
+  *namelen = (u8_t)n;
+  *name = (const char *)&buf[i];
+  i = (u16_t)(i + n);
+  addrlen = (buf[i++] == 6) ? 16 : 4;
+  if (i + addrlen + 4 > len) {
+    return ERR_VAL;
+  }
+  ip_addr_set_zero(ipaddr);
+#if LWIP_IPV6
+  if (addrlen == 16) {
+    IP_SET_TYPE_VAL(*ipaddr, IPADDR_TYPE_V6);
+    MEMCPY(ip_2_ip6(ipaddr)->addr, &buf[i], 16);
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  if (addrlen == 4) {
+    IP_SET_TYPE_VAL(*ipaddr, IPADDR_TYPE_V4);
+    MEMCPY(&ip_2_ip4(ipaddr)->addr, &buf[i], 4);
+  }
+#endif /* LWIP_IPV4 */
+  i = (u16_t)(i + addrlen);
+  *ttl = buf[i] | ((u32_t)buf[i + 1] << 8) | ((u32_t)buf[i + 2] << 16) | ((u32_t)buf[i + 3] << 24);
+  *pos = (u16_t)(i + 4);
+  return ERR_OK;
+}
+
+/**
+ * Put back names serialized by dns_cache_save() into free entries of the
+ * table. Names that expired in the meantime or are already in the table
+ * are skipped.
+ *
+ * @param buf the serialized names
+ * @param len length of buf
+ * @param elapsed seconds since dns_cache_save()
+ * @return number of names restored, or ERR_VAL if buf is not usable
+ */
+int
+dns_cache_restore(const u8_t *buf, u16_t len, u32_t elapsed)
+{
+  const char *name;
+  u8_t i, n, namelen;
+  u16_t pos = 2;
+  u32_t ttl;
+  ip_addr_t ipaddr;
+  int restored = 0;
+
+  if ((len < 2) || (buf[0] != DNS_CACHE_VERSION)) {
+    return ERR_VAL;
+  }
+  /* all or nothing */
+  for (n = 0; n < buf[1]; n++) {
+    if (dns_cache_record(buf, len, &pos, &name, &namelen, &ipaddr, &ttl) != ERR_OK) {
+      return ERR_VAL;
+    }
+  }
+
+  pos = 2;
+  for (n = 0; n < buf[1]; n++) {
+    dns_cache_record(buf, len, &pos, &name, &namelen, &ipaddr, &ttl);
+    if ((ttl <= elapsed) || (ttl > DNS_MAX_TTL) || ip_addr_isany_val(ipaddr)) {
+      continue;
+    }
+    /* already asked for since the wakeup? */
+    for (i = 0; i < DNS_TABLE_SIZE; i++) {
+      if ((dns_table[i].state != DNS_STATE_UNUSED) &&
+          (lwip_strnicmp(name, dns_table[i].name, namelen) == 0) &&
+          (dns_table[i].name[namelen] == 0)) {
+        break;
+      }
+    }
+    if (i < DNS_TABLE_SIZE) {
+      continue;
+    }
+    for (i = 0; i < DNS_TABLE_SIZE; i++) {
+      if (dns_table[i].state == DNS_STATE_UNUSED) {
+        break;
+      }
+    }
+    if (i == DNS_TABLE_SIZE) {
+      break;
+    }
+
+    MEMCPY(dns_table[i].name, name, namelen);
+    dns_table[i].name[namelen] = 0;
+    ip_addr_copy(dns_table[i].ipaddr, ipaddr);
+    dns_table[i].ttl = ttl - elapsed;
+    /* the first name is the one asked for last */
+    dns_table[i].seqno = (u8_t)(dns_seqno - 1 - n);
+#if DNS_PREFETCH_TTL
+    dns_table[i].prefetch = 0;
+#endif
+#if LWIP_IPV4 && LWIP_IPV6
+    dns_table[i].reqaddrtype = IP_IS_V6_VAL(ipaddr) ? LWIP_DNS_ADDRTYPE_IPV6 : LWIP_DNS_ADDRTYPE_IPV4;
+#endif /* LWIP_IPV4 && LWIP_IPV6 */
+#if LWIP_DNS_SUPPORT_MDNS_QUERIES
+    dns_table[i].is_mdns = 0;
+#endif
+    dns_table[i].state = DNS_STATE_DONE;
+    restored++;
+  }
+
+  return restored;
+}
+#endif /* LWIP_RESUME */
+
 #endif /* LWIP_DNS */
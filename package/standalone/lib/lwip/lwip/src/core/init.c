@@ -169,6 +169,12 @@ PACK_STRUCT_END
 #if (LWIP_TCP && LWIP_TCP_SACK_OUT && (LWIP_TCP_MAX_SACK_NUM < 1))
 #error "LWIP_TCP_MAX_SACK_NUM must be greater than 0"
 #endif
+#if (LWIP_TCP && LWIP_TCP_SACK_IN && !LWIP_TCP_SACK_OUT)
+#error "To use LWIP_TCP_SACK_IN, LWIP_TCP_SACK_OUT needs to be enabled to offer SACK"
+#endif
+#if (LWIP_TCP && LWIP_TCP_RACK && !LWIP_TCP_SACK_IN)
+#error "To use LWIP_TCP_RACK, LWIP_TCP_SACK_IN needs to be enabled"
+#endif
 #if (LWIP_NETIF_API && (NO_SYS==1))
 #error "If you want to use NETIF API, you have to define NO_SYS=0 in your lwipopts.h"
 #endif
@@ -849,6 +849,109 @@ dhcp_start(struct netif *netif)
   return result;
 }
 
+#if LWIP_RESUME
+/* Seconds left of a lease time, infinite stays infinite */
+static u32_t
+dhcp_time_left(u32_t t, u32_t elapsed)
+{
+  if (t == 0xffffffffUL) {
+    return t;
+  }
+  return t > elapsed ? t - elapsed : 0;
+}
+
+/**
+ * Get the lease bound on a netif, with the times that are left of it.
+ *
+ * @param netif the netif to read the lease of
+ * @param lease filled in on success
+ * @return ERR_OK, or ERR_VAL if the netif has no bound lease
+ */
+err_t
+dhcp_get_lease(struct netif *netif, struct dhcp_lease *lease)
+{
+  struct dhcp *dhcp;
+  u32_t used;
+
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("netif != NULL", (netif != NULL), return ERR_ARG;);
+  LWIP_ERROR("lease != NULL", (lease != NULL), return ERR_ARG;);
+  dhcp = netif_dhcp_data(netif);
+
+  if (dhcp == NULL || !dhcp_supplied_address(netif)) {
+    return ERR_VAL;
+  }
+
+  used = (u32_t)dhcp->lease_used * DHCP_COARSE_TIMER_SECS;
+  ip4_addr_copy(lease->ip_addr, dhcp->offered_ip_addr);
+  ip4_addr_copy(lease->netmask, *netif_ip4_netmask(netif));
+  ip4_addr_copy(lease->gw, *netif_ip4_gw(netif));
+  ip4_addr_copy(lease->server, *ip_2_ip4(&dhcp->server_ip_addr));
+  lease->t0_lease = dhcp_time_left(dhcp->offered_t0_lease, used);
+  lease->t1_renew = dhcp_time_left(dhcp->offered_t1_renew, used);
+  lease->t2_rebind = dhcp_time_left(dhcp->offered_t2_rebind, used);
+  return ERR_OK;
+}
+
+/**
+ * Bind a lease obtained before, e.g. before a deep sleep, without talking to
+ * the server. The client continues as if it had just received an ACK for the
+ * time left of the lease: it renews at T1 and rebinds at T2. A lease past T1
+ * is renewed at the next coarse timer tick.
+ *
+ * @param netif the netif to bind the lease on, must be up
+ * @param lease the lease as returned by dhcp_get_lease()
+ * @param elapsed seconds passed since dhcp_get_lease()
+ * @return ERR_OK, ERR_TIMEOUT if the lease has expired, ERR_MEM
+ */
+err_t
+dhcp_restore_lease(struct netif *netif, const struct dhcp_lease *lease, u32_t elapsed)
+{
+  struct dhcp *dhcp;
+
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("netif != NULL", (netif != NULL), return ERR_ARG;);
+  LWIP_ERROR("lease != NULL", (lease != NULL), return ERR_ARG;);
+  LWIP_ERROR("netif is not up, old style port?", netif_is_up(netif), return ERR_ARG;);
+
+  if (dhcp_time_left(lease->t0_lease, elapsed) == 0) {
+    LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE, ("dhcp_restore_lease(): lease expired\n"));
+    return ERR_TIMEOUT;
+  }
+
+  dhcp = netif_dhcp_data(netif);
+  if (dhcp == NULL) {
+    dhcp = (struct dhcp *)mem_malloc(sizeof(struct dhcp));
+    if (dhcp == NULL) {
+      return ERR_MEM;
+    }
+    netif_set_client_data(netif, LWIP_NETIF_CLIENT_DATA_INDEX_DHCP, dhcp);
+  } else if (dhcp->pcb_allocated != 0) {
+    dhcp_dec_pcb_refcount();
+  }
+
+  memset(dhcp, 0, sizeof(struct dhcp));
+
+  if (dhcp_inc_pcb_refcount() != ERR_OK) {
+    return ERR_MEM;
+  }
+  dhcp->pcb_allocated = 1;
+
+  ip4_addr_copy(dhcp->offered_ip_addr, lease->ip_addr);
+  ip4_addr_copy(dhcp->offered_sn_mask, lease->netmask);
+  ip4_addr_copy(dhcp->offered_gw_addr, lease->gw);
+  ip_addr_copy_from_ip4(dhcp->server_ip_addr, lease->server);
+  dhcp->subnet_mask_given = 1;
+  dhcp->offered_t0_lease = dhcp_time_left(lease->t0_lease, elapsed);
+  dhcp->offered_t1_renew = dhcp_time_left(lease->t1_renew, elapsed);
+  dhcp->offered_t2_rebind = dhcp_time_left(lease->t2_rebind, elapsed);
+
+  LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("dhcp_restore_lease(): %"U32_F" secs left\n", dhcp->offered_t0_lease));
+  dhcp_bind(netif);
+  return ERR_OK;
+}
+#endif /* LWIP_RESUME */
+
 /**
  * @ingroup dhcp4
  * Inform a DHCP server of our manual configuration.
@@ -550,6 +550,31 @@ etharp_remove_static_entry(const ip4_addr_t *ipaddr)
 }
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
 
+#if LWIP_RESUME
+/** Add a dynamic ARP entry learnt before a deep sleep, so that the first
+ * packet after wakeup goes out without an ARP round trip. The entry ages
+ * and is refreshed like any other.
+ *
+ * @param netif netif the entry was learnt on
+ * @param ipaddr IP address of the entry
+ * @param ethaddr ethernet address of the entry
+ *
+ * @return See return values of etharp_add_static_entry
+ */
+err_t
+etharp_restore_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct eth_addr *ethaddr)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("etharp_restore_entry: netif != NULL", (netif != NULL), return ERR_ARG;);
+
+  if (!ip4_addr_netcmp(ipaddr, netif_ip4_addr(netif), netif_ip4_netmask(netif))) {
+    return ERR_RTE;
+  }
+
+  return etharp_update_arp_entry(netif, ipaddr, ethaddr, ETHARP_FLAG_TRY_HARD);
+}
+#endif /* LWIP_RESUME */
+
 /**
  * Remove all ARP table entries of the specified netif.
  *
@@ -1148,6 +1148,10 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   pcb->lastack = iss - 1;
   pcb->snd_wl2 = iss - 1;
   pcb->snd_lbb = iss - 1;
+#if LWIP_TCP_SACK_IN
+  pcb->sack_high = iss;
+  pcb->sack_recover = iss;
+#endif /* LWIP_TCP_SACK_IN */
   /* Start with a window that does not need scaling. When window scaling is
      enabled and used, the window is enlarged when both sides agree on scaling. */
   pcb->rcv_wnd = pcb->rcv_ann_wnd = TCPWND_MIN16(TCP_WND);
@@ -1193,7 +1197,6 @@ void
 tcp_slowtmr(void)
 {
   struct tcp_pcb *pcb, *prev;
-  tcpwnd_size_t eff_wnd;
   u8_t pcb_remove;      /* flag if a PCB should be removed */
   u8_t pcb_reset;       /* flag if a RST should be sent when removing */
   err_t err;
@@ -1294,11 +1297,7 @@ tcp_slowtmr_start:
             pcb->rtime = 0;
 
             /* Reduce congestion window and ssthresh. */
-            eff_wnd = LWIP_MIN(pcb->cwnd, pcb->snd_wnd);
-            pcb->ssthresh = eff_wnd >> 1;
-            if (pcb->ssthresh < (tcpwnd_size_t)(pcb->mss << 1)) {
-              pcb->ssthresh = (tcpwnd_size_t)(pcb->mss << 1);
-            }
+            pcb->ssthresh = tcp_cc_ssthresh(pcb);
             pcb->cwnd = pcb->mss;
             LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"TCPWNDSIZE_F
                                          " ssthresh %"TCPWNDSIZE_F"\n",
@@ -1514,6 +1513,10 @@ tcp_fasttmr_start:
         tcp_output(pcb);
         tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
       }
+#if LWIP_TCP_RACK
+      /* RACK reordering and tail loss probe timers */
+      tcp_rack_tmr(pcb);
+#endif /* LWIP_TCP_RACK */
       /* send pending FIN */
       if (pcb->flags & TF_CLOSEPEND) {
         LWIP_DEBUGF(TCP_DEBUG, ("tcp_fasttmr: pending FIN\n"));
@@ -1929,6 +1932,10 @@ tcp_alloc(u8_t prio)
     connection is established. To avoid these complications, we set ssthresh to the
     largest effective cwnd (amount of in-flight data) that the sender can have. */
     pcb->ssthresh = TCP_SND_BUF;
+    tcp_cc_init(pcb);
+#if LWIP_TCP_RACK
+    pcb->rack.reo_wnd_mult = 1;
+#endif /* LWIP_TCP_RACK */
 
 #if LWIP_CALLBACK_API
     pcb->recv = tcp_recv_null;
@@ -0,0 +1,255 @@
+/**
+ * @file
+ * Transmission Control Protocol, congestion control
+ *
+ * How cwnd opens on ACKs and what ssthresh becomes after a loss. NewReno
+ * (RFC 5681, RFC 3465 byte counting) is always built; with LWIP_TCP_CC each
+ * pcb may use another algorithm from tcp_cc_algos[], chosen by tcp_set_cc()
+ * or the TCP_CONGESTION socket option.
+ *
+ * Westwood+ keeps NewReno's window growth, but estimates the bandwidth from
+ * the bytes acknowledged per round trip and, after a loss, sets ssthresh to
+ * that bandwidth times the shortest round trip: the window that fills the
+ * path without queueing. A loss on a radio link that is not congested then
+ * costs the queue, not half of the window.
+ */
+
+/*
+ * Copyright (c) 2024 Newracom, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/priv/tcp_priv.h"
+#if LWIP_TCP_CC
+#include "lwip/sys.h"
+#endif /* LWIP_TCP_CC */
+
+#include <string.h>
+
+/**
+ * NewReno: open cwnd by 'acked' bytes, in slow start up to 2 SMSS per ACK
+ * (1 SMSS after an RTO), in congestion avoidance 1 SMSS per cwnd acked.
+ */
+void
+tcp_newreno_cong_avoid(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  if (pcb->cwnd < pcb->ssthresh) {
+    tcpwnd_size_t increase;
+    /* limit to 1 SMSS segment during period following RTO */
+    u8_t num_seg = (pcb->flags & TF_RTO) ? 1 : 2;
+    /* RFC 3465, section 2.2 Slow Start */
+    increase = LWIP_MIN(acked, (tcpwnd_size_t)(num_seg * pcb->mss));
+    TCP_WND_INC(pcb->cwnd, increase);
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
+  } else {
+    /* RFC 3465, section 2.1 Congestion Avoidance */
+    TCP_WND_INC(pcb->bytes_acked, acked);
+    if (pcb->bytes_acked >= pcb->cwnd) {
+      pcb->bytes_acked = (tcpwnd_size_t)(pcb->bytes_acked - pcb->cwnd);
+      TCP_WND_INC(pcb->cwnd, pcb->mss);
+    }
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
+  }
+}
+
+/**
+ * NewReno: half of the minimum of the current cwnd and the advertised
+ * window, at least 2 SMSS.
+ */
+tcpwnd_size_t
+tcp_newreno_ssthresh(struct tcp_pcb *pcb)
+{
+  tcpwnd_size_t ssthresh = LWIP_MIN(pcb->cwnd, pcb->snd_wnd) / 2;
+
+  if (ssthresh < (2U * pcb->mss)) {
+    LWIP_DEBUGF(TCP_FR_DEBUG,
+                ("tcp_newreno_ssthresh: The minimum value for ssthresh %"TCPWNDSIZE_F
+                 " should be min 2 mss %"U16_F"...\n",
+                 ssthresh, (u16_t)(2 * pcb->mss)));
+    ssthresh = (tcpwnd_size_t)(2U * pcb->mss);
+  }
+  return ssthresh;
+}
+
+#if LWIP_TCP_CC
+
+/** Rounds shorter than this (ms) are merged with the next one before
+    taking a bandwidth sample, so that ACK compression does not inflate it */
+#ifndef TCP_WESTWOOD_MIN_ROUND
+#define TCP_WESTWOOD_MIN_ROUND 50
+#endif
+
+static void
+tcp_westwood_init(struct tcp_pcb *pcb)
+{
+  memset(&pcb->cc_state.westwood, 0, sizeof(pcb->cc_state.westwood));
+}
+
+static void
+tcp_westwood_round(struct tcp_pcb *pcb, u32_t now)
+{
+  struct tcp_westwood *w = &pcb->cc_state.westwood;
+
+  /* ends with the ACK of the first byte sent from now on, a round trip later */
+  w->start = now;
+  w->acked = 0;
+  w->end_seq = pcb->snd_nxt;
+  w->started = 1;
+}
+
+/** Count the bytes acked; at the end of each round, filter a bandwidth sample */
+static void
+tcp_westwood_acked(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  struct tcp_westwood *w = &pcb->cc_state.westwood;
+  u32_t now = sys_now();
+  u32_t delta, sample;
+
+  if (!w->started) {
+    tcp_westwood_round(pcb, now);
+    return;
+  }
+  w->acked += acked;
+  if (TCP_SEQ_LEQ(pcb->lastack, w->end_seq)) {
+    return;
+  }
+  delta = now - w->start;
+  if (delta != 0 && (w->rtt_min == 0 || delta < w->rtt_min)) {
+    w->rtt_min = delta;
+  }
+  if (delta < TCP_WESTWOOD_MIN_ROUND) {
+    /* too short to tell, extend the round by another round trip */
+    w->end_seq = pcb->snd_nxt;
+    return;
+  }
+  if (w->acked < 0xFFFFFFFFUL / 1000) {
+    sample = w->acked * 1000 / delta;
+  } else {
+    sample = w->acked / delta * 1000;
+  }
+  /* Westwood+ low-pass filter, a gain of 1/8 */
+  if (w->bw == 0) {
+    w->bw = sample;
+  } else {
+    w->bw = w->bw - (w->bw >> 3) + (sample >> 3);
+  }
+  LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_westwood_acked: bw %"U32_F" B/s, rtt_min %"U32_F" ms\n",
+                               w->bw, w->rtt_min));
+  tcp_westwood_round(pcb, now);
+}
+
+/** The estimated bandwidth-delay product, at least 2 SMSS */
+static tcpwnd_size_t
+tcp_westwood_ssthresh(struct tcp_pcb *pcb)
+{
+  struct tcp_westwood *w = &pcb->cc_state.westwood;
+  u32_t bdp;
+
+  if (w->bw == 0 || w->rtt_min == 0) {
+    /* no estimate yet */
+    return tcp_newreno_ssthresh(pcb);
+  }
+  if (w->bw <= 0xFFFFFFFFUL / w->rtt_min) {
+    bdp = w->bw * w->rtt_min / 1000;
+  } else {
+    bdp = w->bw / 1000 * w->rtt_min;
+  }
+  bdp = LWIP_MIN(bdp, TCPWND_MAX);
+  if (bdp < (2U * pcb->mss)) {
+    bdp = 2U * pcb->mss;
+  }
+  LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_westwood_ssthresh: %"U32_F"\n", bdp));
+  return (tcpwnd_size_t)bdp;
+}
+
+static const struct tcp_cc_ops tcp_cc_newreno = {
+  NULL,
+  NULL,
+  tcp_newreno_cong_avoid,
+  tcp_newreno_ssthresh
+};
+
+static const struct tcp_cc_ops tcp_cc_westwood = {
+  tcp_westwood_init,
+  tcp_westwood_acked,
+  tcp_newreno_cong_avoid,
+  tcp_westwood_ssthresh
+};
+
+/** By TCP_CC_* */
+const struct tcp_cc_ops *const tcp_cc_algos[TCP_CC_NUM] = {
+  &tcp_cc_newreno,
+  &tcp_cc_westwood
+};
+
+/** Called for new pcbs: the default algorithm */
+void
+tcp_cc_init(struct tcp_pcb *pcb)
+{
+  LWIP_ASSERT("TCP_CC_DEFAULT", TCP_CC_DEFAULT < TCP_CC_NUM);
+  pcb->cc = TCP_CC_DEFAULT;
+  if (tcp_cc_algos[pcb->cc]->init != NULL) {
+    tcp_cc_algos[pcb->cc]->init(pcb);
+  }
+}
+
+/**
+ * @ingroup tcp_raw
+ * Select the congestion control of a connection, TCP_CC_NEWRENO or
+ * TCP_CC_WESTWOOD. It may change at any time; cwnd and ssthresh are kept,
+ * the new algorithm starts without history.
+ *
+ * @param pcb the tcp_pcb (not a listening one)
+ * @param cc TCP_CC_*
+ * @return ERR_OK, or ERR_VAL for an unknown algorithm or a listening pcb
+ */
+err_t
+tcp_set_cc(struct tcp_pcb *pcb, u8_t cc)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_set_cc: invalid pcb", pcb != NULL, return ERR_ARG);
+  if (cc >= TCP_CC_NUM || pcb->state == LISTEN) {
+    return ERR_VAL;
+  }
+  if (pcb->cc != cc) {
+    pcb->cc = cc;
+    if (tcp_cc_algos[cc]->init != NULL) {
+      tcp_cc_algos[cc]->init(pcb);
+    }
+  }
+  return ERR_OK;
+}
+
+#endif /* LWIP_TCP_CC */
+
+#endif /* LWIP_TCP */
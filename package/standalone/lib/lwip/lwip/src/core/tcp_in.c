@@ -85,6 +85,12 @@ static u8_t flags;
 static u8_t recv_flags;
 static struct pbuf *recv_data;
 
+#if LWIP_TCP_SACK_IN
+/* SACK blocks of the incoming segment, set by tcp_parseopt() */
+static struct tcp_sack_range tcp_sack_blocks[LWIP_TCP_SACK_IN_BLOCKS];
+static u8_t tcp_sack_num;
+#endif /* LWIP_TCP_SACK_IN */
+
 struct tcp_pcb *tcp_input_pcb;
 
 /* Forward declarations. */
@@ -695,6 +701,10 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     npcb->snd_nxt = iss;
     npcb->lastack = iss;
     npcb->snd_lbb = iss;
+#if LWIP_TCP_SACK_IN
+    npcb->sack_high = iss;
+    npcb->sack_recover = iss;
+#endif /* LWIP_TCP_SACK_IN */
     npcb->snd_wl1 = seqno - 1;/* initialise to seqno-1 to force window update */
     npcb->callback_arg = pcb->callback_arg;
 #if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
@@ -896,6 +906,12 @@ tcp_process(struct tcp_pcb *pcb)
           pcb->unsent = rseg->next;
         } else {
           pcb->unacked = rseg->next;
+#if LWIP_TCP_RACK
+          if (pcb->nrtx == 0) {
+            /* the handshake is the first round trip of RACK */
+            tcp_rack_delivered(pcb, rseg);
+          }
+#endif /* LWIP_TCP_RACK */
         }
         tcp_seg_free(rseg);
 
@@ -1123,6 +1139,11 @@ tcp_free_acked_segments(struct tcp_pcb *pcb, struct tcp_seg *seg_list, const cha
 
     pcb->snd_queuelen = (u16_t)(pcb->snd_queuelen - clen);
     recv_acked = (tcpwnd_size_t)(recv_acked + next->len);
+#if LWIP_TCP_RACK
+    if (!(next->flags & TF_SEG_SACKED)) {
+      tcp_rack_delivered(pcb, next);
+    }
+#endif /* LWIP_TCP_RACK */
     tcp_seg_free(next);
 
     LWIP_DEBUGF(TCP_QLEN_DEBUG, ("%"TCPWNDSIZE_F" (after freeing %s)\n",
@@ -1154,6 +1175,10 @@ tcp_receive(struct tcp_pcb *pcb)
   s16_t m;
   u32_t right_wnd_edge;
   int found_dupack = 0;
+#if LWIP_TCP_SACK_IN
+  u32_t lastack = pcb->lastack;
+  u32_t sack_high = pcb->sack_high;
+#endif /* LWIP_TCP_SACK_IN */
 
   LWIP_ASSERT("tcp_receive: invalid pcb", pcb != NULL);
   LWIP_ASSERT("tcp_receive: wrong state", pcb->state >= ESTABLISHED);
@@ -1185,6 +1210,12 @@ tcp_receive(struct tcp_pcb *pcb)
 #endif /* TCP_WND_DEBUG */
     }
 
+#if LWIP_TCP_SACK_IN
+    if (tcp_sack_active(pcb)) {
+      tcp_sack_input(pcb, ackno, tcp_sack_blocks, tcp_sack_num);
+    }
+#endif /* LWIP_TCP_SACK_IN */
+
     /* (From Stevens TCP/IP Illustrated Vol II, p970.) Its only a
      * duplicate ack if:
      * 1) It doesn't ACK new data
@@ -1219,13 +1250,16 @@ tcp_receive(struct tcp_pcb *pcb)
               if ((u8_t)(pcb->dupacks + 1) > pcb->dupacks) {
                 ++pcb->dupacks;
               }
-              if (pcb->dupacks > 3) {
-                /* Inflate the congestion window */
-                TCP_WND_INC(pcb->cwnd, pcb->mss);
-              }
-              if (pcb->dupacks >= 3) {
-                /* Do fast retransmit (checked via TF_INFR, not via dupacks count) */
-                tcp_rexmit_fast(pcb);
+              /* With SACK, tcp_sack_ack() counts what is in flight instead */
+              if (!tcp_sack_active(pcb)) {
+                if (pcb->dupacks > 3) {
+                  /* Inflate the congestion window */
+                  TCP_WND_INC(pcb->cwnd, pcb->mss);
+                }
+                if (pcb->dupacks >= 3) {
+                  /* Do fast retransmit (checked via TF_INFR, not via dupacks count) */
+                  tcp_rexmit_fast(pcb);
+                }
               }
             }
           }
@@ -1242,8 +1276,9 @@ tcp_receive(struct tcp_pcb *pcb)
 
       /* Reset the "IN Fast Retransmit" flag, since we are no longer
          in fast retransmit. Also reset the congestion window to the
-         slow start threshold. */
-      if (pcb->flags & TF_INFR) {
+         slow start threshold. A SACK connection stays in fast recovery
+         until all the data sent before it is acknowledged. */
+      if ((pcb->flags & TF_INFR) && !tcp_sack_partial_ack(pcb, ackno)) {
         tcp_clear_flags(pcb, TF_INFR);
         pcb->cwnd = pcb->ssthresh;
         pcb->bytes_acked = 0;
@@ -1261,27 +1296,12 @@ tcp_receive(struct tcp_pcb *pcb)
       /* Reset the fast retransmit variables. */
       pcb->dupacks = 0;
       pcb->lastack = ackno;
+      tcp_cc_acked(pcb, acked);
 
       /* Update the congestion control variables (cwnd and
          ssthresh). */
-      if (pcb->state >= ESTABLISHED) {
-        if (pcb->cwnd < pcb->ssthresh) {
-          tcpwnd_size_t increase;
-          /* limit to 1 SMSS segment during period following RTO */
-          u8_t num_seg = (pcb->flags & TF_RTO) ? 1 : 2;
-          /* RFC 3465, section 2.2 Slow Start */
-          increase = LWIP_MIN(acked, (tcpwnd_size_t)(num_seg * pcb->mss));
-          TCP_WND_INC(pcb->cwnd, increase);
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
-        } else {
-          /* RFC 3465, section 2.1 Congestion Avoidance */
-          TCP_WND_INC(pcb->bytes_acked, acked);
-          if (pcb->bytes_acked >= pcb->cwnd) {
-            pcb->bytes_acked = (tcpwnd_size_t)(pcb->bytes_acked - pcb->cwnd);
-            TCP_WND_INC(pcb->cwnd, pcb->mss);
-          }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
-        }
+      if ((pcb->state >= ESTABLISHED) && !(pcb->flags & TF_INFR)) {
+        tcp_cc_cong_avoid(pcb, acked);
       }
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_receive: ACK for %"U32_F", unacked->seqno %"U32_F":%"U32_F"\n",
                                     ackno,
@@ -1375,6 +1395,13 @@ tcp_receive(struct tcp_pcb *pcb)
 
       pcb->rttest = 0;
     }
+
+#if LWIP_TCP_SACK_IN
+    if (tcp_sack_active(pcb)) {
+      /* detect losses and queue their retransmission */
+      tcp_sack_ack(pcb, (u8_t)(pcb->lastack != lastack || pcb->sack_high != sack_high));
+    }
+#endif /* LWIP_TCP_SACK_IN */
   }
 
   /* If the incoming segment contains data, we must process it
@@ -1436,6 +1463,13 @@ tcp_receive(struct tcp_pcb *pcb)
       struct pbuf *p = inseg.p;
       u32_t off32 = pcb->rcv_nxt - seqno;
       u16_t new_tot_len, off;
+#if LWIP_TCP_SACK_OUT
+      if (pcb->flags & TF_SACK) {
+        /* the part received before is reported as a D-SACK */
+        pcb->rcv_dsack.left = seqno;
+        pcb->rcv_dsack.right = pcb->rcv_nxt;
+      }
+#endif /* LWIP_TCP_SACK_OUT */
       LWIP_ASSERT("inseg.p != NULL", inseg.p);
       LWIP_ASSERT("insane offset!", (off32 < 0xffff));
       off = (u16_t)off32;
@@ -1458,6 +1492,13 @@ tcp_receive(struct tcp_pcb *pcb)
         /* must be a duplicate of a packet that has already been correctly handled */
 
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_receive: duplicate seqno %"U32_F"\n", seqno));
+#if LWIP_TCP_SACK_OUT
+        if (pcb->flags & TF_SACK) {
+          /* tell the sender its retransmission was spurious (D-SACK, RFC 2883) */
+          pcb->rcv_dsack.left = seqno;
+          pcb->rcv_dsack.right = seqno + tcplen;
+        }
+#endif /* LWIP_TCP_SACK_OUT */
         tcp_ack_now(pcb);
       }
     }
@@ -1930,6 +1971,10 @@ tcp_parseopt(struct tcp_pcb *pcb)
 
   LWIP_ASSERT("tcp_parseopt: invalid pcb", pcb != NULL);
 
+#if LWIP_TCP_SACK_IN
+  tcp_sack_num = 0;
+#endif /* LWIP_TCP_SACK_IN */
+
   /* Parse the TCP MSS option, if present. */
   if (tcphdr_optlen != 0) {
     for (tcp_optidx = 0; tcp_optidx < tcphdr_optlen; ) {
@@ -2022,6 +2067,33 @@ tcp_parseopt(struct tcp_pcb *pcb)
           }
           break;
 #endif /* LWIP_TCP_SACK_OUT */
+#if LWIP_TCP_SACK_IN
+        case LWIP_TCP_OPT_SACK:
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK\n"));
+          data = tcp_get_next_optbyte();
+          if ((data < 10) || (((data - 2) & 7) != 0) || (tcp_optidx - 2 + data) > tcphdr_optlen) {
+            /* Bad length */
+            LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+            return;
+          }
+          /* TCP SACK option with valid length: (left, right) pairs */
+          for (data = (u8_t)((data - 2) / 8); data > 0; data--) {
+            u32_t edge[2];
+            int i, j;
+            for (i = 0; i < 2; i++) {
+              edge[i] = 0;
+              for (j = 0; j < 4; j++) {
+                edge[i] = (edge[i] << 8) | tcp_get_next_optbyte();
+              }
+            }
+            if (tcp_sack_num < LWIP_TCP_SACK_IN_BLOCKS) {
+              tcp_sack_blocks[tcp_sack_num].left = edge[0];
+              tcp_sack_blocks[tcp_sack_num].right = edge[1];
+              tcp_sack_num++;
+            }
+          }
+          break;
+#endif /* LWIP_TCP_SACK_IN */
         default:
           LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: other\n"));
           data = tcp_get_next_optbyte();
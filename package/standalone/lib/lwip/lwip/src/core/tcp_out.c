@@ -74,7 +74,7 @@
 #include "lwip/stats.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
-#if LWIP_TCP_TIMESTAMPS
+#if LWIP_TCP_TIMESTAMPS || LWIP_TCP_RACK
 #include "lwip/sys.h"
 #endif
 
@@ -1173,6 +1173,12 @@ tcp_get_num_sacks(const struct tcp_pcb *pcb, u8_t optlen)
        each additional one - 8 bytes. */
     optlen += 12;
 
+    /* a D-SACK goes first (RFC 2883) */
+    if (LWIP_TCP_DSACK_VALID(pcb) && (optlen <= TCP_MAX_OPTION_BYTES)) {
+      ++num_sacks;
+      optlen += 8;
+    }
+
     /* Max options size = 40, number of SACK array entries = LWIP_TCP_MAX_SACK_NUM */
     for (i = 0; (i < LWIP_TCP_MAX_SACK_NUM) && (optlen <= TCP_MAX_OPTION_BYTES) &&
          LWIP_TCP_SACK_VALID(pcb, i); ++i) {
@@ -1203,6 +1209,11 @@ tcp_build_sack_option(const struct tcp_pcb *pcb, u32_t *opts, u8_t num_sacks)
      which is 2B of header, plus 8B for each SACK. */
   *(opts++) = PP_HTONL(0x01010500 + 2 + num_sacks * 8);
 
+  if (LWIP_TCP_DSACK_VALID(pcb)) {
+    *(opts++) = lwip_htonl(pcb->rcv_dsack.left);
+    *(opts++) = lwip_htonl(pcb->rcv_dsack.right);
+    num_sacks--;
+  }
   for (i = 0; i < num_sacks; ++i) {
     *(opts++) = lwip_htonl(pcb->rcv_sacks[i].left);
     *(opts++) = lwip_htonl(pcb->rcv_sacks[i].right);
@@ -1226,6 +1237,50 @@ tcp_build_wnd_scale_option(u32_t *opts)
 }
 #endif
 
+/**
+ * Check if a segment of the unsent queue may be sent now.
+ *
+ * Without SACK, everything above lastack is held to the smaller of the
+ * send and congestion windows. With SACK (RFC 6675), the congestion window
+ * only bounds what is in flight ('pipe'), not what the peer SACKed or what
+ * was lost, while the send window still bounds the sequence space.
+ *
+ * @param pcb the tcp_pcb
+ * @param seg the segment
+ * @param wnd the smaller of pcb->snd_wnd and pcb->cwnd
+ * @param pipe the data in flight (SACK connections only)
+ */
+static int
+tcp_output_fits(const struct tcp_pcb *pcb, const struct tcp_seg *seg, u32_t wnd, u32_t pipe)
+{
+  u32_t end = lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len;
+
+#if LWIP_TCP_SACK_IN
+  if (tcp_sack_active(pcb)) {
+    if (end > pcb->snd_wnd) {
+      return 0;
+    }
+    if (seg->flags & TF_SEG_SACKED) {
+      /* not sent again */
+      return 1;
+    }
+    if ((pcb->flags & TF_SACK_REXMIT) && (seg->flags & TF_SEG_LOST)) {
+      /* the first retransmission of the fast recovery (RFC 6675 step 4.3) */
+      return 1;
+    }
+#if LWIP_TCP_RACK
+    if (pcb->rack.flags & TCP_RACK_TLP_SEND) {
+      /* the tail loss probe */
+      return 1;
+    }
+#endif /* LWIP_TCP_RACK */
+    return pipe + seg->len <= pcb->cwnd;
+  }
+#endif /* LWIP_TCP_SACK_IN */
+  LWIP_UNUSED_ARG(pipe);
+  return end <= wnd;
+}
+
 /**
  * @ingroup tcp_raw
  * Find out what we can send and send it
@@ -1238,7 +1293,10 @@ err_t
 tcp_output(struct tcp_pcb *pcb)
 {
   struct tcp_seg *seg, *useg;
-  u32_t wnd, snd_nxt;
+  u32_t wnd, snd_nxt, pipe = 0;
+#if LWIP_TCP_SACK_IN
+  u32_t seg_pipe = 0;
+#endif /* LWIP_TCP_SACK_IN */
   err_t err;
   struct netif *netif;
 #if TCP_CWND_DEBUG
@@ -1302,8 +1360,14 @@ tcp_output(struct tcp_pcb *pcb)
     ip_addr_copy(pcb->local_ip, *local_ip);
   }
 
+#if LWIP_TCP_SACK_IN
+  if (tcp_sack_active(pcb)) {
+    pipe = tcp_sack_pipe(pcb);
+  }
+#endif /* LWIP_TCP_SACK_IN */
+
   /* Handle the current segment not fitting within the window */
-  if (lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len > wnd) {
+  if (!tcp_output_fits(pcb, seg, wnd, pipe)) {
     /* We need to start the persistent timer when the next unsent segment does not fit
      * within the remaining (could be 0) send window and RTO timer is not running (we
      * have no in-flight data). If window is still too small after persist timer fires,
@@ -1330,8 +1394,7 @@ tcp_output(struct tcp_pcb *pcb)
     for (; useg->next != NULL; useg = useg->next);
   }
   /* data available and window allows it to be sent? */
-  while (seg != NULL &&
-         lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len <= wnd) {
+  while (seg != NULL && tcp_output_fits(pcb, seg, wnd, pipe)) {
     LWIP_ASSERT("RST not expected here!",
                 (TCPH_FLAGS(seg->tcphdr) & TCP_RST) == 0);
     /* Stop sending if the nagle algorithm would prevent it
@@ -1358,23 +1421,50 @@ tcp_output(struct tcp_pcb *pcb)
       TCPH_SET_FLAG(seg->tcphdr, TCP_ACK);
     }
 
-    err = tcp_output_segment(seg, pcb, netif);
-    if (err != ERR_OK) {
-      /* segment could not be sent, for whatever reason */
-      tcp_set_flags(pcb, TF_NAGLEMEMERR);
-      return err;
-    }
+#if LWIP_TCP_SACK_IN
+    if (seg->flags & TF_SEG_SACKED) {
+      /* the peer has it: back on the unacked queue without sending it */
+      pcb->unsent = seg->next;
+    } else
+#endif /* LWIP_TCP_SACK_IN */
+    {
+#if LWIP_TCP_SACK_IN
+      seg_pipe = tcp_sack_active(pcb) ? tcp_sack_seg_pipe(pcb, seg) : 0;
+#endif /* LWIP_TCP_SACK_IN */
+
+      err = tcp_output_segment(seg, pcb, netif);
+      if (err != ERR_OK) {
+        /* segment could not be sent, for whatever reason */
+        tcp_set_flags(pcb, TF_NAGLEMEMERR);
+        return err;
+      }
 #if TCP_OVERSIZE_DBGCHECK
-    seg->oversize_left = 0;
+      seg->oversize_left = 0;
 #endif /* TCP_OVERSIZE_DBGCHECK */
-    pcb->unsent = seg->next;
-    if (pcb->state != SYN_SENT) {
-      tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+      pcb->unsent = seg->next;
+      if (pcb->state != SYN_SENT) {
+        tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+#if LWIP_TCP_SACK_OUT
+        /* the ACK went without options, the D-SACK is not reported */
+        pcb->rcv_dsack.left = pcb->rcv_dsack.right = 0;
+#endif /* LWIP_TCP_SACK_OUT */
+      }
+#if LWIP_TCP_SACK_IN
+      tcp_clear_flags(pcb, TF_SACK_REXMIT);
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_RACK
+      pcb->rack.flags &= (u16_t)~TCP_RACK_TLP_SEND;
+#endif /* LWIP_TCP_RACK */
     }
     snd_nxt = lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
     if (TCP_SEQ_LT(pcb->snd_nxt, snd_nxt)) {
       pcb->snd_nxt = snd_nxt;
     }
+#if LWIP_TCP_SACK_IN
+    if (tcp_sack_active(pcb)) {
+      pipe = pipe - seg_pipe + tcp_sack_seg_pipe(pcb, seg);
+    }
+#endif /* LWIP_TCP_SACK_IN */
     /* put segment on unacknowledged list if length > 0 */
     if (TCP_TCPLEN(seg) > 0) {
       seg->next = NULL;
@@ -1414,6 +1504,9 @@ tcp_output(struct tcp_pcb *pcb)
     pcb->unsent_oversize = 0;
   }
 #endif /* TCP_OVERSIZE */
+#if LWIP_TCP_RACK
+  tcp_rack_sent(pcb);
+#endif /* LWIP_TCP_RACK */
 
 output_done:
   tcp_clear_flags(pcb, TF_NAGLEMEMERR);
@@ -1473,6 +1566,18 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
     return ERR_OK;
   }
 
+#if LWIP_TCP_SACK_IN
+  /* after an RTO, snd_nxt is back at lastack and only the lost mark tells
+     that the segment was sent before */
+  if (tcp_sack_active(pcb) &&
+      ((seg->flags & TF_SEG_LOST) || TCP_SEQ_LT(lwip_ntohl(seg->tcphdr->seqno), pcb->snd_nxt))) {
+    seg->flags |= TF_SEG_RETRANS;
+  }
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_RACK
+  seg->xmit_time = sys_now();
+#endif /* LWIP_TCP_RACK */
+
   /* The TCP header has already been constructed, but the ackno and
    wnd fields remain. */
   seg->tcphdr->ackno = lwip_htonl(pcb->rcv_nxt);
@@ -1653,6 +1758,12 @@ tcp_rexmit_rto_prepare(struct tcp_pcb *pcb)
     LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rexmit_rto: segment busy\n"));
     return ERR_VAL;
   }
+#if LWIP_TCP_SACK_IN
+  if (tcp_sack_active(pcb)) {
+    /* all but the SACKed segments are lost */
+    tcp_sack_rto(pcb);
+  }
+#endif /* LWIP_TCP_SACK_IN */
   /* concatenate unsent queue after unacked queue */
   seg->next = pcb->unsent;
 #if TCP_OVERSIZE_DBGCHECK
@@ -1775,6 +1886,56 @@ tcp_rexmit(struct tcp_pcb *pcb)
 }
 
 
+/**
+ * Requeue a segment of the unacked queue for retransmission
+ *
+ * Called by the SACK loss recovery, for the segments deemed lost and for
+ * the tail loss probe.
+ *
+ * @param pcb the tcp_pcb
+ * @param seg the segment, on pcb->unacked
+ * @return ERR_VAL if the segment is still referenced by the netif driver
+ */
+err_t
+tcp_rexmit_seg(struct tcp_pcb *pcb, struct tcp_seg *seg)
+{
+  struct tcp_seg **cur_seg;
+
+  LWIP_ASSERT("tcp_rexmit_seg: invalid pcb", pcb != NULL);
+  LWIP_ASSERT("tcp_rexmit_seg: invalid seg", seg != NULL);
+
+  if (tcp_output_segment_busy(seg)) {
+    LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rexmit_seg busy\n"));
+    return ERR_VAL;
+  }
+
+  for (cur_seg = &pcb->unacked; *cur_seg != seg; cur_seg = &((*cur_seg)->next)) {
+    LWIP_ASSERT("tcp_rexmit_seg: seg not on unacked", *cur_seg != NULL);
+  }
+  *cur_seg = seg->next;
+
+  /* Keep the unsent queue sorted. */
+  cur_seg = &(pcb->unsent);
+  while (*cur_seg &&
+         TCP_SEQ_LT(lwip_ntohl((*cur_seg)->tcphdr->seqno), lwip_ntohl(seg->tcphdr->seqno))) {
+    cur_seg = &((*cur_seg)->next);
+  }
+  seg->next = *cur_seg;
+  *cur_seg = seg;
+#if TCP_OVERSIZE
+  if (seg->next == NULL) {
+    /* the retransmitted segment is last in unsent, so reset unsent_oversize */
+    pcb->unsent_oversize = 0;
+  }
+#endif /* TCP_OVERSIZE */
+
+  /* Don't take any rtt measurements after retransmitting. */
+  pcb->rttest = 0;
+
+  MIB2_STATS_INC(mib2.tcpretranssegs);
+  return ERR_OK;
+}
+
 /**
  * Handle retransmission after three dupacks received
  *
@@ -1793,18 +1954,9 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
                  (u16_t)pcb->dupacks, pcb->lastack,
                  lwip_ntohl(pcb->unacked->tcphdr->seqno)));
     if (tcp_rexmit(pcb) == ERR_OK) {
-      /* Set ssthresh to half of the minimum of the current
-       * cwnd and the advertised window */
-      pcb->ssthresh = LWIP_MIN(pcb->cwnd, pcb->snd_wnd) / 2;
-
-      /* The minimum value for ssthresh should be 2 MSS */
-      if (pcb->ssthresh < (2U * pcb->mss)) {
-        LWIP_DEBUGF(TCP_FR_DEBUG,
-                    ("tcp_receive: The minimum value for ssthresh %"TCPWNDSIZE_F
-                     " should be min 2 mss %"U16_F"...\n",
-                     pcb->ssthresh, (u16_t)(2 * pcb->mss)));
-        pcb->ssthresh = 2 * pcb->mss;
-      }
+      /* Reduce ssthresh, by half of the minimum of the current
+       * cwnd and the advertised window for NewReno */
+      pcb->ssthresh = tcp_cc_ssthresh(pcb);
 
       pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
       tcp_set_flags(pcb, TF_INFR);
@@ -2062,6 +2214,10 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   } else {
     /* remove ACK flags from the PCB, as we sent an empty ACK now */
     tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+#if LWIP_TCP_SACK_OUT
+    /* a D-SACK is reported once */
+    pcb->rcv_dsack.left = pcb->rcv_dsack.right = 0;
+#endif /* LWIP_TCP_SACK_OUT */
   }
 
   return err;
@@ -0,0 +1,614 @@
+/**
+ * @file
+ * Transmission Control Protocol, SACK loss recovery
+ *
+ * The sender side of SACK: a scoreboard of the segments the peer SACKed
+ * (RFC 6675), time-based loss detection and tail loss probes (RACK-TLP,
+ * RFC 8985). The marks of the scoreboard are kept in the flags of the
+ * segments on pcb->unacked and pcb->unsent:
+ *
+ * - TF_SEG_SACKED: the peer has the segment, it is not sent again
+ * - TF_SEG_LOST: the segment is deemed lost and is retransmitted
+ * - TF_SEG_RETRANS: the last copy sent was a retransmission
+ *
+ * so that the data in flight, RFC 6675 'pipe', is the length of the
+ * segments that are neither SACKed nor lost, plus the length of those
+ * retransmitted. tcp_output() holds pipe to cwnd.
+ *
+ * A first SACK block that reports data the peer received twice (D-SACK,
+ * RFC 2883) tells of a spurious retransmission: RACK widens its reordering
+ * window on it.
+ *
+ * Only connections whose peer offered SACK (TF_SACK) take these paths,
+ * the others keep the NewReno recovery of tcp_in.c.
+ */
+
+/*
+ * Copyright (c) 2024 Newracom, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP && LWIP_TCP_SACK_IN /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/sys.h"
+
+/** Segments, or segments' worth of bytes, SACKed above a hole that make it
+    lost (RFC 6675 DupThresh) */
+#define TCP_SACK_DUPTHRESH      3
+
+#if LWIP_TCP_RACK
+/** Probe timeout before the first round trip is measured (RFC 8985 7.2) */
+#define TCP_RACK_PTO_INIT       1000
+/** Added to the probe timeout when the peer may delay its ACK to a single
+    segment in flight */
+#define TCP_RACK_DELACK         (2 * TCP_TMR_INTERVAL)
+/** Recoveries without D-SACK before a widened reordering window shrinks back
+    (RFC 8985 6.2 step 4) */
+#define TCP_RACK_REO_PERSIST    16
+
+static void tcp_rack_dsack(struct tcp_pcb *pcb, const struct tcp_sack_range *block);
+static u8_t tcp_rack_detect_loss(struct tcp_pcb *pcb);
+static void tcp_tlp_arm(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_RACK */
+
+#define tcp_seg_seqno(seg) lwip_ntohl((seg)->tcphdr->seqno)
+
+/**
+ * The part of a segment in flight: nothing if SACKed, the first copy unless
+ * lost, and the retransmission. Segments of the unsent queue above snd_nxt
+ * were never sent.
+ */
+u32_t
+tcp_sack_seg_pipe(const struct tcp_pcb *pcb, const struct tcp_seg *seg)
+{
+  u32_t pipe = 0;
+
+  if ((seg->flags & TF_SEG_SACKED) || !TCP_SEQ_LT(tcp_seg_seqno(seg), pcb->snd_nxt)) {
+    return 0;
+  }
+  if (!(seg->flags & TF_SEG_LOST)) {
+    pipe += seg->len;
+  }
+  if (seg->flags & TF_SEG_RETRANS) {
+    pipe += seg->len;
+  }
+  return pipe;
+}
+
+/** The data in flight, RFC 6675 'pipe' */
+u32_t
+tcp_sack_pipe(const struct tcp_pcb *pcb)
+{
+  const struct tcp_seg *seg;
+  u32_t pipe = 0;
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    pipe += tcp_sack_seg_pipe(pcb, seg);
+  }
+  /* queued retransmissions */
+  for (seg = pcb->unsent; seg != NULL && TCP_SEQ_LT(tcp_seg_seqno(seg), pcb->snd_nxt); seg = seg->next) {
+    pipe += tcp_sack_seg_pipe(pcb, seg);
+  }
+  return pipe;
+}
+
+static void
+tcp_sack_mark(struct tcp_pcb *pcb, struct tcp_seg *seg, u32_t left, u32_t right)
+{
+  for (; seg != NULL && TCP_SEQ_LT(tcp_seg_seqno(seg), pcb->snd_nxt); seg = seg->next) {
+    u32_t start = tcp_seg_seqno(seg);
+    u32_t end = start + TCP_TCPLEN(seg);
+
+    if (TCP_SEQ_LEQ(right, start)) {
+      /* the queues are sorted */
+      break;
+    }
+    if (!(seg->flags & TF_SEG_SACKED) && TCP_SEQ_LEQ(left, start) && TCP_SEQ_LEQ(end, right)) {
+      seg->flags |= TF_SEG_SACKED;
+#if LWIP_TCP_RACK
+      tcp_rack_delivered(pcb, seg);
+#endif /* LWIP_TCP_RACK */
+      if (TCP_SEQ_GT(end, pcb->sack_high)) {
+        pcb->sack_high = end;
+      }
+    }
+  }
+}
+
+/**
+ * Called by tcp_receive() with the SACK blocks of an ACK, before the
+ * acknowledged segments are freed: marks the segments they cover.
+ *
+ * @param pcb the tcp_pcb
+ * @param ackno the ACK of the segment
+ * @param blocks the SACK blocks
+ * @param num number of blocks
+ */
+void
+tcp_sack_input(struct tcp_pcb *pcb, u32_t ackno, const struct tcp_sack_range *blocks, u8_t num)
+{
+  u8_t i;
+
+  /* A first block below the ACK or within the second one is a D-SACK
+     (RFC 2883 section 4): the data was received twice */
+  if ((num > 0) && TCP_SEQ_LT(blocks[0].left, blocks[0].right) &&
+      (TCP_SEQ_LEQ(blocks[0].right, ackno) ||
+       ((num > 1) && TCP_SEQ_GEQ(blocks[0].left, blocks[1].left) &&
+        TCP_SEQ_LEQ(blocks[0].right, blocks[1].right)))) {
+    LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_sack_input: D-SACK %"U32_F":%"U32_F"\n",
+                               blocks[0].left, blocks[0].right));
+#if LWIP_TCP_RACK
+    tcp_rack_dsack(pcb, &blocks[0]);
+#endif /* LWIP_TCP_RACK */
+    blocks++;
+    num--;
+  }
+
+  for (i = 0; i < num; i++) {
+    u32_t left = blocks[i].left;
+    u32_t right = blocks[i].right;
+
+    /* blocks outside what was sent are ignored */
+    if (!TCP_SEQ_LT(left, right) || !TCP_SEQ_GT(right, ackno) ||
+        !TCP_SEQ_GT(right, pcb->lastack) || TCP_SEQ_GT(right, pcb->snd_nxt)) {
+      continue;
+    }
+    tcp_sack_mark(pcb, pcb->unacked, left, right);
+    tcp_sack_mark(pcb, pcb->unsent, left, right);
+  }
+}
+
+/** Forget what the peer SACKed */
+static void
+tcp_sack_clear(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    seg->flags &= (u8_t)~TF_SEG_SACKED;
+  }
+  for (seg = pcb->unsent; seg != NULL; seg = seg->next) {
+    seg->flags &= (u8_t)~TF_SEG_SACKED;
+  }
+  pcb->sack_high = pcb->lastack;
+}
+
+/**
+ * Mark lost the segments with DupThresh segments, or more than
+ * (DupThresh - 1) * SMSS bytes, SACKed above them (RFC 6675 IsLost)
+ */
+static u8_t
+tcp_sack_mark_lost(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+  u32_t sacked = 0;
+  u16_t count = 0;
+  u8_t lost = 0;
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked += seg->len;
+      count++;
+    }
+  }
+  for (seg = pcb->unacked; seg != NULL && count > 0; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked -= seg->len;
+      count--;
+    } else if (!(seg->flags & TF_SEG_LOST)) {
+      if ((count < TCP_SACK_DUPTHRESH) && (sacked <= (u32_t)(TCP_SACK_DUPTHRESH - 1) * pcb->mss)) {
+        /* less is SACKed above the next segments */
+        break;
+      }
+      seg->flags |= TF_SEG_LOST;
+      lost = 1;
+    }
+  }
+  return lost;
+}
+
+/**
+ * Enter fast recovery on a loss, and queue the lost segments that were
+ * not retransmitted yet. tcp_output() sends them first, as pipe allows.
+ */
+static void
+tcp_sack_recover(struct tcp_pcb *pcb, u8_t lost)
+{
+  struct tcp_seg *seg, *next;
+
+  if (!(pcb->flags & (TF_INFR | TF_RTO))) {
+    if (!lost && pcb->dupacks >= TCP_SACK_DUPTHRESH && pcb->unacked != NULL &&
+        pcb->sack_high == pcb->lastack &&
+        !(pcb->unacked->flags & (TF_SEG_SACKED | TF_SEG_LOST))) {
+      /* DupThresh ACKs without SACK blocks to tell which segment is missing */
+      pcb->unacked->flags |= TF_SEG_LOST;
+      lost = 1;
+    }
+    if (!lost) {
+      return;
+    }
+    /* RFC 6675 section 5, with the reduction of tcp_rexmit_fast() */
+    pcb->ssthresh = tcp_cc_ssthresh(pcb);
+    pcb->cwnd = pcb->ssthresh;
+    pcb->sack_recover = pcb->snd_nxt;
+    tcp_set_flags(pcb, TF_INFR | TF_SACK_REXMIT);
+    LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_sack_recover: lastack %"U32_F", recover %"U32_F
+                               ", cwnd %"TCPWNDSIZE_F"\n", pcb->lastack, pcb->sack_recover, pcb->cwnd));
+#if LWIP_TCP_RACK
+    /* the recovery repairs the tail as well */
+    pcb->rack.flags &= (u16_t)~(TCP_RACK_TLP_OUT | TCP_RACK_PTO_TIMER);
+    /* a window widened on D-SACKs lasts TCP_RACK_REO_PERSIST recoveries */
+    if ((pcb->rack.reo_wnd_persist > 0) && (--pcb->rack.reo_wnd_persist == 0)) {
+      pcb->rack.reo_wnd_mult = 1;
+    }
+#endif /* LWIP_TCP_RACK */
+  }
+
+  for (seg = pcb->unacked; seg != NULL; seg = next) {
+    next = seg->next;
+    if ((seg->flags & TF_SEG_SACK_MARKS) == TF_SEG_LOST) {
+      /* a busy segment is tried again with the next ACK */
+      tcp_rexmit_seg(pcb, seg);
+    }
+  }
+}
+
+/**
+ * Called by tcp_receive() after an ACK was processed.
+ *
+ * @param pcb the tcp_pcb
+ * @param delivered the ACK acknowledged or SACKed new data
+ */
+void
+tcp_sack_ack(struct tcp_pcb *pcb, u8_t delivered)
+{
+  u8_t lost;
+
+  if ((pcb->unacked != NULL) && (pcb->unacked->flags & TF_SEG_SACKED)) {
+    /* The peer acknowledged up to data it SACKed before and no further:
+       it dropped that data (reneging, RFC 2018) */
+    LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_sack_ack: reneging at %"U32_F"\n", pcb->lastack));
+    tcp_sack_clear(pcb);
+  }
+  if (TCP_SEQ_LT(pcb->sack_high, pcb->lastack)) {
+    pcb->sack_high = pcb->lastack;
+  }
+
+#if LWIP_TCP_RACK
+  /* DupThresh counts reordering as loss: once the peer has seen some,
+     RACK's reordering window alone tells (RFC 8985 6.2) */
+  lost = (pcb->rack.flags & TCP_RACK_REORD) ? 0 : tcp_sack_mark_lost(pcb);
+  lost |= tcp_rack_detect_loss(pcb);
+#else
+  lost = tcp_sack_mark_lost(pcb);
+#endif /* LWIP_TCP_RACK */
+  tcp_sack_recover(pcb, lost);
+
+#if LWIP_TCP_RACK
+  if ((pcb->rack.flags & TCP_RACK_TLP_OUT) && TCP_SEQ_GEQ(pcb->lastack, pcb->rack.tlp_end)) {
+    /* RFC 8985 7.4: a retransmitted probe that is acknowledged repaired
+       a loss, unless it was D-SACKed */
+    if ((pcb->rack.flags & (TCP_RACK_TLP_REXMIT | TCP_RACK_TLP_DSACK)) == TCP_RACK_TLP_REXMIT) {
+      pcb->ssthresh = tcp_cc_ssthresh(pcb);
+      pcb->cwnd = pcb->ssthresh;
+    }
+    pcb->rack.flags &= (u16_t)~(TCP_RACK_TLP_OUT | TCP_RACK_TLP_REXMIT | TCP_RACK_TLP_DSACK);
+  }
+  if (delivered) {
+    tcp_tlp_arm(pcb);
+  }
+#else
+  LWIP_UNUSED_ARG(delivered);
+#endif /* LWIP_TCP_RACK */
+}
+
+/**
+ * Called by tcp_rexmit_rto_prepare(): everything in flight but the SACKed
+ * segments is lost. The SACK marks are kept, so that the retransmission
+ * skips what the peer has.
+ */
+void
+tcp_sack_rto(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (!(seg->flags & TF_SEG_SACKED)) {
+      seg->flags = (u8_t)((seg->flags & ~TF_SEG_RETRANS) | TF_SEG_LOST);
+    }
+  }
+  tcp_clear_flags(pcb, TF_INFR | TF_SACK_REXMIT);
+#if LWIP_TCP_RACK
+  pcb->rack.flags &= (u16_t)~(TCP_RACK_REO_TIMER | TCP_RACK_PTO_TIMER | TCP_RACK_TLP_OUT |
+                              TCP_RACK_TLP_REXMIT | TCP_RACK_TLP_DSACK | TCP_RACK_TLP_SEND);
+#endif /* LWIP_TCP_RACK */
+}
+
+#if LWIP_TCP_RACK
+
+/** The segment sent at t1 ending at seq1 was sent after the one at t2, seq2 */
+static int
+tcp_rack_sent_after(u32_t t1, u32_t seq1, u32_t t2, u32_t seq2)
+{
+  return ((s32_t)(t1 - t2) > 0) || ((t1 == t2) && TCP_SEQ_GT(seq1, seq2));
+}
+
+/**
+ * Called for each segment acknowledged or SACKed (RFC 8985 6.2 steps 1 to 3)
+ */
+void
+tcp_rack_delivered(struct tcp_pcb *pcb, const struct tcp_seg *seg)
+{
+  struct tcp_rack *rack = &pcb->rack;
+  u32_t end = tcp_seg_seqno(seg) + TCP_TCPLEN(seg);
+  u32_t rtt;
+
+  if (!tcp_sack_active(pcb)) {
+    return;
+  }
+  rtt = sys_now() - seg->xmit_time;
+
+  if (seg->flags & TF_SEG_RETRANS) {
+    /* too quick for the retransmission: the first copy arrived */
+    if ((rack->flags & TCP_RACK_RTT) && (rtt < rack->min_rtt)) {
+      return;
+    }
+  } else {
+    /* Karn's algorithm: only the segments sent once time the path */
+    if (rack->srtt == 0) {
+      rack->srtt = rtt;
+    } else {
+      rack->srtt = rack->srtt - (rack->srtt >> 3) + (rtt >> 3);
+    }
+    /* delivered below data SACKed before */
+    if (TCP_SEQ_LT(end, pcb->sack_high)) {
+      rack->flags |= TCP_RACK_REORD;
+    }
+  }
+
+  rack->rtt = rtt;
+  if (!(rack->flags & TCP_RACK_RTT) || (rtt < rack->min_rtt)) {
+    rack->min_rtt = rtt;
+  }
+  rack->flags |= TCP_RACK_RTT;
+
+  if (tcp_rack_sent_after(seg->xmit_time, end, rack->xmit_ts, rack->end_seq)) {
+    rack->xmit_ts = seg->xmit_time;
+    rack->end_seq = end;
+  }
+}
+
+/**
+ * A D-SACK: a retransmission was spurious, so the path reorders (RFC 8985
+ * 6.2 step 2). The reordering window grows by a quarter of min_rtt, at
+ * most once a round trip (step 4), and a retransmitted probe that is
+ * D-SACKed repaired no loss (7.4).
+ */
+static void
+tcp_rack_dsack(struct tcp_pcb *pcb, const struct tcp_sack_range *block)
+{
+  struct tcp_rack *rack = &pcb->rack;
+
+  rack->flags |= TCP_RACK_REORD;
+  if ((rack->flags & TCP_RACK_TLP_OUT) && (rack->flags & TCP_RACK_TLP_REXMIT) &&
+      (block->right == rack->tlp_end)) {
+    rack->flags |= TCP_RACK_TLP_DSACK;
+  }
+  if ((rack->flags & TCP_RACK_DSACK_ROUND) && TCP_SEQ_GEQ(pcb->lastack, rack->dsack_round)) {
+    rack->flags &= (u16_t)~TCP_RACK_DSACK_ROUND;
+  }
+  if (!(rack->flags & TCP_RACK_DSACK_ROUND)) {
+    if (rack->reo_wnd_mult < 0xff) {
+      rack->reo_wnd_mult++;
+    }
+    rack->reo_wnd_persist = TCP_RACK_REO_PERSIST;
+    rack->dsack_round = pcb->snd_nxt;
+    rack->flags |= TCP_RACK_DSACK_ROUND;
+  }
+}
+
+/** The reordering window (RFC 8985 6.2 step 4) */
+static u32_t
+tcp_rack_reo_wnd(const struct tcp_pcb *pcb)
+{
+  const struct tcp_seg *seg;
+  u32_t wnd;
+  u16_t sacked = 0;
+
+  if (!(pcb->rack.flags & TCP_RACK_REORD)) {
+    if (pcb->flags & (TF_INFR | TF_RTO)) {
+      return 0;
+    }
+    for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+      if ((seg->flags & TF_SEG_SACKED) && (++sacked >= TCP_SACK_DUPTHRESH)) {
+        return 0;
+      }
+    }
+  }
+  wnd = pcb->rack.reo_wnd_mult * (pcb->rack.min_rtt / 4);
+  return LWIP_MIN(wnd, pcb->rack.srtt);
+}
+
+/**
+ * Mark lost the segments sent a reordering window before the last one
+ * delivered, and arm the reordering timer for the others sent before it
+ * (RFC 8985 6.2 step 5)
+ */
+static u8_t
+tcp_rack_detect_loss(struct tcp_pcb *pcb)
+{
+  struct tcp_rack *rack = &pcb->rack;
+  struct tcp_seg *seg;
+  u32_t now, reo_wnd, timeout = 0;
+  u8_t lost = 0;
+
+  rack->flags &= (u16_t)~TCP_RACK_REO_TIMER;
+  if (!(rack->flags & TCP_RACK_RTT)) {
+    return 0;
+  }
+  now = sys_now();
+  reo_wnd = tcp_rack_reo_wnd(pcb);
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    s32_t remaining;
+
+    /* SACKed, or already waiting for its retransmission */
+    if ((seg->flags & TF_SEG_SACKED) || ((seg->flags & (TF_SEG_LOST | TF_SEG_RETRANS)) == TF_SEG_LOST)) {
+      continue;
+    }
+    if (!tcp_rack_sent_after(rack->xmit_ts, rack->end_seq,
+                             seg->xmit_time, tcp_seg_seqno(seg) + TCP_TCPLEN(seg))) {
+      continue;
+    }
+    remaining = (s32_t)(seg->xmit_time + rack->rtt + reo_wnd - now);
+    if (remaining <= 0) {
+      seg->flags = (u8_t)((seg->flags & ~TF_SEG_RETRANS) | TF_SEG_LOST);
+      lost = 1;
+    } else if ((u32_t)remaining > timeout) {
+      timeout = (u32_t)remaining;
+    }
+  }
+  if (timeout > 0) {
+    rack->reo_timeout = now + timeout;
+    rack->flags |= TCP_RACK_REO_TIMER;
+  }
+  return lost;
+}
+
+/**
+ * Arm the probe timeout (RFC 8985 7.2): two round trips, and the delayed
+ * ACK of the peer for a single segment in flight. Not armed in recovery,
+ * with a probe outstanding, or if the RTO comes first.
+ */
+static void
+tcp_tlp_arm(struct tcp_pcb *pcb)
+{
+  struct tcp_rack *rack = &pcb->rack;
+  u32_t pto, rto;
+
+  rack->flags &= (u16_t)~TCP_RACK_PTO_TIMER;
+  if ((pcb->unacked == NULL) || (pcb->flags & (TF_INFR | TF_RTO)) ||
+      (rack->flags & TCP_RACK_TLP_OUT) || (pcb->rtime < 0)) {
+    return;
+  }
+  if (rack->srtt != 0) {
+    pto = 2 * rack->srtt;
+    if (pcb->unacked->next == NULL) {
+      pto += TCP_RACK_DELACK;
+    }
+  } else {
+    pto = TCP_RACK_PTO_INIT;
+  }
+  rto = (u32_t)(pcb->rto - pcb->rtime) * TCP_SLOW_INTERVAL;
+  if ((pcb->rto <= pcb->rtime) || (pto >= rto)) {
+    return;
+  }
+  rack->pto_timeout = sys_now() + pto;
+  rack->flags |= TCP_RACK_PTO_TIMER;
+}
+
+/** Called by tcp_output() after sending: arm the probe timeout */
+void
+tcp_rack_sent(struct tcp_pcb *pcb)
+{
+  if (tcp_sack_active(pcb) && !(pcb->rack.flags & TCP_RACK_PTO_TIMER)) {
+    tcp_tlp_arm(pcb);
+  }
+}
+
+/**
+ * Send the tail loss probe (RFC 8985 7.3): new data if the peer's window
+ * takes it, else the last segment sent again
+ */
+static void
+tcp_tlp_send(struct tcp_pcb *pcb)
+{
+  struct tcp_rack *rack = &pcb->rack;
+  struct tcp_seg *seg = pcb->unsent;
+  struct tcp_seg *last;
+
+  if ((seg != NULL) && !TCP_SEQ_LT(tcp_seg_seqno(seg), pcb->snd_nxt) &&
+      (tcp_seg_seqno(seg) - pcb->lastack + seg->len <= pcb->snd_wnd)) {
+    rack->flags &= (u16_t)~TCP_RACK_TLP_REXMIT;
+  } else {
+    for (last = pcb->unacked; last->next != NULL; last = last->next);
+    if ((last->flags & TF_SEG_SACKED) || (tcp_rexmit_seg(pcb, last) != ERR_OK)) {
+      return;
+    }
+    rack->flags |= TCP_RACK_TLP_REXMIT;
+  }
+  rack->flags &= (u16_t)~TCP_RACK_TLP_DSACK;
+  LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_tlp_send: %s probe at %"U32_F"\n",
+                             (rack->flags & TCP_RACK_TLP_REXMIT) ? "retransmitted" : "new",
+                             tcp_seg_seqno(pcb->unsent)));
+
+  rack->flags |= TCP_RACK_TLP_SEND;
+  tcp_output(pcb);
+  rack->flags &= (u16_t)~TCP_RACK_TLP_SEND;
+
+  rack->tlp_end = pcb->snd_nxt;
+  rack->flags |= TCP_RACK_TLP_OUT;
+  /* restart the RTO after the probe */
+  pcb->rtime = 0;
+}
+
+/**
+ * Called by tcp_fasttmr(): the reordering timer and the probe timeout
+ */
+void
+tcp_rack_tmr(struct tcp_pcb *pcb)
+{
+  struct tcp_rack *rack = &pcb->rack;
+  u32_t now;
+
+  if (!tcp_sack_active(pcb) || (pcb->unacked == NULL)) {
+    rack->flags &= (u16_t)~(TCP_RACK_REO_TIMER | TCP_RACK_PTO_TIMER);
+    return;
+  }
+  now = sys_now();
+
+  if ((rack->flags & TCP_RACK_REO_TIMER) && ((s32_t)(now - rack->reo_timeout) >= 0)) {
+    if (tcp_rack_detect_loss(pcb)) {
+      tcp_sack_recover(pcb, 1);
+      tcp_output(pcb);
+    }
+  }
+  if ((rack->flags & TCP_RACK_PTO_TIMER) && ((s32_t)(now - rack->pto_timeout) >= 0)) {
+    rack->flags &= (u16_t)~TCP_RACK_PTO_TIMER;
+    if (!(pcb->flags & (TF_INFR | TF_RTO))) {
+      tcp_tlp_send(pcb);
+    }
+  }
+}
+
+#endif /* LWIP_TCP_RACK */
+
+#endif /* LWIP_TCP && LWIP_TCP_SACK_IN */
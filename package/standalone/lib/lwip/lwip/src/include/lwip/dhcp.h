@@ -141,6 +141,23 @@ err_t dhcp_event_enable (struct netif *netif, dhcp_event_handler_t handler);
 void dhcp_event_disable (struct netif *netif);
 #endif
 
+#if LWIP_RESUME
+/** A bound lease, as kept across deep sleep. Times are seconds left,
+ * 0xffffffff for an infinite lease. */
+struct dhcp_lease {
+  ip4_addr_t ip_addr;
+  ip4_addr_t netmask;
+  ip4_addr_t gw;
+  ip4_addr_t server;
+  u32_t t0_lease;
+  u32_t t1_renew;
+  u32_t t2_rebind;
+};
+
+err_t dhcp_get_lease(struct netif *netif, struct dhcp_lease *lease);
+err_t dhcp_restore_lease(struct netif *netif, const struct dhcp_lease *lease, u32_t elapsed);
+#endif /* LWIP_RESUME */
+
 #define netif_dhcp_data(netif) ((struct dhcp*)netif_get_client_data(netif, LWIP_NETIF_CLIENT_DATA_INDEX_DHCP))
 
 #ifdef __cplusplus
@@ -122,6 +122,14 @@ err_t          dns_local_addhost(const char *hostname, const ip_addr_t *addr);
 #endif /* DNS_LOCAL_HOSTLIST_IS_DYNAMIC */
 #endif /* DNS_LOCAL_HOSTLIST */
 
+#if LWIP_RESUME
+/** Version of the dns_cache_save() format */
+#define DNS_CACHE_VERSION 1
+
+int            dns_cache_save(u8_t *buf, u16_t len);
+int            dns_cache_restore(const u8_t *buf, u16_t len, u32_t elapsed);
+#endif /* LWIP_RESUME */
+
 #ifdef __cplusplus
 }
 #endif
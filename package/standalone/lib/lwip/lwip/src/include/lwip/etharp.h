@@ -92,6 +92,9 @@ void etharp_cleanup_netif(struct netif *netif);
 err_t etharp_add_static_entry(const ip4_addr_t *ipaddr, struct eth_addr *ethaddr);
 err_t etharp_remove_static_entry(const ip4_addr_t *ipaddr);
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+#if LWIP_RESUME
+err_t etharp_restore_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct eth_addr *ethaddr);
+#endif /* LWIP_RESUME */
 
 void etharp_input(struct pbuf *p, struct netif *netif);
 
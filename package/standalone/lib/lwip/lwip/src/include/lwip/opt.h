@@ -1123,6 +1123,22 @@
 #define DNS_DOES_NAME_CHECK             1
 #endif
 
+/** DNS_NEG_TTL: seconds a name the server reported as non-existent
+ * (NXDOMAIN) stays in the table, so that lookups of it fail at once instead
+ * of asking again. 0 disables negative caching.
+ */
+#if !defined DNS_NEG_TTL || defined __DOXYGEN__
+#define DNS_NEG_TTL                     0
+#endif
+
+/** DNS_PREFETCH_TTL: a cached name that is looked up with this many seconds
+ * or less left to live is asked for again in the background, while the
+ * cached address still answers. 0 disables prefetching.
+ */
+#if !defined DNS_PREFETCH_TTL || defined __DOXYGEN__
+#define DNS_PREFETCH_TTL                0
+#endif
+
 /** LWIP_DNS_SECURE: controls the security level of the DNS implementation
  * Use all DNS security features by default.
  * This is overridable but should only be needed by very small targets
@@ -1282,6 +1298,48 @@
 #define LWIP_TCP_MAX_SACK_NUM           4
 #endif
 
+/**
+ * LWIP_TCP_SACK_IN==1: TCP uses the SACKs it receives (RFC 6675): segments
+ * the peer has are not retransmitted, holes are retransmitted as soon as
+ * enough data above them is SACKed, and the congestion window bounds the
+ * data in flight rather than everything above the last ACK.
+ * The peer is offered SACK with LWIP_TCP_SACK_OUT.
+ */
+#if !defined LWIP_TCP_SACK_IN || defined __DOXYGEN__
+#define LWIP_TCP_SACK_IN                0
+#endif
+
+/**
+ * LWIP_TCP_RACK==1: Time-based loss detection of SACK connections (RACK-TLP,
+ * RFC 8985): a segment is lost once a segment sent after it has been
+ * delivered and a reordering window has passed, and a probe is sent after
+ * two round trips without ACK so that a lost tail is repaired without
+ * waiting for the RTO. The timers run at TCP_TMR_INTERVAL.
+ * Needs LWIP_TCP_SACK_IN.
+ */
+#if !defined LWIP_TCP_RACK || defined __DOXYGEN__
+#define LWIP_TCP_RACK                   0
+#endif
+
+/**
+ * LWIP_TCP_CC==1: Congestion control selectable per pcb, with tcp_set_cc()
+ * or the TCP_CONGESTION socket option: NewReno (RFC 5681, the only one
+ * without this option) or Westwood+, which after a loss sets ssthresh from
+ * the bandwidth estimated from the ACK rate rather than halving the window,
+ * so that random (radio) losses cost less than congestion.
+ */
+#if !defined LWIP_TCP_CC || defined __DOXYGEN__
+#define LWIP_TCP_CC                     0
+#endif
+
+/**
+ * TCP_CC_DEFAULT: Congestion control of new pcbs (TCP_CC_NEWRENO or
+ * TCP_CC_WESTWOOD). Needs LWIP_TCP_CC.
+ */
+#if !defined TCP_CC_DEFAULT || defined __DOXYGEN__
+#define TCP_CC_DEFAULT                  TCP_CC_NEWRENO
+#endif
+
 /**
  * TCP_MSS: TCP Maximum segment size. (default is 536, a conservative default,
  * you might want to increase this.)
@@ -270,6 +270,15 @@ struct tcp_seg {
                                                checksummed into 'chksum' */
 #define TF_SEG_OPTS_WND_SCALE   (u8_t)0x08U /* Include WND SCALE option (only used in SYN segments) */
 #define TF_SEG_OPTS_SACK_PERM   (u8_t)0x10U /* Include SACK Permitted option (only used in SYN segments) */
+#if LWIP_TCP_SACK_IN
+#define TF_SEG_SACKED           (u8_t)0x20U /* Selectively acknowledged by the peer */
+#define TF_SEG_LOST             (u8_t)0x40U /* Deemed lost, to be retransmitted */
+#define TF_SEG_RETRANS          (u8_t)0x80U /* Last sent as a retransmission */
+#define TF_SEG_SACK_MARKS       (u8_t)(TF_SEG_SACKED | TF_SEG_LOST | TF_SEG_RETRANS)
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_RACK
+  u32_t xmit_time;         /* sys_now() when last sent */
+#endif /* LWIP_TCP_RACK */
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
@@ -278,6 +287,7 @@ struct tcp_seg {
 #define LWIP_TCP_OPT_MSS        2
 #define LWIP_TCP_OPT_WS         3
 #define LWIP_TCP_OPT_SACK_PERM  4
+#define LWIP_TCP_OPT_SACK       5
 #define LWIP_TCP_OPT_TS         8
 
 #define LWIP_TCP_OPT_LEN_MSS    4
@@ -462,7 +472,7 @@ struct tcp_seg *tcp_seg_copy(struct tcp_seg *seg);
 err_t tcp_send_fin(struct tcp_pcb *pcb);
 err_t tcp_enqueue_flags(struct tcp_pcb *pcb, u8_t flags);
 
-void tcp_rexmit_seg(struct tcp_pcb *pcb, struct tcp_seg *seg);
+err_t tcp_rexmit_seg(struct tcp_pcb *pcb, struct tcp_seg *seg);
 
 void tcp_rst(const struct tcp_pcb* pcb, u32_t seqno, u32_t ackno,
        const ip_addr_t *local_ip, const ip_addr_t *remote_ip,
@@ -473,6 +483,72 @@ u32_t tcp_next_iss(struct tcp_pcb *pcb);
 err_t tcp_keepalive(struct tcp_pcb *pcb);
 err_t tcp_split_unsent_seg(struct tcp_pcb *pcb, u16_t split);
 err_t tcp_zero_window_probe(struct tcp_pcb *pcb);
+
+#if LWIP_TCP_SACK_IN
+/** The peer SACKs: loss recovery goes by the scoreboard (tcp_sack.c) */
+#define tcp_sack_active(pcb) (((pcb)->flags & TF_SACK) != 0)
+/** An ACK below the RecoveryPoint does not end the fast recovery */
+#define tcp_sack_partial_ack(pcb, ack) (tcp_sack_active(pcb) && TCP_SEQ_LT(ack, (pcb)->sack_recover))
+
+/** Max. SACK blocks in a segment (40 bytes of options) */
+#define LWIP_TCP_SACK_IN_BLOCKS 4
+
+void  tcp_sack_input(struct tcp_pcb *pcb, u32_t ackno, const struct tcp_sack_range *blocks, u8_t num);
+void  tcp_sack_ack(struct tcp_pcb *pcb, u8_t delivered);
+void  tcp_sack_rto(struct tcp_pcb *pcb);
+u32_t tcp_sack_pipe(const struct tcp_pcb *pcb);
+u32_t tcp_sack_seg_pipe(const struct tcp_pcb *pcb, const struct tcp_seg *seg);
+#else /* LWIP_TCP_SACK_IN */
+#define tcp_sack_active(pcb) 0
+#define tcp_sack_partial_ack(pcb, ack) 0
+#endif /* LWIP_TCP_SACK_IN */
+
+#if LWIP_TCP_RACK
+#define TCP_RACK_RTT            0x01U /* rtt and min_rtt are set */
+#define TCP_RACK_REORD          0x02U /* the peer has seen reordering */
+#define TCP_RACK_REO_TIMER      0x04U /* reo_timeout is armed */
+#define TCP_RACK_PTO_TIMER      0x08U /* pto_timeout is armed */
+#define TCP_RACK_TLP_OUT        0x10U /* a probe is outstanding until tlp_end */
+#define TCP_RACK_TLP_REXMIT     0x20U /* and it was a retransmission */
+#define TCP_RACK_TLP_SEND       0x40U /* tcp_output() may send one segment over cwnd */
+#define TCP_RACK_DSACK_ROUND    0x80U /* dsack_round is set */
+#define TCP_RACK_TLP_DSACK      0x100U /* the retransmitted probe was D-SACKed */
+
+void tcp_rack_delivered(struct tcp_pcb *pcb, const struct tcp_seg *seg);
+void tcp_rack_sent(struct tcp_pcb *pcb);
+void tcp_rack_tmr(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_RACK */
+
+/* Congestion control (tcp_cc.c): NewReno is built in, LWIP_TCP_CC chooses per pcb */
+void          tcp_newreno_cong_avoid(struct tcp_pcb *pcb, tcpwnd_size_t acked);
+tcpwnd_size_t tcp_newreno_ssthresh(struct tcp_pcb *pcb);
+#if LWIP_TCP_CC
+/** A congestion control algorithm */
+struct tcp_cc_ops {
+  /** The pcb starts using this algorithm */
+  void (*init)(struct tcp_pcb *pcb);
+  /** New data was acknowledged, in and out of recovery (may be NULL) */
+  void (*acked)(struct tcp_pcb *pcb, tcpwnd_size_t acked);
+  /** Open cwnd on an ACK outside recovery */
+  void (*cong_avoid)(struct tcp_pcb *pcb, tcpwnd_size_t acked);
+  /** ssthresh after a loss, fast retransmit or RTO */
+  tcpwnd_size_t (*ssthresh)(struct tcp_pcb *pcb);
+};
+extern const struct tcp_cc_ops *const tcp_cc_algos[TCP_CC_NUM];
+
+void tcp_cc_init(struct tcp_pcb *pcb);
+#define tcp_cc_cong_avoid(pcb, acked) tcp_cc_algos[(pcb)->cc]->cong_avoid(pcb, acked)
+#define tcp_cc_ssthresh(pcb) tcp_cc_algos[(pcb)->cc]->ssthresh(pcb)
+#define tcp_cc_acked(pcb, acked) do { \
+    if (tcp_cc_algos[(pcb)->cc]->acked != NULL) { \
+      tcp_cc_algos[(pcb)->cc]->acked(pcb, acked); \
+    } } while (0)
+#else /* LWIP_TCP_CC */
+#define tcp_cc_init(pcb)
+#define tcp_cc_cong_avoid(pcb, acked) tcp_newreno_cong_avoid(pcb, acked)
+#define tcp_cc_ssthresh(pcb) tcp_newreno_ssthresh(pcb)
+#define tcp_cc_acked(pcb, acked)
+#endif /* LWIP_TCP_CC */
 void  tcp_trigger_input_pcb_close(void);
 
 #if TCP_CALCULATE_EFF_SEND_MSS
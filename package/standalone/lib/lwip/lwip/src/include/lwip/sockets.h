@@ -285,6 +285,7 @@ struct linger {
 #define TCP_KEEPINTVL  0x04    /* set pcb->keep_intvl - Use seconds for get/setsockopt */
 #define TCP_KEEPCNT    0x05    /* set pcb->keep_cnt   - Use number of probes sent for get/setsockopt */
 #define TCP_QUICKACK   0x06    /* set pcb->quickack    - Use block/reenable quick ACKs */
+#define TCP_CONGESTION 0x07    /* set pcb->cc          - Use TCP_CC_* of lwip/tcp.h (LWIP_TCP_CC) */
 
 #endif /* LWIP_TCP */
 
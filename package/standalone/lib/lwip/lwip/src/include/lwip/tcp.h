@@ -164,6 +164,52 @@ struct tcp_sack_range {
 };
 #endif /* LWIP_TCP_SACK_OUT */
 
+#if LWIP_TCP_RACK
+/** RACK-TLP state of a connection (RFC 8985), times in ms of sys_now() */
+struct tcp_rack {
+  /** Send time and end of the most recently sent segment delivered */
+  u32_t xmit_ts;
+  u32_t end_seq;
+  /** Round trip of that segment, and the smallest seen */
+  u32_t rtt;
+  u32_t min_rtt;
+  /** Smoothed round trip of the segments sent once, for the probe timeout */
+  u32_t srtt;
+  /** Deadlines of the reordering and probe timers */
+  u32_t reo_timeout;
+  u32_t pto_timeout;
+  /** snd_nxt after the tail loss probe */
+  u32_t tlp_end;
+  /** snd_nxt when the reordering window was last widened on a D-SACK */
+  u32_t dsack_round;
+  /** The reordering window in quarters of min_rtt, and the recoveries
+      without D-SACK left before it shrinks back to one (RFC 8985 6.2) */
+  u8_t reo_wnd_mult;
+  u8_t reo_wnd_persist;
+  u16_t flags;
+};
+#endif /* LWIP_TCP_RACK */
+
+#if LWIP_TCP_CC
+/** Congestion control algorithms, for tcp_set_cc() and TCP_CONGESTION */
+#define TCP_CC_NEWRENO  0
+#define TCP_CC_WESTWOOD 1
+#define TCP_CC_NUM      2
+
+/** Westwood+ bandwidth estimate, times in ms of sys_now() */
+struct tcp_westwood {
+  /** Estimated bandwidth, bytes per second (0: none yet) */
+  u32_t bw;
+  /** Shortest round seen */
+  u32_t rtt_min;
+  /** The current round: start time, bytes acked, ends when end_seq is acked */
+  u32_t start;
+  u32_t acked;
+  u32_t end_seq;
+  u8_t started;
+};
+#endif /* LWIP_TCP_CC */
+
 /** Function prototype for deallocation of arguments. Called *just before* the
  * pcb is freed, so don't expect to be able to do anything with this pcb!
  *
@@ -269,6 +315,9 @@ struct tcp_pcb {
 #define TF_RTO         0x0800U /* RTO timer has fired, in-flight data moved to unsent and being retransmitted */
 #if LWIP_TCP_SACK_OUT
 #define TF_SACK        0x1000U /* Selective ACKs enabled */
+#endif
+#if LWIP_TCP_SACK_IN
+#define TF_SACK_REXMIT 0x2000U /* Fast recovery started: the first retransmission may exceed cwnd */
 #endif
 
   /* the rest of the fields are in host byte order
@@ -289,6 +338,9 @@ struct tcp_pcb {
   /* SACK ranges to include in ACK packets (entry is invalid if left==right) */
   struct tcp_sack_range rcv_sacks[LWIP_TCP_MAX_SACK_NUM];
 #define LWIP_TCP_SACK_VALID(pcb, idx) ((pcb)->rcv_sacks[idx].left != (pcb)->rcv_sacks[idx].right)
+  /* duplicate data to report once, first in the next ACK (D-SACK, RFC 2883) */
+  struct tcp_sack_range rcv_dsack;
+#define LWIP_TCP_DSACK_VALID(pcb) ((pcb)->rcv_dsack.left != (pcb)->rcv_dsack.right)
 #endif /* LWIP_TCP_SACK_OUT */
 
   /* Retransmission timer. */
@@ -315,6 +367,21 @@ struct tcp_pcb {
   /* first byte following last rto byte */
   u32_t rto_end;
 
+#if LWIP_TCP_SACK_IN
+  /* SACK scoreboard (RFC 6675), the marks are in the segments */
+  u32_t sack_high;    /* highest sequence number SACKed, HighSACK */
+  u32_t sack_recover; /* snd_nxt when fast recovery started, RecoveryPoint */
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_RACK
+  struct tcp_rack rack;
+#endif /* LWIP_TCP_RACK */
+#if LWIP_TCP_CC
+  u8_t cc;            /* congestion control, TCP_CC_* */
+  union {
+    struct tcp_westwood westwood;
+  } cc_state;
+#endif /* LWIP_TCP_CC */
+
   /* sender variables */
   u32_t snd_nxt;   /* next new seqno to be sent */
   u32_t snd_wl1, snd_wl2; /* Sequence and acknowledgement numbers of last
@@ -477,6 +544,10 @@ err_t            tcp_write   (struct tcp_pcb *pcb, const void *dataptr, u16_t le
                               u8_t apiflags);
 
 void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
+#if LWIP_TCP_CC
+err_t            tcp_set_cc  (struct tcp_pcb *pcb, u8_t cc);
+#define          tcp_get_cc(pcb) ((pcb)->cc)
+#endif /* LWIP_TCP_CC */
 
 err_t            tcp_output  (struct tcp_pcb *pcb);
 
@@ -19,13 +19,28 @@ set(LWIP_TESTFILES
 	${LWIP_TESTDIR}/core/test_pbuf.c
 	${LWIP_TESTDIR}/core/test_timers.c
 	${LWIP_TESTDIR}/dhcp/test_dhcp.c
+	${LWIP_TESTDIR}/dhcps/test_dhcps.c
+	${LWIP_TESTDIR}/dns/test_dns.c
 	${LWIP_TESTDIR}/etharp/test_etharp.c
 	${LWIP_TESTDIR}/ip4/test_ip4.c
 	${LWIP_TESTDIR}/ip6/test_ip6.c
 	${LWIP_TESTDIR}/mdns/test_mdns.c
+	${LWIP_TESTDIR}/memprof/test_memprof.c
 	${LWIP_TESTDIR}/mqtt/test_mqtt.c
+	${LWIP_TESTDIR}/resume/test_resume.c
 	${LWIP_TESTDIR}/tcp/tcp_helper.c
+	${LWIP_TESTDIR}/tcp/tcp_link.c
 	${LWIP_TESTDIR}/tcp/test_tcp_oos.c
 	${LWIP_TESTDIR}/tcp/test_tcp.c
+	${LWIP_TESTDIR}/tcp/test_tcp_sack.c
+	${LWIP_TESTDIR}/tcp/test_tcp_cc.c
 	${LWIP_TESTDIR}/udp/test_udp.c
+	${LWIP_DIR}/../apps/resume/lwip_resume.c
+	${LWIP_DIR}/../apps/memprof/lwip_memprof.c
+	${LWIP_DIR}/../apps/dhcpserver/dhcps_lease.c
+	${LWIP_DIR}/../apps/dhcpserver/dhcpserver.c
 )
+# Warm resume, the pool profiler and the DHCP server live with the vendor apps, next to the lwIP tree;
+# the target headers dhcpserver.c includes are stubbed in dhcps/include
+set(LWIP_TESTINCLUDES ${LWIP_DIR}/../include/apps/resume ${LWIP_DIR}/../include/apps/memprof
+	${LWIP_DIR}/../include/apps/dhcpserver ${LWIP_TESTDIR}/dhcps/include)
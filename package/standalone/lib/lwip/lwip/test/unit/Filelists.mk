@@ -39,13 +39,33 @@ TESTFILES=$(TESTDIR)/lwip_unittests.c \
 	$(TESTDIR)/core/test_pbuf.c \
 	$(TESTDIR)/core/test_timers.c \
 	$(TESTDIR)/dhcp/test_dhcp.c \
+	$(TESTDIR)/dhcps/test_dhcps.c \
+	$(TESTDIR)/dns/test_dns.c \
 	$(TESTDIR)/etharp/test_etharp.c \
 	$(TESTDIR)/ip4/test_ip4.c \
 	$(TESTDIR)/ip6/test_ip6.c \
 	$(TESTDIR)/mdns/test_mdns.c \
+	$(TESTDIR)/memprof/test_memprof.c \
 	$(TESTDIR)/mqtt/test_mqtt.c \
+	$(TESTDIR)/resume/test_resume.c \
 	$(TESTDIR)/tcp/tcp_helper.c \
+	$(TESTDIR)/tcp/tcp_link.c \
 	$(TESTDIR)/tcp/test_tcp_oos.c \
 	$(TESTDIR)/tcp/test_tcp.c \
+	$(TESTDIR)/tcp/test_tcp_sack.c \
+	$(TESTDIR)/tcp/test_tcp_cc.c \
 	$(TESTDIR)/udp/test_udp.c
 
+# Warm resume lives with the vendor apps, next to the lwIP tree
+TESTFILES+=$(LWIPDIR)/../../apps/resume/lwip_resume.c
+CFLAGS+=-I$(LWIPDIR)/../../include/apps/resume
+
+# Pool profiler, also with the vendor apps
+TESTFILES+=$(LWIPDIR)/../../apps/memprof/lwip_memprof.c
+CFLAGS+=-I$(LWIPDIR)/../../include/apps/memprof
+
+# DHCP server and its lease table, also with the vendor apps; the target
+# headers dhcpserver.c includes are stubbed in dhcps/include
+TESTFILES+=$(LWIPDIR)/../../apps/dhcpserver/dhcps_lease.c \
+	$(LWIPDIR)/../../apps/dhcpserver/dhcpserver.c
+CFLAGS+=-I$(LWIPDIR)/../../include/apps/dhcpserver -I$(TESTDIR)/dhcps/include
@@ -6,8 +6,11 @@
 #if !LWIP_STATS || !MEM_STATS ||!MEMP_STATS
 #error "This tests needs MEM- and MEMP-statistics enabled"
 #endif
-#if LWIP_DNS
-#error "This test needs DNS turned off (as it mallocs on init)"
+/* dns_init() allocates only the UDP pcb of a fixed source port and the
+   entries of a dynamic local host list */
+#if LWIP_DNS && (!(LWIP_DNS_SECURE & LWIP_DNS_SECURE_RAND_SRC_PORT) || \
+                 (DNS_LOCAL_HOSTLIST && DNS_LOCAL_HOSTLIST_IS_DYNAMIC))
+#error "This test needs a DNS that does not allocate on init"
 #endif
 #if !LWIP_TCP || !TCP_QUEUE_OOSEQ || !LWIP_WND_SCALE
 #error "This test needs TCP OOSEQ queueing and window scaling enabled"
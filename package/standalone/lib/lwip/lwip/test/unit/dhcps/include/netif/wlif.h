@@ -0,0 +1,6 @@
+#ifndef __WLIF_H__
+#define __WLIF_H__
+
+/* The soft AP interface of the tests is a plain ethernet netif */
+
+#endif /* __WLIF_H__ */
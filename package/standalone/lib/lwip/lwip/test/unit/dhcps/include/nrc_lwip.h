@@ -0,0 +1,44 @@
+#ifndef __NRC_LWIP_H__
+#define __NRC_LWIP_H__
+
+/* What dhcpserver.c needs of port/include/nrc_lwip.h, without the
+ * system and driver headers of the target; the soft AP side is stubbed
+ * in test_dhcps.c */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <strings.h>
+
+#include "lwip/netif.h"
+#include "lwip/ip_addr.h"
+
+typedef enum {
+	WIFI_NULL_MODE = 0,
+	WIFI_STATION_MODE,
+	WIFI_SOFTAP_MODE,
+	WIFI_STATIONAP_MODE,
+	WIFI_MAX_MODE
+} WIFI_MODE;
+
+#define MAX_IF 2
+
+enum dhcp_status {
+	DHCP_STOPPED,
+	DHCP_STARTED
+};
+
+struct ip_info {
+	ip_addr_t ip;
+	ip_addr_t netmask;
+	ip_addr_t gw;
+};
+
+#define A(format, ...)	printf(format, ##__VA_ARGS__)
+#define MACSTR		"%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC2STR(a)	(a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+
+WIFI_MODE wifi_get_opmode(void);
+bool wifi_get_ip_info(int vif_id, struct ip_info *info);
+enum dhcp_status wifi_softap_dhcps_status(void);
+
+#endif /* __NRC_LWIP_H__ */
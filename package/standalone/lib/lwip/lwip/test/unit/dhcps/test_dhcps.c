@@ -0,0 +1,754 @@
+#include "test_dhcps.h"
+
+#include "lwip/def.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip.h"
+#include "lwip/netif.h"
+#include "lwip/etharp.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+#include "netif/ethernet.h"
+#include "dhcpserver.h"
+#include "dhcps_lease.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if !LWIP_DHCPS
+#error "This test needs LWIP_DHCPS enabled"
+#endif
+
+/* A client per AID of a full soft AP cell */
+#define SCALE_CLIENTS     2000
+
+/* Offset of the DHCP message in a frame */
+#define DHCP_OFS          (SIZEOF_ETH_HDR + IP_HLEN + UDP_HLEN)
+/* Offset of the options after the magic cookie in the DHCP message */
+#define OPTIONS_OFS       (DHCP_MSG_LEN + 4)
+
+static struct netif net_softap;
+static ip4_addr_t pool_start;
+
+/* Last frame sent by the server */
+static u32_t tx_buf[1600 / 4];
+static u8_t *const tx_frame = (u8_t *)tx_buf;
+static u16_t tx_len;
+static int txpacket;
+
+static const u8_t magic_cookie[] = { 0x63, 0x82, 0x53, 0x63 };
+
+/* The soft AP side of dhcpserver.c */
+WIFI_MODE
+wifi_get_opmode(void)
+{
+  return WIFI_SOFTAP_MODE;
+}
+
+bool
+wifi_get_ip_info(int vif_id, struct ip_info *info)
+{
+  LWIP_UNUSED_ARG(vif_id);
+  ip_addr_copy(info->ip, net_softap.ip_addr);
+  ip_addr_copy(info->netmask, net_softap.netmask);
+  ip_addr_copy(info->gw, net_softap.gw);
+  return true;
+}
+
+enum dhcp_status
+wifi_softap_dhcps_status(void)
+{
+  return dhcps_get_interface() != NULL ? DHCP_STARTED : DHCP_STOPPED;
+}
+
+/* Helper functions */
+static void
+client_mac(u8_t *mac, u32_t n)
+{
+  mac[0] = 0x02;
+  mac[1] = 0x00;
+  mac[2] = (u8_t)(n >> 24);
+  mac[3] = (u8_t)(n >> 16);
+  mac[4] = (u8_t)(n >> 8);
+  mac[5] = (u8_t)n;
+}
+
+static u32_t
+pool_offset(const ip4_addr_t *ip)
+{
+  return lwip_ntohl(ip4_addr_get_u32(ip)) - lwip_ntohl(ip4_addr_get_u32(&pool_start));
+}
+
+/* DISCOVER then REQUEST of the address offered, on the lease table only */
+static int
+client_join(u32_t n, ip4_addr_t *ip, u32_t now, u32_t secs)
+{
+  u8_t mac[6];
+
+  client_mac(mac, n);
+  if (dhcps_lease_offer(mac, ip, now) != DHCPS_LEASE_OK) {
+    return DHCPS_LEASE_FULL;
+  }
+  return dhcps_lease_bind(mac, ip, now, secs);
+}
+
+static err_t
+softap_tx(struct netif *netif, struct pbuf *p)
+{
+  fail_unless(netif == &net_softap);
+  fail_unless(p->tot_len <= sizeof(tx_buf));
+  tx_len = pbuf_copy_partial(p, tx_frame, sizeof(tx_buf), 0);
+  txpacket++;
+  return ERR_OK;
+}
+
+static err_t
+softap_init(struct netif *netif)
+{
+  netif->name[0] = 'a';
+  netif->name[1] = 'p';
+  netif->output = etharp_output;
+  netif->linkoutput = softap_tx;
+  netif->mtu = 1500;
+  netif->hwaddr_len = 6;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP;
+  client_mac(netif->hwaddr, 0xffffffff);
+  return ERR_OK;
+}
+
+/* Address and netmask of the soft AP, then the DHCP server on it */
+static void
+softap_start(const char *ip, const char *netmask)
+{
+  struct ip_info info;
+
+  memset(&info, 0, sizeof(info));
+  fail_unless(ipaddr_aton(ip, &info.ip));
+  fail_unless(ipaddr_aton(netmask, &info.netmask));
+  ip_addr_copy(info.gw, info.ip);
+  netif_set_addr(&net_softap, ip_2_ip4(&info.ip), ip_2_ip4(&info.netmask), ip_2_ip4(&info.gw));
+  dhcps_start(&info, &net_softap);
+  fail_unless(dhcps_get_interface() == &net_softap);
+  /* not the gratuitous ARP of the new address */
+  txpacket = 0;
+}
+
+/* Frame of a client broadcasting a DHCP message of `len` bytes (300, the
+ * size of a BOOTP message, if 0), with the options given after the magic
+ * cookie, returns the length of the frame */
+static u16_t
+client_frame(u8_t *frame, u32_t n, const ip4_addr_t *ciaddr,
+             const u8_t *options, u16_t options_len, u16_t len)
+{
+  struct eth_hdr *eth = (struct eth_hdr *)frame;
+  struct ip_hdr *iph = (struct ip_hdr *)(frame + SIZEOF_ETH_HDR);
+  struct udp_hdr *udph = (struct udp_hdr *)(frame + SIZEOF_ETH_HDR + IP_HLEN);
+  u8_t *m = frame + DHCP_OFS;
+
+  if (len == 0) {
+    len = 300;
+  }
+  memset(frame, 0, DHCP_OFS + len);
+
+  memset(&eth->dest, 0xff, ETH_HWADDR_LEN);
+  client_mac(eth->src.addr, n);
+  eth->type = PP_HTONS(ETHTYPE_IP);
+
+  IPH_VHL_SET(iph, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iph, lwip_htons(IP_HLEN + UDP_HLEN + len));
+  IPH_TTL_SET(iph, 64);
+  IPH_PROTO_SET(iph, IP_PROTO_UDP);
+  if (ciaddr != NULL) {
+    ip4_addr_copy(iph->src, *ciaddr);
+  }
+  ip4_addr_set_u32(&iph->dest, IPADDR_BROADCAST);
+  IPH_CHKSUM_SET(iph, inet_chksum(iph, IP_HLEN));
+
+  udph->src = PP_HTONS(DHCPS_CLIENT_PORT);
+  udph->dest = PP_HTONS(DHCPS_SERVER_PORT);
+  udph->len = lwip_htons(UDP_HLEN + len);
+
+  m[0] = 1;          /* BOOTREQUEST */
+  m[1] = DHCP_HTYPE_ETHERNET;
+  m[2] = DHCP_HLEN_ETHERNET;
+  memcpy(&m[4], &n, 4);   /* xid */
+  if (ciaddr != NULL) {
+    memcpy(&m[12], &ciaddr->addr, 4);
+  }
+  client_mac(&m[28], n);
+  memcpy(&m[DHCP_MSG_LEN], magic_cookie, sizeof(magic_cookie));
+  fail_unless(OPTIONS_OFS + options_len <= len);
+  if (options_len > 0) {
+    memcpy(&m[OPTIONS_OFS], options, options_len);
+  }
+
+  return (u16_t)(DHCP_OFS + len);
+}
+
+/* Cuts the DHCP message of a frame to `len` bytes, returns the length of the frame */
+static u16_t
+client_frame_cut(u8_t *frame, u16_t len)
+{
+  struct ip_hdr *iph = (struct ip_hdr *)(frame + SIZEOF_ETH_HDR);
+  struct udp_hdr *udph = (struct udp_hdr *)(frame + SIZEOF_ETH_HDR + IP_HLEN);
+
+  IPH_LEN_SET(iph, lwip_htons(IP_HLEN + UDP_HLEN + len));
+  IPH_CHKSUM_SET(iph, 0);
+  IPH_CHKSUM_SET(iph, inet_chksum(iph, IP_HLEN));
+  udph->len = lwip_htons(UDP_HLEN + len);
+  return (u16_t)(DHCP_OFS + len);
+}
+
+/* Hands a frame to the soft AP as the driver would, in a chain of pool
+ * pbufs when it is long */
+static void
+softap_input(const u8_t *frame, u16_t len)
+{
+  struct pbuf *p, *q;
+
+  p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+  fail_unless(p != NULL);
+  for (q = p; q != NULL; q = q->next) {
+    memcpy(q->payload, frame, q->len);
+    frame += q->len;
+  }
+  net_softap.input(p, &net_softap);
+}
+
+/* Sends a DISCOVER (ciaddr NULL) or a REQUEST of client n and returns
+ * the type of the reply, 0 if there is none */
+static u8_t
+client_send(u32_t n, u8_t type, const ip4_addr_t *ciaddr,
+            const ip4_addr_t *req, const ip4_addr_t *server)
+{
+  static u32_t frame[1600 / 4];
+  u8_t options[32];
+  u16_t len = 0;
+  int sent = txpacket;
+
+  options[len++] = DHCP_OPTION_MSG_TYPE;
+  options[len++] = 1;
+  options[len++] = type;
+  if (req != NULL) {
+    options[len++] = DHCP_OPTION_REQ_IPADDR;
+    options[len++] = 4;
+    memcpy(&options[len], &req->addr, 4);
+    len += 4;
+  }
+  if (server != NULL) {
+    options[len++] = DHCP_OPTION_SERVER_ID;
+    options[len++] = 4;
+    memcpy(&options[len], &server->addr, 4);
+    len += 4;
+  }
+  options[len++] = DHCP_OPTION_REQ_LIST;
+  options[len++] = 3;
+  options[len++] = DHCP_OPTION_SUBNET_MASK;
+  options[len++] = DHCP_OPTION_ROUTER;
+  options[len++] = DHCP_OPTION_DNS_SERVER;
+  options[len++] = DHCP_OPTION_END;
+
+  softap_input((u8_t *)frame, client_frame((u8_t *)frame, n, ciaddr, options, len, 0));
+
+  if (txpacket == sent) {
+    return 0;
+  }
+  fail_unless(txpacket == sent + 1);
+  return tx_frame[DHCP_OFS + OPTIONS_OFS] == DHCP_OPTION_MSG_TYPE ? tx_frame[DHCP_OFS + OPTIONS_OFS + 2] : 0xff;
+}
+
+/* Value of an option of the last reply, NULL if it has none */
+static const u8_t *
+reply_option(u8_t code, u8_t len)
+{
+  u16_t i = DHCP_OFS + OPTIONS_OFS;
+
+  while (i + 1 < tx_len && tx_frame[i] != DHCP_OPTION_END) {
+    if (tx_frame[i] == code) {
+      fail_unless(tx_frame[i + 1] == len);
+      return &tx_frame[i + 2];
+    }
+    i += 2 + tx_frame[i + 1];
+  }
+  return NULL;
+}
+
+/* The last reply is a well formed one to client n, returns the address in it */
+static ip4_addr_t
+reply_check(u32_t n)
+{
+  const struct eth_hdr *eth = (const struct eth_hdr *)tx_frame;
+  const struct udp_hdr *udph = (const struct udp_hdr *)(tx_frame + SIZEOF_ETH_HDR + IP_HLEN);
+  const u8_t *m = tx_frame + DHCP_OFS;
+  ip4_addr_t yiaddr;
+  u8_t mac[6];
+
+  fail_unless(tx_len >= DHCP_OFS + sizeof(struct dhcps_msg));
+  fail_unless(eth_addr_cmp(&eth->dest, &ethbroadcast));
+  fail_unless(udph->src == PP_HTONS(DHCPS_SERVER_PORT));
+  fail_unless(udph->dest == PP_HTONS(DHCPS_CLIENT_PORT));
+  fail_unless(m[0] == DHCP_REPLY);
+  fail_unless(memcmp(&m[4], &n, 4) == 0);
+  client_mac(mac, n);
+  fail_unless(memcmp(&m[28], mac, 6) == 0);
+  fail_unless(memcmp(&m[DHCP_MSG_LEN], magic_cookie, sizeof(magic_cookie)) == 0);
+  memcpy(&yiaddr.addr, &m[16], 4);
+  return yiaddr;
+}
+
+/* An OFFER or ACK carries the netmask of the soft AP and the server id */
+static void
+reply_check_options(void)
+{
+  const u8_t *opt;
+
+  opt = reply_option(DHCP_OPTION_SUBNET_MASK, 4);
+  fail_unless(opt != NULL);
+  fail_unless(memcmp(opt, &ip_2_ip4(&net_softap.netmask)->addr, 4) == 0);
+  opt = reply_option(DHCP_OPTION_SERVER_ID, 4);
+  fail_unless(opt != NULL);
+  fail_unless(memcmp(opt, &ip_2_ip4(&net_softap.ip_addr)->addr, 4) == 0);
+  opt = reply_option(DHCP_OPTION_LEASE_TIME, 4);
+  fail_unless(opt != NULL);
+  fail_unless(((u32_t)opt[0] << 24 | (u32_t)opt[1] << 16 | (u32_t)opt[2] << 8 | opt[3]) ==
+              dhcps_lease_time * 60);
+}
+
+/* DISCOVER/OFFER then REQUEST/ACK of client n, returns the address bound */
+static ip4_addr_t
+client_join_frames(u32_t n)
+{
+  ip4_addr_t offered, acked;
+
+  fail_unless(client_send(n, DHCPDISCOVER, NULL, NULL, NULL) == DHCPOFFER);
+  offered = reply_check(n);
+  reply_check_options();
+  fail_unless(client_send(n, DHCPREQUEST, NULL, &offered, ip_2_ip4(&net_softap.ip_addr)) == DHCPACK);
+  acked = reply_check(n);
+  reply_check_options();
+  fail_unless(ip4_addr_cmp(&offered, &acked));
+  return acked;
+}
+
+static void
+count_bound(const struct dhcps_pool *lease, void *arg)
+{
+  if (lease->bound) {
+    (*(int *)arg)++;
+  }
+}
+
+static void
+dhcps_setup(void)
+{
+  ip4_addr_t addr;
+
+  ip4_addr_set_zero(&addr);
+  netif_add(&net_softap, &addr, &addr, &addr, NULL, softap_init, ethernet_input);
+  netif_set_link_up(&net_softap);
+  netif_set_up(&net_softap);
+
+  IP4_ADDR(&pool_start, 10, 0, 0, 2);
+  dhcps_lease_table_init(&pool_start, DHCPS_MAX_LEASE);
+}
+
+static void
+dhcps_teardown(void)
+{
+  if (dhcps_get_interface() != NULL) {
+    dhcps_stop();
+  }
+  netif_remove(&net_softap);
+  dhcps_lease_table_init(&pool_start, 0);
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+/* Test functions */
+
+/* A cell filling up through DISCOVER/OFFER and REQUEST/ACK frames: every
+ * client gets its own address of the /20 of the soft AP, and the time
+ * per client stays flat with the number of clients */
+START_TEST(test_dhcps_scale)
+{
+  static u8_t seen[DHCPS_MAX_LEASE];
+  static ip4_addr_t bound_ip[SCALE_CLIENTS];
+  ip4_addr_t ip;
+  u8_t mac[6];
+  clock_t start, t_first = 0;
+  double us;
+  u32_t n;
+  int bound = 0;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(DHCPS_MAX_LEASE >= SCALE_CLIENTS);
+  memset(seen, 0, sizeof(seen));
+  softap_start("10.0.0.1", "255.255.240.0");
+
+  start = clock();
+  for (n = 0; n < SCALE_CLIENTS; n++) {
+    bound_ip[n] = client_join_frames(n);
+    if (n == SCALE_CLIENTS / 10 - 1) {
+      t_first = clock() - start;
+    }
+  }
+  us = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC / SCALE_CLIENTS;
+  printf("dhcps: %d DISCOVER/OFFER + REQUEST/ACK in %.3f us each, %.3f us for the first %d\n",
+         SCALE_CLIENTS, us, (double)t_first * 1000000 / CLOCKS_PER_SEC / (SCALE_CLIENTS / 10),
+         SCALE_CLIENTS / 10);
+
+  fail_unless(dhcps_lease_count() == SCALE_CLIENTS);
+  for (n = 0; n < SCALE_CLIENTS; n++) {
+    client_mac(mac, n);
+    fail_unless(dhcps_lease_find(mac, &ip));
+    fail_unless(ip4_addr_cmp(&ip, &bound_ip[n]));
+    fail_unless(pool_offset(&ip) < DHCPS_MAX_LEASE);
+    fail_unless(!seen[pool_offset(&ip)]);
+    seen[pool_offset(&ip)] = 1;
+  }
+  dhcps_lease_foreach(count_bound, &bound, 0);
+  fail_unless(bound == SCALE_CLIENTS);
+
+  /* renewals of the whole cell, REQUESTs without the address option */
+  start = clock();
+  for (n = 0; n < SCALE_CLIENTS; n++) {
+    fail_unless(client_send(n, DHCPREQUEST, &bound_ip[n], NULL, NULL) == DHCPACK);
+    ip = reply_check(n);
+    fail_unless(ip4_addr_cmp(&ip, &bound_ip[n]));
+  }
+  us = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC / SCALE_CLIENTS;
+  printf("dhcps: %d REQUEST/ACK renewals in %.3f us each\n", SCALE_CLIENTS, us);
+  fail_unless(dhcps_lease_count() == SCALE_CLIENTS);
+}
+END_TEST
+
+/* The pool follows the address and netmask of the soft AP: the addresses
+ * after it, or before it when it is in the upper half of the subnet */
+START_TEST(test_dhcps_pool)
+{
+  static const struct {
+    const char *ip, *netmask, *first, *last;
+  } cells[] = {
+    { "192.168.4.1", "255.255.255.0", "192.168.4.2", "192.168.4.254" },
+    { "192.168.4.200", "255.255.255.0", "192.168.4.1", "192.168.4.199" },
+    { "192.168.4.100", "255.255.255.0", "192.168.4.101", "192.168.4.254" },
+    { "172.16.0.9", "255.255.255.248", "172.16.0.10", "172.16.0.14" },
+    { "10.0.15.254", "255.255.240.0", "10.0.8.39", "10.0.15.253" },
+  };
+  static u8_t seen[DHCPS_MAX_LEASE];
+  ip4_addr_t first, last, ip;
+  u32_t n, size, ofs;
+  size_t c;
+  LWIP_UNUSED_ARG(_i);
+
+  for (c = 0; c < sizeof(cells) / sizeof(cells[0]); c++) {
+    fail_unless(ip4addr_aton(cells[c].first, &first));
+    fail_unless(ip4addr_aton(cells[c].last, &last));
+    size = lwip_ntohl(last.addr) - lwip_ntohl(first.addr) + 1;
+    fail_unless(size <= DHCPS_MAX_LEASE);
+    memset(seen, 0, sizeof(seen));
+
+    softap_start(cells[c].ip, cells[c].netmask);
+    for (n = 0; n < size; n++) {
+      fail_unless(client_send(n, DHCPDISCOVER, NULL, NULL, NULL) == DHCPOFFER);
+      ip = reply_check(n);
+      reply_check_options();
+      ofs = lwip_ntohl(ip.addr) - lwip_ntohl(first.addr);
+      fail_unless(ofs < size, "%s: offered %s", cells[c].ip, ip4addr_ntoa(&ip));
+      fail_unless(!seen[ofs]);
+      seen[ofs] = 1;
+    }
+    fail_unless(dhcps_lease_count() == size);
+    dhcps_stop();
+  }
+}
+END_TEST
+
+/* REQUESTs for an address bound to another client or out of the pool
+ * get a NAK, and the lease of the other client is kept */
+START_TEST(test_dhcps_request_nak)
+{
+  ip4_addr_t a, ip, outside;
+  u8_t mac[6];
+  LWIP_UNUSED_ARG(_i);
+
+  softap_start("192.168.4.1", "255.255.255.0");
+  a = client_join_frames(1);
+
+  fail_unless(client_send(2, DHCPREQUEST, NULL, &a, ip_2_ip4(&net_softap.ip_addr)) == DHCPNAK);
+  reply_check(2);
+  fail_unless(reply_option(DHCP_OPTION_SUBNET_MASK, 4) == NULL);
+  client_mac(mac, 1);
+  fail_unless(dhcps_lease_find(mac, &ip));
+  fail_unless(ip4_addr_cmp(&ip, &a));
+  client_mac(mac, 2);
+  fail_unless(!dhcps_lease_find(mac, &ip));
+
+  /* renewing from an address of another subnet, as after a move */
+  IP4_ADDR(&outside, 192, 168, 7, 20);
+  fail_unless(client_send(2, DHCPREQUEST, &outside, NULL, NULL) == DHCPNAK);
+  fail_unless(!dhcps_lease_find(mac, &ip));
+
+  /* a RELEASE gives the address up, without a reply */
+  fail_unless(client_send(1, DHCPRELEASE, &a, NULL, NULL) == 0);
+  client_mac(mac, 1);
+  fail_unless(!dhcps_lease_find(mac, &ip));
+}
+END_TEST
+
+/* A REQUEST with the id of another server means the client took its
+ * offer: no reply, and the address offered goes back to the pool */
+START_TEST(test_dhcps_other_server)
+{
+  ip4_addr_t offered, other, ip;
+  u8_t mac[6];
+  LWIP_UNUSED_ARG(_i);
+
+  softap_start("192.168.4.1", "255.255.255.0");
+  fail_unless(client_send(3, DHCPDISCOVER, NULL, NULL, NULL) == DHCPOFFER);
+  offered = reply_check(3);
+  client_mac(mac, 3);
+  fail_unless(dhcps_lease_find(mac, &ip));
+  fail_unless(dhcps_lease_count() == 1);
+
+  IP4_ADDR(&other, 192, 168, 4, 254);
+  fail_unless(client_send(3, DHCPREQUEST, NULL, &offered, &other) == 0);
+  fail_unless(!dhcps_lease_find(mac, &ip));
+  fail_unless(dhcps_lease_count() == 0);
+}
+END_TEST
+
+/* Short, truncated and oversized messages, the latter in a pbuf chain:
+ * options are parsed up to the end of the message or of struct
+ * dhcps_msg, whichever comes first */
+START_TEST(test_dhcps_malformed)
+{
+  static u32_t frame[1600 / 4];
+  static const u8_t discover[] = { DHCP_OPTION_MSG_TYPE, 1, DHCPDISCOVER, DHCP_OPTION_END };
+  static const u8_t no_value[] = { DHCP_OPTION_MSG_TYPE, 1 };
+  static const u8_t too_long[] = { DHCP_OPTION_MSG_TYPE, 1, DHCPDISCOVER, DHCP_OPTION_REQ_IPADDR, 200 };
+  u8_t *m = (u8_t *)frame + DHCP_OFS;
+  u16_t len;
+  LWIP_UNUSED_ARG(_i);
+
+  softap_start("192.168.4.1", "255.255.255.0");
+
+  /* shorter than the fixed header and the magic cookie */
+  client_frame((u8_t *)frame, 1, NULL, discover, sizeof(discover), 0);
+  len = client_frame_cut((u8_t *)frame, DHCP_MSG_LEN + 2);
+  softap_input((u8_t *)frame, len);
+  fail_unless(txpacket == 0);
+
+  /* the type option cut short by the end of the message */
+  client_frame((u8_t *)frame, 1, NULL, no_value, sizeof(no_value), 0);
+  len = client_frame_cut((u8_t *)frame, OPTIONS_OFS + sizeof(no_value));
+  softap_input((u8_t *)frame, len);
+  fail_unless(txpacket == 0);
+
+  /* an option running past the end still leaves the type parsed before it */
+  len = client_frame((u8_t *)frame, 2, NULL, too_long, sizeof(too_long), 0);
+  softap_input((u8_t *)frame, len);
+  fail_unless(txpacket == 1);
+  reply_check(2);
+
+  /* a 1000 byte message: the type after the first 312 bytes of options
+   * is out of reach... */
+  len = client_frame((u8_t *)frame, 3, NULL, NULL, 0, 1000);
+  memcpy(&m[OPTIONS_OFS + 400], discover, sizeof(discover));
+  softap_input((u8_t *)frame, len);
+  fail_unless(txpacket == 1);
+
+  /* ...and the one in them is not */
+  memset(&m[OPTIONS_OFS + 400], 0, sizeof(discover));
+  memcpy(&m[OPTIONS_OFS], discover, sizeof(discover));
+  softap_input((u8_t *)frame, len);
+  fail_unless(txpacket == 2);
+  reply_check(3);
+  reply_check_options();
+  fail_unless(dhcps_lease_count() == 2);
+}
+END_TEST
+
+/* Leases and offers expire on time, not before */
+START_TEST(test_dhcps_expiry)
+{
+  ip4_addr_t ip;
+  u8_t mac[6];
+  u32_t t;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(client_join(1, &ip, 0, 10) == DHCPS_LEASE_OK);
+  /* a lease over a round of the wheel */
+  fail_unless(client_join(2, &ip, 0, DHCPS_LEASE_WHEEL + 20) == DHCPS_LEASE_OK);
+  client_mac(mac, 3);
+  fail_unless(dhcps_lease_offer(mac, &ip, 0) == DHCPS_LEASE_OK);
+  fail_unless(dhcps_lease_count() == 3);
+
+  for (t = 1; t < 10; t++) {
+    dhcps_lease_tick(t);
+  }
+  fail_unless(dhcps_lease_count() == 3);
+  dhcps_lease_tick(10);
+  fail_unless(dhcps_lease_count() == 2);
+  client_mac(mac, 1);
+  fail_unless(!dhcps_lease_find(mac, &ip));
+
+  /* a late tick expires what was due in between */
+  dhcps_lease_tick(DHCPS_OFFER_SECS + 5);
+  fail_unless(dhcps_lease_count() == 1);
+  client_mac(mac, 3);
+  fail_unless(!dhcps_lease_find(mac, &ip));
+
+  dhcps_lease_tick(DHCPS_LEASE_WHEEL + 19);
+  fail_unless(dhcps_lease_count() == 1);
+  dhcps_lease_tick(DHCPS_LEASE_WHEEL + 20);
+  fail_unless(dhcps_lease_count() == 0);
+}
+END_TEST
+
+/* The lease table refuses addresses the client may not have */
+START_TEST(test_dhcps_nak)
+{
+  ip4_addr_t a, b, other;
+  u8_t mac_a[6], mac_b[6], mac_c[6];
+  LWIP_UNUSED_ARG(_i);
+
+  client_mac(mac_a, 1);
+  client_mac(mac_b, 2);
+  client_mac(mac_c, 3);
+  fail_unless(dhcps_lease_offer(mac_a, &a, 0) == DHCPS_LEASE_OK);
+  fail_unless(dhcps_lease_offer(mac_b, &b, 0) == DHCPS_LEASE_OK);
+  fail_unless(!ip4_addr_cmp(&a, &b));
+
+  /* the address offered to another client */
+  fail_unless(dhcps_lease_bind(mac_b, &a, 0, 60) == DHCPS_LEASE_WRONG);
+  fail_unless(dhcps_lease_bind(mac_c, &a, 0, 60) == DHCPS_LEASE_WRONG);
+  /* the same DISCOVER again gets the same address */
+  fail_unless(dhcps_lease_offer(mac_a, &other, 0) == DHCPS_LEASE_OK);
+  fail_unless(ip4_addr_cmp(&a, &other));
+  fail_unless(dhcps_lease_bind(mac_a, &a, 0, 60) == DHCPS_LEASE_OK);
+
+  /* a client without a lease keeps a free address of the pool, as after a
+   * restart of the AP, but not one outside of it */
+  IP4_ADDR(&other, 10, 0, 0, 200);
+  fail_unless(dhcps_lease_bind(mac_c, &other, 0, 60) == DHCPS_LEASE_OK);
+  fail_unless(dhcps_lease_find(mac_c, &b));
+  fail_unless(ip4_addr_cmp(&b, &other));
+  dhcps_lease_release(mac_c);
+  IP4_ADDR(&other, 192, 168, 0, 200);
+  fail_unless(dhcps_lease_bind(mac_c, &other, 0, 60) == DHCPS_LEASE_WRONG);
+
+  /* a released address is not handed out again at once */
+  dhcps_lease_release(mac_a);
+  fail_unless(!dhcps_lease_find(mac_a, &other));
+  fail_unless(dhcps_lease_offer(mac_c, &other, 0) == DHCPS_LEASE_OK);
+  fail_unless(!ip4_addr_cmp(&a, &other));
+}
+END_TEST
+
+/* A full pool gives the lease expiring first to a new client */
+START_TEST(test_dhcps_full)
+{
+  ip4_addr_t ip, first;
+  u8_t mac[6];
+  u32_t n;
+  LWIP_UNUSED_ARG(_i);
+
+  dhcps_lease_table_init(&pool_start, 4);
+  for (n = 0; n < 4; n++) {
+    fail_unless(client_join(n, &ip, 0, n == 2 ? 100 : 1000) == DHCPS_LEASE_OK);
+    if (n == 2) {
+      ip4_addr_copy(first, ip);
+    }
+  }
+  fail_unless(client_join(4, &ip, 1, 1000) == DHCPS_LEASE_OK);
+  fail_unless(ip4_addr_cmp(&ip, &first));
+  client_mac(mac, 2);
+  fail_unless(!dhcps_lease_find(mac, &ip));
+  fail_unless(dhcps_lease_count() == 4);
+
+  dhcps_lease_table_init(&pool_start, 0);
+  client_mac(mac, 5);
+  fail_unless(dhcps_lease_offer(mac, &ip, 0) == DHCPS_LEASE_FULL);
+}
+END_TEST
+
+/* Bound leases survive a save and restore, renewals do not need a save */
+START_TEST(test_dhcps_persist)
+{
+  static u8_t chunks[DHCPS_LEASE_CHUNKS][DHCPS_LEASE_CHUNK_SIZE];
+  static size_t lens[DHCPS_LEASE_CHUNKS];
+  ip4_addr_t ip, found;
+  u8_t mac[6];
+  int chunk;
+  u32_t n, clients = DHCPS_LEASE_CHUNK * 2 + 5;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(DHCPS_LEASE_CHUNKS >= 3);
+  fail_unless(dhcps_lease_dirty(0) == -1);
+  for (n = 0; n < clients; n++) {
+    fail_unless(client_join(n, &ip, 0, 3600) == DHCPS_LEASE_OK);
+  }
+  /* an offer is not saved */
+  client_mac(mac, clients);
+  fail_unless(dhcps_lease_offer(mac, &ip, 0) == DHCPS_LEASE_OK);
+
+  fail_unless(dhcps_lease_dirty(0) == 0);
+  fail_unless(dhcps_lease_dirty(1) == 1);
+  fail_unless(dhcps_lease_dirty(2) == 2);
+  fail_unless(dhcps_lease_dirty(3) == -1);
+
+  memset(lens, 0, sizeof(lens));
+  for (chunk = dhcps_lease_dirty(0); chunk >= 0; chunk = dhcps_lease_dirty(chunk + 1)) {
+    lens[chunk] = dhcps_lease_save(chunk, chunks[chunk], 600);
+    fail_unless(lens[chunk] <= DHCPS_LEASE_CHUNK_SIZE);
+  }
+  fail_unless(chunks[0][1] == DHCPS_LEASE_CHUNK);
+  fail_unless(chunks[2][1] == 5);
+  fail_unless(dhcps_lease_dirty(0) == -1);
+
+  client_mac(mac, 7);
+  fail_unless(dhcps_lease_find(mac, &ip));
+  fail_unless(dhcps_lease_bind(mac, &ip, 600, 3600) == DHCPS_LEASE_OK);
+  fail_unless(dhcps_lease_dirty(0) == -1);
+
+  /* restart */
+  dhcps_lease_table_init(&pool_start, DHCPS_MAX_LEASE);
+  fail_unless(dhcps_lease_restore(0, chunks[0], 1, 1000) == -1);
+  for (chunk = 0; chunk < 3; chunk++) {
+    fail_unless(dhcps_lease_restore(chunk, chunks[chunk], lens[chunk], 1000) == chunks[chunk][1]);
+  }
+  fail_unless(dhcps_lease_count() == clients);
+  fail_unless(dhcps_lease_dirty(0) == -1);
+
+  for (n = 0; n < clients; n++) {
+    client_mac(mac, n);
+    fail_unless(dhcps_lease_find(mac, &found));
+    fail_unless(pool_offset(&found) == n);
+  }
+  /* 3000 s were left at the save */
+  dhcps_lease_tick(3999);
+  fail_unless(dhcps_lease_count() == clients);
+  dhcps_lease_tick(4000);
+  fail_unless(dhcps_lease_count() == 0);
+  /* the expiries are to be saved */
+  fail_unless(dhcps_lease_dirty(0) == 0);
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+dhcps_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_dhcps_scale),
+    TESTFUNC(test_dhcps_pool),
+    TESTFUNC(test_dhcps_request_nak),
+    TESTFUNC(test_dhcps_other_server),
+    TESTFUNC(test_dhcps_malformed),
+    TESTFUNC(test_dhcps_expiry),
+    TESTFUNC(test_dhcps_nak),
+    TESTFUNC(test_dhcps_full),
+    TESTFUNC(test_dhcps_persist)
+  };
+  return create_suite("DHCPS", tests, sizeof(tests)/sizeof(testfunc), dhcps_setup, dhcps_teardown);
+}
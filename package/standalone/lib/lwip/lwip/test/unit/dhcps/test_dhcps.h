@@ -0,0 +1,8 @@
+#ifndef LWIP_HDR_TEST_DHCPS_H
+#define LWIP_HDR_TEST_DHCPS_H
+
+#include "../lwip_check.h"
+
+Suite* dhcps_suite(void);
+
+#endif
@@ -0,0 +1,436 @@
+#include "test_dns.h"
+
+#include "lwip/dns.h"
+#include "lwip/netif.h"
+#include "lwip/ip4.h"
+#include "lwip/udp.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/dns.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+
+#include <string.h>
+
+#if !LWIP_DNS || !DNS_NEG_TTL || !DNS_PREFETCH_TTL || !LWIP_RESUME
+#error "This test needs LWIP_DNS with DNS_NEG_TTL, DNS_PREFETCH_TTL and LWIP_RESUME"
+#endif
+
+#define DNS_TEST_NAME_LEN 64
+/* Longer than any TTL given by the tests */
+#define DNS_TEST_MAX_TTL  700
+/* RCODE 2 */
+#define DNS_TEST_ERR_SERVER 0x02
+
+static struct netif test_netif;
+static ip4_addr_t test_ipaddr, test_netmask, test_server;
+
+/* The last query sent to the fake server */
+static struct {
+  int count;
+  u16_t id;
+  u16_t port;
+  u16_t type;
+  char name[DNS_TEST_NAME_LEN];
+} query;
+
+/* The last answer given to a found callback */
+static struct {
+  int count;
+  int found;
+  ip_addr_t addr;
+  char name[DNS_TEST_NAME_LEN];
+} answer;
+
+/* Helper functions */
+
+/* Catch the queries on their way out */
+static err_t
+dns_test_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  u8_t buf[256];
+  u16_t len, pos, out = 0;
+  struct ip_hdr *iphdr = (struct ip_hdr *)buf;
+  struct udp_hdr *udphdr;
+  struct dns_hdr *dnshdr;
+
+  LWIP_UNUSED_ARG(netif);
+  fail_unless(ip4_addr_cmp(ipaddr, &test_server));
+  len = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+  fail_unless(len > IP_HLEN + UDP_HLEN + SIZEOF_DNS_HDR);
+  fail_unless(IPH_PROTO(iphdr) == IP_PROTO_UDP);
+  udphdr = (struct udp_hdr *)(buf + IP_HLEN);
+  fail_unless(udphdr->dest == PP_HTONS(DNS_SERVER_PORT));
+  dnshdr = (struct dns_hdr *)(buf + IP_HLEN + UDP_HLEN);
+
+  query.count++;
+  query.id = lwip_ntohs(dnshdr->id);
+  query.port = lwip_ntohs(udphdr->src);
+
+  /* labels to a dotted name */
+  pos = IP_HLEN + UDP_HLEN + SIZEOF_DNS_HDR;
+  while (pos < len && buf[pos] != 0 && out < sizeof(query.name) - 1) {
+    u8_t n = buf[pos++];
+    if (out > 0) {
+      query.name[out++] = '.';
+    }
+    while (n-- > 0 && pos < len && out < sizeof(query.name) - 1) {
+      query.name[out++] = (char)buf[pos++];
+    }
+  }
+  query.name[out] = 0;
+  pos++;
+  fail_unless(pos + 4 <= len);
+  query.type = (u16_t)((buf[pos] << 8) | buf[pos + 1]);
+  return ERR_OK;
+}
+
+static err_t
+dns_test_netif_init(struct netif *netif)
+{
+  fail_unless(netif != NULL);
+  netif->output = dns_test_output;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+/* Answer the last query from the fake server: an A record, or an error */
+static void
+dns_test_respond(u8_t rcode, const char *addr, u32_t ttl)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  struct udp_hdr *udphdr;
+  u8_t *dns;
+  u16_t pos = SIZEOF_DNS_HDR, len;
+  const char *label = query.name;
+  ip4_addr_t ip4;
+
+  p = pbuf_alloc(PBUF_RAW, IP_HLEN + UDP_HLEN + 512, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless(p->len == p->tot_len);
+  memset(p->payload, 0, p->len);
+  dns = (u8_t *)p->payload + IP_HLEN + UDP_HLEN;
+
+  dns[0] = (u8_t)(query.id >> 8);
+  dns[1] = (u8_t)query.id;
+  dns[2] = DNS_FLAG1_RESPONSE | DNS_FLAG1_RD;
+  dns[3] = DNS_FLAG2_RA | rcode;
+  dns[5] = 1;                           /* questions */
+  dns[7] = (rcode == DNS_FLAG2_ERR_NONE) ? 1 : 0;
+
+  /* the question, as asked */
+  while (*label) {
+    const char *dot = strchr(label, '.');
+    u8_t n = (u8_t)(dot ? dot - label : (int)strlen(label));
+    dns[pos++] = n;
+    memcpy(&dns[pos], label, n);
+    pos = (u16_t)(pos + n);
+    label += n + (dot ? 1 : 0);
+  }
+  dns[pos++] = 0;
+  dns[pos++] = (u8_t)(query.type >> 8);
+  dns[pos++] = (u8_t)query.type;
+  dns[pos++] = 0;
+  dns[pos++] = DNS_RRCLASS_IN;
+
+  if (rcode == DNS_FLAG2_ERR_NONE) {
+    fail_unless(query.type == DNS_RRTYPE_A);
+    fail_unless(ip4addr_aton(addr, &ip4));
+    dns[pos++] = 0xc0;                  /* pointer to the question's name */
+    dns[pos++] = SIZEOF_DNS_HDR;
+    dns[pos++] = 0;
+    dns[pos++] = DNS_RRTYPE_A;
+    dns[pos++] = 0;
+    dns[pos++] = DNS_RRCLASS_IN;
+    dns[pos++] = (u8_t)(ttl >> 24);
+    dns[pos++] = (u8_t)(ttl >> 16);
+    dns[pos++] = (u8_t)(ttl >> 8);
+    dns[pos++] = (u8_t)ttl;
+    dns[pos++] = 0;
+    dns[pos++] = 4;
+    memcpy(&dns[pos], &ip4.addr, 4);
+    pos += 4;
+  }
+
+  len = (u16_t)(IP_HLEN + UDP_HLEN + pos);
+  pbuf_realloc(p, len);
+
+  udphdr = (struct udp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  udphdr->src = PP_HTONS(DNS_SERVER_PORT);
+  udphdr->dest = lwip_htons(query.port);
+  udphdr->len = lwip_htons((u16_t)(UDP_HLEN + pos));
+  udphdr->chksum = 0;
+
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(len));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  ip4_addr_copy(iphdr->src, test_server);
+  ip4_addr_copy(iphdr->dest, test_ipaddr);
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+
+  fail_unless(ip4_input(p, &test_netif) == ERR_OK);
+}
+
+static void
+dns_test_found(const char *name, const ip_addr_t *ipaddr, void *arg)
+{
+  LWIP_UNUSED_ARG(arg);
+  answer.count++;
+  answer.found = ipaddr != NULL;
+  if (ipaddr != NULL) {
+    ip_addr_copy(answer.addr, *ipaddr);
+  }
+  strncpy(answer.name, name, sizeof(answer.name) - 1);
+}
+
+static err_t
+dns_test_lookup(const char *name, ip_addr_t *addr)
+{
+  return dns_gethostbyname_addrtype(name, addr, dns_test_found, NULL, LWIP_DNS_ADDRTYPE_IPV4);
+}
+
+/* Resolve a name through the fake server */
+static void
+dns_test_resolve(const char *name, const char *addr, u32_t ttl)
+{
+  ip_addr_t ip;
+  int queries = query.count, answers = answer.count;
+
+  fail_unless(dns_test_lookup(name, &ip) == ERR_INPROGRESS);
+  fail_unless(query.count == queries + 1);
+  fail_unless(strcmp(query.name, name) == 0);
+  dns_test_respond(DNS_FLAG2_ERR_NONE, addr, ttl);
+  fail_unless(answer.count == answers + 1);
+  fail_unless(answer.found);
+}
+
+/* Check a name is answered from the cache, without a query */
+static void
+dns_test_cached(const char *name, const char *addr)
+{
+  ip_addr_t ip;
+  int queries = query.count;
+
+  fail_unless(dns_test_lookup(name, &ip) == ERR_OK);
+  fail_unless(query.count == queries);
+  fail_unless(strcmp(ipaddr_ntoa(&ip), addr) == 0);
+}
+
+static void
+dns_test_tick(u32_t secs)
+{
+  while (secs-- > 0) {
+    dns_tmr();
+  }
+}
+
+/* Setups/teardown functions */
+
+static void
+dns_setup(void)
+{
+  ip_addr_t server;
+  u8_t i;
+
+  IP4_ADDR(&test_ipaddr, 192,168,5,10);
+  IP4_ADDR(&test_netmask, 255,255,255,0);
+  IP4_ADDR(&test_server, 192,168,5,1);
+
+  netif_add(&test_netif, &test_ipaddr, &test_netmask, &test_server, NULL, dns_test_netif_init, ip4_input);
+  netif_set_default(&test_netif);
+  netif_set_up(&test_netif);
+
+  /* the only server, whatever other suites (DHCP) left */
+  for (i = 1; i < DNS_MAX_SERVERS; i++) {
+    dns_setserver(i, NULL);
+  }
+  ip_addr_copy_from_ip4(server, test_server);
+  dns_setserver(0, &server);
+  memset(&query, 0, sizeof(query));
+  memset(&answer, 0, sizeof(answer));
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+static void
+dns_teardown(void)
+{
+  /* time out the queries left and expire every name */
+  dns_test_tick(DNS_TEST_MAX_TTL);
+  dns_setserver(0, NULL);
+  netif_remove(&test_netif);
+  netif_set_default(NULL);
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+/* Test functions */
+
+/* As many names as the table holds stay cached side by side */
+START_TEST(test_dns_cache_names)
+{
+  static const char *const names[] = {
+    "broker.example.com", "fota.example.com", "pool.ntp.org", "api.example.com"
+  };
+  char addr[24];
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(LWIP_ARRAYSIZE(names) <= DNS_TABLE_SIZE);
+  for (i = 0; i < (int)LWIP_ARRAYSIZE(names); i++) {
+    snprintf(addr, sizeof(addr), "10.0.0.%d", i + 1);
+    dns_test_resolve(names[i], addr, 300);
+  }
+  for (i = 0; i < (int)LWIP_ARRAYSIZE(names); i++) {
+    snprintf(addr, sizeof(addr), "10.0.0.%d", i + 1);
+    dns_test_cached(names[i], addr);
+  }
+  /* names are not case sensitive */
+  dns_test_cached("Broker.Example.COM", "10.0.0.1");
+}
+END_TEST
+
+/* A name is dropped when its TTL runs out, not before */
+START_TEST(test_dns_ttl)
+{
+  ip_addr_t ip;
+  LWIP_UNUSED_ARG(_i);
+
+  dns_test_resolve("short.example.com", "10.0.1.1", DNS_PREFETCH_TTL + 20);
+  dns_test_tick(19);
+  dns_test_cached("short.example.com", "10.0.1.1");
+  /* no lookup in the prefetch window */
+  dns_test_tick(DNS_PREFETCH_TTL + 1);
+  fail_unless(dns_test_lookup("short.example.com", &ip) == ERR_INPROGRESS);
+  dns_test_respond(DNS_FLAG2_ERR_NONE, "10.0.1.2", 0);
+  /* TTL 0: for this transaction only */
+  fail_unless(answer.found);
+  fail_unless(dns_test_lookup("short.example.com", &ip) == ERR_INPROGRESS);
+  dns_test_respond(DNS_FLAG2_ERR_NONE, "10.0.1.2", 100);
+}
+END_TEST
+
+/* NXDOMAIN is remembered for DNS_NEG_TTL */
+START_TEST(test_dns_negative)
+{
+  ip_addr_t ip;
+  int queries;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(dns_test_lookup("missing.example.com", &ip) == ERR_INPROGRESS);
+  dns_test_respond(DNS_FLAG2_ERR_NAME, NULL, 0);
+  fail_unless(answer.count == 1);
+  fail_unless(!answer.found);
+
+  queries = query.count;
+  fail_unless(dns_test_lookup("missing.example.com", &ip) == ERR_VAL);
+  fail_unless(query.count == queries);
+  dns_test_tick(DNS_NEG_TTL - 1);
+  fail_unless(dns_test_lookup("missing.example.com", &ip) == ERR_VAL);
+  dns_test_tick(1);
+  fail_unless(dns_test_lookup("missing.example.com", &ip) == ERR_INPROGRESS);
+  fail_unless(query.count == queries + 1);
+
+  /* other failures are not remembered */
+  dns_test_respond(DNS_TEST_ERR_SERVER, NULL, 0);
+  fail_unless(answer.count == 2);
+  fail_unless(dns_test_lookup("missing.example.com", &ip) == ERR_INPROGRESS);
+  dns_test_respond(DNS_FLAG2_ERR_NAME, NULL, 0);
+}
+END_TEST
+
+/* A name used near the end of its TTL is refreshed in the background */
+START_TEST(test_dns_prefetch)
+{
+  ip_addr_t ip;
+  int queries;
+  LWIP_UNUSED_ARG(_i);
+
+  dns_test_resolve("mqtt.example.com", "10.0.2.1", 100);
+  dns_test_tick(100 - DNS_PREFETCH_TTL - 1);
+  dns_test_cached("mqtt.example.com", "10.0.2.1");
+
+  dns_test_tick(1);
+  queries = query.count;
+  fail_unless(dns_test_lookup("mqtt.example.com", &ip) == ERR_OK);
+  fail_unless(strcmp(ipaddr_ntoa(&ip), "10.0.2.1") == 0);
+  fail_unless(query.count == queries + 1);
+  fail_unless(strcmp(query.name, "mqtt.example.com") == 0);
+
+  /* the old address answers until the new one comes, with a single query */
+  dns_test_cached("mqtt.example.com", "10.0.2.1");
+  dns_test_respond(DNS_FLAG2_ERR_NONE, "10.0.2.2", 100);
+  /* nobody was waiting */
+  fail_unless(answer.count == 1);
+  dns_test_tick(DNS_PREFETCH_TTL + 10);
+  dns_test_cached("mqtt.example.com", "10.0.2.2");
+
+  /* no answer to a prefetch: the name goes when the retries are over */
+  dns_test_tick(100 - 2 * DNS_PREFETCH_TTL - 10);
+  fail_unless(dns_test_lookup("mqtt.example.com", &ip) == ERR_OK);
+  fail_unless(query.count == queries + 2);
+  dns_test_tick(DNS_MAX_RETRIES * DNS_MAX_RETRIES);
+  fail_unless(dns_test_lookup("mqtt.example.com", &ip) == ERR_INPROGRESS);
+  dns_test_respond(DNS_FLAG2_ERR_NONE, "10.0.2.3", 100);
+}
+END_TEST
+
+/* Names saved before a deep sleep answer after the wakeup */
+START_TEST(test_dns_save_restore)
+{
+  u8_t buf[128];
+  int len;
+  LWIP_UNUSED_ARG(_i);
+
+  dns_test_resolve("old.example.com", "10.0.3.1", 600);
+  dns_test_resolve("short.example.com", "10.0.3.2", 60);
+  dns_test_resolve("new.example.com", "10.0.3.3", 600);
+
+  len = dns_cache_save(buf, sizeof(buf));
+  fail_unless(len > 2);
+  fail_unless(buf[0] == DNS_CACHE_VERSION);
+  fail_unless(buf[1] == 3);
+  /* the names asked for last come first */
+  fail_unless(dns_cache_save(buf, 2 + 1 + 15 + 1 + 4 + 4) == 2 + 1 + 15 + 1 + 4 + 4);
+  fail_unless(buf[1] == 1);
+  fail_unless(memcmp(&buf[3], "new.example.com", 15) == 0);
+  fail_unless(dns_cache_save(buf, 1) == ERR_BUF);
+  fail_unless(dns_cache_save(buf, sizeof(buf)) == len);
+
+  /* the sleep: the table is lost */
+  dns_test_tick(600);
+
+  fail_unless(dns_cache_restore(buf, 1, 0) == ERR_VAL);
+  fail_unless(dns_cache_restore(buf, (u16_t)(len - 1), 100) == ERR_VAL);
+  buf[0]++;
+  fail_unless(dns_cache_restore(buf, (u16_t)len, 100) == ERR_VAL);
+  buf[0]--;
+  /* the short one expired during the sleep */
+  fail_unless(dns_cache_restore(buf, (u16_t)len, 100) == 2);
+  dns_test_cached("old.example.com", "10.0.3.1");
+  dns_test_cached("new.example.com", "10.0.3.3");
+  /* restored only once */
+  fail_unless(dns_cache_restore(buf, (u16_t)len, 100) == 0);
+
+  /* with the TTL left at the save, less the sleep */
+  dns_test_tick(600 - 100 - DNS_PREFETCH_TTL - 1);
+  dns_test_cached("old.example.com", "10.0.3.1");
+  dns_test_tick(DNS_PREFETCH_TTL + 1);
+  dns_test_resolve("new.example.com", "10.0.3.4", 600);
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+dns_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_dns_cache_names),
+    TESTFUNC(test_dns_ttl),
+    TESTFUNC(test_dns_negative),
+    TESTFUNC(test_dns_prefetch),
+    TESTFUNC(test_dns_save_restore)
+  };
+  return create_suite("DNS", tests, sizeof(tests)/sizeof(testfunc), dns_setup, dns_teardown);
+}
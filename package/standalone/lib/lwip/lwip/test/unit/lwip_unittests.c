@@ -5,6 +5,8 @@
 #include "udp/test_udp.h"
 #include "tcp/test_tcp.h"
 #include "tcp/test_tcp_oos.h"
+#include "tcp/test_tcp_sack.h"
+#include "tcp/test_tcp_cc.h"
 #include "core/test_def.h"
 #include "core/test_mem.h"
 #include "core/test_netif.h"
@@ -12,6 +14,10 @@
 #include "core/test_timers.h"
 #include "etharp/test_etharp.h"
 #include "dhcp/test_dhcp.h"
+#include "dhcps/test_dhcps.h"
+#include "dns/test_dns.h"
+#include "resume/test_resume.h"
+#include "memprof/test_memprof.h"
 #include "mdns/test_mdns.h"
 #include "mqtt/test_mqtt.h"
 #include "api/test_sockets.h"
@@ -67,6 +73,8 @@ int main(void)
     udp_suite,
     tcp_suite,
     tcp_oos_suite,
+    tcp_sack_suite,
+    tcp_cc_suite,
     def_suite,
     mem_suite,
     netif_suite,
@@ -74,6 +82,10 @@ int main(void)
     timers_suite,
     etharp_suite,
     dhcp_suite,
+    dhcps_suite,
+    dns_suite,
+    resume_suite,
+    memprof_suite,
     mdns_suite,
     mqtt_suite,
     sockets_suite
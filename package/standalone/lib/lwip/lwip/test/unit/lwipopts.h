@@ -34,6 +34,15 @@
 
 #define LWIP_TESTMODE                   1
 
+/* Pool sizes of lib/lwip/tools/lwip_memprof.py, for the replay of the
+   MEMPROF suite. They override the sizes below. */
+#ifdef LWIP_TUNED_OPTS
+#define LWIP_MEMPROF_REPLAY             1
+#include LWIP_TUNED_OPTS
+/* the test stack runs other timers than the device */
+#undef MEMP_NUM_SYS_TIMEOUT
+#endif
+
 #define LWIP_IPV6                       1
 
 #define LWIP_CHECKSUM_ON_COPY           1
@@ -55,20 +64,55 @@
 #define LWIP_DHCP                       1
 
 /* Minimal changes to opt.h required for tcp unit tests: */
+#ifndef MEM_SIZE
 #define MEM_SIZE                        16000
+#endif
+#ifndef TCP_SND_QUEUELEN
 #define TCP_SND_QUEUELEN                40
+#endif
+#ifndef MEMP_NUM_TCP_SEG
 #define MEMP_NUM_TCP_SEG                TCP_SND_QUEUELEN
+#endif
+#ifndef TCP_SND_BUF
 #define TCP_SND_BUF                     (12 * TCP_MSS)
+#endif
+#ifndef TCP_WND
 #define TCP_WND                         (10 * TCP_MSS)
+#endif
 #define LWIP_WND_SCALE                  1
 #define TCP_RCV_SCALE                   0
+/* SACK loss recovery and RACK-TLP (tcp_sack tests) */
+#define LWIP_TCP_SACK_OUT               1
+#define LWIP_TCP_SACK_IN                1
+#define LWIP_TCP_RACK                   1
+/* Congestion control per pcb (tcp_cc tests) */
+#define LWIP_TCP_CC                     1
+#ifndef PBUF_POOL_SIZE
 #define PBUF_POOL_SIZE                  400 /* pbuf tests need ~200KByte */
+#endif
 
 /* Enable IGMP and MDNS for MDNS tests */
 #define LWIP_IGMP                       1
 #define LWIP_MDNS_RESPONDER             1
 #define LWIP_NUM_NETIF_CLIENT_DATA      (LWIP_MDNS_RESPONDER)
 
+/* DNS cache with negative caching and prefetch (dns tests) */
+#define LWIP_DNS                        1
+#define DNS_TABLE_SIZE                  4
+#define DNS_NEG_TTL                     30
+#define DNS_PREFETCH_TTL                30
+
+/* Save/restore of the IPv4 state across deep sleep (resume tests) */
+#define LWIP_RESUME                     1
+
+/* Heap and pool high-water marks (memprof tests) */
+#define LWIP_MEMPROF                    1
+
+/* DHCP server and its lease table for a full soft AP cell (dhcps tests) */
+#define LWIP_DHCPS                      1
+#define DHCPS_MAX_LEASE                 2007
+#define DHCPS_DEBUG                     LWIP_DBG_OFF
+
 /* Minimal changes to opt.h required for etharp unit tests: */
 #define ETHARP_SUPPORT_STATIC_ENTRIES   1
 
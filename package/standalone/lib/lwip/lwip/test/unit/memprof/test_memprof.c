@@ -0,0 +1,619 @@
+#include "test_memprof.h"
+
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+#include "../tcp/tcp_helper.h"
+#include "arch/sys_arch.h"
+#include "lwip_memprof.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if !LWIP_MEMPROF || !LWIP_STATS || !MEM_STATS || !MEMP_STATS
+#error "This test needs LWIP_MEMPROF and the heap and pool statistics enabled"
+#endif
+
+/*
+ * Besides the profiler itself, this suite replays a traffic trace against
+ * the stack and fails if any heap or pool allocation failed. Built with the
+ * header of lib/lwip/tools/lwip_memprof.py, it validates the tuned sizes:
+ *
+ *   make CFLAGS+='-DLWIP_TUNED_OPTS=\"/path/to/lwipopts_tuned.h\"'
+ *   LWIP_MEMPROF_TRACE=capture.trace CK_RUN_SUITE=MEMPROF ./lwip_unittests
+ *
+ * Only this suite is meant to run with a tuned header: the others size the
+ * pools for their own needs. Without LWIP_MEMPROF_TRACE, the trace below is
+ * replayed. A trace is text, one event per line, ordered by time:
+ *
+ *   lwiptrace 1
+ *   <ms> <conn> open tcp|udp
+ *   <ms> <conn> rx <bytes>    the peer sends
+ *   <ms> <conn> tx <bytes>    the application writes
+ *   <ms> <conn> ack <bytes>   the peer acknowledges, TCP
+ *   <ms> <conn> close
+ *
+ * "lwip_memprof.py trace" turns a capture into one. The application is
+ * modelled as reading what has arrived each time the clock moves, so data
+ * received within the same millisecond stays queued in the stack, as it
+ * would while the application task waits for the CPU.
+ */
+
+#define REPLAY_CONNS      32
+#define REPLAY_CHUNK      2048
+
+struct replay_conn {
+  u8_t used;
+  u8_t udp;
+  struct tcp_pcb *tcp;
+  struct udp_pcb *udp_pcb;
+  u16_t port;
+  struct pbuf *rxq;           /* received, not read by the application yet */
+  u32_t rx_pending;           /* the peer has more to send */
+  u32_t tx_pending;           /* the application has more to write */
+  u32_t ack_pending;          /* the peer has more to acknowledge */
+};
+
+static struct replay_conn replay_conns[REPLAY_CONNS];
+static struct netif replay_netif;
+static struct netif *old_netif_list;
+static struct netif *old_netif_default;
+static u32_t replay_tmr;
+static u8_t replay_data[REPLAY_CHUNK];
+
+/* A few minutes of a sensor node: an MQTT-like session, a UDP uplink with
+ * replies, and a firmware download over a second TCP connection. Synthetic,
+ * to exercise the replay; real traces come from captures. */
+static const char replay_default_trace[] =
+  "lwiptrace 1\n"
+  "0 1 open tcp\n"
+  "0 1 tx 42\n"
+  "35 1 ack 42\n"
+  "35 1 rx 4\n"
+  "40 1 tx 64\n"
+  "80 1 ack 64\n"
+  "80 1 rx 5\n"
+  "100 2 open udp\n"
+  "100 2 tx 96\n"
+  "140 2 rx 96\n"
+  "1000 1 tx 180\n"
+  "1040 1 ack 180\n"
+  "1100 2 tx 96\n"
+  "1150 2 rx 96\n"
+  "1200 3 open tcp\n"
+  "1200 3 tx 220\n"
+  "1240 3 ack 220\n"
+  "1300 3 rx 4380\n"
+  "1310 3 rx 4380\n"
+  "1320 3 rx 4380\n"
+  "1330 1 rx 320\n"
+  "1330 3 rx 4380\n"
+  "1340 3 rx 4380\n"
+  "1350 3 rx 8760\n"
+  "1400 3 tx 2\n"
+  "1450 3 ack 2\n"
+  "1500 3 close\n"
+  "2000 1 tx 180\n"
+  "2000 2 tx 512\n"
+  "2040 1 ack 120\n"
+  "2060 2 rx 512\n"
+  "2300 1 ack 60\n"
+  "3000 1 tx 1460\n"
+  "3000 1 tx 1460\n"
+  "3000 1 tx 1460\n"
+  "3080 1 ack 2920\n"
+  "3120 1 ack 1460\n"
+  "3500 2 close\n"
+  "4000 1 tx 2\n"
+  "4040 1 ack 2\n"
+  "4100 1 close\n";
+
+/* Helper functions */
+static err_t
+replay_tcp_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  struct replay_conn *c = (struct replay_conn *)arg;
+
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    return ERR_OK;
+  }
+  if (c->rxq == NULL) {
+    c->rxq = p;
+  } else {
+    pbuf_cat(c->rxq, p);
+  }
+  return ERR_OK;
+}
+
+static void
+replay_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                const ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  replay_tcp_recv(arg, NULL, p, ERR_OK);
+}
+
+/* An rx segment, unless the pool is out: then the peer's packet is lost and
+ * the failure is in the statistics, which is what the replay checks */
+static struct pbuf *
+replay_tcp_segment(struct replay_conn *c, u16_t len, u32_t ackno_offset)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)(IP_HLEN + TCP_HLEN + len), PBUF_POOL);
+  if (p == NULL) {
+    return NULL;
+  }
+  pbuf_free(p);
+  return tcp_create_rx_segment(c->tcp, replay_data, len, 0, ackno_offset, TCP_ACK);
+}
+
+static void
+replay_udp_rx(struct replay_conn *c, u16_t len)
+{
+  struct udp_hdr *uh;
+  struct ip_hdr *ih;
+  struct pbuf *p;
+
+  p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_POOL);
+  if (p == NULL) {
+    return;
+  }
+  fail_unless(pbuf_add_header(p, sizeof(struct udp_hdr)) == 0);
+  uh = (struct udp_hdr *)p->payload;
+  uh->chksum = 0;
+  uh->src = lwip_htons(TEST_REMOTE_PORT);
+  uh->dest = lwip_htons(c->port);
+  uh->len = lwip_htons(p->tot_len);
+  fail_unless(pbuf_add_header(p, sizeof(struct ip_hdr)) == 0);
+  ih = (struct ip_hdr *)p->payload;
+  memset(ih, 0, sizeof(*ih));
+  ih->src.addr = ip_2_ip4(&test_remote_ip)->addr;
+  ih->dest.addr = ip_2_ip4(&test_local_ip)->addr;
+  ih->_len = lwip_htons(p->tot_len);
+  ih->_ttl = 32;
+  ih->_proto = IP_PROTO_UDP;
+  IPH_VHL_SET(ih, 4, sizeof(struct ip_hdr) / 4);
+  IPH_CHKSUM_SET(ih, inet_chksum(ih, sizeof(struct ip_hdr)));
+  fail_unless(ip4_input(p, &replay_netif) == ERR_OK);
+}
+
+static void
+replay_udp_tx(struct replay_conn *c, u16_t len)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+  if (p == NULL) {
+    return;
+  }
+  udp_sendto(c->udp_pcb, p, &test_remote_ip, TEST_REMOTE_PORT);
+  pbuf_free(p);
+}
+
+/* Let the peer send what the window allows, and the application write what
+ * the send buffer takes */
+static void
+replay_tcp_flush(struct replay_conn *c)
+{
+  struct pbuf *p;
+  u32_t n;
+
+  while (c->rx_pending > 0) {
+    n = LWIP_MIN(LWIP_MIN(c->rx_pending, TCP_MSS), c->tcp->rcv_wnd);
+    n = LWIP_MIN(n, REPLAY_CHUNK);
+    if (n == 0) {
+      break;
+    }
+    p = replay_tcp_segment(c, (u16_t)n, 0);
+    if (p == NULL) {
+      break;
+    }
+    test_tcp_input(p, &replay_netif);
+    c->rx_pending -= n;
+  }
+
+  n = c->tcp->snd_nxt - c->tcp->lastack;
+  n = LWIP_MIN(n, c->ack_pending);
+  if (n > 0) {
+    p = replay_tcp_segment(c, 0, n);
+    if (p != NULL) {
+      test_tcp_input(p, &replay_netif);
+      c->ack_pending -= n;
+    }
+  }
+
+  while (c->tx_pending > 0) {
+    n = LWIP_MIN(LWIP_MIN(c->tx_pending, tcp_sndbuf(c->tcp)), REPLAY_CHUNK);
+    if (n == 0 || tcp_write(c->tcp, replay_data, (u16_t)n, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+      break;
+    }
+    c->tx_pending -= n;
+  }
+  tcp_output(c->tcp);
+}
+
+/* The application reads everything received so far */
+static void
+replay_read(void)
+{
+  struct replay_conn *c;
+  int i;
+
+  for (i = 0; i < REPLAY_CONNS; i++) {
+    c = &replay_conns[i];
+    if (!c->used) {
+      continue;
+    }
+    if (c->rxq != NULL) {
+      if (!c->udp) {
+        tcp_recved(c->tcp, c->rxq->tot_len);
+      }
+      pbuf_free(c->rxq);
+      c->rxq = NULL;
+    }
+    if (!c->udp) {
+      replay_tcp_flush(c);
+    }
+  }
+}
+
+static void
+replay_time(u32_t ms)
+{
+  if (ms == lwip_sys_now) {
+    return;
+  }
+  replay_read();
+  while ((s32_t)(replay_tmr - ms) <= 0) {
+    lwip_sys_now = replay_tmr;
+    tcp_tmr();
+    replay_read();
+    replay_tmr += TCP_TMR_INTERVAL;
+  }
+  lwip_sys_now = ms;
+}
+
+static void
+replay_close(struct replay_conn *c)
+{
+  if (c->rxq != NULL) {
+    pbuf_free(c->rxq);
+  }
+  if (c->tcp != NULL) {
+    tcp_abort(c->tcp);
+  }
+  if (c->udp_pcb != NULL) {
+    udp_remove(c->udp_pcb);
+  }
+  memset(c, 0, sizeof(*c));
+}
+
+static int
+replay_open(struct replay_conn *c, int id, const char *proto)
+{
+  memset(c, 0, sizeof(*c));
+  c->port = (u16_t)(TEST_LOCAL_PORT + id);
+  if (strcmp(proto, "udp") == 0) {
+    c->udp = 1;
+    c->udp_pcb = udp_new();
+    if (c->udp_pcb == NULL) {
+      return 0;
+    }
+    fail_unless(udp_bind(c->udp_pcb, &test_local_ip, c->port) == ERR_OK);
+    udp_recv(c->udp_pcb, replay_udp_recv, c);
+  } else if (strcmp(proto, "tcp") == 0) {
+    c->tcp = tcp_new();
+    if (c->tcp == NULL) {
+      return 0;
+    }
+    tcp_set_state(c->tcp, ESTABLISHED, &test_local_ip, &test_remote_ip,
+                  c->port, (u16_t)(TEST_REMOTE_PORT + id));
+    c->tcp->snd_wnd = TCP_WND;
+    c->tcp->snd_wnd_max = TCP_WND;
+    tcp_arg(c->tcp, c);
+    tcp_recv(c->tcp, replay_tcp_recv);
+  } else {
+    return -1;
+  }
+  c->used = 1;
+  return 0;
+}
+
+/* Replay a trace, return the number of lines that were not understood */
+static int
+replay(const char *trace)
+{
+  struct replay_conn *c;
+  const char *line, *end;
+  char buf[80], op[8], arg[8];
+  unsigned long ms, last_ms = 0, len;
+  int id, n, bad = 0, header = 0;
+
+  for (line = trace; *line != '\0'; line = (*end != '\0') ? end + 1 : end) {
+    end = strchr(line, '\n');
+    if (end == NULL) {
+      end = line + strlen(line);
+    }
+    n = (int)LWIP_MIN((size_t)(end - line), sizeof(buf) - 1);
+    memcpy(buf, line, n);
+    buf[n] = '\0';
+    if (buf[0] == '#' || buf[0] == '\0' || buf[0] == '\r') {
+      continue;
+    }
+    if (!header) {
+      header = (strncmp(buf, "lwiptrace 1", 11) == 0);
+      if (!header) {
+        return -1;
+      }
+      continue;
+    }
+
+    arg[0] = '\0';
+    n = sscanf(buf, "%lu %d %7s %7s", &ms, &id, op, arg);
+    if (n < 3 || id < 0 || id >= REPLAY_CONNS || ms < last_ms) {
+      bad++;
+      continue;
+    }
+    last_ms = ms;
+    replay_time((u32_t)ms);
+
+    c = &replay_conns[id];
+    if (strcmp(op, "open") == 0) {
+      if (c->used) {
+        replay_close(c);
+      }
+      if (replay_open(c, id, arg) < 0) {
+        bad++;
+      }
+      continue;
+    }
+    if (!c->used) {
+      /* the PCB could not be allocated, or a line without "open" */
+      continue;
+    }
+    if (strcmp(op, "close") == 0) {
+      replay_close(c);
+      continue;
+    }
+    len = strtoul(arg, NULL, 10);
+    if (strcmp(op, "rx") == 0) {
+      if (c->udp) {
+        replay_udp_rx(c, (u16_t)LWIP_MIN(len, REPLAY_CHUNK));
+      } else {
+        c->rx_pending += len;
+      }
+    } else if (strcmp(op, "tx") == 0) {
+      if (c->udp) {
+        replay_udp_tx(c, (u16_t)LWIP_MIN(len, REPLAY_CHUNK));
+      } else {
+        c->tx_pending += len;
+      }
+    } else if (strcmp(op, "ack") == 0 && !c->udp) {
+      c->ack_pending += len;
+    } else {
+      bad++;
+      continue;
+    }
+    if (!c->udp) {
+      replay_tcp_flush(c);
+    }
+  }
+
+  /* let the last exchanges complete */
+  replay_time((u32_t)(last_ms + 1000));
+  return bad;
+}
+
+static char *
+replay_load(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  char *trace;
+  long size;
+
+  if (f == NULL) {
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  trace = (char *)malloc((size_t)size + 1);
+  if (trace != NULL) {
+    size = (long)fread(trace, 1, (size_t)size, f);
+    trace[size] = '\0';
+  }
+  fclose(f);
+  return trace;
+}
+
+static int dump_lines;
+static int dump_pools;
+static int dump_end;
+
+static void
+dump_check(const char *line, void *arg)
+{
+  LWIP_UNUSED_ARG(arg);
+  if (dump_lines++ == 0) {
+    fail_unless(strncmp(line, "LWIPPROF 1 ", 11) == 0);
+  }
+  if (strncmp(line, "POOL ", 5) == 0) {
+    dump_pools++;
+  }
+  if (strncmp(line, "POOL UDP_PCB ", 13) == 0) {
+    fail_unless(strstr(line, " 3 0") != NULL);  /* <max> <err> */
+  }
+  dump_end = (strcmp(line, "END") == 0);
+}
+
+/* Setups/teardown functions */
+static void
+memprof_setup(void)
+{
+  old_netif_list = netif_list;
+  old_netif_default = netif_default;
+  netif_list = NULL;
+  netif_default = NULL;
+  test_tcp_init_netif(&replay_netif, NULL, &test_local_ip, &test_netmask);
+  memset(replay_conns, 0, sizeof(replay_conns));
+  lwip_sys_now = 0;
+  replay_tmr = TCP_TMR_INTERVAL;
+  tcp_remove_all();
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+  lwip_memprof_reset();
+}
+
+static void
+memprof_teardown(void)
+{
+  int i;
+
+  for (i = 0; i < REPLAY_CONNS; i++) {
+    if (replay_conns[i].used) {
+      replay_close(&replay_conns[i]);
+    }
+  }
+  tcp_remove_all();
+  netif_list = old_netif_list;
+  netif_default = old_netif_default;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+/* Test functions */
+START_TEST(test_memprof_reset)
+{
+  struct lwip_memprof prof;
+  struct udp_pcb *pcb[3];
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < 3; i++) {
+    pcb[i] = udp_new();
+    fail_unless(pcb[i] != NULL);
+  }
+  udp_remove(pcb[1]);
+  udp_remove(pcb[2]);
+
+  lwip_memprof_get(&prof);
+  fail_unless(strcmp(prof.pool[MEMP_UDP_PCB].name, "UDP_PCB") == 0);
+  fail_unless(prof.pool[MEMP_UDP_PCB].num == MEMP_NUM_UDP_PCB);
+  fail_unless(prof.pool[MEMP_UDP_PCB].used == 1);
+  fail_unless(prof.pool[MEMP_UDP_PCB].max == 3);
+  fail_unless(prof.heap.num == MEM_SIZE);
+
+  /* the new window starts from what is in use */
+  lwip_sys_now = 1000;
+  lwip_memprof_reset();
+  lwip_sys_now = 1500;
+  lwip_memprof_get(&prof);
+  fail_unless(prof.pool[MEMP_UDP_PCB].max == 1);
+  fail_unless(prof.window_ms == 500);
+
+  udp_remove(pcb[0]);
+}
+END_TEST
+
+START_TEST(test_memprof_err)
+{
+  struct lwip_memprof prof;
+  struct udp_pcb *pcb[MEMP_NUM_UDP_PCB + 1];
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < MEMP_NUM_UDP_PCB; i++) {
+    pcb[i] = udp_new();
+    fail_unless(pcb[i] != NULL);
+  }
+  pcb[i] = udp_new();
+  fail_unless(pcb[i] == NULL);
+
+  lwip_memprof_get(&prof);
+  fail_unless(prof.pool[MEMP_UDP_PCB].max == MEMP_NUM_UDP_PCB);
+  fail_unless(prof.pool[MEMP_UDP_PCB].err == 1);
+
+  for (i = 0; i < MEMP_NUM_UDP_PCB; i++) {
+    udp_remove(pcb[i]);
+  }
+  lwip_memprof_reset();
+  lwip_memprof_get(&prof);
+  fail_unless(prof.pool[MEMP_UDP_PCB].max == 0);
+  fail_unless(prof.pool[MEMP_UDP_PCB].err == 0);
+}
+END_TEST
+
+START_TEST(test_memprof_dump)
+{
+  struct udp_pcb *pcb[3];
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < 3; i++) {
+    pcb[i] = udp_new();
+    fail_unless(pcb[i] != NULL);
+  }
+  for (i = 0; i < 3; i++) {
+    udp_remove(pcb[i]);
+  }
+
+  dump_lines = dump_pools = dump_end = 0;
+  lwip_memprof_dump(dump_check, NULL);
+  fail_unless(dump_pools == MEMP_MAX);
+  fail_unless(dump_end);
+}
+END_TEST
+
+/* Replay the trace, no allocation may fail */
+START_TEST(test_memprof_replay)
+{
+  struct lwip_memprof prof;
+  const char *path = getenv("LWIP_MEMPROF_TRACE");
+  char *trace = NULL;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  if (path != NULL) {
+    trace = replay_load(path);
+    fail_unless(trace != NULL, "cannot read %s", path);
+    if (trace == NULL) {
+      return;
+    }
+  }
+  fail_unless(replay(trace != NULL ? trace : replay_default_trace) == 0);
+  free(trace);
+
+  lwip_memprof_get(&prof);
+  printf("memprof replay over %u ms, %s\n", (unsigned)prof.window_ms,
+         path != NULL ? path : "built-in trace");
+  printf("  %-16s %6u of %6u, %u failed\n", prof.heap.name, (unsigned)prof.heap.max,
+         (unsigned)prof.heap.num, (unsigned)prof.heap.err);
+  fail_unless(prof.heap.err == 0, "MEM_SIZE: %u allocations failed", (unsigned)prof.heap.err);
+  for (i = 0; i < MEMP_MAX; i++) {
+    if (prof.pool[i].max == 0 && prof.pool[i].err == 0) {
+      continue;
+    }
+    printf("  %-16s %6u of %6u, %u failed\n", prof.pool[i].name, (unsigned)prof.pool[i].max,
+           (unsigned)prof.pool[i].num, (unsigned)prof.pool[i].err);
+    fail_unless(prof.pool[i].err == 0, "%s: %u allocations failed", prof.pool[i].name,
+                (unsigned)prof.pool[i].err);
+  }
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+memprof_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_memprof_reset),
+    TESTFUNC(test_memprof_err),
+    TESTFUNC(test_memprof_dump),
+    TESTFUNC(test_memprof_replay)
+  };
+  return create_suite("MEMPROF", tests, sizeof(tests)/sizeof(testfunc), memprof_setup, memprof_teardown);
+}
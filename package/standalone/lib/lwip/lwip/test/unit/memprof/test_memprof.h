@@ -0,0 +1,8 @@
+#ifndef LWIP_HDR_TEST_MEMPROF_H
+#define LWIP_HDR_TEST_MEMPROF_H
+
+#include "../lwip_check.h"
+
+Suite* memprof_suite(void);
+
+#endif
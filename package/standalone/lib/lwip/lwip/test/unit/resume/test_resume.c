@@ -0,0 +1,336 @@
+#include "test_resume.h"
+
+#include "lwip/udp.h"
+#include "lwip/dhcp.h"
+#include "lwip/etharp.h"
+#include "lwip/prot/dhcp.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/etharp.h"
+#include "netif/ethernet.h"
+#include "lwip_resume.h"
+
+#include <string.h>
+#include <time.h>
+
+#if !LWIP_RESUME || !LWIP_DHCP
+#error "This test needs LWIP_RESUME and DHCP enabled"
+#endif
+
+#define RESTORE_LOOPS 1000
+
+static struct netif test_netif;
+static struct eth_addr test_hwaddr = {{0x00,0x23,0x45,0x67,0x89,0xab}};
+static struct eth_addr gw_ethaddr = {{0x02,0x00,0x00,0x00,0x00,0x01}};
+static struct eth_addr peer_ethaddr = {{0x02,0x00,0x00,0x00,0x00,0x32}};
+static ip4_addr_t test_ipaddr, test_netmask, test_gw, test_peer;
+static struct dhcp_lease test_lease;
+static u8_t snapshot[LWIP_RESUME_SIZE_MAX];
+
+static int linkoutput_ctr;
+static struct eth_hdr last_ethhdr;
+
+/* Helper functions */
+/* Count the frames sent, except gratuitous ARPs: they are announcements, not
+ * round trips, and the port skips them on a wakeup from retention anyway */
+static err_t
+resume_netif_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  struct etharp_hdr arphdr;
+  struct eth_hdr ethhdr;
+
+  fail_unless(netif == &test_netif);
+  fail_unless(p != NULL);
+  fail_unless(pbuf_copy_partial(p, &ethhdr, sizeof(ethhdr), 0) == sizeof(ethhdr));
+  if (ethhdr.type == PP_HTONS(ETHTYPE_ARP) &&
+      pbuf_copy_partial(p, &arphdr, sizeof(arphdr), SIZEOF_ETH_HDR) == sizeof(arphdr) &&
+      memcmp(&arphdr.sipaddr, &arphdr.dipaddr, sizeof(arphdr.sipaddr)) == 0) {
+    return ERR_OK;
+  }
+  last_ethhdr = ethhdr;
+  linkoutput_ctr++;
+  return ERR_OK;
+}
+
+static err_t
+resume_netif_init(struct netif *netif)
+{
+  fail_unless(netif != NULL);
+  netif->linkoutput = resume_netif_linkoutput;
+  netif->output = etharp_output;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  SMEMCPY(netif->hwaddr, test_hwaddr.addr, ETH_HWADDR_LEN);
+  return ERR_OK;
+}
+
+/* Forget everything a deep sleep loses */
+static void
+resume_power_cycle(void)
+{
+  dhcp_stop(&test_netif);
+  dhcp_cleanup(&test_netif);
+  etharp_cleanup_netif(&test_netif);
+  netif_set_addr(&test_netif, IP4_ADDR_ANY4, IP4_ADDR_ANY4, IP4_ADDR_ANY4);
+  linkoutput_ctr = 0;
+}
+
+/* Bind a lease, learn the gateway and a peer, open a connected UDP PCB and
+ * take a snapshot after 'used' coarse timer ticks */
+static int
+resume_take_snapshot(u16_t used, struct udp_pcb **pcb)
+{
+  ip_addr_t peer;
+  int len;
+  u16_t i;
+
+  fail_unless(dhcp_restore_lease(&test_netif, &test_lease, 0) == ERR_OK);
+  fail_unless(etharp_restore_entry(&test_netif, &test_gw, &gw_ethaddr) == ERR_OK);
+  fail_unless(etharp_restore_entry(&test_netif, &test_peer, &peer_ethaddr) == ERR_OK);
+
+  *pcb = udp_new();
+  fail_unless(*pcb != NULL);
+  ip_addr_copy_from_ip4(peer, test_peer);
+  fail_unless(udp_bind(*pcb, IP4_ADDR_ANY, 40000) == ERR_OK);
+  fail_unless(udp_connect(*pcb, &peer, 5683) == ERR_OK);
+
+  for (i = 0; i < used; i++) {
+    dhcp_coarse_tmr();
+  }
+
+  len = lwip_resume_save(&test_netif, snapshot, sizeof(snapshot));
+  fail_unless(len > 0);
+  return len;
+}
+
+/* Setups/teardown functions */
+
+static void
+resume_setup(void)
+{
+  IP4_ADDR(&test_ipaddr, 192,168,4,23);
+  IP4_ADDR(&test_netmask, 255,255,255,0);
+  IP4_ADDR(&test_gw, 192,168,4,1);
+  IP4_ADDR(&test_peer, 192,168,4,50);
+
+  memset(&test_lease, 0, sizeof(test_lease));
+  ip4_addr_copy(test_lease.ip_addr, test_ipaddr);
+  ip4_addr_copy(test_lease.netmask, test_netmask);
+  ip4_addr_copy(test_lease.gw, test_gw);
+  ip4_addr_copy(test_lease.server, test_gw);
+  test_lease.t0_lease = 3600;
+  test_lease.t1_renew = 1800;
+  test_lease.t2_rebind = 3150;
+
+  fail_unless(netif_default == NULL);
+  netif_set_default(netif_add(&test_netif, NULL, NULL, NULL, NULL, resume_netif_init, ethernet_input));
+  netif_set_up(&test_netif);
+  linkoutput_ctr = 0;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+static void
+resume_teardown(void)
+{
+  dhcp_stop(&test_netif);
+  dhcp_cleanup(&test_netif);
+  etharp_cleanup_netif(&test_netif);
+  netif_remove(&test_netif);
+  netif_set_default(NULL);
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+
+/* Test functions */
+
+START_TEST(test_resume_round_trip)
+{
+  struct lwip_resume_info info;
+  struct udp_pcb *pcb;
+  struct pbuf *p;
+  ip_addr_t peer;
+  int len;
+  LWIP_UNUSED_ARG(_i);
+
+  /* 20 minutes of the lease used before the sleep */
+  len = resume_take_snapshot(20, &pcb);
+  fail_unless(len == 52 + 2 * 10 + 1 * 12);
+  fail_unless(snapshot[0] == 'L' && snapshot[1] == 'R');
+  fail_unless(snapshot[2] == LWIP_RESUME_VERSION);
+  udp_remove(pcb);
+  resume_power_cycle();
+  fail_unless(lwip_resume_udp_port(IP4_ADDR_ANY, 5683) == 0);
+
+  /* 10 minutes of deep sleep */
+  fail_unless(lwip_resume_restore(&test_netif, snapshot, (u16_t)len, 600, &info) == ERR_OK);
+  fail_unless(info.dhcp == 1);
+  fail_unless(info.arp == 2);
+  fail_unless(info.udp == 1);
+  fail_unless(info.lease_left == 3600 - 1200 - 600);
+
+  /* bound without a single frame */
+  fail_unless(linkoutput_ctr == 0);
+  fail_unless(dhcp_supplied_address(&test_netif));
+  fail_unless(netif_dhcp_data(&test_netif)->state == DHCP_STATE_BOUND);
+  fail_unless(ip4_addr_cmp(netif_ip4_addr(&test_netif), &test_ipaddr));
+  fail_unless(ip4_addr_cmp(netif_ip4_netmask(&test_netif), &test_netmask));
+  fail_unless(ip4_addr_cmp(netif_ip4_gw(&test_netif), &test_gw));
+
+  /* the flow keeps its local port */
+  ip_addr_copy_from_ip4(peer, test_peer);
+  fail_unless(lwip_resume_udp_port(&peer, 5683) == 40000);
+  fail_unless(lwip_resume_udp_port(&peer, 5684) == 0);
+
+  /* the first packet goes out without an ARP request */
+  pcb = udp_new();
+  fail_unless(pcb != NULL);
+  fail_unless(udp_bind(pcb, IP4_ADDR_ANY, lwip_resume_udp_port(&peer, 5683)) == ERR_OK);
+  fail_unless(udp_connect(pcb, &peer, 5683) == ERR_OK);
+  p = pbuf_alloc(PBUF_TRANSPORT, 16, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless(udp_send(pcb, p) == ERR_OK);
+  pbuf_free(p);
+  fail_unless(linkoutput_ctr == 1);
+  fail_unless(last_ethhdr.type == PP_HTONS(ETHTYPE_IP));
+  fail_unless(memcmp(&last_ethhdr.dest, &peer_ethaddr, ETH_HWADDR_LEN) == 0);
+  udp_remove(pcb);
+}
+END_TEST
+
+START_TEST(test_resume_renew)
+{
+  struct lwip_resume_info info;
+  struct udp_pcb *pcb;
+  int len;
+  LWIP_UNUSED_ARG(_i);
+
+  len = resume_take_snapshot(0, &pcb);
+  udp_remove(pcb);
+  resume_power_cycle();
+
+  /* slept past T1: still bound, renewed at the next tick */
+  fail_unless(lwip_resume_restore(&test_netif, snapshot, (u16_t)len, 2000, &info) == ERR_OK);
+  fail_unless(info.lease_left == 1600);
+  fail_unless(netif_dhcp_data(&test_netif)->state == DHCP_STATE_BOUND);
+  fail_unless(linkoutput_ctr == 0);
+
+  dhcp_coarse_tmr();
+  fail_unless(netif_dhcp_data(&test_netif)->state == DHCP_STATE_RENEWING);
+  /* unicast to the server, its ARP entry was restored too */
+  fail_unless(linkoutput_ctr == 1);
+  fail_unless(memcmp(&last_ethhdr.dest, &gw_ethaddr, ETH_HWADDR_LEN) == 0);
+}
+END_TEST
+
+START_TEST(test_resume_expired)
+{
+  struct udp_pcb *pcb;
+  int len;
+  LWIP_UNUSED_ARG(_i);
+
+  len = resume_take_snapshot(10, &pcb);
+  udp_remove(pcb);
+  resume_power_cycle();
+
+  fail_unless(lwip_resume_restore(&test_netif, snapshot, (u16_t)len, 3000, NULL) == ERR_TIMEOUT);
+  fail_unless(ip4_addr_isany_val(*netif_ip4_addr(&test_netif)));
+  fail_unless(!dhcp_supplied_address(&test_netif));
+  fail_unless(lwip_resume_udp_port(IP4_ADDR_ANY, 5683) == 0);
+}
+END_TEST
+
+START_TEST(test_resume_reject)
+{
+  u8_t bad[LWIP_RESUME_SIZE_MAX];
+  struct udp_pcb *pcb;
+  int len;
+  LWIP_UNUSED_ARG(_i);
+
+  len = resume_take_snapshot(0, &pcb);
+  udp_remove(pcb);
+  resume_power_cycle();
+
+  /* damaged */
+  memcpy(bad, snapshot, sizeof(bad));
+  bad[20] ^= 0x01;
+  fail_unless(lwip_resume_restore(&test_netif, bad, (u16_t)len, 0, NULL) == ERR_VAL);
+
+  /* another version */
+  memcpy(bad, snapshot, sizeof(bad));
+  bad[2]++;
+  fail_unless(lwip_resume_restore(&test_netif, bad, (u16_t)len, 0, NULL) == ERR_VAL);
+
+  /* truncated */
+  fail_unless(lwip_resume_restore(&test_netif, snapshot, (u16_t)(len - 1), 0, NULL) == ERR_VAL);
+
+  /* another netif */
+  test_netif.hwaddr[5]++;
+  fail_unless(lwip_resume_restore(&test_netif, snapshot, (u16_t)len, 0, NULL) == ERR_VAL);
+  test_netif.hwaddr[5]--;
+
+  fail_unless(ip4_addr_isany_val(*netif_ip4_addr(&test_netif)));
+  fail_unless(linkoutput_ctr == 0);
+
+  /* the original is fine */
+  fail_unless(lwip_resume_restore(&test_netif, snapshot, (u16_t)len, 0, NULL) == ERR_OK);
+}
+END_TEST
+
+START_TEST(test_resume_static)
+{
+  struct lwip_resume_info info;
+  int len;
+  LWIP_UNUSED_ARG(_i);
+
+  netif_set_addr(&test_netif, &test_ipaddr, &test_netmask, &test_gw);
+  len = lwip_resume_save(&test_netif, snapshot, sizeof(snapshot));
+  fail_unless(len == 52);
+  resume_power_cycle();
+
+  fail_unless(lwip_resume_restore(&test_netif, snapshot, (u16_t)len, 100000, &info) == ERR_OK);
+  fail_unless(info.dhcp == 0);
+  fail_unless(netif_dhcp_data(&test_netif) == NULL);
+  fail_unless(ip4_addr_cmp(netif_ip4_addr(&test_netif), &test_ipaddr));
+}
+END_TEST
+
+START_TEST(test_resume_time)
+{
+  struct udp_pcb *pcb;
+  clock_t start;
+  double us;
+  int len, i;
+  LWIP_UNUSED_ARG(_i);
+
+  len = resume_take_snapshot(0, &pcb);
+  udp_remove(pcb);
+
+  start = clock();
+  for (i = 0; i < RESTORE_LOOPS; i++) {
+    resume_power_cycle();
+    fail_unless(lwip_resume_restore(&test_netif, snapshot, (u16_t)len, 60, NULL) == ERR_OK);
+  }
+  us = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC / RESTORE_LOOPS;
+  /* includes the power cycle, an upper bound of the restore */
+  printf("resume: %d byte snapshot restored in %.2f us\n", len, us);
+
+  /* far below one DHCP round trip */
+  fail_unless(us < 1000);
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+resume_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_resume_round_trip),
+    TESTFUNC(test_resume_renew),
+    TESTFUNC(test_resume_expired),
+    TESTFUNC(test_resume_reject),
+    TESTFUNC(test_resume_static),
+    TESTFUNC(test_resume_time)
+  };
+  return create_suite("RESUME", tests, sizeof(tests)/sizeof(testfunc), resume_setup, resume_teardown);
+}
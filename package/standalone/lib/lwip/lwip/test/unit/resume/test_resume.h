@@ -0,0 +1,8 @@
+#ifndef LWIP_HDR_TEST_RESUME_H
+#define LWIP_HDR_TEST_RESUME_H
+
+#include "../lwip_check.h"
+
+Suite* resume_suite(void);
+
+#endif
@@ -0,0 +1,388 @@
+#include "tcp_link.h"
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/ip4.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+
+#include <string.h>
+
+#define TCP_LINK_PORT 7000
+
+struct tcp_link_pkt {
+  struct tcp_link_pkt *next;
+  struct pbuf *p;
+  u32_t deliver_us;
+};
+
+static const ip4_addr_t *
+tcp_link_ip(u8_t dir)
+{
+  static ip4_addr_t ip[2];
+
+  IP4_ADDR(&ip[TCP_LINK_A], 10, 0, 0, 1);
+  IP4_ADDR(&ip[TCP_LINK_B], 10, 0, 0, 2);
+  return &ip[dir];
+}
+
+u32_t
+tcp_link_rand(struct tcp_link *link)
+{
+  link->seed = link->seed * 1103515245UL + 12345UL;
+  return (link->seed >> 16) & 0x7fff;
+}
+
+/** The start of the next up period of a duty-cycled direction */
+static u32_t
+tcp_link_up_us(const struct tcp_link_dir *d, u32_t us)
+{
+  u32_t period, at;
+
+  if (d->off_ms == 0) {
+    return us;
+  }
+  period = (d->on_ms + d->off_ms) * 1000;
+  at = us % period;
+  if (at < d->on_ms * 1000) {
+    return us;
+  }
+  return us - at + period;
+}
+
+static void
+tcp_link_count(struct tcp_link *link, u8_t dir, struct pbuf *p, u32_t *seqno, u16_t *len)
+{
+  struct ip_hdr iphdr;
+  struct tcp_hdr tcphdr;
+  u16_t iphlen;
+
+  *seqno = 0;
+  *len = 0;
+  if (pbuf_copy_partial(p, &iphdr, sizeof(iphdr), 0) != sizeof(iphdr) ||
+      IPH_PROTO(&iphdr) != IP_PROTO_TCP) {
+    return;
+  }
+  iphlen = (u16_t)(IPH_HL_BYTES(&iphdr));
+  if (pbuf_copy_partial(p, &tcphdr, sizeof(tcphdr), iphlen) != sizeof(tcphdr)) {
+    return;
+  }
+  *seqno = lwip_ntohl(tcphdr.seqno);
+  *len = (u16_t)(lwip_ntohs(IPH_LEN(&iphdr)) - iphlen - TCPH_HDRLEN_BYTES(&tcphdr));
+  link->data_bytes[dir] += *len;
+}
+
+static err_t
+tcp_link_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  struct tcp_link *link = (struct tcp_link *)netif->state;
+  u8_t dir = (netif == &link->netif[TCP_LINK_A]) ? TCP_LINK_A : TCP_LINK_B;
+  struct tcp_link_dir *d = &link->dir[dir];
+  struct tcp_link_pkt *pkt, **pp;
+  u32_t now_us = sys_now() * 1000;
+  u32_t start_us, seqno;
+  u16_t len, queued = 0;
+  LWIP_UNUSED_ARG(ipaddr);
+
+  link->sent[dir]++;
+  tcp_link_count(link, dir, p, &seqno, &len);
+
+  for (pkt = link->pkts[dir]; pkt != NULL; pkt = pkt->next) {
+    if (pkt->deliver_us - d->delay * 1000 > now_us) {
+      queued++;
+    }
+  }
+  if ((d->queue != 0 && queued >= d->queue) ||
+      (d->loss != 0 && tcp_link_rand(link) % 10000 < d->loss) ||
+      (link->drop != NULL && link->drop(link->drop_arg, dir, seqno, len))) {
+    link->dropped[dir]++;
+    return ERR_OK;
+  }
+
+  pkt = (struct tcp_link_pkt *)calloc(1, sizeof(*pkt));
+  EXPECT_RETX(pkt != NULL, ERR_MEM);
+  pkt->p = pbuf_clone(PBUF_RAW, PBUF_POOL, p);
+  if (pkt->p == NULL) {
+    free(pkt);
+    link->dropped[dir]++;
+    return ERR_OK;
+  }
+
+  /* wait for the sender, then for the link to be up */
+  start_us = LWIP_MAX(now_us, link->busy_us[dir]);
+  start_us = tcp_link_up_us(d, start_us);
+  if (d->rate != 0) {
+    start_us += (u32_t)((u64_t)p->tot_len * 1000000 / d->rate);
+  }
+  link->busy_us[dir] = start_us;
+  pkt->deliver_us = start_us + d->delay * 1000;
+  if (d->reorder != 0 && tcp_link_rand(link) % 10000 < d->reorder) {
+    pkt->deliver_us += d->reorder_delay * 1000;
+  }
+  if (link->hold != NULL) {
+    pkt->deliver_us += link->hold(link->hold_arg, dir, seqno, len) * 1000;
+  }
+
+  for (pp = &link->pkts[dir]; *pp != NULL && (*pp)->deliver_us <= pkt->deliver_us; pp = &(*pp)->next);
+  pkt->next = *pp;
+  *pp = pkt;
+  return ERR_OK;
+}
+
+static err_t
+tcp_link_netif_init(struct netif *netif)
+{
+  netif->output = tcp_link_output;
+  netif->mtu = 1500;
+  return ERR_OK;
+}
+
+void
+tcp_link_init(struct tcp_link *link, u32_t seed)
+{
+  u8_t i;
+
+  memset(link, 0, sizeof(*link));
+  link->seed = seed;
+  for (i = 0; i < 2; i++) {
+    ip4_addr_t mask;
+
+    IP4_ADDR(&mask, 255, 255, 255, 0);
+    netif_add(&link->netif[i], tcp_link_ip(i), &mask, IP4_ADDR_ANY4, link,
+              tcp_link_netif_init, ip4_input);
+    netif_set_up(&link->netif[i]);
+    netif_set_link_up(&link->netif[i]);
+  }
+}
+
+void
+tcp_link_free(struct tcp_link *link)
+{
+  u8_t i;
+
+  for (i = 0; i < 2; i++) {
+    while (link->pkts[i] != NULL) {
+      struct tcp_link_pkt *pkt = link->pkts[i];
+
+      link->pkts[i] = pkt->next;
+      pbuf_free(pkt->p);
+      free(pkt);
+    }
+    netif_remove(&link->netif[i]);
+  }
+}
+
+void
+tcp_link_step(struct tcp_link *link)
+{
+  u8_t i;
+  u32_t now_us;
+
+  lwip_sys_now++;
+  now_us = lwip_sys_now * 1000;
+  for (i = 0; i < 2; i++) {
+    /* a packet is delivered to the other end */
+    while (link->pkts[i] != NULL && link->pkts[i]->deliver_us <= now_us) {
+      struct tcp_link_pkt *pkt = link->pkts[i];
+
+      link->pkts[i] = pkt->next;
+      ip4_input(pkt->p, &link->netif[i ^ 1]);
+      free(pkt);
+    }
+  }
+  if (lwip_sys_now % TCP_TMR_INTERVAL == 0) {
+    tcp_tmr();
+  }
+}
+
+/* The byte at offset i of a transfer */
+#define TCP_LINK_BYTE(i) ((u8_t)((i) * 7 + ((i) >> 9)))
+
+static void
+tcp_link_xfer_write(struct tcp_link_xfer *xfer)
+{
+  u8_t buf[512];
+
+  while (xfer->written < xfer->total) {
+    u16_t len = (u16_t)LWIP_MIN(sizeof(buf), xfer->total - xfer->written);
+    u16_t i;
+
+    len = LWIP_MIN(len, tcp_sndbuf(xfer->tx));
+    if (len == 0 || tcp_sndqueuelen(xfer->tx) >= TCP_SND_QUEUELEN - 2) {
+      break;
+    }
+    for (i = 0; i < len; i++) {
+      buf[i] = TCP_LINK_BYTE(xfer->written + i);
+    }
+    if (tcp_write(xfer->tx, buf, len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+      break;
+    }
+    xfer->written += len;
+  }
+  tcp_output(xfer->tx);
+}
+
+static err_t
+tcp_link_xfer_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(len);
+  tcp_link_xfer_write((struct tcp_link_xfer *)arg);
+  return ERR_OK;
+}
+
+static err_t
+tcp_link_xfer_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  struct tcp_link_xfer *xfer = (struct tcp_link_xfer *)arg;
+  struct pbuf *q;
+  LWIP_UNUSED_ARG(err);
+
+  if (p == NULL) {
+    return ERR_OK;
+  }
+  for (q = p; q != NULL; q = q->next) {
+    const u8_t *data = (const u8_t *)q->payload;
+    u16_t i;
+
+    for (i = 0; i < q->len; i++) {
+      if (data[i] != TCP_LINK_BYTE(xfer->received + i)) {
+        xfer->corrupt = 1;
+      }
+    }
+    xfer->received += q->len;
+  }
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  if (xfer->received >= xfer->total && xfer->done_ms == 0) {
+    xfer->done_ms = sys_now();
+  }
+  return ERR_OK;
+}
+
+static void
+tcp_link_xfer_err(void *arg, err_t err)
+{
+  struct tcp_link_xfer *xfer = (struct tcp_link_xfer *)arg;
+  LWIP_UNUSED_ARG(err);
+
+  /* the pcbs are freed */
+  xfer->error = 1;
+  xfer->tx = NULL;
+  xfer->rx = NULL;
+}
+
+static err_t
+tcp_link_xfer_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  struct tcp_link_xfer *xfer = (struct tcp_link_xfer *)arg;
+  LWIP_UNUSED_ARG(err);
+
+  xfer->rx = pcb;
+  tcp_arg(pcb, xfer);
+  tcp_recv(pcb, tcp_link_xfer_recv);
+  tcp_err(pcb, tcp_link_xfer_err);
+  return ERR_OK;
+}
+
+static err_t
+tcp_link_xfer_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(err);
+  return ERR_OK;
+}
+
+int
+tcp_link_xfer_open(struct tcp_link_xfer *xfer, struct tcp_link *link, u32_t total)
+{
+  struct tcp_pcb *pcb;
+  ip_addr_t ip;
+  err_t err;
+  u32_t i;
+
+  memset(xfer, 0, sizeof(*xfer));
+  xfer->link = link;
+  xfer->total = total;
+
+  pcb = tcp_new();
+  EXPECT_RETX(pcb != NULL, -1);
+  ip_addr_copy_from_ip4(ip, *tcp_link_ip(TCP_LINK_B));
+  tcp_bind_netif(pcb, &link->netif[TCP_LINK_B]);
+  err = tcp_bind(pcb, &ip, TCP_LINK_PORT);
+  EXPECT_RETX(err == ERR_OK, -1);
+  xfer->listener = tcp_listen(pcb);
+  EXPECT_RETX(xfer->listener != NULL, -1);
+  tcp_arg(xfer->listener, xfer);
+  tcp_accept(xfer->listener, tcp_link_xfer_accept);
+
+  xfer->tx = tcp_new();
+  EXPECT_RETX(xfer->tx != NULL, -1);
+  tcp_bind_netif(xfer->tx, &link->netif[TCP_LINK_A]);
+  tcp_arg(xfer->tx, xfer);
+  tcp_sent(xfer->tx, tcp_link_xfer_sent);
+  tcp_err(xfer->tx, tcp_link_xfer_err);
+  err = tcp_connect(xfer->tx, &ip, TCP_LINK_PORT, tcp_link_xfer_connected);
+  EXPECT_RETX(err == ERR_OK, -1);
+
+  for (i = 0; i < 10000 && (xfer->rx == NULL || xfer->tx->state != ESTABLISHED); i++) {
+    tcp_link_step(link);
+    if (xfer->error) {
+      return -1;
+    }
+  }
+  EXPECT_RETX(xfer->rx != NULL && xfer->tx->state == ESTABLISHED, -1);
+  return 0;
+}
+
+int
+tcp_link_xfer_run(struct tcp_link_xfer *xfer, u32_t timeout_ms)
+{
+  u32_t end = sys_now() + timeout_ms;
+
+  xfer->start_ms = sys_now();
+  tcp_link_xfer_write(xfer);
+  while (xfer->done_ms == 0 && !xfer->error && (s32_t)(sys_now() - end) < 0) {
+    tcp_link_step(xfer->link);
+    if (xfer->tx != NULL && xfer->written < xfer->total) {
+      tcp_link_xfer_write(xfer);
+    }
+  }
+  return (xfer->done_ms != 0 && !xfer->corrupt) ? 0 : -1;
+}
+
+void
+tcp_link_xfer_close(struct tcp_link_xfer *xfer)
+{
+  if (xfer->tx != NULL) {
+    tcp_arg(xfer->tx, NULL);
+    tcp_sent(xfer->tx, NULL);
+    tcp_err(xfer->tx, NULL);
+    tcp_abort(xfer->tx);
+  }
+  if (xfer->rx != NULL) {
+    tcp_arg(xfer->rx, NULL);
+    tcp_recv(xfer->rx, NULL);
+    tcp_err(xfer->rx, NULL);
+    tcp_abort(xfer->rx);
+  }
+  if (xfer->listener != NULL) {
+    tcp_close(xfer->listener);
+  }
+  /* tcp_link_free() drops the RSTs and what is still on the link:
+     delivered to no pcb, it would be answered through the loopback */
+  memset(xfer, 0, sizeof(*xfer));
+}
+
+u32_t
+tcp_link_xfer_goodput(const struct tcp_link_xfer *xfer)
+{
+  u32_t ms = xfer->done_ms - xfer->start_ms;
+
+  if (xfer->done_ms == 0) {
+    return 0;
+  }
+  return (u32_t)((u64_t)xfer->received * 1000 / LWIP_MAX(ms, 1));
+}
@@ -0,0 +1,84 @@
+#ifndef LWIP_HDR_TCP_LINK_H
+#define LWIP_HDR_TCP_LINK_H
+
+#include "../lwip_check.h"
+#include "lwip/arch.h"
+#include "lwip/tcp.h"
+#include "lwip/netif.h"
+
+/*
+ * Two netifs, A (10.0.0.1) and B (10.0.0.2), joined by a simulated link,
+ * and a bulk transfer from a pcb bound to A to a pcb bound to B.
+ *
+ * Time is simulated: tcp_link_step() advances lwip_sys_now by 1 ms,
+ * delivers the packets due and runs tcp_tmr() every TCP_TMR_INTERVAL.
+ * Losses come from a seeded generator, so that a run can be repeated.
+ */
+
+#define TCP_LINK_A 0
+#define TCP_LINK_B 1
+
+/** One direction of the link */
+struct tcp_link_dir {
+  u32_t rate;           /* bytes per second, 0: no serialization delay */
+  u32_t delay;          /* propagation delay, ms */
+  u16_t loss;           /* random loss, per 10000 packets */
+  u16_t reorder;        /* packets delayed by reorder_delay, per 10000 */
+  u32_t reorder_delay;  /* ms */
+  u32_t on_ms;          /* duty cycle: the link is up on_ms, */
+  u32_t off_ms;         /* then down off_ms; 0: always up */
+  u16_t queue;          /* packets waiting to be sent, tail drop above */
+};
+
+struct tcp_link_pkt;
+
+/** Called for every packet sent, return 1 to drop it */
+typedef u8_t (*tcp_link_drop_fn)(void *arg, u8_t dir, u32_t seqno, u16_t len);
+/** Called for every packet not dropped, return the ms to hold it back by */
+typedef u32_t (*tcp_link_hold_fn)(void *arg, u8_t dir, u32_t seqno, u16_t len);
+
+struct tcp_link {
+  struct netif netif[2];
+  struct tcp_link_dir dir[2];
+  struct tcp_link_pkt *pkts[2];   /* by delivery time */
+  u32_t busy_us[2];               /* the sender is busy until */
+  u32_t seed;
+  tcp_link_drop_fn drop;
+  void *drop_arg;
+  tcp_link_hold_fn hold;
+  void *hold_arg;
+  /* counters, per direction */
+  u32_t sent[2];
+  u32_t dropped[2];
+  u32_t data_bytes[2];            /* TCP payload, with retransmissions */
+};
+
+/** A transfer of 'total' bytes from A to B */
+struct tcp_link_xfer {
+  struct tcp_link *link;
+  struct tcp_pcb *tx;
+  struct tcp_pcb *rx;
+  struct tcp_pcb *listener;
+  u32_t total;
+  u32_t written;
+  u32_t received;
+  u32_t start_ms;
+  u32_t done_ms;                  /* 0 until all was received */
+  u8_t corrupt;
+  u8_t error;
+};
+
+void tcp_link_init(struct tcp_link *link, u32_t seed);
+void tcp_link_free(struct tcp_link *link);
+void tcp_link_step(struct tcp_link *link);
+u32_t tcp_link_rand(struct tcp_link *link);
+
+/** Connect A to B, run until established; 0 on success */
+int tcp_link_xfer_open(struct tcp_link_xfer *xfer, struct tcp_link *link, u32_t total);
+/** Run until the data was received or timeout_ms; 0 on success */
+int tcp_link_xfer_run(struct tcp_link_xfer *xfer, u32_t timeout_ms);
+void tcp_link_xfer_close(struct tcp_link_xfer *xfer);
+/** bytes per second */
+u32_t tcp_link_xfer_goodput(const struct tcp_link_xfer *xfer);
+
+#endif
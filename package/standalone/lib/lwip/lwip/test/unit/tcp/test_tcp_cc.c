@@ -0,0 +1,191 @@
+#include "test_tcp_cc.h"
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/stats.h"
+#include "tcp_link.h"
+
+#include <stdio.h>
+
+#if !LWIP_TCP_CC
+#error "This tests needs LWIP_TCP_CC enabled"
+#endif
+
+static struct netif *old_netif_list;
+static struct netif *old_netif_default;
+
+/* Setups/teardown functions */
+
+static void
+tcp_cc_setup(void)
+{
+  old_netif_list = netif_list;
+  old_netif_default = netif_default;
+  netif_list = NULL;
+  netif_default = NULL;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+static void
+tcp_cc_teardown(void)
+{
+  netif_list = old_netif_list;
+  netif_default = old_netif_default;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+struct cc_result {
+  u32_t goodput;
+  u32_t bw;       /* Westwood+ estimate at the end */
+};
+
+/** Transfer 'total' bytes over a link, the sender using congestion control 'cc' */
+static int
+cc_xfer(const struct tcp_link_dir *dir, u32_t seed, u8_t cc, u32_t total,
+        struct cc_result *res)
+{
+  struct tcp_link link;
+  struct tcp_link_xfer xfer;
+  int ret;
+
+  memset(res, 0, sizeof(*res));
+  tcp_link_init(&link, seed);
+  if (tcp_link_xfer_open(&xfer, &link, total) != 0) {
+    tcp_link_free(&link);
+    return -1;
+  }
+  fail_unless(tcp_set_cc(xfer.tx, cc) == ERR_OK);
+  link.dir[TCP_LINK_A] = dir[TCP_LINK_A];
+  link.dir[TCP_LINK_B] = dir[TCP_LINK_B];
+
+  ret = tcp_link_xfer_run(&xfer, 600000);
+  fail_unless(xfer.done_ms != 0);
+  fail_unless(!xfer.corrupt);
+  fail_unless(!xfer.error);
+  res->goodput = tcp_link_xfer_goodput(&xfer);
+  if (cc == TCP_CC_WESTWOOD) {
+    res->bw = xfer.tx->cc_state.westwood.bw;
+  }
+
+  tcp_link_xfer_close(&xfer);
+  tcp_link_free(&link);
+  return ret;
+}
+
+/* A long HaLow-like link: 40 KB/s, 60 ms each way, about one window in flight */
+static void
+cc_link(struct tcp_link_dir *dir)
+{
+  memset(dir, 0, 2 * sizeof(*dir));
+  dir[TCP_LINK_A].rate = 40000;
+  dir[TCP_LINK_A].delay = 60;
+  dir[TCP_LINK_A].queue = 32;
+  dir[TCP_LINK_B].rate = 40000;
+  dir[TCP_LINK_B].delay = 60;
+  dir[TCP_LINK_B].queue = 32;
+}
+
+/* Test functions */
+
+/** Algorithms are chosen per pcb */
+START_TEST(test_tcp_cc_select)
+{
+  struct tcp_pcb *pcb;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb = tcp_new();
+  fail_unless(pcb != NULL);
+  EXPECT(tcp_get_cc(pcb) == TCP_CC_DEFAULT);
+  EXPECT(tcp_set_cc(pcb, TCP_CC_WESTWOOD) == ERR_OK);
+  EXPECT(tcp_get_cc(pcb) == TCP_CC_WESTWOOD);
+  EXPECT(pcb->cc_state.westwood.bw == 0);
+  EXPECT(tcp_set_cc(pcb, TCP_CC_NUM) == ERR_VAL);
+  EXPECT(tcp_get_cc(pcb) == TCP_CC_WESTWOOD);
+  EXPECT(tcp_set_cc(pcb, TCP_CC_NEWRENO) == ERR_OK);
+  EXPECT(tcp_get_cc(pcb) == TCP_CC_NEWRENO);
+  tcp_abort(pcb);
+}
+END_TEST
+
+/** Westwood+ estimates the bandwidth of the link */
+START_TEST(test_tcp_cc_westwood_bw)
+{
+  struct tcp_link_dir dir[2];
+  struct cc_result res;
+  LWIP_UNUSED_ARG(_i);
+
+  cc_link(dir);
+  EXPECT(cc_xfer(dir, 1, TCP_CC_WESTWOOD, 256 * TCP_MSS, &res) == 0);
+  printf("tcp_cc westwood: estimated %u B/s of 40000, goodput %u B/s\n",
+         (unsigned)res.bw, (unsigned)res.goodput);
+  /* headers are not counted, and the first rounds are in slow start */
+  EXPECT(res.bw > 30000);
+  EXPECT(res.bw <= 40000);
+}
+END_TEST
+
+/** Goodput of NewReno and Westwood+ under random loss and duty-cycle gaps,
+    averaged over seeds */
+START_TEST(test_tcp_cc_bench)
+{
+  static const struct {
+    const char *name;
+    u16_t loss;
+    u32_t on_ms;
+    u32_t off_ms;
+  } scenario[] = {
+    { "clean",              0,   0,   0 },
+    { "loss 1%",          100,   0,   0 },
+    { "loss 3%",          300,   0,   0 },
+    { "loss 5%",          500,   0,   0 },
+    { "duty 200/50",        0, 200,  50 },
+    { "duty 200/50 2%",   200, 200,  50 },
+    { "duty 100/100 2%",  200, 100, 100 }
+  };
+  const u32_t seeds = 4;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  printf("tcp_cc bench: %u KB at 40 KB/s, 120 ms RTT, goodput in B/s\n",
+         (unsigned)(256 * TCP_MSS / 1024));
+  printf("  %-18s %8s %8s\n", "scenario", "newreno", "westwood");
+  for (i = 0; i < sizeof(scenario) / sizeof(scenario[0]); i++) {
+    struct tcp_link_dir dir[2];
+    u32_t seed, goodput[TCP_CC_NUM] = {0, 0};
+    u8_t cc;
+
+    cc_link(dir);
+    dir[TCP_LINK_A].loss = scenario[i].loss;
+    dir[TCP_LINK_A].on_ms = scenario[i].on_ms;
+    dir[TCP_LINK_A].off_ms = scenario[i].off_ms;
+    dir[TCP_LINK_B].on_ms = scenario[i].on_ms;
+    dir[TCP_LINK_B].off_ms = scenario[i].off_ms;
+
+    for (cc = 0; cc < TCP_CC_NUM; cc++) {
+      for (seed = 1; seed <= seeds; seed++) {
+        struct cc_result res;
+
+        EXPECT(cc_xfer(dir, seed, cc, 256 * TCP_MSS, &res) == 0);
+        goodput[cc] += res.goodput / seeds;
+      }
+    }
+    printf("  %-18s %8u %8u\n", scenario[i].name, (unsigned)goodput[TCP_CC_NEWRENO],
+           (unsigned)goodput[TCP_CC_WESTWOOD]);
+    if (scenario[i].loss != 0) {
+      EXPECT(goodput[TCP_CC_WESTWOOD] >= goodput[TCP_CC_NEWRENO]);
+    }
+  }
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+tcp_cc_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_tcp_cc_select),
+    TESTFUNC(test_tcp_cc_westwood_bw),
+    TESTFUNC(test_tcp_cc_bench)
+  };
+  return create_suite("TCP_CC", tests, sizeof(tests)/sizeof(testfunc), tcp_cc_setup, tcp_cc_teardown);
+}
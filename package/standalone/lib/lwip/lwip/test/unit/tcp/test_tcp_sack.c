@@ -0,0 +1,351 @@
+#include "test_tcp_sack.h"
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/stats.h"
+#include "tcp_link.h"
+
+#include <stdio.h>
+
+#if !LWIP_TCP_SACK_IN || !LWIP_TCP_RACK
+#error "This tests needs LWIP_TCP_SACK_IN and LWIP_TCP_RACK enabled"
+#endif
+
+static struct netif *old_netif_list;
+static struct netif *old_netif_default;
+
+/* Setups/teardown functions */
+
+static void
+tcp_sack_setup(void)
+{
+  old_netif_list = netif_list;
+  old_netif_default = netif_default;
+  netif_list = NULL;
+  netif_default = NULL;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+static void
+tcp_sack_teardown(void)
+{
+  netif_list = old_netif_list;
+  netif_default = old_netif_default;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+/** Segments dropped the first time they are sent, or held back by 'hold'
+    ms to reorder them, by offset in the stream */
+struct sack_drops {
+  u32_t base;
+  u32_t offset[8];
+  u32_t hold;
+  u8_t num;
+  u8_t done;
+};
+
+static u8_t
+sack_drop(void *arg, u8_t dir, u32_t seqno, u16_t len)
+{
+  struct sack_drops *drops = (struct sack_drops *)arg;
+  u8_t i;
+
+  if (dir != TCP_LINK_A || len == 0) {
+    return 0;
+  }
+  for (i = 0; i < drops->num; i++) {
+    if (!(drops->done & (1 << i)) && seqno - drops->base == drops->offset[i]) {
+      drops->done |= (u8_t)(1 << i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static u32_t
+sack_hold(void *arg, u8_t dir, u32_t seqno, u16_t len)
+{
+  struct sack_drops *drops = (struct sack_drops *)arg;
+
+  return sack_drop(arg, dir, seqno, len) ? drops->hold : 0;
+}
+
+struct sack_result {
+  u32_t goodput;
+  u32_t ms;
+  u32_t rexmit;   /* bytes sent again */
+  u8_t reo_wnd_mult;
+};
+
+/** Transfer 'total' bytes over a link, with or without SACK on both ends */
+static int
+sack_xfer(const struct tcp_link_dir *dir, u32_t seed, u8_t sack, u32_t total,
+          struct sack_drops *drops, struct sack_result *res)
+{
+  struct tcp_link link;
+  struct tcp_link_xfer xfer;
+  int ret;
+
+  memset(res, 0, sizeof(*res));
+  tcp_link_init(&link, seed);
+  /* the handshake takes the delays of the link, RACK's first round trip,
+     and none of its losses */
+  for (ret = 0; ret < 2; ret++) {
+    link.dir[ret] = dir[ret];
+    link.dir[ret].loss = 0;
+    link.dir[ret].reorder = 0;
+  }
+  if (tcp_link_xfer_open(&xfer, &link, total) != 0) {
+    tcp_link_free(&link);
+    return -1;
+  }
+  fail_unless((xfer.tx->flags & TF_SACK) != 0);
+  fail_unless((xfer.rx->flags & TF_SACK) != 0);
+  if (!sack) {
+    /* the stack without SACK loss recovery */
+    tcp_clear_flags(xfer.tx, TF_SACK);
+    tcp_clear_flags(xfer.rx, TF_SACK);
+  }
+  if (drops != NULL) {
+    for (ret = 0; ret < drops->num; ret++) {
+      drops->offset[ret] *= xfer.tx->mss;
+    }
+    drops->base = xfer.tx->snd_nxt;
+    if (drops->hold != 0) {
+      link.hold = sack_hold;
+      link.hold_arg = drops;
+    } else {
+      link.drop = sack_drop;
+      link.drop_arg = drops;
+    }
+  }
+  link.dir[TCP_LINK_A] = dir[TCP_LINK_A];
+  link.dir[TCP_LINK_B] = dir[TCP_LINK_B];
+  link.data_bytes[TCP_LINK_A] = 0;
+
+  ret = tcp_link_xfer_run(&xfer, 600000);
+  fail_unless(xfer.done_ms != 0);
+  fail_unless(!xfer.corrupt);
+  fail_unless(!xfer.error);
+  res->goodput = tcp_link_xfer_goodput(&xfer);
+  res->ms = xfer.done_ms - xfer.start_ms;
+  res->rexmit = link.data_bytes[TCP_LINK_A] - xfer.received;
+  res->reo_wnd_mult = xfer.tx->rack.reo_wnd_mult;
+
+  tcp_link_xfer_close(&xfer);
+  tcp_link_free(&link);
+  return ret;
+}
+
+/* A HaLow-like link: 40 KB/s, 10 ms each way */
+static void
+sack_link(struct tcp_link_dir *dir)
+{
+  memset(dir, 0, 2 * sizeof(*dir));
+  dir[TCP_LINK_A].rate = 40000;
+  dir[TCP_LINK_A].delay = 10;
+  dir[TCP_LINK_A].queue = 32;
+  dir[TCP_LINK_B].rate = 40000;
+  dir[TCP_LINK_B].delay = 10;
+  dir[TCP_LINK_B].queue = 32;
+}
+
+/* Test functions */
+
+/** Two losses in a window: only the two segments are sent again, without RTO */
+START_TEST(test_tcp_sack_scoreboard)
+{
+  struct tcp_link_dir dir[2];
+  struct sack_drops drops;
+  struct sack_result base, sack;
+  LWIP_UNUSED_ARG(_i);
+
+  sack_link(dir);
+
+  memset(&drops, 0, sizeof(drops));
+  drops.offset[0] = 4;
+  drops.offset[1] = 6;
+  drops.num = 2;
+  EXPECT(sack_xfer(dir, 1, 1, 40 * TCP_MSS, &drops, &sack) == 0);
+  EXPECT(drops.done == 3);
+
+  memset(&drops, 0, sizeof(drops));
+  drops.offset[0] = 4;
+  drops.offset[1] = 6;
+  drops.num = 2;
+  EXPECT(sack_xfer(dir, 1, 0, 40 * TCP_MSS, &drops, &base) == 0);
+  EXPECT(drops.done == 3);
+
+  printf("tcp_sack scoreboard: %u ms, %u bytes sent again; without SACK %u ms, %u bytes\n",
+         (unsigned)sack.ms, (unsigned)sack.rexmit, (unsigned)base.ms, (unsigned)base.rexmit);
+  EXPECT(sack.rexmit == 2 * TCP_MSS);
+  EXPECT(sack.ms < base.ms);
+}
+END_TEST
+
+/** The last segments are lost: a tail loss probe recovers them before the RTO */
+START_TEST(test_tcp_sack_tlp)
+{
+  struct tcp_link_dir dir[2];
+  struct sack_drops drops;
+  struct sack_result base, sack;
+  LWIP_UNUSED_ARG(_i);
+
+  sack_link(dir);
+
+  memset(&drops, 0, sizeof(drops));
+  drops.offset[0] = 18;
+  drops.offset[1] = 19;
+  drops.num = 2;
+  EXPECT(sack_xfer(dir, 1, 1, 20 * TCP_MSS, &drops, &sack) == 0);
+  EXPECT(drops.done == 3);
+
+  memset(&drops, 0, sizeof(drops));
+  drops.offset[0] = 18;
+  drops.offset[1] = 19;
+  drops.num = 2;
+  EXPECT(sack_xfer(dir, 1, 0, 20 * TCP_MSS, &drops, &base) == 0);
+  EXPECT(drops.done == 3);
+
+  printf("tcp_sack tail loss: %u ms, without SACK %u ms\n", (unsigned)sack.ms, (unsigned)base.ms);
+  EXPECT(sack.rexmit == 2 * TCP_MSS);
+  /* the probe goes at 2 * SRTT, at the granularity of the fast timer */
+  EXPECT(sack.ms + 500 <= base.ms);
+}
+END_TEST
+
+/* A faster link: a segment every 1.5 ms, 40 ms round trip */
+static void
+sack_fast_link(struct tcp_link_dir *dir)
+{
+  sack_link(dir);
+  dir[TCP_LINK_A].rate = 400000;
+  dir[TCP_LINK_A].delay = 20;
+  dir[TCP_LINK_B].rate = 400000;
+  dir[TCP_LINK_B].delay = 20;
+}
+
+/** Segments overtaken by two others, well within the reordering window:
+    RACK waits for them and nothing is sent again */
+START_TEST(test_tcp_sack_reorder)
+{
+  struct tcp_link_dir dir[2];
+  struct sack_drops holds;
+  struct sack_result sack;
+  u8_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  sack_fast_link(dir);
+
+  memset(&holds, 0, sizeof(holds));
+  for (i = 0; i < 8; i++) {
+    holds.offset[i] = 8 + 7 * i;
+  }
+  holds.num = 8;
+  holds.hold = 4;
+  EXPECT(sack_xfer(dir, 1, 1, 64 * TCP_MSS, &holds, &sack) == 0);
+  EXPECT(holds.done == 0xff);
+
+  printf("tcp_sack reorder: %u ms, %u bytes sent again\n", (unsigned)sack.ms, (unsigned)sack.rexmit);
+  EXPECT(sack.rexmit == 0);
+}
+END_TEST
+
+/** Segments overtaken by ten others, more than the reordering window: the
+    D-SACK of the first spurious retransmission widens it, and the
+    reordering that follows costs nothing */
+START_TEST(test_tcp_sack_dsack)
+{
+  struct tcp_link_dir dir[2];
+  struct sack_drops holds;
+  struct sack_result sack;
+  u8_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  sack_fast_link(dir);
+
+  memset(&holds, 0, sizeof(holds));
+  for (i = 0; i < 8; i++) {
+    holds.offset[i] = 8 + 7 * i;
+  }
+  holds.num = 8;
+  holds.hold = 15;
+  EXPECT(sack_xfer(dir, 1, 1, 64 * TCP_MSS, &holds, &sack) == 0);
+  EXPECT(holds.done == 0xff);
+
+  printf("tcp_sack D-SACK: %u ms, %u bytes sent again, reordering window %u/4 min_rtt\n",
+         (unsigned)sack.ms, (unsigned)sack.rexmit, (unsigned)sack.reo_wnd_mult);
+  EXPECT(sack.reo_wnd_mult > 1);
+  EXPECT(sack.rexmit <= TCP_MSS);
+}
+END_TEST
+
+/** Goodput with and without SACK, averaged over seeds */
+START_TEST(test_tcp_sack_bench)
+{
+  static const struct {
+    const char *name;
+    u16_t loss;
+    u16_t reorder;
+    u32_t on_ms;
+    u32_t off_ms;
+  } scenario[] = {
+    { "clean",              0,   0,   0,   0 },
+    { "loss 1%",          100,   0,   0,   0 },
+    { "loss 3%",          300,   0,   0,   0 },
+    { "loss 5%",          500,   0,   0,   0 },
+    { "loss 3% reorder",  300, 200,   0,   0 },
+    { "duty 200/50 1%",   100,   0, 200,  50 }
+  };
+  const u32_t seeds = 4;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  printf("tcp_sack bench: %u KB at 40 KB/s, 20 ms RTT, goodput in B/s\n",
+         (unsigned)(64 * TCP_MSS / 1024));
+  printf("  %-18s %8s %8s %8s %8s\n", "scenario", "base", "sack", "rexmit", "rexmit");
+  for (i = 0; i < sizeof(scenario) / sizeof(scenario[0]); i++) {
+    struct tcp_link_dir dir[2];
+    u32_t seed, goodput[2] = {0, 0}, rexmit[2] = {0, 0};
+    u8_t sack;
+
+    sack_link(dir);
+    dir[TCP_LINK_A].loss = scenario[i].loss;
+    dir[TCP_LINK_A].reorder = scenario[i].reorder;
+    dir[TCP_LINK_A].reorder_delay = 15;
+    dir[TCP_LINK_A].on_ms = scenario[i].on_ms;
+    dir[TCP_LINK_A].off_ms = scenario[i].off_ms;
+    dir[TCP_LINK_B].on_ms = scenario[i].on_ms;
+    dir[TCP_LINK_B].off_ms = scenario[i].off_ms;
+
+    for (sack = 0; sack < 2; sack++) {
+      for (seed = 1; seed <= seeds; seed++) {
+        struct sack_result res;
+
+        EXPECT(sack_xfer(dir, seed, sack, 64 * TCP_MSS, NULL, &res) == 0);
+        goodput[sack] += res.goodput / seeds;
+        rexmit[sack] += res.rexmit / seeds;
+      }
+    }
+    printf("  %-18s %8u %8u %8u %8u\n", scenario[i].name, (unsigned)goodput[0],
+           (unsigned)goodput[1], (unsigned)rexmit[0], (unsigned)rexmit[1]);
+    if (scenario[i].loss != 0) {
+      EXPECT(goodput[1] >= goodput[0]);
+    }
+  }
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+tcp_sack_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_tcp_sack_scoreboard),
+    TESTFUNC(test_tcp_sack_tlp),
+    TESTFUNC(test_tcp_sack_reorder),
+    TESTFUNC(test_tcp_sack_dsack),
+    TESTFUNC(test_tcp_sack_bench)
+  };
+  return create_suite("TCP_SACK", tests, sizeof(tests)/sizeof(testfunc), tcp_sack_setup, tcp_sack_teardown);
+}
@@ -31,16 +31,22 @@ LWIP_APPS_INC	= $(LWIP_BASE_INC)/apps
 LWIP_PING		= $(LWIP_BASE_APPS)/ping
 LWIP_IPERF		= $(LWIP_BASE_APPS)/iperf
 LWIP_DHCPS		= $(LWIP_BASE_APPS)/dhcpserver
+LWIP_RESUME		= $(LWIP_BASE_APPS)/resume
+LWIP_MEMPROF	= $(LWIP_BASE_APPS)/memprof
 
 LWIP_PING_INC		= $(LWIP_APPS_INC)/ping
 LWIP_IPERF_INC		= $(LWIP_APPS_INC)/iperf
 LWIP_DHCPS_INC		= $(LWIP_APPS_INC)/dhcpserver
+LWIP_RESUME_INC		= $(LWIP_APPS_INC)/resume
+LWIP_MEMPROF_INC	= $(LWIP_APPS_INC)/memprof
 
 INCLUDE += -I$(LWIP_BASE_INC)
 INCLUDE += -I$(LWIP_APPS_INC)
 INCLUDE += -I$(LWIP_PING_INC)
 INCLUDE += -I$(LWIP_IPERF_INC)
 INCLUDE += -I$(LWIP_DHCPS_INC)
+INCLUDE += -I$(LWIP_RESUME_INC)
+INCLUDE += -I$(LWIP_MEMPROF_INC)
 INCLUDE += -I$(LWIP_INC)
 INCLUDE += -I$(LWIP_PORT_INC)
 INCLUDE += -I$(LWIP_PORT_ARCH_INC)
@@ -62,12 +68,29 @@ VPATH	+= $(LWIP_PORT_NETIF)
 VPATH	+= $(LWIP_PING)
 VPATH	+= $(LWIP_IPERF)
 VPATH	+= $(LWIP_DHCPS)
+VPATH	+= $(LWIP_RESUME)
+VPATH	+= $(LWIP_MEMPROF)
 VPATH	+= $(LWIP_PORT_NAT)
 VPATH	+= $(SNMP_APP)
 VPATH	+= $(SNTP_APP)
 
 DEFINE	+= -DNRC_LWIP
 
+# Header generated by tools/lwip_memprof.py, e.g. LWIP_TUNED_OPTS=lwipopts_tuned.h
+ifneq ($(LWIP_TUNED_OPTS),)
+DEFINE	+= -DLWIP_TUNED_OPTS=\"$(LWIP_TUNED_OPTS)\"
+endif
+
+# Lock-contention tracing of sys_arch.c, read with tools/lwip_locktrace.py
+ifeq ($(CONFIG_LWIP_SYS_TRACE), y)
+DEFINE	+= -DLWIP_SYS_TRACE=1
+endif
+
+# Westwood+ congestion control by default for new TCP connections
+ifeq ($(CONFIG_LWIP_TCP_WESTWOOD), y)
+DEFINE	+= -DTCP_CC_DEFAULT=TCP_CC_WESTWOOD
+endif
+
 # COREFILES, CORE4FILES: The minimum set of files needed for lwIP.
 COREFILES	= \
 	init.c \
@@ -88,6 +111,8 @@ COREFILES	= \
 	tcp.c \
 	tcp_in.c \
 	tcp_out.c \
+	tcp_sack.c \
+	tcp_cc.c \
 	timeouts.c \
 	udp.c
 
@@ -123,6 +148,7 @@ NETIFFILES= \
 # PORTING_FILES
 LWIP_PORTING = \
 	sys_arch.c \
+	sys_arch_trace.c \
 	wlif.c \
 	nrc_ping.c \
 	nrc_iperf.c \
@@ -154,6 +180,9 @@ LWIP_APP+= \
 	ping.c \
 	captdns.c \
 	dhcpserver.c \
+	dhcps_lease.c \
+	lwip_resume.c \
+	lwip_memprof.c \
 
 # IPv6
 ifeq ($(CONFIG_IPV6), y)
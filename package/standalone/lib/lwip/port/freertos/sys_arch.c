@@ -40,6 +40,7 @@
 #include "semphr.h"
 #include "task.h"
 #include "lwip/arch.h"
+#include "lwip/tcpip.h"
 
 /** Set this to 1 if you want the stack size passed to sys_thread_new() to be
  * interpreted as number of stack words (FreeRTOS-like).
@@ -231,6 +232,27 @@ sys_arch_msleep(u32_t delay_ms)
   vTaskDelay(delay_ticks);
 }
 
+#if LWIP_SYS_TRACE
+/* Trace names of the two mutexes everything goes through, NULL for the
+   name of the creating task */
+static const char *
+sys_arch_trace_mutex_name(sys_mutex_t *mutex)
+{
+#if LWIP_TCPIP_CORE_LOCKING
+  if (mutex == &lock_tcpip_core) {
+    return "core";
+  }
+#endif
+#if SYS_LIGHTWEIGHT_PROT && LWIP_FREERTOS_SYS_ARCH_PROTECT_USES_MUTEX && \
+    LWIP_FREERTOS_SYS_ARCH_NOT_USE_RECURSIVE_MUTEX
+  if (mutex == &g_lwip_mutex) {
+    return "protect";
+  }
+#endif
+  return NULL;
+}
+#endif /* LWIP_SYS_TRACE */
+
 #if !LWIP_COMPAT_MUTEX
 
 /* Create a new mutex*/
@@ -245,12 +267,35 @@ sys_mutex_new(sys_mutex_t *mutex)
     return ERR_MEM;
   }
   SYS_STATS_INC_USED(mutex);
+#if LWIP_SYS_TRACE
+  sys_trace_new(&mutex->trace, SYS_TRACE_MUTEX, sys_arch_trace_mutex_name(mutex));
+#endif
   return ERR_OK;
 }
 
 void
 sys_mutex_lock(sys_mutex_t *mutex)
 {
+#if LWIP_SYS_TRACE
+  u32_t t0 = sys_trace_begin();
+  if (t0) {
+    u8_t owner = SYS_TRACE_NONE;
+    /* a first try tells whether the mutex was taken */
+    #if LWIP_FREERTOS_SYS_ARCH_NOT_USE_RECURSIVE_MUTEX
+    if (xSemaphoreTake(mutex->mut, 0) != pdTRUE) {
+      owner = sys_trace_holder(&mutex->trace);
+      while (xSemaphoreTake(mutex->mut, portMAX_DELAY) != pdTRUE);
+    }
+    #else
+    if (xSemaphoreTakeRecursive(mutex->mut, 0) != pdTRUE) {
+      owner = sys_trace_holder(&mutex->trace);
+      while (xSemaphoreTakeRecursive(mutex->mut, portMAX_DELAY) != pdTRUE);
+    }
+    #endif
+    sys_trace_locked(&mutex->trace, t0, owner);
+    return;
+  }
+#endif /* LWIP_SYS_TRACE */
   #if LWIP_FREERTOS_SYS_ARCH_NOT_USE_RECURSIVE_MUTEX
   while( xSemaphoreTake( mutex->mut, portMAX_DELAY ) != pdTRUE );
   #else
@@ -266,6 +311,9 @@ sys_mutex_lock(sys_mutex_t *mutex)
 void
 sys_mutex_unlock(sys_mutex_t *mutex)
 {
+#if LWIP_SYS_TRACE
+  sys_trace_unlocked(&mutex->trace);
+#endif
   #if LWIP_FREERTOS_SYS_ARCH_NOT_USE_RECURSIVE_MUTEX
   xSemaphoreGive( mutex->mut );
   #else
@@ -304,6 +352,9 @@ sys_sem_new(sys_sem_t *sem, u8_t initial_count)
     return ERR_MEM;
   }
   SYS_STATS_INC_USED(sem);
+#if LWIP_SYS_TRACE
+  sys_trace_new(&sem->trace, SYS_TRACE_SEM, NULL);
+#endif
 
   if(initial_count == 1) {
     BaseType_t ret = xSemaphoreGive(sem->sem);
@@ -319,6 +370,9 @@ sys_sem_signal(sys_sem_t *sem)
   LWIP_ASSERT("sem != NULL", sem != NULL);
   LWIP_ASSERT("sem->sem != NULL", sem->sem != NULL);
 
+#if LWIP_SYS_TRACE
+  sys_trace_signaled(&sem->trace);
+#endif
   ret = xSemaphoreGive(sem->sem);
   /* queue full is OK, this is a signal only... */
   LWIP_ASSERT("sys_sem_signal: sane return value",
@@ -329,6 +383,9 @@ u32_t
 sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout_ms)
 {
   BaseType_t ret;
+#if LWIP_SYS_TRACE
+  u32_t t0 = sys_trace_begin();
+#endif
   LWIP_ASSERT("sem != NULL", sem != NULL);
   LWIP_ASSERT("sem->sem != NULL", sem->sem != NULL);
 
@@ -341,10 +398,16 @@ sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout_ms)
     ret = xSemaphoreTake(sem->sem, timeout_ticks);
     if (ret == errQUEUE_EMPTY) {
       /* timed out */
+#if LWIP_SYS_TRACE
+      sys_trace_waited(&sem->trace, t0);
+#endif
       return SYS_ARCH_TIMEOUT;
     }
     LWIP_ASSERT("taking semaphore failed", ret == pdTRUE);
   }
+#if LWIP_SYS_TRACE
+  sys_trace_waited(&sem->trace, t0);
+#endif
 
   /* Old versions of lwIP required us to return the time waited.
      This is not the case any more. Just returning != SYS_ARCH_TIMEOUT
@@ -375,6 +438,9 @@ sys_mbox_new(sys_mbox_t *mbox, int size)
     return ERR_MEM;
   }
   SYS_STATS_INC_USED(mbox);
+#if LWIP_SYS_TRACE
+  sys_trace_new(&mbox->trace, SYS_TRACE_MBOX, NULL);
+#endif
   return ERR_OK;
 }
 
@@ -385,6 +451,21 @@ sys_mbox_post(sys_mbox_t *mbox, void *msg)
   LWIP_ASSERT("mbox != NULL", mbox != NULL);
   LWIP_ASSERT("mbox->mbx != NULL", mbox->mbx != NULL);
 
+#if LWIP_SYS_TRACE
+  {
+    u32_t t0 = sys_trace_begin();
+    if (t0) {
+      /* a first try tells whether the mailbox was full */
+      int blocked = xQueueSendToBack(mbox->mbx, &msg, 0) != pdTRUE;
+      if (blocked) {
+        ret = xQueueSendToBack(mbox->mbx, &msg, portMAX_DELAY);
+        LWIP_ASSERT("mbox post failed", ret == pdTRUE);
+      }
+      sys_trace_posted(&mbox->trace, t0, blocked, uxQueueMessagesWaiting(mbox->mbx));
+      return;
+    }
+  }
+#endif /* LWIP_SYS_TRACE */
   ret = xQueueSendToBack(mbox->mbx, &msg, portMAX_DELAY);
   LWIP_ASSERT("mbox post failed", ret == pdTRUE);
 }
@@ -398,6 +479,9 @@ sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
 
   ret = xQueueSendToBack(mbox->mbx, &msg, 0);
   if (ret == pdTRUE) {
+#if LWIP_SYS_TRACE
+    sys_trace_posted(&mbox->trace, sys_trace_begin(), 0, uxQueueMessagesWaiting(mbox->mbx));
+#endif
     return ERR_OK;
   } else {
     LWIP_ASSERT("mbox trypost failed", ret == errQUEUE_FULL);
@@ -432,6 +516,9 @@ sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout_ms)
 {
   BaseType_t ret;
   void *msg_dummy;
+#if LWIP_SYS_TRACE
+  u32_t t0 = sys_trace_fetch_begin(&mbox->trace);
+#endif
   LWIP_ASSERT("mbox != NULL", mbox != NULL);
   LWIP_ASSERT("mbox->mbx != NULL", mbox->mbx != NULL);
 
@@ -449,10 +536,16 @@ sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout_ms)
     if (ret == errQUEUE_EMPTY) {
       /* timed out */
       *msg = NULL;
+#if LWIP_SYS_TRACE
+      sys_trace_fetched(&mbox->trace, t0);
+#endif
       return SYS_ARCH_TIMEOUT;
     }
     LWIP_ASSERT("mbox fetch failed", ret == pdTRUE);
   }
+#if LWIP_SYS_TRACE
+  sys_trace_fetched(&mbox->trace, t0);
+#endif
 
   /* Old versions of lwIP required us to return the time waited.
      This is not the case any more. Just returning != SYS_ARCH_TIMEOUT
@@ -528,6 +621,9 @@ sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize
   LWIP_ASSERT("task creation failed", ret == pdTRUE);
 
   lwip_thread.thread_handle = rtos_task;
+#if LWIP_SYS_TRACE
+  sys_trace_thread(name, rtos_task);
+#endif
   return lwip_thread;
 }
 
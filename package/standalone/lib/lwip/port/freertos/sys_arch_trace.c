@@ -0,0 +1,789 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/* Lock-contention tracing for sys_arch.c, see arch/sys_arch_trace.h */
+
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+
+#if LWIP_SYS_TRACE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "arch/sys_arch_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SYS_TRACE_WAIT      0
+#define SYS_TRACE_HOLD      1
+
+#define SYS_TRACE_TICK_US   (1000000UL / configTICK_RATE_HZ)
+
+struct sys_trace_task {
+  void *handle;
+  char name[LWIP_SYS_TRACE_NAME_LEN];
+};
+
+struct sys_trace_edge {
+  u8_t lock;
+  u8_t waiter;
+  u8_t owner;
+  u32_t count;
+  u32_t wait_us;
+};
+
+struct sys_trace_event {
+  u32_t t;
+  u32_t dur;
+  u8_t lock;
+  u8_t task;
+  u8_t type;
+  u8_t owner;
+};
+
+/* Entry 0 of the classes and of the tasks takes what does not fit */
+static struct sys_trace_lock trace_locks[LWIP_SYS_TRACE_LOCKS];
+static u8_t trace_nlocks;
+static struct sys_trace_task trace_tasks[LWIP_SYS_TRACE_TASKS];
+static u8_t trace_ntasks;
+static struct sys_trace_pair trace_pairs[LWIP_SYS_TRACE_PAIRS];
+static u8_t trace_npairs;
+static struct sys_trace_edge trace_edges[LWIP_SYS_TRACE_EDGES];
+static u8_t trace_nedges;
+static struct sys_trace_event trace_events[LWIP_SYS_TRACE_EVENTS];
+static u16_t trace_event_next;
+static u16_t trace_event_count;
+
+static volatile int trace_on;
+static u32_t trace_start;
+static void *trace_tcpip_thread;
+static u8_t trace_tcpip_lock = SYS_TRACE_NONE;
+
+static const char *const trace_kinds[] = { "mutex", "sem", "mbox" };
+
+/*
+ * Microseconds from the tick count and the SysTick down-counter. The tick
+ * count is read again to catch a tick between the two reads; a tick due
+ * while interrupts are masked can make it run back by a tick, which
+ * trace_elapsed() clamps.
+ */
+#ifndef LWIP_SYS_TRACE_NOW_US
+#define SYST_RVR            (*(volatile u32_t *)0xe000e014)
+#define SYST_CVR            (*(volatile u32_t *)0xe000e018)
+
+static u32_t
+trace_now_us(void)
+{
+  TickType_t tick;
+  u32_t load, cur;
+
+  do {
+    tick = xTaskGetTickCount();
+    cur = SYST_CVR;
+  } while (tick != xTaskGetTickCount());
+
+  load = SYST_RVR + 1;
+  return tick * SYS_TRACE_TICK_US + (u32_t)(((u64_t)(load - cur) * SYS_TRACE_TICK_US) / load);
+}
+#define LWIP_SYS_TRACE_NOW_US() trace_now_us()
+#endif
+
+static u32_t
+trace_elapsed(u32_t t0, u32_t t1)
+{
+  u32_t d = t1 - t0;
+  return (d & 0x80000000UL) ? 0 : d;
+}
+
+static u8_t
+trace_bucket(u32_t us)
+{
+  u8_t b = 0;
+
+  us >>= 2;
+  while (us && b < LWIP_SYS_TRACE_BUCKETS - 1) {
+    us >>= 1;
+    b++;
+  }
+  return b;
+}
+
+static void
+trace_hist_add(u16_t *hist, u32_t us)
+{
+  u8_t b = trace_bucket(us);
+
+  if (hist[b] != 0xffff) {
+    hist[b]++;
+  }
+}
+
+static void
+trace_name_copy(char *dst, const char *src)
+{
+  strncpy(dst, src ? src : "?", LWIP_SYS_TRACE_NAME_LEN - 1);
+  dst[LWIP_SYS_TRACE_NAME_LEN - 1] = '\0';
+}
+
+/* Called in a critical section */
+static u8_t
+trace_task_id(void)
+{
+  void *handle = xTaskGetCurrentTaskHandle();
+  const char *name = pcTaskGetName(NULL);
+  u8_t i;
+
+  for (i = 1; i < trace_ntasks; i++) {
+    /* a handle can be reused by a task created later */
+    if (trace_tasks[i].handle == handle &&
+        strncmp(trace_tasks[i].name, name, LWIP_SYS_TRACE_NAME_LEN - 1) == 0) {
+      return i;
+    }
+  }
+  if (trace_ntasks == 0) {
+    trace_name_copy(trace_tasks[0].name, "other");
+    trace_ntasks = 1;
+  }
+  if (trace_ntasks == LWIP_SYS_TRACE_TASKS) {
+    return 0;
+  }
+  trace_tasks[i].handle = handle;
+  trace_name_copy(trace_tasks[i].name, name);
+  trace_ntasks++;
+  return i;
+}
+
+/* Called in a critical section */
+static u8_t
+trace_lock_id(u8_t kind, const char *name)
+{
+  u8_t i;
+
+  for (i = 1; i < trace_nlocks; i++) {
+    if (trace_locks[i].kind == kind &&
+        strncmp(trace_locks[i].name, name, LWIP_SYS_TRACE_NAME_LEN - 1) == 0) {
+      return i;
+    }
+  }
+  if (trace_nlocks == 0) {
+    trace_name_copy(trace_locks[0].name, "other");
+    trace_nlocks = 1;
+  }
+  if (trace_nlocks == LWIP_SYS_TRACE_LOCKS) {
+    return 0;
+  }
+  trace_locks[i].kind = kind;
+  trace_name_copy(trace_locks[i].name, name);
+  trace_nlocks++;
+  return i;
+}
+
+/* Called in a critical section */
+static struct sys_trace_pair *
+trace_pair(u8_t lock, u8_t task)
+{
+  u8_t i;
+
+  for (i = 0; i < trace_npairs; i++) {
+    if (trace_pairs[i].lock == lock && trace_pairs[i].task == task) {
+      return &trace_pairs[i];
+    }
+  }
+  if (trace_npairs == LWIP_SYS_TRACE_PAIRS) {
+    return NULL;
+  }
+  trace_pairs[i].lock = lock;
+  trace_pairs[i].task = task;
+  trace_npairs++;
+  return &trace_pairs[i];
+}
+
+/* Called in a critical section */
+static void
+trace_edge_add(u8_t lock, u8_t waiter, u8_t owner, u32_t us)
+{
+  struct sys_trace_pair *p;
+  u8_t i;
+
+  if (owner == SYS_TRACE_NONE || owner == waiter) {
+    return;
+  }
+  p = trace_pair(lock, owner);
+  if (p) {
+    p->caused_us += us;
+  }
+  for (i = 0; i < trace_nedges; i++) {
+    if (trace_edges[i].lock == lock && trace_edges[i].waiter == waiter &&
+        trace_edges[i].owner == owner) {
+      break;
+    }
+  }
+  if (i == trace_nedges) {
+    if (trace_nedges == LWIP_SYS_TRACE_EDGES) {
+      return;
+    }
+    trace_edges[i].lock = lock;
+    trace_edges[i].waiter = waiter;
+    trace_edges[i].owner = owner;
+    trace_nedges++;
+  }
+  trace_edges[i].count++;
+  trace_edges[i].wait_us += us;
+}
+
+/* Called in a critical section */
+static void
+trace_event_add(u32_t t, u32_t us, u8_t lock, u8_t task, u8_t type, u8_t owner)
+{
+  struct sys_trace_event *ev;
+
+  if (us < LWIP_SYS_TRACE_EVENT_US) {
+    return;
+  }
+  ev = &trace_events[trace_event_next];
+  ev->t = t;
+  ev->dur = us;
+  ev->lock = lock;
+  ev->task = task;
+  ev->type = type;
+  ev->owner = owner;
+  trace_event_next = (trace_event_next + 1) % LWIP_SYS_TRACE_EVENTS;
+  if (trace_event_count < LWIP_SYS_TRACE_EVENTS) {
+    trace_event_count++;
+  }
+}
+
+/* Called in a critical section */
+static void
+trace_wait(u8_t lock, u8_t task, u32_t t0, u32_t us, int contended, u8_t owner)
+{
+  struct sys_trace_lock *l = &trace_locks[lock];
+  struct sys_trace_pair *p = trace_pair(lock, task);
+
+  l->count++;
+  if (p) {
+    p->count++;
+  }
+  if (!contended) {
+    return;
+  }
+  l->contended++;
+  l->wait_us += us;
+  if (us > l->wait_max_us) {
+    l->wait_max_us = us;
+  }
+  trace_hist_add(l->wait_hist, us);
+  if (p) {
+    p->contended++;
+    p->wait_us += us;
+    if (us > p->wait_max_us) {
+      p->wait_max_us = us;
+    }
+  }
+  trace_edge_add(lock, task, owner, us);
+  trace_event_add(t0, us, lock, task, SYS_TRACE_WAIT, owner);
+}
+
+/* Called in a critical section */
+static void
+trace_hold(u8_t lock, u8_t task, u32_t t0, u32_t us)
+{
+  struct sys_trace_lock *l = &trace_locks[lock];
+  struct sys_trace_pair *p = trace_pair(lock, task);
+
+  l->hold_us += us;
+  if (us > l->hold_max_us) {
+    l->hold_max_us = us;
+  }
+  trace_hist_add(l->hold_hist, us);
+  if (p) {
+    p->hold_us += us;
+    if (us > p->hold_max_us) {
+      p->hold_max_us = us;
+    }
+  }
+  trace_event_add(t0, us, lock, task, SYS_TRACE_HOLD, SYS_TRACE_NONE);
+}
+
+void
+sys_trace_new(struct sys_trace_obj *obj, u8_t kind, const char *name)
+{
+  if (name == NULL) {
+    /* no task before the scheduler has a task to run */
+    name = xTaskGetCurrentTaskHandle() ? pcTaskGetName(NULL) : "init";
+  }
+  taskENTER_CRITICAL();
+  obj->lock = trace_lock_id(kind, name);
+  obj->owner = SYS_TRACE_NONE;
+  obj->depth = 0;
+  obj->since = 0;
+  taskEXIT_CRITICAL();
+}
+
+void
+sys_trace_thread(const char *name, void *handle)
+{
+  if (name != NULL && strcmp(name, TCPIP_THREAD_NAME) == 0) {
+    trace_tcpip_thread = handle;
+  }
+}
+
+u32_t
+sys_trace_begin(void)
+{
+  if (!trace_on) {
+    return 0;
+  }
+  /* 0 stands for not traced */
+  return LWIP_SYS_TRACE_NOW_US() | 1;
+}
+
+void
+sys_trace_locked(struct sys_trace_obj *obj, u32_t t0, u8_t owner)
+{
+  u32_t now;
+
+  if (!t0) {
+    return;
+  }
+  now = LWIP_SYS_TRACE_NOW_US();
+  taskENTER_CRITICAL();
+  if (obj->depth++ == 0) {
+    u8_t task = trace_task_id();
+    if (trace_on) {
+      trace_wait(obj->lock, task, t0, trace_elapsed(t0, now),
+                 owner != SYS_TRACE_NONE, owner);
+    }
+    obj->owner = task;
+    obj->since = now | 1;
+  }
+  taskEXIT_CRITICAL();
+}
+
+void
+sys_trace_unlocked(struct sys_trace_obj *obj)
+{
+  u32_t now;
+
+  if (obj->depth == 0) {
+    return;
+  }
+  now = LWIP_SYS_TRACE_NOW_US();
+  taskENTER_CRITICAL();
+  if (obj->depth > 0 && --obj->depth == 0) {
+    if (trace_on) {
+      trace_hold(obj->lock, obj->owner, obj->since, trace_elapsed(obj->since, now));
+    }
+    obj->since = 0;
+  }
+  taskEXIT_CRITICAL();
+}
+
+void
+sys_trace_signaled(struct sys_trace_obj *obj)
+{
+  if (!trace_on) {
+    return;
+  }
+  taskENTER_CRITICAL();
+  obj->owner = trace_task_id();
+  taskEXIT_CRITICAL();
+}
+
+void
+sys_trace_waited(struct sys_trace_obj *obj, u32_t t0)
+{
+  u32_t now;
+
+  if (!t0) {
+    return;
+  }
+  now = LWIP_SYS_TRACE_NOW_US();
+  taskENTER_CRITICAL();
+  if (trace_on) {
+    /* the owner of a semaphore is the task that signaled it last */
+    trace_wait(obj->lock, trace_task_id(), t0, trace_elapsed(t0, now), 1, obj->owner);
+  }
+  taskEXIT_CRITICAL();
+}
+
+void
+sys_trace_posted(struct sys_trace_obj *obj, u32_t t0, int blocked, u32_t queued)
+{
+  struct sys_trace_lock *l = &trace_locks[obj->lock];
+  u32_t now;
+
+  if (!t0) {
+    return;
+  }
+  now = LWIP_SYS_TRACE_NOW_US();
+  taskENTER_CRITICAL();
+  if (trace_on) {
+    if (queued > l->depth_max) {
+      l->depth_max = (u8_t)LWIP_MIN(queued, 0xff);
+    }
+    if (blocked) {
+      /* on a full mailbox, blocked by the task fetching from it */
+      trace_wait(obj->lock, trace_task_id(), t0, trace_elapsed(t0, now), 1, obj->owner);
+    }
+  }
+  taskEXIT_CRITICAL();
+}
+
+u32_t
+sys_trace_fetch_begin(struct sys_trace_obj *obj)
+{
+  u32_t now;
+
+  if (obj->since == 0 && !trace_on) {
+    return 0;
+  }
+  now = LWIP_SYS_TRACE_NOW_US();
+  taskENTER_CRITICAL();
+  if (trace_tcpip_thread != NULL && xTaskGetCurrentTaskHandle() == trace_tcpip_thread &&
+      obj->lock != trace_tcpip_lock) {
+    if (trace_tcpip_lock == SYS_TRACE_NONE) {
+      trace_tcpip_lock = trace_lock_id(SYS_TRACE_MBOX, "tcpip");
+    }
+    obj->lock = trace_tcpip_lock;
+    obj->since = 0;
+  }
+  if (obj->since != 0) {
+    /* the time spent on the previous message */
+    if (trace_on && obj->owner != SYS_TRACE_NONE) {
+      trace_hold(obj->lock, obj->owner, obj->since, trace_elapsed(obj->since, now));
+    }
+    obj->since = 0;
+  }
+  taskEXIT_CRITICAL();
+  return trace_on ? (now | 1) : 0;
+}
+
+void
+sys_trace_fetched(struct sys_trace_obj *obj, u32_t t0)
+{
+  u32_t now;
+
+  if (!t0) {
+    return;
+  }
+  now = LWIP_SYS_TRACE_NOW_US();
+  taskENTER_CRITICAL();
+  obj->owner = trace_task_id();
+  if (trace_on) {
+    /* waiting for a message is idle time, not blocked by anyone */
+    trace_wait(obj->lock, obj->owner, t0, trace_elapsed(t0, now), 1, SYS_TRACE_NONE);
+    obj->since = now | 1;
+  }
+  taskEXIT_CRITICAL();
+}
+
+void
+sys_trace_enable(int on)
+{
+  if (on && !trace_on && trace_start == 0) {
+    trace_start = LWIP_SYS_TRACE_NOW_US() | 1;
+  }
+  trace_on = on;
+}
+
+int
+sys_trace_enabled(void)
+{
+  return trace_on;
+}
+
+void
+sys_trace_reset(void)
+{
+  u8_t i;
+
+  taskENTER_CRITICAL();
+  for (i = 0; i < trace_nlocks; i++) {
+    struct sys_trace_lock *l = &trace_locks[i];
+    l->depth_max = 0;
+    l->count = l->contended = 0;
+    l->wait_us = l->wait_max_us = 0;
+    l->hold_us = l->hold_max_us = 0;
+    memset(l->wait_hist, 0, sizeof(l->wait_hist));
+    memset(l->hold_hist, 0, sizeof(l->hold_hist));
+  }
+  trace_npairs = 0;
+  trace_nedges = 0;
+  trace_event_next = 0;
+  trace_event_count = 0;
+  trace_start = LWIP_SYS_TRACE_NOW_US() | 1;
+  taskEXIT_CRITICAL();
+}
+
+static const char *
+trace_task_name(u8_t task)
+{
+  if (task == SYS_TRACE_NONE) {
+    return "-";
+  }
+  return trace_tasks[task].name;
+}
+
+void
+sys_trace_show(sys_trace_out_fn out, void *arg)
+{
+  char line[128];
+  u8_t i;
+
+  snprintf(line, sizeof(line), "%-12s %-5s %8s %8s %10s %8s %10s %8s %5s",
+           "class", "kind", "count", "blocked", "wait_us", "max", "hold_us", "max", "depth");
+  out(line, arg);
+  for (i = 0; i < trace_nlocks; i++) {
+    const struct sys_trace_lock *l = &trace_locks[i];
+    if (l->count == 0 && l->hold_us == 0) {
+      continue;
+    }
+    snprintf(line, sizeof(line), "%-12s %-5s %8lu %8lu %10lu %8lu %10lu %8lu %5u",
+             l->name, trace_kinds[l->kind], (unsigned long)l->count,
+             (unsigned long)l->contended, (unsigned long)l->wait_us,
+             (unsigned long)l->wait_max_us, (unsigned long)l->hold_us,
+             (unsigned long)l->hold_max_us, l->depth_max);
+    out(line, arg);
+  }
+}
+
+/* Index of the n largest values, by selection, the tables are small */
+static int
+trace_rank(u32_t (*value)(int i), int total, u8_t *rank, int n)
+{
+  int count = 0;
+  int i, j;
+
+  while (count < n) {
+    int best = -1;
+    for (i = 0; i < total; i++) {
+      for (j = 0; j < count; j++) {
+        if (rank[j] == i) {
+          break;
+        }
+      }
+      if (j < count || value(i) == 0) {
+        continue;
+      }
+      if (best < 0 || value(i) > value(best)) {
+        best = i;
+      }
+    }
+    if (best < 0) {
+      break;
+    }
+    rank[count++] = (u8_t)best;
+  }
+  return count;
+}
+
+static u32_t
+trace_pair_wait(int i)
+{
+  /* the tcpip thread waiting for messages is idle, not blocked */
+  return trace_pairs[i].lock == trace_tcpip_lock ? 0 : trace_pairs[i].wait_us;
+}
+
+static u32_t
+trace_pair_caused(int i)
+{
+  return trace_pairs[i].caused_us;
+}
+
+static u8_t trace_tcpip_task;
+
+static u32_t
+trace_edge_tcpip(int i)
+{
+  return trace_edges[i].waiter == trace_tcpip_task ? trace_edges[i].wait_us : 0;
+}
+
+void
+sys_trace_top(sys_trace_out_fn out, void *arg, int n)
+{
+  u8_t rank[LWIP_SYS_TRACE_PAIRS];
+  char line[128];
+  int count, i;
+
+  if (n <= 0 || n > LWIP_SYS_TRACE_PAIRS) {
+    n = LWIP_SYS_TRACE_PAIRS;
+  }
+
+  out("waited the most:", arg);
+  count = trace_rank(trace_pair_wait, trace_npairs, rank, n);
+  for (i = 0; i < count; i++) {
+    const struct sys_trace_pair *p = &trace_pairs[rank[i]];
+    snprintf(line, sizeof(line), "  %-12s on %-12s %10lu us %6lu times, max %lu us",
+             trace_task_name(p->task), trace_locks[p->lock].name, (unsigned long)p->wait_us,
+             (unsigned long)p->contended, (unsigned long)p->wait_max_us);
+    out(line, arg);
+  }
+
+  out("made others wait the most:", arg);
+  count = trace_rank(trace_pair_caused, trace_npairs, rank, n);
+  for (i = 0; i < count; i++) {
+    const struct sys_trace_pair *p = &trace_pairs[rank[i]];
+    snprintf(line, sizeof(line), "  %-12s on %-12s %10lu us, held %lu us, max %lu us",
+             trace_task_name(p->task), trace_locks[p->lock].name, (unsigned long)p->caused_us,
+             (unsigned long)p->hold_us, (unsigned long)p->hold_max_us);
+    out(line, arg);
+  }
+
+  trace_tcpip_task = SYS_TRACE_NONE;
+  for (i = 1; i < trace_ntasks; i++) {
+    if (trace_tasks[i].handle == trace_tcpip_thread) {
+      trace_tcpip_task = (u8_t)i;
+    }
+  }
+  out("blocked the tcpip thread:", arg);
+  count = trace_rank(trace_edge_tcpip, trace_nedges, rank, LWIP_MIN(n, LWIP_SYS_TRACE_EDGES));
+  for (i = 0; i < count; i++) {
+    const struct sys_trace_edge *e = &trace_edges[rank[i]];
+    snprintf(line, sizeof(line), "  %-12s on %-12s %10lu us %6lu times",
+             trace_task_name(e->owner), trace_locks[e->lock].name, (unsigned long)e->wait_us,
+             (unsigned long)e->count);
+    out(line, arg);
+  }
+}
+
+static int
+trace_hist_line(char *line, size_t size, const char *head, const u16_t *hist)
+{
+  int len = snprintf(line, size, "%s", head);
+  u8_t b;
+
+  for (b = 0; b < LWIP_SYS_TRACE_BUCKETS && len < (int)size; b++) {
+    len += snprintf(line + len, size - len, " %u", hist[b]);
+  }
+  return len;
+}
+
+int
+sys_trace_hist(sys_trace_out_fn out, void *arg, const char *name)
+{
+  const struct sys_trace_lock *l = NULL;
+  char line[128];
+  int len;
+  u8_t i, b;
+
+  for (i = 0; i < trace_nlocks; i++) {
+    if (strcmp(trace_locks[i].name, name) == 0) {
+      l = &trace_locks[i];
+      break;
+    }
+  }
+  if (l == NULL) {
+    return -1;
+  }
+
+  len = snprintf(line, sizeof(line), "us   ");
+  for (b = 0; b < LWIP_SYS_TRACE_BUCKETS - 1 && len < (int)sizeof(line); b++) {
+    len += snprintf(line + len, sizeof(line) - len, " <%lu", 4UL << b);
+  }
+  snprintf(line + len, sizeof(line) - len, " more");
+  out(line, arg);
+  trace_hist_line(line, sizeof(line), "wait ", l->wait_hist);
+  out(line, arg);
+  trace_hist_line(line, sizeof(line), "hold ", l->hold_hist);
+  out(line, arg);
+  return 0;
+}
+
+void
+sys_trace_export(sys_trace_out_fn out, void *arg)
+{
+  int was_on = trace_on;
+  char line[128];
+  u16_t first, n;
+  u8_t i;
+
+  trace_on = 0;
+
+  snprintf(line, sizeof(line), "LOCKTRACE %d %lu", LWIP_SYS_TRACE_VERSION,
+           (unsigned long)trace_elapsed(trace_start, LWIP_SYS_TRACE_NOW_US()));
+  out(line, arg);
+
+  for (i = 0; i < trace_ntasks; i++) {
+    snprintf(line, sizeof(line), "TASK %u %s%s", i, trace_tasks[i].name,
+             i && trace_tasks[i].handle == trace_tcpip_thread ? " tcpip" : "");
+    out(line, arg);
+  }
+
+  for (i = 0; i < trace_nlocks; i++) {
+    const struct sys_trace_lock *l = &trace_locks[i];
+    snprintf(line, sizeof(line), "LOCK %u %s %s %lu %lu %lu %lu %lu %lu %u", i,
+             trace_kinds[l->kind], l->name, (unsigned long)l->count,
+             (unsigned long)l->contended, (unsigned long)l->wait_us,
+             (unsigned long)l->wait_max_us, (unsigned long)l->hold_us,
+             (unsigned long)l->hold_max_us, l->depth_max);
+    out(line, arg);
+  }
+
+  for (i = 0; i < trace_npairs; i++) {
+    const struct sys_trace_pair *p = &trace_pairs[i];
+    snprintf(line, sizeof(line), "PAIR %u %u %lu %lu %lu %lu %lu %lu %lu", p->lock, p->task,
+             (unsigned long)p->count, (unsigned long)p->contended, (unsigned long)p->wait_us,
+             (unsigned long)p->wait_max_us, (unsigned long)p->hold_us,
+             (unsigned long)p->hold_max_us, (unsigned long)p->caused_us);
+    out(line, arg);
+  }
+
+  for (i = 0; i < trace_nedges; i++) {
+    const struct sys_trace_edge *e = &trace_edges[i];
+    snprintf(line, sizeof(line), "EDGE %u %u %u %lu %lu", e->lock, e->waiter, e->owner,
+             (unsigned long)e->count, (unsigned long)e->wait_us);
+    out(line, arg);
+  }
+
+  for (i = 0; i < trace_nlocks; i++) {
+    char head[16];
+    snprintf(head, sizeof(head), "HIST %u wait", i);
+    trace_hist_line(line, sizeof(line), head, trace_locks[i].wait_hist);
+    out(line, arg);
+    snprintf(head, sizeof(head), "HIST %u hold", i);
+    trace_hist_line(line, sizeof(line), head, trace_locks[i].hold_hist);
+    out(line, arg);
+  }
+
+  /* oldest first, relative to the reset */
+  first = (trace_event_next + LWIP_SYS_TRACE_EVENTS - trace_event_count) % LWIP_SYS_TRACE_EVENTS;
+  for (n = 0; n < trace_event_count; n++) {
+    const struct sys_trace_event *ev = &trace_events[(first + n) % LWIP_SYS_TRACE_EVENTS];
+    snprintf(line, sizeof(line), "EV %lu %lu %u %u %s %d",
+             (unsigned long)trace_elapsed(trace_start, ev->t), (unsigned long)ev->dur,
+             ev->lock, ev->task, ev->type == SYS_TRACE_WAIT ? "wait" : "hold",
+             ev->owner == SYS_TRACE_NONE ? -1 : ev->owner);
+    out(line, arg);
+  }
+
+  out("END", arg);
+  trace_on = was_on;
+}
+
+#endif /* LWIP_SYS_TRACE */
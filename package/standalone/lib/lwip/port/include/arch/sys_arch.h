@@ -40,6 +40,7 @@
 
 #include "lwip/opt.h"
 #include "lwip/arch.h"
+#include "arch/sys_arch_trace.h"
 
 /** This is returned by _fromisr() sys functions to tell the outermost function
  * that a higher priority task was woken and the scheduler needs to be invoked.
@@ -61,6 +62,9 @@ typedef u32_t sys_prot_t;
 #if !LWIP_COMPAT_MUTEX
 struct _sys_mut {
   void *mut;
+#if LWIP_SYS_TRACE
+  struct sys_trace_obj trace;
+#endif
 };
 typedef struct _sys_mut sys_mutex_t;
 #define sys_mutex_valid_val(mutex)   ((mutex).mut != NULL)
@@ -70,6 +74,9 @@ typedef struct _sys_mut sys_mutex_t;
 
 struct _sys_sem {
   void *sem;
+#if LWIP_SYS_TRACE
+  struct sys_trace_obj trace;
+#endif
 };
 typedef struct _sys_sem sys_sem_t;
 #define sys_sem_valid_val(sema)   ((sema).sem != NULL)
@@ -78,6 +85,9 @@ typedef struct _sys_sem sys_sem_t;
 
 struct _sys_mbox {
   void *mbx;
+#if LWIP_SYS_TRACE
+  struct sys_trace_obj trace;
+#endif
 };
 typedef struct _sys_mbox sys_mbox_t;
 #define sys_mbox_valid_val(mbox)   ((mbox).mbx != NULL)
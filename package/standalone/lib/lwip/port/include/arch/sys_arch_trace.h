@@ -0,0 +1,262 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef LWIP_ARCH_SYS_ARCH_TRACE_H
+#define LWIP_ARCH_SYS_ARCH_TRACE_H
+
+/*
+ * Wait and hold times of the sys_arch mutexes, semaphores and mailboxes,
+ * per object class and per task. Built with LWIP_SYS_TRACE, recording
+ * starts with sys_trace_enable(1).
+ *
+ * An object class is what the times are summed under:
+ *   - "core", the lwIP core lock (LOCK_TCPIP_CORE), and "protect", the
+ *     mutex of SYS_ARCH_PROTECT
+ *   - "tcpip", the mailbox the tcpip thread fetches from
+ *   - otherwise the kind and the task that created the object, e.g. the
+ *     netconn semaphores and mailboxes of the sockets of a task
+ *
+ * What is measured:
+ *   mutex  wait  blocked in sys_mutex_lock(), when the mutex was taken
+ *          hold  lock to unlock
+ *   sem    wait  blocked in sys_arch_sem_wait(), charged to the task
+ *                that signals it
+ *   mbox   wait  blocked in sys_arch_mbox_fetch(), or in sys_mbox_post()
+ *                on a full mailbox
+ *          hold  a fetch to the next fetch of the same task, the time
+ *                spent on the message
+ *
+ * A wait on a held mutex is also charged to the task holding it, so that
+ * the report names who blocks whom, the tcpip thread in particular. Waits
+ * and holds longer than LWIP_SYS_TRACE_EVENT_US also go to a ring of
+ * events, exported with the totals for lib/lwip/tools/lwip_locktrace.py:
+ *
+ *   LOCKTRACE <version> <us since the reset>
+ *   TASK <id> <name> [tcpip]
+ *   LOCK <id> <mutex|sem|mbox> <name> <count> <contended> <wait us> <wait max>
+ *        <hold us> <hold max> <depth max>
+ *   PAIR <lock> <task> <count> <contended> <wait us> <wait max> <hold us>
+ *        <hold max> <caused us>
+ *   EDGE <lock> <waiter> <owner> <count> <wait us>
+ *   HIST <lock> wait|hold <count per bucket>
+ *   EV <start us> <duration us> <lock> <task> wait|hold <owner, -1 for none>
+ *   END
+ *
+ * Bucket b of the histograms counts the times below 2^(b+2) us, the last
+ * one everything longer.
+ */
+
+#include "lwip/opt.h"
+#include "lwip/arch.h"
+
+#ifndef LWIP_SYS_TRACE
+#define LWIP_SYS_TRACE                0
+#endif
+
+#if LWIP_SYS_TRACE
+
+#define LWIP_SYS_TRACE_VERSION        1
+
+/* Object classes, the first one takes what does not fit */
+#ifndef LWIP_SYS_TRACE_LOCKS
+#define LWIP_SYS_TRACE_LOCKS          24
+#endif
+
+/* Tasks told apart, the first one takes what does not fit */
+#ifndef LWIP_SYS_TRACE_TASKS
+#define LWIP_SYS_TRACE_TASKS          16
+#endif
+
+/* Class and task pairs */
+#ifndef LWIP_SYS_TRACE_PAIRS
+#define LWIP_SYS_TRACE_PAIRS          48
+#endif
+
+/* Class, waiter and holder triples */
+#ifndef LWIP_SYS_TRACE_EDGES
+#define LWIP_SYS_TRACE_EDGES          32
+#endif
+
+#ifndef LWIP_SYS_TRACE_EVENTS
+#define LWIP_SYS_TRACE_EVENTS         128
+#endif
+
+/* Shortest wait or hold kept as an event */
+#ifndef LWIP_SYS_TRACE_EVENT_US
+#define LWIP_SYS_TRACE_EVENT_US       100
+#endif
+
+#define LWIP_SYS_TRACE_BUCKETS        12
+#define LWIP_SYS_TRACE_NAME_LEN       12
+
+/* No task */
+#define SYS_TRACE_NONE                0xff
+
+enum sys_trace_kind {
+  SYS_TRACE_MUTEX,
+  SYS_TRACE_SEM,
+  SYS_TRACE_MBOX
+};
+
+/* In each sys_mutex_t, sys_sem_t and sys_mbox_t */
+struct sys_trace_obj {
+  u8_t lock;          /* class */
+  u8_t owner;         /* task holding the mutex, last signaling the
+                         semaphore, or last fetching from the mailbox */
+  u8_t depth;         /* recursive locks */
+  u32_t since;        /* lock or fetch time */
+};
+
+struct sys_trace_lock {
+  char name[LWIP_SYS_TRACE_NAME_LEN];
+  u8_t kind;
+  u8_t depth_max;     /* messages queued in a mailbox */
+  u32_t count;        /* locks, waits, fetches, blocked posts */
+  u32_t contended;    /* of which had to block */
+  u32_t wait_us;
+  u32_t wait_max_us;
+  u32_t hold_us;
+  u32_t hold_max_us;
+  u16_t wait_hist[LWIP_SYS_TRACE_BUCKETS];
+  u16_t hold_hist[LWIP_SYS_TRACE_BUCKETS];
+};
+
+struct sys_trace_pair {
+  u8_t lock;
+  u8_t task;
+  u32_t count;
+  u32_t contended;
+  u32_t wait_us;
+  u32_t wait_max_us;
+  u32_t hold_us;
+  u32_t hold_max_us;
+  u32_t caused_us;    /* others waited this long while the task held it */
+};
+
+/* Called with each line of a report, without the line end */
+typedef void (*sys_trace_out_fn)(const char *line, void *arg);
+
+/*
+ * sys_arch.c hooks. sys_trace_begin() returns the start of a wait, 0 when
+ * not recording, and the other hooks then return at once. 'owner' is the
+ * task holding a mutex found taken, read with sys_trace_holder() before
+ * blocking, SYS_TRACE_NONE if it was free.
+ */
+#define sys_trace_holder(obj)   ((obj)->owner)
+
+void sys_trace_new(struct sys_trace_obj *obj, u8_t kind, const char *name);
+u32_t sys_trace_begin(void);
+void sys_trace_locked(struct sys_trace_obj *obj, u32_t t0, u8_t owner);
+void sys_trace_unlocked(struct sys_trace_obj *obj);
+void sys_trace_signaled(struct sys_trace_obj *obj);
+void sys_trace_waited(struct sys_trace_obj *obj, u32_t t0);
+void sys_trace_posted(struct sys_trace_obj *obj, u32_t t0, int blocked, u32_t queued);
+u32_t sys_trace_fetch_begin(struct sys_trace_obj *obj);
+void sys_trace_fetched(struct sys_trace_obj *obj, u32_t t0);
+void sys_trace_thread(const char *name, void *handle);
+
+/*********************************************************************
+ * @fn sys_trace_enable
+ *
+ * @brief Start or stop recording
+ *
+ * @param on
+ *
+ * @return none
+ **********************************************************************/
+void sys_trace_enable(int on);
+
+/*********************************************************************
+ * @fn sys_trace_enabled
+ *
+ * @brief Whether recording is on
+ *
+ * @return 1 or 0
+ **********************************************************************/
+int sys_trace_enabled(void);
+
+/*********************************************************************
+ * @fn sys_trace_reset
+ *
+ * @brief Clear the totals and the events, keep the classes and tasks
+ *
+ * @return none
+ **********************************************************************/
+void sys_trace_reset(void);
+
+/*********************************************************************
+ * @fn sys_trace_show
+ *
+ * @brief Print the totals of each class
+ *
+ * @param out, arg: line output
+ *
+ * @return none
+ **********************************************************************/
+void sys_trace_show(sys_trace_out_fn out, void *arg);
+
+/*********************************************************************
+ * @fn sys_trace_top
+ *
+ * @brief Print the task and class pairs that waited the most, those
+ *        that made others wait the most, and what the tcpip thread
+ *        waited for
+ *
+ * @param out, arg: line output
+ *
+ * @param n: lines per list
+ *
+ * @return none
+ **********************************************************************/
+void sys_trace_top(sys_trace_out_fn out, void *arg, int n);
+
+/*********************************************************************
+ * @fn sys_trace_hist
+ *
+ * @brief Print the wait and hold histograms of a class
+ *
+ * @param out, arg: line output
+ *
+ * @param name: class name
+ *
+ * @return 0, -1 if there is no such class
+ **********************************************************************/
+int sys_trace_hist(sys_trace_out_fn out, void *arg, const char *name);
+
+/*********************************************************************
+ * @fn sys_trace_export
+ *
+ * @brief Print everything for lib/lwip/tools/lwip_locktrace.py.
+ *        Recording is paused meanwhile.
+ *
+ * @param out, arg: line output
+ *
+ * @return none
+ **********************************************************************/
+void sys_trace_export(sys_trace_out_fn out, void *arg);
+
+#endif /* LWIP_SYS_TRACE */
+
+#endif /* LWIP_ARCH_SYS_ARCH_TRACE_H */
@@ -32,6 +32,12 @@
 #ifndef __LWIPOPTS_H__
 #define __LWIPOPTS_H__
 
+/* Pool sizes generated by lib/lwip/tools/lwip_memprof.py, they take
+   precedence over the defaults below */
+#ifdef LWIP_TUNED_OPTS
+#include LWIP_TUNED_OPTS
+#endif
+
 #define TCPIP_THREAD_NAME           "tcpip"
 #define LWIP_HTTPD_MAX_TAG_NAME_LEN 20
 #define LWIP_HTTPD_MAX_TAG_INSERT_LEN 1024
@@ -85,8 +91,19 @@ extern int ip4_input_nat(struct pbuf *p, struct netif *inp);
 
 /* DNS is not going to be used as this is a simple local example. */
 #define LWIP_DNS						1
-#define DNS_TABLE_SIZE 1
+/* Names cached: the broker, FOTA, NTP and HTTP servers of an application */
+#ifndef DNS_TABLE_SIZE
+#define DNS_TABLE_SIZE 8
+#endif
 #define DNS_MAX_NAME_LENGTH 128
+/* Seconds an NXDOMAIN answer is kept */
+#ifndef DNS_NEG_TTL
+#define DNS_NEG_TTL 30
+#endif
+/* Names used in the last seconds of their TTL are asked again in the background */
+#ifndef DNS_PREFETCH_TTL
+#define DNS_PREFETCH_TTL 30
+#endif
 
 #define LWIP_HAVE_LOOPIF				0
 #define TCP_LISTEN_BACKLOG				1
@@ -182,17 +199,21 @@ this.
 
 /* MEM_SIZE: the size of the heap memory. If the application will send
 a lot of data that needs to be copied, this should be set high. */
+#ifndef MEM_SIZE
 #if defined(TS8266) || defined(TR6260) || defined(NRC7392)
 #define MEM_SIZE                4000
 #else
 #define MEM_SIZE                20000
 #endif
+#endif
 
 /* MEMP_NUM_PBUF: the number of memp struct pbufs. If the application
    sends a lot of data out of ROM (or other static memory), this
    should be set high. */
 //#define MEMP_NUM_PBUF           16
+#ifndef MEMP_NUM_PBUF
 #define MEMP_NUM_PBUF           100
+#endif
 
 /* MEMP_NUM_RAW_PCB: the number of UDP protocol control blocks. One
    per active RAW "connection". */
@@ -222,22 +243,30 @@ a lot of data that needs to be copied, this should be set high. */
 #endif
 /* MEMP_NUM_TCP_SEG: the number of simultaneously queued TCP
    segments. */
+#ifndef MEMP_NUM_TCP_SEG
 #define MEMP_NUM_TCP_SEG       2*TCP_SND_QUEUELEN //  8
+#endif
 /* MEMP_NUM_SYS_TIMEOUT: the number of simulateously active
    timeouts. */
+#ifndef MEMP_NUM_SYS_TIMEOUT
 #define MEMP_NUM_SYS_TIMEOUT    20
+#endif
 
 
 /* The following four are used only with the sequential API and can be
    set to 0 if the application only will use the raw API. */
 /* MEMP_NUM_NETBUF: the number of struct netbufs. */
+#ifndef MEMP_NUM_NETBUF
 #define MEMP_NUM_NETBUF         MEMP_NUM_TCP_PCB
+#endif
 /* MEMP_NUM_NETCONN: the number of struct netconns. */
 #define MEMP_NUM_NETCONN        MEMP_NUM_TCP_PCB
 /* MEMP_NUM_APIMSG: the number of struct api_msg, used for
    communication between the TCP/IP stack and the sequential
    programs. */
+#ifndef MEMP_NUM_API_MSG
 #define MEMP_NUM_API_MSG        8
+#endif
 /* MEMP_NUM_TCPIPMSG: the number of struct tcpip_msg, which is used
    for sequential API communication and incoming packets. Used in
    src/api/tcpip.c. */
@@ -261,11 +290,13 @@ a lot of data that needs to be copied, this should be set high. */
 
 /* ---------- Pbuf options ---------- */
 /* PBUF_POOL_SIZE: the number of buffers in the pbuf pool. */
+#ifndef PBUF_POOL_SIZE
 #if defined(TS8266) || defined(TR6260) || defined(NRC7392)
 #define PBUF_POOL_SIZE          5
 #else
 #define PBUF_POOL_SIZE          12
 #endif
+#endif
 
 /* PBUF_POOL_BUFSIZE: the size of each pbuf in the pbuf pool. */
 #define PBUF_POOL_BUFSIZE       1600
@@ -290,14 +321,19 @@ a lot of data that needs to be copied, this should be set high. */
 #endif
 
 /* TCP sender buffer space (bytes). */
+#ifndef TCP_SND_BUF
 #define TCP_SND_BUF             (4 * TCP_MSS)
+#endif
 
 /* TCP sender buffer space (pbufs). This must be at least = 2 *
    TCP_SND_BUF/TCP_MSS for things to work. */
 #define TCP_SND_QUEUELEN        6 * TCP_SND_BUF/TCP_MSS
 
-/* TCP receive window. */
+/* TCP receive window, within what the pbuf pool holds (init.c checks it):
+   well below 64 KB, so without window scaling. */
+#ifndef TCP_WND
 #define TCP_WND                 (4 * TCP_MSS)
+#endif
 
 /* Maximum number of retransmissions of data segments. */
 #define TCP_MAXRTX              12
@@ -308,6 +344,21 @@ a lot of data that needs to be copied, this should be set high. */
 /* LWIP_TCP_SACK_OUT==1: TCP will support sending selective acknowledgements (SACKs) */
 #define LWIP_TCP_SACK_OUT               1
 
+/* LWIP_TCP_SACK_IN==1: Recover from losses with the peer's SACKs (tcp_sack.c) */
+#ifndef LWIP_TCP_SACK_IN
+#define LWIP_TCP_SACK_IN                1
+#endif
+
+/* LWIP_TCP_RACK==1: Time-based loss detection and tail loss probes (RACK-TLP) */
+#ifndef LWIP_TCP_RACK
+#define LWIP_TCP_RACK                   1
+#endif
+
+/* LWIP_TCP_CC==1: Congestion control per socket (TCP_CONGESTION), NewReno or Westwood+ */
+#ifndef LWIP_TCP_CC
+#define LWIP_TCP_CC                     1
+#endif
+
 /* TCP_WND_UPDATE_THRESHOLD: difference in window to trigger anexplicit window update and defined as LWIP_MIN((TCP_WND / 4), (TCP_MSS * 4)) in opt.h */
 #define TCP_WND_UPDATE_THRESHOLD        (TCP_WND/2)
 
@@ -328,7 +379,9 @@ a lot of data that needs to be copied, this should be set high. */
  * if they both deal with IP fragments */
 #define IP_REASSEMBLY			1
 #define IP_REASS_MAX_PBUFS		10
+#ifndef MEMP_NUM_REASSDATA
 #define MEMP_NUM_REASSDATA		10
+#endif
 #define IP_FRAG					1
 
 /* If defined to 1, IP options are allowed (but not parsed). If
@@ -401,6 +454,26 @@ a lot of data that needs to be copied, this should be set high. */
 /* LWIP_DHCPS==1: Enable dhcp server application */
 #define LWIP_DHCPS            1
 
+/* DHCPS_MAX_LEASE: addresses the dhcp server hands out, up to the 2007 AIDs of the soft AP */
+#ifndef DHCPS_MAX_LEASE
+#define DHCPS_MAX_LEASE       100
+#endif
+
+/* LWIP_RESUME==1: Enable saving the IPv4 state across deep sleep (lwip_resume.c) */
+#ifndef LWIP_RESUME
+#define LWIP_RESUME           1
+#endif
+
+/* LWIP_MEMPROF==1: Enable the memory pool profiler (lwip_memprof.c) */
+#ifndef LWIP_MEMPROF
+#define LWIP_MEMPROF          1
+#endif
+
+/* LWIP_SYS_TRACE==1: Trace the lock and mailbox waits of sys_arch.c (sys_arch_trace.c) */
+#ifndef LWIP_SYS_TRACE
+#define LWIP_SYS_TRACE        0
+#endif
+
 /* LWIP_BRIDGE==1: Enable bridge interface application */
 #define LWIP_BRIDGE            1
 
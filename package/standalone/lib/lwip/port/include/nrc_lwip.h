@@ -121,6 +121,16 @@ int wifi_station_dhcpc_status(int vif);
 int wifi_bridge_dhcpc_start(void);
 int wifi_bridge_dhcpc_stop(void);
 int wifi_bridge_dhcpc_status(void);
+#if LWIP_RESUME
+struct lwip_resume_info;
+int wifi_station_resume_save(int vif, u8_t *buf, u16_t len);
+int wifi_station_resume_restore(int vif, const u8_t *buf, u16_t len, u32_t elapsed,
+								struct lwip_resume_info *info);
+#endif
+#endif
+#if LWIP_RESUME && LWIP_DNS
+int wifi_dns_cache_save(u8_t *buf, u16_t len);
+int wifi_dns_cache_restore(const u8_t *buf, u16_t len, u32_t elapsed);
 #endif
 
 bool wifi_ifconfig(int argc, char *argv[]);
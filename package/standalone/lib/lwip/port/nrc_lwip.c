@@ -12,6 +12,9 @@
 #if LWIP_IPV4 && LWIP_DHCPS
 #include "dhcpserver/dhcpserver.h"
 #endif /* LWIP_IPV4 && LWIP_DHCPS */
+#if LWIP_RESUME
+#include "resume/lwip_resume.h"
+#endif /* LWIP_RESUME */
 #include "nrc_lwip.h"
 #if LWIP_DNS && LWIP_DHCPS
 #include "captdns.h"
@@ -342,6 +345,81 @@ int wifi_bridge_dhcpc_status(void)
 	return wifi_dhcpc_status(BRIDGE_INTERFACE);
 }
 
+#if LWIP_RESUME
+int wifi_station_resume_save(int vif, u8_t *buf, u16_t len)
+{
+	int ret;
+
+	if (vif != WLAN0_INTERFACE && vif != WLAN1_INTERFACE)
+		return -EINVAL;
+
+	LOCK_TCPIP_CORE();
+	ret = lwip_resume_save(nrc_netif_get_by_idx(vif), buf, len);
+	UNLOCK_TCPIP_CORE();
+
+	return ret;
+}
+
+int wifi_station_resume_restore(int vif, const u8_t *buf, u16_t len, u32_t elapsed,
+								struct lwip_resume_info *info)
+{
+	struct netif *target_if;
+	struct lwip_resume_info result;
+	err_t err;
+
+	if (vif != WLAN0_INTERFACE && vif != WLAN1_INTERFACE)
+		return -EINVAL;
+
+	target_if = nrc_netif_get_by_idx(vif);
+
+	LOCK_TCPIP_CORE();
+	if (wifi_dhcpc_status(vif)) {
+		dhcp_stop(target_if);
+		dhcp_cleanup(target_if);
+		dhcpc_start_flag[vif] = false;
+	}
+	err = lwip_resume_restore(target_if, buf, len, elapsed, &result);
+	/* a restored lease is renewed by the DHCP client like any other */
+	if (err == ERR_OK && result.dhcp)
+		dhcpc_start_flag[vif] = true;
+	UNLOCK_TCPIP_CORE();
+
+	if (info)
+		*info = result;
+
+	I(TT_NET, "%swlan%d resume %d, dhcp %d arp %d udp %d\n", module_name(), vif,
+		err, result.dhcp, result.arp, result.udp);
+
+	return err != ERR_OK ? -1 : 0;
+}
+#endif /* LWIP_RESUME */
+
+#if LWIP_RESUME && LWIP_DNS
+int wifi_dns_cache_save(u8_t *buf, u16_t len)
+{
+	int ret;
+
+	LOCK_TCPIP_CORE();
+	ret = dns_cache_save(buf, len);
+	UNLOCK_TCPIP_CORE();
+
+	return ret;
+}
+
+int wifi_dns_cache_restore(const u8_t *buf, u16_t len, u32_t elapsed)
+{
+	int ret;
+
+	LOCK_TCPIP_CORE();
+	ret = dns_cache_restore(buf, len, elapsed);
+	UNLOCK_TCPIP_CORE();
+
+	I(TT_NET, "%sdns cache resume %d\n", module_name(), ret);
+
+	return ret;
+}
+#endif /* LWIP_RESUME && LWIP_DNS */
+
 #endif /* LWIP_IPV4 && LWIP_DHCP */
 
 void reset_ip_address(int vif)
@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""
+Views of the lock traces of sys_arch_trace.c.
+
+With LWIP_SYS_TRACE (CONFIG_LWIP_SYS_TRACE=y), the "lwiplock export"
+console command prints the wait and hold times of the sys_arch mutexes,
+semaphores and mailboxes (see port/include/arch/sys_arch_trace.h):
+
+    LOCKTRACE 1 <us since the reset>
+    TASK <id> <name> [tcpip]
+    LOCK <id> <kind> <name> <count> <contended> <wait us> <wait max> <hold us> <hold max> <depth max>
+    PAIR <lock> <task> <count> <contended> <wait us> <wait max> <hold us> <hold max> <caused us>
+    EDGE <lock> <waiter> <owner> <count> <wait us>
+    HIST <lock> wait|hold <count per bucket>
+    EV <start us> <duration us> <lock> <task> wait|hold <owner>
+    END
+
+The last export found in a console log is used:
+
+    ./lwip_locktrace.py summary console.log
+        who blocks the tcpip thread, and the classes by wait time
+
+    ./lwip_locktrace.py folded console.log -o locks.folded
+        folded stacks "task;class;wait;owner <us>", for flamegraph.pl or
+        speedscope: the width of a frame is the time spent waiting for,
+        or holding, the class
+
+    ./lwip_locktrace.py chrome console.log -o locks.json
+        the events longer than LWIP_SYS_TRACE_EVENT_US as a timeline for
+        ui.perfetto.dev or chrome://tracing, a track per task
+"""
+
+import argparse
+import json
+import sys
+
+VERSION = 1
+
+KEYWORDS = ("LOCKTRACE", "TASK", "LOCK", "PAIR", "EDGE", "HIST", "EV", "END")
+
+
+class Trace:
+    def __init__(self, window_us):
+        self.window_us = window_us
+        self.tasks = {}
+        self.tcpip = None
+        self.locks = {}
+        self.pairs = []
+        self.edges = []
+        self.hist = {}
+        self.events = []
+
+    def task(self, i):
+        return self.tasks.get(i, "task%d" % i) if i >= 0 else "-"
+
+    def lock(self, i):
+        return self.locks[i]["name"] if i in self.locks else "lock%d" % i
+
+    def idle(self, lock, task):
+        """The tcpip thread waiting for its mailbox"""
+        return task == self.tcpip and self.lock(lock) == "tcpip"
+
+
+def parse(lines):
+    """Yield the complete exports found in console output"""
+    tr = None
+    for line in lines:
+        # the console may prefix the lines with a timestamp
+        f = line.split()
+        for i, word in enumerate(f):
+            if word in KEYWORDS:
+                f = f[i:]
+                break
+        if f and f[0] == "LOCKTRACE":
+            if int(f[1]) != VERSION:
+                raise ValueError("trace version %s, %d expected" % (f[1], VERSION))
+            tr = Trace(int(f[2]))
+            continue
+        if tr is None or not f:
+            continue
+        try:
+            if f[0] == "TASK":
+                tr.tasks[int(f[1])] = f[2]
+                if len(f) > 3 and f[3] == "tcpip":
+                    tr.tcpip = int(f[1])
+            elif f[0] == "LOCK":
+                v = [int(x) for x in f[4:11]]
+                tr.locks[int(f[1])] = dict(kind=f[2], name=f[3], count=v[0], contended=v[1],
+                                           wait=v[2], wait_max=v[3], hold=v[4],
+                                           hold_max=v[5], depth=v[6])
+            elif f[0] == "PAIR":
+                v = [int(x) for x in f[1:10]]
+                tr.pairs.append(dict(lock=v[0], task=v[1], count=v[2], contended=v[3],
+                                     wait=v[4], wait_max=v[5], hold=v[6], hold_max=v[7],
+                                     caused=v[8]))
+            elif f[0] == "EDGE":
+                v = [int(x) for x in f[1:6]]
+                tr.edges.append(dict(lock=v[0], waiter=v[1], owner=v[2], count=v[3],
+                                     wait=v[4]))
+            elif f[0] == "HIST":
+                tr.hist[(int(f[1]), f[2])] = [int(x) for x in f[3:]]
+            elif f[0] == "EV":
+                tr.events.append(dict(t=int(f[1]), dur=int(f[2]), lock=int(f[3]),
+                                      task=int(f[4]), type=f[5], owner=int(f[6])))
+            elif f[0] == "END":
+                yield tr
+                tr = None
+            else:
+                tr = None
+        except (IndexError, ValueError):
+            # a line cut by other console output, drop the export
+            tr = None
+
+
+def load(path):
+    with open(path, errors="replace") as f:
+        traces = list(parse(f))
+    if not traces:
+        sys.exit("%s: no complete 'lwiplock export' output" % path)
+    return traces[-1]
+
+
+def output(path, text):
+    if path:
+        with open(path, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+def cmd_summary(args):
+    tr = load(args.log)
+    out = []
+    window = max(tr.window_us, 1)
+
+    out.append("window %.3f s" % (tr.window_us / 1e6))
+    out.append("")
+    if tr.tcpip is None:
+        out.append("tcpip thread not seen")
+    else:
+        edges = sorted((e for e in tr.edges if e["waiter"] == tr.tcpip),
+                       key=lambda e: -e["wait"])
+        blocked = sum(e["wait"] for e in edges)
+        out.append("tcpip thread blocked %d us (%.1f%%) by:" % (blocked, 100.0 * blocked / window))
+        for e in edges[:args.top]:
+            out.append("  %-12s holding %-12s %10d us %6d times" %
+                       (tr.task(e["owner"]), tr.lock(e["lock"]), e["wait"], e["count"]))
+        busy = [p for p in tr.pairs if tr.idle(p["lock"], p["task"])]
+        if busy:
+            p = busy[0]
+            out.append("tcpip thread on its messages %d us (%.1f%%), longest %d us" %
+                       (p["hold"], 100.0 * p["hold"] / window, p["hold_max"]))
+    out.append("")
+
+    out.append("%-12s %-5s %8s %8s %10s %8s %10s %8s" %
+               ("class", "kind", "count", "blocked", "wait_us", "max", "hold_us", "max"))
+    for l in sorted(tr.locks.values(), key=lambda l: -l["wait"]):
+        if l["count"] == 0 and l["hold"] == 0:
+            continue
+        out.append("%-12s %-5s %8d %8d %10d %8d %10d %8d" %
+                   (l["name"], l["kind"], l["count"], l["contended"], l["wait"],
+                    l["wait_max"], l["hold"], l["hold_max"]))
+    out.append("")
+
+    out.append("made others wait the most:")
+    for p in sorted(tr.pairs, key=lambda p: -p["caused"])[:args.top]:
+        if p["caused"] == 0:
+            break
+        out.append("  %-12s on %-12s %10d us, held %d us, max %d us" %
+                   (tr.task(p["task"]), tr.lock(p["lock"]), p["caused"], p["hold"],
+                    p["hold_max"]))
+    output(args.output, "\n".join(out) + "\n")
+
+
+def cmd_folded(args):
+    tr = load(args.log)
+    stacks = {}
+
+    def add(frames, us):
+        if us > 0:
+            key = ";".join(frames)
+            stacks[key] = stacks.get(key, 0) + us
+
+    for p in tr.pairs:
+        task, lock = tr.task(p["task"]), tr.lock(p["lock"])
+        if tr.idle(p["lock"], p["task"]):
+            add([task, lock, "idle"], p["wait"])
+        else:
+            # the waits with a known owner are split by owner
+            known = 0
+            for e in tr.edges:
+                if e["lock"] == p["lock"] and e["waiter"] == p["task"]:
+                    add([task, lock, "wait", tr.task(e["owner"])], e["wait"])
+                    known += e["wait"]
+            add([task, lock, "wait"], p["wait"] - known)
+        add([task, lock, "hold"], p["hold"])
+
+    output(args.output, "".join("%s %d\n" % kv for kv in sorted(stacks.items())))
+
+
+def cmd_chrome(args):
+    tr = load(args.log)
+    events = []
+
+    for i, name in sorted(tr.tasks.items()):
+        events.append(dict(ph="M", pid=1, tid=i, name="thread_name", args=dict(name=name)))
+    for ev in tr.events:
+        lock = tr.lock(ev["lock"])
+        if ev["type"] == "wait":
+            if tr.idle(ev["lock"], ev["task"]):
+                name = "idle"
+            elif ev["owner"] >= 0:
+                name = "wait %s (%s)" % (lock, tr.task(ev["owner"]))
+            else:
+                name = "wait %s" % lock
+        else:
+            name = "hold %s" % lock
+        events.append(dict(ph="X", pid=1, tid=ev["task"], ts=ev["t"], dur=ev["dur"],
+                           name=name, cat=ev["type"],
+                           args=dict(lock=lock, owner=tr.task(ev["owner"]))))
+
+    output(args.output, json.dumps(dict(traceEvents=events, displayTimeUnit="ms"),
+                                   indent=1) + "\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="views of sys_arch_trace lock traces")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("summary", help="who blocks the tcpip thread")
+    p.add_argument("log", help="console log with 'lwiplock export' output")
+    p.add_argument("-o", "--output", help="file to write, default stdout")
+    p.add_argument("--top", type=int, default=10, help="lines per list (default 10)")
+    p.set_defaults(func=cmd_summary)
+
+    p = sub.add_parser("folded", help="folded stacks for a flame graph")
+    p.add_argument("log", help="console log with 'lwiplock export' output")
+    p.add_argument("-o", "--output", help="file to write, default stdout")
+    p.set_defaults(func=cmd_folded)
+
+    p = sub.add_parser("chrome", help="timeline in the Chrome trace format")
+    p.add_argument("log", help="console log with 'lwiplock export' output")
+    p.add_argument("-o", "--output", help="file to write, default stdout")
+    p.set_defaults(func=cmd_chrome)
+
+    args = ap.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
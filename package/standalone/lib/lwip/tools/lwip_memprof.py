@@ -0,0 +1,468 @@
+#!/usr/bin/env python3
+"""
+Pool sizes for lwipopts.h from the profiles of lwip_memprof.c.
+
+The "lwipprof dump" console command prints a profile of the lwIP heap and
+memp pools (see include/apps/memprof/lwip_memprof.h):
+
+    LWIPPROF 1 <ms since the reset>
+    CONF <option> <value>
+    HEAP <MEM_SIZE> <used> <max> <err>
+    POOL <name> <element size> <num> <used> <max> <err>
+    END
+
+"tune" reads every profile in the given console logs, keeps the highest
+mark seen for each pool and writes a header that sizes the pools carrying
+traffic to that mark plus a margin:
+
+    ./lwip_memprof.py tune logs/*.log -o lwipopts_tuned.h
+
+The pools that bound the number of sockets (PCBs, netconns) are not changed:
+their use reflects the application, not the traffic. Neither are the pools
+that the profiles never used. A pool that ran out during a profile is grown
+instead, and has to be profiled again.
+
+The header is used with LWIP_TUNED_OPTS=lwipopts_tuned.h in the make
+command line. Under LWIP_MEMPROF_REPLAY, it also carries the TCP settings and
+socket pools of the device, for the replay suite of the lwIP unit tests
+(lwip/test/unit/memprof).
+
+"trace" turns a pcap capture of the device traffic into a trace for that
+replay, keeping the flows from and to the device address:
+
+    ./lwip_memprof.py trace capture.pcap --device 192.168.200.12 -o capture.trace
+"""
+
+import argparse
+import math
+import socket
+import struct
+import sys
+
+VERSION = 1
+
+# Pools sized from the traffic, and the option setting each of them
+TUNED = {
+    "PBUF": "MEMP_NUM_PBUF",
+    "PBUF_POOL": "PBUF_POOL_SIZE",
+    "TCP_SEG": "MEMP_NUM_TCP_SEG",
+    "REASSDATA": "MEMP_NUM_REASSDATA",
+    "FRAG_PBUF": "MEMP_NUM_FRAG_PBUF",
+    "NETBUF": "MEMP_NUM_NETBUF",
+    "TCPIP_MSG_API": "MEMP_NUM_TCPIP_MSG_API",
+    "TCPIP_MSG_INPKT": "MEMP_NUM_TCPIP_MSG_INPKT",
+    "API_MSG": "MEMP_NUM_API_MSG",
+    "ARP_QUEUE": "MEMP_NUM_ARP_QUEUE",
+    "SYS_TIMEOUT": "MEMP_NUM_SYS_TIMEOUT",
+}
+
+# Pools kept as configured, only copied for the replay
+CAPACITY = {
+    "RAW_PCB": "MEMP_NUM_RAW_PCB",
+    "UDP_PCB": "MEMP_NUM_UDP_PCB",
+    "TCP_PCB": "MEMP_NUM_TCP_PCB",
+    "TCP_PCB_LISTEN": "MEMP_NUM_TCP_PCB_LISTEN",
+    "NETCONN": "MEMP_NUM_NETCONN",
+}
+
+# PBUF_LINK_HLEN + PBUF_IP_HLEN + PBUF_TRANSPORT_HLEN of the port
+PBUF_HEADERS = 16 + 20 + 20
+
+# IP_REASS_MAX_PBUFS of the port, MEMP_NUM_REASSDATA may not exceed it
+IP_REASS_MAX_PBUFS = 10
+
+
+class Pool:
+    def __init__(self, name, size, num, used, peak, err):
+        self.name = name
+        self.size = size
+        self.num = num
+        self.used = used
+        self.max = peak
+        self.err = err
+
+    def merge(self, other):
+        if other.size != self.size or other.num != self.num:
+            raise ValueError("%s: %dx%d in one profile, %dx%d in another"
+                             % (self.name, self.num, self.size, other.num, other.size))
+        self.max = max(self.max, other.max)
+        self.err += other.err
+
+
+class Profile:
+    def __init__(self):
+        self.window_ms = 0
+        self.conf = {}
+        self.heap = None
+        self.pools = {}
+
+    def merge(self, other):
+        self.window_ms += other.window_ms
+        for k, v in other.conf.items():
+            if self.conf.setdefault(k, v) != v:
+                raise ValueError("%s: %d in one profile, %d in another"
+                                 % (k, self.conf[k], v))
+        if self.heap is None:
+            self.heap = other.heap
+        else:
+            self.heap.merge(other.heap)
+        for name, pool in other.pools.items():
+            if name in self.pools:
+                self.pools[name].merge(pool)
+            else:
+                self.pools[name] = pool
+
+
+def parse(lines):
+    """Yield the complete profiles found in console output"""
+    prof = None
+    for line in lines:
+        # the console may prefix the lines with a timestamp
+        i = line.find("LWIPPROF ")
+        if i >= 0:
+            f = line[i:].split()
+            if int(f[1]) != VERSION:
+                raise ValueError("profile version %s, %d expected" % (f[1], VERSION))
+            prof = Profile()
+            prof.window_ms = int(f[2])
+            continue
+        if prof is None:
+            continue
+        f = line.split()
+        if not f:
+            continue
+        try:
+            if f[0] == "CONF":
+                prof.conf[f[1]] = int(f[2])
+            elif f[0] == "HEAP":
+                v = [int(x) for x in f[1:5]]
+                prof.heap = Pool("MEM_SIZE", 1, v[0], v[1], v[2], v[3])
+            elif f[0] == "POOL":
+                v = [int(x) for x in f[2:7]]
+                prof.pools[f[1]] = Pool(f[1], *v)
+            elif f[0] == "END":
+                if prof.heap is not None:
+                    yield prof
+                prof = None
+            else:
+                prof = None
+        except (IndexError, ValueError):
+            # a line cut by other console output, drop the profile
+            prof = None
+
+
+def sized(pool, margin):
+    """Elements needed for a pool, with the margin"""
+    if pool.err:
+        # the high-water mark stopped at the pool size, the need is unknown
+        return max(pool.num * 2, 1)
+    return max(int(math.ceil(pool.max * (1 + margin))), pool.max + 1)
+
+
+def tune(prof, margin):
+    """Return ({option: (old, new, element size)}, [notes])"""
+    opts = {}
+    notes = []
+
+    align = prof.conf.get("MEM_ALIGNMENT", 4)
+    heap = prof.heap
+    size = sized(heap, margin)
+    size = (size + align - 1) // align * align
+    opts["MEM_SIZE"] = [heap.num, size, 1]
+    if heap.err:
+        notes.append("MEM_SIZE: %d allocations failed, doubled" % heap.err)
+
+    for name, opt in TUNED.items():
+        pool = prof.pools.get(name)
+        if pool is None:
+            continue
+        if pool.max == 0 and not pool.err:
+            # no traffic of this kind in the profiles, not a reason to drop it
+            notes.append("%s: not used, left as configured" % opt)
+            continue
+        opts[opt] = [pool.num, sized(pool, margin), pool.size]
+        if pool.err:
+            notes.append("%s: %d allocations failed, doubled" % (name, pool.err))
+
+    # the constraints of lwip_sanity_check() in init.c
+    queuelen = prof.conf.get("TCP_SND_QUEUELEN")
+    if queuelen and "MEMP_NUM_TCP_SEG" in opts and opts["MEMP_NUM_TCP_SEG"][1] < queuelen:
+        opts["MEMP_NUM_TCP_SEG"][1] = queuelen
+        notes.append("MEMP_NUM_TCP_SEG: raised to TCP_SND_QUEUELEN")
+
+    wnd = prof.conf.get("TCP_WND")
+    bufsize = prof.conf.get("PBUF_POOL_BUFSIZE")
+    if wnd and bufsize and "PBUF_POOL_SIZE" in opts:
+        need = -(-wnd // (bufsize - PBUF_HEADERS))
+        if opts["PBUF_POOL_SIZE"][1] < need:
+            opts["PBUF_POOL_SIZE"][1] = need
+            notes.append("PBUF_POOL_SIZE: raised to hold TCP_WND")
+
+    if "MEMP_NUM_REASSDATA" in opts and opts["MEMP_NUM_REASSDATA"][1] > IP_REASS_MAX_PBUFS:
+        opts["MEMP_NUM_REASSDATA"][1] = IP_REASS_MAX_PBUFS
+        notes.append("MEMP_NUM_REASSDATA: limited to IP_REASS_MAX_PBUFS")
+
+    return opts, notes
+
+
+def header(prof, opts, notes, sources):
+    out = []
+    out.append("/* Generated by lib/lwip/tools/lwip_memprof.py, do not edit */")
+    out.append("/* %s, %d profiles over %d s */" % (", ".join(sources), prof.count,
+                                                  prof.window_ms // 1000))
+    for n in notes:
+        out.append("/* %s */" % n)
+    out.append("#ifndef __LWIPOPTS_TUNED_H__")
+    out.append("#define __LWIPOPTS_TUNED_H__")
+    out.append("")
+    for opt, (old, new, size) in opts.items():
+        out.append("#define %-28s %-6d /* was %d */" % (opt, new, old))
+    out.append("")
+    out.append("#ifdef LWIP_MEMPROF_REPLAY")
+    out.append("/* The device settings that the sizes depend on */")
+    for opt in ("TCP_MSS", "TCP_WND", "TCP_SND_BUF", "TCP_SND_QUEUELEN", "PBUF_POOL_BUFSIZE"):
+        if opt in prof.conf:
+            out.append("#define %-28s %d" % (opt, prof.conf[opt]))
+    for name, opt in CAPACITY.items():
+        if name in prof.pools:
+            out.append("#define %-28s %d" % (opt, prof.pools[name].num))
+    out.append("#endif /* LWIP_MEMPROF_REPLAY */")
+    out.append("")
+    out.append("#endif /* __LWIPOPTS_TUNED_H__ */")
+    return "\n".join(out) + "\n"
+
+
+LINKTYPE_ETHERNET = 1
+LINKTYPE_RAW = 101
+LINKTYPE_LINUX_SLL = 113
+
+TCP_FIN = 0x01
+TCP_SYN = 0x02
+TCP_RST = 0x04
+TCP_ACK = 0x10
+
+
+def pcap_packets(f):
+    """Yield (seconds, IPv4 packet) from a pcap file"""
+    hdr = f.read(24)
+    if len(hdr) < 24:
+        raise ValueError("not a pcap file")
+    magic = struct.unpack("<I", hdr[:4])[0]
+    if magic in (0xA1B2C3D4, 0xA1B23C4D):
+        endian = "<"
+    elif magic in (0xD4C3B2A1, 0x4D3CB2A1):
+        endian = ">"
+    else:
+        raise ValueError("not a pcap file (pcapng is not read, convert it with editcap -F pcap)")
+    frac = 1e-9 if magic in (0xA1B23C4D, 0x4D3CB2A1) else 1e-6
+    linktype = struct.unpack(endian + "I", hdr[20:24])[0]
+
+    while True:
+        rec = f.read(16)
+        if len(rec) < 16:
+            return
+        sec, sub, caplen, _ = struct.unpack(endian + "IIII", rec)
+        data = f.read(caplen)
+        if linktype == LINKTYPE_ETHERNET:
+            off = 12
+            ethertype = struct.unpack(">H", data[off:off + 2])[0]
+            while ethertype == 0x8100:
+                off += 4
+                ethertype = struct.unpack(">H", data[off:off + 2])[0]
+            if ethertype != 0x0800:
+                continue
+            data = data[off + 2:]
+        elif linktype == LINKTYPE_LINUX_SLL:
+            if struct.unpack(">H", data[14:16])[0] != 0x0800:
+                continue
+            data = data[16:]
+        elif linktype != LINKTYPE_RAW:
+            raise ValueError("link type %d, Ethernet or raw IP expected" % linktype)
+        if len(data) >= 20 and data[0] >> 4 == 4:
+            yield sec + sub * frac, data
+
+
+class Flow:
+    def __init__(self, conn, udp):
+        self.conn = conn
+        self.udp = udp
+        self.rx_next = None     # next new sequence number from the peer
+        self.tx_next = None     # from the device
+        self.tx_sent = None     # end of the data sent by the device
+        self.acked = None       # highest ack from the peer
+        self.fins = 0
+
+
+def trace(path, device, out):
+    """Write the trace of the flows of 'device' in a capture, return the events"""
+    dev = socket.inet_aton(device)
+    flows = {}
+    start = None
+    events = 0
+    conns = 0
+    free = []       # the replay keeps REPLAY_CONNS connections, ids are reused
+
+    def new_flow(udp):
+        nonlocal conns
+        conns += 1
+        return Flow(free.pop(0) if free else len(flows), udp)
+
+    out.write("lwiptrace 1\n")
+    out.write("# %s, device %s\n" % (path, device))
+
+    def event(ms, flow, op, arg=None):
+        nonlocal events
+        out.write("%d %d %s%s\n" % (ms, flow.conn, op, "" if arg is None else " %d" % arg))
+        events += 1
+
+    with open(path, "rb") as f:
+        for t, ip in pcap_packets(f):
+            ihl = (ip[0] & 0x0F) * 4
+            total = struct.unpack(">H", ip[2:4])[0]
+            proto = ip[9]
+            src, dst = ip[12:16], ip[16:20]
+            if proto not in (6, 17) or dev not in (src, dst):
+                continue
+            if struct.unpack(">H", ip[6:8])[0] & 0x1FFF:
+                continue        # not the first fragment
+            l4 = ip[ihl:total]
+            if len(l4) < 8:
+                continue
+            sport, dport = struct.unpack(">HH", l4[:4])
+            rx = dst == dev
+            peer = src if rx else dst
+            key = (proto, peer, sport if rx else dport, dport if rx else sport)
+
+            if start is None:
+                start = t
+            ms = int(round((t - start) * 1000))
+
+            flow = flows.get(key)
+            if proto == 17:
+                if flow is None:
+                    flow = flows[key] = new_flow(True)
+                    event(ms, flow, "open udp")
+                event(ms, flow, "rx" if rx else "tx", len(l4) - 8)
+                continue
+
+            if len(l4) < 20:
+                continue
+            seq, ack = struct.unpack(">II", l4[4:12])
+            doff = (l4[12] >> 4) * 4
+            flags = l4[13]
+            payload = len(l4) - doff
+            if flow is None:
+                if not flags & TCP_SYN:
+                    continue    # started before the capture
+                flow = flows[key] = new_flow(False)
+                event(ms, flow, "open tcp")
+
+            # SYN and FIN take a sequence number, count the data only
+            if rx:
+                if flags & TCP_SYN:
+                    flow.rx_next = (seq + 1) & 0xFFFFFFFF
+                elif flow.rx_next is not None and payload > 0:
+                    end = (seq + payload) & 0xFFFFFFFF
+                    new = (end - flow.rx_next) & 0xFFFFFFFF
+                    if 0 < new <= payload:
+                        event(ms, flow, "rx", new)
+                        flow.rx_next = end
+                if flags & TCP_ACK and flow.tx_next is not None:
+                    if flow.acked is None:
+                        flow.acked = flow.tx_next
+                    new = (ack - flow.acked) & 0xFFFFFFFF
+                    if 0 < new < 0x80000000:
+                        # the ack of a SYN or FIN is not data
+                        new = min(new, (flow.tx_sent - flow.acked) & 0xFFFFFFFF)
+                        if new > 0:
+                            event(ms, flow, "ack", new)
+                        flow.acked = ack
+            else:
+                if flags & TCP_SYN:
+                    flow.tx_next = (seq + 1) & 0xFFFFFFFF
+                    flow.tx_sent = flow.tx_next
+                elif flow.tx_next is not None and payload > 0:
+                    end = (seq + payload) & 0xFFFFFFFF
+                    new = (end - flow.tx_sent) & 0xFFFFFFFF
+                    if 0 < new <= payload:
+                        event(ms, flow, "tx", new)
+                        flow.tx_sent = end
+
+            if flags & TCP_FIN:
+                flow.fins += 1
+            if flags & TCP_RST or flow.fins == 2:
+                event(ms, flow, "close")
+                del flows[key]
+                free.append(flow.conn)
+                free.sort()
+
+    return events, conns
+
+
+def cmd_trace(args):
+    out = open(args.output, "w") if args.output else sys.stdout
+    try:
+        events, conns = trace(args.capture, args.device, out)
+    finally:
+        if args.output:
+            out.close()
+    sys.stderr.write("%d connections, %d events\n" % (conns, events))
+
+
+def cmd_tune(args):
+    total = Profile()
+    total.count = 0
+    for path in args.logs:
+        with open(path, errors="replace") as f:
+            for prof in parse(f):
+                total.merge(prof)
+                total.count += 1
+    if total.count == 0:
+        sys.exit("no complete profile in %s" % ", ".join(args.logs))
+
+    opts, notes = tune(total, args.margin)
+
+    saved = 0
+    sys.stderr.write("%-24s %8s %8s %8s\n" % ("option", "was", "tuned", "bytes"))
+    for opt, (old, new, size) in opts.items():
+        delta = (old - new) * size
+        saved += delta
+        sys.stderr.write("%-24s %8d %8d %+8d\n" % (opt, old, new, -delta))
+    if saved >= 0:
+        sys.stderr.write("%d profiles, %d bytes saved\n" % (total.count, saved))
+    else:
+        sys.stderr.write("%d profiles, %d bytes more\n" % (total.count, -saved))
+    for n in notes:
+        sys.stderr.write("note: %s\n" % n)
+
+    text = header(total, opts, notes, args.logs)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="lwipopts pool sizes from lwip_memprof profiles")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("tune", help="header from profiles")
+    p.add_argument("logs", nargs="+", help="console logs with 'lwipprof dump' output")
+    p.add_argument("-o", "--output", help="header to write, default stdout")
+    p.add_argument("--margin", type=float, default=0.25,
+                   help="headroom over the highest mark (default 0.25)")
+    p.set_defaults(func=cmd_tune)
+
+    p = sub.add_parser("trace", help="replay trace from a capture")
+    p.add_argument("capture", help="pcap file")
+    p.add_argument("--device", required=True, help="IPv4 address of the device")
+    p.add_argument("-o", "--output", help="trace to write, default stdout")
+    p.set_defaults(func=cmd_trace)
+
+    args = ap.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -1463,6 +1463,20 @@
  */
 #define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
+/**
+ * \def MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+ *
+ * Resize the I/O buffers of a context once its handshake is over: down to
+ * the maximum fragment length the session negotiated, and back to
+ * MBEDTLS_SSL_IN_CONTENT_LEN and MBEDTLS_SSL_OUT_CONTENT_LEN for a
+ * renegotiation (backport of the option of Mbed TLS 2.22).
+ *
+ * Requires: MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+ *
+ * Uncomment this macro to enable resizing the I/O buffers
+ */
+//#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+
 /**
  * \def MBEDTLS_SSL_PROTO_SSL3
  *
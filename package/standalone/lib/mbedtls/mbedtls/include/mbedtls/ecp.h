@@ -235,7 +235,8 @@ typedef struct mbedtls_ecp_group
     int (*t_post)(mbedtls_ecp_point *, void *); /*!< Unused. */
     void *t_data;               /*!< Unused. */
     mbedtls_ecp_point *T;       /*!< Pre-computed points for ecp_mul_comb(). */
-    size_t T_size;              /*!< The number of pre-computed points. */
+    size_t T_size;              /*!< The number of pre-computed points,
+                                     0 for a constant table of the curve. */
 }
 mbedtls_ecp_group;
 
@@ -363,6 +363,10 @@ struct mbedtls_ssl_handshake_params
     uint16_t mtu;                       /*!<  Handshake mtu, used to fragment outgoing messages */
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
 
+    unsigned char *tls_hs_reasm;        /*!<  TLS: start of a handshake message
+                                              split over several records */
+    size_t tls_hs_reasm_len;            /*!<  Length of that start            */
+
     /*
      * Checksum contexts
      */
@@ -725,6 +729,30 @@ static inline size_t mbedtls_ssl_hs_hdr_len( const mbedtls_ssl_context *ssl )
     return( 4 );
 }
 
+/*
+ * Length of the record buffers of a context: fixed, or with
+ * MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH the length they have now.
+ */
+static inline size_t mbedtls_ssl_in_buffer_len( const mbedtls_ssl_context *ssl )
+{
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    return( ssl->in_buf_len );
+#else
+    ((void) ssl);
+    return( MBEDTLS_SSL_IN_BUFFER_LEN );
+#endif
+}
+
+static inline size_t mbedtls_ssl_out_buffer_len( const mbedtls_ssl_context *ssl )
+{
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    return( ssl->out_buf_len );
+#else
+    ((void) ssl);
+    return( MBEDTLS_SSL_OUT_BUFFER_LEN );
+#endif
+}
+
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
 void mbedtls_ssl_send_flight_completed( mbedtls_ssl_context *ssl );
 void mbedtls_ssl_recv_flight_completed( mbedtls_ssl_context *ssl );
@@ -52,6 +52,8 @@ extern "C" {
  */
 typedef struct mbedtls_x509_crt
 {
+    int own_buffer;                     /**< Indicates if \c raw is owned
+                                         *   by the structure or not.        */
     mbedtls_x509_buf raw;               /**< The raw certificate data (DER). */
     mbedtls_x509_buf tbs;               /**< The raw certificate body (DER). The part that is To Be Signed. */
 
@@ -231,6 +233,22 @@ extern const mbedtls_x509_crt_profile mbedtls_x509_crt_profile_suiteb;
 int mbedtls_x509_crt_parse_der( mbedtls_x509_crt *chain, const unsigned char *buf,
                         size_t buflen );
 
+/**
+ * \brief          Parse a single DER formatted certificate and add it
+ *                 to the chained list, without copying it: the chain
+ *                 references the buffer, which must hold the certificate
+ *                 unchanged until the chain is freed, e.g. DER in flash.
+ *
+ * \param chain    points to the start of the chain
+ * \param buf      buffer holding the certificate DER data
+ * \param buflen   size of the buffer
+ *
+ * \return         0 if successful, or a specific X509 or PEM error code
+ */
+int mbedtls_x509_crt_parse_der_nocopy( mbedtls_x509_crt *chain,
+                                       const unsigned char *buf,
+                                       size_t buflen );
+
 /**
  * \brief          Parse one DER-encoded or one or more concatenated PEM-encoded
  *                 certificates and add them to the chained list.
@@ -733,6 +733,20 @@ void mbedtls_ecp_point_free( mbedtls_ecp_point *pt )
     mbedtls_mpi_free( &( pt->Z ) );
 }
 
+/*
+ * Is the comb table of G a constant one of ecp_curves.c, in flash?
+ * Those are marked by T_size 0 and are never freed.
+ */
+static int ecp_group_is_static_comb_table( const mbedtls_ecp_group *grp )
+{
+#if MBEDTLS_ECP_FIXED_POINT_OPTIM == 1
+    return( grp->T != NULL && grp->T_size == 0 );
+#else
+    (void) grp;
+    return( 0 );
+#endif
+}
+
 /*
  * Unallocate (the components of) a group
  */
@@ -752,7 +766,7 @@ void mbedtls_ecp_group_free( mbedtls_ecp_group *grp )
         mbedtls_mpi_free( &grp->N );
     }
 
-    if( grp->T != NULL )
+    if( !ecp_group_is_static_comb_table( grp ) && grp->T != NULL )
     {
         for( i = 0; i < grp->T_size; i++ )
             mbedtls_ecp_point_free( &grp->T[i] );
@@ -2295,11 +2309,13 @@ static unsigned char ecp_pick_window_size( const mbedtls_ecp_group *grp,
         w++;
 
     /*
-     * Make sure w is within bounds.
+     * Make sure w is within bounds, unless a static table of G is used: it
+     * was made for this w and costs no memory.
      * (The last test is useful only for very small curves in the test suite.)
      */
 #if( MBEDTLS_ECP_WINDOW_SIZE < 6 )
-    if( w > MBEDTLS_ECP_WINDOW_SIZE )
+    if( ( !p_eq_g || !ecp_group_is_static_comb_table( grp ) ) &&
+        w > MBEDTLS_ECP_WINDOW_SIZE )
         w = MBEDTLS_ECP_WINDOW_SIZE;
 #endif
     if( w >= grp->nbits )
@@ -1165,6 +1165,9 @@ static int ssl_parse_max_fragment_length_ext( mbedtls_ssl_context *ssl,
         return( MBEDTLS_ERR_SSL_BAD_HS_SERVER_HELLO );
     }
 
+    /* Records from the server are now limited too */
+    ssl->session_negotiate->mfl_code = buf[0];
+
     return( 0 );
 }
 #endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
@@ -1796,6 +1799,12 @@ static int ssl_parse_server_hello( mbedtls_ssl_context *ssl )
     }
     ssl->session_negotiate->compression = comp;
 
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    /* Set again by the extension if the server accepts it in this hello,
+     * a resumed session does not keep it */
+    ssl->session_negotiate->mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+#endif
+
     ext = buf + 40 + n;
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "server hello, total extension length: %d", ext_len ) );
@@ -125,10 +125,10 @@ static size_t ssl_get_maximum_datagram_size( mbedtls_ssl_context const *ssl )
 {
     size_t mtu = ssl_get_current_mtu( ssl );
 
-    if( mtu != 0 && mtu < MBEDTLS_SSL_OUT_BUFFER_LEN )
+    if( mtu != 0 && mtu < mbedtls_ssl_out_buffer_len( ssl ) )
         return( mtu );
 
-    return( MBEDTLS_SSL_OUT_BUFFER_LEN );
+    return( mbedtls_ssl_out_buffer_len( ssl ) );
 }
 
 static int ssl_get_remaining_space_in_datagram( mbedtls_ssl_context const *ssl )
@@ -2408,7 +2408,7 @@ static int ssl_compress_buf( mbedtls_ssl_context *ssl )
     ssl->transform_out->ctx_deflate.next_in = msg_pre;
     ssl->transform_out->ctx_deflate.avail_in = len_pre;
     ssl->transform_out->ctx_deflate.next_out = msg_post;
-    ssl->transform_out->ctx_deflate.avail_out = MBEDTLS_SSL_OUT_BUFFER_LEN - bytes_written;
+    ssl->transform_out->ctx_deflate.avail_out = mbedtls_ssl_out_buffer_len( ssl ) - bytes_written;
 
     ret = deflate( &ssl->transform_out->ctx_deflate, Z_SYNC_FLUSH );
     if( ret != Z_OK )
@@ -2417,7 +2417,7 @@ static int ssl_compress_buf( mbedtls_ssl_context *ssl )
         return( MBEDTLS_ERR_SSL_COMPRESSION_FAILED );
     }
 
-    ssl->out_msglen = MBEDTLS_SSL_OUT_BUFFER_LEN -
+    ssl->out_msglen = mbedtls_ssl_out_buffer_len( ssl ) -
                       ssl->transform_out->ctx_deflate.avail_out - bytes_written;
 
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "after compression: msglen = %d, ",
@@ -2455,7 +2455,7 @@ static int ssl_decompress_buf( mbedtls_ssl_context *ssl )
     ssl->transform_in->ctx_inflate.next_in = msg_pre;
     ssl->transform_in->ctx_inflate.avail_in = len_pre;
     ssl->transform_in->ctx_inflate.next_out = msg_post;
-    ssl->transform_in->ctx_inflate.avail_out = MBEDTLS_SSL_IN_BUFFER_LEN -
+    ssl->transform_in->ctx_inflate.avail_out = mbedtls_ssl_in_buffer_len( ssl ) -
                                                header_bytes;
 
     ret = inflate( &ssl->transform_in->ctx_inflate, Z_SYNC_FLUSH );
@@ -2465,7 +2465,7 @@ static int ssl_decompress_buf( mbedtls_ssl_context *ssl )
         return( MBEDTLS_ERR_SSL_COMPRESSION_FAILED );
     }
 
-    ssl->in_msglen = MBEDTLS_SSL_IN_BUFFER_LEN -
+    ssl->in_msglen = mbedtls_ssl_in_buffer_len( ssl ) -
                      ssl->transform_in->ctx_inflate.avail_out - header_bytes;
 
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "after decompression: msglen = %d, ",
@@ -2540,7 +2540,7 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
     }
 
-    if( nb_want > MBEDTLS_SSL_IN_BUFFER_LEN - (size_t)( ssl->in_hdr - ssl->in_buf ) )
+    if( nb_want > mbedtls_ssl_in_buffer_len( ssl ) - (size_t)( ssl->in_hdr - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "requesting more data than fits" ) );
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
@@ -2626,7 +2626,7 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
         }
         else
         {
-            len = MBEDTLS_SSL_IN_BUFFER_LEN - ( ssl->in_hdr - ssl->in_buf );
+            len = mbedtls_ssl_in_buffer_len( ssl ) - ( ssl->in_hdr - ssl->in_buf );
 
             if( ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER )
                 timeout = ssl->handshake->retransmit_timeout;
@@ -3618,8 +3618,95 @@ static uint32_t ssl_get_hs_total_len( mbedtls_ssl_context const *ssl )
               ssl->in_msg[3] );
 }
 
+/*
+ * TLS: a handshake message longer than its record, as a server sends its
+ * certificates under a small max_fragment_length. The start of it is kept
+ * in handshake->tls_hs_reasm; with the record that completes it, the
+ * message is put together again in front of the rest of that record.
+ *
+ * Returns MBEDTLS_ERR_SSL_CONTINUE_PROCESSING while the message is not
+ * complete.
+ */
+static int ssl_tls_hs_reassemble( mbedtls_ssl_context *ssl )
+{
+    mbedtls_ssl_handshake_params * const hs = ssl->handshake;
+    unsigned char *reasm;
+    size_t hs_len;
+
+    if( hs == NULL || hs->tls_hs_reasm == NULL )
+    {
+        if( hs == NULL || ssl->in_msglen < mbedtls_ssl_hs_hdr_len( ssl ) )
+            return( 0 );
+
+        hs_len = mbedtls_ssl_hs_hdr_len( ssl ) + ssl_get_hs_total_len( ssl );
+        if( ssl->in_msglen >= hs_len )
+            return( 0 );
+
+        /* The bound of a message in a single record */
+        if( hs_len > MBEDTLS_SSL_IN_CONTENT_LEN )
+        {
+            MBEDTLS_SSL_DEBUG_MSG( 1, ( "handshake message too long: %u",
+                                        (unsigned) hs_len ) );
+            return( MBEDTLS_ERR_SSL_INVALID_RECORD );
+        }
+
+        MBEDTLS_SSL_DEBUG_MSG( 2, ( "handshake message of %u bytes split over records",
+                                    (unsigned) hs_len ) );
+
+        hs->tls_hs_reasm = mbedtls_calloc( 1, hs_len );
+        if( hs->tls_hs_reasm == NULL )
+        {
+            MBEDTLS_SSL_DEBUG_MSG( 1, ( "alloc(%u bytes) failed", (unsigned) hs_len ) );
+            return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+        }
+        memcpy( hs->tls_hs_reasm, ssl->in_msg, ssl->in_msglen );
+        hs->tls_hs_reasm_len = ssl->in_msglen;
+        ssl->in_msglen = 0;
+
+        return( MBEDTLS_ERR_SSL_CONTINUE_PROCESSING );
+    }
+
+    reasm = hs->tls_hs_reasm;
+    hs_len = mbedtls_ssl_hs_hdr_len( ssl ) +
+             ( ( reasm[1] << 16 ) | ( reasm[2] << 8 ) | reasm[3] );
+
+    if( ssl->in_msglen < hs_len - hs->tls_hs_reasm_len )
+    {
+        memcpy( reasm + hs->tls_hs_reasm_len, ssl->in_msg, ssl->in_msglen );
+        hs->tls_hs_reasm_len += ssl->in_msglen;
+        ssl->in_msglen = 0;
+
+        return( MBEDTLS_ERR_SSL_CONTINUE_PROCESSING );
+    }
+
+    if( (size_t)( ssl->in_msg - ssl->in_buf ) + hs->tls_hs_reasm_len +
+        ssl->in_msglen > mbedtls_ssl_in_buffer_len( ssl ) )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "reassembled handshake message does not fit" ) );
+        return( MBEDTLS_ERR_SSL_INVALID_RECORD );
+    }
+
+    memmove( ssl->in_msg + hs->tls_hs_reasm_len, ssl->in_msg, ssl->in_msglen );
+    memcpy( ssl->in_msg, reasm, hs->tls_hs_reasm_len );
+    ssl->in_msglen += hs->tls_hs_reasm_len;
+
+    mbedtls_platform_zeroize( reasm, hs->tls_hs_reasm_len );
+    mbedtls_free( reasm );
+    hs->tls_hs_reasm = NULL;
+    hs->tls_hs_reasm_len = 0;
+
+    return( 0 );
+}
+
 int mbedtls_ssl_prepare_handshake_record( mbedtls_ssl_context *ssl )
 {
+    if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_STREAM )
+    {
+        int ret = ssl_tls_hs_reassemble( ssl );
+        if( ret != 0 )
+            return( ret );
+    }
+
     if( ssl->in_msglen < mbedtls_ssl_hs_hdr_len( ssl ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "handshake message too short: %d",
@@ -3700,7 +3787,7 @@ int mbedtls_ssl_prepare_handshake_record( mbedtls_ssl_context *ssl )
     }
     else
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
-    /* With TLS we don't handle fragmentation (for now) */
+    /* With TLS, fragments are put together above while there is a handshake */
     if( ssl->in_msglen < ssl->in_hslen )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "TLS handshake fragmentation not supported" ) );
@@ -4102,7 +4189,7 @@ static int ssl_parse_record_header( mbedtls_ssl_context *ssl )
     }
 
     /* Check length against the size of our buffer */
-    if( ssl->in_msglen > MBEDTLS_SSL_IN_BUFFER_LEN
+    if( ssl->in_msglen > mbedtls_ssl_in_buffer_len( ssl )
                          - (size_t)( ssl->in_msg - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad message length" ) );
@@ -4891,7 +4978,7 @@ static int ssl_load_buffered_record( mbedtls_ssl_context *ssl )
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "Found buffered record from current epoch - load" ) );
 
     /* Double-check that the record is not too large */
-    if( rec_len > MBEDTLS_SSL_IN_BUFFER_LEN -
+    if( rec_len > mbedtls_ssl_in_buffer_len( ssl ) -
         (size_t)( ssl->in_hdr - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "should never happen" ) );
@@ -5124,6 +5211,15 @@ int mbedtls_ssl_handle_message_type( mbedtls_ssl_context *ssl )
 {
     int ret;
 
+    /* Nothing comes between the records of a handshake message */
+    if( ssl->in_msgtype != MBEDTLS_SSL_MSG_HANDSHAKE &&
+        ssl->handshake != NULL && ssl->handshake->tls_hs_reasm != NULL )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "record of type %d inside a handshake message",
+                                    ssl->in_msgtype ) );
+        return( MBEDTLS_ERR_SSL_UNEXPECTED_MESSAGE );
+    }
+
     /*
      * Handle particular types of records
      */
@@ -6318,6 +6414,140 @@ static void ssl_calc_finished_tls_sha384(
 #endif /* MBEDTLS_SHA512_C */
 #endif /* MBEDTLS_SSL_PROTO_TLS1_2 */
 
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+static int ssl_resize_buffer( unsigned char **buffer, size_t len_new,
+                              size_t *len_old )
+{
+    unsigned char *resized_buffer = mbedtls_calloc( 1, len_new );
+    if( resized_buffer == NULL )
+        return( -1 );
+
+    /* Copy what fits: the callers make sure no data is lost when
+     * downsizing */
+    memcpy( resized_buffer, *buffer,
+            ( len_new < *len_old ) ? len_new : *len_old );
+    mbedtls_platform_zeroize( *buffer, *len_old );
+    mbedtls_free( *buffer );
+
+    *buffer = resized_buffer;
+    *len_old = len_new;
+
+    return( 0 );
+}
+
+/*
+ * Reallocate the I/O buffers to in_buf_new_len and out_buf_new_len bytes:
+ * only to make them smaller if downsizing, and only if what they hold
+ * still fits, or only to make them larger otherwise.
+ */
+static int ssl_handle_buffer_resizing( mbedtls_ssl_context *ssl, int downsizing,
+                                       size_t in_buf_new_len,
+                                       size_t out_buf_new_len )
+{
+    int ret = 0;
+    int modified = 0;
+    size_t written_in = 0, iv_offset_in = 0, len_offset_in = 0, offt_in = 0;
+    size_t written_out = 0, iv_offset_out = 0, len_offset_out = 0;
+
+    if( ssl->in_buf != NULL )
+    {
+        written_in = ssl->in_msg - ssl->in_buf;
+        iv_offset_in = ssl->in_iv - ssl->in_buf;
+        len_offset_in = ssl->in_len - ssl->in_buf;
+        if( ssl->in_offt != NULL )
+            offt_in = ssl->in_offt - ssl->in_buf;
+
+        if( downsizing ?
+            ssl->in_buf_len > in_buf_new_len &&
+            written_in + ssl->in_msglen <= in_buf_new_len &&
+            (size_t)( ssl->in_hdr - ssl->in_buf ) + ssl->in_left <= in_buf_new_len :
+            ssl->in_buf_len < in_buf_new_len )
+        {
+            if( ssl_resize_buffer( &ssl->in_buf, in_buf_new_len,
+                                   &ssl->in_buf_len ) != 0 )
+            {
+                MBEDTLS_SSL_DEBUG_MSG( 1, ( "input buffer resizing failed - out of memory" ) );
+                ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+            }
+            else
+            {
+                MBEDTLS_SSL_DEBUG_MSG( 2, ( "reallocating in_buf to %u",
+                                            (unsigned) in_buf_new_len ) );
+                modified = 1;
+            }
+        }
+    }
+
+    if( ssl->out_buf != NULL )
+    {
+        written_out = ssl->out_msg - ssl->out_buf;
+        iv_offset_out = ssl->out_iv - ssl->out_buf;
+        len_offset_out = ssl->out_len - ssl->out_buf;
+
+        if( downsizing ?
+            ssl->out_buf_len > out_buf_new_len &&
+            (size_t)( ssl->out_hdr - ssl->out_buf ) + ssl->out_left <= out_buf_new_len :
+            ssl->out_buf_len < out_buf_new_len )
+        {
+            if( ssl_resize_buffer( &ssl->out_buf, out_buf_new_len,
+                                   &ssl->out_buf_len ) != 0 )
+            {
+                MBEDTLS_SSL_DEBUG_MSG( 1, ( "output buffer resizing failed - out of memory" ) );
+                ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+            }
+            else
+            {
+                MBEDTLS_SSL_DEBUG_MSG( 2, ( "reallocating out_buf to %u",
+                                            (unsigned) out_buf_new_len ) );
+                modified = 1;
+            }
+        }
+    }
+
+    if( modified )
+    {
+        /* Update pointers here to avoid doing it twice. */
+        ssl_reset_in_out_pointers( ssl );
+        /* The message pointers depend on the transform, keep their offsets */
+        ssl->out_msg = ssl->out_buf + written_out;
+        ssl->out_len = ssl->out_buf + len_offset_out;
+        ssl->out_iv = ssl->out_buf + iv_offset_out;
+
+        ssl->in_msg = ssl->in_buf + written_in;
+        ssl->in_len = ssl->in_buf + len_offset_in;
+        ssl->in_iv = ssl->in_buf + iv_offset_in;
+        if( ssl->in_offt != NULL )
+            ssl->in_offt = ssl->in_buf + offt_in;
+    }
+
+    return( ret );
+}
+
+/*
+ * Once the handshake is over, the records are no longer than the maximum
+ * fragment length: the one the session negotiated for those of the peer,
+ * and at most the configured one for ours.
+ */
+static void ssl_shrink_buffers( mbedtls_ssl_context *ssl )
+{
+    size_t in_len = MBEDTLS_SSL_IN_CONTENT_LEN;
+    size_t out_len = mbedtls_ssl_get_max_frag_len( ssl );
+
+    if( ssl->session_in != NULL &&
+        ssl_mfl_code_to_length( ssl->session_in->mfl_code ) < in_len )
+    {
+        in_len = ssl_mfl_code_to_length( ssl->session_in->mfl_code );
+    }
+    if( out_len > MBEDTLS_SSL_OUT_CONTENT_LEN )
+        out_len = MBEDTLS_SSL_OUT_CONTENT_LEN;
+
+    /* A failed reallocation keeps the larger buffer */
+    (void) ssl_handle_buffer_resizing( ssl, 1,
+                MBEDTLS_SSL_HEADER_LEN + MBEDTLS_SSL_PAYLOAD_OVERHEAD + in_len,
+                MBEDTLS_SSL_HEADER_LEN + MBEDTLS_SSL_PAYLOAD_OVERHEAD + out_len );
+}
+#endif /* MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH */
+
 static void ssl_handshake_wrapup_free_hs_transform( mbedtls_ssl_context *ssl )
 {
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "=> handshake wrapup: final free" ) );
@@ -6340,6 +6570,10 @@ static void ssl_handshake_wrapup_free_hs_transform( mbedtls_ssl_context *ssl )
     ssl->transform = ssl->transform_negotiate;
     ssl->transform_negotiate = NULL;
 
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    ssl_shrink_buffers( ssl );
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "<= handshake wrapup: final free" ) );
 }
 
@@ -6686,6 +6920,13 @@ static int ssl_handshake_init( mbedtls_ssl_context *ssl )
     if( ssl->handshake )
         mbedtls_ssl_handshake_free( ssl );
 
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    /* Full size again for the handshake */
+    if( ssl_handle_buffer_resizing( ssl, 0, MBEDTLS_SSL_IN_BUFFER_LEN,
+                                    MBEDTLS_SSL_OUT_BUFFER_LEN ) != 0 )
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+#endif
+
     /*
      * Either the pointers are now NULL or cleared properly and can be freed.
      * Now allocate missing structures.
@@ -6900,6 +7141,9 @@ int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
         ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
         goto error;
     }
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    ssl->in_buf_len = MBEDTLS_SSL_IN_BUFFER_LEN;
+#endif
 
     ssl->out_buf = mbedtls_calloc( 1, MBEDTLS_SSL_OUT_BUFFER_LEN );
     if( ssl->out_buf == NULL )
@@ -6908,6 +7152,9 @@ int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
         ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
         goto error;
     }
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    ssl->out_buf_len = MBEDTLS_SSL_OUT_BUFFER_LEN;
+#endif
 
     ssl_reset_in_out_pointers( ssl );
 
@@ -6924,6 +7171,10 @@ error:
 
     ssl->in_buf = NULL;
     ssl->out_buf = NULL;
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    ssl->in_buf_len = 0;
+    ssl->out_buf_len = 0;
+#endif
 
     ssl->in_hdr = NULL;
     ssl->in_ctr = NULL;
@@ -7005,14 +7256,14 @@ static int ssl_session_reset_int( mbedtls_ssl_context *ssl, int partial )
     ssl->session_in = NULL;
     ssl->session_out = NULL;
 
-    memset( ssl->out_buf, 0, MBEDTLS_SSL_OUT_BUFFER_LEN );
+    memset( ssl->out_buf, 0, mbedtls_ssl_out_buffer_len( ssl ) );
 
 #if defined(MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE) && defined(MBEDTLS_SSL_SRV_C)
     if( partial == 0 )
 #endif /* MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE && MBEDTLS_SSL_SRV_C */
     {
         ssl->in_left = 0;
-        memset( ssl->in_buf, 0, MBEDTLS_SSL_IN_BUFFER_LEN );
+        memset( ssl->in_buf, 0, mbedtls_ssl_in_buffer_len( ssl ) );
     }
 
 #if defined(MBEDTLS_SSL_HW_RECORD_ACCEL)
@@ -8913,6 +9164,13 @@ void mbedtls_ssl_handshake_free( mbedtls_ssl_context *ssl )
     ssl_buffering_free( ssl );
 #endif
 
+    if( handshake->tls_hs_reasm != NULL )
+    {
+        mbedtls_platform_zeroize( handshake->tls_hs_reasm,
+                                  handshake->tls_hs_reasm_len );
+        mbedtls_free( handshake->tls_hs_reasm );
+    }
+
     mbedtls_platform_zeroize( handshake,
                               sizeof( mbedtls_ssl_handshake_params ) );
 }
@@ -8949,13 +9207,13 @@ void mbedtls_ssl_free( mbedtls_ssl_context *ssl )
 
     if( ssl->out_buf != NULL )
     {
-        mbedtls_platform_zeroize( ssl->out_buf, MBEDTLS_SSL_OUT_BUFFER_LEN );
+        mbedtls_platform_zeroize( ssl->out_buf, mbedtls_ssl_out_buffer_len( ssl ) );
         mbedtls_free( ssl->out_buf );
     }
 
     if( ssl->in_buf != NULL )
     {
-        mbedtls_platform_zeroize( ssl->in_buf, MBEDTLS_SSL_IN_BUFFER_LEN );
+        mbedtls_platform_zeroize( ssl->in_buf, mbedtls_ssl_in_buffer_len( ssl ) );
         mbedtls_free( ssl->in_buf );
     }
 
@@ -109,7 +109,8 @@ int main( void )
     "aes_cbc, aes_gcm, aes_ccm, aes_ctx, chachapoly,\n"                 \
     "aes_cmac, des3_cmac, poly1305\n"                                   \
     "havege, ctr_drbg, hmac_drbg\n"                                     \
-    "rsa, dhm, ecdsa, ecdh.\n"
+    "rsa, dhm, ecdsa, ecdh,\n"                                          \
+    "p256 (ecdsa and ecdh on secp256r1 only).\n"
 
 #if defined(MBEDTLS_ERROR_C)
 #define PRINT_ERROR                                                     \
@@ -176,7 +177,7 @@ do {                                                                    \
 
 #define TIME_PUBLIC( TITLE, TYPE, CODE )                                \
 do {                                                                    \
-    unsigned long ii;                                                   \
+    unsigned long ii, tsc;                                              \
     int ret;                                                            \
     MEMORY_MEASURE_INIT;                                                \
                                                                         \
@@ -185,10 +186,12 @@ do {                                                                    \
     mbedtls_set_alarm( 3 );                                             \
                                                                         \
     ret = 0;                                                            \
+    tsc = mbedtls_timing_hardclock();                                   \
     for( ii = 1; ! mbedtls_timing_alarmed && ! ret ; ii++ )             \
     {                                                                   \
         CODE;                                                           \
     }                                                                   \
+    tsc = mbedtls_timing_hardclock() - tsc;                             \
                                                                         \
     if( ret != 0 )                                                      \
     {                                                                   \
@@ -198,7 +201,7 @@ do {                                                                    \
     {                                                                   \
         mbedtls_printf( "%6lu " TYPE "/s", ii / 3 );                    \
         MEMORY_MEASURE_PRINT( sizeof( TYPE ) + 1 );                     \
-        mbedtls_printf( "\n" );                                         \
+        mbedtls_printf( ",  %9lu cycles/op\n", tsc / ( ii - 1 ) );      \
     }                                                                   \
 } while( 0 )
 
@@ -231,6 +234,10 @@ static int myrand( void *rng_state, unsigned char *output, size_t len )
 #if defined(MBEDTLS_ECP_C)
 void ecp_clear_precomputed( mbedtls_ecp_group *grp )
 {
+    /* a constant table of the curve (T_size 0) is in flash, not the heap */
+    if( grp->T != NULL && grp->T_size == 0 )
+        return;
+
     if( grp->T != NULL )
     {
         size_t i;
@@ -255,7 +262,8 @@ typedef struct {
          aria, camellia, blowfish, chacha20,
          poly1305,
          havege, ctr_drbg, hmac_drbg,
-         rsa, dhm, ecdsa, ecdh;
+         rsa, dhm, ecdsa, ecdh,
+         p256;
 } todo_list;
 
 
@@ -272,6 +280,7 @@ int main( int argc, char *argv[] )
     if( argc <= 1 )
     {
         memset( &todo, 1, sizeof( todo ) );
+        todo.p256 = 0;
     }
     else
     {
@@ -335,6 +344,8 @@ int main( int argc, char *argv[] )
                 todo.ecdsa = 1;
             else if( strcmp( argv[i], "ecdh" ) == 0 )
                 todo.ecdh = 1;
+            else if( strcmp( argv[i], "p256" ) == 0 )
+                todo.ecdsa = todo.ecdh = todo.p256 = 1;
             else
             {
                 mbedtls_printf( "Unrecognized option: %s\n", argv[i] );
@@ -824,10 +835,31 @@ int main( int argc, char *argv[] )
 
         memset( buf, 0x2A, sizeof( buf ) );
 
+        /* a new group for each key, as for the ephemeral key of a handshake */
         for( curve_info = mbedtls_ecp_curve_list();
              curve_info->grp_id != MBEDTLS_ECP_DP_NONE;
              curve_info++ )
         {
+            if( todo.p256 && curve_info->grp_id != MBEDTLS_ECP_DP_SECP256R1 )
+                continue;
+
+            mbedtls_ecdsa_init( &ecdsa );
+
+            mbedtls_snprintf( title, sizeof( title ), "ECDSA-%s",
+                                              curve_info->name );
+            TIME_PUBLIC( title, "keygen",
+                    ret = mbedtls_ecdsa_genkey( &ecdsa, curve_info->grp_id, myrand, NULL ) );
+
+            mbedtls_ecdsa_free( &ecdsa );
+        }
+
+        for( curve_info = mbedtls_ecp_curve_list();
+             curve_info->grp_id != MBEDTLS_ECP_DP_NONE;
+             curve_info++ )
+        {
+            if( todo.p256 && curve_info->grp_id != MBEDTLS_ECP_DP_SECP256R1 )
+                continue;
+
             mbedtls_ecdsa_init( &ecdsa );
 
             if( mbedtls_ecdsa_genkey( &ecdsa, curve_info->grp_id, myrand, NULL ) != 0 )
@@ -847,6 +879,9 @@ int main( int argc, char *argv[] )
              curve_info->grp_id != MBEDTLS_ECP_DP_NONE;
              curve_info++ )
         {
+            if( todo.p256 && curve_info->grp_id != MBEDTLS_ECP_DP_SECP256R1 )
+                continue;
+
             mbedtls_ecdsa_init( &ecdsa );
 
             if( mbedtls_ecdsa_genkey( &ecdsa, curve_info->grp_id, myrand, NULL ) != 0 ||
@@ -889,6 +924,9 @@ int main( int argc, char *argv[] )
              curve_info->grp_id != MBEDTLS_ECP_DP_NONE;
              curve_info++ )
         {
+            if( todo.p256 && curve_info->grp_id != MBEDTLS_ECP_DP_SECP256R1 )
+                continue;
+
             mbedtls_ecdh_init( &ecdh );
 
             if( mbedtls_ecp_group_load( &ecdh.grp, curve_info->grp_id ) != 0 ||
@@ -915,6 +953,9 @@ int main( int argc, char *argv[] )
               curve_info->grp_id != MBEDTLS_ECP_DP_NONE;
               curve_info++ )
         {
+            if( todo.p256 )
+                break;
+
             mbedtls_ecdh_init( &ecdh );
             mbedtls_mpi_init( &z );
 
@@ -940,6 +981,9 @@ int main( int argc, char *argv[] )
              curve_info->grp_id != MBEDTLS_ECP_DP_NONE;
              curve_info++ )
         {
+            if( todo.p256 && curve_info->grp_id != MBEDTLS_ECP_DP_SECP256R1 )
+                continue;
+
             mbedtls_ecdh_init( &ecdh );
 
             if( mbedtls_ecp_group_load( &ecdh.grp, curve_info->grp_id ) != 0 ||
@@ -966,6 +1010,9 @@ int main( int argc, char *argv[] )
               curve_info->grp_id != MBEDTLS_ECP_DP_NONE;
               curve_info++)
         {
+            if( todo.p256 )
+                break;
+
             mbedtls_ecdh_init( &ecdh );
             mbedtls_mpi_init( &z );
 
@@ -107,9 +107,16 @@ TLS_SRCS += \
 
 # porting layer
 PORTING_SRCS += \
-	timing_alt.c
+	timing_alt.c \
+	tls_cert_store.c
+
+# client sessions kept by host:port and the record size of the clients,
+# built with the TLS sources
+TLS_SRCS += tls_session_cache.c
+TLS_SRCS += tls_max_frag.c
 
 ifeq ($(CONFIG_USE_HW_SECURITY_ACC_SHA),y)
+DEFINE += -DCONFIG_USE_HW_SECURITY_ACC_SHA
 CRYPTO_SRCS += sha1_hw.c
 CRYPTO_SRCS += sha256_hw.c
 CRYPTO_SRCS += sha512_hw.c
@@ -91,6 +91,9 @@
 #define MBEDTLS_BIGNUM_C
 #define MBEDTLS_ECP_DP_SECP256R1_ENABLED
 #define MBEDTLS_ECP_C
+/* Multiplications of the P-256 generator use the comb table of ecp_curves.c
+ * in flash, not one computed into the heap of each group */
+#define MBEDTLS_ECP_FIXED_POINT_OPTIM	1
 #if defined (INCLUDE_PMF_SWENC)
 #define MBEDTLS_CCM_C
 #endif
@@ -122,6 +125,25 @@
 #define MBEDTLS_SSL_DTLS_BADMAC_LIMIT
 #define MBEDTLS_SSL_DTLS_HELLO_VERIFY
 
+/* Session resumption: tickets (RFC 5077) and a client cache by host:port,
+ * kept over deep sleep (port/tls_session_cache.c) */
+#define MBEDTLS_SSL_SESSION_TICKETS
+#define NRC_TLS_SESSION_CACHE
+#define NRC_TLS_SESSION_CACHE_SIZE	4
+#define NRC_TLS_SESSION_MAX_AGE		86400	/* s */
+
+/* Certificates and keys parsed once, shared by the TLS clients
+ * (port/tls_cert_store.c) */
+#define NRC_TLS_CERT_STORE
+#define NRC_TLS_CERT_STORE_SIZE		6
+
+/* Records of at most NRC_TLS_MAX_FRAG_LEN bytes asked for by the TLS
+ * clients (port/tls_max_frag.c), and I/O buffers shrunk to the size
+ * negotiated once the handshake is over */
+#define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+#define NRC_TLS_MAX_FRAG_LEN		2048
+
 #if (defined (CONFIG_SAE) || defined (CONFIG_OWE))
 #define MBEDTLS_HMAC_DRBG_C
 #endif
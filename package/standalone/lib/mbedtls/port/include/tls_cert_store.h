@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __TLS_CERT_STORE_H__
+#define __TLS_CERT_STORE_H__
+
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+
+#include <stddef.h>
+
+/*
+ * Certificates and keys parsed once and shared by the TLS clients, instead
+ * of a copy parsed by each connection. An entry is found by the buffer it
+ * was parsed from: the same address, length and content. Entries no
+ * connection uses stay parsed for the next one, until the store is full or
+ * tls_cert_store_flush() is called.
+ *
+ * PEM buffers (NUL terminated, as for mbedtls_x509_crt_parse()) are
+ * decoded into the heap. A DER certificate is parsed in place with
+ * mbedtls_x509_crt_parse_der_nocopy(): its buffer, e.g. a const array in
+ * flash, must not change while the store holds it.
+ */
+
+#if defined(NRC_TLS_CERT_STORE)
+
+/*********************************************************************
+ * @fn tls_cert_store_get_crt
+ *
+ * @brief Get the certificate chain of a PEM or DER buffer, parsed on the
+ *        first call. Release it with tls_cert_store_put_crt().
+ *
+ * @param buf, len: the certificates, len including the NUL of PEM
+ *
+ * @param err: if not NULL, set to the parse error when NULL is returned
+ *
+ * @return the chain, to pass to mbedtls_ssl_conf_ca_chain() or
+ *         mbedtls_ssl_conf_own_cert(); NULL on error
+ **********************************************************************/
+mbedtls_x509_crt *tls_cert_store_get_crt(const unsigned char *buf, size_t len, int *err);
+
+/*********************************************************************
+ * @fn tls_cert_store_get_key
+ *
+ * @brief Get the private key of a PEM or DER buffer, parsed on the first
+ *        call. Release it with tls_cert_store_put_key().
+ *
+ * @param buf, len: the key, len including the NUL of PEM
+ *
+ * @param pwd, pwd_len: the password of an encrypted key, or NULL
+ *
+ * @param err: if not NULL, set to the parse error when NULL is returned
+ *
+ * @return the key, NULL on error
+ **********************************************************************/
+mbedtls_pk_context *tls_cert_store_get_key(const unsigned char *buf, size_t len,
+										   const unsigned char *pwd, size_t pwd_len, int *err);
+
+/*********************************************************************
+ * @fn tls_cert_store_put_crt
+ *
+ * @brief Release a chain of tls_cert_store_get_crt(), once no
+ *        mbedtls_ssl_config using it is left. NULL is ignored.
+ **********************************************************************/
+void tls_cert_store_put_crt(mbedtls_x509_crt *crt);
+
+/*********************************************************************
+ * @fn tls_cert_store_put_key
+ *
+ * @brief Release a key of tls_cert_store_get_key(). NULL is ignored.
+ **********************************************************************/
+void tls_cert_store_put_key(mbedtls_pk_context *pk);
+
+/*********************************************************************
+ * @fn tls_cert_store_flush
+ *
+ * @brief Free the entries no connection uses, to give the heap back
+ *        when no TLS connection is expected for a while. A buffer
+ *        rewritten in place is parsed again without it, its old entry is
+ *        only dropped later.
+ **********************************************************************/
+void tls_cert_store_flush(void);
+
+#endif /* NRC_TLS_CERT_STORE */
+
+#endif /* __TLS_CERT_STORE_H__ */
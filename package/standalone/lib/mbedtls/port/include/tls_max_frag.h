@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __TLS_MAX_FRAG_H__
+#define __TLS_MAX_FRAG_H__
+
+#include "mbedtls/ssl.h"
+
+#include <stddef.h>
+
+/*
+ * The record size the TLS clients ask for with the max_fragment_length
+ * extension (RFC 6066): 512, 1024, 2048 or 4096 bytes, or 0 for records
+ * of up to 16 KB. Smaller records fit in fewer MPDUs, and once the
+ * handshake is over the I/O buffers of a connection shrink to the size
+ * the server agreed to (MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH): a connection
+ * holds about 9 KB instead of 38 KB at 2048 (tools/mfl_bench.c). The
+ * handshake still needs 16 KB buffers, to reassemble the messages the
+ * server splits into records. A server that ignores the extension still
+ * gets records of this size, but may send up to 16 KB ones back.
+ *
+ * The setting applies to the connections made after it changes. The
+ * default is NRC_TLS_MAX_FRAG_LEN.
+ */
+
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+
+/*********************************************************************
+ * @fn tls_max_frag_set
+ *
+ * @brief Set the record size of the next connections
+ *
+ * @param len: 512, 1024, 2048, 4096, or 0 not to ask for a limit
+ *
+ * @return 0, or -1 if len is none of these
+ **********************************************************************/
+int tls_max_frag_set(size_t len);
+
+/*********************************************************************
+ * @fn tls_max_frag_get
+ *
+ * @brief Get the record size of the next connections
+ *
+ * @return 512, 1024, 2048, 4096, or 0 if none is asked for
+ **********************************************************************/
+size_t tls_max_frag_get(void);
+
+/*********************************************************************
+ * @fn tls_max_frag_conf
+ *
+ * @brief Ask for the record size in the handshakes of a client
+ *        configuration, before mbedtls_ssl_setup()
+ *
+ * @param conf: the configuration
+ **********************************************************************/
+void tls_max_frag_conf(mbedtls_ssl_config *conf);
+
+#endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
+
+#endif /* __TLS_MAX_FRAG_H__ */
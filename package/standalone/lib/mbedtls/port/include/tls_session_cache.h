@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __TLS_SESSION_CACHE_H__
+#define __TLS_SESSION_CACHE_H__
+
+#include "mbedtls/ssl.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * TLS client sessions kept by host:port, so that the next connection to the
+ * same server resumes with the session ticket (RFC 5077) or the session ID
+ * instead of a full handshake. The master secret is kept, not the peer
+ * certificate: a resumed connection reports the verify result of the full
+ * handshake it resumes.
+ *
+ * Sessions expire with the ticket lifetime the server gave, or after
+ * NRC_TLS_SESSION_MAX_AGE seconds for session IDs.
+ */
+
+#if defined(NRC_TLS_SESSION_CACHE)
+
+/*********************************************************************
+ * @fn tls_session_cache_set
+ *
+ * @brief Offer the session kept for host:port in the next handshake,
+ *        between mbedtls_ssl_setup() and mbedtls_ssl_handshake()
+ *
+ * @param ssl: the client context
+ *
+ * @param host, port: the server
+ *
+ * @return 0 if a session is offered, -1 if none is kept for host:port,
+ *         MBEDTLS_ERR_SSL_* otherwise
+ **********************************************************************/
+int tls_session_cache_set(mbedtls_ssl_context *ssl, const char *host, int port);
+
+/*********************************************************************
+ * @fn tls_session_cache_update
+ *
+ * @brief Keep the session of a completed handshake for host:port
+ *
+ * @param ssl: the client context, after mbedtls_ssl_handshake() succeeded
+ *
+ * @param host, port: the server
+ *
+ * @return 1 if the handshake resumed the session offered, 0 if it was a
+ *         full one
+ **********************************************************************/
+int tls_session_cache_update(const mbedtls_ssl_context *ssl, const char *host, int port);
+
+/*********************************************************************
+ * @fn tls_session_cache_remove
+ *
+ * @brief Forget the session of host:port, after a failed handshake or
+ *        certificate check
+ **********************************************************************/
+void tls_session_cache_remove(const char *host, int port);
+
+/*********************************************************************
+ * @fn tls_session_cache_clear
+ *
+ * @brief Forget all sessions
+ **********************************************************************/
+void tls_session_cache_clear(void);
+
+/*********************************************************************
+ * @fn tls_session_cache_save
+ *
+ * @brief Serialize the live sessions, most recently used first, to keep
+ *        them over a deep sleep. What does not fit in buf is left out.
+ *        Clears the flag of tls_session_cache_changed().
+ *
+ * @param buf, len: where to write
+ *
+ * @return bytes written
+ **********************************************************************/
+int tls_session_cache_save(unsigned char *buf, size_t len);
+
+/*********************************************************************
+ * @fn tls_session_cache_restore
+ *
+ * @brief Put back sessions serialized by tls_session_cache_save()
+ *
+ * @param buf, len: the saved records
+ *
+ * @param elapsed: seconds since they were saved
+ *
+ * @return the number of sessions restored
+ **********************************************************************/
+int tls_session_cache_restore(const unsigned char *buf, size_t len, uint32_t elapsed);
+
+/*********************************************************************
+ * @fn tls_session_cache_changed
+ *
+ * @brief Whether a full handshake added or replaced a session, or one
+ *        was removed, since the last save, so that a flash copy is only
+ *        rewritten when needed. A new ticket for a resumed session does
+ *        not count: the one saved is still good for its own lifetime.
+ **********************************************************************/
+bool tls_session_cache_changed(void);
+
+#endif /* NRC_TLS_SESSION_CACHE */
+
+#endif /* __TLS_SESSION_CACHE_H__ */
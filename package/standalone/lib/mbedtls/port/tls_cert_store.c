@@ -0,0 +1,295 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "tls_cert_store.h"
+
+#if defined(NRC_TLS_CERT_STORE) && defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_PK_PARSE_C)
+
+#include "mbedtls/platform.h"
+#if defined(MBEDTLS_THREADING_C)
+#include "mbedtls/threading.h"
+#endif
+#if defined(MBEDTLS_THREADING_FREERTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef NRC_TLS_CERT_STORE_SIZE
+#define NRC_TLS_CERT_STORE_SIZE		6
+#endif
+
+typedef struct {
+	/* first: the pointer handed out is the entry */
+	union {
+		mbedtls_x509_crt crt;
+		mbedtls_pk_context pk;
+	} u;
+	bool is_key;
+	const unsigned char *buf;
+	size_t len;
+	uint32_t hash;
+	int refs;
+	uint32_t used;			/* LRU stamp */
+} tls_cert_entry_t;
+
+static tls_cert_entry_t *store[NRC_TLS_CERT_STORE_SIZE];
+static uint32_t store_stamp;
+
+#if defined(MBEDTLS_THREADING_C)
+static mbedtls_threading_mutex_t store_mutex;
+#endif
+
+static bool tls_cert_store_lock(void)
+{
+#if defined(MBEDTLS_THREADING_C)
+	if (!store_mutex.is_valid) {
+#if defined(MBEDTLS_THREADING_FREERTOS)
+		vTaskSuspendAll();
+#endif
+		if (!store_mutex.is_valid)
+			mbedtls_mutex_init(&store_mutex);
+#if defined(MBEDTLS_THREADING_FREERTOS)
+		xTaskResumeAll();
+#endif
+	}
+	return mbedtls_mutex_lock(&store_mutex) == 0;
+#else
+	return true;
+#endif
+}
+
+static void tls_cert_store_unlock(void)
+{
+#if defined(MBEDTLS_THREADING_C)
+	mbedtls_mutex_unlock(&store_mutex);
+#endif
+}
+
+/* FNV-1a, to tell a buffer rewritten in place from the one parsed */
+static uint32_t tls_cert_hash(uint32_t h, const unsigned char *p, size_t len)
+{
+	while (len-- > 0) {
+		h ^= *p++;
+		h *= 16777619UL;
+	}
+	return h;
+}
+
+static bool tls_cert_is_pem(const unsigned char *buf, size_t len)
+{
+	return len > 0 && buf[len - 1] == '\0' &&
+		   strstr((const char *)buf, "-----BEGIN ") != NULL;
+}
+
+static void tls_cert_entry_free(tls_cert_entry_t *e)
+{
+	if (e->is_key)
+		mbedtls_pk_free(&e->u.pk);
+	else
+		mbedtls_x509_crt_free(&e->u.crt);
+	mbedtls_free(e);
+}
+
+static tls_cert_entry_t *tls_cert_store_find(const unsigned char *buf, size_t len,
+											 uint32_t hash, bool is_key)
+{
+	int i;
+
+	for (i = 0; i < NRC_TLS_CERT_STORE_SIZE; i++) {
+		tls_cert_entry_t *e = store[i];
+
+		if (e != NULL && e->is_key == is_key && e->buf == buf &&
+			e->len == len && e->hash == hash)
+			return e;
+	}
+	return NULL;
+}
+
+/* Keep a new entry: in a free slot, or in place of the least recently used
+   one nobody holds. If all are held, the entry is not kept and is freed by
+   its last put. */
+static void tls_cert_store_insert(tls_cert_entry_t *e)
+{
+	int i, slot = -1;
+
+	for (i = 0; i < NRC_TLS_CERT_STORE_SIZE; i++) {
+		if (store[i] == NULL) {
+			slot = i;
+			break;
+		}
+		if (store[i]->refs == 0 && (slot < 0 || store[i]->used < store[slot]->used))
+			slot = i;
+	}
+	if (slot < 0)
+		return;
+	if (store[slot] != NULL)
+		tls_cert_entry_free(store[slot]);
+	store[slot] = e;
+}
+
+static tls_cert_entry_t *tls_cert_store_get(const unsigned char *buf, size_t len,
+											const unsigned char *pwd, size_t pwd_len,
+											bool is_key, int *err)
+{
+	tls_cert_entry_t *e;
+	uint32_t hash;
+	int ret;
+
+	if (buf == NULL || len == 0) {
+		ret = is_key ? MBEDTLS_ERR_PK_BAD_INPUT_DATA : MBEDTLS_ERR_X509_BAD_INPUT_DATA;
+		goto fail;
+	}
+	hash = tls_cert_hash(2166136261UL, buf, len);
+	if (is_key && pwd != NULL)
+		hash = tls_cert_hash(hash, pwd, pwd_len);
+
+	if (!tls_cert_store_lock()) {
+		ret = is_key ? MBEDTLS_ERR_PK_BAD_INPUT_DATA : MBEDTLS_ERR_X509_BAD_INPUT_DATA;
+		goto fail;
+	}
+
+	e = tls_cert_store_find(buf, len, hash, is_key);
+	if (e != NULL) {
+		e->refs++;
+		e->used = ++store_stamp;
+		tls_cert_store_unlock();
+		return e;
+	}
+
+	/* parsed with the lock held: a second user waits rather than parsing again */
+	e = mbedtls_calloc(1, sizeof(*e));
+	if (e == NULL) {
+		tls_cert_store_unlock();
+		ret = is_key ? MBEDTLS_ERR_PK_ALLOC_FAILED : MBEDTLS_ERR_X509_ALLOC_FAILED;
+		goto fail;
+	}
+	e->is_key = is_key;
+	if (is_key) {
+		mbedtls_pk_init(&e->u.pk);
+		ret = mbedtls_pk_parse_key(&e->u.pk, buf, len, pwd, pwd_len);
+	} else {
+		mbedtls_x509_crt_init(&e->u.crt);
+		if (tls_cert_is_pem(buf, len)) {
+			/* > 0: some of the chain could not be parsed, the rest is used */
+			ret = mbedtls_x509_crt_parse(&e->u.crt, buf, len);
+			if (ret > 0 && e->u.crt.version != 0)
+				ret = 0;
+		} else
+			ret = mbedtls_x509_crt_parse_der_nocopy(&e->u.crt, buf, len);
+	}
+	if (ret != 0) {
+		tls_cert_store_unlock();
+		tls_cert_entry_free(e);
+		goto fail;
+	}
+	e->buf = buf;
+	e->len = len;
+	e->hash = hash;
+	e->refs = 1;
+	e->used = ++store_stamp;
+	tls_cert_store_insert(e);
+
+	tls_cert_store_unlock();
+	return e;
+
+fail:
+	if (err != NULL)
+		*err = ret;
+	return NULL;
+}
+
+static void tls_cert_store_put(void *p)
+{
+	tls_cert_entry_t *e = p;
+	int i;
+
+	if (e == NULL || !tls_cert_store_lock())
+		return;
+
+	for (i = 0; i < NRC_TLS_CERT_STORE_SIZE; i++) {
+		if (store[i] == e)
+			break;
+	}
+	if (--e->refs == 0 && i == NRC_TLS_CERT_STORE_SIZE) {
+		/* not kept, the store was full */
+		tls_cert_entry_free(e);
+	}
+
+	tls_cert_store_unlock();
+}
+
+mbedtls_x509_crt *tls_cert_store_get_crt(const unsigned char *buf, size_t len, int *err)
+{
+	tls_cert_entry_t *e = tls_cert_store_get(buf, len, NULL, 0, false, err);
+
+	return e != NULL ? &e->u.crt : NULL;
+}
+
+mbedtls_pk_context *tls_cert_store_get_key(const unsigned char *buf, size_t len,
+										   const unsigned char *pwd, size_t pwd_len, int *err)
+{
+	tls_cert_entry_t *e = tls_cert_store_get(buf, len, pwd, pwd_len, true, err);
+
+	return e != NULL ? &e->u.pk : NULL;
+}
+
+void tls_cert_store_put_crt(mbedtls_x509_crt *crt)
+{
+	tls_cert_store_put(crt);
+}
+
+void tls_cert_store_put_key(mbedtls_pk_context *pk)
+{
+	tls_cert_store_put(pk);
+}
+
+void tls_cert_store_flush(void)
+{
+	int i;
+
+	if (!tls_cert_store_lock())
+		return;
+
+	for (i = 0; i < NRC_TLS_CERT_STORE_SIZE; i++) {
+		if (store[i] != NULL && store[i]->refs == 0) {
+			tls_cert_entry_free(store[i]);
+			store[i] = NULL;
+		}
+	}
+
+	tls_cert_store_unlock();
+}
+
+#endif /* NRC_TLS_CERT_STORE && MBEDTLS_X509_CRT_PARSE_C && MBEDTLS_PK_PARSE_C */
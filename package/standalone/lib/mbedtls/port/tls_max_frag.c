@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "tls_max_frag.h"
+
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+
+#ifndef NRC_TLS_MAX_FRAG_LEN
+#define NRC_TLS_MAX_FRAG_LEN		0
+#endif
+
+#if NRC_TLS_MAX_FRAG_LEN == 0
+#define TLS_MAX_FRAG_CODE	MBEDTLS_SSL_MAX_FRAG_LEN_NONE
+#elif NRC_TLS_MAX_FRAG_LEN == 512
+#define TLS_MAX_FRAG_CODE	MBEDTLS_SSL_MAX_FRAG_LEN_512
+#elif NRC_TLS_MAX_FRAG_LEN == 1024
+#define TLS_MAX_FRAG_CODE	MBEDTLS_SSL_MAX_FRAG_LEN_1024
+#elif NRC_TLS_MAX_FRAG_LEN == 2048
+#define TLS_MAX_FRAG_CODE	MBEDTLS_SSL_MAX_FRAG_LEN_2048
+#elif NRC_TLS_MAX_FRAG_LEN == 4096
+#define TLS_MAX_FRAG_CODE	MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#else
+#error "NRC_TLS_MAX_FRAG_LEN is none of 0, 512, 1024, 2048 and 4096"
+#endif
+
+static unsigned char max_frag_code = TLS_MAX_FRAG_CODE;
+
+static int tls_max_frag_code(size_t len, unsigned char *code)
+{
+	switch (len) {
+		case 0:
+			*code = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+			break;
+		case 512:
+			*code = MBEDTLS_SSL_MAX_FRAG_LEN_512;
+			break;
+		case 1024:
+			*code = MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+			break;
+		case 2048:
+			*code = MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+			break;
+		case 4096:
+			*code = MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+			break;
+		default:
+			return -1;
+	}
+	return 0;
+}
+
+int tls_max_frag_set(size_t len)
+{
+	unsigned char code;
+
+	if (tls_max_frag_code(len, &code) != 0)
+		return -1;
+	max_frag_code = code;
+	return 0;
+}
+
+size_t tls_max_frag_get(void)
+{
+	if (max_frag_code == MBEDTLS_SSL_MAX_FRAG_LEN_NONE)
+		return 0;
+	return (size_t)256 << max_frag_code;
+}
+
+void tls_max_frag_conf(mbedtls_ssl_config *conf)
+{
+	/* the codes above are all valid ones */
+	(void)mbedtls_ssl_conf_max_frag_len(conf, max_frag_code);
+}
+
+#endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
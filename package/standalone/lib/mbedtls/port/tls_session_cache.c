@@ -0,0 +1,528 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "tls_session_cache.h"
+
+#if defined(NRC_TLS_SESSION_CACHE) && defined(MBEDTLS_SSL_CLI_C)
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef NRC_TLS_SESSION_CACHE_SIZE
+#define NRC_TLS_SESSION_CACHE_SIZE	4
+#endif
+
+#ifndef NRC_TLS_SESSION_MAX_AGE
+#define NRC_TLS_SESSION_MAX_AGE		86400
+#endif
+
+/* "host:port" */
+#define TLS_SESSION_KEY_MAX		80
+
+/* Version of the records of tls_session_cache_save() */
+#define TLS_SESSION_SAVE_VERSION	1
+
+typedef struct {
+	char key[TLS_SESSION_KEY_MAX];
+	uint32_t expires;		/* uptime, s */
+	uint32_t used;			/* LRU stamp, 0: free */
+	unsigned char *data;	/* serialized session */
+	size_t len;
+} tls_session_entry_t;
+
+static tls_session_entry_t cache[NRC_TLS_SESSION_CACHE_SIZE];
+static uint32_t cache_stamp;
+static bool cache_changed;
+static SemaphoreHandle_t cache_lock;
+
+static uint32_t tls_session_now(void)
+{
+	return (uint32_t)(xTaskGetTickCount() / configTICK_RATE_HZ);
+}
+
+static bool tls_session_lock(void)
+{
+	if (cache_lock == NULL) {
+		SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+
+		if (lock == NULL)
+			return false;
+		vTaskSuspendAll();
+		if (cache_lock == NULL) {
+			cache_lock = lock;
+			lock = NULL;
+		}
+		xTaskResumeAll();
+		if (lock != NULL)
+			vSemaphoreDelete(lock);
+	}
+	return xSemaphoreTake(cache_lock, portMAX_DELAY) == pdTRUE;
+}
+
+static void tls_session_unlock(void)
+{
+	xSemaphoreGive(cache_lock);
+}
+
+static bool tls_session_key(char *key, const char *host, int port)
+{
+	int n = snprintf(key, TLS_SESSION_KEY_MAX, "%s:%d", host, port);
+
+	return n > 0 && n < TLS_SESSION_KEY_MAX;
+}
+
+static void tls_session_entry_free(tls_session_entry_t *e)
+{
+	if (e->data != NULL) {
+		mbedtls_platform_zeroize(e->data, e->len);
+		mbedtls_free(e->data);
+	}
+	memset(e, 0, sizeof(*e));
+}
+
+/* The live entry of key, expired ones are dropped on the way */
+static tls_session_entry_t *tls_session_find(const char *key)
+{
+	uint32_t now = tls_session_now();
+	int i;
+
+	for (i = 0; i < NRC_TLS_SESSION_CACHE_SIZE; i++) {
+		tls_session_entry_t *e = &cache[i];
+
+		if (e->used == 0)
+			continue;
+		if ((int32_t)(e->expires - now) <= 0) {
+			tls_session_entry_free(e);
+			continue;
+		}
+		if (strcmp(e->key, key) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+/* A free entry, or the least recently used one */
+static tls_session_entry_t *tls_session_alloc(void)
+{
+	tls_session_entry_t *lru = &cache[0];
+	int i;
+
+	for (i = 0; i < NRC_TLS_SESSION_CACHE_SIZE; i++) {
+		if (cache[i].used == 0)
+			return &cache[i];
+		if (cache[i].used < lru->used)
+			lru = &cache[i];
+	}
+	tls_session_entry_free(lru);
+	return lru;
+}
+
+/*
+ * Serialized session:
+ *   ciphersuite(2) compression(1) id_len(1) id master(48) verify_result(4)
+ *   ticket_len(2) ticket ticket_lifetime(4) mfl_code(1) trunc_hmac(1) etm(1)
+ */
+#define TLS_SESSION_FIXED_LEN	(2 + 1 + 1 + 48 + 4 + 2 + 4 + 1 + 1 + 1)
+
+static size_t tls_session_size(const mbedtls_ssl_session *s)
+{
+	size_t len = TLS_SESSION_FIXED_LEN + s->id_len;
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+	len += s->ticket_len;
+#endif
+	return len;
+}
+
+static void tls_session_write(unsigned char *p, const mbedtls_ssl_session *s)
+{
+	size_t ticket_len = 0;
+	uint32_t lifetime = 0;
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+	ticket_len = s->ticket_len;
+	lifetime = s->ticket_lifetime;
+#endif
+	*p++ = (unsigned char)(s->ciphersuite >> 8);
+	*p++ = (unsigned char)(s->ciphersuite);
+	*p++ = (unsigned char)(s->compression);
+	*p++ = (unsigned char)(s->id_len);
+	memcpy(p, s->id, s->id_len);
+	p += s->id_len;
+	memcpy(p, s->master, sizeof(s->master));
+	p += sizeof(s->master);
+	*p++ = (unsigned char)(s->verify_result >> 24);
+	*p++ = (unsigned char)(s->verify_result >> 16);
+	*p++ = (unsigned char)(s->verify_result >> 8);
+	*p++ = (unsigned char)(s->verify_result);
+	*p++ = (unsigned char)(ticket_len >> 8);
+	*p++ = (unsigned char)(ticket_len);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+	if (ticket_len > 0)
+		memcpy(p, s->ticket, ticket_len);
+	p += ticket_len;
+#endif
+	*p++ = (unsigned char)(lifetime >> 24);
+	*p++ = (unsigned char)(lifetime >> 16);
+	*p++ = (unsigned char)(lifetime >> 8);
+	*p++ = (unsigned char)(lifetime);
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+	*p++ = s->mfl_code;
+#else
+	*p++ = 0;
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+	*p++ = (unsigned char)s->trunc_hmac;
+#else
+	*p++ = 0;
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+	*p++ = (unsigned char)s->encrypt_then_mac;
+#else
+	*p++ = 0;
+#endif
+}
+
+/* Into an initialized session; 0 or MBEDTLS_ERR_SSL_* */
+static int tls_session_read(mbedtls_ssl_session *s, const unsigned char *p, size_t len)
+{
+	const unsigned char *end = p + len;
+	size_t id_len, ticket_len;
+
+	if (len < TLS_SESSION_FIXED_LEN)
+		return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+	s->ciphersuite = (p[0] << 8) | p[1];
+	s->compression = p[2];
+	id_len = p[3];
+	p += 4;
+	if (id_len > sizeof(s->id) || (size_t)(end - p) < id_len + 48 + 4 + 2)
+		return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+	s->id_len = id_len;
+	memcpy(s->id, p, id_len);
+	p += id_len;
+	memcpy(s->master, p, sizeof(s->master));
+	p += sizeof(s->master);
+	s->verify_result = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+					   ((uint32_t)p[2] << 8) | p[3];
+	ticket_len = (p[4] << 8) | p[5];
+	p += 6;
+	if ((size_t)(end - p) != ticket_len + 4 + 3)
+		return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+	if (ticket_len > 0) {
+		s->ticket = mbedtls_calloc(1, ticket_len);
+		if (s->ticket == NULL)
+			return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+		memcpy(s->ticket, p, ticket_len);
+		s->ticket_len = ticket_len;
+	}
+	s->ticket_lifetime = ((uint32_t)p[ticket_len] << 24) | ((uint32_t)p[ticket_len + 1] << 16) |
+						 ((uint32_t)p[ticket_len + 2] << 8) | p[ticket_len + 3];
+#else
+	if (ticket_len > 0)
+		return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+#endif
+	p += ticket_len + 4;
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+	s->mfl_code = p[0];
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+	s->trunc_hmac = p[1];
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+	s->encrypt_then_mac = p[2];
+#endif
+	return 0;
+}
+
+/* Seconds the server lets the session be resumed */
+static uint32_t tls_session_lifetime(const mbedtls_ssl_session *s)
+{
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+	if (s->ticket_len > 0 && s->ticket_lifetime > 0)
+		return s->ticket_lifetime < NRC_TLS_SESSION_MAX_AGE ? s->ticket_lifetime : NRC_TLS_SESSION_MAX_AGE;
+#endif
+	return NRC_TLS_SESSION_MAX_AGE;
+}
+
+int tls_session_cache_set(mbedtls_ssl_context *ssl, const char *host, int port)
+{
+	char key[TLS_SESSION_KEY_MAX];
+	mbedtls_ssl_session session;
+	tls_session_entry_t *e;
+	int ret = -1;
+
+	if (!tls_session_key(key, host, port) || !tls_session_lock())
+		return ret;
+
+	mbedtls_ssl_session_init(&session);
+	e = tls_session_find(key);
+	if (e != NULL) {
+		ret = tls_session_read(&session, e->data, e->len);
+		if (ret == 0) {
+			e->used = ++cache_stamp;
+			ret = mbedtls_ssl_set_session(ssl, &session);
+		}
+		if (ret != 0)
+			tls_session_entry_free(e);
+	}
+	mbedtls_ssl_session_free(&session);
+
+	tls_session_unlock();
+	return ret;
+}
+
+int tls_session_cache_update(const mbedtls_ssl_context *ssl, const char *host, int port)
+{
+	const mbedtls_ssl_session *s = ssl->session;
+	char key[TLS_SESSION_KEY_MAX];
+	tls_session_entry_t *e;
+	unsigned char *data;
+	size_t len;
+	int resumed = 0;
+
+	if (s == NULL || !tls_session_key(key, host, port) || !tls_session_lock())
+		return 0;
+
+	e = tls_session_find(key);
+	/* the master secret only stays the same when the session was resumed */
+	if (e != NULL)
+		resumed = memcmp(e->data + 4 + e->data[3], s->master, sizeof(s->master)) == 0;
+
+	len = tls_session_size(s);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+	if (s->id_len == 0 && s->ticket_len == 0)
+#else
+	if (s->id_len == 0)
+#endif
+	{
+		/* the server does not resume */
+		if (e != NULL)
+			tls_session_entry_free(e);
+		goto out;
+	}
+
+	data = mbedtls_calloc(1, len);
+	if (data == NULL)
+		goto out;
+	tls_session_write(data, s);
+
+	if (e == NULL) {
+		e = tls_session_alloc();
+		strcpy(e->key, key);
+	}
+	if (e->data == NULL || e->len != len || memcmp(e->data, data, len) != 0) {
+		/* a new session, or a new ticket for the one resumed */
+		e->expires = tls_session_now() + tls_session_lifetime(s);
+		/* the ticket saved before still resumes within its own lifetime:
+		   a saved copy is only stale after a full handshake */
+		if (!resumed)
+			cache_changed = true;
+	}
+	if (e->data != NULL) {
+		mbedtls_platform_zeroize(e->data, e->len);
+		mbedtls_free(e->data);
+	}
+	e->data = data;
+	e->len = len;
+	e->used = ++cache_stamp;
+
+out:
+	tls_session_unlock();
+	return resumed;
+}
+
+void tls_session_cache_remove(const char *host, int port)
+{
+	char key[TLS_SESSION_KEY_MAX];
+	tls_session_entry_t *e;
+
+	if (!tls_session_key(key, host, port) || !tls_session_lock())
+		return;
+
+	e = tls_session_find(key);
+	if (e != NULL) {
+		tls_session_entry_free(e);
+		cache_changed = true;
+	}
+
+	tls_session_unlock();
+}
+
+void tls_session_cache_clear(void)
+{
+	int i;
+
+	if (!tls_session_lock())
+		return;
+
+	for (i = 0; i < NRC_TLS_SESSION_CACHE_SIZE; i++) {
+		if (cache[i].used != 0) {
+			tls_session_entry_free(&cache[i]);
+			cache_changed = true;
+		}
+	}
+
+	tls_session_unlock();
+}
+
+/*
+ * Saved records, after a version byte:
+ *   key_len(1) key lifetime_left(4) len(2) session
+ */
+int tls_session_cache_save(unsigned char *buf, size_t len)
+{
+	uint32_t now = tls_session_now();
+	uint32_t last = UINT32_MAX;
+	size_t pos = 0;
+
+	if (len < 1 || !tls_session_lock())
+		return 0;
+
+	buf[pos++] = TLS_SESSION_SAVE_VERSION;
+	for (;;) {
+		tls_session_entry_t *e = NULL;
+		size_t key_len;
+		uint32_t left;
+		int i;
+
+		/* the next most recently used */
+		for (i = 0; i < NRC_TLS_SESSION_CACHE_SIZE; i++) {
+			if (cache[i].used != 0 && cache[i].used < last &&
+				(e == NULL || cache[i].used > e->used))
+				e = &cache[i];
+		}
+		if (e == NULL)
+			break;
+		last = e->used;
+
+		left = e->expires - now;
+		if ((int32_t)left <= 0)
+			continue;
+		key_len = strlen(e->key);
+		if (pos + 1 + key_len + 4 + 2 + e->len > len)
+			continue;
+
+		buf[pos++] = (unsigned char)key_len;
+		memcpy(buf + pos, e->key, key_len);
+		pos += key_len;
+		buf[pos++] = (unsigned char)(left >> 24);
+		buf[pos++] = (unsigned char)(left >> 16);
+		buf[pos++] = (unsigned char)(left >> 8);
+		buf[pos++] = (unsigned char)(left);
+		buf[pos++] = (unsigned char)(e->len >> 8);
+		buf[pos++] = (unsigned char)(e->len);
+		memcpy(buf + pos, e->data, e->len);
+		pos += e->len;
+	}
+	cache_changed = false;
+
+	tls_session_unlock();
+	return pos > 1 ? (int)pos : 0;
+}
+
+int tls_session_cache_restore(const unsigned char *buf, size_t len, uint32_t elapsed)
+{
+	uint32_t now = tls_session_now();
+	uint32_t stamp;
+	size_t pos = 1;
+	int n = 0;
+
+	if (len < 1 || buf[0] != TLS_SESSION_SAVE_VERSION || !tls_session_lock())
+		return 0;
+
+	/* saved most recently used first: stamp them from the top down */
+	stamp = cache_stamp + NRC_TLS_SESSION_CACHE_SIZE + 1;
+	cache_stamp = stamp;
+
+	while (pos < len) {
+		mbedtls_ssl_session session;
+		tls_session_entry_t *e;
+		size_t key_len, data_len;
+		uint32_t left;
+		int ret;
+
+		key_len = buf[pos];
+		if (key_len >= TLS_SESSION_KEY_MAX || len - pos < 1 + key_len + 4 + 2)
+			break;
+		data_len = (buf[pos + 1 + key_len + 4] << 8) | buf[pos + 1 + key_len + 5];
+		if (len - pos - (1 + key_len + 4 + 2) < data_len)
+			break;
+		left = ((uint32_t)buf[pos + 1 + key_len] << 24) | ((uint32_t)buf[pos + 1 + key_len + 1] << 16) |
+			   ((uint32_t)buf[pos + 1 + key_len + 2] << 8) | buf[pos + 1 + key_len + 3];
+
+		/* checked the way tls_session_cache_set() will read it */
+		mbedtls_ssl_session_init(&session);
+		ret = tls_session_read(&session, buf + pos + 1 + key_len + 6, data_len);
+		mbedtls_ssl_session_free(&session);
+
+		if (ret == 0 && left > elapsed) {
+			char key[TLS_SESSION_KEY_MAX];
+
+			memcpy(key, buf + pos + 1, key_len);
+			key[key_len] = '\0';
+			e = tls_session_find(key);
+			if (e == NULL) {
+				unsigned char *data = mbedtls_calloc(1, data_len);
+
+				if (data != NULL) {
+					/* saved most recent first: the oldest gets the lowest stamp */
+					e = tls_session_alloc();
+					strcpy(e->key, key);
+					memcpy(data, buf + pos + 1 + key_len + 6, data_len);
+					e->data = data;
+					e->len = data_len;
+					e->expires = now + (left - elapsed);
+					e->used = --stamp;
+					n++;
+				}
+			}
+		}
+		pos += 1 + key_len + 6 + data_len;
+	}
+
+	tls_session_unlock();
+	return n;
+}
+
+bool tls_session_cache_changed(void)
+{
+	return cache_changed;
+}
+
+#endif /* NRC_TLS_SESSION_CACHE && MBEDTLS_SSL_CLI_C */
@@ -0,0 +1,264 @@
+/*
+ * Host benchmark for the shared certificate store (port/tls_cert_store.c).
+ *
+ * Connects to ssl_server2 with a CA, a client certificate and a key, the
+ * way NetworkConnectTLS() and httpc_ssl_conn() do: parsing them for each
+ * connection, or taking them from the store, from PEM or from DER parsed
+ * in place. Reports the parse and connect time per connection, the peak
+ * heap of a connection, and the heap the certificates of an MQTT and an
+ * HTTPS connection hold while both are open.
+ *
+ * Build lib/mbedtls/mbedtls for the host with host/build.sh first:
+ *
+ *   M=/tmp/nrc-mbedtls-host
+ *   gcc -O2 -DNRC_TLS_CERT_STORE -Ihost/include -I$M/include -I../port/include \
+ *       -Wl,--wrap=calloc,--wrap=free -o cert_store_bench \
+ *       cert_store_bench.c ../port/tls_cert_store.c \
+ *       -L$M/library -lmbedtls -lmbedx509 -lmbedcrypto
+ *   $M/programs/ssl/ssl_server2 server_port=14433 auth_mode=optional \
+ *       force_ciphersuite=TLS-ECDHE-RSA-WITH-AES-128-GCM-SHA256 &
+ *   ./cert_store_bench [port] [connections]
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/certs.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "tls_cert_store.h"
+
+/* Heap accounting of the mbedTLS calls through --wrap */
+static size_t cur_bytes, peak_bytes;
+
+void *__real_calloc(size_t n, size_t size);
+void __real_free(void *p);
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+	void *p = __real_calloc(n, size);
+
+	if (p != NULL) {
+		cur_bytes += malloc_usable_size(p);
+		if (cur_bytes > peak_bytes)
+			peak_bytes = cur_bytes;
+	}
+	return p;
+}
+
+void __wrap_free(void *p)
+{
+	if (p != NULL)
+		cur_bytes -= malloc_usable_size(p);
+	__real_free(p);
+}
+
+enum { PER_CONNECTION, STORE_PEM, STORE_DER, MODES };
+
+static const char *mode_name[MODES] = { "per connection", "store, PEM", "store, DER in place" };
+
+struct certs {
+	const unsigned char *ca, *cli, *key;
+	size_t ca_len, cli_len, key_len;
+};
+
+/* One client connection, as the MQTT and HTTP clients keep it */
+struct conn {
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_config conf;
+	mbedtls_net_context net;
+	mbedtls_x509_crt *cacert, *clicert;
+	mbedtls_pk_context *pkey;
+	/* per connection */
+	mbedtls_x509_crt own_cacert, own_clicert;
+	mbedtls_pk_context own_pkey;
+};
+
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctr_drbg;
+static const char *port = "14433";
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int conn_certs(struct conn *c, int mode, const struct certs *certs)
+{
+	int ret;
+
+	memset(c, 0, sizeof(*c));
+	mbedtls_net_init(&c->net);
+	mbedtls_ssl_init(&c->ssl);
+	mbedtls_ssl_config_init(&c->conf);
+
+	if (mode == PER_CONNECTION) {
+		mbedtls_x509_crt_init(&c->own_cacert);
+		mbedtls_x509_crt_init(&c->own_clicert);
+		mbedtls_pk_init(&c->own_pkey);
+		c->cacert = &c->own_cacert;
+		c->clicert = &c->own_clicert;
+		c->pkey = &c->own_pkey;
+		if ((ret = mbedtls_x509_crt_parse(c->cacert, certs->ca, certs->ca_len)) < 0 ||
+			(ret = mbedtls_x509_crt_parse(c->clicert, certs->cli, certs->cli_len)) < 0 ||
+			(ret = mbedtls_pk_parse_key(c->pkey, certs->key, certs->key_len, NULL, 0)) != 0)
+			return ret;
+		return 0;
+	}
+
+	ret = 0;
+	c->cacert = tls_cert_store_get_crt(certs->ca, certs->ca_len, &ret);
+	c->clicert = tls_cert_store_get_crt(certs->cli, certs->cli_len, &ret);
+	c->pkey = tls_cert_store_get_key(certs->key, certs->key_len, NULL, 0, &ret);
+	return ret;
+}
+
+static int conn_setup(struct conn *c, int mode, const struct certs *certs)
+{
+	int ret;
+
+	if ((ret = conn_certs(c, mode, certs)) != 0)
+		return ret;
+	if ((ret = mbedtls_ssl_config_defaults(&c->conf, MBEDTLS_SSL_IS_CLIENT,
+										   MBEDTLS_SSL_TRANSPORT_STREAM,
+										   MBEDTLS_SSL_PRESET_DEFAULT)) != 0)
+		return ret;
+	mbedtls_ssl_conf_authmode(&c->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+	mbedtls_ssl_conf_ca_chain(&c->conf, c->cacert, NULL);
+	if ((ret = mbedtls_ssl_conf_own_cert(&c->conf, c->clicert, c->pkey)) != 0)
+		return ret;
+	mbedtls_ssl_conf_rng(&c->conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+	if ((ret = mbedtls_ssl_setup(&c->ssl, &c->conf)) != 0)
+		return ret;
+	return mbedtls_ssl_set_hostname(&c->ssl, "localhost");
+}
+
+static int conn_handshake(struct conn *c)
+{
+	int ret;
+
+	if ((ret = mbedtls_net_connect(&c->net, "localhost", port, MBEDTLS_NET_PROTO_TCP)) != 0)
+		return ret;
+	mbedtls_ssl_set_bio(&c->ssl, &c->net, mbedtls_net_send, mbedtls_net_recv, NULL);
+	while ((ret = mbedtls_ssl_handshake(&c->ssl)) != 0) {
+		if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+			return ret;
+	}
+	if (mbedtls_ssl_get_verify_result(&c->ssl) != 0)
+		return -1;
+	mbedtls_ssl_close_notify(&c->ssl);
+	return 0;
+}
+
+static void conn_free(struct conn *c, int mode)
+{
+	mbedtls_net_free(&c->net);
+	mbedtls_ssl_free(&c->ssl);
+	mbedtls_ssl_config_free(&c->conf);
+	if (mode == PER_CONNECTION) {
+		mbedtls_x509_crt_free(&c->own_cacert);
+		mbedtls_x509_crt_free(&c->own_clicert);
+		mbedtls_pk_free(&c->own_pkey);
+	} else {
+		tls_cert_store_put_crt(c->cacert);
+		tls_cert_store_put_crt(c->clicert);
+		tls_cert_store_put_key(c->pkey);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const struct certs pem = {
+		(const unsigned char *)mbedtls_test_ca_crt_rsa_sha256_pem,
+		(const unsigned char *)mbedtls_test_cli_crt_rsa,
+		(const unsigned char *)mbedtls_test_cli_key_rsa,
+		mbedtls_test_ca_crt_rsa_sha256_pem_len,
+		mbedtls_test_cli_crt_rsa_len,
+		mbedtls_test_cli_key_rsa_len
+	};
+	const struct certs der = {
+		mbedtls_test_ca_crt_rsa_sha256_der,
+		mbedtls_test_cli_crt_rsa_der,
+		mbedtls_test_cli_key_rsa_der,
+		mbedtls_test_ca_crt_rsa_sha256_der_len,
+		mbedtls_test_cli_crt_rsa_der_len,
+		mbedtls_test_cli_key_rsa_der_len
+	};
+	int count = 20;
+	int mode, i, ret;
+
+	if (argc > 1)
+		port = argv[1];
+	if (argc > 2)
+		count = atoi(argv[2]);
+
+	mbedtls_entropy_init(&entropy);
+	mbedtls_ctr_drbg_init(&ctr_drbg);
+	if (mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, NULL, 0) != 0)
+		return 1;
+
+	printf("%d connections to localhost:%s, RSA-2048 CA, client certificate and key\n",
+		   count, port);
+	printf("%-20s %10s %12s %12s %14s\n", "certificates", "setup ms", "connect ms",
+		   "peak heap", "held, 2 conns");
+	for (mode = 0; mode < MODES; mode++) {
+		const struct certs *certs = mode == STORE_DER ? &der : &pem;
+		double setup = 0, connect = 0;
+		size_t base, peak = 0, held;
+		struct conn *c = calloc(2, sizeof(*c));
+
+		/* the first connection fills the store, it is not counted */
+		for (i = -1; i < count; i++) {
+			double t0, t1, t2;
+
+			base = cur_bytes;
+			peak_bytes = cur_bytes;
+			t0 = now_ms();
+			ret = conn_setup(&c[0], mode, certs);
+			t1 = now_ms();
+			if (ret == 0)
+				ret = conn_handshake(&c[0]);
+			t2 = now_ms();
+			if (ret != 0) {
+				printf("%s: connection failed -0x%04x\n", mode_name[mode], -ret);
+				return 1;
+			}
+			conn_free(&c[0], mode);
+			if (i < 0)
+				continue;
+			setup += t1 - t0;
+			connect += t2 - t0;
+			if (peak_bytes - base > peak)
+				peak = peak_bytes - base;
+		}
+
+		/* the certificates of an MQTT and an HTTPS connection open at once,
+		   from an empty store */
+		tls_cert_store_flush();
+		base = cur_bytes;
+		if (conn_certs(&c[0], mode, certs) != 0 || conn_certs(&c[1], mode, certs) != 0) {
+			printf("%s: parse failed\n", mode_name[mode]);
+			return 1;
+		}
+		held = cur_bytes - base;
+		conn_free(&c[0], mode);
+		conn_free(&c[1], mode);
+		tls_cert_store_flush();
+		free(c);
+
+		printf("%-20s %10.2f %12.2f %12zu %14zu\n", mode_name[mode], setup / count,
+			   connect / count, peak, held);
+	}
+
+	mbedtls_ctr_drbg_free(&ctr_drbg);
+	mbedtls_entropy_free(&entropy);
+	return 0;
+}
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""
+Precomputed comb table of the secp256r1 base point for ecp_curves.c.
+
+ecp_mul_comb() multiplies the base point G with a table of 2^(w-1) points,
+T[i] = G + sum(2^(d*(l+1)) G for each bit l set in i), d = ceil(nbits / w),
+normalized to Z = 1 (see ecp_precompute_comb()). Without a static table it
+computes the table on the first multiplication of each group and keeps it in
+the heap. This script computes the same table for the window
+ecp_pick_window_size() picks for G (w = 5 on a 256-bit curve) and prints it
+in the limb format of ecp_curves.c, so that it can live in flash:
+
+    ./ecp_comb_table.py > /tmp/secp256r1_T.h
+"""
+
+import argparse
+
+P = 0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF
+A = P - 3
+B = 0x5AC635D8AA3A93E7B3EBBD55769886BC651D06B0CC53B0F63BCE3C3E27D2604B
+GX = 0x6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296
+GY = 0x4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5
+NBITS = 256
+
+
+def add(p, q):
+    """Affine addition, None is the point at infinity"""
+    if p is None:
+        return q
+    if q is None:
+        return p
+    if p[0] == q[0]:
+        if (p[1] + q[1]) % P == 0:
+            return None
+        lam = (3 * p[0] * p[0] + A) * pow(2 * p[1], -1, P) % P
+    else:
+        lam = (q[1] - p[1]) * pow(q[0] - p[0], -1, P) % P
+    x = (lam * lam - p[0] - q[0]) % P
+    return (x, (lam * (p[0] - x) - p[1]) % P)
+
+
+def double_n(p, n):
+    for _ in range(n):
+        p = add(p, p)
+    return p
+
+
+def comb_table(w):
+    d = (NBITS + w - 1) // w
+    g = (GX, GY)
+    assert (GY * GY - GX ** 3 - A * GX - B) % P == 0
+    # G_l = 2^(d*l) G, l = 1 .. w-1
+    gl = [double_n(g, d * l) for l in range(1, w)]
+    table = []
+    for i in range(1 << (w - 1)):
+        t = g
+        for l in range(w - 1):
+            if i & (1 << l):
+                t = add(t, gl[l])
+        table.append(t)
+    return table
+
+
+def limbs(v):
+    b = v.to_bytes(NBITS // 8, "little")
+    return ["    BYTES_TO_T_UINT_8( %s )," %
+            ", ".join("0x%02X" % c for c in b[i:i + 8])
+            for i in range(0, len(b), 8)]
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    p.add_argument("--name", default="secp256r1", help="prefix of the C names")
+    p.add_argument("--window", type=int, default=5,
+                   help="w of ecp_pick_window_size() for the base point")
+    args = p.parse_args()
+
+    table = comb_table(args.window)
+    assert table[0] == (GX, GY)
+    for i, (x, y) in enumerate(table):
+        for coord, v in (("X", x), ("Y", y)):
+            print("static const mbedtls_mpi_uint %s_T_%d_%s[] = {" % (args.name, i, coord))
+            print("\n".join(limbs(v)))
+            print("};")
+    print("static const mbedtls_ecp_point %s_T[%d] = {" % (args.name, len(table)))
+    for i in range(len(table)):
+        print("    ECP_POINT_INIT_XY_Z1( %s_T_%d_X, %s_T_%d_Y )," % ((args.name, i) * 2))
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
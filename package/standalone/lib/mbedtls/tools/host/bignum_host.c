@@ -0,0 +1,75 @@
+/*
+ * Host build of lib/mbedtls/mbedtls (tools/host/build.sh): the functions of
+ * the mbedTLS 2.16 bignum API that the software library/bignum.c of the SDK
+ * lacks (port/bignum_hw.c has them on the device).
+ */
+
+#include "mbedtls/bignum.h"
+
+#include <string.h>
+
+#define ciL    (sizeof(mbedtls_mpi_uint))         /* chars in limb  */
+
+#define CHARS_TO_LIMBS(i) ( (i) / ciL + ( (i) % ciL != 0 ) )
+
+#define GET_BYTE( X, i )                                \
+    ( ( ( X )->p[( i ) / ciL] >> ( ( ( i ) % ciL ) * 8 ) ) & 0xff )
+
+int mbedtls_mpi_read_binary_le( mbedtls_mpi *X,
+                                const unsigned char *buf, size_t buflen )
+{
+    int ret;
+    size_t i;
+
+    if( ( ret = mbedtls_mpi_grow( X, CHARS_TO_LIMBS( buflen ) ) ) != 0 ||
+        ( ret = mbedtls_mpi_lset( X, 0 ) ) != 0 )
+        return( ret );
+
+    for( i = 0; i < buflen; i++ )
+        X->p[i / ciL] |= ( (mbedtls_mpi_uint) buf[i] ) << ( ( i % ciL ) << 3 );
+
+    return( 0 );
+}
+
+int mbedtls_mpi_write_binary_le( const mbedtls_mpi *X,
+                                 unsigned char *buf, size_t buflen )
+{
+    size_t stored_bytes = X->n * ciL;
+    size_t bytes_to_copy;
+    size_t i;
+
+    if( stored_bytes < buflen )
+    {
+        bytes_to_copy = stored_bytes;
+    }
+    else
+    {
+        bytes_to_copy = buflen;
+
+        /* The output buffer is smaller than the allocated size of X.
+         * However X may fit if its leading bytes are zero. */
+        for( i = bytes_to_copy; i < stored_bytes; i++ )
+        {
+            if( GET_BYTE( X, i ) != 0 )
+                return( MBEDTLS_ERR_MPI_BUFFER_TOO_SMALL );
+        }
+    }
+
+    for( i = 0; i < bytes_to_copy; i++ )
+        buf[i] = GET_BYTE( X, i );
+
+    if( stored_bytes < buflen )
+        memset( buf + stored_bytes, 0, buflen - stored_bytes );
+
+    return( 0 );
+}
+
+int mbedtls_mpi_is_prime_ext( const mbedtls_mpi *X, int rounds,
+                              int (*f_rng)(void *, unsigned char *, size_t),
+                              void *p_rng )
+{
+    /* the rounds library/bignum.c picks for the size of X */
+    (void) rounds;
+
+    return( mbedtls_mpi_is_prime( X, f_rng, p_rng ) );
+}
@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# Builds lib/mbedtls/mbedtls for the host, with the software bignum
+# (library/bignum.c) and the default include/mbedtls/config.h, into a copy
+# of the tree: the programs (programs/test/benchmark, programs/ssl/ssl_server2,
+# ...) and the test suites, for the benchmarks of lib/mbedtls/tools.
+#
+#   ./build.sh [build dir]          default: /tmp/nrc-mbedtls-host
+#   /tmp/nrc-mbedtls-host/programs/test/benchmark p256
+#   make -C /tmp/nrc-mbedtls-host check
+#
+# The mbedTLS makefiles do not track headers: the copy is made again on
+# each run.
+
+set -e
+
+HOST=$(cd "$(dirname "$0")" && pwd)
+SRC=$HOST/../../mbedtls
+OUT=${1:-/tmp/nrc-mbedtls-host}
+PYTHON=${PYTHON:-python3}
+
+CFLAGS="-O2 -I$HOST/include"
+
+rm -rf "$OUT"
+cp -a "$SRC" "$OUT"
+
+# the self tests of the SDK are shell commands of the device
+sed -i 's|^#define MBEDTLS_SELF_TEST|//#define MBEDTLS_SELF_TEST|' "$OUT/include/mbedtls/config.h"
+# I/O buffers resized after the handshake, as in config-nrc-basic.h
+sed -i 's|^//#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH|#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH|' "$OUT/include/mbedtls/config.h"
+
+make -C "$OUT" CFLAGS="$CFLAGS" lib
+cc $CFLAGS -I"$OUT/include" -c -o "$OUT/library/bignum_host.o" "$HOST/bignum_host.c"
+ar rs "$OUT/library/libmbedcrypto.a" "$OUT/library/bignum_host.o"
+
+make -C "$OUT" CFLAGS="$CFLAGS" PYTHON="$PYTHON" programs tests
@@ -0,0 +1,11 @@
+/*
+ * Host build of lib/mbedtls/mbedtls (tools/host/build.sh): library/bignum.c
+ * runs single threaded on the host.
+ */
+#ifndef __COMMON_H__
+#define __COMMON_H__
+
+#define portENTER_CRITICAL()
+#define portEXIT_CRITICAL()
+
+#endif /* __COMMON_H__ */
@@ -0,0 +1,10 @@
+/*
+ * Host build of lib/mbedtls/mbedtls (tools/host/build.sh): the types of the
+ * SDK the mbedTLS headers refer to.
+ */
+#ifndef __SYSTEM_COMMON_H__
+#define __SYSTEM_COMMON_H__
+
+typedef struct cmd_tbl_s cmd_tbl_t;
+
+#endif /* __SYSTEM_COMMON_H__ */
@@ -0,0 +1 @@
+/* Host build of lib/mbedtls/mbedtls (tools/host/build.sh): not used */
@@ -0,0 +1,232 @@
+/*
+ * Host benchmark for the record size of the TLS clients (port/tls_max_frag.c)
+ * and the I/O buffers resized after the handshake
+ * (MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH).
+ *
+ * Downloads a file over HTTPS, the way the FOTA of atcmd_fota.c does
+ * through nrc_httpc_get(), with no max_fragment_length and with 512, 1024,
+ * 2048 and 4096 byte records. For each, reports the peak heap of a
+ * connection, the heap it holds once the handshake is over, the bytes on
+ * the wire per KB of file and the throughput.
+ *
+ * The server is OpenSSL: unlike ssl_server2, it splits its handshake
+ * messages into records of the size negotiated, as brokers and web servers
+ * built on it do. Build lib/mbedtls/mbedtls for the host with
+ * host/build.sh first:
+ *
+ *   M=/tmp/nrc-mbedtls-host
+ *   gcc -O2 -Ihost/include -I$M/include -I../port/include \
+ *       -Wl,--wrap=calloc,--wrap=free -o mfl_bench \
+ *       mfl_bench.c ../port/tls_max_frag.c \
+ *       -L$M/library -lmbedtls -lmbedx509 -lmbedcrypto
+ *   mkdir -p /tmp/mfl && head -c 1048576 /dev/urandom > /tmp/mfl/fw.bin
+ *   (cd /tmp/mfl && openssl s_server -quiet -WWW -accept 14443 \
+ *       -cert $M/tests/data_files/server2-sha256.crt \
+ *       -key $M/tests/data_files/server2.key) &
+ *   ./mfl_bench [port] [file] [runs]
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/certs.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "tls_max_frag.h"
+
+/* Heap accounting of the mbedTLS calls through --wrap */
+static size_t cur_bytes, peak_bytes;
+
+void *__real_calloc(size_t n, size_t size);
+void __real_free(void *p);
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+	void *p = __real_calloc(n, size);
+
+	if (p != NULL) {
+		cur_bytes += malloc_usable_size(p);
+		if (cur_bytes > peak_bytes)
+			peak_bytes = cur_bytes;
+	}
+	return p;
+}
+
+void __wrap_free(void *p)
+{
+	if (p != NULL)
+		cur_bytes -= malloc_usable_size(p);
+	__real_free(p);
+}
+
+/* Bytes on the wire, through the BIO of the connection */
+static size_t wire_bytes;
+
+static int bench_recv(void *ctx, unsigned char *buf, size_t len)
+{
+	int ret = mbedtls_net_recv(ctx, buf, len);
+
+	if (ret > 0)
+		wire_bytes += ret;
+	return ret;
+}
+
+static int bench_send(void *ctx, const unsigned char *buf, size_t len)
+{
+	int ret = mbedtls_net_send(ctx, buf, len);
+
+	if (ret > 0)
+		wire_bytes += ret;
+	return ret;
+}
+
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctr_drbg;
+static mbedtls_x509_crt cacert;
+static const char *port = "14443";
+static const char *file = "fw.bin";
+
+struct result {
+	size_t peak;		/* heap of the connection, at most */
+	size_t held;		/* heap of the connection after the handshake */
+	size_t payload;		/* bytes of the response */
+	size_t wire;		/* bytes received and sent */
+	double ms;			/* request to the last byte */
+};
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int download(struct result *r)
+{
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_config conf;
+	mbedtls_net_context net;
+	unsigned char buf[1024];	/* the read buffer of the FOTA download */
+	size_t base;
+	double t0;
+	int len, ret;
+
+	mbedtls_net_init(&net);
+	mbedtls_ssl_init(&ssl);
+	mbedtls_ssl_config_init(&conf);
+	base = cur_bytes;
+	peak_bytes = cur_bytes;
+
+	if ((ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+										   MBEDTLS_SSL_TRANSPORT_STREAM,
+										   MBEDTLS_SSL_PRESET_DEFAULT)) != 0)
+		goto exit;
+	mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+	mbedtls_ssl_conf_ca_chain(&conf, &cacert, NULL);
+	mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+	tls_max_frag_conf(&conf);
+	if ((ret = mbedtls_ssl_setup(&ssl, &conf)) != 0 ||
+		(ret = mbedtls_ssl_set_hostname(&ssl, "localhost")) != 0 ||
+		(ret = mbedtls_net_connect(&net, "localhost", port, MBEDTLS_NET_PROTO_TCP)) != 0)
+		goto exit;
+	mbedtls_ssl_set_bio(&ssl, &net, bench_send, bench_recv, NULL);
+
+	wire_bytes = 0;
+	while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+		if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+			goto exit;
+	}
+	if (mbedtls_ssl_get_verify_result(&ssl) != 0) {
+		ret = -1;
+		goto exit;
+	}
+	r->held = cur_bytes - base;
+
+	wire_bytes = 0;
+	r->payload = 0;
+	t0 = now_ms();
+	len = snprintf((char *)buf, sizeof(buf), "GET /%s HTTP/1.0\r\n\r\n", file);
+	while ((ret = mbedtls_ssl_write(&ssl, buf, len)) <= 0) {
+		if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+			goto exit;
+	}
+	while ((ret = mbedtls_ssl_read(&ssl, buf, sizeof(buf))) > 0)
+		r->payload += ret;
+	if (ret != 0 && ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
+		goto exit;
+	r->ms = now_ms() - t0;
+	r->wire = wire_bytes;
+	r->peak = peak_bytes - base;
+	ret = 0;
+
+exit:
+	mbedtls_net_free(&net);
+	mbedtls_ssl_free(&ssl);
+	mbedtls_ssl_config_free(&conf);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t mfl[] = { 0, 4096, 2048, 1024, 512 };
+	int runs = 5;
+	int i, j, ret;
+
+	if (argc > 1)
+		port = argv[1];
+	if (argc > 2)
+		file = argv[2];
+	if (argc > 3)
+		runs = atoi(argv[3]);
+
+	mbedtls_entropy_init(&entropy);
+	mbedtls_ctr_drbg_init(&ctr_drbg);
+	mbedtls_x509_crt_init(&cacert);
+	if (mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, NULL, 0) != 0 ||
+		mbedtls_x509_crt_parse(&cacert, (const unsigned char *)mbedtls_test_cas_pem,
+							   mbedtls_test_cas_pem_len) != 0)
+		return 1;
+
+	printf("GET /%s from localhost:%s, %d runs, best throughput\n", file, port, runs);
+	printf("%-8s %10s %10s %14s %12s\n", "mfl", "peak heap", "held heap",
+		   "wire B/KB", "KB/s");
+	for (i = 0; i < (int)(sizeof(mfl) / sizeof(mfl[0])); i++) {
+		struct result best = { 0 }, r;
+
+		if (tls_max_frag_set(mfl[i]) != 0)
+			return 1;
+		for (j = 0; j < runs; j++) {
+			memset(&r, 0, sizeof(r));
+			if ((ret = download(&r)) != 0) {
+				printf("mfl %zu: connection failed -0x%04x\n", mfl[i], -ret);
+				return 1;
+			}
+			if (r.peak > best.peak)
+				best.peak = r.peak;
+			if (r.held > best.held)
+				best.held = r.held;
+			if (best.ms == 0 || r.ms < best.ms) {
+				best.ms = r.ms;
+				best.wire = r.wire;
+				best.payload = r.payload;
+			}
+		}
+		if (mfl[i] == 0)
+			printf("%-8s", "none");
+		else
+			printf("%-8zu", mfl[i]);
+		printf(" %10zu %10zu %14.1f %12.0f\n", best.peak, best.held,
+			   best.wire * 1024.0 / best.payload, best.payload / best.ms * 1000 / 1024);
+	}
+
+	mbedtls_x509_crt_free(&cacert);
+	mbedtls_ctr_drbg_free(&ctr_drbg);
+	mbedtls_entropy_free(&entropy);
+	return 0;
+}
@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+Handshake cost of a full TLS handshake against a resumed one, on the host.
+
+mbedTLS ssl_client2 connects to ssl_server2 through a relay that counts the
+bytes and the time until the client sends its first application data
+record, the end of the handshake. With reconnect=1 the client connects a
+second time with the session of the first, so each run gives a full and a
+resumed handshake. Resumption by session ID (tickets=0) and by session
+ticket (tickets=1, RFC 5077) are both measured.
+
+The relay can add a one-way delay and a rate limit, for the time a
+handshake takes over a slow link: a round trip less, and no certificate
+chain to send and verify, is what resumption saves.
+
+Build the programs of lib/mbedtls/mbedtls for the host with host/build.sh
+first, then:
+
+    ./tls_resume_bench.py --programs /tmp/nrc-mbedtls-host/programs/ssl
+    ./tls_resume_bench.py --programs /tmp/nrc-mbedtls-host/programs/ssl --delay 60 --rate 40000
+"""
+
+import argparse
+import os
+import queue
+import socket
+import subprocess
+import sys
+import threading
+import time
+
+RECORD_CCS = 20
+RECORD_APPLICATION_DATA = 23
+
+
+class Records:
+    """Splits one direction of a TLS stream into record types"""
+
+    def __init__(self):
+        self.buf = b""
+
+    def feed(self, data):
+        self.buf += data
+        types = []
+        while len(self.buf) >= 5:
+            length = (self.buf[3] << 8) | self.buf[4]
+            if len(self.buf) < 5 + length:
+                break
+            types.append(self.buf[0])
+            self.buf = self.buf[5 + length:]
+        return types
+
+
+class Handshake:
+    """What the relay saw of one connection"""
+
+    def __init__(self):
+        self.start = time.monotonic()
+        self.bytes = 0
+        self.time = None
+        self.server_ccs_first = None
+        self.lock = threading.Lock()
+
+    def done(self):
+        return self.time is not None
+
+    def resumed(self):
+        # in an abbreviated handshake the server changes cipher spec first
+        return bool(self.server_ccs_first)
+
+
+class Relay:
+    def __init__(self, port, server_port, delay_ms, rate):
+        self.server_port = server_port
+        self.delay = delay_ms / 1000.0
+        self.rate = rate
+        self.handshakes = []
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(("127.0.0.1", port))
+        self.sock.listen(4)
+        threading.Thread(target=self.accept, daemon=True).start()
+
+    def accept(self):
+        while True:
+            try:
+                client, _ = self.sock.accept()
+            except OSError:
+                return
+            server = socket.create_connection(("127.0.0.1", self.server_port))
+            for s in (client, server):
+                s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            hs = Handshake()
+            self.handshakes.append(hs)
+            self.pipe(client, server, hs, True)
+            self.pipe(server, client, hs, False)
+
+    def pipe(self, src, dst, hs, from_client):
+        """Forward src to dst after the delay, at the rate, counting the handshake"""
+        pending = queue.Queue()
+        records = Records()
+
+        def reader():
+            free = 0.0
+            while True:
+                try:
+                    data = src.recv(4096)
+                except OSError:
+                    data = b""
+                now = time.monotonic()
+                if data and self.rate:
+                    free = max(free, now) + len(data) / float(self.rate)
+                    now = free
+                pending.put((now + self.delay, data))
+                if not data:
+                    return
+                with hs.lock:
+                    if hs.done():
+                        continue
+                    for t in records.feed(data):
+                        if t == RECORD_CCS and hs.server_ccs_first is None:
+                            hs.server_ccs_first = not from_client
+                        if from_client and t == RECORD_APPLICATION_DATA:
+                            hs.time = time.monotonic() - hs.start
+                            break
+                    if not hs.done():
+                        hs.bytes += len(data)
+                    else:
+                        # the bytes of the records before the application data
+                        hs.bytes += len(data) - len(records.buf)
+
+        def writer():
+            while True:
+                due, data = pending.get()
+                wait = due - time.monotonic()
+                if wait > 0:
+                    time.sleep(wait)
+                try:
+                    if not data:
+                        dst.shutdown(socket.SHUT_WR)
+                        return
+                    dst.sendall(data)
+                except OSError:
+                    return
+
+        threading.Thread(target=reader, daemon=True).start()
+        threading.Thread(target=writer, daemon=True).start()
+
+    def close(self):
+        # wakes accept()
+        try:
+            self.sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        self.sock.close()
+
+
+def wait_port(port, timeout=10.0):
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        try:
+            socket.create_connection(("127.0.0.1", port), 0.2).close()
+            return True
+        except OSError:
+            time.sleep(0.1)
+    return False
+
+
+def run(args, tickets):
+    server = subprocess.Popen(
+        [os.path.join(args.programs, "ssl_server2"),
+         "server_port=%d" % args.server_port, "tickets=%d" % tickets,
+         "force_version=%s" % args.version] +
+        (["force_ciphersuite=%s" % args.ciphersuite] if args.ciphersuite else []),
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    relay = None
+    try:
+        if not wait_port(args.server_port):
+            sys.exit("ssl_server2 did not start")
+        # the probe of wait_port() was a connection too
+        time.sleep(0.2)
+        relay = Relay(args.port, args.server_port, args.delay, args.rate)
+        for _ in range(args.count):
+            client = subprocess.run(
+                [os.path.join(args.programs, "ssl_client2"),
+                 "server_port=%d" % args.port, "reconnect=1",
+                 "tickets=%d" % tickets, "auth_mode=%s" % args.auth_mode],
+                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=120)
+            if client.returncode != 0:
+                sys.stderr.write(client.stdout.decode(errors="replace"))
+                sys.exit("ssl_client2 failed")
+        return [hs for hs in relay.handshakes if hs.done()]
+    finally:
+        if relay:
+            relay.close()
+        server.terminate()
+        server.wait()
+
+
+def mean(values):
+    return sum(values) / len(values) if values else 0
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.split("\n")[1],
+                                formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("--programs", required=True,
+                   help="the directory of the ssl_server2 and ssl_client2 host builds")
+    p.add_argument("--port", type=int, default=14433, help="relay port")
+    p.add_argument("--server-port", type=int, default=14434, help="ssl_server2 port")
+    p.add_argument("--count", type=int, default=10, help="runs per mode")
+    p.add_argument("--delay", type=float, default=0, help="one-way delay, ms")
+    p.add_argument("--rate", type=int, default=0, help="link rate, B/s (0: unlimited)")
+    p.add_argument("--version", default="tls1_2", help="force_version of ssl_server2")
+    p.add_argument("--ciphersuite", help="force_ciphersuite of ssl_server2")
+    p.add_argument("--auth-mode", default="required",
+                   help="auth_mode of ssl_client2, 'required' verifies the test CA chain")
+    args = p.parse_args()
+
+    print("%-10s %-8s %5s %10s %10s" % ("mode", "hs", "n", "bytes", "ms"))
+    for name, tickets in (("session id", 0), ("ticket", 1)):
+        handshakes = run(args, tickets)
+        for kind, resumed in (("full", False), ("resumed", True)):
+            sel = [hs for hs in handshakes if hs.resumed() == resumed]
+            print("%-10s %-8s %5d %10.0f %10.1f" % (
+                name, kind, len(sel), mean([hs.bytes for hs in sel]),
+                mean([hs.time for hs in sel]) * 1000))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,246 @@
+/*
+ * Host benchmark for Mini-XML node pools.
+ *
+ * Loads a ~20 KB ONVIF-style device description into a heap tree and into
+ * a pool, reports load time, heap blocks and peak heap of each, then runs
+ * the same mxmlFindPath/mxmlFindElement queries on both trees, checks that
+ * they find the same nodes and reports lookups per second.
+ *
+ *   gcc -O2 -I. -o mxml_bench bench.c mxml-*.c \
+ *       -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+ *   ./mxml_bench [iterations]
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mxml.h"
+
+/* Heap accounting through the linker's --wrap */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static size_t n_alloc, cur_bytes, peak_bytes;
+
+static void account(void *ptr)
+{
+	if (!ptr)
+		return;
+	n_alloc++;
+	cur_bytes += malloc_usable_size(ptr);
+	if (cur_bytes > peak_bytes)
+		peak_bytes = cur_bytes;
+}
+
+void *__wrap_malloc(size_t size)
+{
+	void *p = __real_malloc(size);
+	account(p);
+	return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+	void *p = __real_calloc(n, size);
+	account(p);
+	return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	void *p;
+
+	if (ptr)
+		cur_bytes -= malloc_usable_size(ptr);
+	p = __real_realloc(ptr, size);
+	if (p)
+		account(p);
+	else if (ptr)
+		cur_bytes += malloc_usable_size(ptr);
+	return p;
+}
+
+void __wrap_free(void *ptr)
+{
+	if (ptr)
+		cur_bytes -= malloc_usable_size(ptr);
+	__real_free(ptr);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define NUM_SERVICES	28
+#define NUM_PROFILES	28
+
+static char *make_document(void)
+{
+	static const char *services[] = { "device", "media", "events", "imaging", "ptz", "analytics" };
+	size_t size = 64 * 1024, len = 0;
+	char *doc = malloc(size);
+	int i;
+
+#define OUT(...) (len += snprintf(doc + len, size - len, __VA_ARGS__))
+
+	OUT("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+	OUT("<Device xmlns:tt=\"http://www.onvif.org/ver10/schema\">\n");
+	OUT(" <DeviceInformation><Manufacturer>Newracom</Manufacturer><Model>NRC7292</Model>"
+		"<FirmwareVersion>1.7.0</FirmwareVersion><SerialNumber>NRC-0011223344</SerialNumber>"
+		"<HardwareId>EVK-7292</HardwareId></DeviceInformation>\n");
+	OUT(" <Network><Interface token=\"wlan0\" enabled=\"true\"><MTU>1500</MTU>"
+		"<IPv4 dhcp=\"true\"><Address>192.168.200.12</Address><PrefixLength>24</PrefixLength></IPv4>"
+		"</Interface></Network>\n");
+	OUT(" <Services>\n");
+	for (i = 0; i < NUM_SERVICES; i++)
+		OUT("  <Service id=\"svc%d\" version=\"2.%d\"><Namespace>http://www.onvif.org/ver10/%s/wsdl</Namespace>"
+			"<XAddr>http://192.168.200.12/onvif/%s_%d</XAddr>"
+			"<Capabilities MaxProfiles=\"%d\" Rotation=\"false\" SnapshotUri=\"true\"/></Service>\n",
+			i, i % 10, services[i % 6], services[i % 6], i, 4 + i % 4);
+	OUT(" </Services>\n <Profiles>\n");
+	for (i = 0; i < NUM_PROFILES; i++)
+		OUT("  <Profile token=\"profile_%d\" fixed=\"%s\"><Name>Stream%d</Name>"
+			"<VideoSourceConfiguration token=\"vsc_%d\"><SourceToken>src_%d</SourceToken>"
+			"<Bounds x=\"0\" y=\"0\" width=\"1920\" height=\"1080\"/></VideoSourceConfiguration>"
+			"<VideoEncoderConfiguration token=\"vec_%d\"><Encoding>H264</Encoding>"
+			"<Resolution><Width>%d</Width><Height>%d</Height></Resolution><Quality>%d</Quality>"
+			"<RateControl><FrameRateLimit>%d</FrameRateLimit><BitrateLimit>%d</BitrateLimit></RateControl>"
+			"</VideoEncoderConfiguration></Profile>\n",
+			i, i < 2 ? "true" : "false", i, i % 4, i % 4, i, 640 << (i % 2), 360 << (i % 2),
+			3 + i % 3, 15 + i % 16, 512 * (1 + i % 8));
+	OUT(" </Profiles>\n</Device>\n");
+
+#undef OUT
+	return doc;
+}
+
+struct query {
+	const char *path;	/* mxmlFindPath path, or NULL */
+	const char *element;	/* mxmlFindElement arguments otherwise */
+	const char *attr;
+	const char *value;
+};
+
+static const struct query queries[] = {
+	{ "Device/DeviceInformation/SerialNumber" },
+	{ "Device/Network/Interface/IPv4/Address" },
+	{ "*/Profile/Name" },
+	{ "*/BitrateLimit" },
+	{ "Device/Profiles/Profile/VideoEncoderConfiguration/Resolution/Width" },
+	{ NULL, "Service", "id", "svc23" },
+	{ NULL, "Profile", "token", "profile_20" },
+	{ NULL, "VideoEncoderConfiguration", "token", "vec_17" },
+	{ NULL, "Interface", "enabled", NULL },
+	{ NULL, "Capabilities", NULL, NULL },
+	{ NULL, "Missing", NULL, NULL },
+	{ NULL, "Service", "id", "svc99" },
+};
+
+#define NUM_QUERIES (int)(sizeof(queries) / sizeof(queries[0]))
+
+static mxml_node_t *run_query(mxml_node_t *tree, const struct query *q)
+{
+	if (q->path)
+		return mxmlFindPath(tree, q->path);
+	return mxmlFindElement(tree, tree, q->element, q->attr, q->value, MXML_DESCEND);
+}
+
+/* Position of node in document order, to compare results across trees */
+static int position(mxml_node_t *tree, mxml_node_t *node)
+{
+	mxml_node_t *n;
+	int i = 0;
+
+	if (!node)
+		return -1;
+	for (n = tree; n; n = mxmlWalkNext(n, tree, MXML_DESCEND), i++)
+		if (n == node)
+			return i;
+	return -2;
+}
+
+static double lookups(mxml_node_t *tree, int iters)
+{
+	double t = now();
+	int i, q;
+
+	for (i = 0; i < iters; i++)
+		for (q = 0; q < NUM_QUERIES; q++)
+			run_query(tree, &queries[q]);
+	return (double)iters * NUM_QUERIES / (now() - t);
+}
+
+int main(int argc, char **argv)
+{
+	int iters = argc > 1 ? atoi(argv[1]) : 2000;
+	int loads = 200, i, q, fails = 0;
+	size_t base, len;
+	char *doc = make_document();
+	mxml_node_t *heap_tree, *pool_tree;
+	mxml_pool_t *pool;
+	double t, heap_load, pool_load;
+	size_t heap_allocs, heap_peak, pool_allocs, pool_peak, pool_size;
+
+	len = strlen(doc);
+
+	/* load */
+	t = now();
+	for (i = 0; i < loads; i++)
+		mxmlDelete(mxmlLoadString(NULL, doc, MXML_OPAQUE_CALLBACK));
+	heap_load = (now() - t) / loads;
+
+	t = now();
+	for (i = 0; i < loads; i++) {
+		pool = mxmlPoolNew(0);
+		mxmlPoolLoadString(pool, doc, MXML_OPAQUE_CALLBACK);
+		mxmlPoolDelete(pool);
+	}
+	pool_load = (now() - t) / loads;
+
+	base = peak_bytes = cur_bytes;
+	n_alloc = 0;
+	heap_tree = mxmlLoadString(NULL, doc, MXML_OPAQUE_CALLBACK);
+	heap_allocs = n_alloc;
+	heap_peak = peak_bytes - base;
+
+	base = peak_bytes = cur_bytes;
+	n_alloc = 0;
+	pool = mxmlPoolNew(0);
+	pool_tree = mxmlPoolLoadString(pool, doc, MXML_OPAQUE_CALLBACK);
+	pool_allocs = n_alloc;
+	pool_peak = peak_bytes - base;
+	pool_size = mxmlPoolGetSize(pool);
+
+	printf("document %zu bytes\n\n", len);
+	printf("%-6s %10s %10s %10s %10s\n", "tree", "load(us)", "MB/s", "allocs", "peak heap");
+	printf("%-6s %10.1f %10.2f %10zu %10zu\n", "heap", heap_load * 1e6, len / heap_load / 1e6, heap_allocs, heap_peak);
+	printf("%-6s %10.1f %10.2f %10zu %10zu  (pool %zu)\n", "pool", pool_load * 1e6, len / pool_load / 1e6,
+		   pool_allocs, pool_peak, pool_size);
+
+	/* lookups must find the same nodes */
+	for (q = 0; q < NUM_QUERIES; q++) {
+		int a = position(heap_tree, run_query(heap_tree, &queries[q]));
+		int b = position(pool_tree, run_query(pool_tree, &queries[q]));
+		if (a != b) {
+			printf("MISMATCH query %d (%s): heap %d, pool %d\n", q,
+				   queries[q].path ? queries[q].path : queries[q].element, a, b);
+			fails++;
+		}
+	}
+
+	printf("\n%-6s %14s\n", "tree", "lookups/s");
+	printf("%-6s %14.0f\n", "heap", lookups(heap_tree, iters));
+	printf("%-6s %14.0f\n", "pool", lookups(pool_tree, iters));
+
+	mxmlDelete(heap_tree);
+	mxmlPoolDelete(pool);
+	free(doc);
+	return fails ? 1 : 0;
+}
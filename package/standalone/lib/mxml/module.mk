@@ -8,6 +8,7 @@ CSRCS		+= \
 	mxml-get.c \
 	mxml-index.c \
 	mxml-node.c \
+	mxml-pool.c \
 	mxml-private.c \
 	mxml-search.c \
 	mxml-set.c \
@@ -68,8 +68,8 @@ mxmlElementDeleteAttr(mxml_node_t *node,/* I - Element */
       * Delete this attribute...
       */
 
-      free(attr->name);
-      free(attr->value);
+      _mxml_node_free(node, attr->name);
+      _mxml_node_free(node, attr->value);
 
       i --;
       if (i > 0)
@@ -78,7 +78,7 @@ mxmlElementDeleteAttr(mxml_node_t *node,/* I - Element */
       node->value.element.num_attrs --;
 
       if (node->value.element.num_attrs == 0)
-        free(node->value.element.attrs);
+        _mxml_node_free(node, node->value.element.attrs);
       return;
     }
   }
@@ -112,6 +112,23 @@ mxmlElementGetAttr(mxml_node_t *node,	/* I - Element node */
   if (!node || node->type != MXML_ELEMENT || !name)
     return (NULL);
 
+ /*
+  * Attribute names of pooled nodes are interned, so a name the pool has
+  * never seen can't be there and the others compare by pointer...
+  */
+
+  if (node->pool)
+  {
+    if ((name = _mxml_pool_lookup(node->pool, name)) == NULL)
+      return (NULL);
+
+    for (i = node->value.element.num_attrs, attr = node->value.element.attrs;
+         i > 0;
+         i --, attr ++)
+      if (attr->name == name)
+        return (attr->value);
+  }
+
  /*
   * Look for the attribute...
   */
@@ -217,12 +234,12 @@ mxmlElementSetAttr(mxml_node_t *node,	/* I - Element node */
     return;
 
   if (value)
-    valuec = strdup(value);
+    valuec = _mxml_node_strdup(node, value);
   else
     valuec = NULL;
 
   if (mxml_set_attr(node, name, valuec))
-    free(valuec);
+    _mxml_node_free(node, valuec);
 }
 
 
@@ -265,14 +282,14 @@ mxmlElementSetAttrf(mxml_node_t *node,	/* I - Element node */
   */
 
   va_start(ap, format);
-  value = _mxml_vstrdupf(format, ap);
+  value = _mxml_node_adopt(node, _mxml_vstrdupf(format, ap));
   va_end(ap);
 
   if (!value)
     mxml_error("Unable to allocate memory for attribute '%s' in element %s!",
                name, node->value.element.name);
   else if (mxml_set_attr(node, name, value))
-    free(value);
+    _mxml_node_free(node, value);
 }
 
 
@@ -303,7 +320,7 @@ mxml_set_attr(mxml_node_t *node,	/* I - Element node */
       */
 
       if (attr->value)
-        free(attr->value);
+        _mxml_node_free(node, attr->value);
 
       attr->value = value;
 
@@ -311,10 +328,23 @@ mxml_set_attr(mxml_node_t *node,	/* I - Element node */
     }
 
  /*
-  * Add a new attribute...
+  * Add a new attribute, pooled arrays can't be reallocated so they double
+  * whenever a power of two is full...
   */
 
-  if (node->value.element.num_attrs == 0)
+  if (node->pool)
+  {
+    i = node->value.element.num_attrs;
+
+    if (i == 0 || (i & (i - 1)) == 0)
+    {
+      if ((attr = _mxml_pool_alloc(node->pool, (i ? 2 * i : 1) * sizeof(_mxml_attr_t))) != NULL && i)
+        memcpy(attr, node->value.element.attrs, i * sizeof(_mxml_attr_t));
+    }
+    else
+      attr = node->value.element.attrs;
+  }
+  else if (node->value.element.num_attrs == 0)
     attr = malloc(sizeof(_mxml_attr_t));
   else
     attr = realloc(node->value.element.attrs,
@@ -330,7 +360,7 @@ mxml_set_attr(mxml_node_t *node,	/* I - Element node */
   node->value.element.attrs = attr;
   attr += node->value.element.num_attrs;
 
-  if ((attr->name = strdup(name)) == NULL)
+  if ((attr->name = _mxml_node_name(node, name)) == NULL)
   {
     mxml_error("Unable to allocate memory for attribute '%s' in element %s!",
                name, node->value.element.name);
@@ -72,6 +72,8 @@ mxmlAdd(mxml_node_t *parent,		/* I - Parent node */
   if (node->parent)
     mxmlRemove(node);
 
+  _mxml_pool_changed(parent);
+
  /*
   * Reset pointers...
   */
@@ -303,7 +305,7 @@ mxmlNewCDATA(mxml_node_t *parent,	/* I - Parent node or @code MXML_NO_PARENT@ */
   */
 
   if ((node = mxml_new(parent, MXML_ELEMENT)) != NULL)
-    node->value.element.name = _mxml_strdupf("![CDATA[%s", data);
+    node->value.element.name = _mxml_node_adopt(node, _mxml_strdupf("![CDATA[%s", data));
 
   return (node);
 }
@@ -380,7 +382,7 @@ mxmlNewElement(mxml_node_t *parent,	/* I - Parent node or @code MXML_NO_PARENT@
   */
 
   if ((node = mxml_new(parent, MXML_ELEMENT)) != NULL)
-    node->value.element.name = strdup(name);
+    node->value.element.name = _mxml_node_name(node, name);
 
   return (node);
 }
@@ -449,7 +451,7 @@ mxmlNewOpaque(mxml_node_t *parent,	/* I - Parent node or @code MXML_NO_PARENT@ *
   */
 
   if ((node = mxml_new(parent, MXML_OPAQUE)) != NULL)
-    node->value.opaque = strdup(opaque);
+    node->value.opaque = _mxml_node_strdup(node, opaque);
 
   return (node);
 }
@@ -492,7 +494,7 @@ mxmlNewOpaquef(mxml_node_t *parent,	/* I - Parent node or @code MXML_NO_PARENT@
   {
     va_start(ap, format);
 
-    node->value.opaque = _mxml_vstrdupf(format, ap);
+    node->value.opaque = _mxml_node_adopt(node, _mxml_vstrdupf(format, ap));
 
     va_end(ap);
   }
@@ -568,7 +570,7 @@ mxmlNewText(mxml_node_t *parent,	/* I - Parent node or @code MXML_NO_PARENT@ */
   if ((node = mxml_new(parent, MXML_TEXT)) != NULL)
   {
     node->value.text.whitespace = whitespace;
-    node->value.text.string     = strdup(string);
+    node->value.text.string     = _mxml_node_strdup(node, string);
   }
 
   return (node);
@@ -616,7 +618,7 @@ mxmlNewTextf(mxml_node_t *parent,	/* I - Parent node or @code MXML_NO_PARENT@ */
     va_start(ap, format);
 
     node->value.text.whitespace = whitespace;
-    node->value.text.string     = _mxml_vstrdupf(format, ap);
+    node->value.text.string     = _mxml_node_adopt(node, _mxml_vstrdupf(format, ap));
 
     va_end(ap);
   }
@@ -663,6 +665,8 @@ mxmlRemove(mxml_node_t *node)		/* I - Node to remove */
   fprintf(stderr, "    BEFORE: node->next=%p\n", node->next);
 #endif /* DEBUG > 1 */
 
+  _mxml_pool_changed(node->parent);
+
   if (node->prev)
     node->prev->next = node->next;
   else
@@ -769,6 +773,19 @@ mxml_free(mxml_node_t *node)		/* I - Node */
   int	i;				/* Looping var */
 
 
+ /*
+  * Pooled nodes and their strings go away with the pool...
+  */
+
+  if (node->pool)
+  {
+    if (node->type == MXML_CUSTOM && node->value.custom.data &&
+        node->value.custom.destroy)
+      (*(node->value.custom.destroy))(node->value.custom.data);
+
+    return;
+  }
+
   switch (node->type)
   {
     case MXML_ELEMENT :
@@ -828,6 +845,7 @@ mxml_new(mxml_node_t *parent,		/* I - Parent node */
          mxml_type_t type)		/* I - Node type */
 {
   mxml_node_t	*node;			/* New node */
+  mxml_pool_t	*pool;			/* Pool to allocate from */
 
 
 #if DEBUG > 1
@@ -835,10 +853,18 @@ mxml_new(mxml_node_t *parent,		/* I - Parent node */
 #endif /* DEBUG > 1 */
 
  /*
-  * Allocate memory for the node...
+  * Allocate memory for the node, children of pooled nodes come from the
+  * same pool...
   */
 
-  if ((node = calloc(1, sizeof(mxml_node_t))) == NULL)
+  pool = parent ? parent->pool : _mxml_global()->pool;
+
+  if (pool)
+    node = _mxml_pool_new_node(pool);
+  else
+    node = calloc(1, sizeof(mxml_node_t));
+
+  if (node == NULL)
   {
 #if DEBUG > 1
     fputs("    returning NULL\n", stderr);
@@ -0,0 +1,626 @@
+/*
+ * Node pool and name index for Mini-XML, a small XML file parsing library.
+ *
+ * https://www.msweet.org/mxml
+ *
+ * Copyright © 2003-2019 by Michael R Sweet.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "mxml_config.h"
+#include "mxml-private.h"
+
+
+/*
+ * Local macros...
+ */
+
+#define MXML_POOL_ALIGN(x)	(((x) + sizeof(double) - 1) & ~(sizeof(double) - 1))
+#define MXML_POOL_ORDER(n)	(((_mxml_pool_node_t *)(n))->order)
+
+
+/*
+ * Local functions...
+ */
+
+static unsigned		mxml_pool_hash(const char *s);
+static int		mxml_pool_index(mxml_pool_t *pool, mxml_node_t *root);
+static _mxml_pool_name_t *mxml_pool_name(mxml_pool_t *pool, const char *s, int add);
+
+
+/*
+ * 'mxmlPoolDelete()' - Delete a pool and every node allocated from it.
+ *
+ * Trees loaded or built in the pool must not be used afterwards.  Custom
+ * data destructors are not called for pooled nodes unless the nodes are
+ * deleted with @link mxmlDelete@ first.
+ *
+ * @since Mini-XML 3.0@
+ */
+
+void
+mxmlPoolDelete(mxml_pool_t *pool)	/* I - Pool to delete */
+{
+  _mxml_pool_block_t	*block,		/* Current block */
+			*next;		/* Next block */
+
+
+  if (!pool)
+    return;
+
+  for (block = pool->blocks; block; block = next)
+  {
+    next = block->next;
+    free(block);
+  }
+
+  free(pool->names);
+  free(pool->index_nodes);
+  free(pool);
+}
+
+
+/*
+ * 'mxmlPoolGetSize()' - Get the number of bytes a pool took from the heap.
+ *
+ * @since Mini-XML 3.0@
+ */
+
+size_t					/* O - Bytes allocated */
+mxmlPoolGetSize(mxml_pool_t *pool)	/* I - Pool */
+{
+  if (!pool)
+    return (0);
+
+  return (pool->size + pool->num_buckets * sizeof(_mxml_pool_name_t *) +
+          pool->num_indexed * sizeof(mxml_node_t *));
+}
+
+
+/*
+ * 'mxmlPoolLoadString()' - Load a string into a new tree allocated from a pool.
+ *
+ * Nodes, strings and attributes of the tree come from the pool, element and
+ * attribute names are stored once per pool, and @link mxmlFindElement@ and
+ * @link mxmlFindPath@ look names up through an index of the tree that is
+ * built on first use.  The tree is freed with @link mxmlPoolDelete@.
+ *
+ * @since Mini-XML 3.0@
+ */
+
+mxml_node_t *				/* O - First node or @code NULL@ if the string has errors. */
+mxmlPoolLoadString(mxml_pool_t *pool,	/* I - Pool */
+                   const char  *s,	/* I - String to load */
+                   mxml_load_cb_t cb)	/* I - Callback function or constant */
+{
+  _mxml_global_t	*global = _mxml_global();
+					/* Global data */
+  mxml_node_t		*node;		/* Loaded tree */
+
+
+  if (!pool)
+    return (NULL);
+
+  global->pool = pool;
+  node         = mxmlLoadString(NULL, s, cb);
+  global->pool = NULL;
+
+  return (node);
+}
+
+
+/*
+ * 'mxmlPoolNew()' - Create a node pool.
+ *
+ * The pool hands out memory in blocks of "block_size" bytes, 0 selects a
+ * default size.  Nodes added to a parent from a pool are allocated from the
+ * same pool.
+ *
+ * @since Mini-XML 3.0@
+ */
+
+mxml_pool_t *				/* O - New pool or @code NULL@ */
+mxmlPoolNew(size_t block_size)		/* I - Block size in bytes or 0 */
+{
+  mxml_pool_t	*pool;			/* New pool */
+
+
+  if ((pool = calloc(1, sizeof(mxml_pool_t))) == NULL)
+    return (NULL);
+
+  pool->block_size = block_size ? block_size : MXML_POOL_BLOCK_SIZE;
+
+  return (pool);
+}
+
+
+/*
+ * 'mxmlPoolNewXML()' - Create a new XML document tree in a pool.
+ *
+ * @since Mini-XML 3.0@
+ */
+
+mxml_node_t *				/* O - New ?xml node */
+mxmlPoolNewXML(mxml_pool_t *pool,	/* I - Pool */
+               const char  *version)	/* I - Version number to use */
+{
+  _mxml_global_t	*global = _mxml_global();
+					/* Global data */
+  mxml_node_t		*node;		/* New node */
+
+
+  if (!pool)
+    return (NULL);
+
+  global->pool = pool;
+  node         = mxmlNewXML(version);
+  global->pool = NULL;
+
+  return (node);
+}
+
+
+/*
+ * '_mxml_node_adopt()' - Move a malloc'd string into the node's pool.
+ */
+
+char *					/* O - String owned by node */
+_mxml_node_adopt(mxml_node_t *node,	/* I - Node */
+                 char        *s)	/* I - String from malloc() */
+{
+  char	*t;				/* Pooled copy */
+
+
+  if (!node->pool || !s)
+    return (s);
+
+  t = _mxml_pool_strdup(node->pool, s);
+  free(s);
+
+  return (t);
+}
+
+
+/*
+ * '_mxml_node_free()' - Free a string or array owned by a node.
+ */
+
+void
+_mxml_node_free(mxml_node_t *node,	/* I - Node */
+                void        *p)		/* I - Memory to free */
+{
+  if (!node->pool)
+    free(p);
+}
+
+
+/*
+ * '_mxml_node_name()' - Copy an element or attribute name for a node.
+ *
+ * Names are interned in pooled trees; comments, CDATA and declarations,
+ * which also are element names, are not.
+ */
+
+char *					/* O - Name owned by node */
+_mxml_node_name(mxml_node_t *node,	/* I - Node */
+                const char  *name)	/* I - Name */
+{
+  _mxml_pool_name_t	*entry;		/* Interned name */
+
+
+  if (!node->pool)
+    return (strdup(name));
+
+  if (name[0] == '!' || (entry = mxml_pool_name(node->pool, name, 1)) == NULL)
+    return (_mxml_pool_strdup(node->pool, name));
+
+  return (entry->name);
+}
+
+
+/*
+ * '_mxml_node_strdup()' - Copy a string for a node.
+ */
+
+char *					/* O - String owned by node */
+_mxml_node_strdup(mxml_node_t *node,	/* I - Node */
+                  const char  *s)	/* I - String */
+{
+  if (!node->pool)
+    return (strdup(s));
+
+  return (_mxml_pool_strdup(node->pool, s));
+}
+
+
+/*
+ * '_mxml_pool_alloc()' - Allocate zeroed memory from a pool.
+ */
+
+void *					/* O - Memory or @code NULL@ */
+_mxml_pool_alloc(mxml_pool_t *pool,	/* I - Pool */
+                 size_t      bytes)	/* I - Number of bytes */
+{
+  _mxml_pool_block_t	*block;		/* Block to allocate from */
+  size_t		header = MXML_POOL_ALIGN(sizeof(_mxml_pool_block_t));
+					/* Space used by the block header */
+  size_t		size;		/* Size of a new block */
+  void			*p;		/* Allocated memory */
+
+
+  bytes = MXML_POOL_ALIGN(bytes);
+  block = pool->blocks;
+
+  if (!block || block->size - block->used < bytes)
+  {
+   /*
+    * Large requests get a block of their own behind the current one so
+    * the space left in the current block is not lost...
+    */
+
+    size = bytes > pool->block_size / 4 ? bytes : pool->block_size;
+
+    if ((block = malloc(header + size)) == NULL)
+    {
+      mxml_error("Unable to allocate %u bytes from pool.", (unsigned)bytes);
+      return (NULL);
+    }
+
+    block->size = size;
+    block->used = 0;
+    pool->size  += header + size;
+
+    if (size != pool->block_size && pool->blocks)
+    {
+      block->next        = pool->blocks->next;
+      pool->blocks->next = block;
+    }
+    else
+    {
+      block->next  = pool->blocks;
+      pool->blocks = block;
+    }
+  }
+
+  p = (char *)block + header + block->used;
+  block->used += bytes;
+
+  memset(p, 0, bytes);
+
+  return (p);
+}
+
+
+/*
+ * '_mxml_pool_changed()' - Note that the tree of a pooled node has changed.
+ */
+
+void
+_mxml_pool_changed(mxml_node_t *node)	/* I - Changed node */
+{
+  if (node && node->pool)
+  {
+    node->pool->index_top = NULL;
+    node->pool->index_bad = NULL;
+  }
+}
+
+
+/*
+ * '_mxml_pool_find()' - Find an element through the name index of a pool.
+ *
+ * Handles the searches that start at the top node, descending either into
+ * the whole subtree or only into the direct children, which covers the
+ * searches done by mxmlFindPath.  Returns 0 when the search has to be done
+ * by walking the tree.
+ */
+
+int					/* O - 1 if handled, 0 otherwise */
+_mxml_pool_find(mxml_node_t *node,	/* I - Current node */
+                mxml_node_t *top,	/* I - Top node */
+                const char  *element,	/* I - Element name */
+                const char  *attr,	/* I - Attribute name or @code NULL@ */
+                const char  *value,	/* I - Attribute value or @code NULL@ */
+                int         descend,	/* I - Descend into tree */
+                mxml_node_t **found)	/* O - Element node or @code NULL@ */
+{
+  mxml_pool_t		*pool = top->pool;
+					/* Pool of the tree */
+  mxml_node_t		*root,		/* Root of the tree */
+			*last,		/* Last node under top */
+			*current;	/* Current candidate */
+  _mxml_pool_name_t	*entry;		/* Index entry for the name */
+  const char		*temp;		/* Current attribute value */
+  int			lo, hi, mid;	/* Binary search bounds */
+
+
+  if (!pool || node != top || !element || element[0] == '!' ||
+      (descend != MXML_DESCEND && descend != MXML_DESCEND_FIRST))
+    return (0);
+
+  for (root = top; root->parent; root = root->parent);
+
+  if (root == pool->index_bad)
+    return (0);
+
+  if (root != pool->index_top && mxml_pool_index(pool, root))
+  {
+    pool->index_bad = root;
+    return (0);
+  }
+
+  *found = NULL;
+
+  if ((entry = mxml_pool_name(pool, element, 0)) == NULL)
+    return (1);
+
+ /*
+  * Nodes under top are those numbered after top and up to its last
+  * descendant; the index lists every name in document order...
+  */
+
+  for (last = top; last->last_child; last = last->last_child);
+
+  lo = 0;
+  hi = entry->num_nodes;
+
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+
+    if (MXML_POOL_ORDER(entry->nodes[mid]) <= MXML_POOL_ORDER(top))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  for (; lo < entry->num_nodes; lo ++)
+  {
+    current = entry->nodes[lo];
+
+    if (MXML_POOL_ORDER(current) > MXML_POOL_ORDER(last))
+      break;
+
+    if (descend == MXML_DESCEND_FIRST && current->parent != top)
+      continue;
+
+    if (!attr ||
+        ((temp = mxmlElementGetAttr(current, attr)) != NULL &&
+	 (!value || !strcmp(value, temp))))
+    {
+      *found = current;
+      break;
+    }
+  }
+
+  return (1);
+}
+
+
+/*
+ * '_mxml_pool_lookup()' - Get the interned copy of a name.
+ */
+
+const char *				/* O - Interned name or @code NULL@ */
+_mxml_pool_lookup(mxml_pool_t *pool,	/* I - Pool */
+                  const char  *name)	/* I - Name */
+{
+  _mxml_pool_name_t	*entry;		/* Interned name */
+
+
+  if ((entry = mxml_pool_name(pool, name, 0)) == NULL)
+    return (NULL);
+
+  return (entry->name);
+}
+
+
+/*
+ * '_mxml_pool_new_node()' - Allocate a node from a pool.
+ */
+
+mxml_node_t *				/* O - New node or @code NULL@ */
+_mxml_pool_new_node(mxml_pool_t *pool)	/* I - Pool */
+{
+  mxml_node_t	*node;			/* New node */
+
+
+  if ((node = _mxml_pool_alloc(pool, sizeof(_mxml_pool_node_t))) != NULL)
+    node->pool = pool;
+
+  return (node);
+}
+
+
+/*
+ * '_mxml_pool_strdup()' - Copy a string into a pool.
+ */
+
+char *					/* O - Copy or @code NULL@ */
+_mxml_pool_strdup(mxml_pool_t *pool,	/* I - Pool */
+                  const char  *s)	/* I - String */
+{
+  size_t	len = strlen(s) + 1;	/* Length with nul */
+  char		*t;			/* Copy */
+
+
+  if ((t = _mxml_pool_alloc(pool, len)) != NULL)
+    memcpy(t, s, len);
+
+  return (t);
+}
+
+
+/*
+ * 'mxml_pool_hash()' - Hash a name (FNV-1a).
+ */
+
+static unsigned				/* O - Hash */
+mxml_pool_hash(const char *s)		/* I - Name */
+{
+  unsigned	hash = 2166136261u;	/* Hash */
+
+
+  while (*s)
+  {
+    hash ^= (unsigned char)*s++;
+    hash *= 16777619u;
+  }
+
+  return (hash);
+}
+
+
+/*
+ * 'mxml_pool_index()' - Index the elements of a tree by name.
+ *
+ * Numbers every node of the tree in document order and lists the elements
+ * of each name in that order.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+mxml_pool_index(mxml_pool_t *pool,	/* I - Pool */
+                mxml_node_t *root)	/* I - Root of the tree */
+{
+  mxml_node_t		*node;		/* Current node */
+  _mxml_pool_name_t	*entry;		/* Index entry */
+  int			i,		/* Looping var */
+			order,		/* Document order */
+			count;		/* Elements to index */
+  mxml_node_t		**nodes;	/* Node array */
+
+
+  for (i = 0; i < pool->num_buckets; i ++)
+    for (entry = pool->names[i]; entry; entry = entry->next)
+      entry->num_nodes = 0;
+
+ /*
+  * Number the nodes and count the elements of each name...
+  */
+
+  for (node = root, order = 0, count = 0; node; node = mxmlWalkNext(node, root, MXML_DESCEND))
+  {
+    if (node->pool != pool)
+      return (-1);
+
+    MXML_POOL_ORDER(node) = order ++;
+
+    if (node->type == MXML_ELEMENT && node->value.element.name &&
+        (entry = mxml_pool_name(pool, node->value.element.name, 0)) != NULL)
+    {
+      entry->num_nodes ++;
+      count ++;
+    }
+  }
+
+  if (count > pool->num_indexed)
+  {
+    if ((nodes = realloc(pool->index_nodes, count * sizeof(mxml_node_t *))) == NULL)
+      return (-1);
+
+    pool->index_nodes = nodes;
+    pool->num_indexed = count;
+  }
+
+ /*
+  * Give each name its slice of the node array and fill them in...
+  */
+
+  for (i = 0, nodes = pool->index_nodes; i < pool->num_buckets; i ++)
+    for (entry = pool->names[i]; entry; entry = entry->next)
+    {
+      entry->nodes     = nodes;
+      nodes            += entry->num_nodes;
+      entry->num_nodes = 0;
+    }
+
+  for (node = root; node; node = mxmlWalkNext(node, root, MXML_DESCEND))
+    if (node->type == MXML_ELEMENT && node->value.element.name &&
+        (entry = mxml_pool_name(pool, node->value.element.name, 0)) != NULL)
+      entry->nodes[entry->num_nodes ++] = node;
+
+  pool->index_top = root;
+
+  return (0);
+}
+
+
+/*
+ * 'mxml_pool_name()' - Find or add an interned name.
+ */
+
+static _mxml_pool_name_t *		/* O - Name entry or @code NULL@ */
+mxml_pool_name(mxml_pool_t *pool,	/* I - Pool */
+               const char  *name,	/* I - Name */
+               int         add)		/* I - Add the name if missing? */
+{
+  unsigned		hash = mxml_pool_hash(name);
+					/* Hash of name */
+  _mxml_pool_name_t	*entry,		/* Current entry */
+			*next,		/* Next entry */
+			**buckets;	/* New bucket array */
+  int			i,		/* Looping var */
+			num_buckets;	/* New bucket count */
+  size_t		len;		/* Length of name */
+
+
+  if (pool->num_buckets)
+  {
+    for (entry = pool->names[hash & (pool->num_buckets - 1)]; entry; entry = entry->next)
+      if (entry->hash == hash && !strcmp(entry->name, name))
+        return (entry);
+  }
+
+  if (!add)
+    return (NULL);
+
+ /*
+  * Grow the table to keep chains short...
+  */
+
+  if (pool->num_names >= pool->num_buckets)
+  {
+    num_buckets = pool->num_buckets ? pool->num_buckets * 2 : 32;
+
+    if ((buckets = calloc(num_buckets, sizeof(_mxml_pool_name_t *))) == NULL)
+      return (NULL);
+
+    for (i = 0; i < pool->num_buckets; i ++)
+      for (entry = pool->names[i]; entry; entry = next)
+      {
+        next = entry->next;
+        entry->next = buckets[entry->hash & (num_buckets - 1)];
+        buckets[entry->hash & (num_buckets - 1)] = entry;
+      }
+
+    free(pool->names);
+    pool->names       = buckets;
+    pool->num_buckets = num_buckets;
+  }
+
+  len = strlen(name);
+
+  if ((entry = _mxml_pool_alloc(pool, sizeof(_mxml_pool_name_t) + len)) == NULL)
+    return (NULL);
+
+  entry->hash = hash;
+  memcpy(entry->name, name, len + 1);
+
+  entry->next = pool->names[hash & (pool->num_buckets - 1)];
+  pool->names[hash & (pool->num_buckets - 1)] = entry;
+  pool->num_names ++;
+
+ /*
+  * An index built before does not know the new name...
+  */
+
+  pool->index_top = NULL;
+
+  return (entry);
+}
@@ -67,6 +67,45 @@ struct _mxml_node_s			/**** An XML node. ****/
   _mxml_value_t		value;		/* Node value */
   int			ref_count;	/* Use count */
   void			*user_data;	/* User data */
+  mxml_pool_t		*pool;		/* Pool the node lives in or NULL */
+};
+
+typedef struct _mxml_pool_node_s	/**** A node allocated from a pool. ****/
+{
+  mxml_node_t		node;		/* Node */
+  int			order;		/* Position in document order */
+} _mxml_pool_node_t;
+
+typedef struct _mxml_pool_block_s	/**** A block of pool memory. ****/
+{
+  struct _mxml_pool_block_s *next;	/* Next block */
+  size_t		size;		/* Usable bytes */
+  size_t		used;		/* Bytes handed out */
+} _mxml_pool_block_t;
+
+typedef struct _mxml_pool_name_s	/**** An interned name. ****/
+{
+  struct _mxml_pool_name_s *next;	/* Next name in hash bucket */
+  unsigned		hash;		/* Hash of name */
+  int			num_nodes;	/* Indexed elements with this name */
+  mxml_node_t		**nodes;	/* Elements in document order */
+  char			name[1];	/* Name */
+} _mxml_pool_name_t;
+
+#define MXML_POOL_BLOCK_SIZE	2048	/* Default pool block size */
+
+struct _mxml_pool_s			/**** A node/string pool. ****/
+{
+  size_t		block_size;	/* Size of regular blocks */
+  size_t		size;		/* Bytes taken from the heap */
+  _mxml_pool_block_t	*blocks;	/* Blocks, current one first */
+  int			num_buckets;	/* Size of name hash table */
+  int			num_names;	/* Number of interned names */
+  _mxml_pool_name_t	**names;	/* Name hash table */
+  int			num_indexed;	/* Size of index node array */
+  mxml_node_t		**index_nodes;	/* Index node array */
+  mxml_node_t		*index_top;	/* Root of indexed tree or NULL */
+  mxml_node_t		*index_bad;	/* Root of tree that can't be indexed */
 };
 
 struct _mxml_index_s			 /**** An XML node index. ****/
@@ -87,6 +126,7 @@ typedef struct _mxml_global_s		/**** Global, per-thread data ****/
   int	wrap;
   mxml_custom_load_cb_t	custom_load_cb;
   mxml_custom_save_cb_t	custom_save_cb;
+  mxml_pool_t		*pool;		/* Pool for new root nodes */
 } _mxml_global_t;
 
 
@@ -96,3 +136,16 @@ typedef struct _mxml_global_s		/**** Global, per-thread data ****/
 
 extern _mxml_global_t	*_mxml_global(void);
 extern int		_mxml_entity_cb(const char *name);
+extern char		*_mxml_node_adopt(mxml_node_t *node, char *s);
+extern void		_mxml_node_free(mxml_node_t *node, void *p);
+extern char		*_mxml_node_name(mxml_node_t *node, const char *name);
+extern char		*_mxml_node_strdup(mxml_node_t *node, const char *s);
+extern void		*_mxml_pool_alloc(mxml_pool_t *pool, size_t bytes);
+extern void		_mxml_pool_changed(mxml_node_t *node);
+extern int		_mxml_pool_find(mxml_node_t *node, mxml_node_t *top,
+			                const char *element, const char *attr,
+			                const char *value, int descend,
+			                mxml_node_t **found);
+extern const char	*_mxml_pool_lookup(mxml_pool_t *pool, const char *name);
+extern mxml_node_t	*_mxml_pool_new_node(mxml_pool_t *pool);
+extern char		*_mxml_pool_strdup(mxml_pool_t *pool, const char *s);
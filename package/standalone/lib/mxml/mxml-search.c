@@ -39,6 +39,7 @@ mxmlFindElement(mxml_node_t *node,	/* I - Current node */
 		int         descend)	/* I - Descend into tree - @code MXML_DESCEND@, @code MXML_NO_DESCEND@, or @code MXML_DESCEND_FIRST@ */
 {
   const char	*temp;			/* Current attribute value */
+  mxml_node_t	*found;			/* Node found through the index */
 
 
  /*
@@ -48,6 +49,13 @@ mxmlFindElement(mxml_node_t *node,	/* I - Current node */
   if (!node || !top || (!attr && value))
     return (NULL);
 
+ /*
+  * Trees loaded into a pool are searched by name through their index...
+  */
+
+  if (_mxml_pool_find(node, top, element, attr, value, descend, &found))
+    return (found);
+
  /*
   * Start with the next node...
   */
@@ -53,10 +53,10 @@ mxmlSetCDATA(mxml_node_t *node,		/* I - Node to set */
   * Allocate the new value, free any old element value, and set the new value...
   */
 
-  s = _mxml_strdupf("![CDATA[%s", data);
+  s = _mxml_node_adopt(node, _mxml_strdupf("![CDATA[%s", data));
 
   if (node->value.element.name)
-    free(node->value.element.name);
+    _mxml_node_free(node, node->value.element.name);
 
   node->value.element.name = s;
 
@@ -134,9 +134,11 @@ mxmlSetElement(mxml_node_t *node,	/* I - Node to set */
   */
 
   if (node->value.element.name)
-    free(node->value.element.name);
+    _mxml_node_free(node, node->value.element.name);
 
-  node->value.element.name = strdup(name);
+  node->value.element.name = _mxml_node_name(node, name);
+
+  _mxml_pool_changed(node);
 
   return (0);
 }
@@ -202,9 +204,9 @@ mxmlSetOpaque(mxml_node_t *node,	/* I - Node to set */
   */
 
   if (node->value.opaque)
-    free(node->value.opaque);
+    _mxml_node_free(node, node->value.opaque);
 
-  node->value.opaque = strdup(opaque);
+  node->value.opaque = _mxml_node_strdup(node, opaque);
 
   return (0);
 }
@@ -243,11 +245,11 @@ mxmlSetOpaquef(mxml_node_t *node,	/* I - Node to set */
   */
 
   va_start(ap, format);
-  s = _mxml_vstrdupf(format, ap);
+  s = _mxml_node_adopt(node, _mxml_vstrdupf(format, ap));
   va_end(ap);
 
   if (node->value.opaque)
-    free(node->value.opaque);
+    _mxml_node_free(node, node->value.opaque);
 
   node->value.opaque = s;
 
@@ -319,10 +321,10 @@ mxmlSetText(mxml_node_t *node,		/* I - Node to set */
   */
 
   if (node->value.text.string)
-    free(node->value.text.string);
+    _mxml_node_free(node, node->value.text.string);
 
   node->value.text.whitespace = whitespace;
-  node->value.text.string     = strdup(string);
+  node->value.text.string     = _mxml_node_strdup(node, string);
 
   return (0);
 }
@@ -360,11 +362,11 @@ mxmlSetTextf(mxml_node_t *node,		/* I - Node to set */
   */
 
   va_start(ap, format);
-  s = _mxml_vstrdupf(format, ap);
+  s = _mxml_node_adopt(node, _mxml_vstrdupf(format, ap));
   va_end(ap);
 
   if (node->value.text.string)
-    free(node->value.text.string);
+    _mxml_node_free(node, node->value.text.string);
 
   node->value.text.whitespace = whitespace;
   node->value.text.string     = s;
@@ -99,6 +99,9 @@ typedef struct _mxml_node_s mxml_node_t;	/**** An XML node. ****/
 typedef struct _mxml_index_s mxml_index_t;
 					/**** An XML node index. ****/
 
+typedef struct _mxml_pool_s mxml_pool_t;
+					/**** A node/string pool for trees. ****/
+
 typedef int (*mxml_custom_load_cb_t)(mxml_node_t *, const char *);
 					/**** Custom data load callback function ****/
 
@@ -203,6 +206,12 @@ __attribute__ ((__format__ (__printf__, 3, 4)))
 #    endif /* __GNUC__ */
 ;
 extern mxml_node_t	*mxmlNewXML(const char *version);
+extern void		mxmlPoolDelete(mxml_pool_t *pool);
+extern size_t		mxmlPoolGetSize(mxml_pool_t *pool);
+extern mxml_node_t	*mxmlPoolLoadString(mxml_pool_t *pool, const char *s,
+			                    mxml_type_t (*cb)(mxml_node_t *));
+extern mxml_pool_t	*mxmlPoolNew(size_t block_size);
+extern mxml_node_t	*mxmlPoolNewXML(mxml_pool_t *pool, const char *version);
 extern int		mxmlRelease(mxml_node_t *node);
 extern void		mxmlRemove(mxml_node_t *node);
 extern int		mxmlRetain(mxml_node_t *node);
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+#
+# Minimal MQTT 3.1.1 broker, a stand-in for mosquitto when benchmarking
+# the client on a host.
+#
+# It acknowledges QoS 1/2 publishes after `--delay` milliseconds, without
+# holding up the packets behind them, to emulate the round trip of a HaLow
+# link. Publishes are routed to matching subscribers at QoS 0.
+#
+# A client whose id ends in "-drop<N>" is disconnected when its Nth new
+# (not dup) publish on a connection arrives, before that publish is
+# acknowledged, to exercise retransmission on reconnect. A publish on a
+# topic under "reject/" always closes the connection, like a broker that
+# denies it. Per connection counts are printed on close.
+#
+#   python3 mqtt_broker.py -p 1883 --delay 100
+#
+
+import argparse
+import asyncio
+import re
+
+CONNECT, CONNACK, PUBLISH, PUBACK, PUBREC, PUBREL, PUBCOMP = 1, 2, 3, 4, 5, 6, 7
+SUBSCRIBE, SUBACK, UNSUBSCRIBE, UNSUBACK, PINGREQ, PINGRESP, DISCONNECT = 8, 9, 10, 11, 12, 13, 14
+
+sessions = {}       # client id -> set of unreleased QoS 2 packet ids
+subscribers = {}    # writer -> list of topic filters
+
+
+def encode_length(length):
+    out = bytearray()
+    while True:
+        byte = length % 128
+        length //= 128
+        if length:
+            byte |= 0x80
+        out.append(byte)
+        if not length:
+            return bytes(out)
+
+
+def packet(first, body=b''):
+    return bytes([first]) + encode_length(len(body)) + body
+
+
+def ack(kind, packet_id):
+    return packet(kind << 4 | (2 if kind == PUBREL else 0), packet_id.to_bytes(2, 'big'))
+
+
+def topic_matches(topic_filter, topic):
+    pattern = re.escape(topic_filter).replace(r'\+', '[^/]*').replace(r'\#', '.*')
+    return re.fullmatch(pattern, topic) is not None
+
+
+async def read_packet(reader):
+    first = (await reader.readexactly(1))[0]
+    length, multiplier = 0, 1
+    while True:
+        byte = (await reader.readexactly(1))[0]
+        length += (byte & 127) * multiplier
+        multiplier *= 128
+        if not byte & 128:
+            break
+    return first, await reader.readexactly(length)
+
+
+def read_string(body, pos):
+    length = int.from_bytes(body[pos:pos + 2], 'big')
+    return body[pos + 2:pos + 2 + length].decode('utf-8', 'replace'), pos + 2 + length
+
+
+class Connection:
+    def __init__(self, args, reader, writer):
+        self.args = args
+        self.reader = reader
+        self.writer = writer
+        self.client_id = '?'
+        self.drop_after = 0
+        self.publishes = 0
+        self.dups = 0
+        self.ids = set()
+        self.last = asyncio.sleep(0)
+
+    def send(self, data, delay=0.0):
+        """Queues data behind whatever was sent before, acks keep their order"""
+        previous = self.last
+
+        async def later():
+            await asyncio.sleep(delay)
+            await previous
+            if not self.writer.is_closing():
+                self.writer.write(data)
+
+        self.last = asyncio.ensure_future(later())
+
+    def delayed(self, data):
+        self.send(data, self.args.delay / 1000.0)
+
+    def on_connect(self, body):
+        _, pos = read_string(body, 0)
+        flags = body[pos + 1]
+        self.client_id, _ = read_string(body, pos + 4)
+        match = re.search(r'-drop(\d+)$', self.client_id)
+        if match:
+            self.drop_after = int(match.group(1))
+        present = 0
+        if flags & 0x02 or self.client_id not in sessions:
+            sessions[self.client_id] = set()
+        else:
+            present = 1
+        self.send(packet(CONNACK << 4, bytes([present, 0])))
+
+    def on_publish(self, first, body):
+        qos = (first >> 1) & 3
+        topic, pos = read_string(body, 0)
+        packet_id = 0
+        if qos:
+            packet_id = int.from_bytes(body[pos:pos + 2], 'big')
+            pos += 2
+        self.publishes += 1
+        if first & 0x08:
+            self.dups += 1
+        self.ids.add(packet_id)
+        if self.drop_after and self.publishes - self.dups == self.drop_after:
+            return False
+        if topic.startswith('reject/'):
+            return False
+        for writer, filters in list(subscribers.items()):
+            if any(topic_matches(f, topic) for f in filters) and not writer.is_closing():
+                writer.write(packet(PUBLISH << 4, len(topic.encode()).to_bytes(2, 'big') +
+                                    topic.encode() + body[pos:]))
+        if qos == 1:
+            self.delayed(ack(PUBACK, packet_id))
+        elif qos == 2:
+            sessions[self.client_id].add(packet_id)
+            self.delayed(ack(PUBREC, packet_id))
+        return True
+
+    def on_subscribe(self, body):
+        packet_id = int.from_bytes(body[0:2], 'big')
+        pos, granted = 2, bytearray()
+        while pos < len(body):
+            topic_filter, pos = read_string(body, pos)
+            granted.append(min(body[pos], 2))
+            pos += 1
+            subscribers.setdefault(self.writer, []).append(topic_filter)
+        self.send(packet(SUBACK << 4, packet_id.to_bytes(2, 'big') + bytes(granted)))
+
+    def on_unsubscribe(self, body):
+        packet_id = int.from_bytes(body[0:2], 'big')
+        pos, filters = 2, subscribers.get(self.writer, [])
+        while pos < len(body):
+            topic_filter, pos = read_string(body, pos)
+            if topic_filter in filters:
+                filters.remove(topic_filter)
+        self.send(ack(UNSUBACK, packet_id))
+
+    async def run(self):
+        try:
+            while True:
+                first, body = await read_packet(self.reader)
+                kind = first >> 4
+                if kind == CONNECT:
+                    self.on_connect(body)
+                elif kind == PUBLISH:
+                    if not self.on_publish(first, body):
+                        break
+                elif kind == PUBREL:
+                    packet_id = int.from_bytes(body[0:2], 'big')
+                    sessions.get(self.client_id, set()).discard(packet_id)
+                    self.delayed(ack(PUBCOMP, packet_id))
+                elif kind == SUBSCRIBE:
+                    self.on_subscribe(body)
+                elif kind == UNSUBSCRIBE:
+                    self.on_unsubscribe(body)
+                elif kind == PINGREQ:
+                    self.send(packet(PINGRESP << 4))
+                elif kind == DISCONNECT:
+                    break
+                await self.writer.drain()
+            await self.last
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            subscribers.pop(self.writer, None)
+            self.writer.close()
+            if not self.args.quiet:
+                print('{}: {} publishes, {} dup, {} packet ids'.format(
+                    self.client_id, self.publishes, self.dups, len(self.ids)))
+
+
+async def serve(args):
+    async def on_client(reader, writer):
+        writer.get_extra_info('socket').setsockopt(6, 1, 1)     # TCP_NODELAY
+        await Connection(args, reader, writer).run()
+
+    server = await asyncio.start_server(on_client, args.bind, args.port)
+    async with server:
+        await server.serve_forever()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='MQTT broker stand-in for client benchmarks')
+    parser.add_argument('-b', '--bind', default='127.0.0.1')
+    parser.add_argument('-p', '--port', type=int, default=1883)
+    parser.add_argument('--delay', type=float, default=100.0, help='ack delay in ms, the emulated RTT')
+    parser.add_argument('-q', '--quiet', action='store_true')
+    args = parser.parse_args()
+    try:
+        asyncio.run(serve(args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,282 @@
+/*
+ * Host benchmark for the publish queue of the MQTT client.
+ *
+ * Publishes the same messages with the blocking MQTTPublish and with
+ * MQTTPublishAsync at several in-flight windows, and reports messages per
+ * second. Every queued publish has to complete exactly once, also over a
+ * connection the broker drops every few messages, which makes the client
+ * retransmit on reconnect. Payloads larger than the send buffer check that
+ * they are gathered from the caller's buffer rather than copied.
+ *
+ * The drop checks then expect a FAILURE completion, exactly once, for each
+ * publish that is dropped: by MQTTPublishFlush, by closing a clean session,
+ * and after MAX_PUBLISH_RESEND reconnects on a topic the broker rejects.
+ *
+ * Runs against mqtt_broker.py, whose --delay emulates the link round trip:
+ *
+ *   python3 mqtt_broker.py --delay 100 &
+ *   gcc -O2 -DINCLUDE_MEASURE_AIRTIME -DMQTTCLIENT_PLATFORM_HEADER=MQTTLinux.h \
+ *       -I ../../src -I ../../src/linux -I ../../../MQTTPacket/src -o pubbench \
+ *       pubbench.c ../../src/MQTTClient.c ../../src/linux/MQTTLinux.c ../../../MQTTPacket/src/MQTT[A-Z]*.c
+ *   ./pubbench [host] [port] [messages]
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "MQTTClient.h"
+
+#define PAYLOAD_MAX	4096
+
+static char *host = "127.0.0.1";
+static int port = 1883;
+
+static Network network;
+static MQTTClient client;
+static unsigned char sendbuf[128], readbuf[128];
+static MQTTPacket_connectData options = MQTTPacket_connectData_initializer;
+
+static char (*payloads)[PAYLOAD_MAX];
+static int message_of_id[MAX_PACKET_ID + 1];
+static int *completed, *dropped, failed, reconnects;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void publish_complete(unsigned short id, int rc)
+{
+	if (rc == SUCCESS)
+		completed[message_of_id[id]]++;
+	else {
+		dropped[message_of_id[id]]++;
+		failed++;
+	}
+}
+
+static int open_session(const char *client_id, int gather)
+{
+	NetworkInit(&network);
+	if (!gather)
+		network.mqttwritev = NULL;
+	if (NetworkConnect(&network, host, port) != 0) {
+		printf("can't connect to %s:%d\n", host, port);
+		return -1;
+	}
+	options.clientID.cstring = (char *)client_id;
+	options.keepAliveInterval = 30;
+	return MQTTConnect(&client, &options);
+}
+
+static int reconnect(void)
+{
+	NetworkDisconnect(&network);
+	reconnects++;
+	/* the queued publishes of the client survive, they are resent on connect */
+	NetworkInit(&network);
+	if (NetworkConnect(&network, host, port) != 0)
+		return -1;
+	return MQTTConnect(&client, &options);
+}
+
+static void yield(void)
+{
+	if (MQTTYield(&client, 5) != SUCCESS || !MQTTIsConnected(&client))
+		reconnect();
+}
+
+static void make_payload(int i, size_t size)
+{
+	int len = snprintf(payloads[i], PAYLOAD_MAX, "message %d ", i);
+	memset(payloads[i] + len, 'x', size > (size_t)len ? size - len : 0);
+}
+
+/* Publishes count messages, returns messages/s or -1 if any was lost or duplicated */
+static double run(const char *name, const char *client_id, int async, int qos, int window,
+				  int count, size_t size, int gather)
+{
+	double t;
+	int i, lost = 0;
+
+	memset(completed, 0, count * sizeof(int));
+	memset(dropped, 0, count * sizeof(int));
+	failed = reconnects = 0;
+	MQTTClientInit(&client, &network, 5000, sendbuf, sizeof(sendbuf), readbuf, sizeof(readbuf));
+	MQTTSetPublishHandler(&client, publish_complete);
+	MQTTSetInflightWindow(&client, window);
+	options.cleansession = 0;
+	if (open_session(client_id, gather) != SUCCESS) {
+		printf("%-24s connect failed\n", name);
+		return -1;
+	}
+
+	t = now();
+	for (i = 0; i < count; i++) {
+		MQTTMessage message = { 0 };
+		int rc;
+
+		make_payload(i, size);
+		message.qos = qos;
+		message.payload = payloads[i];
+		message.payloadlen = size;
+		if (!async) {
+			if (MQTTPublish(&client, "bench/halow", &message) == SUCCESS)
+				completed[i]++;
+			else
+				lost++;
+			continue;
+		}
+		while ((rc = MQTTPublishAsync(&client, "bench/halow", &message)) == BUFFER_OVERFLOW)
+			yield();
+		if (rc == SUCCESS && qos == QOS0)
+			completed[i]++;
+		else if (rc == SUCCESS)
+			message_of_id[message.id] = i;
+		else
+			lost++;
+	}
+	while (MQTTPublishPending(&client) > 0)
+		yield();
+	t = now() - t;
+
+	MQTTDisconnect(&client);
+	NetworkDisconnect(&network);
+
+	for (i = 0; i < count; i++)
+		if (completed[i] != 1)
+			lost++;
+	printf("%-24s %6d %8zu %10.1f %10d %6d\n", name, window, size, count / t, reconnects, lost + failed);
+	return (lost || failed) ? -1 : count / t;
+}
+
+/* Queues count QoS 1 publishes on topic, message i on reject_topic if i == reject */
+static void queue(int count, const char *topic, int reject, const char *reject_topic)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		MQTTMessage message = { 0 };
+
+		make_payload(i, 64);
+		message.qos = QOS1;
+		message.payload = payloads[i];
+		message.payloadlen = 64;
+		while (MQTTPublishAsync(&client, i == reject ? reject_topic : topic, &message) == BUFFER_OVERFLOW)
+			yield();
+		message_of_id[message.id] = i;
+	}
+}
+
+/* Each publish completes once, and those in [first, last] are the ones dropped */
+static int check_drops(const char *name, int count, int first, int last)
+{
+	int i, bad = 0;
+
+	for (i = 0; i < count; i++) {
+		int drop = (i >= first && i <= last);
+
+		if (completed[i] + dropped[i] != 1 || dropped[i] != drop)
+			bad++;
+	}
+	printf("%-24s %6d %8s %10d %10d %6d\n", name, count, "-", failed, reconnects, bad);
+	return bad ? -1 : 0;
+}
+
+static int drops(int count)
+{
+	int fails = 0;
+
+	memset(completed, 0, count * sizeof(int));
+	memset(dropped, 0, count * sizeof(int));
+	failed = reconnects = 0;
+	MQTTClientInit(&client, &network, 5000, sendbuf, sizeof(sendbuf), readbuf, sizeof(readbuf));
+	MQTTSetPublishHandler(&client, publish_complete);
+
+	/* queued while disconnected, then flushed */
+	queue(count, "bench/halow", -1, NULL);
+	if (MQTTPublishFlush(&client) != count || MQTTPublishPending(&client) != 0)
+		fails++;
+	fails += check_drops("flush", count, 0, count - 1);
+
+	/* a clean session drops what is not acknowledged when it is closed,
+	 * here all of them: the broker acks after --delay */
+	memset(completed, 0, count * sizeof(int));
+	memset(dropped, 0, count * sizeof(int));
+	failed = 0;
+	options.cleansession = 1;
+	if (open_session("pubbench-clean", 1) != SUCCESS)
+		return -1;
+	queue(count, "bench/halow", -1, NULL);
+	MQTTDisconnect(&client);
+	NetworkDisconnect(&network);
+	if (MQTTPublishPending(&client) != 0)
+		fails++;
+	fails += check_drops("clean disconnect", count, 0, count - 1);
+
+	/* the broker closes the connection on the rejected publish every time,
+	 * a window of 1 keeps the publishes behind it from being sent with it */
+	memset(completed, 0, count * sizeof(int));
+	memset(dropped, 0, count * sizeof(int));
+	failed = 0;
+	options.cleansession = 0;
+	MQTTSetInflightWindow(&client, 1);
+	if (open_session("pubbench-reject", 1) != SUCCESS)
+		return -1;
+	queue(count, "bench/halow", count / 2, "reject/halow");
+	while (MQTTPublishPending(&client) > 0)
+		yield();
+	MQTTDisconnect(&client);
+	NetworkDisconnect(&network);
+	fails += check_drops("resend limit", count, count / 2, count / 2);
+	if (reconnects < MAX_PUBLISH_RESEND)
+		fails++;
+
+	return fails ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	int count, windows[] = { 1, 2, 4, 8 }, i, fails = 0;
+
+	if (argc > 1)
+		host = argv[1];
+	if (argc > 2)
+		port = atoi(argv[2]);
+	count = argc > 3 ? atoi(argv[3]) : 100;
+
+	/* writes to a connection the broker dropped fail instead */
+	signal(SIGPIPE, SIG_IGN);
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	payloads = malloc(count * sizeof(*payloads));
+	completed = malloc(count * sizeof(int));
+	dropped = malloc(count * sizeof(int));
+
+	printf("%-24s %6s %8s %10s %10s %6s\n", "mode", "window", "payload", "msg/s", "reconnects", "lost");
+	fails += run("MQTTPublish qos1", "pubbench", 0, QOS1, 1, count, 64, 1) < 0;
+	for (i = 0; i < (int)(sizeof(windows) / sizeof(windows[0])); i++)
+		fails += run("MQTTPublishAsync qos1", "pubbench", 1, QOS1, windows[i], count, 64, 1) < 0;
+	fails += run("MQTTPublishAsync qos2", "pubbench", 1, QOS2, MAX_INFLIGHT_PUBLISH, count, 64, 1) < 0;
+	fails += run("MQTTPublishAsync qos0", "pubbench", 1, QOS0, MAX_INFLIGHT_PUBLISH, count, 64, 1) < 0;
+
+	/* a payload 32 times the send buffer only works when gathered */
+	fails += run("gather qos1", "pubbench", 1, QOS1, MAX_INFLIGHT_PUBLISH, count, PAYLOAD_MAX, 1) < 0;
+	fails += run("copy qos1", "pubbench", 1, QOS1, MAX_INFLIGHT_PUBLISH, count, 96, 0) < 0;
+
+	/* the broker drops the connection on every 7th publish */
+	fails += run("reconnect qos1", "pubbench-drop7", 1, QOS1, MAX_INFLIGHT_PUBLISH, count, 64, 1) < 0;
+	fails += run("reconnect qos2", "pubbench-drop7", 1, QOS2, MAX_INFLIGHT_PUBLISH, count, 64, 1) < 0;
+
+	printf("\n%-24s %6s %8s %10s %10s %6s\n", "drops", "count", "", "failed", "reconnects", "wrong");
+	fails += drops(count > MAX_INFLIGHT_PUBLISH ? MAX_INFLIGHT_PUBLISH : count) < 0;
+
+	free(payloads);
+	free(completed);
+	free(dropped);
+	return fails ? 1 : 0;
+}
@@ -19,8 +19,10 @@
 
 #include <stdio.h>
 #include <string.h>
+#if !defined(MQTTCLIENT_PLATFORM_HEADER)
 #include "nrc_sdk.h"
 #include "util_trace.h"
+#endif
 
 static void NewMessageData(MessageData* md, MQTTString* aTopicName, MQTTMessage* aMessage) {
     md->topicName = aTopicName;
@@ -32,25 +34,43 @@ static int getNextPacketId(MQTTClient *c) {
     return c->next_packetid = (c->next_packetid == MAX_PACKET_ID) ? 1 : c->next_packetid + 1;
 }
 
-static int sendPacket(MQTTClient* c, int length, Timer* timer)
+/* Sends the packet in c->buf followed by payload, which the transport gathers
+ * straight from the caller's buffer if it can, instead of copying it after the header */
+static int sendPacketPayload(MQTTClient* c, int length, unsigned char* payload, int payloadlen, Timer* timer)
 {
-	int rc = FAILURE, sent = 0;
+	int rc = FAILURE, sent = 0, total;
+
+	if (payloadlen > 0 && c->ipstack->mqttwritev == NULL && length + payloadlen <= c->buf_size)
+	{
+		/* one write makes one segment (or TLS record) rather than two */
+		memcpy(&c->buf[length], payload, payloadlen);
+		length += payloadlen;
+		payloadlen = 0;
+	}
+	total = length + payloadlen;
+
 #if defined(INCLUDE_MQTT_FAST_CONN)
-	while (sent < length)
+	while (sent < total)
 	{
-		rc = c->ipstack->mqttwrite(c->ipstack, &c->buf[sent], length, 0);
+		int timeout_ms = 0;
 #else
-	while (sent < length && !TimerIsExpired(timer))
+	while (sent < total && !TimerIsExpired(timer))
 	{
-		rc = c->ipstack->mqttwrite(c->ipstack, &c->buf[sent], length, TimerLeftMS(timer));
+		int timeout_ms = TimerLeftMS(timer);
 #endif /* defined(INCLUDE_MQTT_FAST_CONN) */
+		if (sent >= length)
+			rc = c->ipstack->mqttwrite(c->ipstack, &payload[sent - length], total - sent, timeout_ms);
+		else if (payloadlen > 0 && c->ipstack->mqttwritev != NULL)
+			rc = c->ipstack->mqttwritev(c->ipstack, &c->buf[sent], length - sent, payload, payloadlen, timeout_ms);
+		else
+			rc = c->ipstack->mqttwrite(c->ipstack, &c->buf[sent], length - sent, timeout_ms);
 		if (rc < 0){  // there was an error writing the data
-			nrc_usr_print("%s sendPacket loop error %d %d %d\n", __func__, rc, sent, length);
+			nrc_usr_print("%s sendPacket loop error %d %d %d\n", __func__, rc, sent, total);
 			break;
 		}
 		sent += rc;
 	}
-	if (sent == length)
+	if (sent == total)
 	{
 		TimerCountdown(&c->last_sent, c->keepAliveInterval); // record the fact that we have successfully sent the packet
 		rc = SUCCESS;
@@ -62,6 +82,204 @@ static int sendPacket(MQTTClient* c, int length, Timer* timer)
 }
 
 
+static int sendPacket(MQTTClient* c, int length, Timer* timer)
+{
+	return sendPacketPayload(c, length, NULL, 0, timer);
+}
+
+
+static int sendPublish(MQTTClient* c, const char* topicName, MQTTMessage* message, Timer* timer)
+{
+    MQTTString topic = MQTTString_initializer;
+    int len;
+
+    topic.cstring = (char *)topicName;
+    len = MQTTSerialize_publishHeader(c->buf, c->buf_size, message->dup, message->qos, message->retained,
+              message->id, topic, message->payloadlen);
+    if (len <= 0)
+        return FAILURE;
+
+    return sendPacketPayload(c, len, (unsigned char*)message->payload, message->payloadlen, timer);
+}
+
+
+static struct InflightPublish* findInflight(MQTTClient* c, unsigned short id)
+{
+    int i;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISH; ++i)
+    {
+        if (c->inflight[i].state != INFLIGHT_FREE && c->inflight[i].message.id == id)
+            return &c->inflight[i];
+    }
+    return NULL;
+}
+
+
+/* Oldest publish in the given state, so that messages go out (again) in queue order */
+static struct InflightPublish* oldestInflight(MQTTClient* c, int state)
+{
+    struct InflightPublish* oldest = NULL;
+    int i;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISH; ++i)
+    {
+        if (c->inflight[i].state == state &&
+            (oldest == NULL || (int)(c->inflight[i].seq - oldest->seq) < 0))
+            oldest = &c->inflight[i];
+    }
+    return oldest;
+}
+
+
+static struct InflightPublish* queueInflight(MQTTClient* c, const char* topicName, MQTTMessage* message, int notify)
+{
+    struct InflightPublish* p = NULL;
+    int i;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISH; ++i)
+    {
+        if (c->inflight[i].state == INFLIGHT_FREE)
+        {
+            p = &c->inflight[i];
+            break;
+        }
+    }
+    if (p == NULL)
+        return NULL;
+
+    /* the packet id must not be in use by another unacknowledged publish */
+    do
+        message->id = getNextPacketId(c);
+    while (findInflight(c, message->id) != NULL);
+
+    p->topicName = topicName;
+    p->message = *message;
+    p->message.dup = 0;
+    p->seq = c->inflight_seq++;
+    p->notify = notify;
+    p->resends = 0;
+    p->state = INFLIGHT_QUEUED;
+    return p;
+}
+
+
+static void completeInflight(MQTTClient* c, struct InflightPublish* p, int rc)
+{
+    p->state = INFLIGHT_FREE;
+    if (p->notify && c->publishComplete != NULL)
+        c->publishComplete(p->message.id, rc);
+}
+
+
+static int countInflight(MQTTClient* c)
+{
+    int i, count = 0;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISH; ++i)
+    {
+        if (c->inflight[i].state == INFLIGHT_SENT || c->inflight[i].state == INFLIGHT_RELEASED)
+            count++;
+    }
+    return count;
+}
+
+
+/* Drops every queued or in-flight publish, the session they belong to is gone */
+static int flushInflight(MQTTClient* c)
+{
+    int i, count = 0;
+
+    /* in queue order, so that completions come in the order of the publishes */
+    for (;;)
+    {
+        struct InflightPublish* p = NULL;
+
+        for (i = 0; i < MAX_INFLIGHT_PUBLISH; ++i)
+        {
+            if (c->inflight[i].state != INFLIGHT_FREE &&
+                (p == NULL || (int)(c->inflight[i].seq - p->seq) < 0))
+                p = &c->inflight[i];
+        }
+        if (p == NULL)
+            break;
+        completeInflight(c, p, FAILURE);
+        count++;
+    }
+    return count;
+}
+
+
+/* Sends queued publishes for as long as the in-flight window allows */
+static int sendQueued(MQTTClient* c, Timer* timer)
+{
+    struct InflightPublish* p;
+    int inflight = countInflight(c);
+
+    while (inflight < c->inflight_window && (p = oldestInflight(c, INFLIGHT_QUEUED)) != NULL)
+    {
+        if (sendPublish(c, p->topicName, &p->message, timer) != SUCCESS)
+            return FAILURE; /* stays queued, will go out after the reconnect */
+        p->state = INFLIGHT_SENT;
+        p->message.dup = 1; /* any later send is a retransmission */
+        inflight++;
+    }
+    return SUCCESS;
+}
+
+
+/* After a reconnect, sends again whatever was not acknowledged on the previous connection */
+static int resendInflight(MQTTClient* c, Timer* timer)
+{
+    unsigned char resent[MAX_INFLIGHT_PUBLISH] = {0};
+    int i, rc = SUCCESS;
+
+    /* in order of the original sends, publishes waiting for PUBACK/PUBREC
+     * are sent again with dup set, those waiting for PUBCOMP get their PUBREL */
+    for (;;)
+    {
+        struct InflightPublish* p = NULL;
+        int k = -1;
+
+        for (i = 0; i < MAX_INFLIGHT_PUBLISH; ++i)
+        {
+            struct InflightPublish* q = &c->inflight[i];
+            if (!resent[i] && (q->state == INFLIGHT_SENT || q->state == INFLIGHT_RELEASED) &&
+                (p == NULL || (int)(q->seq - p->seq) < 0))
+            {
+                p = q;
+                k = i;
+            }
+        }
+        if (p == NULL)
+            break;
+        resent[k] = 1;
+
+        /* one the server never acknowledges, or closes the connection on, must not hold its slot forever */
+        if (p->state == INFLIGHT_SENT && p->resends >= MAX_PUBLISH_RESEND)
+        {
+            completeInflight(c, p, FAILURE);
+            continue;
+        }
+
+        if (p->state == INFLIGHT_SENT)
+        {
+            p->resends++;
+            rc = sendPublish(c, p->topicName, &p->message, timer);
+        }
+        else
+        {
+            int len = MQTTSerialize_ack(c->buf, c->buf_size, PUBREL, 0, p->message.id);
+            rc = (len <= 0) ? FAILURE : sendPacket(c, len, timer);
+        }
+        if (rc != SUCCESS)
+            return rc;
+    }
+
+    return sendQueued(c, timer);
+}
+
+
 void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeout_ms,
 		unsigned char* sendbuf, size_t sendbuf_size, unsigned char* readbuf, size_t readbuf_size)
 {
@@ -80,6 +298,11 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
     c->ping_outstanding = 0;
     c->defaultMessageHandler = NULL;
     c->next_packetid = 1;
+    for (i = 0; i < MAX_INFLIGHT_PUBLISH; ++i)
+        c->inflight[i].state = INFLIGHT_FREE;
+    c->inflight_window = MAX_INFLIGHT_PUBLISH;
+    c->inflight_seq = 0;
+    c->publishComplete = NULL;
     TimerInit(&c->last_sent);
     TimerInit(&c->last_received);
 #if defined(MQTT_TASK)
@@ -258,7 +481,10 @@ void MQTTCloseSession(MQTTClient* c)
     c->ping_outstanding = 0;
     c->isconnected = 0;
     if (c->cleansession)
+    {
         MQTTCleanSession(c);
+        flushInflight(c);
+    }
 }
 
 
@@ -266,9 +492,13 @@ int cycle(MQTTClient* c, Timer* timer)
 {
     int len = 0,
         rc = SUCCESS;
+    Timer send_timer;   /* the read timer may be about to expire, sends get the command timeout */
 
     int packet_type = readPacket(c, timer);     /* read the socket, see what work is due */
 
+    TimerInit(&send_timer);
+    TimerCountdownMS(&send_timer, c->command_timeout_ms);
+
     switch (packet_type)
     {
         default:
@@ -278,10 +508,26 @@ int cycle(MQTTClient* c, Timer* timer)
         case 0: /* timed out reading packet */
             break;
         case CONNACK:
-        case PUBACK:
         case SUBACK:
         case UNSUBACK:
             break;
+        case PUBACK:
+        case PUBCOMP:
+        {
+            unsigned short mypacketid;
+            unsigned char dup, type;
+            struct InflightPublish* p;
+            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
+            {
+                rc = FAILURE;
+                goto exit;
+            }
+            if ((p = findInflight(c, mypacketid)) != NULL && p->state != INFLIGHT_QUEUED)
+                completeInflight(c, p, SUCCESS);
+            if ((rc = sendQueued(c, &send_timer)) != SUCCESS) // the window has room for one more
+                goto exit;
+            break;
+        }
         case PUBLISH:
         {
             MQTTMessage msg;
@@ -303,7 +549,7 @@ int cycle(MQTTClient* c, Timer* timer)
                 if (len <= 0)
                     rc = FAILURE;
                 else
-                    rc = sendPacket(c, len, timer);
+                    rc = sendPacket(c, len, &send_timer);
                 if (rc == FAILURE)
                     goto exit; // there was a problem
             }
@@ -314,20 +560,21 @@ int cycle(MQTTClient* c, Timer* timer)
         {
             unsigned short mypacketid;
             unsigned char dup, type;
+            struct InflightPublish* p;
             if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
                 rc = FAILURE;
             else if ((len = MQTTSerialize_ack(c->buf, c->buf_size,
                 (packet_type == PUBREC) ? PUBREL : PUBCOMP, 0, mypacketid)) <= 0)
                 rc = FAILURE;
-            else if ((rc = sendPacket(c, len, timer)) != SUCCESS) // send the PUBREL packet
+            else if ((rc = sendPacket(c, len, &send_timer)) != SUCCESS) // send the PUBREL packet
                 rc = FAILURE; // there was a problem
+            else if (packet_type == PUBREC && (p = findInflight(c, mypacketid)) != NULL && p->state == INFLIGHT_SENT)
+                p->state = INFLIGHT_RELEASED; // now waiting for PUBCOMP
             if (rc == FAILURE)
                 goto exit; // there was a problem
             break;
         }
 
-        case PUBCOMP:
-            break;
         case PINGRESP:
             c->ping_outstanding = 0;
             break;
@@ -377,6 +624,7 @@ int MQTTIsConnected(MQTTClient* client)
 extern bool isMQTTRun_flag;
 #endif /* defined(INCLUDE_MQTT_FAST_CONN) */
 
+#if defined(MQTT_TASK)
 void MQTTRun(void* parm)
 {
 #if defined(INCLUDE_MQTT_FAST_CONN)
@@ -400,12 +648,13 @@ void MQTTRun(void* parm)
 #if defined(MQTT_TASK)
 		MutexUnlock(&c->mutex);
 #endif
-        vTaskDelay(pdMS_TO_TICKS(100));
+        /* read the acks of queued publishes back to back, the
+         * tick of delay still lets publishers take the mutex */
+        vTaskDelay(MQTTPublishPending(c) ? 1 : pdMS_TO_TICKS(100));
 	}
 }
 
 
-#if defined(MQTT_TASK)
 int MQTTStartTask(MQTTClient* client)
 {
 	return ThreadStart(&client->thread, &MQTTRun, client);
@@ -488,6 +737,8 @@ exit:
     {
         c->isconnected = 1;
         c->ping_outstanding = 0;
+        TimerCountdownMS(&connect_timer, c->command_timeout_ms);
+        resendInflight(c, &connect_timer);
     } else {
 		c->isconnected = 0;
 	}
@@ -675,9 +926,8 @@ int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
 {
     int rc = FAILURE;
     Timer timer;
-    MQTTString topic = MQTTString_initializer;
-    topic.cstring = (char *)topicName;
-    int len = 0;
+    struct InflightPublish* p = NULL;
+    unsigned int seq;
 
 #if defined(MQTT_TASK)
 	MutexLock(&c->mutex);
@@ -691,52 +941,46 @@ int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
     TimerCountdownMS(&timer, c->command_timeout_ms);
 #endif /* !defined(INCLUDE_MQTT_FAST_CONN) */
 
-    if (message->qos == QOS1 || message->qos == QOS2)
-        message->id = getNextPacketId(c);
-
-    len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id,
-              topic, (unsigned char*)message->payload, message->payloadlen);
-    if (len <= 0)
+    if (message->qos == QOS0)
+    {
+        message->dup = 0;
+        rc = sendPublish(c, topicName, message, &timer);
         goto exit;
+    }
 
-    if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
+    /* QoS 1/2 go through the publish queue like MQTTPublishAsync ones,
+     * publishes queued before this one keep their place in the window */
+    while ((p = queueInflight(c, topicName, message, 0)) == NULL)
+    {
+        if (TimerIsExpired(&timer) || cycle(c, &timer) < 0)
+            goto exit;
+    }
+    seq = p->seq;
+
+    if ((rc = sendQueued(c, &timer)) != SUCCESS)
         goto exit; // there was a problem
 
 #if defined(INCLUDE_MQTT_FAST_CONN)
     TimerCountdownMS(&timer, c->command_timeout_ms);
 #endif /* defined(INCLUDE_MQTT_FAST_CONN) */
-    if (message->qos == QOS1)
+    /* wait for PUBACK, or PUBCOMP for QoS 2 */
+    while (p->state != INFLIGHT_FREE && p->seq == seq)
     {
-        if (waitfor(c, PUBACK, &timer) == PUBACK)
+        if (TimerIsExpired(&timer) || cycle(c, &timer) < 0)
         {
-#if !defined(INCLUDE_MEASURE_AIRTIME)					            
-            nrc_usr_print("[%s] PUBACK received\n", __func__);
-#endif /* !defined(INCLUDE_MEASURE_AIRTIME) */
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
-                rc = FAILURE;
-        }
-        else
             rc = FAILURE;
-    }
-    else if (message->qos == QOS2)
-    {
-        if (waitfor(c, PUBCOMP, &timer) == PUBCOMP)
-        {
-#if !defined(INCLUDE_MEASURE_AIRTIME)		            
-            nrc_usr_print("[%s] PUBCOMP received\n", __func__);
-#endif /* !defined(INCLUDE_MEASURE_AIRTIME) */            
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
-                rc = FAILURE;
+            goto exit;
         }
-        else
-            rc = FAILURE;
     }
+#if !defined(INCLUDE_MEASURE_AIRTIME)
+    nrc_usr_print("[%s] %s received\n", __func__, (message->qos == QOS1) ? "PUBACK" : "PUBCOMP");
+#endif /* !defined(INCLUDE_MEASURE_AIRTIME) */
+    rc = SUCCESS;
 
 exit:
+    /* the caller's payload can't be referenced once we return */
+    if (rc != SUCCESS && p != NULL && p->state != INFLIGHT_FREE && p->seq == seq)
+        p->state = INFLIGHT_FREE;
     //if (rc == FAILURE)
         //MQTTCloseSession(c);
 
@@ -748,6 +992,97 @@ exit:
 }
 
 
+int MQTTPublishAsync(MQTTClient* c, const char* topicName, MQTTMessage* message)
+{
+    int rc = FAILURE;
+    Timer timer;
+
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+
+    if (message->qos == QOS0)
+    {
+        message->dup = 0;
+        if (c->isconnected)
+            rc = sendPublish(c, topicName, message, &timer);
+        goto exit;
+    }
+
+    /* queued even when disconnected, it goes out after the next MQTTConnect */
+    if (queueInflight(c, topicName, message, 1) == NULL)
+    {
+        rc = BUFFER_OVERFLOW;
+        goto exit;
+    }
+    rc = SUCCESS;
+    if (c->isconnected)
+        sendQueued(c, &timer); /* on failure it stays queued until the reconnect */
+
+exit:
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+
+    return rc;
+}
+
+
+int MQTTSetInflightWindow(MQTTClient* c, unsigned int window)
+{
+    if (window < 1 || window > MAX_INFLIGHT_PUBLISH)
+        return FAILURE;
+
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+    c->inflight_window = window;
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+
+    return SUCCESS;
+}
+
+
+void MQTTSetPublishHandler(MQTTClient* c, publishHandler handler)
+{
+    c->publishComplete = handler;
+}
+
+
+int MQTTPublishPending(MQTTClient* c)
+{
+    int i, count = 0;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISH; ++i)
+    {
+        if (c->inflight[i].state != INFLIGHT_FREE)
+            count++;
+    }
+    return count;
+}
+
+
+int MQTTPublishFlush(MQTTClient* c)
+{
+    int count;
+
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+    count = flushInflight(c);
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+
+    return count;
+}
+
+
 int MQTTDisconnect(MQTTClient* c)
 {
     int rc = FAILURE;
@@ -34,7 +34,6 @@
   #define DLLExport
 #endif
 
-#include "MQTTNrcImpl.h"
 #include "MQTTPacket.h"
 
 #if defined(MQTTCLIENT_PLATFORM_HEADER)
@@ -44,6 +43,8 @@
 #define xstr(s) str(s)
 #define str(s) #s
 #include xstr(MQTTCLIENT_PLATFORM_HEADER)
+#else
+#include "MQTTNrcImpl.h"
 #endif
 
 #define MAX_PACKET_ID 65535 /* according to the MQTT specification - do not change! */
@@ -52,6 +53,14 @@
 #define MAX_MESSAGE_HANDLERS 15 /* redefinable - how many subscriptions do you want? */
 #endif
 
+#if !defined(MAX_INFLIGHT_PUBLISH)
+#define MAX_INFLIGHT_PUBLISH 8 /* redefinable - how many QoS 1/2 publishes can be queued or awaiting acks? */
+#endif
+
+#if !defined(MAX_PUBLISH_RESEND)
+#define MAX_PUBLISH_RESEND 3 /* redefinable - how many reconnects a publish is sent again on before it is dropped */
+#endif
+
 enum QoS { QOS0, QOS1, QOS2, SUBFAIL=0x80 };
 
 /* all failure return codes must be negative */
@@ -103,6 +112,14 @@ typedef struct MQTTSubackData
 
 typedef void (*messageHandler)(MessageData*);
 
+/* Called with the packet id of a queued publish once it is acknowledged (SUCCESS)
+ * or dropped (FAILURE): by MQTTPublishFlush, when a clean session is closed, or when
+ * it was sent again on MAX_PUBLISH_RESEND reconnects without being acknowledged.
+ * Runs inside the client, so it must not call the MQTT API. */
+typedef void (*publishHandler)(unsigned short id, int rc);
+
+enum InflightState { INFLIGHT_FREE, INFLIGHT_QUEUED, INFLIGHT_SENT, INFLIGHT_RELEASED };
+
 typedef struct MQTTClient
 {
     unsigned int next_packetid,
@@ -124,6 +141,19 @@ typedef struct MQTTClient
 
     void (*defaultMessageHandler) (MessageData*);
 
+    struct InflightPublish
+    {
+        const char* topicName;
+        MQTTMessage message;            /* payload is not copied, it must stay valid until completion */
+        unsigned int seq;               /* queue order, also sent order */
+        unsigned char state;            /* enum InflightState */
+        unsigned char notify;           /* call publishComplete, not for blocking MQTTPublish */
+        unsigned char resends;          /* times sent again after a reconnect */
+    } inflight[MAX_INFLIGHT_PUBLISH];   /* QoS 1/2 publishes, queued or awaiting PUBACK/PUBREC/PUBCOMP */
+    unsigned int inflight_window,
+      inflight_seq;
+    publishHandler publishComplete;
+
     Network* ipstack;
     Timer last_sent, last_received;
 #if defined(MQTT_TASK)
@@ -168,6 +198,45 @@ DLLExport int MQTTConnect(MQTTClient* client, MQTTPacket_connectData* options);
  */
 DLLExport int MQTTPublish(MQTTClient* client, const char*, MQTTMessage*);
 
+/** MQTT Publish Async - queue an MQTT publish packet and return without waiting for acks.
+ *  QoS 1/2 messages are sent as soon as the in-flight window allows and are kept, with their
+ *  packet id, until acknowledged. Unacknowledged ones are sent again after a reconnect.
+ *  QoS 0 messages are sent right away.
+ *  @param client - the client object to use
+ *  @param topic - the topic to publish to, must stay valid until completion
+ *  @param message - the message to send, the payload must stay valid until completion.
+ *                   message->id is set to the packet id of the queued publish
+ *  @return success code, BUFFER_OVERFLOW if the queue is full
+ */
+DLLExport int MQTTPublishAsync(MQTTClient* client, const char*, MQTTMessage*);
+
+/** MQTT SetInflightWindow - set how many QoS 1/2 publishes may await acks at once
+ *  @param client - the client object to use
+ *  @param window - 1 to MAX_INFLIGHT_PUBLISH, 1 gives one publish per round trip
+ *  @return success code
+ */
+DLLExport int MQTTSetInflightWindow(MQTTClient* client, unsigned int window);
+
+/** MQTT SetPublishHandler - set the completion callback of MQTTPublishAsync
+ *  @param client - the client object to use
+ *  @param handler - called with the packet id and result of each queued publish, or NULL
+ */
+DLLExport void MQTTSetPublishHandler(MQTTClient* client, publishHandler handler);
+
+/** MQTT PublishPending - how many QoS 1/2 publishes are queued or awaiting acks
+ *  @param client - the client object to use
+ *  @return number of publishes
+ */
+DLLExport int MQTTPublishPending(MQTTClient* client);
+
+/** MQTT PublishFlush - drop the QoS 1/2 publishes that are queued or awaiting acks
+ *  Queued publishes survive a disconnect unless the session is clean, this releases them.
+ *  Those of MQTTPublishAsync complete with FAILURE.
+ *  @param client - the client object to use
+ *  @return number of publishes dropped
+ */
+DLLExport int MQTTPublishFlush(MQTTClient* client);
+
 /** MQTT SetMessageHandler - set or remove a per topic message handler
  *  @param client - the client object to use
  *  @param topicFilter - the topic filter set the message handler for
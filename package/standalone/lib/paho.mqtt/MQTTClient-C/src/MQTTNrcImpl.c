@@ -30,6 +30,7 @@
 #include "lwip/tcpip.h"
 #include "lwip/sys.h"
 #include "lwip/netdb.h"
+#include "lwip/errno.h"
 
 #if LWIP_SOCKET
 #include "lwip/sockets.h"
@@ -44,6 +45,9 @@
 #include "mbedtls/entropy.h"
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/debug.h"
+#include "tls_session_cache.h"
+#include "tls_cert_store.h"
+#include "tls_max_frag.h"
 #endif
 
 #include "nrc_sdk.h"
@@ -53,9 +57,15 @@ typedef struct {
 	mbedtls_ssl_context ssl_ctx;        /* mbedtls ssl context */
 	mbedtls_net_context net_ctx;        /* Fill in socket id */
 	mbedtls_ssl_config ssl_conf;        /* SSL configuration */
+#if defined(NRC_TLS_CERT_STORE)
+	mbedtls_x509_crt *cacert;           /* shared, see tls_cert_store.h */
+	mbedtls_x509_crt *clicert;
+	mbedtls_pk_context *pkey;
+#else
 	mbedtls_x509_crt cacert;
 	mbedtls_x509_crt clicert;
 	mbedtls_pk_context pkey;
+#endif
 } mqtt_ssl_t;
 #endif
 
@@ -118,11 +128,8 @@ void TimerInit(Timer* timer)
 	memset(&timer->xTimeOut, '\0', sizeof(timer->xTimeOut));
 }
 
-int nrc_sock_read(Network* n, unsigned char* buffer, int len, int timeout_ms)
+static int nrc_sock_wait(Network* n, int for_write, int timeout_ms)
 {
-	int rc = 0;
-	int recvlen = 0;
-	int ret = -1;
 	fd_set fdset;
 	struct timeval tv;
 
@@ -132,22 +139,44 @@ int nrc_sock_read(Network* n, unsigned char* buffer, int len, int timeout_ms)
 	tv.tv_sec = timeout_ms / 1000;
 	tv.tv_usec = (timeout_ms % 1000) * 1000;
 
-	ret = select(n->my_socket + 1, &fdset, NULL, NULL, &tv);
+	if (for_write)
+		return select(n->my_socket + 1, NULL, &fdset, NULL, &tv);
+	return select(n->my_socket + 1, &fdset, NULL, NULL, &tv);
+}
+
+int nrc_sock_read(Network* n, unsigned char* buffer, int len, int timeout_ms)
+{
+	int rc = 0;
+	int recvlen = 0;
+	int ret = -1;
 
-	if (ret < 0) {
+	/* Most reads are for bytes that already sit in the receive buffer
+	 * (the rest of a packet, or the next one of a burst of acks),
+	 * only go through select() when there is nothing to read yet */
+	rc = recv(n->my_socket, buffer, len, MSG_DONTWAIT);
+	if (rc > 0) {
+		recvlen = rc;
+	} else if (rc == 0) {
+		return -30;
+	} else if (errno != EWOULDBLOCK && errno != EAGAIN) {
 		return -10;
-	} else if (ret == 0) {
-		/* timeout */
-		return ret;
-	} else if (ret == 1) {
-		do {
-			rc = recv(n->my_socket, buffer + recvlen, len - recvlen, 0);
-			if (rc > 0) {
-				recvlen += rc;
-			} else {
-				return -30;
-			}
-		} while (recvlen < len);
+	} else {
+		ret = nrc_sock_wait(n, 0, timeout_ms);
+		if (ret < 0) {
+			return -10;
+		} else if (ret == 0) {
+			/* timeout */
+			return ret;
+		}
+	}
+
+	while (recvlen < len) {
+		rc = recv(n->my_socket, buffer + recvlen, len - recvlen, 0);
+		if (rc > 0) {
+			recvlen += rc;
+		} else {
+			return -30;
+		}
 	}
 	return recvlen;
 }
@@ -156,16 +185,8 @@ int nrc_sock_write(Network* n, unsigned char* buffer, int len, int timeout_ms)
 {
 	int rc = 0;
 	int ret = -1;
-	fd_set fdset;
-	struct timeval tv;
-
-	FD_ZERO(&fdset);
-	FD_SET(n->my_socket, &fdset);
-
-	tv.tv_sec = timeout_ms / 1000;
-	tv.tv_usec = (timeout_ms % 1000) * 1000;
 
-	ret = select(n->my_socket + 1, NULL, &fdset, NULL, &tv);
+	ret = nrc_sock_wait(n, 1, timeout_ms);
 
 	if (ret < 0) {
 		/* error */
@@ -180,11 +201,38 @@ int nrc_sock_write(Network* n, unsigned char* buffer, int len, int timeout_ms)
 	return rc;
 }
 
+int nrc_sock_writev(Network* n, unsigned char* header, int header_len,
+	unsigned char* payload, int payload_len, int timeout_ms)
+{
+	struct iovec iov[2];
+	int ret = -1;
+
+	ret = nrc_sock_wait(n, 1, timeout_ms);
+
+	if (ret < 0) {
+		/* error */
+		return -1;
+	} else if (ret == 0) {
+		/* timeout */
+		return ret;
+	}
+
+	/* Header and payload go out in the same segment, without
+	 * copying the payload into the client's send buffer */
+	iov[0].iov_base = header;
+	iov[0].iov_len = header_len;
+	iov[1].iov_base = payload;
+	iov[1].iov_len = payload_len;
+
+	return writev(n->my_socket, iov, 2);
+}
+
 void NetworkInit(Network* n)
 {
 	n->my_socket = -1;
 	n->mqttread = nrc_sock_read;
 	n->mqttwrite = nrc_sock_write;
+	n->mqttwritev = nrc_sock_writev;
 }
 
 int NetworkConnect(Network* n, char* addr, int port)
@@ -385,15 +433,14 @@ int mqtt_ssl_write_all(Network *n, unsigned char *buffer, int len, int timeout_m
 	return writtenLen;
 }
 
-void mqtt_ssl_disconnect(Network *n)
+static void mqtt_ssl_free(mqtt_ssl_t *ssl)
 {
-	mqtt_ssl_t *ssl = (mqtt_ssl_t *)(n->my_socket);
-	if (ssl == NULL)
-		return;
-
-	mbedtls_ssl_close_notify(&ssl->ssl_ctx);
 	mbedtls_net_free(&ssl->net_ctx);
-#if defined(MBEDTLS_X509_CRT_PARSE_C)
+#if defined(NRC_TLS_CERT_STORE)
+	tls_cert_store_put_crt(ssl->cacert);
+	tls_cert_store_put_crt(ssl->clicert);
+	tls_cert_store_put_key(ssl->pkey);
+#elif defined(MBEDTLS_X509_CRT_PARSE_C)
 	mbedtls_x509_crt_free( &ssl->cacert);
 	if ((ssl->pkey).pk_info != NULL) {
 		mbedtls_x509_crt_free(&ssl->clicert);
@@ -404,9 +451,20 @@ void mqtt_ssl_disconnect(Network *n)
 	mbedtls_ssl_config_free(&ssl->ssl_conf);
 }
 
+void mqtt_ssl_disconnect(Network *n)
+{
+	mqtt_ssl_t *ssl = (mqtt_ssl_t *)(n->my_socket);
+	if (ssl == NULL)
+		return;
+
+	mbedtls_ssl_close_notify(&ssl->ssl_ctx);
+	mqtt_ssl_free(ssl);
+}
+
 int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 {
 	int ret = -1;
+	int resume = 0;
 	char port[10] = {0,};
 	snprintf(port, 10, "%d", po);
 
@@ -425,7 +483,11 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 	mbedtls_net_init(&ssl->net_ctx);
 	mbedtls_ssl_init(&ssl->ssl_ctx);
 	mbedtls_ssl_config_init(&ssl->ssl_conf);
-#if defined(MBEDTLS_X509_CRT_PARSE_C)
+#if defined(NRC_TLS_CERT_STORE)
+	ssl->cacert = NULL;
+	ssl->clicert = NULL;
+	ssl->pkey = NULL;
+#elif defined(MBEDTLS_X509_CRT_PARSE_C)
 	mbedtls_x509_crt_init(&ssl->cacert);
 	mbedtls_x509_crt_init(&ssl->clicert);
 	mbedtls_pk_init(&ssl->pkey);
@@ -434,14 +496,53 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 	/*
 	* Initialize certificates
 	*/
-#if defined(MBEDTLS_X509_CRT_PARSE_C)
+#if defined(NRC_TLS_CERT_STORE)
+	/* parsed by the first connection, shared with the others */
+	nrc_usr_print("  . Loading the CA root certificate ...");
+	if (certs->ca_cert != NULL) {
+		ssl->cacert = tls_cert_store_get_crt((const unsigned char *)certs->ca_cert, certs->ca_cert_length, &ret);
+		if (ssl->cacert == NULL) {
+			nrc_usr_print(" failed! x509parse_crt returned -0x%04x\n\n", -ret);
+			goto fail;
+		}
+#if !defined( RELEASE )
+		ssl_parse_crt(ssl->cacert);
+#endif
+	}
+	nrc_usr_print(" ok\n");
+
+	/*
+	* Setup Client Cert/Key
+	*/
+	if ( certs->client_cert != NULL && certs->client_pk != NULL) {
+		nrc_usr_print("  . Loading the client certificate ...");
+		ssl->clicert = tls_cert_store_get_crt((const unsigned char *)certs->client_cert, certs->client_cert_length, &ret);
+		if (ssl->clicert == NULL) {
+			nrc_usr_print(" failed! mbedtls_x509_crt_parse returned -0x%x\n\n", -ret);
+			goto fail;
+		}
+#if !defined( RELEASE )
+		ssl_parse_crt(ssl->clicert);
+#endif
+		nrc_usr_print(" ok\n");
+
+		nrc_usr_print("  . Parsing the client private key[%s] ...", certs->client_pk_pwd);
+		ssl->pkey = tls_cert_store_get_key((const unsigned char *)certs->client_pk, certs->client_pk_length,
+			(const unsigned char *)certs->client_pk_pwd, certs->client_pk_pwd_length, &ret);
+		if (ssl->pkey == NULL) {
+			nrc_usr_print(" failed! mbedtls_pk_parse_key returned -0x%x\n\n", -ret);
+			goto fail;
+		}
+		nrc_usr_print(" ok\n");
+	}
+#elif defined(MBEDTLS_X509_CRT_PARSE_C)
 	nrc_usr_print("  . Loading the CA root certificate ...");
 	if (certs->ca_cert != NULL) {
 #if defined(MBEDTLS_CERTS_C)
 		ret = mbedtls_x509_crt_parse(&ssl->cacert, (const unsigned char *)certs->ca_cert, certs->ca_cert_length);
 		if (ret != 0) {
 			nrc_usr_print(" failed! x509parse_crt returned -0x%04x\n\n", -ret);
-			return ret;
+			goto fail;
 		}
 #endif
 	}
@@ -465,7 +566,7 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 #endif
 		if ( ret != 0 ) {
 			nrc_usr_print(" failed! mbedtls_x509_crt_parse returned -0x%x\n\n", -ret);
-			return ret;
+			goto fail;
 		}
 #if !defined( RELEASE )
 		ssl_parse_crt(&ssl->clicert);
@@ -485,7 +586,7 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 #endif
 		if ( ret != 0 ) {
 			nrc_usr_print(" failed! mbedtls_pk_parse_key returned -0x%x\n\n", -ret);
-			return ret;
+			goto fail;
 		}
 		nrc_usr_print(" ok\n");
 	}
@@ -497,7 +598,7 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 	nrc_usr_print("  . Connecting to tcp/%s/%s...", addr, port);
 	if (0 != (ret = mbedtls_net_connect(&ssl->net_ctx, addr, port, MBEDTLS_NET_PROTO_TCP))) {
 		nrc_usr_print(" failed! net_connect returned -0x%04x\n\n", -ret);
-		return ret;
+		goto fail;
 	}
 	nrc_usr_print(" ok\n");
 
@@ -510,7 +611,7 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 				MBEDTLS_SSL_TRANSPORT_STREAM,
 				MBEDTLS_SSL_PRESET_DEFAULT ) ) != 0 ) {
 		nrc_usr_print(" failed! mbedtls_ssl_config_defaults returned %d\n\n", ret);
-		return ret;
+		goto fail;
 	}
 	nrc_usr_print(" ok\n");
 
@@ -524,33 +625,53 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 		mbedtls_ssl_conf_authmode(&ssl->ssl_conf, MBEDTLS_SSL_VERIFY_NONE);
 	}
 
-#if defined(MBEDTLS_X509_CRT_PARSE_C)
+#if defined(NRC_TLS_CERT_STORE)
+	mbedtls_ssl_conf_ca_chain(&ssl->ssl_conf, ssl->cacert, NULL);
+
+	if (ssl->clicert != NULL &&
+		( ret = mbedtls_ssl_conf_own_cert(&ssl->ssl_conf, ssl->clicert, ssl->pkey ) ) != 0 ) {
+		nrc_usr_print(" failed! mbedtls_ssl_conf_own_cert returned %d\n\n", ret);
+		goto fail;
+	}
+#elif defined(MBEDTLS_X509_CRT_PARSE_C)
 	mbedtls_ssl_conf_ca_chain(&ssl->ssl_conf, &ssl->cacert, NULL);
 
 	if ( ( ret = mbedtls_ssl_conf_own_cert(&ssl->ssl_conf, &ssl->clicert, &ssl->pkey ) ) != 0 ) {
 		nrc_usr_print(" failed! mbedtls_ssl_conf_own_cert returned %d\n\n", ret);
-		return ret;
+		goto fail;
 	}
 #endif
 	mbedtls_ssl_conf_rng(&ssl->ssl_conf, mqtt_ssl_random, NULL );
 	mbedtls_ssl_conf_dbg(&ssl->ssl_conf, mqtt_ssl_debug, NULL );
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+	/* the record size set with tls_max_frag_set() */
+	tls_max_frag_conf(&ssl->ssl_conf);
+#endif
 
 
 	if ( ( ret = mbedtls_ssl_setup(&ssl->ssl_ctx, &ssl->ssl_conf) ) != 0 ) {
 		nrc_usr_print(" failed! mbedtls_ssl_setup returned %d\n\n", ret);
-		return ret;
+		goto fail;
 	}
 	mbedtls_ssl_set_hostname(&ssl->ssl_ctx, addr);
 	mbedtls_ssl_set_bio( &ssl->ssl_ctx, &ssl->net_ctx, mbedtls_net_send, mbedtls_net_recv, mbedtls_net_recv_timeout);
+#if defined(NRC_TLS_SESSION_CACHE)
+	/* resume the last session with this server, if any */
+	resume = (tls_session_cache_set(&ssl->ssl_ctx, addr, po) == 0);
+#endif
 
 	/*
 	* Handshake
 	*/
-	nrc_usr_print("  . Performing the SSL/TLS handshake...");
+	nrc_usr_print("  . Performing the SSL/TLS handshake%s...", resume ? " (resuming)" : "");
 	while ((ret = mbedtls_ssl_handshake(&ssl->ssl_ctx)) != 0) {
 		if ((ret != MBEDTLS_ERR_SSL_WANT_READ) && (ret != MBEDTLS_ERR_SSL_WANT_WRITE)) {
 			nrc_usr_print(" failed! mbedtls_ssl_handshake returned -0x%04x\n\n", -ret);
-			return ret;
+#if defined(NRC_TLS_SESSION_CACHE)
+			if (resume)
+				tls_session_cache_remove(addr, po);
+#endif
+			goto fail;
 		}
 	}
 	nrc_usr_print(" ok\n");
@@ -562,8 +683,15 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 	nrc_usr_print("  . Verifying peer X.509 certificate...");
 	if (0 != (ret = mqtt_real_confirm(mbedtls_ssl_get_verify_result(&ssl->ssl_ctx)))) {
 		nrc_usr_print(" failed! verify result not confirmed.\n\n");
-		return ret;
+#if defined(NRC_TLS_SESSION_CACHE)
+		tls_session_cache_remove(addr, po);
+#endif
+		goto fail;
 	}
+#if defined(NRC_TLS_SESSION_CACHE)
+	resume = tls_session_cache_update(&ssl->ssl_ctx, addr, po);
+	nrc_usr_print("  . Session %s\n", resume ? "resumed" : "established");
+#endif
 #else
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 	/*
@@ -599,9 +727,15 @@ int NetworkConnectTLS(Network *n, const char *addr, int po, Certs *certs)
 	n->my_socket = (int)(ssl);
 	n->mqttread = mqtt_ssl_read_all;
 	n->mqttwrite = mqtt_ssl_write_all;
+	n->mqttwritev = NULL;
 	n->disconnect = mqtt_ssl_disconnect;
 
 	return 0;
+
+fail:
+	mqtt_ssl_free(ssl);
+	vPortFree(ssl);
+	return ret;
 }
 
 int NetworkDisconnectTLS(Network* n)
@@ -44,6 +44,8 @@ struct Network
 	int my_socket;
 	int (*mqttread) (Network*, unsigned char*, int, int);
 	int (*mqttwrite) (Network*, unsigned char*, int, int);
+	/* Optional, writes a header and a payload in one go, NULL if the transport can't gather */
+	int (*mqttwritev) (Network*, unsigned char*, int, unsigned char*, int, int);
 	void (*disconnect) (Network*);
 };
 
@@ -71,6 +73,7 @@ int ThreadStart(Thread*, void (*fn)(void*), void* arg);
 
 int nrc_sock_read(Network*, unsigned char*, int, int);
 int nrc_sock_write(Network*, unsigned char*, int, int);
+int nrc_sock_writev(Network*, unsigned char*, int, unsigned char*, int, int);
 
 void NetworkInit(Network*);
 int NetworkConnect(Network*, char*, int);
@@ -0,0 +1,211 @@
+/*******************************************************************************
+ * Copyright (c) 2014, 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Allan Stockdill-Mander - initial API and implementation and/or initial documentation
+ *    Ian Craggs - return codes from linux_read
+ *******************************************************************************/
+
+#include "MQTTLinux.h"
+
+#include <sys/uio.h>
+
+void TimerInit(Timer* timer)
+{
+	timer->end_time = (struct timeval){0, 0};
+}
+
+char TimerIsExpired(Timer* timer)
+{
+	struct timeval now, res;
+	gettimeofday(&now, NULL);
+	timersub(&timer->end_time, &now, &res);
+	return res.tv_sec < 0 || (res.tv_sec == 0 && res.tv_usec <= 0);
+}
+
+
+void TimerCountdownMS(Timer* timer, unsigned int timeout)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	struct timeval interval = {timeout / 1000, (timeout % 1000) * 1000};
+	timeradd(&now, &interval, &timer->end_time);
+}
+
+
+void TimerCountdown(Timer* timer, unsigned int timeout)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	struct timeval interval = {timeout, 0};
+	timeradd(&now, &interval, &timer->end_time);
+}
+
+
+int TimerLeftMS(Timer* timer)
+{
+	struct timeval now, res;
+	gettimeofday(&now, NULL);
+	timersub(&timer->end_time, &now, &res);
+	return (res.tv_sec < 0) ? 0 : res.tv_sec * 1000 + res.tv_usec / 1000;
+}
+
+
+static int linux_wait(Network* n, int for_write, int timeout_ms)
+{
+	fd_set fdset;
+	struct timeval tv;
+
+	FD_ZERO(&fdset);
+	FD_SET(n->my_socket, &fdset);
+
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	if (for_write)
+		return select(n->my_socket + 1, NULL, &fdset, NULL, &tv);
+	return select(n->my_socket + 1, &fdset, NULL, NULL, &tv);
+}
+
+
+/* Same contract as nrc_sock_read: the bytes already received are
+ * read without a select(), which is only used to wait for more */
+int linux_read(Network* n, unsigned char* buffer, int len, int timeout_ms)
+{
+	int bytes = 0;
+	int rc;
+
+	rc = recv(n->my_socket, buffer, len, MSG_DONTWAIT);
+	if (rc > 0)
+		bytes = rc;
+	else if (rc == 0)
+		return -30;
+	else if (errno != EWOULDBLOCK && errno != EAGAIN)
+		return -10;
+	else
+	{
+		rc = linux_wait(n, 0, timeout_ms);
+		if (rc <= 0)
+			return (rc < 0) ? -10 : 0;
+	}
+
+	while (bytes < len)
+	{
+		rc = recv(n->my_socket, &buffer[bytes], (size_t)(len - bytes), 0);
+		if (rc <= 0)
+			return -30;
+		bytes += rc;
+	}
+	return bytes;
+}
+
+
+int linux_write(Network* n, unsigned char* buffer, int len, int timeout_ms)
+{
+	int rc = linux_wait(n, 1, timeout_ms);
+
+	if (rc <= 0)
+		return (rc < 0) ? -1 : 0;
+	return write(n->my_socket, buffer, len);
+}
+
+
+int linux_writev(Network* n, unsigned char* header, int header_len,
+	unsigned char* payload, int payload_len, int timeout_ms)
+{
+	struct iovec iov[2];
+	int rc = linux_wait(n, 1, timeout_ms);
+
+	if (rc <= 0)
+		return (rc < 0) ? -1 : 0;
+
+	iov[0].iov_base = header;
+	iov[0].iov_len = header_len;
+	iov[1].iov_base = payload;
+	iov[1].iov_len = payload_len;
+	return writev(n->my_socket, iov, 2);
+}
+
+
+void NetworkInit(Network* n)
+{
+	n->my_socket = -1;
+	n->mqttread = linux_read;
+	n->mqttwrite = linux_write;
+	n->mqttwritev = linux_writev;
+	n->disconnect = NULL;
+}
+
+
+int NetworkConnect(Network* n, char* addr, int port)
+{
+	int type = SOCK_STREAM;
+	struct sockaddr_in address;
+	int rc = -1;
+	sa_family_t family = AF_INET;
+	struct addrinfo *result = NULL;
+	struct addrinfo hints = {0, AF_UNSPEC, SOCK_STREAM, IPPROTO_TCP, 0, NULL, NULL, NULL};
+
+	if ((rc = getaddrinfo(addr, NULL, &hints, &result)) == 0)
+	{
+		struct addrinfo* res = result;
+
+		/* prefer ip4 addresses */
+		while (res)
+		{
+			if (res->ai_family == AF_INET)
+			{
+				result = res;
+				break;
+			}
+			res = res->ai_next;
+		}
+
+		if (result->ai_family == AF_INET)
+		{
+			address.sin_port = htons(port);
+			address.sin_family = family = AF_INET;
+			address.sin_addr = ((struct sockaddr_in*)(result->ai_addr))->sin_addr;
+		}
+		else
+			rc = -1;
+
+		freeaddrinfo(result);
+	}
+
+	if (rc == 0)
+	{
+		int opval = 1;
+
+		n->my_socket = socket(family, type, 0);
+		if (n->my_socket == -1)
+			return -1;
+		rc = connect(n->my_socket, (struct sockaddr*)&address, sizeof(address));
+		if (rc < 0)
+		{
+			close(n->my_socket);
+			n->my_socket = -1;
+			return -2;
+		}
+		setsockopt(n->my_socket, IPPROTO_TCP, TCP_NODELAY, &opval, sizeof(opval));
+	}
+
+	return rc;
+}
+
+
+int NetworkDisconnect(Network* n)
+{
+	close(n->my_socket);
+	n->my_socket = -1;
+	return 0;
+}
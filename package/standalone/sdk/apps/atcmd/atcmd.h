@@ -197,6 +197,7 @@ enum ATCMD_ID
 	ATCMD_BASIC_FW_DOWNLOAD,
 	ATCMD_BASIC_SF_USER,
 	ATCMD_BASIC_SF_SYS_USER,
+	ATCMD_BASIC_TLS_MFL,
 	ATCMD_BASIC_TIMEOUT,
 
 	ATCMD_BASIC_MAX,
@@ -272,6 +273,8 @@ enum ATCMD_ID
 	ATCMD_SOCKET_TCP_KEEPALIVE,
 	ATCMD_SOCKET_TCP_NODELAY,
 	ATCMD_SOCKET_TIMEOUT,
+	ATCMD_SOCKET_DTLS_PSK,
+	ATCMD_SOCKET_DTLS_CERT,
 
 	ATCMD_SOCKET_MAX,
 
@@ -311,6 +314,7 @@ enum ATCMD_DATA_TYPE
 	ATCMD_DATA_SSEND = 0,
 	ATCMD_DATA_FWBINDL,
 	ATCMD_DATA_SFUSER,
+	ATCMD_DATA_SDTLSCERT,
 
 	ATCMD_DATA_TYPE_MAX
 };
@@ -25,6 +25,9 @@
 
 
 #include "atcmd.h"
+#if defined(SUPPORT_MBEDTLS)
+#include "tls_max_frag.h"
+#endif
 
 
 /**********************************************************************************************/
@@ -1775,6 +1778,69 @@ static atcmd_info_t g_atcmd_basic_sf_sys_user =
 
 /**********************************************************************************************/
 
+#if defined(SUPPORT_MBEDTLS) && defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+
+static int _atcmd_basic_tls_mfl_get (int argc, char *argv[])
+{
+	switch (argc)
+	{
+		case 0:
+			ATCMD_MSG_INFO("TLSMFL", "%d", (int)tls_max_frag_get());
+			break;
+
+		default:
+			return ATCMD_ERROR_INVAL;
+	}
+
+	return ATCMD_SUCCESS;
+}
+
+static int _atcmd_basic_tls_mfl_set (int argc, char *argv[])
+{
+	switch (argc)
+	{
+		case 0:
+			ATCMD_MSG_HELP("AT+TLSMFL={0|512|1024|2048|4096}");
+			break;
+
+		case 1:
+		{
+			int len = atoi(argv[0]);
+
+			/* for the TLS connections made after it, FOTA over HTTPS */
+			if (len < 0 || tls_max_frag_set(len) != 0)
+				return ATCMD_ERROR_INVAL;
+
+			_atcmd_info("tls_mfl: %d", len);
+			break;
+		}
+
+		default:
+			return ATCMD_ERROR_INVAL;
+	}
+
+	return ATCMD_SUCCESS;
+}
+
+static atcmd_info_t g_atcmd_basic_tls_mfl =
+{
+	.list.next = NULL,
+	.list.prev = NULL,
+
+	.group = ATCMD_GROUP_BASIC,
+
+	.cmd = "TLSMFL",
+	.id = ATCMD_BASIC_TLS_MFL,
+
+	.handler[ATCMD_HANDLER_RUN] = NULL,
+	.handler[ATCMD_HANDLER_GET] = _atcmd_basic_tls_mfl_get,
+	.handler[ATCMD_HANDLER_SET] = _atcmd_basic_tls_mfl_set,
+};
+
+#endif /* #if defined(SUPPORT_MBEDTLS) && defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH) */
+
+/**********************************************************************************************/
+
 #define ATCMD_TIMEOUT_CMD_LEN_MAX		20
 
 typedef struct
@@ -2015,6 +2081,10 @@ static atcmd_info_t *g_atcmd_info_basic[] =
 	&g_atcmd_basic_sf_sys_user,
 #endif	
 
+#if defined(SUPPORT_MBEDTLS) && defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+	&g_atcmd_basic_tls_mfl,
+#endif
+
 /*	&g_atcmd_basic_timeout, */
 
 	NULL
@@ -506,6 +506,7 @@ static const char *str_data_type[ATCMD_DATA_TYPE_MAX] =
 	[ATCMD_DATA_SSEND] = "SSEND", 
 	[ATCMD_DATA_FWBINDL] = "FWBINDL",
    	[ATCMD_DATA_SFUSER] = "SFUSER",
+	[ATCMD_DATA_SDTLSCERT] = "SDTLSCERT",
 };
 
 void atcmd_data_mode_init_params (enum ATCMD_DATA_TYPE data_type, atcmd_data_mode_params_t *params)
@@ -574,6 +575,10 @@ int atcmd_data_mode_enable (atcmd_data_mode_params_t *params)
 		case ATCMD_DATA_SFUSER:
 			_atcmd_data_mode_debug(" - offset=%d", params->sf_user.offset);
 			break;
+#endif
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_DATA_SDTLSCERT:
+			break;
 #endif
 		default:
 			return -EINVAL;
@@ -701,6 +706,11 @@ static void atcmd_data_mode_timeout (uint32_t time)
 			atcmd_sf_user_write_event_idle(offset, send_len, cnt);
 			break;
 		}
+#endif
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_DATA_SDTLSCERT:
+			atcmd_socket_dtls_cert_event_idle(id, send_len, cnt);
+			break;
 #endif
 	}
 }
@@ -1598,6 +1608,14 @@ static int _atcmd_receive_data (enum ATCMD_DATA_TYPE data_type, int id, char *bu
 
 				return atcmd_sf_user_write(offset, len, buf);
 			}
+#endif
+#if defined(CONFIG_ATCMD_DTLS)
+			case ATCMD_DATA_SDTLSCERT:
+				/* A partial PEM on exit is dropped, not stored. */
+				if (len != data_mode_params->len)
+					break;
+
+				return atcmd_socket_dtls_cert_write(id, buf, len);
 #endif
 			default:
 				break;
@@ -1630,6 +1648,11 @@ static void _atcmd_receive_data_done (enum ATCMD_DATA_TYPE data_type, int id, ui
 			atcmd_sf_user_write_event_done(offset, done);
 			break;
 		}
+#endif
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_DATA_SDTLSCERT:
+			atcmd_socket_dtls_cert_event_done(id, done);
+			break;
 #endif
 		default:
 			break;
@@ -1659,6 +1682,11 @@ static void _atcmd_receive_data_drop (enum ATCMD_DATA_TYPE data_type, int id, ui
 			atcmd_sf_user_write_event_drop(offset, drop);
 			break;
 		}
+#endif
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_DATA_SDTLSCERT:
+			atcmd_socket_dtls_cert_event_drop(id, drop);
+			break;
 #endif
 		default:
 			break;
@@ -1689,6 +1717,11 @@ static void _atcmd_receive_data_exit (enum ATCMD_DATA_TYPE data_type,
 			atcmd_sf_user_write_event_fail(offset, len);
 			break;
 		}
+#endif
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_DATA_SDTLSCERT:
+			atcmd_socket_dtls_cert_event_fail(id, len);
+			break;
 #endif
 		default:
 			break;
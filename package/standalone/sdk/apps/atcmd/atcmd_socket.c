@@ -25,6 +25,9 @@
 
 
 #include "atcmd.h"
+#if defined(CONFIG_ATCMD_DTLS)
+#include "nvs.h"
+#endif
 
 
 /**********************************************************************************************/
@@ -39,8 +42,13 @@ static int _atcmd_socket_close (int id, int err);
 
 /**********************************************************************************************/
 
+#if defined(CONFIG_ATCMD_DTLS)
+static const char *str_proto[ATCMD_SOCKET_PROTO_NUM] = { "UDP", "TCP", "DTLS" };
+static const char *str_proto_lwr[ATCMD_SOCKET_PROTO_NUM] = { "udp", "tcp", "dtls" };
+#else
 static const char *str_proto[ATCMD_SOCKET_PROTO_NUM] = { "UDP", "TCP" };
 static const char *str_proto_lwr[ATCMD_SOCKET_PROTO_NUM] = { "udp", "tcp" };
+#endif
 
 //#define CONFIG_ATCMD_SOCKET_STATIC
 #ifdef CONFIG_ATCMD_SOCKET_STATIC
@@ -113,6 +121,42 @@ static struct
 	.data = { { 0, 0 }, { 0 , 0} }
 };
 
+#if defined(CONFIG_ATCMD_DTLS)
+#define ATCMD_SOCKET_DTLS_PSK_ID_LEN_MAX	64
+#define ATCMD_SOCKET_DTLS_PSK_LEN_MAX		MBEDTLS_PSK_MAX_LEN
+
+#define ATCMD_SOCKET_DTLS_CERT_LEN_MAX		(ATCMD_DATA_LEN_MAX - 1)
+
+/*
+ * AT+SDTLSPSK, certificates if psk_len is 0.
+ * AT+SDTLSCERT, PEM stored in NVS with the terminating NUL.
+ * Loaded on the first open and kept, so the parsed copies in tls_cert_store are reused.
+ */
+static struct
+{
+	char psk_identity[ATCMD_SOCKET_DTLS_PSK_ID_LEN_MAX + 1];
+	uint8_t psk[ATCMD_SOCKET_DTLS_PSK_LEN_MAX];
+	int psk_len;
+
+	struct
+	{
+		char *pem;
+		int len;
+	} cert[ATCMD_SOCKET_DTLS_CERT_NUM];
+} g_atcmd_socket_dtls =
+{
+	.psk_identity = { '\0', },
+	.psk_len = 0,
+	.cert = { { NULL, 0 }, },
+};
+
+static const char *str_dtls_cert[ATCMD_SOCKET_DTLS_CERT_NUM] = { "CA", "CRT", "KEY" };
+static const char *str_dtls_cert_nvs_key[ATCMD_SOCKET_DTLS_CERT_NUM] =
+{
+	"atcmd_dtls_ca", "atcmd_dtls_crt", "atcmd_dtls_key"
+};
+#endif
+
 /**********************************************************************************************/
 
 static void _atcmd_socket_print (atcmd_socket_t *socket)
@@ -127,6 +171,9 @@ static void _atcmd_socket_print (atcmd_socket_t *socket)
 	{
 		case ATCMD_SOCKET_PROTO_UDP:
 		case ATCMD_SOCKET_PROTO_TCP:
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_SOCKET_PROTO_DTLS:
+#endif
 			_atcmd_info(" - protocol : %s", str_proto_lwr[socket->protocol]);
 			break;
 
@@ -179,7 +226,7 @@ static atcmd_socket_t *_atcmd_socket_search (int id,
 		if (id >= 0 && id != socket->id)
 			continue;
 
-		if (protocol == ATCMD_SOCKET_PROTO_UDP || protocol == ATCMD_SOCKET_PROTO_TCP)
+		if (protocol >= ATCMD_SOCKET_PROTO_UDP && protocol < ATCMD_SOCKET_PROTO_NUM)
 			if (protocol != socket->protocol)
 				continue;
 
@@ -300,6 +347,45 @@ static int _atcmd_socket_event_handler (int type, int id, ...)
 			break;
 		}
 
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_SOCKET_EVENT_DTLSCERT_IDLE:
+		{
+			uint32_t length = va_arg(ap, uint32_t);
+			uint32_t count = va_arg(ap, uint32_t);
+
+			_atcmd_info("SEVENT: DTLSCERT_IDLE, type=%d length=%u count=%u", id, length, count);
+			ATCMD_MSG_SEVENT("\"DTLSCERT_IDLE\",%d,%u,%u", id, length, count);
+			break;
+		}
+
+		case ATCMD_SOCKET_EVENT_DTLSCERT_DROP:
+		{
+			uint32_t length = va_arg(ap, uint32_t);
+
+			_atcmd_info("SEVENT: DTLSCERT_DROP, type=%d length=%u", id, length);
+			ATCMD_MSG_SEVENT("\"DTLSCERT_DROP\",%d,%u", id, length);
+			break;
+		}
+
+		case ATCMD_SOCKET_EVENT_DTLSCERT_FAIL:
+		{
+			uint32_t length = va_arg(ap, uint32_t);
+
+			_atcmd_info("SEVENT: DTLSCERT_FAIL, type=%d length=%u", id, length);
+			ATCMD_MSG_SEVENT("\"DTLSCERT_FAIL\",%d,%u", id, length);
+			break;
+		}
+
+		case ATCMD_SOCKET_EVENT_DTLSCERT_DONE:
+		{
+			uint32_t length = va_arg(ap, uint32_t);
+
+			_atcmd_info("SEVENT: DTLSCERT_DONE, type=%d length=%u", id, length);
+			ATCMD_MSG_SEVENT("\"DTLSCERT_DONE\",%d,%u", id, length);
+			break;
+		}
+#endif
+
 		default:
 			_atcmd_info("SEVENT: invalid type (%d)", type);
 			ret = -1;
@@ -418,6 +504,10 @@ static int __atcmd_socket_send_data (atcmd_socket_t *socket, char *data, int len
 	{
 		if (socket->protocol == ATCMD_SOCKET_PROTO_TCP)
 			ret = _lwip_socket_send_tcp(socket->id, data + i, len - i);
+#if defined(CONFIG_ATCMD_DTLS)
+		else if (socket->protocol == ATCMD_SOCKET_PROTO_DTLS)
+			ret = _lwip_socket_send_dtls(socket->id, data + i, len - i);
+#endif
 		else
 			ret = _lwip_socket_send_udp(socket->id, &socket->remote_addr, socket->remote_port,
 										data + i, len - i, netif);
@@ -513,6 +603,9 @@ static int _atcmd_socket_send_data (atcmd_socket_t *socket, char *data, int len,
 	{
 		case ATCMD_SOCKET_PROTO_UDP:
 		case ATCMD_SOCKET_PROTO_TCP:
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_SOCKET_PROTO_DTLS:
+#endif
 			_str_proto = str_proto[socket->protocol];
 			_str_proto_lwr = str_proto_lwr[socket->protocol];
 			break;
@@ -682,6 +775,13 @@ static int __atcmd_socket_recv_handler (int id, int len, bool passive)
 			ret = _lwip_socket_recv_tcp(id, rxd->buf.data, len);
 			break;
 
+#if defined(CONFIG_ATCMD_DTLS)
+		case ATCMD_SOCKET_PROTO_DTLS:
+			/* len 0: a datagram with no data for the host, a handshake record or an alert */
+			ret = _lwip_socket_recv_dtls(id, rxd->buf.data, len > 0 ? len : sizeof(rxd->buf.data));
+			break;
+#endif
+
 		default:
 			_atcmd_error("invalid, protocol=%d", socket->protocol);
 			ret = -EPROTOTYPE;
@@ -774,7 +874,7 @@ static void _atcmd_socket_recv_handler (int id)
 				else
 					ret = __atcmd_socket_recv_handler(id, len - i, false);
 
-				if (ret < 0)
+				if (ret <= 0)
 					break;
 			}
 		}
@@ -842,6 +942,122 @@ static int _atcmd_socket_deinit (void)
 	return _lwip_socket_deinit();
 }
 
+#if defined(CONFIG_ATCMD_DTLS)
+static int _atcmd_socket_dtls_cert_load (int type, char **pem, int *len)
+{
+	nvs_handle_t handle;
+	size_t size = 0;
+	char *buf = NULL;
+	int ret = -ENOENT;
+
+	*pem = NULL;
+	*len = 0;
+
+	if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READONLY, &handle) != NVS_OK)
+		return -ENOENT;
+
+	if (nvs_get_blob(handle, str_dtls_cert_nvs_key[type], NULL, &size) == NVS_OK && size > 0)
+	{
+		buf = _atcmd_malloc(size);
+		if (!buf)
+			ret = -ENOMEM;
+		else if (nvs_get_blob(handle, str_dtls_cert_nvs_key[type], buf, &size) != NVS_OK ||
+					buf[size - 1] != '\0')
+		{
+			_atcmd_free(buf);
+			ret = -EIO;
+		}
+		else
+		{
+			*pem = buf;
+			*len = size;
+			ret = 0;
+		}
+	}
+
+	nvs_close(handle);
+
+	return ret;
+}
+
+static int _atcmd_socket_dtls_cert_save (int type, const char *pem, int len)
+{
+	nvs_handle_t handle;
+	nvs_err_t err;
+
+	if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &handle) != NVS_OK)
+		return -EIO;
+
+	if (pem && len > 0)
+		err = nvs_set_blob(handle, str_dtls_cert_nvs_key[type], pem, len);
+	else
+	{
+		err = nvs_erase_key(handle, str_dtls_cert_nvs_key[type]);
+		if (err == NVS_ERR_NVS_NOT_FOUND)
+			err = NVS_OK;
+	}
+
+	if (err == NVS_OK)
+		err = nvs_commit(handle);
+
+	nvs_close(handle);
+
+	return err == NVS_OK ? 0 : -EIO;
+}
+
+static int _atcmd_socket_dtls_auth (lwip_socket_dtls_auth_t *auth)
+{
+	int i;
+
+	memset(auth, 0, sizeof(lwip_socket_dtls_auth_t));
+
+	if (g_atcmd_socket_dtls.psk_len > 0)
+	{
+		auth->psk_identity = g_atcmd_socket_dtls.psk_identity;
+		auth->psk = g_atcmd_socket_dtls.psk;
+		auth->psk_len = g_atcmd_socket_dtls.psk_len;
+
+		return 0;
+	}
+
+	/* Certificates provisioned by AT+SDTLSCERT only, there is no built-in fallback. */
+	for (i = 0 ; i < ATCMD_SOCKET_DTLS_CERT_NUM ; i++)
+	{
+		if (g_atcmd_socket_dtls.cert[i].pem)
+			continue;
+
+		if (_atcmd_socket_dtls_cert_load(i, &g_atcmd_socket_dtls.cert[i].pem,
+										&g_atcmd_socket_dtls.cert[i].len) == -ENOMEM)
+		{
+			_atcmd_info("dtls_auth: no memory");
+			return -ENOMEM;
+		}
+	}
+
+	if (!g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_CA].pem)
+	{
+		_atcmd_info("dtls_auth: no CA certificate");
+		return -ENOENT;
+	}
+
+	if (!g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_CRT].pem !=
+			!g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_KEY].pem)
+	{
+		_atcmd_info("dtls_auth: client certificate and key not paired");
+		return -ENOENT;
+	}
+
+	auth->ca_cert = g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_CA].pem;
+	auth->ca_cert_len = g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_CA].len;
+	auth->client_cert = g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_CRT].pem;
+	auth->client_cert_len = g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_CRT].len;
+	auth->client_key = g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_KEY].pem;
+	auth->client_key_len = g_atcmd_socket_dtls.cert[ATCMD_SOCKET_DTLS_CERT_KEY].len;
+
+	return 0;
+}
+#endif
+
 static int _atcmd_socket_open (atcmd_socket_t *socket, bool ipv6, bool reuse_addr)
 {
 	int i;
@@ -914,6 +1130,18 @@ static int _atcmd_socket_open (atcmd_socket_t *socket, bool ipv6, bool reuse_add
 			if (timeout_msec == 0)
 				timeout_msec = 30 * 1000;
 
+#if defined(CONFIG_ATCMD_DTLS)
+			if (socket->protocol == ATCMD_SOCKET_PROTO_DTLS)
+			{
+				lwip_socket_dtls_auth_t auth;
+
+				ret = _atcmd_socket_dtls_auth(&auth);
+				if (ret == 0)
+					ret = _lwip_socket_open_dtls_client(&id, &socket->remote_addr, socket->remote_port,
+												timeout_msec, ipv6, reuse_addr, &auth);
+			}
+			else
+#endif
 			ret = _lwip_socket_open_tcp_client(&id, &socket->remote_addr, socket->remote_port,
 												timeout_msec, ipv6, reuse_addr);
 			if (ret == 0)
@@ -1011,7 +1239,7 @@ static int __atcmd_socket_open_set (int argc, char *argv[], enum ATCMD_SOCKET_PR
 		case 3:
 			param_reuse_addr = argv[2];
 
-		case 2: /* tcp client */
+		case 2: /* tcp/dtls client */
 		{
 			char str_server_addr[ATCMD_MSG_LEN_MAX];
 			char *param_server_addr = argv[0];
@@ -1059,6 +1287,11 @@ static int __atcmd_socket_open_set (int argc, char *argv[], enum ATCMD_SOCKET_PR
 		{
 			char *param_local_port = argv[0];
 
+#if defined(CONFIG_ATCMD_DTLS)
+			if (proto == ATCMD_SOCKET_PROTO_DTLS)
+				return -EINVAL;
+#endif
+
 			socket.local_port = atoi(param_local_port);
 			if (!_atcmd_socket_valid_port(socket.local_port))
 				return -EINVAL;
@@ -1105,6 +1338,9 @@ static int _atcmd_socket_open_set (int argc, char *argv[])
 			ATCMD_MSG_HELP("AT+SOPEN=\"udp\",<local_port>[,<reuse_addr>]");
 			ATCMD_MSG_HELP("AT+SOPEN=\"tcp\",<local_port>[,<reuse_addr>]");
 			ATCMD_MSG_HELP("AT+SOPEN=\"tcp\",\"<server_address>\",<server_port>[,<reuse_addr>]");
+#if defined(CONFIG_ATCMD_DTLS)
+			ATCMD_MSG_HELP("AT+SOPEN=\"dtls\",\"<server_address>\",<server_port>[,<reuse_addr>]");
+#endif
 			break;
 
 #ifdef CONFIG_ATCMD_IPV6
@@ -1118,7 +1354,7 @@ static int _atcmd_socket_open_set (int argc, char *argv[])
 		case 3:
 		case 2:
 		{
-			char str_protocol[ATCMD_STR_SIZE(3)];
+			char str_protocol[ATCMD_STR_SIZE(4)];
 
 			param_protocol = argv[0];
 
@@ -1130,6 +1366,10 @@ static int _atcmd_socket_open_set (int argc, char *argv[])
 					proto = ATCMD_SOCKET_PROTO_UDP;
 				else if (strcmp(str_protocol, "tcp") == 0 || strcmp(str_protocol, "TCP") == 0)
 					proto = ATCMD_SOCKET_PROTO_TCP;
+#if defined(CONFIG_ATCMD_DTLS)
+				else if (strcmp(str_protocol, "dtls") == 0 || strcmp(str_protocol, "DTLS") == 0)
+					proto = ATCMD_SOCKET_PROTO_DTLS;
+#endif
 				else
 					return ATCMD_ERROR_INVAL;
 
@@ -1184,6 +1424,9 @@ static int _atcmd_socket_open6_set (int argc, char *argv[])
 			ATCMD_MSG_HELP("AT+SOPEN6=\"udp\",<local_port>[,<reuse_addr>]");
 			ATCMD_MSG_HELP("AT+SOPEN6=\"tcp\",<local_port>[,<reuse_addr>]");
 			ATCMD_MSG_HELP("AT+SOPEN6=\"tcp\",\"<server_address>\",server_port>[,<reuse_addr>]");
+#if defined(CONFIG_ATCMD_DTLS)
+			ATCMD_MSG_HELP("AT+SOPEN6=\"dtls\",\"<server_address>\",server_port>[,<reuse_addr>]");
+#endif
 			break;
 
 		case 4:
@@ -2303,6 +2546,218 @@ static atcmd_info_t g_atcmd_socket_timeout =
 
 /**********************************************************************************************/
 
+#if defined(CONFIG_ATCMD_DTLS)
+
+static int _atcmd_socket_dtls_psk_get (int argc, char *argv[])
+{
+	switch (argc)
+	{
+		case 0:
+			ATCMD_MSG_INFO("SDTLSPSK", "\"%s\"",
+						g_atcmd_socket_dtls.psk_len > 0 ? g_atcmd_socket_dtls.psk_identity : "");
+			break;
+
+		default:
+			return ATCMD_ERROR_INVAL;
+	}
+
+	return ATCMD_SUCCESS;
+}
+
+static int _atcmd_socket_dtls_psk_set (int argc, char *argv[])
+{
+	switch (argc)
+	{
+		case 0:
+			ATCMD_MSG_HELP("AT+SDTLSPSK=\"<identity>\",\"<key_hex>\"");
+			ATCMD_MSG_HELP("AT+SDTLSPSK=\"\"");
+			break;
+
+		case 1: /* certificates */
+			if (strcmp(argv[0], "\"\"") != 0)
+				return ATCMD_ERROR_INVAL;
+
+			memset(g_atcmd_socket_dtls.psk, 0, sizeof(g_atcmd_socket_dtls.psk));
+			g_atcmd_socket_dtls.psk_identity[0] = '\0';
+			g_atcmd_socket_dtls.psk_len = 0;
+			break;
+
+		case 2:
+		{
+			char identity[ATCMD_STR_SIZE(ATCMD_SOCKET_DTLS_PSK_ID_LEN_MAX)];
+			char key[ATCMD_STR_SIZE(ATCMD_SOCKET_DTLS_PSK_LEN_MAX * 2)];
+			uint8_t psk[ATCMD_SOCKET_DTLS_PSK_LEN_MAX];
+			int len;
+			int i;
+
+			if (!atcmd_param_to_str(argv[0], identity, sizeof(identity)) || strlen(identity) == 0)
+				return ATCMD_ERROR_INVAL;
+
+			if (!atcmd_param_to_str(argv[1], key, sizeof(key)))
+				return ATCMD_ERROR_INVAL;
+
+			len = strlen(key);
+			if (len == 0 || (len % 2) != 0)
+				return ATCMD_ERROR_INVAL;
+
+			for (i = 0 ; i < len ; i += 2)
+			{
+				char byte[2 + 2 + 1] = { '0', 'x', key[i], key[i + 1], '\0' };
+				uint32_t val;
+
+				if (atcmd_param_to_hex(byte, &val) != 0)
+					return ATCMD_ERROR_INVAL;
+
+				psk[i / 2] = val;
+			}
+
+			strcpy(g_atcmd_socket_dtls.psk_identity, identity);
+			memcpy(g_atcmd_socket_dtls.psk, psk, len / 2);
+			g_atcmd_socket_dtls.psk_len = len / 2;
+			break;
+		}
+
+		default:
+			return ATCMD_ERROR_INVAL;
+	}
+
+	return ATCMD_SUCCESS;
+}
+
+static atcmd_info_t g_atcmd_socket_dtls_psk =
+{
+	.list.next = NULL,
+	.list.prev = NULL,
+
+	.group = ATCMD_GROUP_SOCKET,
+
+	.cmd = "DTLSPSK",
+	.id = ATCMD_SOCKET_DTLS_PSK,
+
+	.handler[ATCMD_HANDLER_RUN] = NULL,
+	.handler[ATCMD_HANDLER_GET] = _atcmd_socket_dtls_psk_get,
+	.handler[ATCMD_HANDLER_SET] = _atcmd_socket_dtls_psk_set,
+};
+
+/**********************************************************************************************/
+
+static int _atcmd_socket_dtls_cert_get (int argc, char *argv[])
+{
+	switch (argc)
+	{
+		case 0:
+		{
+			nvs_handle_t handle;
+			bool opened;
+			int i;
+
+			opened = (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READONLY, &handle) == NVS_OK);
+
+			for (i = 0 ; i < ATCMD_SOCKET_DTLS_CERT_NUM ; i++)
+			{
+				size_t size = 0;
+
+				if (!opened || nvs_get_blob(handle, str_dtls_cert_nvs_key[i], NULL, &size) != NVS_OK)
+					size = 0;
+
+				ATCMD_MSG_INFO("SDTLSCERT", "%d,\"%s\",%d", i, str_dtls_cert[i], (int)(size > 0 ? size - 1 : 0));
+			}
+
+			if (opened)
+				nvs_close(handle);
+			break;
+		}
+
+		default:
+			return ATCMD_ERROR_INVAL;
+	}
+
+	return ATCMD_SUCCESS;
+}
+
+static int _atcmd_socket_dtls_cert_set (int argc, char *argv[])
+{
+	switch (argc)
+	{
+		case 0:
+			ATCMD_MSG_HELP("AT+SDTLSCERT=<type>,<length>");
+			ATCMD_MSG_HELP("AT+SDTLSCERT=<type>,0");
+			ATCMD_MSG_HELP("  <type> 0:CA 1:client certificate 2:client key, PEM");
+			break;
+
+		case 2:
+		{
+			int type = atoi(argv[0]);
+			int length = atoi(argv[1]);
+
+			if (type < 0 || type >= ATCMD_SOCKET_DTLS_CERT_NUM)
+				return ATCMD_ERROR_INVAL;
+
+			if (length < 0 || length > ATCMD_SOCKET_DTLS_CERT_LEN_MAX)
+				return ATCMD_ERROR_INVAL;
+
+			if (length == 0)
+			{
+				_atcmd_info("dtls_cert_erase: %s", str_dtls_cert[type]);
+
+				if (_atcmd_socket_dtls_cert_save(type, NULL, 0) != 0)
+					return ATCMD_ERROR_FAIL;
+
+				if (g_atcmd_socket_dtls.cert[type].pem)
+				{
+					_atcmd_free(g_atcmd_socket_dtls.cert[type].pem);
+					g_atcmd_socket_dtls.cert[type].pem = NULL;
+					g_atcmd_socket_dtls.cert[type].len = 0;
+				}
+			}
+			else
+			{
+				atcmd_data_mode_params_t data_mode_params;
+
+				_atcmd_info("dtls_cert_write: %s length=%d", str_dtls_cert[type], length);
+
+				atcmd_data_mode_init_params(ATCMD_DATA_SDTLSCERT, &data_mode_params);
+
+				data_mode_params.id = type;
+				data_mode_params.len = length;
+				data_mode_params.timeout = 1000;
+				data_mode_params.done_event = true;
+
+				if (atcmd_data_mode_enable(&data_mode_params) != 0)
+				{
+					_atcmd_info("dtls_cert_write: failed");
+					return ATCMD_ERROR_FAIL;
+				}
+			}
+			break;
+		}
+
+		default:
+			return ATCMD_ERROR_INVAL;
+	}
+
+	return ATCMD_SUCCESS;
+}
+
+static atcmd_info_t g_atcmd_socket_dtls_cert =
+{
+	.list.next = NULL,
+	.list.prev = NULL,
+
+	.group = ATCMD_GROUP_SOCKET,
+
+	.cmd = "DTLSCERT",
+	.id = ATCMD_SOCKET_DTLS_CERT,
+
+	.handler[ATCMD_HANDLER_RUN] = NULL,
+	.handler[ATCMD_HANDLER_GET] = _atcmd_socket_dtls_cert_get,
+	.handler[ATCMD_HANDLER_SET] = _atcmd_socket_dtls_cert_set,
+};
+
+#endif /* #if defined(CONFIG_ATCMD_DTLS) */
+
+/**********************************************************************************************/
+
 static atcmd_group_t g_atcmd_group_socket =
 {
 	.list.next = NULL,
@@ -2336,6 +2791,10 @@ static atcmd_info_t *g_atcmd_info_socket[] =
 	&g_atcmd_socket_tcp_keepalive,
 	&g_atcmd_socket_tcp_nodelay,
 	&g_atcmd_socket_timeout,
+#if defined(CONFIG_ATCMD_DTLS)
+	&g_atcmd_socket_dtls_psk,
+	&g_atcmd_socket_dtls_cert,
+#endif
 
 	NULL
 };
@@ -2392,6 +2851,18 @@ void atcmd_socket_disable (void)
 
 	atcmd_group_unregister(ATCMD_GROUP_SOCKET);
 
+#if defined(CONFIG_ATCMD_DTLS)
+	for (i = 0 ; i < ATCMD_SOCKET_DTLS_CERT_NUM ; i++)
+	{
+		if (g_atcmd_socket_dtls.cert[i].pem)
+		{
+			_atcmd_free(g_atcmd_socket_dtls.cert[i].pem);
+			g_atcmd_socket_dtls.cert[i].pem = NULL;
+			g_atcmd_socket_dtls.cert[i].len = 0;
+		}
+	}
+#endif
+
 	_atcmd_free(g_atcmd_socket_rxd);
 	_atcmd_free(g_atcmd_socket);
 }
@@ -2428,6 +2899,67 @@ void atcmd_socket_event_send_exit (int id, uint32_t done, uint32_t drop)
 	_atcmd_socket_event_handler(ATCMD_SOCKET_EVENT_SEND_EXIT, id, done, drop);
 }
 
+#if defined(CONFIG_ATCMD_DTLS)
+int atcmd_socket_dtls_cert_write (int type, char *data, int len)
+{
+	char *pem;
+
+	if (type < 0 || type >= ATCMD_SOCKET_DTLS_CERT_NUM)
+		return 0;
+
+	if (len <= 11 || len > ATCMD_SOCKET_DTLS_CERT_LEN_MAX || strncmp(data, "-----BEGIN ", 11) != 0)
+	{
+		_atcmd_info("dtls_cert_write: %s not PEM", str_dtls_cert[type]);
+		return 0;
+	}
+
+	pem = _atcmd_malloc(len + 1);
+	if (!pem)
+	{
+		_atcmd_info("dtls_cert_write: no memory");
+		return 0;
+	}
+
+	memcpy(pem, data, len);
+	pem[len] = '\0';
+
+	if (_atcmd_socket_dtls_cert_save(type, pem, len + 1) != 0)
+	{
+		_atcmd_info("dtls_cert_write: %s nvs failed", str_dtls_cert[type]);
+		_atcmd_free(pem);
+		return 0;
+	}
+
+	if (g_atcmd_socket_dtls.cert[type].pem)
+		_atcmd_free(g_atcmd_socket_dtls.cert[type].pem);
+
+	g_atcmd_socket_dtls.cert[type].pem = pem;
+	g_atcmd_socket_dtls.cert[type].len = len + 1;
+
+	return len;
+}
+
+void atcmd_socket_dtls_cert_event_idle (int type, uint32_t length, uint32_t count)
+{
+	_atcmd_socket_event_handler(ATCMD_SOCKET_EVENT_DTLSCERT_IDLE, type, length, count);
+}
+
+void atcmd_socket_dtls_cert_event_drop (int type, uint32_t length)
+{
+	_atcmd_socket_event_handler(ATCMD_SOCKET_EVENT_DTLSCERT_DROP, type, length);
+}
+
+void atcmd_socket_dtls_cert_event_fail (int type, uint32_t length)
+{
+	_atcmd_socket_event_handler(ATCMD_SOCKET_EVENT_DTLSCERT_FAIL, type, length);
+}
+
+void atcmd_socket_dtls_cert_event_done (int type, uint32_t length)
+{
+	_atcmd_socket_event_handler(ATCMD_SOCKET_EVENT_DTLSCERT_DONE, type, length);
+}
+#endif
+
 /**********************************************************************************************/
 
 #if defined(CONFIG_ATCMD_CLI)
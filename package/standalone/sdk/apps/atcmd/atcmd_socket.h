@@ -45,6 +45,9 @@ enum ATCMD_SOCKET_PROTO
 
 	ATCMD_SOCKET_PROTO_UDP = 0,
 	ATCMD_SOCKET_PROTO_TCP,
+#if defined(CONFIG_ATCMD_DTLS)
+	ATCMD_SOCKET_PROTO_DTLS, /* DTLS 1.2 client over UDP */
+#endif
 
 	ATCMD_SOCKET_PROTO_NUM,
 
@@ -62,7 +65,24 @@ enum ATCMD_SOCKET_EVENT
 	ATCMD_SOCKET_EVENT_SEND_ERROR,
 	ATCMD_SOCKET_EVENT_RECV_READY,
 	ATCMD_SOCKET_EVENT_RECV_ERROR,
+#if defined(CONFIG_ATCMD_DTLS)
+	ATCMD_SOCKET_EVENT_DTLSCERT_IDLE,
+	ATCMD_SOCKET_EVENT_DTLSCERT_DROP,
+	ATCMD_SOCKET_EVENT_DTLSCERT_FAIL,
+	ATCMD_SOCKET_EVENT_DTLSCERT_DONE,
+#endif
+};
+
+#if defined(CONFIG_ATCMD_DTLS)
+enum ATCMD_SOCKET_DTLS_CERT
+{
+	ATCMD_SOCKET_DTLS_CERT_CA = 0,
+	ATCMD_SOCKET_DTLS_CERT_CRT,
+	ATCMD_SOCKET_DTLS_CERT_KEY,
+
+	ATCMD_SOCKET_DTLS_CERT_NUM
 };
+#endif
 
 typedef char atcmd_socket_ipaddr_t[ATCMD_SOCKET_IPADDR_LEN_MAX + 1];
 
@@ -110,6 +130,15 @@ extern void atcmd_socket_event_send_idle (int id, uint32_t done, uint32_t drop,
 extern void atcmd_socket_event_send_drop (int id, uint32_t drop);
 extern void atcmd_socket_event_send_exit (int id, uint32_t done, uint32_t drop);
 
+#if defined(CONFIG_ATCMD_DTLS)
+extern int atcmd_socket_dtls_cert_write (int type, char *data, int len);
+
+extern void atcmd_socket_dtls_cert_event_idle (int type, uint32_t length, uint32_t count);
+extern void atcmd_socket_dtls_cert_event_drop (int type, uint32_t length);
+extern void atcmd_socket_dtls_cert_event_fail (int type, uint32_t length);
+extern void atcmd_socket_dtls_cert_event_done (int type, uint32_t length);
+#endif
+
 /**********************************************************************************************/
 #endif /* #ifndef __NRC_ATCMD_SOCKET_H__ */
 
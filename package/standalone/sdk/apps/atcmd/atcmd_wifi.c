@@ -2494,6 +2494,57 @@ static void _atcmd_wifi_connect_update_ap_info (void)
 	}
 }
 
+/*
+ * Limits the scan to the channel of the last AP joined with this SSID, if it is
+ * in the scan list. The list is saved to scan_freq, n_scan_freq is 0 if it was full.
+ */
+static bool _atcmd_wifi_connect_fast (atcmd_wifi_ssid_t ssid, uint16_t scan_freq[], uint8_t *n_scan_freq)
+{
+	atcmd_wifi_connect_t *connect = &g_atcmd_wifi_info->connect;
+	atcmd_wifi_channels_t *channels = &g_atcmd_wifi_info->supported_channels;
+	uint16_t nons1g_freq = 0;
+	int i;
+
+	if (connect->hint.s1g_freq == 0 || strlen(ssid) == 0 || strcmp(ssid, connect->hint.ssid) != 0)
+		return false;
+
+	for (i = 0 ; i < channels->n_channel ; i++)
+	{
+		if (channels->channel[i].s1g_freq == connect->hint.s1g_freq)
+		{
+			nons1g_freq = channels->channel[i].nons1g_freq;
+			break;
+		}
+	}
+
+	if (nons1g_freq == 0)
+		return false;
+
+	if (wifi_api_get_scan_freq(scan_freq, n_scan_freq) != 0)
+		*n_scan_freq = 0;
+	else if (*n_scan_freq > WIFI_CHANNEL_NUM_MAX)
+		return false;
+
+	if (*n_scan_freq == 1)
+		return false;
+
+	for (i = 0 ; i < *n_scan_freq ; i++)
+	{
+		if (scan_freq[i] == nons1g_freq)
+			break;
+	}
+
+	if (*n_scan_freq > 0 && i == *n_scan_freq)
+		return false;
+
+	if (wifi_api_set_scan_freq(&nons1g_freq, 1) != 0)
+		return false;
+
+	_atcmd_info("wifi_connect: fast, %.1f", connect->hint.s1g_freq / 10.);
+
+	return true;
+}
+
 static int _atcmd_wifi_connect (atcmd_wifi_bssid_t bssid, atcmd_wifi_ssid_t ssid, 
 								atcmd_wifi_security_t security, atcmd_wifi_password_t password, 
 								bool event_poll)
@@ -2502,6 +2553,9 @@ static int _atcmd_wifi_connect (atcmd_wifi_bssid_t bssid, atcmd_wifi_ssid_t ssid
 	atcmd_wifi_bgscan_t *bgscan = &g_atcmd_wifi_info->bgscan;
 	uint32_t timeout_msec = _atcmd_timeout_value("WCONN");
 	bool connection_timeout = false;
+	uint16_t scan_freq[WIFI_CHANNEL_NUM_MAX];
+	uint8_t n_scan_freq = 0;
+	bool fast;
 	int sae_pwe;
 
 /*	_atcmd_debug("wifi_connect: event_poll=%d net_id=%d", event_poll, net_id); */
@@ -2544,6 +2598,8 @@ static int _atcmd_wifi_connect (atcmd_wifi_bssid_t bssid, atcmd_wifi_ssid_t ssid
 	if (wifi_api_set_security(security, password, sae_pwe) != 0)
 		goto wifi_connect_fail;
 
+	fast = _atcmd_wifi_connect_fast(ssid, scan_freq, &n_scan_freq);
+
 	connect->connected = false;
 	connect->connecting = true;
 	connect->disconnecting = false;
@@ -2559,16 +2615,37 @@ static int _atcmd_wifi_connect (atcmd_wifi_bssid_t bssid, atcmd_wifi_ssid_t ssid
 		_atcmd_wifi_event_polled(ATCMD_WIFI_EVT_CONNECT_SUCCESS);
 	}
 
-	switch (wifi_api_connect(timeout_msec))
+	wifi_api_start_conn_time();
+
+	if (fast)
 	{
-		case 0:
-			break;
+		if (wifi_api_connect(ATCMD_WIFI_FAST_CONNECT_TIMEOUT) != 0)
+		{
+			_atcmd_info("wifi_connect: fast, not found");
 
-		case 1:
-			connection_timeout = true;
+			wifi_api_disconnect(_atcmd_timeout_value("WDISCONN"));
+			wifi_api_start_conn_time();
 
-		default:
-			goto wifi_connect_fail;
+			connect->hint.s1g_freq = 0;
+			fast = false;
+		}
+
+		wifi_api_set_scan_freq(n_scan_freq > 0 ? scan_freq : NULL, n_scan_freq);
+	}
+
+	if (!fast)
+	{
+		switch (wifi_api_connect(timeout_msec))
+		{
+			case 0:
+				break;
+
+			case 1:
+				connection_timeout = true;
+
+			default:
+				goto wifi_connect_fail;
+		}
 	}
 
 	if (connect->connecting)
@@ -2608,6 +2685,24 @@ static int _atcmd_wifi_connect (atcmd_wifi_bssid_t bssid, atcmd_wifi_ssid_t ssid
 
 	strcpy(connect->password, password);
 
+	{
+		wifi_ap_info_t ap_info;
+		wifi_conn_time_t time;
+
+		if (wifi_api_get_ap_info(&ap_info) == 0)
+		{
+			strcpy(connect->hint.ssid, ap_info.ssid);
+			connect->hint.s1g_freq = ap_info.channel.freq;
+		}
+
+		if (wifi_api_get_conn_time(&time) == 0)
+		{
+			_atcmd_info("wifi_connect: %s, scan=%u(%u) auth=%u assoc=%u 4way=%u msec",
+						fast ? "fast" : "full", time.scan, time.n_scan,
+						time.auth, time.assoc, time.key);
+		}
+	}
+
 	_atcmd_info("wifi_connect: done");
 
 	ATCMD_WIFI_UNLOCK();
@@ -3258,6 +3353,7 @@ static int _atcmd_wifi_dhcp_run (int argc, char *argv[])
 	bool task_run = (argc == 0) ? false : true;
 	atcmd_wifi_connect_t *connect = &g_atcmd_wifi_info->connect;
 	uint32_t timeout_msec = _atcmd_timeout_value("WDHCP");
+	uint32_t start_msec;
 	int ret;
 
 	if (!connect->connected)
@@ -3273,6 +3369,8 @@ static int _atcmd_wifi_dhcp_run (int argc, char *argv[])
 	if (task_run)
 		ATCMD_MSG_WEVENT("\"DHCP_START\"");
 
+	start_msec = atcmd_sys_now();
+
 	switch (wifi_api_start_dhcp_client(timeout_msec, event_cb))
 	{
 		case DHCP_RECOVERY:
@@ -3281,7 +3379,7 @@ static int _atcmd_wifi_dhcp_run (int argc, char *argv[])
 			break;
 
 		case DHCP_SUCCESS:
-			_atcmd_info("wifi_dhcp: success");
+			_atcmd_info("wifi_dhcp: success, %u msec", atcmd_sys_now() - start_msec);
 			ret = ATCMD_SUCCESS;
 			break;
 
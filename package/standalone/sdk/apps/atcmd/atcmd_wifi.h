@@ -75,6 +75,8 @@
 #define ATCMD_WIFI_BSS_MAX_IDLE_RETRY_MIN	3
 #define ATCMD_WIFI_BSS_MAX_IDLE_RETRY_MAX	100
 
+#define ATCMD_WIFI_FAST_CONNECT_TIMEOUT		5000 /* msec */
+
 
 /*
  * RSSI
@@ -178,6 +180,13 @@ typedef struct
 	atcmd_wifi_bssid_t bssid;
 	atcmd_wifi_security_t security;
 	atcmd_wifi_password_t password;
+
+	/* AP of the last connection, scanned first on the next one */
+	struct
+	{
+		atcmd_wifi_ssid_t ssid;
+		uint16_t s1g_freq;
+	} hint;
 } atcmd_wifi_connect_t;
 
 typedef struct
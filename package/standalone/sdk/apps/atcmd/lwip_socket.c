@@ -28,9 +28,23 @@
 #include "lwip_socket.h"
 #include "lwip/netdb.h"
 
+#if defined(CONFIG_ATCMD_DTLS)
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/timing.h"
+#include "mbedtls/net_sockets.h"
+#include "tls_session_cache.h"
+#include "tls_cert_store.h"
+#include "tls_max_frag.h"
+#endif
+
 
 static lwip_socket_info_t *g_lwip_socket_info = NULL;
 
+#if defined(CONFIG_ATCMD_DTLS)
+static void _lwip_socket_dtls_free (struct lwip_socket_dtls *dtls);
+#endif
+
 /**********************************************************************************************/
 
 static int __lwip_socket_error (const char *func, const int line, int _errno_)
@@ -802,6 +816,18 @@ int _lwip_socket_deinit (void)
 
 	vTaskDelete(info->task);
 
+#if defined(CONFIG_ATCMD_DTLS)
+	{
+		int fd;
+
+		for (fd = 0 ; fd < FD_SETSIZE ; fd++)
+		{
+			if (info->dtls[fd])
+				_lwip_socket_dtls_free(info->dtls[fd]);
+		}
+	}
+#endif
+
 	if (info->send_done_event)
 		vEventGroupDelete(info->send_done_event);
 
@@ -938,6 +964,414 @@ int _lwip_socket_get_local (int fd, ip_addr_t *ipaddr, uint16_t *port)
 	return _lwip_socket_get_info(fd, ipaddr, port, false);
 }
 
+/**********************************************************************************************/
+
+#if defined(CONFIG_ATCMD_DTLS)
+
+/*
+ * DTLS 1.2 client on a connected UDP socket. The handshake is done in
+ * _lwip_socket_open_dtls_client(), before the socket task selects the
+ * socket: the records that follow are read by _lwip_socket_recv_dtls() when
+ * the task reports the socket readable, one datagram at a time.
+ *
+ * The session of a handshake is kept by server address and port
+ * (tls_session_cache.h), so that the next socket to the server resumes it
+ * in one round trip.
+ */
+
+#define LWIP_SOCKET_DTLS_MTU			1472 /* 1500 - IPv4 - UDP, see __lwip_socket_send() */
+#define LWIP_SOCKET_DTLS_TIMEOUT_MIN	1000 /* msec, first retransmission of a flight */
+
+typedef struct lwip_socket_dtls
+{
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_config conf;
+	mbedtls_entropy_context entropy;
+	mbedtls_ctr_drbg_context ctr_drbg;
+	mbedtls_timing_delay_context timer;
+
+	/* shared, see tls_cert_store.h */
+	mbedtls_x509_crt *ca_cert;
+	mbedtls_x509_crt *client_cert;
+	mbedtls_pk_context *client_key;
+
+	int fd;
+	bool handshake;
+	char host[IPADDR_STRLEN_MAX];
+	uint16_t port;
+} lwip_socket_dtls_t;
+
+static const int g_lwip_socket_dtls_psk_ciphersuites[] =
+{
+	MBEDTLS_TLS_PSK_WITH_AES_128_CCM_8,
+	MBEDTLS_TLS_PSK_WITH_AES_128_GCM_SHA256,
+	MBEDTLS_TLS_PSK_WITH_AES_128_CBC_SHA256,
+	0
+};
+
+static lwip_socket_dtls_t *_lwip_socket_dtls_get (int fd)
+{
+	lwip_socket_info_t *info = g_lwip_socket_info;
+
+	if (!info || fd < 0 || fd >= FD_SETSIZE)
+		return NULL;
+
+	return info->dtls[fd];
+}
+
+static int _lwip_socket_dtls_bio_send (void *ctx, const unsigned char *buf, size_t len)
+{
+	lwip_socket_dtls_t *dtls = (lwip_socket_dtls_t *)ctx;
+	int ret;
+
+	ret = send(dtls->fd, buf, len, MSG_DONTWAIT);
+	if (ret >= 0)
+		return ret;
+
+	switch (errno)
+	{
+		case EAGAIN:
+		case ENOBUFS:
+			return MBEDTLS_ERR_SSL_WANT_WRITE;
+
+		default:
+			return MBEDTLS_ERR_NET_SEND_FAILED;
+	}
+}
+
+static int _lwip_socket_dtls_bio_recv (void *ctx, unsigned char *buf, size_t len)
+{
+	lwip_socket_dtls_t *dtls = (lwip_socket_dtls_t *)ctx;
+	int ret;
+
+	ret = recv(dtls->fd, buf, len, MSG_DONTWAIT);
+	if (ret >= 0)
+		return ret;
+
+	switch (errno)
+	{
+		case EAGAIN:
+			return MBEDTLS_ERR_SSL_WANT_READ;
+
+		default:
+			return MBEDTLS_ERR_NET_RECV_FAILED;
+	}
+}
+
+static int _lwip_socket_dtls_bio_recv_timeout (void *ctx, unsigned char *buf, size_t len,
+											uint32_t timeout_ms)
+{
+	lwip_socket_dtls_t *dtls = (lwip_socket_dtls_t *)ctx;
+	struct timeval timeout;
+	fd_set fds;
+	int ret;
+
+	FD_ZERO(&fds);
+	FD_SET(dtls->fd, &fds);
+
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+	ret = select(dtls->fd + 1, &fds, NULL, NULL, (timeout_ms == 0) ? NULL : &timeout);
+	if (ret == 0)
+		return MBEDTLS_ERR_SSL_TIMEOUT;
+	else if (ret < 0)
+		return MBEDTLS_ERR_NET_RECV_FAILED;
+
+	return _lwip_socket_dtls_bio_recv(ctx, buf, len);
+}
+
+static void _lwip_socket_dtls_free (lwip_socket_dtls_t *dtls)
+{
+	if (!dtls->handshake)
+		mbedtls_ssl_close_notify(&dtls->ssl);
+
+	mbedtls_ssl_free(&dtls->ssl);
+	mbedtls_ssl_config_free(&dtls->conf);
+	mbedtls_ctr_drbg_free(&dtls->ctr_drbg);
+	mbedtls_entropy_free(&dtls->entropy);
+
+	tls_cert_store_put_crt(dtls->ca_cert);
+	tls_cert_store_put_crt(dtls->client_cert);
+	tls_cert_store_put_key(dtls->client_key);
+
+	_lwip_socket_mfree(dtls);
+}
+
+static int _lwip_socket_dtls_setup (lwip_socket_dtls_t *dtls, const lwip_socket_dtls_auth_t *auth,
+									int timeout_msec)
+{
+	int ret;
+
+	ret = mbedtls_ctr_drbg_seed(&dtls->ctr_drbg, mbedtls_entropy_func, &dtls->entropy,
+								(const unsigned char *)"atcmd_dtls", 10);
+	if (ret != 0)
+		return ret;
+
+	ret = mbedtls_ssl_config_defaults(&dtls->conf, MBEDTLS_SSL_IS_CLIENT,
+						MBEDTLS_SSL_TRANSPORT_DATAGRAM, MBEDTLS_SSL_PRESET_DEFAULT);
+	if (ret != 0)
+		return ret;
+
+	mbedtls_ssl_conf_rng(&dtls->conf, mbedtls_ctr_drbg_random, &dtls->ctr_drbg);
+	mbedtls_ssl_conf_handshake_timeout(&dtls->conf, LWIP_SOCKET_DTLS_TIMEOUT_MIN, timeout_msec);
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+	/* the record size set with AT+TLSMFL, as for the TLS clients */
+	tls_max_frag_conf(&dtls->conf);
+#endif
+
+	if (auth->psk_len > 0)
+	{
+		mbedtls_ssl_conf_ciphersuites(&dtls->conf, g_lwip_socket_dtls_psk_ciphersuites);
+
+		ret = mbedtls_ssl_conf_psk(&dtls->conf, auth->psk, auth->psk_len,
+								(const unsigned char *)auth->psk_identity,
+								strlen(auth->psk_identity));
+		if (ret != 0)
+			return ret;
+	}
+	else
+	{
+		dtls->ca_cert = tls_cert_store_get_crt((const unsigned char *)auth->ca_cert,
+											auth->ca_cert_len, &ret);
+		if (!dtls->ca_cert)
+			return ret;
+
+		mbedtls_ssl_conf_authmode(&dtls->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+		mbedtls_ssl_conf_ca_chain(&dtls->conf, dtls->ca_cert, NULL);
+
+		if (auth->client_cert && auth->client_key)
+		{
+			dtls->client_cert = tls_cert_store_get_crt((const unsigned char *)auth->client_cert,
+												auth->client_cert_len, &ret);
+			if (!dtls->client_cert)
+				return ret;
+
+			dtls->client_key = tls_cert_store_get_key((const unsigned char *)auth->client_key,
+												auth->client_key_len, NULL, 0, &ret);
+			if (!dtls->client_key)
+				return ret;
+
+			ret = mbedtls_ssl_conf_own_cert(&dtls->conf, dtls->client_cert, dtls->client_key);
+			if (ret != 0)
+				return ret;
+		}
+	}
+
+	ret = mbedtls_ssl_setup(&dtls->ssl, &dtls->conf);
+	if (ret != 0)
+		return ret;
+
+	/* no IP fragments: the handshake messages are split to fit */
+	mbedtls_ssl_set_mtu(&dtls->ssl, LWIP_SOCKET_DTLS_MTU);
+
+	mbedtls_ssl_set_bio(&dtls->ssl, dtls, _lwip_socket_dtls_bio_send,
+						NULL, _lwip_socket_dtls_bio_recv_timeout);
+	mbedtls_ssl_set_timer_cb(&dtls->ssl, &dtls->timer,
+						mbedtls_timing_set_delay, mbedtls_timing_get_delay);
+
+	return 0;
+}
+
+static int _lwip_socket_dtls_handshake (lwip_socket_dtls_t *dtls)
+{
+	int resumed = 0;
+	int ret;
+
+#if defined(NRC_TLS_SESSION_CACHE)
+	tls_session_cache_set(&dtls->ssl, dtls->host, dtls->port);
+#endif
+
+	dtls->handshake = true;
+
+	do {
+		ret = mbedtls_ssl_handshake(&dtls->ssl);
+	} while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+
+	if (ret != 0)
+	{
+#if defined(NRC_TLS_SESSION_CACHE)
+		tls_session_cache_remove(dtls->host, dtls->port);
+#endif
+		return ret;
+	}
+
+	dtls->handshake = false;
+
+#if defined(NRC_TLS_SESSION_CACHE)
+	resumed = tls_session_cache_update(&dtls->ssl, dtls->host, dtls->port);
+#endif
+
+	_lwip_socket_log("SOCK_DTLS: fd=%d %s,%u %s, %s", dtls->fd, dtls->host, dtls->port,
+					mbedtls_ssl_get_ciphersuite(&dtls->ssl), resumed ? "resumed" : "full handshake");
+
+	/* records are read when the socket task reports them */
+	mbedtls_ssl_set_bio(&dtls->ssl, dtls, _lwip_socket_dtls_bio_send,
+						_lwip_socket_dtls_bio_recv, NULL);
+
+	return 0;
+}
+
+int _lwip_socket_open_dtls_client (int *fd, ip_addr_t *remote_addr, uint16_t remote_port,
+								int timeout_msec, bool ipv6, bool reuse_addr,
+								const lwip_socket_dtls_auth_t *auth)
+{
+	lwip_socket_info_t *info = g_lwip_socket_info;
+	lwip_socket_dtls_t *dtls;
+	int ret;
+
+	if (!info)
+		return _lwip_socket_error(EPERM);
+
+	if (!fd || !remote_addr || !remote_port || !auth)
+		return _lwip_socket_error(EINVAL);
+
+	if (auth->psk_len == 0 && !auth->ca_cert)
+		return _lwip_socket_error(EINVAL);
+
+	*fd = socket((ipv6 ? AF_INET6 : AF_INET), SOCK_DGRAM, IPPROTO_UDP);
+	if (*fd < 0)
+		return _lwip_socket_error(errno);
+
+	if (*fd >= FD_SETSIZE)
+	{
+		ret = _lwip_socket_error(EMFILE);
+		goto _lwip_socket_open_dtls_fail;
+	}
+
+	ret = _lwip_socket_set_reuse_addr(*fd, reuse_addr);
+	if (ret < 0)
+		goto _lwip_socket_open_dtls_fail;
+
+	/* the datagrams of the server only */
+	ret = _lwip_socket_connect(*fd, remote_addr, remote_port, timeout_msec, ipv6);
+	if (ret < 0)
+		goto _lwip_socket_open_dtls_fail;
+
+	dtls = _lwip_socket_malloc(sizeof(lwip_socket_dtls_t));
+	if (!dtls)
+	{
+		ret = _lwip_socket_error(ENOMEM);
+		goto _lwip_socket_open_dtls_fail;
+	}
+
+	memset(dtls, 0, sizeof(lwip_socket_dtls_t));
+
+	mbedtls_ssl_init(&dtls->ssl);
+	mbedtls_ssl_config_init(&dtls->conf);
+	mbedtls_entropy_init(&dtls->entropy);
+	mbedtls_ctr_drbg_init(&dtls->ctr_drbg);
+
+	dtls->fd = *fd;
+	dtls->handshake = true;
+	dtls->port = remote_port;
+	ipaddr_ntoa_r(remote_addr, dtls->host, sizeof(dtls->host));
+
+	ret = _lwip_socket_dtls_setup(dtls, auth, timeout_msec);
+	if (ret == 0)
+		ret = _lwip_socket_dtls_handshake(dtls);
+
+	if (ret != 0)
+	{
+		_lwip_socket_log("SOCK_DTLS: fd=%d %s,%u mbedtls_err=-0x%X",
+						*fd, dtls->host, dtls->port, -ret);
+
+		_lwip_socket_dtls_free(dtls);
+
+		ret = _lwip_socket_error(ret == MBEDTLS_ERR_SSL_TIMEOUT ? ETIMEDOUT : ECONNREFUSED);
+		goto _lwip_socket_open_dtls_fail;
+	}
+
+	info->dtls[*fd] = dtls;
+
+	_lwip_socket_fds_set(info, *fd, false);
+
+	return 0;
+
+_lwip_socket_open_dtls_fail:
+
+	close(*fd);
+	*fd = -1;
+
+	return ret;
+}
+
+int _lwip_socket_send_dtls (int fd, char *data, int len)
+{
+	lwip_socket_dtls_t *dtls = _lwip_socket_dtls_get(fd);
+	int ret;
+
+	if (!dtls)
+		return _lwip_socket_error(EBADF);
+
+	if (!data || !len)
+		return _lwip_socket_error(EINVAL);
+
+	/* one datagram a record, of at most the MTU: the caller sends the rest */
+	ret = mbedtls_ssl_get_max_out_record_payload(&dtls->ssl);
+	if (ret > 0 && len > ret)
+		len = ret;
+
+	ret = mbedtls_ssl_write(&dtls->ssl, (const unsigned char *)data, len);
+	if (ret >= 0)
+		return ret;
+
+	switch (ret)
+	{
+		case MBEDTLS_ERR_SSL_WANT_READ:
+		case MBEDTLS_ERR_SSL_WANT_WRITE:
+			return _lwip_socket_error(EAGAIN);
+
+		case MBEDTLS_ERR_NET_SEND_FAILED:
+			return _lwip_socket_error(errno);
+
+		default:
+			_lwip_socket_log("SOCK_DTLS: fd=%d send, mbedtls_err=-0x%X", fd, -ret);
+			return _lwip_socket_error(EIO);
+	}
+}
+
+int _lwip_socket_recv_dtls (int fd, char *data, int len)
+{
+	lwip_socket_dtls_t *dtls = _lwip_socket_dtls_get(fd);
+	int ret;
+
+	if (!dtls)
+		return _lwip_socket_error(EBADF);
+
+	if (!data)
+		return _lwip_socket_error(EINVAL);
+
+	/*
+	 * A datagram may also hold a retransmission of the last flight of the
+	 * server, that mbedTLS answers, or a record it drops: no data then.
+	 */
+	ret = mbedtls_ssl_read(&dtls->ssl, (unsigned char *)data, len);
+	if (ret > 0)
+		return ret;
+
+	switch (ret)
+	{
+		case MBEDTLS_ERR_SSL_WANT_READ:
+		case MBEDTLS_ERR_SSL_WANT_WRITE:
+		case MBEDTLS_ERR_SSL_TIMEOUT:
+			return _lwip_socket_error(EAGAIN);
+
+		case 0:
+		case MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY:
+			return _lwip_socket_error(ECONNRESET);
+
+		case MBEDTLS_ERR_NET_RECV_FAILED:
+			return _lwip_socket_error(errno);
+
+		default:
+			_lwip_socket_log("SOCK_DTLS: fd=%d recv, mbedtls_err=-0x%X", fd, -ret);
+			return _lwip_socket_error(EIO);
+	}
+}
+
+#endif /* #if defined(CONFIG_ATCMD_DTLS) */
+
 int _lwip_socket_close (int fd)
 {
 	if (g_lwip_socket_info)
@@ -946,6 +1380,14 @@ int _lwip_socket_close (int fd)
 
 		_lwip_socket_fds_clear(g_lwip_socket_info, fd);
 
+#if defined(CONFIG_ATCMD_DTLS)
+		if (_lwip_socket_dtls_get(fd))
+		{
+			_lwip_socket_dtls_free(g_lwip_socket_info->dtls[fd]);
+			g_lwip_socket_info->dtls[fd] = NULL;
+		}
+#endif
+
 		ret = close(fd);
 		if (ret < 0)
 			return _lwip_socket_error(errno);
@@ -1192,6 +1634,16 @@ int _lwip_socket_recv_len (int fd)
 	int len;
 	int ret;
 
+#if defined(CONFIG_ATCMD_DTLS)
+	/* the rest of a record already read, else the size of the next datagram */
+	if (_lwip_socket_dtls_get(fd))
+	{
+		len = mbedtls_ssl_get_bytes_avail(&g_lwip_socket_info->dtls[fd]->ssl);
+		if (len > 0)
+			return len;
+	}
+#endif
+
 	ret = _lwip_socket_get_recvlen(fd, &len);
 	if (ret == 0)
 		return len;
@@ -34,6 +34,14 @@
 #define _lwip_socket_mfree				_atcmd_free
 #define _lwip_socket_log(fmt, ...)		_atcmd_info(fmt, ##__VA_ARGS__)
 
+#if defined(CONFIG_ATCMD_DTLS)
+#include "mbedtls/ssl.h"
+/* the DTLS build of mbedTLS and the certificates shared by port/tls_cert_store.c */
+#if !defined(MBEDTLS_SSL_PROTO_DTLS) || !defined(NRC_TLS_CERT_STORE)
+#undef CONFIG_ATCMD_DTLS
+#endif
+#endif
+
 /**********************************************************************************************/
 
 /*
@@ -82,6 +90,28 @@ typedef struct
 	void (*tcp_connect) (int fd, ip_addr_t *remote_addr, uint16_t remote_port);
 } lwip_socket_cb_t;
 
+#if defined(CONFIG_ATCMD_DTLS)
+/*
+ * Credentials of a DTLS client: a pre-shared key if psk_len is not 0,
+ * certificates otherwise. The buffers are PEM, lengths including the NUL.
+ */
+typedef struct
+{
+	const char *psk_identity;
+	const uint8_t *psk;
+	size_t psk_len;
+
+	const char *ca_cert;
+	size_t ca_cert_len;
+	const char *client_cert;
+	size_t client_cert_len;
+	const char *client_key;
+	size_t client_key_len;
+} lwip_socket_dtls_auth_t;
+
+struct lwip_socket_dtls;
+#endif
+
 typedef struct
 {
 	TaskHandle_t task;
@@ -117,6 +147,10 @@ typedef struct
 		char name[32];
 		char addr[16];
 	} addrinfo;
+
+#if defined(CONFIG_ATCMD_DTLS)
+	struct lwip_socket_dtls *dtls[FD_SETSIZE];
+#endif
 } lwip_socket_info_t;
 
 /**********************************************************************************************/
@@ -138,6 +172,14 @@ extern int _lwip_socket_open_tcp_client (int *fd, ip_addr_t *remote_addr, uint16
 								int timeout_msec, bool ipv6, bool reuse_addr);
 extern int _lwip_socket_close (int fd);
 
+#if defined(CONFIG_ATCMD_DTLS)
+extern int _lwip_socket_open_dtls_client (int *fd, ip_addr_t *remote_addr, uint16_t remote_port,
+								int timeout_msec, bool ipv6, bool reuse_addr,
+								const lwip_socket_dtls_auth_t *auth);
+extern int _lwip_socket_send_dtls (int fd, char *data, int len);
+extern int _lwip_socket_recv_dtls (int fd, char *data, int len);
+#endif
+
 extern int _lwip_socket_get_peer (int fd, ip_addr_t *ipaddr, uint16_t *port);
 extern int _lwip_socket_get_local (int fd, ip_addr_t *ipaddr, uint16_t *port);
 
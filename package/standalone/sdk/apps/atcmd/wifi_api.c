@@ -32,6 +32,7 @@
 #include "lwip/dhcp.h"
 #include "netif/bridgeif.h"
 #include "driver_nrc.h"
+#include "ctrl_iface_freeRTOS.h"
 
 
 int vif_id_ap = 0;
@@ -958,6 +959,30 @@ int wifi_api_disconnect (uint32_t timeout)
 	}
 }
 
+void wifi_api_start_conn_time (void)
+{
+	wpas_conn_time_start(vif_id_sta);
+}
+
+int wifi_api_get_conn_time (wifi_conn_time_t *time)
+{
+	ctrl_iface_conn_time_t t;
+
+	if (!time)
+		return -EINVAL;
+
+	if (!wpas_conn_time_get(vif_id_sta, &t))
+		return -1;
+
+	time->scan = t.scan_ms;
+	time->auth = t.auth_ms;
+	time->assoc = t.assoc_ms;
+	time->key = t.key_ms;
+	time->n_scan = t.scans;
+
+	return 0;
+}
+
 int wifi_api_get_ap_info (wifi_ap_info_t *info)
 {
 	AP_INFO ap;
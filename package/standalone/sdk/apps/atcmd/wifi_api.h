@@ -118,6 +118,15 @@ typedef struct
 /*	char password[STR_WIFI_PASSWORD_LEN_MAX + 1]; */
 } wifi_ap_info_t;
 
+typedef struct
+{
+	uint32_t scan;
+	uint32_t auth;
+	uint32_t assoc;
+	uint32_t key;
+	uint8_t n_scan;
+} wifi_conn_time_t;
+
 typedef void (*wifi_event_cb_t) (int, void *, int);
 typedef void (*wifi_wps_cb_t) (enum WPS_STATUS, int, ...);
 
@@ -210,6 +219,9 @@ extern int wifi_api_set_sae_pwe (int sae_pwe, bool ap);
 extern int wifi_api_connect (uint32_t timeout);
 extern int wifi_api_disconnect (uint32_t timeout);
 
+extern void wifi_api_start_conn_time (void);
+extern int wifi_api_get_conn_time (wifi_conn_time_t *time);
+
 extern int wifi_api_get_ap_info (wifi_ap_info_t *info);
 
 extern int wifi_api_get_ip4_address (char *address, char *netmask, char *gateway);
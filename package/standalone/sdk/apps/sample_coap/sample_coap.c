@@ -0,0 +1,279 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include "nrc_sdk.h"
+#include "nrc_coap.h"
+#include "wifi_config_setup.h"
+#include "wifi_connect_common.h"
+#include "nvs.h"
+#include "nvs_config.h"
+
+//#define USE_COAPS
+//#define USE_COAP_NON
+//#define USE_COAP_FOTA
+
+#define SERVER_IP   "10.198.1.214"
+
+#if defined( SUPPORT_MBEDTLS ) && defined( USE_COAPS )
+#define SERVER_PORT COAPS_DEFAULT_PORT
+#else
+#define SERVER_PORT COAP_DEFAULT_PORT
+#endif
+
+#define REPORT_PATH "halow/11ah/coap/sample/mytopic"
+#define FW_PATH     "fw"
+
+#define GET_IP_RETRY_MAX 10
+#define CONNECTION_RETRY_MAX 3
+#define SET_DEFAULT_SCAN_CHANNEL_THRESHOLD 1
+
+#if defined( SUPPORT_MBEDTLS ) && defined( USE_COAPS )
+/* the key of the identity on the DTLS server */
+static const uint8_t psk_key[] = {
+	0x4e, 0x52, 0x43, 0x2d, 0x31, 0x31, 0x61, 0x68,
+	0x2d, 0x63, 0x6f, 0x61, 0x70, 0x2d, 0x70, 0x73,
+};
+static const coap_psk_t psk = { psk_key, sizeof(psk_key), "nrc_11ah_coap_test" };
+#endif
+
+static nvs_handle_t nvs_handle;
+
+static void message_arrived(void *arg, uint8_t code, int32_t seq, const uint8_t *payload, size_t len)
+{
+	nrc_usr_print("Notification %d.%02d (seq %d) on %s: %.*s\n", COAP_CODE_CLASS(code),
+		COAP_CODE_DETAIL(code), seq, REPORT_PATH, (int)len, payload);
+}
+
+#if defined( USE_COAP_FOTA )
+static int fw_arrived(void *arg, uint32_t offset, const uint8_t *data, size_t len, int last)
+{
+	if (nrc_fota_write(offset, (uint8_t *)data, len) != NRC_SUCCESS)
+		return -1;
+	if (last)
+		nrc_usr_print("[%s] %d bytes in the FOTA area\n", __func__, offset + len);
+	return 0;
+}
+#endif
+
+static nrc_err_t connect_to_ap(WIFI_CONFIG *param)
+{
+	uint8_t retry_cnt = 0;
+
+	nrc_usr_print("[%s] Sample App for Wi-Fi  \n",__func__);
+
+	/* set initial wifi configuration */
+	wifi_init(param);
+	param->dhcp_timeout = GET_IP_RETRY_MAX;
+
+	/* connect to AP */
+	while(1) {
+		if (wifi_connect(param)== WIFI_SUCCESS) {
+			nrc_usr_print ("[%s] connect to %s successfully !! \n", __func__, param->ssid);
+			break;
+		} else {
+			nrc_usr_print ("[%s] Fail for connection %s\n", __func__, param->ssid);
+			if (retry_cnt > CONNECTION_RETRY_MAX) {
+				nrc_usr_print("(connect) Exceeded retry limit (%d). Run sw_reset\n", CONNECTION_RETRY_MAX);
+				nrc_sw_reset();
+				return NRC_FAIL;
+			} else if(retry_cnt == SET_DEFAULT_SCAN_CHANNEL_THRESHOLD){
+				if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &nvs_handle) == NVS_OK) {
+					nrc_usr_print("[%s] NVS_WIFI_CHANNEL:%d...\n", __func__, 0);
+					nvs_set_u16(nvs_handle, NVS_WIFI_CHANNEL, 0);
+					nrc_set_default_scan_channel(param);
+					nvs_close(nvs_handle);
+				}
+			}
+			_delay_ms(1000);
+			retry_cnt++;
+		}
+	}
+
+	/* check if IP is ready */
+	if (nrc_wait_for_ip(0, param->dhcp_timeout) == NRC_FAIL) {
+		nrc_usr_print("(Get IP) Exceeded retry limit (%d). Run sw_reset\n", GET_IP_RETRY_MAX);
+		nrc_sw_reset();
+	}
+
+	nrc_usr_print("[%s] Device is online connected to %s\n",__func__, param->ssid);
+	return NRC_SUCCESS;
+}
+
+/******************************************************************************
+ * FunctionName : run_sample_coap
+ * Description  : sample test for coap
+ * Parameters   : WIFI_CONFIG
+ * Returns      : 0 or -1 (0: success, -1: fail)
+ *******************************************************************************/
+nrc_err_t run_sample_coap(WIFI_CONFIG *param)
+{
+	int count = 10;
+	int interval = 1000;
+	int message_count = 0;
+	uint32_t channel = 0;
+	coap_ctx_t *coap;
+	coap_req_t req;
+	coap_resp_t resp;
+	coap_stats_t stats;
+	int observe;
+	int i, rc;
+
+	nrc_usr_print("[%s] Sample App for CoAP \n",__func__);
+
+	if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READONLY, &nvs_handle) == NVS_OK) {
+		nvs_get_u16(nvs_handle, NVS_WIFI_CHANNEL, (uint16_t*)&channel);
+		nrc_usr_print("[%s] channel:%d...\n", __func__, channel);
+		if(channel){
+			param->scan_freq_list[0] = channel;
+			param->scan_freq_num = 1;
+		}
+	}
+
+	if (connect_to_ap(param) == NRC_SUCCESS) {
+		AP_INFO ap_info;
+		if (nrc_wifi_get_ap_info(0, &ap_info) == WIFI_SUCCESS) {
+			if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &nvs_handle) == NVS_OK) {
+				nrc_usr_print("[%s] ap_info.freq:%d\n", __func__, ap_info.freq);
+				nvs_set_u16(nvs_handle, NVS_WIFI_CHANNEL, ap_info.freq);
+				nvs_close(nvs_handle);
+			}
+		}
+	}
+
+#if defined( SUPPORT_MBEDTLS ) && defined( USE_COAPS )
+	coap = coap_client_open(SERVER_IP, SERVER_PORT, &psk, &rc);
+#else
+	coap = coap_client_open(SERVER_IP, SERVER_PORT, NULL, &rc);
+#endif
+	if (coap == NULL) {
+		nrc_usr_print("Return code from CoAP open is %d\n", rc);
+		return NRC_FAIL;
+	}
+	nrc_usr_print("[%s] CoAP endpoint to %s:%d\n", __func__, SERVER_IP, SERVER_PORT);
+
+	/* the reports of all the devices, as the MQTT sample subscribes to its topic */
+	memset(&req, 0, sizeof(req));
+	req.method = COAP_METHOD_GET;
+	req.confirmable = 1;
+	req.path = REPORT_PATH;
+	req.content_format = COAP_FORMAT_NONE;
+	if ((observe = coap_observe(coap, &req, message_arrived, NULL)) < 0)
+		nrc_usr_print("Return code from CoAP observe is %d\n", observe);
+
+	for(i=0; i<count; i++) {
+		char payload[35];
+
+		sprintf(payload, "message count %d", ++message_count);
+		memset(&req, 0, sizeof(req));
+		req.method = COAP_METHOD_POST;
+#if defined( USE_COAP_NON )
+		/* one datagram a report, nothing back */
+		req.confirmable = 0;
+		req.no_response = COAP_NO_RESPONSE_2XX;
+#else
+		req.confirmable = 1;
+#endif
+		req.path = REPORT_PATH;
+		req.content_format = COAP_FORMAT_TEXT;
+		req.payload = (const uint8_t *)payload;
+		req.payload_len = strlen(payload);
+		memset(&resp, 0, sizeof(resp));
+
+		if ((rc = coap_request(coap, &req, &resp)) != COAP_RET_OK)
+			nrc_usr_print("Return code from CoAP request is %d\n", rc);
+		else if (resp.code && resp.code != COAP_CODE_CHANGED)
+			nrc_usr_print("Response to the report is %d.%02d\n",
+				COAP_CODE_CLASS(resp.code), COAP_CODE_DETAIL(resp.code));
+
+		/* notifications in the meantime */
+		coap_poll(coap, interval);
+	}
+
+#if defined( USE_COAP_FOTA )
+	/*
+	 * The image in blocks of 256 bytes, fewer MAC fragments at a low MCS.
+	 * nrc_fota_set_info() and nrc_fota_update_done() apply it, see sample_fota.
+	 */
+	if (nrc_fota_is_support() && nrc_fota_erase() == NRC_SUCCESS) {
+		coap_set_block_size(coap, 256);
+		memset(&req, 0, sizeof(req));
+		req.method = COAP_METHOD_GET;
+		req.confirmable = 1;
+		req.path = FW_PATH;
+		req.content_format = COAP_FORMAT_NONE;
+		memset(&resp, 0, sizeof(resp));
+		resp.data_cb = fw_arrived;
+		if ((rc = coap_request(coap, &req, &resp)) != COAP_RET_OK)
+			nrc_usr_print("Return code from CoAP block-wise GET is %d\n", rc);
+	}
+#endif
+
+	if (observe >= 0 && (rc = coap_observe_cancel(coap, observe)) != COAP_RET_OK)
+		nrc_usr_print("Return code from CoAP observe cancel is %d\n", rc);
+
+	coap_get_stats(coap, &stats);
+	nrc_usr_print("[%s] %d datagrams sent (%d bytes), %d received (%d bytes), %d retransmitted\n",
+		__func__, stats.tx_datagrams, stats.tx_bytes, stats.rx_datagrams, stats.rx_bytes,
+		stats.retransmissions);
+	if (stats.handshakes)
+		nrc_usr_print("[%s] DTLS handshake: %d bytes\n", __func__, stats.handshake_bytes);
+	coap_close(coap);
+	nrc_usr_print("[%s] CoAP endpoint closed\n", __func__);
+
+	if (nrc_wifi_get_state(0) == WIFI_STATE_CONNECTED) {
+		nrc_usr_print("[%s] Trying to DISCONNECT... for exit\n",__func__);
+		if (nrc_wifi_disconnect(0, 5000) != WIFI_SUCCESS) {
+			nrc_usr_print ("[%s] Fail for Wi-Fi disconnection\n", __func__);
+			return NRC_FAIL;
+		}
+	}
+
+	nrc_usr_print("[%s] exit \n",__func__);
+	return NRC_SUCCESS;
+}
+
+/******************************************************************************
+ * FunctionName : user_init
+ * Description  : Start Code for User Application, Initialize User function
+ * Parameters   : none
+ * Returns      : none
+ *******************************************************************************/
+WIFI_CONFIG wifi_config;
+WIFI_CONFIG* param = &wifi_config;
+
+void user_init(void)
+{
+	nrc_err_t ret;
+	nrc_uart_console_enable(true);
+
+	if(param == NULL)
+		return;
+	memset(param, 0x0, WIFI_CONFIG_SIZE);
+	nrc_wifi_set_config(param);
+
+	ret = run_sample_coap(param);
+	nrc_usr_print("[%s] test result!! %s \n",__func__, (ret==0) ?  "Success" : "Fail");
+}
@@ -29,10 +29,35 @@
 #define BUFFER_SIZE	256
 // #define VALUE_PARSING 1
 
+#define ARENA_SIZE	1024
+#define CHUNK_SIZE	64
+
+static int print_json_chunk(void *ctx, const char *data, size_t len)
+{
+	nrc_usr_print("%.*s", (int)len, data);
+	return 0;
+}
+
 static void parsing_json_data(char *data)
 {
 	char *out = NULL;
-	cJSON *root = cJSON_Parse(data);
+	char chunk[CHUNK_SIZE];
+	cJSON_Arena arena;
+	cJSON *root = NULL;
+
+	/*
+	 * Parse in place into a single arena block: strings stay in data and
+	 * the whole document goes away with cJSON_ArenaFree().
+	 */
+	if (!cJSON_ArenaInit(&arena, NULL, ARENA_SIZE))
+		return;
+
+	root = cJSON_ParseInSitu(&arena, data);
+	if (!root) {
+		nrc_usr_print("JSON parse error\n");
+		cJSON_ArenaFree(&arena);
+		return;
+	}
 
 #if VALUE_PARSING
 	out = cJSON_Print(cJSON_GetObjectItem(root, "pc"));
@@ -48,10 +73,11 @@ static void parsing_json_data(char *data)
 	nrc_mem_free(out);
 #endif /* VALUE_PARSING */
 
-	out = cJSON_Print(root);
-	nrc_usr_print("%s\n", out);
-	cJSON_Delete(root);
-	nrc_mem_free(out);
+	/* Print without building the whole text in memory */
+	cJSON_PrintStream(root, 1, chunk, sizeof(chunk), print_json_chunk, NULL);
+	nrc_usr_print("\n");
+	nrc_usr_print("arena used %d of %d bytes\n", (int)arena.peak, ARENA_SIZE);
+	cJSON_ArenaFree(&arena);
 }
 
 static void create_json_objects(char *data)
@@ -0,0 +1,179 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "nrc_sdk.h"
+#include "wifi_config_setup.h"
+#include "wifi_connect_common.h"
+#include "wifi_resume.h"
+#include "wifi_batch.h"
+#include "sample_ps_batch_version.h"
+
+/*
+ * The device wakes every ps_sleep ms to read the ADC and sleeps again
+ * without associating. The readings are sent to remote_addr:remote_port
+ * over UDP every BATCH_EVERY wakes, or as soon as one of them moves by
+ * BATCH_THRESHOLD from the last reading sent.
+ */
+
+#define BATCH_EVERY		10
+#define BATCH_THRESHOLD	100	/* ADC counts */
+
+#define MAX_RETRY		3
+#define IP_WAIT_MS		10000
+
+static WIFI_CONFIG wifi_config;
+static WIFI_CONFIG *param = &wifi_config;
+
+static void read_sensor(int32_t *values)
+{
+	nrc_adc_init(true);
+	_delay_ms(10);
+
+#ifdef NRC7292
+	values[0] = nrc_adc_get_data(ADC1);
+	values[1] = nrc_adc_get_data(ADC2);
+#else
+	values[0] = nrc_adc_get_data(ADC0);
+	values[1] = nrc_adc_get_data(ADC1);
+#endif
+
+	nrc_adc_deinit();
+}
+
+static bool _ready_ip_address(void)
+{
+	return nrc_addr_get_state(0) == NET_ADDR_SET &&
+		   nrc_wifi_get_state(0) == WIFI_STATE_CONNECTED;
+}
+
+static nrc_err_t send_batch(WIFI_CONFIG *param)
+{
+	int retry;
+	int waited = 0;
+
+	if (wifi_init(param) != WIFI_SUCCESS) {
+		nrc_usr_print("[%s] wifi_init failed\n", __func__);
+		return NRC_FAIL;
+	}
+
+	for (retry = 0; retry < MAX_RETRY; retry++) {
+		if (wifi_connect(param) == WIFI_SUCCESS)
+			break;
+		_delay_ms(100);
+	}
+	if (retry == MAX_RETRY) {
+		nrc_usr_print("[%s] connection to %s failed\n", __func__, param->ssid);
+		return NRC_FAIL;
+	}
+
+	while (!_ready_ip_address()) {
+		if (waited >= IP_WAIT_MS) {
+			nrc_usr_print("[%s] no IP address\n", __func__);
+			return NRC_FAIL;
+		}
+		_delay_ms(10);
+		waited += 10;
+	}
+
+	nrc_usr_print("[%s] sending %u samples to %s:%d\n", __func__, wifi_batch_pending(),
+				  param->remote_addr, param->remote_port);
+	if (wifi_batch_flush(wifi_batch_send_udp, param) != NRC_SUCCESS) {
+		nrc_usr_print("[%s] %u samples left for the next time\n", __func__,
+					  wifi_batch_pending());
+		return NRC_FAIL;
+	}
+
+	/* let the last frame leave before the radio goes off */
+	_delay_ms(10);
+	wifi_resume_save(0);
+
+	return NRC_SUCCESS;
+}
+
+static void go_to_sleep(uint32_t sleep_ms)
+{
+	nrc_ps_set_wakeup_source(WAKEUP_SOURCE_RTC);
+
+	/* Set GPIO pullup/output/direction mask */
+	/* The GPIO configuration should be customized based on the target board layout */
+	/* If values not set correctly, the board may consume more power during deep sleep */
+#ifdef NRC7292
+	/* Below configuration is for NRC7292 EVK Revision B board */
+	nrc_ps_set_gpio_direction(0x07FFFF7F);
+	nrc_ps_set_gpio_out(0x0);
+	nrc_ps_set_gpio_pullup(0x0);
+#elif defined(NRC7394)
+	/* Below configuration is for NRC7394 EVK Revision board */
+	nrc_ps_set_gpio_direction(0xFFF7FDC7);
+	nrc_ps_set_gpio_out(0x0);
+	nrc_ps_set_gpio_pullup(0x0);
+#endif
+
+	nrc_ps_sleep_alone(sleep_ms);
+}
+
+/******************************************************************************
+ * FunctionName : user_init
+ * Description  : Start Code for User Application, Initialize User function
+ * Parameters   : none
+ * Returns      : none
+ *******************************************************************************/
+void user_init(void)
+{
+	wifi_batch_config_t config = WIFI_BATCH_CONFIG_DEFAULT;
+	VERSION_T app_version;
+	int32_t values[2];
+	bool due;
+
+	nrc_uart_console_enable(true);
+
+	app_version.major = SAMPLE_PS_BATCH_MAJOR;
+	app_version.minor = SAMPLE_PS_BATCH_MINOR;
+	app_version.patch = SAMPLE_PS_BATCH_PATCH;
+	nrc_set_app_version(&app_version);
+	nrc_set_app_name(SAMPLE_PS_BATCH_APP_NAME);
+
+	memset(param, 0x0, WIFI_CONFIG_SIZE);
+	nrc_wifi_set_config(param);
+
+	config.n_fields = 2;
+	config.every = BATCH_EVERY;
+	config.threshold[0] = BATCH_THRESHOLD;
+	config.threshold[1] = BATCH_THRESHOLD;
+	if (wifi_batch_init(&config, WIFI_BATCH_STORE_RETENTION) != NRC_SUCCESS) {
+		nrc_usr_print("[%s] no sample store\n", __func__);
+		return;
+	}
+
+	read_sensor(values);
+	due = wifi_batch_add(values);
+	nrc_usr_print("[%s] ADC %d %d, %u pending\n", __func__, values[0], values[1],
+				  wifi_batch_pending());
+
+	if (due)
+		send_batch(param);
+
+	go_to_sleep(param->ps_sleep);
+}
@@ -29,6 +29,8 @@
 #include "lwip/errno.h"
 #include "wifi_config_setup.h"
 #include "wifi_connect_common.h"
+#include "wifi_resume.h"
+#include "wifi_ps_stats.h"
 #include "sample_ps_schedule_version.h"
 
 #include "nvs.h"
@@ -149,6 +151,7 @@ static void send_data_to_server(WIFI_CONFIG *param)
 
 			length = length + offset + 1;
 			if (send(sockfd, buf, length, 0) > 0) {
+				wifi_ps_stats_tx(length);
 				/* erase nvs data after sending data */
 				nvs_erase_key(nvs_handle, NVS_SEND_DATA);
 			} else {
@@ -188,6 +191,8 @@ static void send_alert_to_server(WIFI_CONFIG *param)
 
 		if (send(sockfd, buf, strlen(buf) + 1, 0) <= 0) {
 			nrc_usr_print("Error occurred during sending\n");
+		} else {
+			wifi_ps_stats_tx(strlen(buf) + 1);
 		}
 	}
 
@@ -254,6 +259,8 @@ static void run_scheduled_client()
 	if (connect_to_ap(&param) == NRC_SUCCESS) {
 		nrc_usr_print("[%s] Sending data to server...\n", __func__);
 		send_data_to_server(&param);
+		/* the next scheduled wakeup skips DHCP */
+		wifi_resume_save(0);
 	}
 }
 
@@ -282,7 +289,7 @@ static void run_gpio_exception()
 		send_alert_to_server(&param);
 	}
 
-	ret = nrc_ps_resume_deep_sleep();
+	ret = wifi_ps_stats_resume_deep_sleep();
 	if (ret == NRC_FAIL)
 		nrc_usr_print("[%s] Can not received ack of QoS NULL frame with pm1 \n", __func__);
 
@@ -319,35 +326,35 @@ nrc_err_t schedule_deep_sleep()
 	nrc_ps_set_gpio_pullup(0x0);
 #endif
 
-	/* set the callbacks for scheduled callbacks */
-	if (nrc_ps_add_schedule(COLLECT_DURATION, false, collect_sensor_data) != NRC_SUCCESS) {
+	/* set the callbacks for scheduled callbacks, "psstats" shows their wakes */
+	if (wifi_ps_stats_add_schedule(COLLECT_DURATION, false, collect_sensor_data) != NRC_SUCCESS) {
 		return NRC_FAIL;
 	}
 
-	if (nrc_ps_add_schedule(REPORT_DURATION, true, run_scheduled_client) != NRC_SUCCESS) {
+	if (wifi_ps_stats_add_schedule(REPORT_DURATION, true, run_scheduled_client) != NRC_SUCCESS) {
 		return NRC_FAIL;
 	}
 
-	if (nrc_ps_add_schedule(SCHEDULE_3_DURATION, false, schedule_3_callback) != NRC_SUCCESS) {
+	if (wifi_ps_stats_add_schedule(SCHEDULE_3_DURATION, false, schedule_3_callback) != NRC_SUCCESS) {
 		return NRC_FAIL;
 	}
 /*
-	if (nrc_ps_add_schedule(SCHEDULE_4_DURATION, false, schedule_4_callback) != NRC_SUCCESS) {
+	if (wifi_ps_stats_add_schedule(SCHEDULE_4_DURATION, false, schedule_4_callback) != NRC_SUCCESS) {
 		return NRC_FAIL;
 	}
 */
 
 	if (SAMPLE_FOTA_ENABLED) {
-		if (nrc_ps_add_schedule(SCHEDULE_4_DURATION, true, fota_callback) != NRC_SUCCESS) {
+		if (wifi_ps_stats_add_schedule(SCHEDULE_4_DURATION, true, fota_callback) != NRC_SUCCESS) {
 			return NRC_FAIL;
 		}
 	}
 
-	if (nrc_ps_add_gpio_callback(true, run_gpio_exception) != NRC_SUCCESS) {
+	if (wifi_ps_stats_add_gpio_callback(true, run_gpio_exception) != NRC_SUCCESS) {
 		return NRC_FAIL;
 	}
 
-	return nrc_ps_start_schedule();
+	return wifi_ps_stats_start_schedule();
 }
 
 /******************************************************************************
@@ -26,6 +26,7 @@
 #include "nrc_sdk.h"
 #include "wifi_config_setup.h"
 #include "wifi_connect_common.h"
+#include "wifi_resume.h"
 #include "lwip/sockets.h"
 
 #define MAX_RETRY 10
@@ -56,25 +57,48 @@ static void prepare_test_data(uint8_t *test_data, size_t length)
 	test_data[length - 1] = '\n';
 }
 
+/*
+ * The socket stays connected across the deep sleep, so that its local port
+ * is kept by wifi_resume_save() and reused after the wakeup.
+ */
 static int udp_send_data(WIFI_CONFIG *param, uint8_t *data, size_t length)
 {
-	int sockfd;
+	static int sockfd = -1;
 	struct sockaddr_in server_addr;
+	struct sockaddr_in local_addr;
 	int ret = -1;
 
-	sockfd = socket(AF_INET, SOCK_DGRAM, 0);
 	if (sockfd < 0) {
-		nrc_usr_print("Failed to create DGRAM socket.\n");
-		return -1;
-	}
+		sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (sockfd < 0) {
+			nrc_usr_print("Failed to create DGRAM socket.\n");
+			return -1;
+		}
 
-	memset(&server_addr, 0, sizeof(server_addr));
-	server_addr.sin_family = AF_INET;
-	server_addr.sin_port = htons(param->remote_port);
-	server_addr.sin_addr.s_addr = inet_addr(param->remote_addr);
+		memset(&local_addr, 0, sizeof(local_addr));
+		local_addr.sin_family = AF_INET;
+		local_addr.sin_port = htons(wifi_resume_udp_port(param->remote_addr, param->remote_port));
+		local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+		if (local_addr.sin_port)
+			bind(sockfd, (struct sockaddr *) &local_addr, sizeof(local_addr));
+
+		memset(&server_addr, 0, sizeof(server_addr));
+		server_addr.sin_family = AF_INET;
+		server_addr.sin_port = htons(param->remote_port);
+		server_addr.sin_addr.s_addr = inet_addr(param->remote_addr);
+		if (connect(sockfd, (struct sockaddr *) &server_addr, sizeof(server_addr)) < 0) {
+			nrc_usr_print("Failed to connect DGRAM socket.\n");
+			close(sockfd);
+			sockfd = -1;
+			return -1;
+		}
+	}
 
-	ret = (int)sendto(sockfd, data, length, 0, (struct sockaddr *) &server_addr, sizeof(server_addr));
-	close(sockfd);
+	ret = (int)send(sockfd, data, length, 0);
+	if (ret < 0) {
+		close(sockfd);
+		sockfd = -1;
+	}
 	return ret;
 }
 
@@ -207,6 +231,9 @@ check_again:
 	nrc_ps_set_gpio_pullup(0x0);
 #endif
 
+	if (wifi_resume_save(0) != WIFI_SUCCESS)
+		nrc_usr_print("[%s] network state not saved, DHCP on wakeup\n", __func__);
+
 	while (1) {
 		if(ps_mode){
 			/* TIM Mode sleep */
@@ -30,139 +30,58 @@
 #include "lwip/netdb.h"
 #include "wifi_config_setup.h"
 #include "wifi_connect_common.h"
+#include "wifi_softap_server.h"
 
-#define TRUE   1
-#define FALSE  0
 #define PORT 8099
 
-#define RECV_BUF_SIZE 1600
 #define ECHO_SERVER_ENABLE 1
+#define SERVER_DATA_DEBUG 0
 
-static int error_val = 0;
-static void softap_udp_server_task(void *pvParameters)
-{
-	WIFI_CONFIG *param = pvParameters;
-	int opt = 1;
-	char rx_buffer[RECV_BUF_SIZE];
-	int clientlen;
-	int sockfd; /* socket */
+static const char *MSGEND = "#*stop_server";
 
-#ifdef CONFIG_IPV6
-	struct sockaddr_in6 serveraddr, clientaddr;
-#else
-	struct sockaddr_in serveraddr, clientaddr;
+static bool softap_udp_server_rx(wifi_softap_server_t *server, wifi_softap_client_t *client,
+								 const uint8_t *data, size_t len, void *arg)
+{
+#if SERVER_DATA_DEBUG
+	nrc_usr_print("[%s] received data with size %d...\n", __func__, len);
 #endif
 
-	int ret = 0;
-	char *MSGEND = "#*stop_server";
-
-	fd_set read_set;
-
-	//create a socket
-#ifdef CONFIG_IPV6
-	if( (sockfd = socket(AF_INET6 , SOCK_DGRAM , 0)) < 0) {
-		error_val = -1;
-		nrc_usr_print("ERROR opening socket");
-		goto exit;
+	if (len >= strlen(MSGEND) && strncmp((const char *)data, MSGEND, strlen(MSGEND)) == 0) {
+		wifi_softap_server_stop(server);
+		return false;
 	}
 
-	serveraddr.sin6_len = sizeof(struct sockaddr_in6);
-	serveraddr.sin6_family = AF_INET6;
-	serveraddr.sin6_port = htons(PORT);
-	serveraddr.sin6_flowinfo = 0;
-	serveraddr.sin6_addr = in6addr_any;
-	serveraddr.sin6_scope_id = 1;
-
-	clientlen = sizeof(struct sockaddr_in6);
-#else
-	if( (sockfd = socket(AF_INET , SOCK_DGRAM , 0)) < 0)  {
-		error_val = -1;
-		nrc_usr_print("ERROR opening socket");
-		goto exit;
-	}
+	return ECHO_SERVER_ENABLE;
+}
 
-	serveraddr.sin_len = sizeof(struct sockaddr_in);
-	serveraddr.sin_family = AF_INET;
-	serveraddr.sin_port = htons(PORT);
-	serveraddr.sin_addr.s_addr = htonl(INADDR_ANY);
+static void softap_udp_server_task(void *pvParameters)
+{
+	wifi_softap_server_config_t config = WIFI_SOFTAP_SERVER_CONFIG_DEFAULT;
+	wifi_softap_server_t *server;
 
-	clientlen = sizeof(struct sockaddr_in);
+	config.port = PORT;
+	config.udp = true;
+#ifdef CONFIG_IPV6
+	config.ipv6 = true;
 #endif
+	config.rx = softap_udp_server_rx;
 
-	if( setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (const void *)&opt, sizeof(opt)) < 0 ){
-		error_val = -1;
-		nrc_usr_print("setsockopt");
-		goto exit;
+	server = wifi_softap_server_create(&config);
+	if (!server) {
+		nrc_usr_print("ERROR opening socket\n");
+		vTaskDelete(NULL);
+		return;
 	}
 
-	//bind the socket to localhost port 8888
-	if (bind(sockfd, (struct sockaddr *)&serveraddr, sizeof(serveraddr)) < 0){
-		error_val = -1;
-		nrc_usr_print("ERROR on binding");
-		goto exit;
-	}
 	nrc_usr_print("[UDP Server]\n");
 	nrc_usr_print("Echo : %s\n", ECHO_SERVER_ENABLE ? "Enable" : "Disable");
-	nrc_usr_print("Receive buffer size :%d \n", RECV_BUF_SIZE);
-	nrc_usr_print("Listener on port %d \n", PORT);
-
-
-	while (1) {
-		memset(rx_buffer, 0, RECV_BUF_SIZE);
-
-		FD_ZERO(&read_set);
-		FD_SET(sockfd, &read_set);
-		if (select(sockfd + 1, &read_set, NULL, NULL, NULL) >= 0) {
-			memset(&clientaddr, 0, sizeof(clientaddr));
-			ret = recvfrom(sockfd, rx_buffer, RECV_BUF_SIZE, MSG_DONTWAIT,
-						   (struct sockaddr *) &clientaddr, (socklen_t *)&clientlen);
-			nrc_usr_print("[%s] received data with size %d...\n", __func__, ret);
-			if (ret < 0){
-				if (errno == EAGAIN)
-					continue;
-
-				error_val = -1;
-				nrc_usr_print("ERROR in recvfrom, errno=%d\n", errno);
-				goto exit;
-			}
-			struct sockaddr_in *client_in = (struct sockaddr_in *) &clientaddr;
-#ifdef CONFIG_IPV6
-			if (client_in->sin_family == AF_INET6) {
-				ip6_addr_t ip6_addr;
-				inet6_addr_to_ip6addr(&ip6_addr, &clientaddr.sin6_addr);
-
-				nrc_usr_print("Server received datagram from %s, port : %d\n",
-							  ip6addr_ntoa(&ip6_addr), ntohs(clientaddr.sin6_port));
-			} else
-#endif
-			{
-				nrc_usr_print("Server received datagram from %s, port : %d\n",
-							  inet_ntoa(client_in->sin_addr), ntohs(client_in->sin_port));
-			}
-//		nrc_usr_print("server received %d bytes: %s\n", ret, rx_buffer);
-#if ECHO_SERVER_ENABLE
-			ret = sendto(sockfd, rx_buffer, strlen(rx_buffer), 0,
-						 (struct sockaddr *) &clientaddr, clientlen);
-			if (ret < 0){
-				error_val = -1;
-				nrc_usr_print("ERROR in sendto");
-				goto exit;
-			}
-#endif
-			if (strncmp(rx_buffer, MSGEND, strlen(MSGEND)) == 0)  {
-				break;
-			}
+	nrc_usr_print("Receive buffer size :%d \n", WIFI_SOFTAP_SERVER_BUF_SIZE);
+	nrc_usr_print("Listener on port %d, \"srvsta\" shows the stations\n", PORT);
 
-		}
-	}
-	error_val = 0;
+	wifi_softap_server_run(server);
 
-exit:
-	if (sockfd  >= 0) {
-		nrc_usr_print("Shutting down and close socket\n");
-		shutdown(sockfd, SHUT_RDWR);
-		close(sockfd);
-	}
+	nrc_usr_print("Shutting down and close socket\n");
+	wifi_softap_server_destroy(server);
 	vTaskDelete(NULL);
 }
 
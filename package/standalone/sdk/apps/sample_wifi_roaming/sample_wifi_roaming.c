@@ -27,6 +27,9 @@
 #include "nrc_lwip.h"
 #include "wifi_config_setup.h"
 #include "wifi_connect_common.h"
+#include "wifi_roaming.h"
+
+#define ROAMING_STATS_INTERVAL_MS	(10 * 1000)
 
 /******************************************************************************
  * FunctionName : run_sample_wifi_connect
@@ -134,6 +137,17 @@ nrc_err_t run_sample_wifi_roaming(WIFI_CONFIG *param)
 		nrc_mem_free(ap_info);
 	}
 
+	/* roam in the background, between APs of the same SSID */
+	if (wifi_roaming_start(0, param, NULL) != WIFI_SUCCESS) {
+		nrc_usr_print("[%s] Fail to start roaming\n", __func__);
+		return NRC_FAIL;
+	}
+
+	while (1) {
+		_delay_ms(ROAMING_STATS_INTERVAL_MS);
+		wifi_roaming_print_stats();
+	}
+
 	return NRC_SUCCESS;
 }
 
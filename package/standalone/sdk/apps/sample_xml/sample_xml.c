@@ -31,8 +31,15 @@
 
 static void parsing_xml_data(char *data)
 {
+	mxml_pool_t *pool;
 	mxml_node_t *tree;
-	tree = mxmlLoadString(NULL, data, MXML_TEXT_CALLBACK);
+
+	/* The whole tree lives in the pool and goes away with mxmlPoolDelete() */
+	pool = mxmlPoolNew(0);
+	if (!pool)
+		return;
+
+	tree = mxmlPoolLoadString(pool, data, MXML_TEXT_CALLBACK);
 
 	mxml_node_t *node;
 	for (node = tree; node != NULL; node = mxmlWalkNext(node, tree, MXML_DESCEND)) {
@@ -54,6 +61,13 @@ static void parsing_xml_data(char *data)
 			break;
 		}
 	}
+
+	/* Lookups by name go through an index of the pooled tree */
+	node = mxmlFindPath(tree, "data/group/node");
+	if (node)
+		nrc_usr_print("[PATH] data/group/node = %s\n", mxmlGetText(node, NULL));
+
+	mxmlPoolDelete(pool);
 }
 
 static void create_xml_objects(char *buffer, int buffer_size)
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+Receiver of the sample frames sent by wifi_batch.c (see wifi_batch_ring.h
+for the format), e.g. from sample_ps_batch.
+
+Prints each sample and the sequence numbers that never arrived, either
+lost on the way or overwritten on the device before they could be sent.
+
+    ./batch_receiver.py [--port 8099]
+"""
+
+import argparse
+import socket
+import struct
+import sys
+
+FRAME_VERSION = 1
+FLAG_DELTA = 0x01
+
+
+def varint(buf, pos):
+    value = shift = 0
+    while True:
+        if pos >= len(buf) or shift > 28:
+            raise ValueError("truncated varint")
+        b = buf[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, pos
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def s32(v):
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def decode(buf):
+    if len(buf) < 2 or buf[0] >> 4 != FRAME_VERSION:
+        raise ValueError("not a version %d frame" % FRAME_VERSION)
+    flags, n_fields = buf[0] & 0x0F, buf[1]
+    seq, pos = varint(buf, 2)
+    count, pos = varint(buf, pos)
+    t, pos = varint(buf, pos)
+
+    samples = []
+    values = [0] * n_fields
+    for i in range(count):
+        if flags & FLAG_DELTA:
+            dt, pos = varint(buf, pos)
+            t = (t + unzigzag(dt)) & 0xFFFFFFFF
+            for f in range(n_fields):
+                d, pos = varint(buf, pos)
+                values[f] = s32(values[f] + unzigzag(d))
+        else:
+            t = struct.unpack_from("<I", buf, pos)[0]
+            values = list(struct.unpack_from("<%di" % n_fields, buf, pos + 4))
+            pos += 4 * (1 + n_fields)
+        samples.append((seq + i, t, list(values)))
+
+    if pos != len(buf):
+        raise ValueError("%d trailing bytes" % (len(buf) - pos))
+    return samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("--port", type=int, default=8099)
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", args.port))
+    expected = {}
+
+    while True:
+        buf, peer = sock.recvfrom(2048)
+        try:
+            samples = decode(buf)
+        except (ValueError, struct.error) as e:
+            sys.stderr.write("%s: %s\n" % (peer[0], e))
+            continue
+
+        for seq, t, values in samples:
+            next_seq = expected.get(peer[0])
+            if next_seq is not None and seq < next_seq:
+                continue
+            if next_seq is not None and seq > next_seq:
+                print("%s: %d samples lost (%d..%d)" % (peer[0], seq - next_seq,
+                                                       next_seq, seq - 1))
+            print("%s: #%d t=%d %s" % (peer[0], seq, t, " ".join(map(str, values))))
+            expected[peer[0]] = seq + 1
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,308 @@
+/*
+ * Unit test of the sample ring and frame codec of wifi_batch_ring.c.
+ *
+ * Covers the ring (wrap-around, overwrite of the oldest samples, checksum),
+ * the frame encoding in both modes against the decoder, frames split by a
+ * small buffer, the send triggers, and a receiver that tracks the sequence
+ * numbers over a link that loses frames and over an outage that overflows
+ * the ring.
+ *
+ *   make run
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wifi_batch_ring.h"
+
+static int checks;
+static int failures;
+
+#define CHECK(cond) do { \
+	checks++; \
+	if (!(cond)) { \
+		failures++; \
+		printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+	} \
+} while (0)
+
+static uint32_t lcg_state = 1;
+
+static uint32_t lcg(void)
+{
+	lcg_state = lcg_state * 1103515245 + 12345;
+	return (lcg_state >> 16) & 0x7fff;
+}
+
+/* A slowly moving temperature (centi-degrees) and humidity (per-mille) */
+static void sensor(int i, int32_t *v)
+{
+	v[0] = 2150 + (i % 40) * 3 - (int32_t)(lcg() % 5);
+	v[1] = 455 + (i % 25) - (int32_t)(lcg() % 3);
+}
+
+static void test_ring(void)
+{
+	static wifi_batch_ring_t ring;
+	wifi_batch_sample_t s;
+	int32_t v[2];
+	int i;
+
+	printf("ring\n");
+
+	CHECK(wifi_batch_ring_init(&ring, 0) < 0);
+	CHECK(wifi_batch_ring_init(&ring, WIFI_BATCH_FIELDS_MAX + 1) < 0);
+	CHECK(wifi_batch_ring_init(&ring, 2) == 0);
+	CHECK(ring.capacity == WIFI_BATCH_RING_BYTES / 12);
+	CHECK(wifi_batch_ring_valid(&ring, 2));
+	CHECK(!wifi_batch_ring_valid(&ring, 3));
+	CHECK(wifi_batch_ring_get(&ring, 0, &s) < 0);
+
+	for (i = 0; i < ring.capacity + 5; i++) {
+		v[0] = i * 10;
+		v[1] = -i;
+		CHECK(wifi_batch_ring_push(&ring, 1000 + i, v) == (uint32_t)i);
+	}
+	CHECK(ring.count == ring.capacity);
+	CHECK(ring.dropped == 5);
+
+	CHECK(wifi_batch_ring_get(&ring, 0, &s) == 0);
+	CHECK(s.seq == 5 && s.t == 1005 && s.v[0] == 50 && s.v[1] == -5);
+	CHECK(wifi_batch_ring_get(&ring, ring.count - 1, &s) == 0);
+	CHECK(s.seq == (uint32_t)ring.capacity + 4 && s.v[1] == -(ring.capacity + 4));
+	CHECK(wifi_batch_ring_get(&ring, ring.count, &s) < 0);
+
+	/* a ring read back damaged is not used */
+	CHECK(!wifi_batch_ring_valid(&ring, 2));
+	wifi_batch_ring_seal(&ring);
+	CHECK(wifi_batch_ring_valid(&ring, 2));
+	ring.data[7] ^= 1;
+	CHECK(!wifi_batch_ring_valid(&ring, 2));
+	ring.data[7] ^= 1;
+	ring.head = ring.capacity;
+	wifi_batch_ring_seal(&ring);
+	CHECK(!wifi_batch_ring_valid(&ring, 2));
+}
+
+static void round_trip(bool delta, int n, size_t *bytes)
+{
+	static wifi_batch_ring_t ring;
+	wifi_batch_sample_t in, out[WIFI_BATCH_RING_BYTES / 8];
+	wifi_batch_frame_t frame;
+	uint8_t buf[1024];
+	uint16_t count;
+	int32_t v[WIFI_BATCH_FIELDS_MAX];
+	int i, len;
+
+	wifi_batch_ring_init(&ring, 2);
+	for (i = 0; i < n; i++) {
+		sensor(i, v);
+		wifi_batch_ring_push(&ring, 1700000000 + i * 60 + (lcg() % 3), v);
+	}
+
+	len = wifi_batch_encode(&ring, delta, buf, sizeof(buf), &count);
+	CHECK(len > 0 && count == n);
+	CHECK(wifi_batch_decode(buf, len, &frame, out, n) == n);
+	CHECK(frame.seq == 0 && frame.count == n && frame.n_fields == 2);
+	CHECK(!!(frame.flags & WIFI_BATCH_FLAG_DELTA) == delta);
+
+	for (i = 0; i < n; i++) {
+		wifi_batch_ring_get(&ring, i, &in);
+		CHECK(memcmp(&in, &out[i], sizeof(in)) == 0);
+	}
+
+	/* no room, truncated, trailing garbage */
+	CHECK(wifi_batch_decode(buf, len, &frame, out, n - 1) < 0);
+	CHECK(wifi_batch_decode(buf, len - 1, &frame, out, n) < 0);
+	CHECK(wifi_batch_decode(buf, len + 1, &frame, out, n) < 0);
+
+	*bytes = len;
+}
+
+static void test_codec(void)
+{
+	static wifi_batch_ring_t ring;
+	wifi_batch_sample_t out[4];
+	wifi_batch_frame_t frame;
+	uint8_t buf[128];
+	size_t raw, delta;
+	uint16_t count;
+	int32_t v[WIFI_BATCH_FIELDS_MAX];
+	int len, f;
+
+	printf("codec\n");
+
+	round_trip(false, 24, &raw);
+	round_trip(true, 24, &delta);
+	printf("  24 samples of 2 fields: %zu bytes raw, %zu delta\n", raw, delta);
+	CHECK(delta * 2 < raw);
+
+	/* extremes wrap around in the deltas */
+	wifi_batch_ring_init(&ring, WIFI_BATCH_FIELDS_MAX);
+	for (f = 0; f < WIFI_BATCH_FIELDS_MAX; f++)
+		v[f] = f & 1 ? INT32_MIN : INT32_MAX;
+	wifi_batch_ring_push(&ring, 0xffffffff, v);
+	for (f = 0; f < WIFI_BATCH_FIELDS_MAX; f++)
+		v[f] = f & 1 ? INT32_MAX : INT32_MIN;
+	wifi_batch_ring_push(&ring, 0, v);
+
+	len = wifi_batch_encode(&ring, true, buf, sizeof(buf), &count);
+	CHECK(count == 2 && len <= WIFI_BATCH_HEADER_MAX + 2 * WIFI_BATCH_SAMPLE_MAX);
+	CHECK(wifi_batch_decode(buf, len, &frame, out, 4) == 2);
+	CHECK(out[0].t == 0xffffffff && out[1].t == 0);
+	CHECK(out[0].v[0] == INT32_MAX && out[1].v[0] == INT32_MIN);
+	CHECK(out[0].v[1] == INT32_MIN && out[1].v[1] == INT32_MAX);
+
+	CHECK(wifi_batch_encode(&ring, true, buf, WIFI_BATCH_HEADER_MAX, &count) < 0);
+	wifi_batch_ring_init(&ring, 1);
+	CHECK(wifi_batch_encode(&ring, true, buf, sizeof(buf), &count) == 0 && count == 0);
+
+	buf[0] = (WIFI_BATCH_FRAME_VERSION + 1) << 4;
+	CHECK(wifi_batch_decode(buf, sizeof(buf), &frame, out, 4) < 0);
+}
+
+static void test_split(void)
+{
+	static wifi_batch_ring_t ring;
+	wifi_batch_sample_t out[WIFI_BATCH_RING_BYTES / 8];
+	wifi_batch_frame_t frame;
+	uint8_t buf[48];
+	uint32_t expect = 0;
+	uint16_t count;
+	int32_t v[2];
+	int i, len, frames = 0;
+
+	printf("split\n");
+
+	wifi_batch_ring_init(&ring, 2);
+	for (i = 0; i < 30; i++) {
+		sensor(i, v);
+		wifi_batch_ring_push(&ring, i * 60, v);
+	}
+
+	while (ring.count) {
+		len = wifi_batch_encode(&ring, true, buf, sizeof(buf), &count);
+		CHECK(len > 0 && len <= (int)sizeof(buf) && count > 0);
+		CHECK(wifi_batch_decode(buf, len, &frame, out, 30) == count);
+		CHECK(frame.seq == expect);
+		expect += count;
+		wifi_batch_ring_consume(&ring, count);
+		frames++;
+	}
+	printf("  30 samples in %d frames of up to %zu bytes\n", frames, sizeof(buf));
+	CHECK(expect == 30 && frames > 1);
+	CHECK(ring.has_sent && ring.sent[0] == out[count - 1].v[0]);
+}
+
+static void test_due(void)
+{
+	static wifi_batch_ring_t ring;
+	wifi_batch_config_t config = { .n_fields = 2, .delta = true, .every = 6,
+								   .threshold = { 50, 0 } };
+	int32_t v[2] = { 2000, 500 };
+	int i;
+
+	printf("due\n");
+
+	wifi_batch_ring_init(&ring, 2);
+	CHECK(!wifi_batch_ring_due(&ring, &config));
+
+	for (i = 0; i < 5; i++) {
+		wifi_batch_ring_push(&ring, i, v);
+		CHECK(!wifi_batch_ring_due(&ring, &config));
+	}
+	wifi_batch_ring_push(&ring, 5, v);
+	CHECK(wifi_batch_ring_due(&ring, &config));
+	wifi_batch_ring_consume(&ring, ring.count);
+	CHECK(!wifi_batch_ring_due(&ring, &config));
+
+	/* below the threshold, then a step */
+	v[0] += 49;
+	v[1] += 1000;
+	wifi_batch_ring_push(&ring, 6, v);
+	CHECK(!wifi_batch_ring_due(&ring, &config));
+	v[0] -= 100;
+	wifi_batch_ring_push(&ring, 7, v);
+	CHECK(wifi_batch_ring_due(&ring, &config));
+	wifi_batch_ring_consume(&ring, ring.count);
+
+	/* a full ring is always due */
+	config.every = 0xffff;
+	for (i = 0; i < ring.capacity - 1; i++) {
+		wifi_batch_ring_push(&ring, 8 + i, v);
+		CHECK(!wifi_batch_ring_due(&ring, &config));
+	}
+	wifi_batch_ring_push(&ring, 8 + i, v);
+	CHECK(wifi_batch_ring_due(&ring, &config));
+}
+
+/*
+ * 2000 wakes, a sample each, sent every 8 samples. 1 frame in 5 is lost,
+ * and there is no link for wakes 800 to 1199: the ring overflows.
+ * The receiver must see every sample at most once, in order, and account
+ * for the others as lost.
+ */
+static void test_link(void)
+{
+	static wifi_batch_ring_t ring;
+	wifi_batch_config_t config = { .n_fields = 2, .delta = true, .every = 8 };
+	wifi_batch_sample_t out[WIFI_BATCH_RING_BYTES / 8];
+	wifi_batch_frame_t frame;
+	uint8_t buf[256];
+	uint32_t expect = 0, received = 0, lost = 0, sent_bytes = 0, frames = 0;
+	uint32_t total = 2000;
+	uint16_t count;
+	int32_t v[2];
+	uint32_t i;
+	int len, n;
+
+	printf("link\n");
+
+	lcg_state = 7;
+	wifi_batch_ring_init(&ring, 2);
+
+	for (i = 0; i < total; i++) {
+		sensor(i, v);
+		wifi_batch_ring_push(&ring, i * 60, v);
+		if (!wifi_batch_ring_due(&ring, &config) || (i >= 800 && i < 1200))
+			continue;
+
+		while (ring.count) {
+			len = wifi_batch_encode(&ring, config.delta, buf, sizeof(buf), &count);
+			CHECK(len > 0);
+			wifi_batch_ring_consume(&ring, count);
+			sent_bytes += len;
+			frames++;
+
+			if (lcg() % 5 == 0)
+				continue;
+
+			n = wifi_batch_decode(buf, len, &frame, out, sizeof(out) / sizeof(out[0]));
+			CHECK(n == count);
+			CHECK(frame.seq >= expect);
+			lost += frame.seq - expect;
+			received += n;
+			expect = frame.seq + n;
+		}
+	}
+	lost += ring.next_seq - ring.count - expect;
+
+	printf("  %u samples: %u received, %u lost (%u overwritten), %u frames, %u bytes\n",
+		   total, received, lost, ring.dropped, frames, sent_bytes);
+	CHECK(received + lost + ring.count == total);
+	CHECK(ring.dropped == 400u - ring.capacity + 1);
+	CHECK(received > total / 2);
+}
+
+int main(void)
+{
+	test_ring();
+	test_codec();
+	test_split();
+	test_due();
+	test_link();
+
+	printf("%d checks, %d failed: %s\n", checks, failures, failures ? "FAIL" : "PASS");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+Energy estimate of a power save schedule from the wake accounting of
+wifi_ps_stats.c.
+
+The "psstats dump" console command prints the totals kept in retention as
+
+    PSSTATS <hex of wifi_ps_stats_t>
+
+This script takes the last such line of a console log, applies a current
+model (the current drawn during deep sleep and in each phase of a wake) and
+prints the charge spent per schedule, the average current and the battery
+life it projects to.
+
+    ./ps_energy.py logs/ps_schedule.log [--model ps_current_model.json]
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x53505350
+VERSION = 1
+SLOTS = 5
+SLOT_GPIO = 4
+PHASES = ("boot", "connect", "ip", "tx", "tail")
+
+SLOT_USED = 1 << 0
+SLOT_NET_INIT = 1 << 1
+SLOT_GPIO_FLAG = 1 << 2
+
+HEADER = struct.Struct("<IHHQQII")
+SLOT = struct.Struct("<%dI" % (9 + 2 * len(PHASES)))
+SIZE = HEADER.size + SLOTS * SLOT.size
+CHECKSUM_OFFSET = 28
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def parse(blob):
+    if len(blob) < SIZE:
+        raise ValueError("%d bytes, %d expected" % (len(blob), SIZE))
+    blob = blob[:SIZE]
+
+    magic, version, size, last_rtc, sleep_ms, cycles, checksum = HEADER.unpack_from(blob)
+    if magic != MAGIC or version != VERSION or size != SIZE:
+        raise ValueError("not a version %d PSSTATS record" % VERSION)
+
+    zeroed = blob[:CHECKSUM_OFFSET] + b"\0\0\0\0" + blob[CHECKSUM_OFFSET + 4:]
+    if fnv1a(zeroed) != checksum:
+        raise ValueError("checksum mismatch")
+
+    slots = []
+    for i in range(SLOTS):
+        v = SLOT.unpack_from(blob, HEADER.size + i * SLOT.size)
+        n = len(PHASES)
+        slots.append({
+            "index": i,
+            "func": v[0],
+            "timeout_ms": v[1],
+            "flags": v[2],
+            "wakes": v[3],
+            "wasted": v[4],
+            "tx_packets": v[5],
+            "tx_bytes": v[6],
+            "awake_ms": v[7],
+            "awake_max_ms": v[8],
+            "phase_ms": dict(zip(PHASES, v[9:9 + n])),
+            "phase_max_ms": dict(zip(PHASES, v[9 + n:9 + 2 * n])),
+        })
+
+    return {"sleep_ms": sleep_ms, "cycles": cycles, "slots": slots}
+
+
+def last_record(path):
+    record = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            i = line.find("PSSTATS ")
+            if i >= 0:
+                record = line[i + 8:].split()[0]
+    if record is None:
+        raise ValueError("%s: no PSSTATS line" % path)
+    return bytes.fromhex(record)
+
+
+def slot_name(slot):
+    if slot["flags"] & SLOT_GPIO_FLAG:
+        return "gpio"
+    return "schedule %d (%u s)" % (slot["index"], slot["timeout_ms"] // 1000)
+
+
+def report(stats, model, out):
+    phase_ma = model["phase_ma"]
+    sleep_mas = stats["sleep_ms"] / 1000.0 * model["sleep_ua"] / 1000.0
+    total_ms = stats["sleep_ms"]
+    total_mas = sleep_mas
+    rows = []
+
+    for slot in stats["slots"]:
+        if not slot["flags"] & SLOT_USED:
+            continue
+        mas = sum(slot["phase_ms"][p] / 1000.0 * phase_ma[p] for p in PHASES)
+        rows.append((slot, mas))
+        total_ms += slot["awake_ms"]
+        total_mas += mas
+
+    if total_ms == 0:
+        out.write("no time accounted yet\n")
+        return 1
+
+    out.write("%u wakes over %.1f h, %.3f%% awake\n" % (
+        stats["cycles"], total_ms / 3600000.0,
+        100.0 * (total_ms - stats["sleep_ms"]) / total_ms))
+    out.write("%-22s %7s %7s %10s %10s %6s\n" % (
+        "", "wakes", "wasted", "mA*s", "mA*s/wake", "share"))
+    for slot, mas in rows:
+        out.write("%-22s %7u %7u %10.2f %10.3f %5.1f%%\n" % (
+            slot_name(slot), slot["wakes"], slot["wasted"], mas,
+            mas / slot["wakes"] if slot["wakes"] else 0.0, 100.0 * mas / total_mas))
+        if slot["wakes"]:
+            out.write("%-22s %s ms/wake\n" % ("", ", ".join(
+                "%s %.0f" % (p, slot["phase_ms"][p] / float(slot["wakes"])) for p in PHASES)))
+    out.write("%-22s %7s %7s %10.2f %10s %5.1f%%\n" % (
+        "sleep", "", "", sleep_mas, "", 100.0 * sleep_mas / total_mas))
+
+    avg_ma = total_mas / (total_ms / 1000.0)
+    capacity = model["battery_mah"] * model.get("battery_derate", 1.0)
+    hours = capacity / avg_ma
+    out.write("average %.4f mA, %.0f mAh battery: %.0f days (%.2f years)\n" % (
+        avg_ma, model["battery_mah"], hours / 24, hours / 24 / 365))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("log", help="console log with a PSSTATS line")
+    parser.add_argument("--model", default="ps_current_model.json",
+                        help="current model (default: %(default)s)")
+    args = parser.parse_args()
+
+    try:
+        stats = parse(last_record(args.log))
+    except (OSError, ValueError) as e:
+        sys.stderr.write("%s\n" % e)
+        return 1
+
+    with open(args.model) as f:
+        model = json.load(f)
+
+    return report(stats, model, sys.stdout)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
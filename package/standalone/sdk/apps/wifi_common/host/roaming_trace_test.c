@@ -0,0 +1,254 @@
+/*
+ * Replays RSSI traces through the roaming policy of wifi_roaming.c.
+ *
+ * A trace (traces/NAME.csv) gives the RSSI of each AP every sample period, empty
+ * when the AP is not heard. The STA starts on the strongest AP. Every row is a
+ * link sample of the serving AP; scans only see the APs on the channels the
+ * policy asked for. A roam takes 60 ms to an AP with a PMKSA and 250 ms
+ * otherwise. Losing the serving AP counts as a drop followed by a full
+ * reconnect to the strongest AP.
+ *
+ * Each trace runs twice, with the trend prediction and without it
+ * (horizon 0), and the time the serving RSSI spends below the roam threshold
+ * is compared.
+ *
+ *   make run
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wifi_roaming_policy.h"
+
+#define MAX_APS		8
+#define MAX_ROWS	2048
+#define NO_SIGNAL	(-128)
+
+#define ROAM_MS_PMKSA	60
+#define ROAM_MS_FULL	250
+
+struct trace {
+	int n_aps;
+	uint8_t bssid[MAX_APS][6];
+	uint16_t freq[MAX_APS];
+	int n_rows;
+	uint32_t t[MAX_ROWS];
+	int8_t rssi[MAX_ROWS][MAX_APS];
+};
+
+struct result {
+	int roams;
+	int ping_pongs;
+	int drops;
+	uint32_t below_ms;	/* serving RSSI below the roam threshold */
+	uint32_t latency_max_ms;
+};
+
+struct expect {
+	const char *file;
+	int min_roams;
+	int max_roams;
+	int max_drops;
+};
+
+static const struct expect expects[] = {
+	{ "aisle.csv",		4, 5, 0 },
+	{ "boundary.csv",	0, 2, 0 },
+	{ "drive_away.csv",	1, 1, 0 },
+};
+
+static int load(const char *path, struct trace *tr)
+{
+	char line[512];
+	FILE *f = fopen(path, "r");
+	bool header = true;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	memset(tr, 0, sizeof(*tr));
+	while (fgets(line, sizeof(line), f)) {
+		char *p = line, *field;
+		int col = 0;
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		while ((field = strsep(&p, ",\n")) != NULL && (p || *field)) {
+			if (col == 0) {
+				if (!header)
+					tr->t[tr->n_rows] = strtoul(field, NULL, 10);
+			} else if (col <= MAX_APS) {
+				if (header) {
+					unsigned int b[6];
+
+					if (sscanf(field, "%x:%x:%x:%x:%x:%x@%hu", &b[0], &b[1], &b[2],
+							   &b[3], &b[4], &b[5], &tr->freq[col - 1]) != 7)
+						break;
+					for (int i = 0; i < 6; i++)
+						tr->bssid[col - 1][i] = b[i];
+					tr->n_aps = col;
+				} else {
+					tr->rssi[tr->n_rows][col - 1] = *field ? atoi(field) : NO_SIGNAL;
+				}
+			}
+			col++;
+		}
+
+		if (header)
+			header = false;
+		else if (++tr->n_rows == MAX_ROWS)
+			break;
+	}
+
+	fclose(f);
+	return tr->n_aps > 0 && tr->n_rows > 0 ? 0 : -1;
+}
+
+static int strongest(const struct trace *tr, int row)
+{
+	int best = -1;
+
+	for (int i = 0; i < tr->n_aps; i++) {
+		if (tr->rssi[row][i] != NO_SIGNAL &&
+			(best < 0 || tr->rssi[row][i] > tr->rssi[row][best]))
+			best = i;
+	}
+	return best;
+}
+
+static int ap_index(const struct trace *tr, const uint8_t *bssid)
+{
+	for (int i = 0; i < tr->n_aps; i++) {
+		if (memcmp(tr->bssid[i], bssid, 6) == 0)
+			return i;
+	}
+	return -1;
+}
+
+static void replay(const struct trace *tr, const wifi_roam_policy_config_t *config,
+				   bool pmksa_ess, struct result *res)
+{
+	wifi_roam_policy_t policy;
+	const wifi_roam_candidate_t *target;
+	int serving = strongest(tr, 0);
+	int previous = -1;
+	uint32_t last_roam = 0;
+
+	memset(res, 0, sizeof(*res));
+	wifi_roam_policy_init(&policy, config, pmksa_ess);
+	wifi_roam_policy_connected(&policy, tr->t[0], tr->bssid[serving], tr->freq[serving]);
+
+	for (int row = 0; row < tr->n_rows; row++) {
+		uint32_t now = tr->t[row];
+		uint32_t period = row + 1 < tr->n_rows ? tr->t[row + 1] - now : 0;
+		wifi_roam_action_t action;
+
+		if (serving < 0 || tr->rssi[row][serving] == NO_SIGNAL) {
+			if (serving >= 0)
+				res->drops++;
+			wifi_roam_policy_disconnected(&policy);
+			serving = strongest(tr, row);
+			res->below_ms += period;
+			if (serving >= 0)
+				wifi_roam_policy_connected(&policy, now, tr->bssid[serving],
+										   tr->freq[serving]);
+			continue;
+		}
+
+		if (tr->rssi[row][serving] < config->roam_threshold)
+			res->below_ms += period;
+
+		wifi_roam_policy_link(&policy, now, tr->rssi[row][serving], 20);
+		action = wifi_roam_policy_decide(&policy, now, &target);
+
+		if (action == WIFI_ROAM_ACTION_SCAN) {
+			uint16_t freqs[WIFI_ROAM_MAX_CANDIDATES + 1];
+			int n = wifi_roam_policy_scan_freqs(&policy, freqs, WIFI_ROAM_MAX_CANDIDATES + 1);
+
+			wifi_roam_policy_scan_start(&policy, now);
+			for (int i = 0; i < tr->n_aps; i++) {
+				int j;
+
+				if (tr->rssi[row][i] == NO_SIGNAL)
+					continue;
+				for (j = 0; j < n && freqs[j] != tr->freq[i]; j++)
+					;
+				if (n && j == n)
+					continue;
+				wifi_roam_policy_candidate(&policy, now, tr->bssid[i], tr->freq[i],
+										   tr->rssi[row][i]);
+			}
+		} else if (action == WIFI_ROAM_ACTION_ROAM) {
+			int next = ap_index(tr, target->bssid);
+			uint32_t latency = target->pmksa ? ROAM_MS_PMKSA : ROAM_MS_FULL;
+
+			if (next < 0 || tr->rssi[row][next] == NO_SIGNAL) {
+				wifi_roam_policy_roamed(&policy, now, now + latency, NULL, 0);
+				continue;
+			}
+
+			if (next == previous && now - last_roam < config->hold_down_ms)
+				res->ping_pongs++;
+			wifi_roam_policy_roamed(&policy, now, now + latency, tr->bssid[next],
+									tr->freq[next]);
+			previous = serving;
+			serving = next;
+			last_roam = now;
+			res->roams++;
+			printf("    %6u ms roam to %02x:%02x:%02x:%02x:%02x:%02x (%d dBm)\n", now,
+				   tr->bssid[next][0], tr->bssid[next][1], tr->bssid[next][2],
+				   tr->bssid[next][3], tr->bssid[next][4], tr->bssid[next][5],
+				   tr->rssi[row][next]);
+		}
+	}
+
+	res->latency_max_ms = policy.latency_max_ms;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *dir = argc > 1 ? argv[1] : "traces";
+	static struct trace tr;
+	int failed = 0;
+
+	for (size_t i = 0; i < sizeof(expects) / sizeof(expects[0]); i++) {
+		const struct expect *e = &expects[i];
+		wifi_roam_policy_config_t config = WIFI_ROAM_POLICY_CONFIG_DEFAULT;
+		struct result predicted, reactive;
+		char path[256];
+		bool ok;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, e->file);
+		if (load(path, &tr) != 0) {
+			printf("%s: cannot load\n", path);
+			failed++;
+			continue;
+		}
+
+		printf("%s (%d APs, %u s)\n", e->file, tr.n_aps, tr.t[tr.n_rows - 1] / 1000);
+		printf("  predictive\n");
+		replay(&tr, &config, true, &predicted);
+		config.horizon_ms = 0;
+		printf("  reactive\n");
+		replay(&tr, &config, true, &reactive);
+
+		ok = predicted.roams >= e->min_roams && predicted.roams <= e->max_roams &&
+			 predicted.drops <= e->max_drops && predicted.ping_pongs == 0 &&
+			 predicted.below_ms <= reactive.below_ms;
+
+		printf("  roams %d/%d, ping-pong %d/%d, drops %d/%d, below %d dBm %u/%u ms"
+			   " (predictive/reactive), max roam %u ms: %s\n",
+			   predicted.roams, reactive.roams, predicted.ping_pongs, reactive.ping_pongs,
+			   predicted.drops, reactive.drops, config.roam_threshold,
+			   predicted.below_ms, reactive.below_ms, predicted.latency_max_ms,
+			   ok ? "PASS" : "FAIL");
+		if (!ok)
+			failed++;
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,468 @@
+/*
+ * Throughput bench of wifi_softap_server.c on Linux sockets.
+ *
+ * N clients on the loopback keep a window of data in flight to an echo
+ * server and check every byte that comes back. The same load is run
+ * against wifi_softap_server and against a copy of the loop the
+ * sample_softap_tcp_server sample used to have, which reads every client
+ * into one buffer and waits for each echo to be sent. The last runs add a
+ * client that sends but never reads, as a station with a bad link would.
+ *
+ * Printed for each run: the aggregate echo throughput, Jain's fairness
+ * index of the per-client throughput (1 is an even share), and the lowest
+ * and highest client share. A last TCP run checks that a client whose
+ * connection is reset while the pool is empty is still freed.
+ *
+ *   make bench
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "wifi_softap_server.h"
+
+#define CLIENTS_MAX		WIFI_SOFTAP_SERVER_CLIENTS_MAX
+#define WINDOW			(16 * 1024)
+#define CHUNK			1400
+#define LEGACY_BUFFER	(4 * 1024)
+
+static int checks;
+static int failures;
+
+#define CHECK(cond) do { \
+	checks++; \
+	if (!(cond)) { \
+		failures++; \
+		printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+	} \
+} while (0)
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The byte at offset off of the stream of client id */
+static uint8_t pattern(int id, uint64_t off)
+{
+	return (uint8_t)(off * 7 + id * 13 + (off >> 8));
+}
+
+/*
+ * The server loop of the sample before wifi_softap_server: one select()
+ * on all the clients, a 4 KB buffer, and a select() of up to 2 s on each
+ * client before its echo is sent.
+ */
+typedef struct {
+	int sock;
+	volatile int stop;
+	uint16_t port;
+} legacy_t;
+
+static void *legacy_run(void *arg)
+{
+	legacy_t *l = arg;
+	int conn[WIFI_SOFTAP_SERVER_CLIENTS_MAX];
+	char buffer[LEGACY_BUFFER];
+	struct timeval tv;
+	fd_set rfds, wfds;
+	int i, sd, max_sd, len;
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++)
+		conn[i] = -1;
+
+	while (!l->stop) {
+		FD_ZERO(&rfds);
+		FD_SET(l->sock, &rfds);
+		max_sd = l->sock;
+		for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++) {
+			if (conn[i] >= 0) {
+				FD_SET(conn[i], &rfds);
+				if (conn[i] > max_sd)
+					max_sd = conn[i];
+			}
+		}
+
+		tv.tv_sec = 0;
+		tv.tv_usec = 100000;
+		if (select(max_sd + 1, &rfds, NULL, NULL, &tv) <= 0)
+			continue;
+
+		if (FD_ISSET(l->sock, &rfds)) {
+			sd = accept(l->sock, NULL, NULL);
+			if (sd >= 0) {
+				fcntl(sd, F_SETFL, O_NONBLOCK);
+				for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX && conn[i] >= 0; i++)
+					;
+				if (i < WIFI_SOFTAP_SERVER_CLIENTS_MAX)
+					conn[i] = sd;
+				else
+					close(sd);
+			}
+			continue;
+		}
+
+		for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX && !l->stop; i++) {
+			sd = conn[i];
+			if (sd < 0 || !FD_ISSET(sd, &rfds))
+				continue;
+
+			len = recv(sd, buffer, sizeof(buffer), 0);
+			if (len <= 0) {
+				close(sd);
+				conn[i] = -1;
+				continue;
+			}
+
+			FD_ZERO(&wfds);
+			FD_SET(sd, &wfds);
+			tv.tv_sec = 2;
+			tv.tv_usec = 0;
+			if (select(sd + 1, NULL, &wfds, NULL, &tv) > 0)
+				send(sd, buffer, len, MSG_NOSIGNAL);
+		}
+	}
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++) {
+		if (conn[i] >= 0)
+			close(conn[i]);
+	}
+	return NULL;
+}
+
+static int legacy_start(legacy_t *l, pthread_t *thread)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int reuse = 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	l->sock = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(l->sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	if (bind(l->sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(l->sock, 64) < 0)
+		return -1;
+	getsockname(l->sock, (struct sockaddr *)&addr, &len);
+	l->port = ntohs(addr.sin_port);
+	l->stop = 0;
+
+	return pthread_create(thread, NULL, legacy_run, l);
+}
+
+static void *server_thread(void *arg)
+{
+	wifi_softap_server_run(arg);
+	return NULL;
+}
+
+typedef struct {
+	int sock;
+	int reads;			/* 0 for a client that never reads */
+	uint64_t sent;
+	uint64_t received;
+	uint64_t bad;
+} client_t;
+
+static client_t clients[CLIENTS_MAX];
+
+/*
+ * Drive n clients for a while. The stalled client, if any, is the last
+ * one and is left out of the throughput and fairness figures.
+ */
+static void load(const char *name, uint16_t port, int n, int stalled, double seconds)
+{
+	static uint8_t buf[64 * 1024];
+	struct pollfd fds[CLIENTS_MAX];
+	struct sockaddr_in addr;
+	double start, elapsed, sum = 0, sum2 = 0, lo = 1e18, hi = 0, rate;
+	uint64_t bytes = 0, bad = 0;
+	int active = n - stalled;
+	int i, len;
+	uint64_t j;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for (i = 0; i < n; i++) {
+		memset(&clients[i], 0, sizeof(clients[i]));
+		clients[i].sock = socket(AF_INET, SOCK_STREAM, 0);
+		clients[i].reads = i < active;
+		if (connect(clients[i].sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			printf("  connect: %s\n", strerror(errno));
+			exit(1);
+		}
+		fcntl(clients[i].sock, F_SETFL, O_NONBLOCK);
+	}
+
+	start = now_s();
+	while ((elapsed = now_s() - start) < seconds) {
+		for (i = 0; i < n; i++) {
+			client_t *c = &clients[i];
+
+			fds[i].fd = c->sock;
+			fds[i].events = c->reads ? POLLIN : 0;
+			if (c->sent - c->received < WINDOW || !c->reads)
+				fds[i].events |= POLLOUT;
+		}
+		if (poll(fds, n, 10) <= 0)
+			continue;
+
+		for (i = 0; i < n; i++) {
+			client_t *c = &clients[i];
+
+			if (fds[i].revents & POLLIN) {
+				len = recv(c->sock, buf, sizeof(buf), 0);
+				for (j = 0; j < (uint64_t)(len > 0 ? len : 0); j++) {
+					if (buf[j] != pattern(i, c->received + j))
+						c->bad++;
+				}
+				if (len > 0)
+					c->received += len;
+			}
+
+			if (fds[i].revents & POLLOUT) {
+				uint64_t room = c->reads ? WINDOW - (c->sent - c->received) : CHUNK;
+
+				len = room < CHUNK ? room : CHUNK;
+				for (j = 0; j < (uint64_t)len; j++)
+					buf[j] = pattern(i, c->sent + j);
+				len = send(c->sock, buf, len, MSG_NOSIGNAL);
+				if (len > 0)
+					c->sent += len;
+			}
+		}
+	}
+
+	for (i = 0; i < active; i++) {
+		rate = clients[i].received * 8 / elapsed / 1e6;
+		bytes += clients[i].received;
+		bad += clients[i].bad;
+		sum += rate;
+		sum2 += rate * rate;
+		if (rate < lo)
+			lo = rate;
+		if (rate > hi)
+			hi = rate;
+	}
+
+	for (i = 0; i < n; i++)
+		close(clients[i].sock);
+
+	printf("  %-7s %3d clients%s: %8.1f Mbit/s, fairness %.3f, client %.2f..%.2f Mbit/s\n",
+		   name, active, stalled ? " + 1 stalled" : "           ",
+		   bytes * 8 / elapsed / 1e6, sum * sum / (active * sum2), lo, hi);
+
+	CHECK(bad == 0);
+	CHECK(bytes > 0);
+}
+
+static void test_tcp(double seconds)
+{
+	static const int counts[] = { 1, 16, 64 };
+	wifi_softap_server_config_t config = WIFI_SOFTAP_SERVER_CONFIG_DEFAULT;
+	wifi_softap_server_stats_t stats;
+	wifi_softap_server_t *server;
+	pthread_t thread;
+	legacy_t legacy;
+	size_t k;
+
+	printf("tcp echo, %d buffers of %d bytes\n", WIFI_SOFTAP_SERVER_BUFS,
+		   WIFI_SOFTAP_SERVER_BUF_SIZE);
+
+	for (k = 0; k < sizeof(counts) / sizeof(counts[0]) + 1; k++) {
+		int n = k < 3 ? counts[k] : 64;
+		int stalled = k == 3;
+
+		if (legacy_start(&legacy, &thread) != 0) {
+			printf("  legacy server: %s\n", strerror(errno));
+			exit(1);
+		}
+		load("legacy", legacy.port, n + stalled, stalled, seconds);
+		legacy.stop = 1;
+		pthread_join(thread, NULL);
+		close(legacy.sock);
+
+		server = wifi_softap_server_create(&config);
+		CHECK(server != NULL);
+		if (!server)
+			return;
+		pthread_create(&thread, NULL, server_thread, server);
+		load("server", wifi_softap_server_port(server), n + stalled, stalled, seconds);
+		wifi_softap_server_stop(server);
+		pthread_join(thread, NULL);
+
+		wifi_softap_server_stats(server, &stats, NULL, 0);
+		printf("  %-7s buffers free %u (min %u), %u pool stalls\n", "",
+			   stats.bufs_free, stats.bufs_min, stats.pool_stalls);
+		wifi_softap_server_destroy(server);
+	}
+}
+
+/*
+ * Clients that close while the pool is empty are still freed. Three
+ * clients that do not read hold the pool in their queues, a fourth one
+ * keeps sending so that every round stalls on it, and a fifth one with a
+ * queue of its own resets its connection.
+ */
+static void test_pool_stall(void)
+{
+	wifi_softap_server_config_t config = WIFI_SOFTAP_SERVER_CONFIG_DEFAULT;
+	wifi_softap_server_stats_t stats;
+	wifi_softap_server_t *server;
+	struct sockaddr_in addr;
+	struct linger lin = { 1, 0 };
+	uint8_t buf[CHUNK];
+	int rcvbuf = 4096;
+	int sock[5];
+	int i, r;
+	const int reader = 3, victim = 4;
+
+	printf("tcp pool stall\n");
+
+	config.backlog_max = 60000;
+	server = wifi_softap_server_create(&config);
+	CHECK(server != NULL);
+	if (!server)
+		return;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(wifi_softap_server_port(server));
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	memset(buf, 0x5a, sizeof(buf));
+
+	for (i = 0; i < 5; i++) {
+		sock[i] = socket(AF_INET, SOCK_STREAM, 0);
+		/* keeps the echo in the queues of the server rather than the kernel */
+		setsockopt(sock[i], SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+		connect(sock[i], (struct sockaddr *)&addr, sizeof(addr));
+		fcntl(sock[i], F_SETFL, O_NONBLOCK);
+	}
+
+	for (r = 0; r < 5000; r++) {
+		for (i = 0; i < 5; i++) {
+			if (i != reader)
+				send(sock[i], buf, sizeof(buf), MSG_NOSIGNAL);
+		}
+		wifi_softap_server_poll(server, 1);
+		wifi_softap_server_stats(server, &stats, NULL, 0);
+		if (stats.bufs_free == 0 && stats.pool_stalls > 0)
+			break;
+	}
+	CHECK(stats.clients == 5);
+	CHECK(stats.bufs_free == 0);
+
+	/* an RST, the queue of the victim can only be dropped */
+	setsockopt(sock[victim], SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+	close(sock[victim]);
+
+	for (r = 0; r < 200; r++) {
+		send(sock[reader], buf, sizeof(buf), MSG_NOSIGNAL);
+		wifi_softap_server_poll(server, 1);
+		wifi_softap_server_stats(server, &stats, NULL, 0);
+		if (stats.clients == 4)
+			break;
+	}
+	printf("  %u clients after the reset, %u buffers free, %u pool stalls\n",
+		   stats.clients, stats.bufs_free, stats.pool_stalls);
+	CHECK(stats.clients == 4);
+	CHECK(stats.bufs_free > 0);
+
+	for (i = 0; i < 4; i++)
+		close(sock[i]);
+	wifi_softap_server_destroy(server);
+}
+
+/* Every peer gets an echo of each of its datagrams, and a client of its own */
+static void test_udp(void)
+{
+	wifi_softap_server_config_t config = WIFI_SOFTAP_SERVER_CONFIG_DEFAULT;
+	wifi_softap_client_stats_t stats[CLIENTS_MAX];
+	wifi_softap_server_t *server;
+	struct sockaddr_in addr;
+	struct pollfd pfd;
+	pthread_t thread;
+	int sock[16];
+	uint8_t buf[512], echo[512];
+	int i, r, n, echoed = 0, rounds = 200;
+
+	printf("udp echo\n");
+
+	config.udp = true;
+	server = wifi_softap_server_create(&config);
+	CHECK(server != NULL);
+	if (!server)
+		return;
+	pthread_create(&thread, NULL, server_thread, server);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(wifi_softap_server_port(server));
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for (i = 0; i < 16; i++) {
+		sock[i] = socket(AF_INET, SOCK_DGRAM, 0);
+		connect(sock[i], (struct sockaddr *)&addr, sizeof(addr));
+	}
+
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < 16; i++) {
+			memset(buf, r + i, sizeof(buf));
+			send(sock[i], buf, sizeof(buf) - i, 0);
+		}
+		for (i = 0; i < 16; i++) {
+			pfd.fd = sock[i];
+			pfd.events = POLLIN;
+			if (poll(&pfd, 1, 100) <= 0)
+				continue;
+			n = recv(sock[i], echo, sizeof(echo), 0);
+			memset(buf, r + i, sizeof(buf));
+			if (n == (int)sizeof(buf) - i && memcmp(buf, echo, n) == 0)
+				echoed++;
+		}
+	}
+
+	wifi_softap_server_stop(server);
+	pthread_join(thread, NULL);
+
+	n = wifi_softap_server_stats(server, NULL, stats, CLIENTS_MAX);
+	printf("  %d datagrams echoed of %d, %d peers\n", echoed, rounds * 16, n);
+	CHECK(echoed == rounds * 16);
+	CHECK(n == 16);
+	for (i = 0; i < n; i++)
+		CHECK(stats[i].tx_bytes == stats[i].rx_bytes && stats[i].backlog == 0);
+
+	for (i = 0; i < 16; i++)
+		close(sock[i]);
+	wifi_softap_server_destroy(server);
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+
+	test_tcp(seconds);
+	test_pool_stall();
+	test_udp();
+
+	printf("%d checks, %d failed: %s\n", checks, failures, failures ? "FAIL" : "PASS");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+#
+# Regenerates the RSSI traces replayed by roaming_trace_test.
+#
+# Each trace is a STA moving past APs of one ESS. RSSI follows a log-distance
+# path loss model with Gaussian shadowing and occasional deep fades, sampled
+# every 500 ms like wifi_roaming's default sample_ms. An AP below -95 dBm is
+# not heard and its cell is left empty. The seed is fixed, so the output is
+# stable.
+#
+#   python3 make_traces.py
+#
+
+import math
+import random
+
+P0 = -35.0      # dBm at 1 m
+N = 2.8         # path loss exponent
+FLOOR = -95
+STEP_MS = 500
+
+
+def rssi(rng, distance, sigma, fade):
+    level = P0 - 10 * N * math.log10(max(distance, 1.0)) + rng.gauss(0, sigma)
+    if rng.random() < fade:
+        level -= rng.uniform(8, 15)
+    return int(round(level))
+
+
+def write(name, comment, aps, positions, sigma, fade, seed):
+    rng = random.Random(seed)
+    with open(name, 'w') as f:
+        for line in comment:
+            f.write('# ' + line + '\n')
+        f.write('time_ms,' + ','.join('{}@{}'.format(b, fr) for b, fr, _ in aps) + '\n')
+        for i, x in enumerate(positions):
+            row = []
+            for _, _, ap_x in aps:
+                level = rssi(rng, math.hypot(x - ap_x, 3.0), sigma, fade)
+                row.append(str(level) if level > FLOOR else '')
+            f.write('{},{}\n'.format(i * STEP_MS, ','.join(row)))
+
+
+def path(points, speed):
+    """Positions every STEP_MS along the segments between points at speed m/s"""
+    out = [points[0]]
+    for a, b in zip(points, points[1:]):
+        steps = int(abs(b - a) / speed / (STEP_MS / 1000.0))
+        out += [a + (b - a) * (k + 1) / steps for k in range(steps)]
+    return out
+
+
+AP1 = ('02:00:00:00:00:01', 9025, 0.0)
+AP2 = ('02:00:00:00:00:02', 9065, 45.0)
+AP3 = ('02:00:00:00:00:03', 9105, 90.0)
+
+write('aisle.csv',
+      ['forklift down an aisle past three APs 45 m apart and back, 1.5 m/s'],
+      [AP1, AP2, AP3], [0.0] * 10 + path([0.0, 90.0, 0.0], 1.5) + [0.0] * 10,
+      sigma=2.0, fade=0.02, seed=1)
+
+write('boundary.csv',
+      ['parked half way between two APs, heavy shadowing and fades'],
+      [AP1, AP2], [22.5] * 240,
+      sigma=4.0, fade=0.05, seed=2)
+
+write('drive_away.csv',
+      ['fast exit from one cell into the next, 4 m/s'],
+      [AP1, AP2], [0.0] * 10 + path([0.0, 45.0], 4.0) + [45.0] * 20,
+      sigma=2.0, fade=0.02, seed=3)
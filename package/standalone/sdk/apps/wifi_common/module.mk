@@ -1,3 +1,11 @@
 CSRCS += \
 	wifi_connect_common.c \
-	wifi_config_setup.c
+	wifi_config_setup.c \
+	wifi_roaming_policy.c \
+	wifi_roaming.c \
+	wifi_resume.c \
+	wifi_ps_stats.c \
+	wifi_batch_ring.c \
+	wifi_batch.c \
+	wifi_softap_server.c \
+	wifi_lwip_prof.c
@@ -284,4 +284,29 @@
 
 #define NVS_SAE_PWE "sae_pwe"
 
+/* BSS hint: the AP of the last successful connection, written by the STA */
+/* after connecting. The next connection scans only its frequency first.  */
+/* Erase hint_freq to force a full scan. */
+/* (type string) */
+#define NVS_HINT_BSSID "hint_bssid"
+/* S1G frequency, as reported in AP_INFO */
+/* (type u16) */
+#define NVS_HINT_FREQ "hint_freq"
+/* (type u8) */
+#define NVS_HINT_BW "hint_bw"
+/* beacon interval (TU) */
+/* (type u16) */
+#define NVS_HINT_BCN "hint_bcn"
+/* SSID the hint was learned for, a hint for another SSID is not used */
+/* (type string) */
+#define NVS_HINT_SSID "hint_ssid"
+
+/* Samples of wifi_batch.c waiting to be sent, with WIFI_BATCH_STORE_NVS */
+/* (type blob) */
+#define NVS_BATCH_RING "batch_ring"
+
+/* TLS client sessions kept over deep sleep by wifi_resume_save() */
+/* (type blob) */
+#define NVS_TLS_SESSIONS "tls_sessions"
+
 #endif
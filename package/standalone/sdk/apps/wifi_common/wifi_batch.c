@@ -0,0 +1,218 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "nrc_sdk.h"
+#include "wifi_batch.h"
+#include "wifi_resume.h"
+
+#include "lwip/sockets.h"
+
+#ifdef SUPPORT_NVS_FLASH
+#include <nvs.h>
+#include "nvs_config.h"
+#endif
+
+_Static_assert(sizeof(wifi_batch_ring_t) <= NRC_RETENTION_BATCH_SIZE,
+			   "NRC_RETENTION_BATCH_SIZE too small");
+
+static const wifi_batch_config_t default_config = WIFI_BATCH_CONFIG_DEFAULT;
+
+static struct {
+	bool ready;
+	wifi_batch_config_t config;
+	wifi_batch_store_t store;
+	wifi_batch_ring_t ring;
+} batch;
+
+static nrc_err_t batch_load(void)
+{
+	if (batch.store == WIFI_BATCH_STORE_RETENTION)
+		return nrc_retention_load(NRC_RETENTION_BATCH_OFFSET, &batch.ring, sizeof(batch.ring));
+
+#ifdef SUPPORT_NVS_FLASH
+	{
+		nvs_handle_t handle;
+		size_t length = sizeof(batch.ring);
+		nvs_err_t err;
+
+		if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &handle) != NVS_OK)
+			return NRC_FAIL;
+		err = nvs_get_blob(handle, NVS_BATCH_RING, &batch.ring, &length);
+		nvs_close(handle);
+
+		if (err == NVS_OK && length == sizeof(batch.ring))
+			return NRC_SUCCESS;
+	}
+#endif
+
+	return NRC_FAIL;
+}
+
+static nrc_err_t batch_save(void)
+{
+	wifi_batch_ring_seal(&batch.ring);
+
+	if (batch.store == WIFI_BATCH_STORE_RETENTION)
+		return nrc_retention_save(NRC_RETENTION_BATCH_OFFSET, &batch.ring, sizeof(batch.ring));
+
+#ifdef SUPPORT_NVS_FLASH
+	{
+		nvs_handle_t handle;
+		nvs_err_t err;
+
+		if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &handle) != NVS_OK)
+			return NRC_FAIL;
+		err = nvs_set_blob(handle, NVS_BATCH_RING, &batch.ring, sizeof(batch.ring));
+		if (err == NVS_OK)
+			err = nvs_commit(handle);
+		nvs_close(handle);
+
+		if (err == NVS_OK)
+			return NRC_SUCCESS;
+	}
+#endif
+
+	return NRC_FAIL;
+}
+
+nrc_err_t wifi_batch_init(const wifi_batch_config_t *config, wifi_batch_store_t store)
+{
+	uint8_t boot = NRC_WAKEUP_REASON_COLDBOOT;
+
+	batch.config = config ? *config : default_config;
+	batch.store = store;
+	batch.ready = false;
+
+	if (batch.config.n_fields == 0 || batch.config.n_fields > WIFI_BATCH_FIELDS_MAX)
+		return NRC_FAIL;
+
+#ifndef SUPPORT_NVS_FLASH
+	if (store == WIFI_BATCH_STORE_NVS)
+		return NRC_FAIL;
+#endif
+
+	/* retention memory does not hold anything meaningful after a cold boot */
+	nrc_ps_wakeup_reason(&boot);
+	if ((store == WIFI_BATCH_STORE_RETENTION && boot == NRC_WAKEUP_REASON_COLDBOOT) ||
+		batch_load() != NRC_SUCCESS ||
+		!wifi_batch_ring_valid(&batch.ring, batch.config.n_fields)) {
+		wifi_batch_ring_init(&batch.ring, batch.config.n_fields);
+		if (batch_save() != NRC_SUCCESS)
+			return NRC_FAIL;
+	}
+
+	batch.ready = true;
+	return NRC_SUCCESS;
+}
+
+bool wifi_batch_add(const int32_t *values)
+{
+	uint64_t rtc = 0;
+	uint32_t seq;
+
+	if (!batch.ready)
+		return false;
+
+	nrc_get_rtc(&rtc);
+	seq = wifi_batch_ring_push(&batch.ring, (uint32_t)(rtc / 1000), values);
+	if (batch_save() != NRC_SUCCESS)
+		nrc_usr_print("[%s] sample %u not stored\n", __func__, seq);
+
+	return wifi_batch_ring_due(&batch.ring, &batch.config);
+}
+
+uint16_t wifi_batch_pending(void)
+{
+	return batch.ready ? batch.ring.count : 0;
+}
+
+nrc_err_t wifi_batch_flush(wifi_batch_send_cb send, void *arg)
+{
+	uint8_t *frame;
+	uint16_t count;
+	int len;
+	nrc_err_t ret = NRC_SUCCESS;
+
+	if (!batch.ready || !send)
+		return NRC_FAIL;
+
+	frame = nrc_mem_malloc(WIFI_BATCH_FRAME_MAX);
+	if (!frame)
+		return NRC_FAIL;
+
+	while (batch.ring.count) {
+		len = wifi_batch_encode(&batch.ring, batch.config.delta, frame,
+								WIFI_BATCH_FRAME_MAX, &count);
+		if (len <= 0 || send(frame, len, arg) != 0) {
+			ret = NRC_FAIL;
+			break;
+		}
+		wifi_batch_ring_consume(&batch.ring, count);
+	}
+
+	if (batch_save() != NRC_SUCCESS)
+		ret = NRC_FAIL;
+
+	nrc_mem_free(frame);
+	return ret;
+}
+
+int wifi_batch_send_udp(const uint8_t *frame, size_t len, void *arg)
+{
+	static int sockfd = -1;
+	WIFI_CONFIG *param = arg;
+	struct sockaddr_in addr;
+
+	if (sockfd < 0) {
+		sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (sockfd < 0)
+			return -1;
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(wifi_resume_udp_port(param->remote_addr, param->remote_port));
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+		if (addr.sin_port)
+			bind(sockfd, (struct sockaddr *)&addr, sizeof(addr));
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(param->remote_port);
+		addr.sin_addr.s_addr = inet_addr(param->remote_addr);
+		if (connect(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			close(sockfd);
+			sockfd = -1;
+			return -1;
+		}
+	}
+
+	if (send(sockfd, frame, len, 0) != (int)len) {
+		close(sockfd);
+		sockfd = -1;
+		return -1;
+	}
+
+	return 0;
+}
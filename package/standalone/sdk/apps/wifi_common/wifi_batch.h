@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __WIFI_BATCH_H__
+#define __WIFI_BATCH_H__
+
+#include "wifi_config_setup.h"
+#include "wifi_batch_ring.h"
+
+/*
+ * Store-and-forward of sensor samples across deep sleep.
+ *
+ * A device that wakes to take a reading adds it with wifi_batch_add()
+ * and goes back to sleep without associating, until the pending samples
+ * are due (see wifi_batch_ring_due()). It then connects and sends them in
+ * as few frames as possible with wifi_batch_flush(). The frame format and
+ * the sequence numbers are described in wifi_batch_ring.h.
+ *
+ * The samples are kept in the NRC_RETENTION_BATCH region of retention
+ * memory, or in NVS when they must survive a power loss at the cost of a
+ * flash write per sample.
+ */
+
+typedef enum {
+	WIFI_BATCH_STORE_RETENTION,
+	WIFI_BATCH_STORE_NVS,
+} wifi_batch_store_t;
+
+#define WIFI_BATCH_CONFIG_DEFAULT { \
+	.n_fields = 1, \
+	.delta = true, \
+	.every = 10, \
+}
+
+/* Frames are kept below this, a single UDP datagram without fragmentation */
+#define WIFI_BATCH_FRAME_MAX	512
+
+/*
+ * Sends a frame. Returns 0 once it is handed over, the samples are then
+ * dropped: with UDP, a lost frame shows as a gap in the sequence numbers.
+ * With MQTT, publish it with QoS 1 and return 0 when MQTTPublish()
+ * succeeds.
+ */
+typedef int (*wifi_batch_send_cb)(const uint8_t *frame, size_t len, void *arg);
+
+/*********************************************************************
+ * @fn wifi_batch_init
+ *
+ * @brief Load the pending samples at each boot. They are dropped if the
+ *        store holds none or for another number of fields.
+ *
+ * @param config: NULL for WIFI_BATCH_CONFIG_DEFAULT
+ *
+ * @param store
+ *
+ * @return NRC_SUCCESS, NRC_FAIL if the store is not available
+ **********************************************************************/
+nrc_err_t wifi_batch_init(const wifi_batch_config_t *config, wifi_batch_store_t store);
+
+/*********************************************************************
+ * @fn wifi_batch_add
+ *
+ * @brief Store a sample, timestamped with the RTC
+ *
+ * @param values: n_fields values, in fixed point
+ *
+ * @return true if the pending samples are due to be sent
+ **********************************************************************/
+bool wifi_batch_add(const int32_t *values);
+
+/*********************************************************************
+ * @fn wifi_batch_pending
+ *
+ * @brief Number of samples waiting to be sent
+ *
+ * @return count
+ **********************************************************************/
+uint16_t wifi_batch_pending(void);
+
+/*********************************************************************
+ * @fn wifi_batch_flush
+ *
+ * @brief Send the pending samples, in frames of up to WIFI_BATCH_FRAME_MAX
+ *        bytes. Stops at the first frame send fails on, its samples are
+ *        kept for the next flush.
+ *
+ * @param send, arg: the transport
+ *
+ * @return NRC_SUCCESS if nothing is left pending
+ **********************************************************************/
+nrc_err_t wifi_batch_flush(wifi_batch_send_cb send, void *arg);
+
+/*********************************************************************
+ * @fn wifi_batch_send_udp
+ *
+ * @brief wifi_batch_send_cb sending to remote_addr:remote_port over UDP.
+ *        The socket stays open, so that wifi_resume_save() keeps its port.
+ *
+ * @param frame, len
+ *
+ * @param arg: WIFI_CONFIG ptr
+ *
+ * @return 0 or -1
+ **********************************************************************/
+int wifi_batch_send_udp(const uint8_t *frame, size_t len, void *arg);
+
+#endif /* __WIFI_BATCH_H__ */
@@ -0,0 +1,350 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "wifi_batch_ring.h"
+
+static uint32_t ring_checksum(const wifi_batch_ring_t *ring)
+{
+	const uint8_t *p = (const uint8_t *)ring;
+	size_t end = offsetof(wifi_batch_ring_t, data) + (size_t)ring->capacity * ring->record_size;
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < end; i++) {
+		if (i >= offsetof(wifi_batch_ring_t, checksum) &&
+			i < offsetof(wifi_batch_ring_t, checksum) + sizeof(ring->checksum))
+			continue;
+		h = (h ^ p[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t *record(const wifi_batch_ring_t *ring, uint16_t i)
+{
+	return (uint8_t *)ring->data + ((ring->head + i) % ring->capacity) * ring->record_size;
+}
+
+int wifi_batch_ring_init(wifi_batch_ring_t *ring, uint8_t n_fields)
+{
+	if (n_fields == 0 || n_fields > WIFI_BATCH_FIELDS_MAX)
+		return -1;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->magic = WIFI_BATCH_MAGIC;
+	ring->version = WIFI_BATCH_RING_VERSION;
+	ring->n_fields = n_fields;
+	ring->record_size = 4 * (1 + n_fields);
+	ring->capacity = sizeof(ring->data) / ring->record_size;
+	wifi_batch_ring_seal(ring);
+
+	return 0;
+}
+
+bool wifi_batch_ring_valid(const wifi_batch_ring_t *ring, uint8_t n_fields)
+{
+	return ring->magic == WIFI_BATCH_MAGIC && ring->version == WIFI_BATCH_RING_VERSION &&
+		   ring->n_fields == n_fields && ring->record_size == 4 * (1 + n_fields) &&
+		   ring->capacity == sizeof(ring->data) / ring->record_size &&
+		   ring->head < ring->capacity && ring->count <= ring->capacity &&
+		   ring->checksum == ring_checksum(ring);
+}
+
+void wifi_batch_ring_seal(wifi_batch_ring_t *ring)
+{
+	ring->checksum = ring_checksum(ring);
+}
+
+uint32_t wifi_batch_ring_push(wifi_batch_ring_t *ring, uint32_t t, const int32_t *v)
+{
+	uint8_t *p;
+	int i;
+
+	if (ring->count == ring->capacity) {
+		ring->head = (ring->head + 1) % ring->capacity;
+		ring->count--;
+		ring->dropped++;
+	}
+
+	p = record(ring, ring->count);
+	put_u32(p, t);
+	for (i = 0; i < ring->n_fields; i++)
+		put_u32(p + 4 * (1 + i), (uint32_t)v[i]);
+	ring->count++;
+
+	return ring->next_seq++;
+}
+
+int wifi_batch_ring_get(const wifi_batch_ring_t *ring, uint16_t i, wifi_batch_sample_t *sample)
+{
+	const uint8_t *p;
+	int f;
+
+	if (i >= ring->count)
+		return -1;
+
+	p = record(ring, i);
+	memset(sample, 0, sizeof(*sample));
+	sample->seq = ring->next_seq - ring->count + i;
+	sample->t = get_u32(p);
+	for (f = 0; f < ring->n_fields; f++)
+		sample->v[f] = (int32_t)get_u32(p + 4 * (1 + f));
+
+	return 0;
+}
+
+bool wifi_batch_ring_due(const wifi_batch_ring_t *ring, const wifi_batch_config_t *config)
+{
+	wifi_batch_sample_t last;
+	int f;
+
+	if (ring->count == 0)
+		return false;
+	if (ring->count >= config->every || ring->count == ring->capacity)
+		return true;
+	if (!ring->has_sent)
+		return false;
+
+	wifi_batch_ring_get(ring, ring->count - 1, &last);
+	for (f = 0; f < ring->n_fields; f++) {
+		int64_t diff = (int64_t)last.v[f] - ring->sent[f];
+
+		if (config->threshold[f] && (diff >= config->threshold[f] || -diff >= config->threshold[f]))
+			return true;
+	}
+
+	return false;
+}
+
+void wifi_batch_ring_consume(wifi_batch_ring_t *ring, uint16_t n)
+{
+	wifi_batch_sample_t last;
+
+	if (n > ring->count)
+		n = ring->count;
+	if (n == 0)
+		return;
+
+	wifi_batch_ring_get(ring, n - 1, &last);
+	memcpy(ring->sent, last.v, sizeof(ring->sent));
+	ring->has_sent = 1;
+
+	ring->head = (ring->head + n) % ring->capacity;
+	ring->count -= n;
+}
+
+/* Encoding */
+
+static int put_varint(uint8_t *p, size_t len, uint32_t v)
+{
+	size_t n = 0;
+
+	do {
+		if (n == len)
+			return -1;
+		p[n] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+		v >>= 7;
+		n++;
+	} while (v);
+
+	return n;
+}
+
+static int get_varint(const uint8_t *p, size_t len, uint32_t *v)
+{
+	size_t n;
+
+	*v = 0;
+	for (n = 0; n < len && n < 5; n++) {
+		*v |= (uint32_t)(p[n] & 0x7f) << (7 * n);
+		if (!(p[n] & 0x80))
+			return n + 1;
+	}
+
+	return -1;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static int encode_sample(const wifi_batch_sample_t *s, const wifi_batch_sample_t *prev,
+						 uint8_t n_fields, bool delta, uint8_t *p, size_t len)
+{
+	size_t n = 0;
+	int r, f;
+
+	if (!delta) {
+		if (len < 4 * (1 + (size_t)n_fields))
+			return -1;
+		put_u32(p, s->t);
+		for (f = 0; f < n_fields; f++)
+			put_u32(p + 4 * (1 + f), (uint32_t)s->v[f]);
+		return 4 * (1 + n_fields);
+	}
+
+	r = put_varint(p, len, zigzag((int32_t)(s->t - prev->t)));
+	if (r < 0)
+		return -1;
+	n += r;
+
+	for (f = 0; f < n_fields; f++) {
+		r = put_varint(p + n, len - n, zigzag((int32_t)((uint32_t)s->v[f] - (uint32_t)prev->v[f])));
+		if (r < 0)
+			return -1;
+		n += r;
+	}
+
+	return n;
+}
+
+int wifi_batch_encode(const wifi_batch_ring_t *ring, bool delta, uint8_t *buf, size_t len,
+					  uint16_t *count)
+{
+	wifi_batch_sample_t s, prev;
+	size_t n = 0, count_at;
+	uint16_t i;
+	int r;
+
+	*count = 0;
+	if (ring->count == 0)
+		return 0;
+	if (len < WIFI_BATCH_HEADER_MAX + WIFI_BATCH_SAMPLE_MAX)
+		return -1;
+
+	wifi_batch_ring_get(ring, 0, &prev);
+	memset(prev.v, 0, sizeof(prev.v));
+
+	buf[n++] = (WIFI_BATCH_FRAME_VERSION << 4) | (delta ? WIFI_BATCH_FLAG_DELTA : 0);
+	buf[n++] = ring->n_fields;
+	n += put_varint(buf + n, len - n, prev.seq);
+	/* the count goes here, once known, as a fixed 3-byte varint */
+	count_at = n;
+	n += 3;
+	n += put_varint(buf + n, len - n, prev.t);
+
+	for (i = 0; i < ring->count; i++) {
+		wifi_batch_ring_get(ring, i, &s);
+		r = encode_sample(&s, &prev, ring->n_fields, delta, buf + n, len - n);
+		if (r < 0)
+			break;
+		n += r;
+		prev = s;
+	}
+
+	buf[count_at] = 0x80 | (i & 0x7f);
+	buf[count_at + 1] = 0x80 | ((i >> 7) & 0x7f);
+	buf[count_at + 2] = (i >> 14) & 0x7f;
+
+	*count = i;
+	return n;
+}
+
+int wifi_batch_decode(const uint8_t *buf, size_t len, wifi_batch_frame_t *frame,
+					  wifi_batch_sample_t *samples, int max)
+{
+	wifi_batch_sample_t prev;
+	uint32_t v, t0;
+	size_t n = 0;
+	int i, f, r;
+
+	if (len < 2)
+		return -1;
+
+	memset(frame, 0, sizeof(*frame));
+	frame->version = buf[0] >> 4;
+	frame->flags = buf[0] & 0x0f;
+	frame->n_fields = buf[1];
+	n = 2;
+	if (frame->version != WIFI_BATCH_FRAME_VERSION || frame->n_fields == 0 ||
+		frame->n_fields > WIFI_BATCH_FIELDS_MAX)
+		return -1;
+
+	if ((r = get_varint(buf + n, len - n, &frame->seq)) < 0)
+		return -1;
+	n += r;
+	if ((r = get_varint(buf + n, len - n, &v)) < 0 || v > UINT16_MAX || (int)v > max)
+		return -1;
+	n += r;
+	frame->count = v;
+	if ((r = get_varint(buf + n, len - n, &t0)) < 0)
+		return -1;
+	n += r;
+
+	memset(&prev, 0, sizeof(prev));
+	prev.t = t0;
+
+	for (i = 0; i < frame->count; i++) {
+		wifi_batch_sample_t *s = &samples[i];
+
+		memset(s, 0, sizeof(*s));
+		s->seq = frame->seq + i;
+
+		if (!(frame->flags & WIFI_BATCH_FLAG_DELTA)) {
+			if (len - n < 4 * (1 + (size_t)frame->n_fields))
+				return -1;
+			s->t = get_u32(buf + n);
+			for (f = 0; f < frame->n_fields; f++)
+				s->v[f] = (int32_t)get_u32(buf + n + 4 * (1 + f));
+			n += 4 * (1 + frame->n_fields);
+			continue;
+		}
+
+		if ((r = get_varint(buf + n, len - n, &v)) < 0)
+			return -1;
+		n += r;
+		s->t = prev.t + (uint32_t)unzigzag(v);
+		for (f = 0; f < frame->n_fields; f++) {
+			if ((r = get_varint(buf + n, len - n, &v)) < 0)
+				return -1;
+			n += r;
+			s->v[f] = (int32_t)((uint32_t)prev.v[f] + (uint32_t)unzigzag(v));
+		}
+		prev = *s;
+	}
+
+	return n == len ? frame->count : -1;
+}
@@ -0,0 +1,236 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __WIFI_BATCH_RING_H__
+#define __WIFI_BATCH_RING_H__
+
+/*
+ * Sample ring and frame codec of the store-and-forward batching
+ * (wifi_batch.c), kept free of SDK calls so that it can be tested on a host
+ * (see host/batch_test.c).
+ *
+ * A sample is a timestamp in seconds and up to WIFI_BATCH_FIELDS_MAX signed
+ * fixed-point fields. Each sample gets a sequence number when it is pushed.
+ * When the ring is full the oldest sample is overwritten, and its sequence
+ * number is never sent.
+ *
+ * A frame carries consecutive samples:
+ *
+ *   u8      version << 4 | flags
+ *   u8      number of fields
+ *   varint  sequence number of the first sample
+ *   varint  number of samples, padded to 3 bytes
+ *   varint  time of the first sample
+ *   samples
+ *
+ * With WIFI_BATCH_FLAG_DELTA each sample is the zigzag varint of its time
+ * and of each field, minus those of the previous sample (the first sample
+ * is taken against 0 for the fields). Without it, each sample is a u32 time
+ * and s32 fields, little-endian.
+ *
+ * The receiver keeps the next sequence number it expects. A frame that
+ * starts further on shows how many samples were lost, either in a lost
+ * frame or overwritten in the ring. A frame that starts before it is a
+ * retransmission, and its known samples are dropped.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WIFI_BATCH_FIELDS_MAX	4
+
+#ifndef WIFI_BATCH_RING_BYTES
+#define WIFI_BATCH_RING_BYTES	384
+#endif
+
+#define WIFI_BATCH_MAGIC		0x48544142	/* "BATH" */
+#define WIFI_BATCH_RING_VERSION	1
+#define WIFI_BATCH_FRAME_VERSION	1
+
+#define WIFI_BATCH_FLAG_DELTA	0x01
+
+/* Largest encoding of a sample, and of the frame header */
+#define WIFI_BATCH_SAMPLE_MAX	(5 * (1 + WIFI_BATCH_FIELDS_MAX))
+#define WIFI_BATCH_HEADER_MAX	(2 + 5 * 3)
+
+typedef struct {
+	uint8_t n_fields;		/* 1..WIFI_BATCH_FIELDS_MAX */
+	bool delta;			/* delta-encode the frames */
+	uint16_t every;			/* send once this many samples are pending */
+	/* send early when a field moved this much from the last value sent, 0 disables */
+	uint32_t threshold[WIFI_BATCH_FIELDS_MAX];
+} wifi_batch_config_t;
+
+typedef struct {
+	uint32_t seq;
+	uint32_t t;
+	int32_t v[WIFI_BATCH_FIELDS_MAX];
+} wifi_batch_sample_t;
+
+/* Stored as is in retention memory or NVS */
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint8_t n_fields;
+	uint8_t record_size;		/* bytes per sample in data */
+	uint16_t capacity;		/* samples */
+	uint16_t head;			/* oldest sample */
+	uint16_t count;
+	uint8_t has_sent;		/* sent[] is valid */
+	uint8_t reserved;
+	uint32_t next_seq;
+	uint32_t dropped;		/* overwritten before being sent */
+	int32_t sent[WIFI_BATCH_FIELDS_MAX];	/* fields of the last sample sent */
+	uint32_t checksum;
+	uint8_t data[WIFI_BATCH_RING_BYTES];
+} wifi_batch_ring_t;
+
+typedef struct {
+	uint8_t version;
+	uint8_t flags;
+	uint8_t n_fields;
+	uint32_t seq;
+	uint16_t count;
+} wifi_batch_frame_t;
+
+/*********************************************************************
+ * @fn wifi_batch_ring_init
+ *
+ * @brief Empty the ring, sequence numbers start over from 0
+ *
+ * @param ring
+ *
+ * @param n_fields: fields per sample
+ *
+ * @return 0, or -1 if n_fields is out of range
+ **********************************************************************/
+int wifi_batch_ring_init(wifi_batch_ring_t *ring, uint8_t n_fields);
+
+/*********************************************************************
+ * @fn wifi_batch_ring_valid
+ *
+ * @brief Check a ring read back from storage
+ *
+ * @param ring
+ *
+ * @param n_fields: fields per sample expected
+ *
+ * @return true if it can be used
+ **********************************************************************/
+bool wifi_batch_ring_valid(const wifi_batch_ring_t *ring, uint8_t n_fields);
+
+/*********************************************************************
+ * @fn wifi_batch_ring_seal
+ *
+ * @brief Update the checksum before the ring is stored
+ *
+ * @return none
+ **********************************************************************/
+void wifi_batch_ring_seal(wifi_batch_ring_t *ring);
+
+/*********************************************************************
+ * @fn wifi_batch_ring_push
+ *
+ * @brief Append a sample, overwriting the oldest one if the ring is full
+ *
+ * @param ring
+ *
+ * @param t: time in seconds
+ *
+ * @param v: n_fields values
+ *
+ * @return Sequence number of the sample
+ **********************************************************************/
+uint32_t wifi_batch_ring_push(wifi_batch_ring_t *ring, uint32_t t, const int32_t *v);
+
+/*********************************************************************
+ * @fn wifi_batch_ring_get
+ *
+ * @brief Read the i-th oldest sample
+ *
+ * @return 0, or -1 if there are not that many
+ **********************************************************************/
+int wifi_batch_ring_get(const wifi_batch_ring_t *ring, uint16_t i, wifi_batch_sample_t *sample);
+
+/*********************************************************************
+ * @fn wifi_batch_ring_due
+ *
+ * @brief Whether the pending samples should be sent now: 'every' samples
+ *        are pending, the ring is full, or the newest sample moved a field
+ *        by its threshold since the last sample sent
+ *
+ * @return true to send
+ **********************************************************************/
+bool wifi_batch_ring_due(const wifi_batch_ring_t *ring, const wifi_batch_config_t *config);
+
+/*********************************************************************
+ * @fn wifi_batch_ring_consume
+ *
+ * @brief Drop the n oldest samples once they have been sent
+ *
+ * @return none
+ **********************************************************************/
+void wifi_batch_ring_consume(wifi_batch_ring_t *ring, uint16_t n);
+
+/*********************************************************************
+ * @fn wifi_batch_encode
+ *
+ * @brief Encode the oldest samples into a frame
+ *
+ * @param ring
+ *
+ * @param delta: delta-encode
+ *
+ * @param buf, len: the frame buffer, at least WIFI_BATCH_HEADER_MAX +
+ *        WIFI_BATCH_SAMPLE_MAX bytes to hold a sample
+ *
+ * @param count: number of samples that fit, to pass to
+ *        wifi_batch_ring_consume() once the frame is sent
+ *
+ * @return Length of the frame, 0 if the ring is empty, -1 if buf is too
+ *         small
+ **********************************************************************/
+int wifi_batch_encode(const wifi_batch_ring_t *ring, bool delta, uint8_t *buf, size_t len,
+					  uint16_t *count);
+
+/*********************************************************************
+ * @fn wifi_batch_decode
+ *
+ * @brief Decode a frame
+ *
+ * @param buf, len: the frame
+ *
+ * @param frame: the header
+ *
+ * @param samples, max: room for the samples
+ *
+ * @return Number of samples, or -1 if the frame is malformed or there is
+ *         not enough room
+ **********************************************************************/
+int wifi_batch_decode(const uint8_t *buf, size_t len, wifi_batch_frame_t *frame,
+					  wifi_batch_sample_t *samples, int max);
+
+#endif /* __WIFI_BATCH_RING_H__ */
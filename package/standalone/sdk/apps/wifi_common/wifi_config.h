@@ -331,6 +331,30 @@
 #define NRC_DHCP_TIMEOUT	60
 #endif /* NRC_DHCP_TIMEOUT */
 
+/**
+ * Fast reconnect. After a successful connection the BSSID, frequency, bandwidth
+ * and beacon interval of the AP are kept in NVS, and the next connection scans
+ * only that frequency. If that does not connect within NRC_WIFI_FAST_CONNECT_TIMEOUT
+ * (ms), the hint is dropped and the connection falls back to the full scan list.
+ */
+#ifndef NRC_WIFI_FAST_CONNECT
+#define NRC_WIFI_FAST_CONNECT	1
+#endif /* NRC_WIFI_FAST_CONNECT */
+
+#ifndef NRC_WIFI_FAST_CONNECT_TIMEOUT
+#define NRC_WIFI_FAST_CONNECT_TIMEOUT	5000
+#endif /* NRC_WIFI_FAST_CONNECT_TIMEOUT */
+
+/**
+ * Warm resume. wifi_resume_save() keeps the address, the DHCP lease, the
+ * gateway's ARP entry and the connected UDP ports in retention memory before
+ * a deep sleep. The first connection after the wakeup puts them back instead
+ * of running DHCP, and falls back to DHCP if the snapshot is not usable.
+ */
+#ifndef NRC_WIFI_WARM_RESUME
+#define NRC_WIFI_WARM_RESUME	1
+#endif /* NRC_WIFI_WARM_RESUME */
+
 /**
  * In wireless networking, an AP is considered idle if there are no active connections to it.
  * The WIFI_BSS_MAX_IDLE directive sets the time duration in seconds that an AP will remain active
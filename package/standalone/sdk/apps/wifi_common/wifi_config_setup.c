@@ -32,6 +32,7 @@
 #include "nvs_config.h"
 #endif
 #include "crypto/sha1.h"
+#include <ctype.h>
 
 #define DISPLAY_WIFI_CONFIG_SETTING 0
 
@@ -431,6 +432,9 @@ bool nrc_set_default_scan_channel(WIFI_CONFIG *wifi_config)
  *
  * @brief generate PMK
  *
+ * PBKDF2 for a passphrase of 8..63 characters. A 64-digit hex string is
+ * already the PSK and is copied as it is.
+ *
  * @param ssid
  *
  * @param passphrase
@@ -442,25 +446,36 @@ bool nrc_set_default_scan_channel(WIFI_CONFIG *wifi_config)
 static int nrc_generate_pmk(char* ssid, const char *passphrase, char *pmk)
 {
 	int ssid_len;
+	int passphrase_len;
 	const int iterations = 4096;
 	const int pmk_len = 32;
-	char pmk_hash[32];
-	char buf[64];
+	uint8_t pmk_hash[32];
 
 	if(ssid == NULL || passphrase == NULL || pmk == NULL)
 		return false;
 
 	ssid_len = strlen(ssid);
+	passphrase_len = strlen(passphrase);
+
+	if (passphrase_len == MAX_PMK_LENGTH) {
+		for (int i = 0; i < passphrase_len; i++) {
+			if (!isxdigit((unsigned char)passphrase[i]))
+				return false;
+		}
+		strcpy(pmk, passphrase);
+		return true;
+	}
+
+	if (passphrase_len < 8 || passphrase_len > 63)
+		return false;
 
 	if (pbkdf2_sha1(passphrase, (const u8 *)ssid, ssid_len, iterations, (u8 *)pmk_hash, pmk_len) < 0) {
 		E(TT_SDK_WIFI, "PMK generation is failed\n");
 		return false;
 	}
 
-	for (int i =0; i<32; i++){
-		sprintf(buf, "%02x",pmk_hash[i]);
-		strcat(pmk, buf);
-	}
+	for (int i =0; i<32; i++)
+		sprintf(pmk + 2 * i, "%02x", pmk_hash[i]);
 
 	V(TT_SDK_WIFI, "PMK for %s based on passphrase '%s'\n", ssid , passphrase);
 	V(TT_SDK_WIFI, "psk_value : %s\n", pmk);
@@ -566,6 +581,36 @@ static nrc_err_t load_wifi_config_from_nvs(WIFI_CONFIG *wifi_config)
 	nvs_get_u8(nvs_handle, NVS_PS_DEEPSLEEP_MODE, (uint8_t*)&wifi_config->ps_mode);
 	nvs_get_u16(nvs_handle, NVS_PS_IDLE_TIMEOUT, (uint16_t*)&wifi_config->ps_idle);
 	nvs_get_u32(nvs_handle, NVS_PS_SLEEP_TIME, (uint32_t*)&wifi_config->ps_sleep);
+
+	nvs_get_u16(nvs_handle, NVS_HINT_FREQ, &wifi_config->fast_scan_freq);
+	nvs_get_u8(nvs_handle, NVS_HINT_BW, &wifi_config->fast_scan_bw);
+	nvs_get_u16(nvs_handle, NVS_HINT_BCN, &wifi_config->fast_scan_bcn);
+	length = sizeof(wifi_config->fast_scan_bssid);
+	nvs_get_str(nvs_handle, NVS_HINT_BSSID, (char *) wifi_config->fast_scan_bssid, &length);
+	length = sizeof(wifi_config->fast_scan_ssid);
+	nvs_get_str(nvs_handle, NVS_HINT_SSID, (char *) wifi_config->fast_scan_ssid, &length);
+
+	/* Derive the PMK once and keep it with the SSID and passphrase it was derived
+	 * from; a PMK without them was set by the user and is used as it is. */
+	if (wifi_config->security_mode == WIFI_SEC_WPA2 && wifi_config->eap_type == 0 &&
+		strlen((char *)wifi_config->password) > 0 &&
+		(strlen((char *)wifi_config->pmk) == 0 ||
+		 (strlen((char *)wifi_config->pmk_ssid) > 0 &&
+		  (strcmp((char *)wifi_config->pmk_ssid, (char *)wifi_config->ssid) != 0 ||
+		   strcmp((char *)wifi_config->pmk_pw, (char *)wifi_config->password) != 0)))) {
+		if (nrc_generate_pmk((char *)wifi_config->ssid, (char *)wifi_config->password,
+				(char *)wifi_config->pmk)) {
+			strcpy((char *)wifi_config->pmk_ssid, (char *)wifi_config->ssid);
+			strcpy((char *)wifi_config->pmk_pw, (char *)wifi_config->password);
+			nvs_set_str(nvs_handle, NVS_WIFI_PMK, (char *)wifi_config->pmk);
+			nvs_set_str(nvs_handle, NVS_WIFI_PMK_SSID, (char *)wifi_config->pmk_ssid);
+			nvs_set_str(nvs_handle, NVS_WIFI_PMK_PASSWORD, (char *)wifi_config->pmk_pw);
+			nvs_commit(nvs_handle);
+		} else {
+			wifi_config->pmk[0] = '\0';
+		}
+	}
+
 	err = nvs_get_blob(nvs_handle, NVS_EAP_CA_CERT, NULL, &length);
 	if (err == NVS_OK && length > 0) {
 		ca_cert = nrc_mem_malloc(length);
@@ -740,6 +785,11 @@ nrc_err_t nrc_erase_all_wifi_nvs(void)
 	nvs_erase_key(nvs_handle, NVS_PS_DEEPSLEEP_MODE);
 	nvs_erase_key(nvs_handle, NVS_PS_IDLE_TIMEOUT);
 	nvs_erase_key(nvs_handle, NVS_PS_SLEEP_TIME);
+	nvs_erase_key(nvs_handle, NVS_HINT_BSSID);
+	nvs_erase_key(nvs_handle, NVS_HINT_FREQ);
+	nvs_erase_key(nvs_handle, NVS_HINT_BW);
+	nvs_erase_key(nvs_handle, NVS_HINT_BCN);
+	nvs_erase_key(nvs_handle, NVS_HINT_SSID);
 
 	if (nvs_handle)
 		nvs_close(nvs_handle);
@@ -785,6 +835,132 @@ nrc_err_t nrc_erase_all_wifi_nvs(void)
 #endif
  }
 
+/*********************************************************************
+ * @brief nrc_save_bss_hint
+ *
+ * Keep the AP of the last connection in NVS and retention memory
+ *
+ * @param wifi configuration ptr
+ * @returns nrc_err_t
+ **********************************************************************/
+nrc_err_t nrc_save_bss_hint(WIFI_CONFIG* wifi_config)
+{
+	uint16_t ret_user_data_size = nrc_ps_get_available_user_data_size();
+#ifdef SUPPORT_NVS_FLASH
+	nvs_handle_t nvs_handle;
+
+	if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &nvs_handle) != NVS_OK) {
+		A("nvs open failed.\n");
+		return NRC_FAIL;
+	}
+
+	nvs_set_str(nvs_handle, NVS_HINT_BSSID, (char *)wifi_config->fast_scan_bssid);
+	nvs_set_u16(nvs_handle, NVS_HINT_FREQ, wifi_config->fast_scan_freq);
+	nvs_set_u8(nvs_handle, NVS_HINT_BW, wifi_config->fast_scan_bw);
+	nvs_set_u16(nvs_handle, NVS_HINT_BCN, wifi_config->fast_scan_bcn);
+	nvs_set_str(nvs_handle, NVS_HINT_SSID, (char *)wifi_config->fast_scan_ssid);
+	nvs_commit(nvs_handle);
+	nvs_close(nvs_handle);
+#endif /* SUPPORT_NVS_FLASH */
+
+	/* the copy restored on wakeup was saved at cold boot */
+	if (ret_user_data_size > 0 && ret_user_data_size >= sizeof(WIFI_CONFIG))
+		return nrc_retention_save(0, wifi_config, sizeof(WIFI_CONFIG));
+
+	return NRC_SUCCESS;
+}
+
+/* Bytes of retention memory to rewrite for a region ending at 'end' */
+static uint16_t retention_extent(uint32_t end)
+{
+	uint16_t avail = nrc_ps_get_available_user_data_size();
+
+	if (end > avail)
+		return 0;
+	if (NRC_RETENTION_SIZE > end && NRC_RETENTION_SIZE <= avail)
+		return NRC_RETENTION_SIZE;
+	return end;
+}
+
+/*********************************************************************
+ * @brief nrc_retention_save
+ *
+ * Write a region of the user data in retention memory
+ *
+ * @param offset, data, size
+ * @returns nrc_err_t
+ **********************************************************************/
+nrc_err_t nrc_retention_save(uint16_t offset, const void *data, uint16_t size)
+{
+	uint16_t extent = retention_extent((uint32_t)offset + size);
+	nrc_err_t ret;
+	uint8_t *buf;
+
+	if (extent == 0)
+		return NRC_FAIL;
+
+	buf = nrc_mem_malloc(extent);
+	if (!buf)
+		return NRC_FAIL;
+
+	/* the regions around this one are written back as they are */
+	if (nrc_ps_load_user_data(buf, extent) != NRC_SUCCESS)
+		memset(buf, 0, extent);
+	memcpy(buf + offset, data, size);
+	ret = nrc_ps_save_user_data(buf, extent);
+
+	nrc_mem_free(buf);
+	return ret;
+}
+
+/*********************************************************************
+ * @brief nrc_retention_load
+ *
+ * Read a region of the user data in retention memory
+ *
+ * @param offset, data, size
+ * @returns nrc_err_t
+ **********************************************************************/
+nrc_err_t nrc_retention_load(uint16_t offset, void *data, uint16_t size)
+{
+	uint32_t end = (uint32_t)offset + size;
+	nrc_err_t ret;
+	uint8_t *buf;
+
+	if (end > nrc_ps_get_available_user_data_size())
+		return NRC_FAIL;
+
+	buf = nrc_mem_malloc(end);
+	if (!buf)
+		return NRC_FAIL;
+
+	ret = nrc_ps_load_user_data(buf, end);
+	if (ret == NRC_SUCCESS)
+		memcpy(data, buf + offset, size);
+
+	nrc_mem_free(buf);
+	return ret;
+}
+
+/*********************************************************************
+ * @brief nrc_clear_bss_hint
+ *
+ * Forget the AP of the last connection
+ *
+ * @param wifi configuration ptr
+ * @returns nrc_err_t
+ **********************************************************************/
+nrc_err_t nrc_clear_bss_hint(WIFI_CONFIG* wifi_config)
+{
+	wifi_config->fast_scan_freq = 0;
+	wifi_config->fast_scan_bw = 0;
+	wifi_config->fast_scan_bcn = 0;
+	memset(wifi_config->fast_scan_bssid, 0, sizeof(wifi_config->fast_scan_bssid));
+	memset(wifi_config->fast_scan_ssid, 0, sizeof(wifi_config->fast_scan_ssid));
+
+	return nrc_save_bss_hint(wifi_config);
+}
+
  /*********************************************************************
  * @brief get global config
  *
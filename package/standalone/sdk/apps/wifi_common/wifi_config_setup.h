@@ -79,6 +79,9 @@ typedef struct  {
 	uint8_t scan_mode;
 	uint16_t fast_scan_freq;
 	uint8_t fast_scan_bssid[MAX_BSSID_LENGTH + 1];
+	uint8_t fast_scan_bw;
+	uint16_t fast_scan_bcn;
+	uint8_t fast_scan_ssid[MAX_SSID_LENGTH + 1];
 	uint8_t eap_type;
 	uint8_t identity[MAX_SSID_LENGTH + 1];
 	uint8_t private_key_password[MAX_PW_LENGTH + 1];
@@ -97,6 +100,21 @@ typedef struct  {
 }WIFI_CONFIG;
 #define WIFI_CONFIG_SIZE	sizeof (WIFI_CONFIG)
 
+/*
+ * User data in retention memory. The wifi configuration comes first, it is
+ * restored from there by nrc_wifi_set_config() on wakeup. The regions after
+ * it belong to other modules and go through nrc_retention_save/load().
+ */
+#define NRC_RETENTION_PS_STATS_OFFSET	WIFI_CONFIG_SIZE
+#define NRC_RETENTION_PS_STATS_SIZE	448
+#define NRC_RETENTION_RESUME_OFFSET	(NRC_RETENTION_PS_STATS_OFFSET + NRC_RETENTION_PS_STATS_SIZE)
+#define NRC_RETENTION_RESUME_SIZE	160
+#define NRC_RETENTION_BATCH_OFFSET	(NRC_RETENTION_RESUME_OFFSET + NRC_RETENTION_RESUME_SIZE)
+#define NRC_RETENTION_BATCH_SIZE	448
+#define NRC_RETENTION_DNS_OFFSET	(NRC_RETENTION_BATCH_OFFSET + NRC_RETENTION_BATCH_SIZE)
+#define NRC_RETENTION_DNS_SIZE		256
+#define NRC_RETENTION_SIZE		(NRC_RETENTION_DNS_OFFSET + NRC_RETENTION_DNS_SIZE)
+
 /*********************************************************************
  * @fn nrc_save_wifi_config
  *
@@ -170,6 +188,60 @@ nrc_err_t nrc_erase_all_wifi_nvs(void);
  nrc_err_t nrc_erase_eap_certificate_nvs(void);
 
 
+/*********************************************************************
+ * @fn nrc_save_bss_hint
+ *
+ * @brief Keep the AP of the last connection (fast_scan_*) in NVS and
+ *        retention memory, so that the next connection scans its channel first
+ *
+ * @param wifi configuration ptr
+ *
+ * @return nrc_err_t
+ **********************************************************************/
+nrc_err_t nrc_save_bss_hint(WIFI_CONFIG* wifi_config);
+
+
+/*********************************************************************
+ * @fn nrc_clear_bss_hint
+ *
+ * @brief Forget the AP of the last connection
+ *
+ * @param wifi configuration ptr
+ *
+ * @return nrc_err_t
+ **********************************************************************/
+nrc_err_t nrc_clear_bss_hint(WIFI_CONFIG* wifi_config);
+
+
+/*********************************************************************
+ * @fn nrc_retention_save
+ *
+ * @brief Write a region of the user data in retention memory, leaving the
+ *        other regions as they are
+ *
+ * @param offset: NRC_RETENTION_*_OFFSET
+ *
+ * @param data, size: the content of the region
+ *
+ * @return nrc_err_t
+ **********************************************************************/
+nrc_err_t nrc_retention_save(uint16_t offset, const void *data, uint16_t size);
+
+
+/*********************************************************************
+ * @fn nrc_retention_load
+ *
+ * @brief Read a region of the user data in retention memory
+ *
+ * @param offset: NRC_RETENTION_*_OFFSET
+ *
+ * @param data, size: buffer for the region
+ *
+ * @return nrc_err_t
+ **********************************************************************/
+nrc_err_t nrc_retention_load(uint16_t offset, void *data, uint16_t size);
+
+
 /*********************************************************************
  * @fn nrc_get_global_wifi_config
  *
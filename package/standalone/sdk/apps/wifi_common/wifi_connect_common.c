@@ -26,8 +26,11 @@
 #include "nrc_sdk.h"
 #include "wifi_config.h"
 #include "wifi_connect_common.h"
+#include "wifi_resume.h"
+#include "wifi_ps_stats.h"
 
 #include "driver_nrc.h"
+#include "ctrl_iface_freeRTOS.h"
 #ifdef SUPPORT_ETHERNET_ACCESSPOINT
 #include "nrc_eth_if.h"
 #endif
@@ -54,6 +57,26 @@ static uint32_t conn_wait_ms = 60 * 1000;
 #define MAX_CNT 100
 //#define MAX_CNT 9999
 
+/* Phase timing of the connection requested by wifi_connect_with_vif */
+static bool conn_report[NRC_WPA_NUM_INTERFACES];
+static bool conn_fast[NRC_WPA_NUM_INTERFACES];
+
+static void wifi_conn_time_report(int vif, uint32_t dhcp_ms)
+{
+	ctrl_iface_conn_time_t t;
+
+	if (!conn_report[vif])
+		return;
+	conn_report[vif] = false;
+
+	if (!wpas_conn_time_get(vif, &t))
+		return;
+
+	nrc_usr_print("[%s] %s scan %u ms (%u), auth %u ms, assoc %u ms, 4-way %u ms, dhcp %u ms\n",
+		__func__, conn_fast[vif] ? "fast" : "full", t.scan_ms, t.scans,
+		t.auth_ms, t.assoc_ms, t.key_ms, dhcp_ms);
+}
+
 static void wifi_event_handler(int vif, tWIFI_EVENT_ID event, int data_len, void *data)
 {
 	char* ip_addr = NULL;
@@ -67,6 +90,7 @@ static void wifi_event_handler(int vif, tWIFI_EVENT_ID event, int data_len, void
 #if defined(INCLUDE_TRACE_WAKEUP)
 			nrc_usr_print("[%s] Receive Connection Success Event for Interface %d\n", __func__, vif);
 #endif
+			wifi_ps_stats_mark(WIFI_PS_PHASE_CONNECT);
 
 			if (!netif_is_link_up(nrc_netif[vif])) {
 				netif_set_link_up(nrc_netif[vif]);
@@ -85,7 +109,17 @@ static void wifi_event_handler(int vif, tWIFI_EVENT_ID event, int data_len, void
 
 			nrc_wifi_get_ip_mode(vif, &ip_mode);
 			if (ip_mode == WIFI_DYNAMIC_IP) {
-				ret = nrc_wifi_set_ip_address(vif, ip_mode, wifi_config->dhcp_timeout, NULL, NULL, NULL);
+				uint32_t dhcp_start = sys_now();
+
+#if NRC_WIFI_WARM_RESUME
+				ret = wifi_resume_restore(vif);
+				if (ret != WIFI_SUCCESS)
+#endif
+					ret = nrc_wifi_set_ip_address(vif, ip_mode, wifi_config->dhcp_timeout, NULL, NULL, NULL);
+				if (ret == WIFI_SUCCESS) {
+					wifi_ps_stats_mark(WIFI_PS_PHASE_IP);
+					wifi_conn_time_report(vif, sys_now() - dhcp_start);
+				}
 			} else {
 				ret = nrc_wifi_set_ip_address(vif, ip_mode, 0, static_ip4, static_netmask, static_gateway);
 				if(ret != WIFI_SUCCESS) {
@@ -94,6 +128,8 @@ static void wifi_event_handler(int vif, tWIFI_EVENT_ID event, int data_len, void
 					nrc_usr_print("[%s] Fail to set IP addr(cnt %d)\n", __func__,cnt);
 					return;
 				}
+				wifi_ps_stats_mark(WIFI_PS_PHASE_IP);
+				wifi_conn_time_report(vif, 0);
 			}
 
 #if defined(INCLUDE_ADD_ETHARP)
@@ -316,6 +352,80 @@ tWIFI_STATUS wifi_deinit_with_vif(int vif)
 	return WIFI_SUCCESS;
 }
 
+/*
+ * Try the AP of the last connection first, scanning only its frequency.
+ * The hint is used only for the SSID it was learned for.
+ * Returns true once connected; otherwise the full scan list is back in place
+ * and the hint is dropped.
+ */
+static bool wifi_fast_connect(int vif, WIFI_CONFIG *param)
+{
+	uint16_t freq = param->fast_scan_freq;
+	tWIFI_STATUS status;
+
+	if (!NRC_WIFI_FAST_CONNECT || freq == 0)
+		return false;
+
+	if (strcmp((char *)param->fast_scan_ssid, (char *)param->ssid) != 0) {
+		nrc_usr_print("[%s] Hint is for \"%s\", full scan\n", __func__,
+				(char *)param->fast_scan_ssid);
+		return false;
+	}
+
+	if (param->scan_freq_num == 1 && param->scan_freq_list[0] == freq)
+		return false;
+
+	nrc_usr_print("[%s] Trying %s on %d\n", __func__, (char *)param->fast_scan_bssid, freq);
+
+	if (nrc_wifi_set_scan_freq(vif, &freq, 1) != WIFI_SUCCESS)
+		return false;
+
+	status = nrc_wifi_connect(vif, NRC_WIFI_FAST_CONNECT_TIMEOUT);
+	if (status != WIFI_SUCCESS) {
+		nrc_usr_print("[%s] Not found on %d (%d), full scan\n", __func__, freq, status);
+		nrc_wifi_disconnect(vif, param->disconn_timeout);
+		nrc_clear_bss_hint(param);
+		wpas_conn_time_start(vif);
+	}
+
+	if (nrc_wifi_set_scan_freq(vif, param->scan_freq_num ? param->scan_freq_list : NULL,
+			param->scan_freq_num) != WIFI_SUCCESS) {
+		nrc_usr_print("[%s] Fail to restore Scan Freq\n", __func__);
+	}
+
+	return status == WIFI_SUCCESS;
+}
+
+/* Keep the AP just joined for the next connection, NVS is written only on change */
+static void wifi_update_bss_hint(int vif, WIFI_CONFIG *param)
+{
+	ctrl_iface_conn_time_t t;
+	AP_INFO ap;
+	char bssid[MAX_BSSID_LENGTH + 1];
+
+	if (!NRC_WIFI_FAST_CONNECT || nrc_wifi_get_ap_info(vif, &ap) != WIFI_SUCCESS)
+		return;
+
+	snprintf(bssid, sizeof(bssid), MACSTR, MAC2STR(ap.bssid));
+	if (!wpas_conn_time_get(vif, &t) || !t.beacon_int)
+		t.beacon_int = param->fast_scan_bcn;
+
+	if (param->fast_scan_freq == ap.freq && param->fast_scan_bw == ap.bw &&
+		param->fast_scan_bcn == t.beacon_int &&
+		strcmp((char *)param->fast_scan_bssid, bssid) == 0 &&
+		strcmp((char *)param->fast_scan_ssid, (char *)param->ssid) == 0)
+		return;
+
+	param->fast_scan_freq = ap.freq;
+	param->fast_scan_bw = ap.bw;
+	param->fast_scan_bcn = t.beacon_int;
+	strcpy((char *)param->fast_scan_bssid, bssid);
+	strcpy((char *)param->fast_scan_ssid, (char *)param->ssid);
+
+	if (nrc_save_bss_hint(param) != NRC_SUCCESS)
+		nrc_usr_print("[%s] Fail to save BSS hint\n", __func__);
+}
+
 tWIFI_STATUS wifi_connect_with_vif(int vif, WIFI_CONFIG *param)
 {
 	tWIFI_STATUS status = WIFI_SUCCESS;
@@ -437,12 +547,20 @@ tWIFI_STATUS wifi_connect_with_vif(int vif, WIFI_CONFIG *param)
 		}
 	}
 
-	status = nrc_wifi_connect(vif, param->conn_timeout);
-	if (status != WIFI_SUCCESS) {
-		nrc_usr_print("[%s] Fail to Connect %d\n", __func__, status);
-		return WIFI_FAIL_CONNECT;
+	wpas_conn_time_start(vif);
+	conn_report[vif] = true;
+	conn_fast[vif] = wifi_fast_connect(vif, param);
+
+	if (!conn_fast[vif]) {
+		status = nrc_wifi_connect(vif, param->conn_timeout);
+		if (status != WIFI_SUCCESS) {
+			nrc_usr_print("[%s] Fail to Connect %d\n", __func__, status);
+			return WIFI_FAIL_CONNECT;
+		}
 	}
 
+	wifi_update_bss_hint(vif, param);
+
  	return WIFI_SUCCESS;
 }
 
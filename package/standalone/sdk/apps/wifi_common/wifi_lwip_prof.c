@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+/*
+ * "lwipprof" console command, over lwip_memprof.c:
+ *
+ *   lwipprof [show]   heap and pool use since the last reset
+ *   lwipprof dump     profile for lib/lwip/tools/lwip_memprof.py
+ *   lwipprof reset    start a new measurement window
+ *
+ * Typical use is a reset once the application is up, the workload, then a
+ * dump captured from the console log.
+ *
+ * "lwiplock" console command, over sys_arch_trace.c (CONFIG_LWIP_SYS_TRACE=y):
+ *
+ *   lwiplock [show]     wait and hold times of each lock class
+ *   lwiplock top [n]    who waits, who makes others wait, who blocks tcpip
+ *   lwiplock hist <c>   wait and hold histograms of class c
+ *   lwiplock export     trace for lib/lwip/tools/lwip_locktrace.py
+ *   lwiplock reset      clear the totals and the events
+ *   lwiplock on|off     start or stop recording
+ */
+
+#include "nrc_sdk.h"
+
+#include "lwip_memprof.h"
+#include "arch/sys_arch_trace.h"
+
+#if (LWIP_MEMPROF && LWIP_STATS && MEM_STATS && MEMP_STATS) || LWIP_SYS_TRACE
+
+static void lwipprof_print(const char *line, void *arg)
+{
+	nrc_usr_print("%s\n", line);
+}
+
+#endif
+
+#if LWIP_MEMPROF && LWIP_STATS && MEM_STATS && MEMP_STATS
+
+static void lwipprof_show(void)
+{
+	static struct lwip_memprof prof;
+	struct lwip_memprof_pool *p;
+	int i;
+
+	lwip_memprof_get(&prof);
+
+	nrc_usr_print("%u ms since reset\n", prof.window_ms);
+	nrc_usr_print("%-16s %6s %6s %6s %6s %6s\n", "pool", "size", "num", "used", "max", "err");
+	nrc_usr_print("%-16s %6s %6u %6u %6u %6u\n", prof.heap.name, "-",
+				  prof.heap.num, prof.heap.used, prof.heap.max, prof.heap.err);
+
+	for (i = 0; i < MEMP_MAX; i++) {
+		p = &prof.pool[i];
+		nrc_usr_print("%-16s %6u %6u %6u %6u %6u%s\n", p->name, p->size, p->num,
+					  p->used, p->max, p->err, p->err ? " !" : "");
+	}
+}
+
+static int cmd_lwipprof_handler(cmd_tbl_t *t, int argc, char *argv[])
+{
+	if (argc > 2)
+		return CMD_RET_USAGE;
+
+	if (argc == 1 || strcmp(argv[1], "show") == 0)
+		lwipprof_show();
+	else if (strcmp(argv[1], "dump") == 0)
+		lwip_memprof_dump(lwipprof_print, NULL);
+	else if (strcmp(argv[1], "reset") == 0)
+		lwip_memprof_reset();
+	else
+		return CMD_RET_USAGE;
+
+	return CMD_RET_SUCCESS;
+}
+
+CMD_MAND(lwipprof,
+	cmd_lwipprof_handler,
+	"lwIP heap and pool high-water marks",
+	"lwipprof [show|dump|reset]");
+
+#endif /* LWIP_MEMPROF && LWIP_STATS && MEM_STATS && MEMP_STATS */
+
+#if LWIP_SYS_TRACE
+
+static int cmd_lwiplock_handler(cmd_tbl_t *t, int argc, char *argv[])
+{
+	if (argc > 3)
+		return CMD_RET_USAGE;
+
+	if (argc == 1 || strcmp(argv[1], "show") == 0) {
+		nrc_usr_print("recording %s\n", sys_trace_enabled() ? "on" : "off");
+		sys_trace_show(lwipprof_print, NULL);
+	} else if (strcmp(argv[1], "top") == 0) {
+		sys_trace_top(lwipprof_print, NULL, argc == 3 ? atoi(argv[2]) : 5);
+	} else if (strcmp(argv[1], "hist") == 0) {
+		if (argc != 3)
+			return CMD_RET_USAGE;
+		if (sys_trace_hist(lwipprof_print, NULL, argv[2]) < 0) {
+			nrc_usr_print("no class %s\n", argv[2]);
+			return CMD_RET_FAILURE;
+		}
+	} else if (strcmp(argv[1], "export") == 0) {
+		sys_trace_export(lwipprof_print, NULL);
+	} else if (strcmp(argv[1], "reset") == 0) {
+		sys_trace_reset();
+	} else if (strcmp(argv[1], "on") == 0) {
+		sys_trace_enable(1);
+	} else if (strcmp(argv[1], "off") == 0) {
+		sys_trace_enable(0);
+	} else {
+		return CMD_RET_USAGE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+CMD_MAND(lwiplock,
+	cmd_lwiplock_handler,
+	"lwIP lock wait and hold times",
+	"lwiplock [show|top [n]|hist <class>|export|reset|on|off]");
+
+#endif /* LWIP_SYS_TRACE */
@@ -0,0 +1,427 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stddef.h>
+
+#include "nrc_sdk.h"
+#include "wifi_ps_stats.h"
+
+#include "lwip/sys.h"
+
+_Static_assert(sizeof(wifi_ps_stats_t) <= NRC_RETENTION_PS_STATS_SIZE,
+			   "NRC_RETENTION_PS_STATS_SIZE too small");
+
+static const char *phase_name[WIFI_PS_PHASE_MAX] = {
+	"boot", "connect", "ip", "tx", "tail"
+};
+
+/*
+ * RAM does not survive the deep sleep: everything below starts over on
+ * each wake, the totals live in retention.
+ */
+static wifi_ps_stats_t stats;
+static bool registered;		/* a wrapper was called since the boot */
+static bool woken;			/* the wakeup of this boot is accounted */
+
+/* The wake being accounted */
+static struct {
+	volatile bool active;
+	int slot;
+	uint32_t boot_ms;
+	uint32_t sleep_ms;
+	uint32_t mark[WIFI_PS_PHASE_MAX];
+	uint32_t tx_packets;
+	uint32_t tx_bytes;
+} run;
+
+static uint32_t stats_checksum(wifi_ps_stats_t *s)
+{
+	const uint8_t *p = (const uint8_t *)s;
+	uint32_t saved = s->checksum;
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	s->checksum = 0;
+	for (i = 0; i < sizeof(*s); i++)
+		h = (h ^ p[i]) * 16777619u;
+	s->checksum = saved;
+
+	return h;
+}
+
+static nrc_err_t stats_save(void)
+{
+	stats.checksum = stats_checksum(&stats);
+	return nrc_retention_save(NRC_RETENTION_PS_STATS_OFFSET, &stats, sizeof(stats));
+}
+
+static void stats_clear_counters(void)
+{
+	int i;
+
+	stats.last_rtc_ms = 0;
+	stats.sleep_ms = 0;
+	stats.cycles = 0;
+	for (i = 0; i < WIFI_PS_STATS_SLOTS; i++) {
+		wifi_ps_slot_stats_t *slot = &stats.slot[i];
+
+		memset(&slot->wakes, 0, sizeof(*slot) - offsetof(wifi_ps_slot_stats_t, wakes));
+	}
+}
+
+/*
+ * Load the totals. The registrations are needed to run the callbacks, so a
+ * checksum error only drops the counters.
+ */
+static nrc_err_t stats_load(void)
+{
+	if (nrc_retention_load(NRC_RETENTION_PS_STATS_OFFSET, &stats, sizeof(stats)) != NRC_SUCCESS)
+		return NRC_FAIL;
+
+	if (stats.magic != WIFI_PS_STATS_MAGIC || stats.version != WIFI_PS_STATS_VERSION ||
+		stats.size != sizeof(stats))
+		return NRC_FAIL;
+
+	if (stats.checksum != stats_checksum(&stats)) {
+		nrc_usr_print("[%s] checksum error, counters cleared\n", __func__);
+		stats_clear_counters();
+	}
+
+	return NRC_SUCCESS;
+}
+
+/* First registration since the boot: the application registers everything again */
+static void stats_register_begin(void)
+{
+	uint8_t boot = NRC_WAKEUP_REASON_COLDBOOT;
+	int i;
+
+	if (registered)
+		return;
+	registered = true;
+
+	nrc_ps_wakeup_reason(&boot);
+	if (boot == NRC_WAKEUP_REASON_COLDBOOT || stats_load() != NRC_SUCCESS) {
+		memset(&stats, 0, sizeof(stats));
+		stats.magic = WIFI_PS_STATS_MAGIC;
+		stats.version = WIFI_PS_STATS_VERSION;
+		stats.size = sizeof(stats);
+	}
+
+	for (i = 0; i < WIFI_PS_STATS_SLOTS; i++)
+		stats.slot[i].flags = 0;
+}
+
+/* Fold the wake into the totals */
+static void stats_end(void)
+{
+	wifi_ps_slot_stats_t *slot;
+	uint32_t phase[WIFI_PS_PHASE_MAX] = { 0, };
+	uint32_t end = sys_now();
+	uint32_t prev, awake;
+	uint64_t rtc = 0;
+	int p;
+
+	run.active = false;
+
+	/* reload, the callback may have reset the counters */
+	if (stats_load() != NRC_SUCCESS)
+		return;
+	slot = &stats.slot[run.slot];
+
+	phase[WIFI_PS_PHASE_BOOT] = run.boot_ms;
+	prev = run.mark[WIFI_PS_PHASE_BOOT];
+	for (p = WIFI_PS_PHASE_CONNECT; p < WIFI_PS_PHASE_TAIL; p++) {
+		if (run.mark[p]) {
+			phase[p] = run.mark[p] - prev;
+			prev = run.mark[p];
+		}
+	}
+	phase[WIFI_PS_PHASE_TAIL] = end - prev;
+	awake = run.boot_ms + (end - run.mark[WIFI_PS_PHASE_BOOT]);
+
+	if (run.boot_ms) {
+		stats.cycles++;
+		stats.sleep_ms += run.sleep_ms;
+	}
+
+	slot->wakes++;
+	if ((slot->flags & WIFI_PS_SLOT_NET_INIT) && run.tx_packets == 0)
+		slot->wasted++;
+	slot->tx_packets += run.tx_packets;
+	slot->tx_bytes += run.tx_bytes;
+	slot->awake_ms += awake;
+	if (awake > slot->awake_max_ms)
+		slot->awake_max_ms = awake;
+	for (p = 0; p < WIFI_PS_PHASE_MAX; p++) {
+		slot->phase_ms[p] += phase[p];
+		if (phase[p] > slot->phase_max_ms[p])
+			slot->phase_max_ms[p] = phase[p];
+	}
+
+	nrc_get_rtc(&rtc);
+	stats.last_rtc_ms = rtc;
+	stats_save();
+}
+
+static void stats_run(int i)
+{
+	scheduled_callback func;
+	uint32_t entry = sys_now();
+	uint64_t rtc = 0;
+
+	if (stats_load() != NRC_SUCCESS) {
+		nrc_usr_print("[%s] no schedule in retention\n", __func__);
+		return;
+	}
+
+	if (!(stats.slot[i].flags & WIFI_PS_SLOT_USED) || !stats.slot[i].func)
+		return;
+	func = (scheduled_callback)stats.slot[i].func;
+
+	memset(&run, 0, sizeof(run));
+	run.slot = i;
+	run.mark[WIFI_PS_PHASE_BOOT] = entry;
+
+	/* the first callback of the wake pays for the boot and ends the sleep */
+	if (!woken) {
+		woken = true;
+		run.boot_ms = entry;
+
+		nrc_get_rtc(&rtc);
+		if (stats.last_rtc_ms && rtc > stats.last_rtc_ms + entry)
+			run.sleep_ms = rtc - entry - stats.last_rtc_ms;
+	}
+
+	run.active = true;
+	func();
+
+	/* unless wifi_ps_stats_resume_deep_sleep() did it already */
+	if (run.active)
+		stats_end();
+}
+
+/* The firmware calls a scheduled_callback without arguments */
+static void stats_run_0(void) { stats_run(0); }
+static void stats_run_1(void) { stats_run(1); }
+static void stats_run_2(void) { stats_run(2); }
+static void stats_run_3(void) { stats_run(3); }
+static void stats_run_gpio(void) { stats_run(WIFI_PS_STATS_SLOT_GPIO); }
+
+static const scheduled_callback trampoline[WIFI_PS_STATS_SLOTS] = {
+	stats_run_0, stats_run_1, stats_run_2, stats_run_3, stats_run_gpio
+};
+
+nrc_err_t wifi_ps_stats_add_schedule(uint32_t timeout, bool net_init, scheduled_callback func)
+{
+	wifi_ps_slot_stats_t *slot;
+	int i;
+
+	if (!func)
+		return NRC_FAIL;
+
+	stats_register_begin();
+
+	for (i = 0; i < WIFI_PS_STATS_SCHEDULES; i++) {
+		if (!(stats.slot[i].flags & WIFI_PS_SLOT_USED))
+			break;
+	}
+	if (i == WIFI_PS_STATS_SCHEDULES)
+		return NRC_FAIL;
+
+	if (nrc_ps_add_schedule(timeout, net_init, trampoline[i]) != NRC_SUCCESS)
+		return NRC_FAIL;
+
+	slot = &stats.slot[i];
+	slot->func = (uint32_t)func;
+	slot->timeout_ms = timeout;
+	slot->flags = WIFI_PS_SLOT_USED | (net_init ? WIFI_PS_SLOT_NET_INIT : 0);
+
+	return stats_save();
+}
+
+nrc_err_t wifi_ps_stats_add_gpio_callback(bool net_init, scheduled_callback func)
+{
+	wifi_ps_slot_stats_t *slot = &stats.slot[WIFI_PS_STATS_SLOT_GPIO];
+
+	if (!func)
+		return NRC_FAIL;
+
+	stats_register_begin();
+
+	if (nrc_ps_add_gpio_callback(net_init, trampoline[WIFI_PS_STATS_SLOT_GPIO]) != NRC_SUCCESS)
+		return NRC_FAIL;
+
+	slot->func = (uint32_t)func;
+	slot->timeout_ms = 0;
+	slot->flags = WIFI_PS_SLOT_USED | WIFI_PS_SLOT_GPIO | (net_init ? WIFI_PS_SLOT_NET_INIT : 0);
+
+	return stats_save();
+}
+
+nrc_err_t wifi_ps_stats_start_schedule(void)
+{
+	uint64_t rtc = 0;
+
+	if (registered) {
+		nrc_get_rtc(&rtc);
+		stats.last_rtc_ms = rtc;
+		stats_save();
+	}
+
+	return nrc_ps_start_schedule();
+}
+
+nrc_err_t wifi_ps_stats_resume_deep_sleep(void)
+{
+	if (run.active)
+		stats_end();
+
+	return nrc_ps_resume_deep_sleep();
+}
+
+void wifi_ps_stats_mark(wifi_ps_phase_t phase)
+{
+	if (!run.active || phase <= WIFI_PS_PHASE_BOOT || phase >= WIFI_PS_PHASE_TAIL)
+		return;
+
+	/* a reconnection within the wake does not move the first marks */
+	if (phase != WIFI_PS_PHASE_TX && run.mark[phase])
+		return;
+
+	run.mark[phase] = sys_now();
+}
+
+void wifi_ps_stats_tx(uint32_t bytes)
+{
+	if (!run.active)
+		return;
+
+	run.tx_packets++;
+	run.tx_bytes += bytes;
+	run.mark[WIFI_PS_PHASE_TX] = sys_now();
+}
+
+nrc_err_t wifi_ps_stats_get(wifi_ps_stats_t *s)
+{
+	if (stats_load() != NRC_SUCCESS)
+		return NRC_FAIL;
+
+	memcpy(s, &stats, sizeof(stats));
+	return NRC_SUCCESS;
+}
+
+nrc_err_t wifi_ps_stats_reset(void)
+{
+	uint64_t rtc = 0;
+
+	if (stats_load() != NRC_SUCCESS)
+		return NRC_FAIL;
+
+	stats_clear_counters();
+	nrc_get_rtc(&rtc);
+	stats.last_rtc_ms = rtc;
+
+	return stats_save();
+}
+
+/******************************************************************************/
+
+static void cmd_psstats_show(void)
+{
+	uint64_t awake = 0;
+	int i, p;
+
+	for (i = 0; i < WIFI_PS_STATS_SLOTS; i++)
+		awake += stats.slot[i].awake_ms;
+
+	nrc_usr_print("cycles %u, sleep %llu ms, awake %llu ms\n",
+				  stats.cycles, stats.sleep_ms, awake);
+
+	for (i = 0; i < WIFI_PS_STATS_SLOTS; i++) {
+		wifi_ps_slot_stats_t *slot = &stats.slot[i];
+		uint32_t n = slot->wakes ? slot->wakes : 1;
+
+		if (!(slot->flags & WIFI_PS_SLOT_USED))
+			continue;
+
+		if (slot->flags & WIFI_PS_SLOT_GPIO)
+			nrc_usr_print("gpio%s:", slot->flags & WIFI_PS_SLOT_NET_INIT ? " (net)" : "");
+		else
+			nrc_usr_print("schedule %d, %u ms%s:", i, slot->timeout_ms,
+						  slot->flags & WIFI_PS_SLOT_NET_INIT ? " (net)" : "");
+		nrc_usr_print(" wakes %u, wasted %u, tx %u/%u bytes, awake avg %u max %u ms\n",
+					  slot->wakes, slot->wasted, slot->tx_packets, slot->tx_bytes,
+					  slot->awake_ms / n, slot->awake_max_ms);
+
+		nrc_usr_print("  ");
+		for (p = 0; p < WIFI_PS_PHASE_MAX; p++)
+			nrc_usr_print(" %s %u/%u", phase_name[p], slot->phase_ms[p] / n,
+						  slot->phase_max_ms[p]);
+		nrc_usr_print(" ms (avg/max)\n");
+	}
+}
+
+static void cmd_psstats_dump(void)
+{
+	const uint8_t *p = (const uint8_t *)&stats;
+	size_t i;
+
+	nrc_usr_print("PSSTATS ");
+	for (i = 0; i < sizeof(stats); i++)
+		nrc_usr_print("%02x", p[i]);
+	nrc_usr_print("\n");
+}
+
+static int cmd_psstats_handler(cmd_tbl_t *t, int argc, char *argv[])
+{
+	if (argc > 2)
+		return CMD_RET_USAGE;
+
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		if (wifi_ps_stats_reset() != NRC_SUCCESS)
+			return CMD_RET_FAILURE;
+		return CMD_RET_SUCCESS;
+	}
+
+	if (stats_load() != NRC_SUCCESS) {
+		nrc_usr_print("no power save statistics\n");
+		return CMD_RET_FAILURE;
+	}
+
+	if (argc == 1 || strcmp(argv[1], "show") == 0)
+		cmd_psstats_show();
+	else if (strcmp(argv[1], "dump") == 0)
+		cmd_psstats_dump();
+	else
+		return CMD_RET_USAGE;
+
+	return CMD_RET_SUCCESS;
+}
+
+CMD_MAND(psstats,
+	cmd_psstats_handler,
+	"power save schedule statistics",
+	"psstats [show|dump|reset]");
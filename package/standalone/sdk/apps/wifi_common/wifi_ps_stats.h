@@ -0,0 +1,185 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __WIFI_PS_STATS_H__
+#define __WIFI_PS_STATS_H__
+
+#include "wifi_config_setup.h"
+#include "api_ps.h"
+
+/*
+ * Wake accounting for the scheduled deep sleep of api_ps.h.
+ *
+ * The schedules and the GPIO callback are registered through the wrappers
+ * below instead of nrc_ps_add_schedule() and nrc_ps_add_gpio_callback().
+ * Every wake then has the time spent in each phase measured, and the
+ * totals are accumulated in the NRC_RETENTION_PS_STATS region so that they
+ * survive the deep sleep:
+ *
+ *   BOOT     wakeup to the callback, sys_now() at its entry
+ *   CONNECT  callback to WIFI_EVT_CONNECT_SUCCESS
+ *   IP       connection to the address being set
+ *   TX       address to the last wifi_ps_stats_tx()
+ *   TAIL     last mark to the return of the callback
+ *
+ * A wake that brings the network up and sends nothing is counted as wasted. The "psstats" console
+ * command shows the totals; "psstats dump" prints them as a PSSTATS line
+ * that host/ps_energy.py turns into charge and battery life estimates.
+ */
+
+#define WIFI_PS_STATS_MAGIC		0x53505350	/* "PSPS" */
+#define WIFI_PS_STATS_VERSION	1
+
+/* 4 schedules and the GPIO callback */
+#define WIFI_PS_STATS_SCHEDULES	4
+#define WIFI_PS_STATS_SLOT_GPIO	WIFI_PS_STATS_SCHEDULES
+#define WIFI_PS_STATS_SLOTS		(WIFI_PS_STATS_SCHEDULES + 1)
+
+typedef enum {
+	WIFI_PS_PHASE_BOOT,
+	WIFI_PS_PHASE_CONNECT,
+	WIFI_PS_PHASE_IP,
+	WIFI_PS_PHASE_TX,
+	WIFI_PS_PHASE_TAIL,
+	WIFI_PS_PHASE_MAX
+} wifi_ps_phase_t;
+
+#define WIFI_PS_SLOT_USED		(1 << 0)
+#define WIFI_PS_SLOT_NET_INIT	(1 << 1)
+#define WIFI_PS_SLOT_GPIO		(1 << 2)
+
+typedef struct {
+	uint32_t func;			/* the user callback, runs from the trampoline */
+	uint32_t timeout_ms;
+	uint32_t flags;			/* WIFI_PS_SLOT_* */
+	uint32_t wakes;
+	uint32_t wasted;		/* network wakes without any transmission */
+	uint32_t tx_packets;
+	uint32_t tx_bytes;
+	uint32_t awake_ms;
+	uint32_t awake_max_ms;
+	uint32_t phase_ms[WIFI_PS_PHASE_MAX];
+	uint32_t phase_max_ms[WIFI_PS_PHASE_MAX];
+} wifi_ps_slot_stats_t;
+
+/* Retention layout, little-endian, parsed by host/ps_energy.py */
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t size;
+	uint64_t last_rtc_ms;	/* nrc_get_rtc() when the last wake ended */
+	uint64_t sleep_ms;
+	uint32_t cycles;		/* wakes from deep sleep */
+	uint32_t checksum;
+	wifi_ps_slot_stats_t slot[WIFI_PS_STATS_SLOTS];
+} wifi_ps_stats_t;
+
+/*********************************************************************
+ * @fn wifi_ps_stats_add_schedule
+ *
+ * @brief nrc_ps_add_schedule() with the wakes of func accounted.
+ *        The first call after a cold boot clears the statistics.
+ *
+ * @param timeout, net_init, func: as nrc_ps_add_schedule()
+ *
+ * @return NRC_SUCCESS, NRC_FAIL if all schedules are in use
+ **********************************************************************/
+nrc_err_t wifi_ps_stats_add_schedule(uint32_t timeout, bool net_init, scheduled_callback func);
+
+/*********************************************************************
+ * @fn wifi_ps_stats_add_gpio_callback
+ *
+ * @brief nrc_ps_add_gpio_callback() with the wakes of func accounted.
+ *
+ * @param net_init, func: as nrc_ps_add_gpio_callback()
+ *
+ * @return NRC_SUCCESS or NRC_FAIL
+ **********************************************************************/
+nrc_err_t wifi_ps_stats_add_gpio_callback(bool net_init, scheduled_callback func);
+
+/*********************************************************************
+ * @fn wifi_ps_stats_start_schedule
+ *
+ * @brief nrc_ps_start_schedule(), the first sleep is accounted from here.
+ *
+ * @return As nrc_ps_start_schedule()
+ **********************************************************************/
+nrc_err_t wifi_ps_stats_start_schedule(void);
+
+/*********************************************************************
+ * @fn wifi_ps_stats_resume_deep_sleep
+ *
+ * @brief nrc_ps_resume_deep_sleep() for a callback that goes back to
+ *        sleep by itself, such as the GPIO one. The wake is accounted
+ *        first since the callback does not return.
+ *
+ * @return As nrc_ps_resume_deep_sleep()
+ **********************************************************************/
+nrc_err_t wifi_ps_stats_resume_deep_sleep(void);
+
+/*********************************************************************
+ * @fn wifi_ps_stats_mark
+ *
+ * @brief End the CONNECT or IP phase of the running wake. No effect
+ *        outside of an accounted callback.
+ *
+ * @param phase
+ *
+ * @return N/A
+ **********************************************************************/
+void wifi_ps_stats_mark(wifi_ps_phase_t phase);
+
+/*********************************************************************
+ * @fn wifi_ps_stats_tx
+ *
+ * @brief Count a transmission of the running wake and end its TX phase.
+ *
+ * @param bytes
+ *
+ * @return N/A
+ **********************************************************************/
+void wifi_ps_stats_tx(uint32_t bytes);
+
+/*********************************************************************
+ * @fn wifi_ps_stats_get
+ *
+ * @brief Read the accumulated statistics.
+ *
+ * @param stats
+ *
+ * @return NRC_SUCCESS, NRC_FAIL if retention holds none
+ **********************************************************************/
+nrc_err_t wifi_ps_stats_get(wifi_ps_stats_t *stats);
+
+/*********************************************************************
+ * @fn wifi_ps_stats_reset
+ *
+ * @brief Clear the counters, the registered callbacks are kept.
+ *
+ * @return NRC_SUCCESS or NRC_FAIL
+ **********************************************************************/
+nrc_err_t wifi_ps_stats_reset(void);
+
+#endif /* __WIFI_PS_STATS_H__ */
@@ -0,0 +1,309 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "nrc_sdk.h"
+#include "wifi_config.h"
+#include "wifi_resume.h"
+
+#include "nrc_lwip.h"
+
+#if NRC_WIFI_WARM_RESUME && LWIP_RESUME
+#include "lwip_resume.h"
+
+#if defined(SUPPORT_MBEDTLS)
+#include "tls_session_cache.h"
+#endif
+
+#ifdef SUPPORT_NVS_FLASH
+#include <nvs.h>
+#include "nvs_config.h"
+#endif
+
+typedef struct {
+	uint64_t rtc_ms;	/* nrc_get_rtc() at save time */
+	uint16_t len;		/* of the snapshot */
+	uint16_t reserved;
+} wifi_resume_hdr_t;
+
+/* The NRC_RETENTION_RESUME region: header and snapshot */
+typedef struct {
+	wifi_resume_hdr_t hdr;
+	u8_t snapshot[LWIP_RESUME_SIZE_MAX];
+} wifi_resume_blob_t;
+
+_Static_assert(sizeof(wifi_resume_blob_t) <= NRC_RETENTION_RESUME_SIZE,
+			   "NRC_RETENTION_RESUME_SIZE too small");
+
+#if LWIP_DNS
+/* The NRC_RETENTION_DNS region: header and dns_cache_save() records */
+typedef struct {
+	wifi_resume_hdr_t hdr;
+	u8_t cache[NRC_RETENTION_DNS_SIZE - sizeof(wifi_resume_hdr_t)];
+} wifi_resume_dns_t;
+
+static void wifi_resume_dns_save(void)
+{
+	wifi_resume_dns_t *blob;
+	int len;
+
+	blob = nrc_mem_malloc(sizeof(*blob));
+	if (!blob)
+		return;
+
+	memset(&blob->hdr, 0, sizeof(blob->hdr));
+	len = wifi_dns_cache_save(blob->cache, sizeof(blob->cache));
+	if (len > 0) {
+		nrc_get_rtc(&blob->hdr.rtc_ms);
+		blob->hdr.len = len;
+	}
+	/* an empty cache is saved too, not to restore an older one */
+	nrc_retention_save(NRC_RETENTION_DNS_OFFSET, blob, sizeof(blob->hdr) + (len > 0 ? len : 0));
+
+	nrc_mem_free(blob);
+}
+
+static void wifi_resume_dns_restore(uint64_t now)
+{
+	wifi_resume_dns_t *blob;
+
+	blob = nrc_mem_malloc(sizeof(*blob));
+	if (!blob)
+		return;
+
+	if (nrc_retention_load(NRC_RETENTION_DNS_OFFSET, blob, sizeof(*blob)) == NRC_SUCCESS &&
+		blob->hdr.len > 0 && blob->hdr.len <= sizeof(blob->cache) && now >= blob->hdr.rtc_ms)
+		wifi_dns_cache_restore(blob->cache, blob->hdr.len,
+							   (uint32_t)((now - blob->hdr.rtc_ms) / 1000));
+
+	nrc_mem_free(blob);
+}
+#else
+static void wifi_resume_dns_save(void) {}
+static void wifi_resume_dns_restore(uint64_t now) {}
+#endif /* LWIP_DNS */
+
+#if defined(NRC_TLS_SESSION_CACHE) && defined(SUPPORT_NVS_FLASH)
+/*
+ * TLS sessions do not fit in retention memory: they go to NVS, rewritten
+ * only when a full handshake added or replaced one, not on every wakeup.
+ */
+#define WIFI_RESUME_TLS_SIZE	1024
+
+/* The NVS_TLS_SESSIONS blob: header and tls_session_cache_save() records */
+typedef struct {
+	wifi_resume_hdr_t hdr;
+	u8_t cache[WIFI_RESUME_TLS_SIZE - sizeof(wifi_resume_hdr_t)];
+} wifi_resume_tls_t;
+
+static void wifi_resume_tls_save(void)
+{
+	wifi_resume_tls_t *blob;
+	nvs_handle_t handle;
+	nvs_err_t err;
+	int len;
+
+	if (!tls_session_cache_changed())
+		return;
+
+	blob = nrc_mem_malloc(sizeof(*blob));
+	if (!blob)
+		return;
+
+	memset(&blob->hdr, 0, sizeof(blob->hdr));
+	len = tls_session_cache_save(blob->cache, sizeof(blob->cache));
+	if (len > 0) {
+		nrc_get_rtc(&blob->hdr.rtc_ms);
+		blob->hdr.len = len;
+	}
+
+	if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &handle) == NVS_OK) {
+		/* no session left: erase, not to restore an older one */
+		if (len > 0)
+			err = nvs_set_blob(handle, NVS_TLS_SESSIONS, blob, sizeof(blob->hdr) + len);
+		else
+			err = nvs_erase_key(handle, NVS_TLS_SESSIONS);
+		if (err == NVS_OK)
+			nvs_commit(handle);
+		nvs_close(handle);
+	}
+
+	nrc_mem_free(blob);
+}
+
+static void wifi_resume_tls_restore(uint64_t now)
+{
+	wifi_resume_tls_t *blob;
+	nvs_handle_t handle;
+	size_t length = sizeof(*blob);
+	nvs_err_t err;
+
+	blob = nrc_mem_malloc(sizeof(*blob));
+	if (!blob)
+		return;
+
+	if (nvs_open(NVS_DEFAULT_NAMESPACE, NVS_READWRITE, &handle) == NVS_OK) {
+		err = nvs_get_blob(handle, NVS_TLS_SESSIONS, blob, &length);
+		nvs_close(handle);
+
+		if (err == NVS_OK && length >= sizeof(blob->hdr) &&
+			blob->hdr.len > 0 && blob->hdr.len <= length - sizeof(blob->hdr) &&
+			now >= blob->hdr.rtc_ms)
+			tls_session_cache_restore(blob->cache, blob->hdr.len,
+									  (uint32_t)((now - blob->hdr.rtc_ms) / 1000));
+	}
+
+	nrc_mem_free(blob);
+}
+#else
+static void wifi_resume_tls_save(void) {}
+static void wifi_resume_tls_restore(uint64_t now) {}
+#endif /* NRC_TLS_SESSION_CACHE && SUPPORT_NVS_FLASH */
+
+/* The snapshot is only good for the first connection after the wakeup */
+static bool resume_done;
+
+tWIFI_STATUS wifi_resume_save(int vif)
+{
+	wifi_resume_blob_t *blob;
+	int len;
+	tWIFI_STATUS ret = WIFI_FAIL;
+
+	if (nrc_wifi_get_state(vif) != WIFI_STATE_CONNECTED || nrc_addr_get_state(vif) != NET_ADDR_SET)
+		return WIFI_FAIL;
+
+	blob = nrc_mem_malloc(sizeof(*blob));
+	if (!blob)
+		return WIFI_NOMEM;
+
+	memset(&blob->hdr, 0, sizeof(blob->hdr));
+	len = wifi_station_resume_save(vif, blob->snapshot, sizeof(blob->snapshot));
+	if (len > 0) {
+		nrc_get_rtc(&blob->hdr.rtc_ms);
+		blob->hdr.len = len;
+
+		if (nrc_retention_save(NRC_RETENTION_RESUME_OFFSET, blob,
+							   sizeof(blob->hdr) + len) == NRC_SUCCESS)
+			ret = WIFI_SUCCESS;
+	}
+
+	if (ret != WIFI_SUCCESS)
+		nrc_usr_print("[%s] Fail to save network state (%d)\n", __func__, len);
+
+	nrc_mem_free(blob);
+
+	wifi_resume_dns_save();
+	wifi_resume_tls_save();
+	return ret;
+}
+
+tWIFI_STATUS wifi_resume_restore(int vif)
+{
+	struct lwip_resume_info info;
+	struct netif *netif = nrc_netif_get_by_idx(vif);
+	char ip[IP4ADDR_STRLEN_MAX], netmask[IP4ADDR_STRLEN_MAX], gateway[IP4ADDR_STRLEN_MAX];
+	uint8_t boot = NRC_WAKEUP_REASON_COLDBOOT;
+	wifi_resume_blob_t *blob;
+	uint64_t now = 0;
+	uint32_t elapsed;
+	tWIFI_STATUS ret = WIFI_FAIL;
+
+	if (resume_done)
+		return WIFI_FAIL;
+	resume_done = true;
+
+	if (nrc_ps_wakeup_reason(&boot) != NRC_SUCCESS || boot == NRC_WAKEUP_REASON_COLDBOOT)
+		return WIFI_FAIL;
+
+	/* the names resolved and the TLS sessions kept before the sleep are
+	   good whether or not the snapshot is */
+	nrc_get_rtc(&now);
+	wifi_resume_dns_restore(now);
+	wifi_resume_tls_restore(now);
+
+	blob = nrc_mem_malloc(sizeof(*blob));
+	if (!blob)
+		return WIFI_NOMEM;
+
+	if (nrc_retention_load(NRC_RETENTION_RESUME_OFFSET, blob, sizeof(*blob)) != NRC_SUCCESS)
+		goto out;
+
+	if (blob->hdr.len > sizeof(blob->snapshot) || now < blob->hdr.rtc_ms)
+		goto out;
+	elapsed = (uint32_t)((now - blob->hdr.rtc_ms) / 1000);
+
+	if (wifi_station_resume_restore(vif, blob->snapshot, blob->hdr.len, elapsed, &info) != 0)
+		goto out;
+
+	/*
+	 * The address is handed to the driver as a static one, so that
+	 * nrc_addr_get_state() reports it. The DHCP client keeps the lease and
+	 * renews it at T1; bind the lease again if the driver stopped it.
+	 */
+	ip4addr_ntoa_r(netif_ip4_addr(netif), ip, sizeof(ip));
+	ip4addr_ntoa_r(netif_ip4_netmask(netif), netmask, sizeof(netmask));
+	ip4addr_ntoa_r(netif_ip4_gw(netif), gateway, sizeof(gateway));
+	if (nrc_wifi_set_ip_address(vif, WIFI_STATIC_IP, 0, ip, netmask, gateway) != WIFI_SUCCESS)
+		goto out;
+	nrc_wifi_set_ip_mode(vif, WIFI_DYNAMIC_IP, NULL);
+	if (info.dhcp && !wifi_station_dhcpc_status(vif))
+		wifi_station_resume_restore(vif, blob->snapshot, blob->hdr.len, elapsed, &info);
+
+	nrc_usr_print("[%s] %s, lease %u s, arp %d, udp %d\n", __func__, ip,
+				  info.dhcp ? info.lease_left : 0, info.arp, info.udp);
+	ret = WIFI_SUCCESS;
+
+out:
+	nrc_mem_free(blob);
+	return ret;
+}
+
+uint16_t wifi_resume_udp_port(const char *remote_addr, uint16_t remote_port)
+{
+	ip_addr_t addr;
+
+	if (!remote_addr || !ipaddr_aton(remote_addr, &addr))
+		return 0;
+
+	return lwip_resume_udp_port(&addr, remote_port);
+}
+
+#else
+
+tWIFI_STATUS wifi_resume_save(int vif)
+{
+	return WIFI_FAIL;
+}
+
+tWIFI_STATUS wifi_resume_restore(int vif)
+{
+	return WIFI_FAIL;
+}
+
+uint16_t wifi_resume_udp_port(const char *remote_addr, uint16_t remote_port)
+{
+	return 0;
+}
+
+#endif /* NRC_WIFI_WARM_RESUME && LWIP_RESUME */
@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __WIFI_RESUME_H__
+#define __WIFI_RESUME_H__
+
+#include "wifi_config_setup.h"
+
+/*********************************************************************
+ * @fn wifi_resume_save
+ *
+ * @brief Keep the network state of a connected STA in retention memory,
+ *        right before nrc_ps_deep_sleep() or nrc_ps_wifi_tim_deep_sleep().
+ *        It goes to the NRC_RETENTION_RESUME region, the wifi
+ *        configuration saved by nrc_wifi_set_config() is left as is. UDP
+ *        sockets must still be open to have their local port saved. The
+ *        DNS cache goes to the NRC_RETENTION_DNS region, the TLS client
+ *        sessions (NRC_TLS_SESSION_CACHE) to NVS when they changed.
+ *
+ * @param vif
+ *
+ * @return If success, then WIFI_SUCCESS. Otherwise, error code(tWIFI_STATUS) is returned.
+ **********************************************************************/
+tWIFI_STATUS wifi_resume_save(int vif);
+
+/*********************************************************************
+ * @fn wifi_resume_restore
+ *
+ * @brief Put back the network state saved before the deep sleep. Called
+ *        on the first connection after a wakeup, in place of DHCP. The
+ *        DNS names still within their TTL and the TLS sessions still
+ *        within their lifetime are put back in any case.
+ *
+ * @param vif
+ *
+ * @return WIFI_SUCCESS if the address is set. Otherwise the caller runs DHCP.
+ **********************************************************************/
+tWIFI_STATUS wifi_resume_restore(int vif);
+
+/*********************************************************************
+ * @fn wifi_resume_udp_port
+ *
+ * @brief Local port of the UDP socket connected to a peer before the deep
+ *        sleep. Binding the new socket to it keeps the flow the peer, or a
+ *        NAT on the way, already knows.
+ *
+ * @param remote_addr: the peer's IPv4 address
+ *
+ * @param remote_port: the peer's port
+ *
+ * @return The local port, 0 if none was restored
+ **********************************************************************/
+uint16_t wifi_resume_udp_port(const char *remote_addr, uint16_t remote_port);
+
+#endif /* __WIFI_RESUME_H__ */
@@ -0,0 +1,301 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "nrc_sdk.h"
+#include "wifi_config.h"
+#include "wifi_roaming.h"
+
+#include "ctrl_iface_freeRTOS.h"
+#include "nrc_lwip.h"
+
+#define WIFI_ROAMING_TASK_STACK_SIZE	2048
+#define WIFI_ROAMING_TASK_PRIORITY	3
+#define WIFI_ROAMING_POLL_MS		50
+
+static struct {
+	int vif;
+	WIFI_CONFIG *param;
+	wifi_roaming_config_t config;
+	wifi_roam_policy_t policy;
+	SemaphoreHandle_t lock;
+	TaskHandle_t task;
+	volatile bool stop;
+} roaming;
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static bool parse_bssid(const char *str, uint8_t *bssid)
+{
+	int i, hi, lo;
+
+	for (i = 0; i < 6; i++) {
+		hi = hex_digit(str[0]);
+		lo = hex_digit(str[1]);
+		if (hi < 0 || lo < 0)
+			return false;
+		bssid[i] = (hi << 4) | lo;
+		str += 2;
+		if (i < 5 && *str++ != ':')
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Scan the channels the policy asks for and feed the APs of our ESS to it.
+ * The scan list of the configuration is put back afterwards.
+ */
+static void wifi_roaming_scan(void)
+{
+	WIFI_CONFIG *param = roaming.param;
+	uint16_t freqs[WIFI_ROAM_MAX_CANDIDATES + 1];
+	SCAN_RESULTS *results;
+	uint8_t bssid[6];
+	uint32_t now;
+	int n, i;
+
+	results = nrc_mem_malloc(sizeof(SCAN_RESULTS));
+	if (!results)
+		return;
+
+	xSemaphoreTake(roaming.lock, portMAX_DELAY);
+	n = wifi_roam_policy_scan_freqs(&roaming.policy, freqs, WIFI_ROAM_MAX_CANDIDATES + 1);
+	wifi_roam_policy_scan_start(&roaming.policy, sys_now());
+	xSemaphoreGive(roaming.lock);
+
+	if (n > 0 && nrc_wifi_set_scan_freq(roaming.vif, freqs, n) != WIFI_SUCCESS)
+		n = 0;
+
+	if (nrc_wifi_scan(roaming.vif) == WIFI_SUCCESS &&
+		nrc_wifi_scan_results(roaming.vif, results) == WIFI_SUCCESS) {
+		now = sys_now();
+		xSemaphoreTake(roaming.lock, portMAX_DELAY);
+		for (i = 0; i < results->n_result; i++) {
+			SCAN_RESULT *r = &results->result[i];
+
+			if (strcmp((char *)param->ssid, r->ssid) != 0 ||
+				r->security != param->security_mode)
+				continue;
+			if (!parse_bssid(r->bssid, bssid))
+				continue;
+			wifi_roam_policy_candidate(&roaming.policy, now, bssid,
+									   atoi(r->freq), atoi(r->sig_level));
+		}
+		xSemaphoreGive(roaming.lock);
+	}
+
+	if (n > 0 && nrc_wifi_set_scan_freq(roaming.vif,
+			param->scan_freq_num ? param->scan_freq_list : NULL,
+			param->scan_freq_num) != WIFI_SUCCESS) {
+		nrc_usr_print("[%s] Fail to restore Scan Freq\n", __func__);
+	}
+
+	nrc_mem_free(results);
+}
+
+/*
+ * Reassociate through the supplicant's ROAM command. It reuses the BSS entry
+ * of the last scan and the PMKSA, without a disconnect in between.
+ */
+static void wifi_roaming_roam(const wifi_roam_candidate_t *target)
+{
+	char bssid[MAX_BSSID_LENGTH + 1];
+	char *argv[] = { "wpa_cli", "ROAM", bssid };
+	uint32_t start, now;
+	AP_INFO ap;
+	bool done = false;
+
+	memset(&ap, 0, sizeof(ap));
+	snprintf(bssid, sizeof(bssid), MACSTR, MAC2STR(target->bssid));
+	nrc_usr_print("[%s] %s freq %d rssi %d%s\n", __func__, bssid, target->freq,
+				  target->rssi, target->pmksa ? " pmksa" : "");
+
+	start = sys_now();
+	if (wpa_cmd_receive(roaming.vif, 3, argv) == 0) {
+		do {
+			_delay_ms(WIFI_ROAMING_POLL_MS);
+			now = sys_now();
+			if (nrc_wifi_get_state(roaming.vif) == WIFI_STATE_CONNECTED &&
+				nrc_wifi_get_ap_info(roaming.vif, &ap) == WIFI_SUCCESS &&
+				memcmp(ap.bssid, target->bssid, 6) == 0) {
+				done = true;
+				break;
+			}
+		} while (now - start < roaming.config.roam_timeout_ms && !roaming.stop);
+	} else {
+		now = sys_now();
+	}
+
+	xSemaphoreTake(roaming.lock, portMAX_DELAY);
+	wifi_roam_policy_roamed(&roaming.policy, start, now,
+							done ? ap.bssid : NULL, done ? ap.freq : 0);
+	xSemaphoreGive(roaming.lock);
+
+	if (done)
+		nrc_usr_print("[%s] Roamed in %u ms\n", __func__, now - start);
+	else
+		nrc_usr_print("[%s] Roam to %s failed\n", __func__, bssid);
+}
+
+static void wifi_roaming_task(void *pvParameters)
+{
+	const wifi_roam_candidate_t *target;
+	wifi_roam_candidate_t candidate;
+	wifi_roam_action_t action;
+	AP_INFO ap;
+	int8_t rssi;
+	uint8_t snr;
+	uint32_t now;
+
+	memset(&candidate, 0, sizeof(candidate));
+
+	while (!roaming.stop) {
+		_delay_ms(roaming.config.sample_ms);
+
+		if (nrc_wifi_get_state(roaming.vif) != WIFI_STATE_CONNECTED) {
+			xSemaphoreTake(roaming.lock, portMAX_DELAY);
+			wifi_roam_policy_disconnected(&roaming.policy);
+			xSemaphoreGive(roaming.lock);
+			continue;
+		}
+
+		if (nrc_wifi_get_ap_info(roaming.vif, &ap) != WIFI_SUCCESS ||
+			nrc_wifi_get_average_rssi(roaming.vif, &rssi) != WIFI_SUCCESS)
+			continue;
+		if (nrc_wifi_get_snr(roaming.vif, &snr) != WIFI_SUCCESS)
+			snr = 0;
+
+		now = sys_now();
+		xSemaphoreTake(roaming.lock, portMAX_DELAY);
+		wifi_roam_policy_connected(&roaming.policy, now, ap.bssid, ap.freq);
+		wifi_roam_policy_link(&roaming.policy, now, rssi, snr);
+		action = wifi_roam_policy_decide(&roaming.policy, now, &target);
+		if (action == WIFI_ROAM_ACTION_ROAM)
+			candidate = *target;
+		xSemaphoreGive(roaming.lock);
+
+		if (action == WIFI_ROAM_ACTION_SCAN)
+			wifi_roaming_scan();
+		else if (action == WIFI_ROAM_ACTION_ROAM)
+			wifi_roaming_roam(&candidate);
+	}
+
+	roaming.task = NULL;
+	vTaskDelete(NULL);
+}
+
+tWIFI_STATUS wifi_roaming_start(int vif, WIFI_CONFIG *param, const wifi_roaming_config_t *config)
+{
+	static const wifi_roaming_config_t default_config = WIFI_ROAMING_CONFIG_DEFAULT;
+
+	if (roaming.task)
+		return WIFI_FAIL;
+
+	if (!roaming.lock) {
+		roaming.lock = xSemaphoreCreateMutex();
+		if (!roaming.lock)
+			return WIFI_NOMEM;
+	}
+
+	roaming.vif = vif;
+	roaming.param = param;
+	roaming.config = config ? *config : default_config;
+	roaming.stop = false;
+
+	/*
+	 * With WPA2-PSK the PMK is derived from the passphrase once per ESS, so
+	 * every AP of the ESS is as cheap to join as a cached PMKSA. Other modes
+	 * only have a PMKSA for the APs joined before.
+	 */
+	wifi_roam_policy_init(&roaming.policy, &roaming.config.policy,
+						  param->security_mode == WIFI_SEC_WPA2);
+
+	if (xTaskCreate(wifi_roaming_task, "ROAMING",
+			WIFI_ROAMING_TASK_STACK_SIZE / sizeof(StackType_t), NULL,
+			WIFI_ROAMING_TASK_PRIORITY, &roaming.task) != pdPASS) {
+		roaming.task = NULL;
+		return WIFI_NOMEM;
+	}
+
+	nrc_usr_print("[%s] scan below %d dBm, roam below %d dBm (+%d dB)\n", __func__,
+				  roaming.config.policy.scan_threshold, roaming.config.policy.roam_threshold,
+				  roaming.config.policy.hysteresis);
+	return WIFI_SUCCESS;
+}
+
+void wifi_roaming_stop(void)
+{
+	roaming.stop = true;
+	while (roaming.task)
+		_delay_ms(WIFI_ROAMING_POLL_MS);
+}
+
+void wifi_roaming_print_stats(void)
+{
+	wifi_roam_policy_t *policy = &roaming.policy;
+	int rssi, predicted;
+	int i;
+
+	if (!roaming.lock)
+		return;
+
+	xSemaphoreTake(roaming.lock, portMAX_DELAY);
+
+	rssi = wifi_roam_policy_rssi(policy, &predicted);
+	if (policy->connected) {
+		nrc_usr_print("[%s] "MACSTR" freq %d rssi %d -> %d (%d mdB/s) snr %d\n", __func__,
+					  MAC2STR(policy->bssid), policy->freq, rssi, predicted,
+					  (int)policy->slope_mdb, policy->snr);
+	}
+
+	for (i = 0; i < policy->n_candidates; i++) {
+		wifi_roam_candidate_t *c = &policy->candidates[i];
+
+		nrc_usr_print("  "MACSTR" freq %d rssi %d%s, %u ms ago\n", MAC2STR(c->bssid),
+					  c->freq, c->rssi, c->pmksa ? " pmksa" : "", sys_now() - c->seen_ms);
+	}
+
+	nrc_usr_print("  roams %u, failed %u, scans %u, max %u ms\n", policy->roams,
+				  policy->roam_failures, policy->scans, policy->latency_max_ms);
+	for (i = 0; i < WIFI_ROAM_LATENCY_BUCKETS; i++) {
+		if (!policy->latency[i])
+			continue;
+		if (i < WIFI_ROAM_LATENCY_BUCKETS - 1)
+			nrc_usr_print("  <= %5u ms: %u\n", wifi_roam_latency_bounds[i], policy->latency[i]);
+		else
+			nrc_usr_print("   > %5u ms: %u\n", wifi_roam_latency_bounds[i - 1], policy->latency[i]);
+	}
+
+	xSemaphoreGive(roaming.lock);
+}
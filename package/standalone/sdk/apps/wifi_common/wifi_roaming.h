@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __WIFI_ROAMING_H__
+#define __WIFI_ROAMING_H__
+
+#include "wifi_config_setup.h"
+#include "wifi_roaming_policy.h"
+
+typedef struct {
+	wifi_roam_policy_config_t policy;
+	uint32_t sample_ms;		/* link quality polling period */
+	uint32_t roam_timeout_ms;	/* reassociation wait */
+} wifi_roaming_config_t;
+
+#define WIFI_ROAMING_CONFIG_DEFAULT { \
+	.policy = WIFI_ROAM_POLICY_CONFIG_DEFAULT, \
+	.sample_ms = 500, \
+	.roam_timeout_ms = 3000, \
+}
+
+/*********************************************************************
+ * @fn wifi_roaming_start
+ *
+ * @brief Start the background roaming task for a connected STA.
+ *        The link is sampled every sample_ms. When the RSSI falls, or is
+ *        predicted to fall, below the scan threshold, the channels of known
+ *        candidates are scanned. When it falls below the roam threshold the
+ *        STA reassociates to the best candidate of the same ESS without
+ *        disconnecting first.
+ *
+ * @param vif
+ *
+ * @param wifi configuration ptr, must stay valid while roaming
+ *
+ * @param roaming configuration, NULL for WIFI_ROAMING_CONFIG_DEFAULT
+ *
+ * @return If success, then WIFI_SUCCESS. Otherwise, error code(tWIFI_STATUS) is returned.
+ **********************************************************************/
+tWIFI_STATUS wifi_roaming_start(int vif, WIFI_CONFIG *param, const wifi_roaming_config_t *config);
+
+/*********************************************************************
+ * @fn wifi_roaming_stop
+ *
+ * @brief Stop the background roaming task
+ *
+ * @param none
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roaming_stop(void);
+
+/*********************************************************************
+ * @fn wifi_roaming_print_stats
+ *
+ * @brief Print the link, the candidates and the roam latency histogram
+ *
+ * @param none
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roaming_print_stats(void);
+
+#endif /* __WIFI_ROAMING_H__ */
@@ -0,0 +1,340 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "wifi_roaming_policy.h"
+
+/* A fall faster than this halves the scan interval */
+#define FAST_FALL_MDB		(-2000)
+/* Bound on the extrapolated drop, a single outlier must not trigger a roam */
+#define MAX_PREDICTED_DROP	20
+
+const uint32_t wifi_roam_latency_bounds[WIFI_ROAM_LATENCY_BUCKETS] = {
+	50, 100, 200, 500, 1000, 2000, 5000, UINT32_MAX
+};
+
+static const wifi_roam_policy_config_t default_config = WIFI_ROAM_POLICY_CONFIG_DEFAULT;
+
+static bool has_pmksa(const wifi_roam_policy_t *policy, const uint8_t *bssid)
+{
+	int i;
+
+	if (policy->pmksa_ess)
+		return true;
+
+	for (i = 0; i < policy->n_pmksa; i++) {
+		if (memcmp(policy->pmksa[i], bssid, 6) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void add_pmksa(wifi_roam_policy_t *policy, const uint8_t *bssid)
+{
+	if (has_pmksa(policy, bssid))
+		return;
+
+	memcpy(policy->pmksa[policy->next_pmksa], bssid, 6);
+	policy->next_pmksa = (policy->next_pmksa + 1) % WIFI_ROAM_PMKSA_MAX;
+	if (policy->n_pmksa < WIFI_ROAM_PMKSA_MAX)
+		policy->n_pmksa++;
+}
+
+static void remove_candidate(wifi_roam_policy_t *policy, int i)
+{
+	policy->n_candidates--;
+	memmove(&policy->candidates[i], &policy->candidates[i + 1],
+			(policy->n_candidates - i) * sizeof(wifi_roam_candidate_t));
+}
+
+static int find_candidate(const wifi_roam_policy_t *policy, const uint8_t *bssid)
+{
+	int i;
+
+	for (i = 0; i < policy->n_candidates; i++) {
+		if (memcmp(policy->candidates[i].bssid, bssid, 6) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/* Least squares slope over the sample window, in mdB/s */
+static int32_t rssi_slope(const wifi_roam_policy_t *policy)
+{
+	int64_t st = 0, sr = 0, stt = 0, str = 0, num, den;
+	int n = policy->n_samples;
+	uint32_t t0;
+	int i;
+
+	/* a partial window is too noisy to extrapolate from */
+	if (n < WIFI_ROAM_TREND_SAMPLES)
+		return 0;
+
+	/* oldest sample */
+	t0 = policy->samples[policy->next_sample].t;
+
+	for (i = 0; i < n; i++) {
+		int64_t t = (int64_t)(policy->samples[i].t - t0);
+		int64_t r = policy->samples[i].rssi;
+
+		st += t;
+		sr += r;
+		stt += t * t;
+		str += t * r;
+	}
+
+	num = n * str - st * sr;
+	den = n * stt - st * st;
+	if (den <= 0)
+		return 0;
+
+	return (int32_t)(num * 1000000 / den);
+}
+
+void wifi_roam_policy_init(wifi_roam_policy_t *policy,
+						   const wifi_roam_policy_config_t *config, bool pmksa_ess)
+{
+	memset(policy, 0, sizeof(*policy));
+	policy->config = config ? *config : default_config;
+	policy->pmksa_ess = pmksa_ess;
+}
+
+void wifi_roam_policy_connected(wifi_roam_policy_t *policy, uint32_t now,
+								const uint8_t *bssid, uint16_t freq)
+{
+	int i;
+
+	(void)now;
+
+	if (!policy->connected || memcmp(policy->bssid, bssid, 6) != 0) {
+		policy->n_samples = 0;
+		policy->next_sample = 0;
+		policy->slope_mdb = 0;
+	}
+
+	policy->connected = true;
+	memcpy(policy->bssid, bssid, 6);
+	policy->freq = freq;
+	add_pmksa(policy, bssid);
+
+	i = find_candidate(policy, bssid);
+	if (i >= 0)
+		remove_candidate(policy, i);
+}
+
+void wifi_roam_policy_disconnected(wifi_roam_policy_t *policy)
+{
+	policy->connected = false;
+	policy->n_samples = 0;
+	policy->next_sample = 0;
+	policy->slope_mdb = 0;
+}
+
+void wifi_roam_policy_link(wifi_roam_policy_t *policy, uint32_t now,
+						   int8_t rssi, uint8_t snr)
+{
+	if (!policy->connected)
+		return;
+
+	if (policy->n_samples == 0)
+		policy->rssi_x16 = rssi * 16;
+	else
+		policy->rssi_x16 += (rssi * 16 - policy->rssi_x16) / 4;
+	policy->snr = snr;
+
+	policy->samples[policy->next_sample].t = now;
+	policy->samples[policy->next_sample].rssi = rssi;
+	policy->next_sample = (policy->next_sample + 1) % WIFI_ROAM_TREND_SAMPLES;
+	if (policy->n_samples < WIFI_ROAM_TREND_SAMPLES)
+		policy->n_samples++;
+
+	policy->slope_mdb = rssi_slope(policy);
+}
+
+int wifi_roam_policy_rssi(const wifi_roam_policy_t *policy, int *predicted)
+{
+	int rssi = (policy->rssi_x16 - 8) / 16;
+
+	if (policy->rssi_x16 >= 0)
+		rssi = (policy->rssi_x16 + 8) / 16;
+
+	if (predicted) {
+		int64_t delta = (int64_t)policy->slope_mdb * policy->config.horizon_ms / 1000000;
+
+		if (delta < -MAX_PREDICTED_DROP)
+			delta = -MAX_PREDICTED_DROP;
+		*predicted = rssi + (int)delta;
+	}
+
+	return rssi;
+}
+
+int wifi_roam_policy_scan_freqs(wifi_roam_policy_t *policy, uint16_t *freqs, int max)
+{
+	int n = 0;
+	int i, j;
+
+	if (policy->scans % WIFI_ROAM_FULL_SCAN_EVERY == 0 || policy->n_candidates == 0)
+		return 0;
+
+	for (i = -1; i < policy->n_candidates && n < max; i++) {
+		uint16_t freq = i < 0 ? policy->freq : policy->candidates[i].freq;
+
+		if (freq == 0)
+			continue;
+
+		for (j = 0; j < n; j++) {
+			if (freqs[j] == freq)
+				break;
+		}
+		if (j == n)
+			freqs[n++] = freq;
+	}
+
+	return n;
+}
+
+void wifi_roam_policy_scan_start(wifi_roam_policy_t *policy, uint32_t now)
+{
+	int i;
+
+	policy->scanned = true;
+	policy->last_scan_ms = now;
+	policy->scans++;
+
+	for (i = policy->n_candidates - 1; i >= 0; i--) {
+		if (now - policy->candidates[i].seen_ms > policy->config.candidate_max_age_ms)
+			remove_candidate(policy, i);
+	}
+}
+
+void wifi_roam_policy_candidate(wifi_roam_policy_t *policy, uint32_t now,
+								const uint8_t *bssid, uint16_t freq, int8_t rssi)
+{
+	wifi_roam_candidate_t c;
+	int i;
+
+	if (policy->connected && memcmp(policy->bssid, bssid, 6) == 0)
+		return;
+
+	i = find_candidate(policy, bssid);
+	if (i >= 0) {
+		remove_candidate(policy, i);
+	} else if (policy->n_candidates == WIFI_ROAM_MAX_CANDIDATES) {
+		if (policy->candidates[WIFI_ROAM_MAX_CANDIDATES - 1].rssi >= rssi)
+			return;
+		policy->n_candidates--;
+	}
+
+	memcpy(c.bssid, bssid, 6);
+	c.freq = freq;
+	c.rssi = rssi;
+	c.pmksa = has_pmksa(policy, bssid);
+	c.seen_ms = now;
+
+	/* keep the table ranked by RSSI */
+	for (i = policy->n_candidates; i > 0 && policy->candidates[i - 1].rssi < rssi; i--)
+		policy->candidates[i] = policy->candidates[i - 1];
+	policy->candidates[i] = c;
+	policy->n_candidates++;
+}
+
+wifi_roam_action_t wifi_roam_policy_decide(wifi_roam_policy_t *policy, uint32_t now,
+										   const wifi_roam_candidate_t **target)
+{
+	const wifi_roam_policy_config_t *config = &policy->config;
+	const wifi_roam_candidate_t *best = NULL;
+	int best_score = 0;
+	uint32_t interval;
+	int rssi, predicted, level;
+	int i;
+
+	if (!policy->connected || policy->n_samples == 0)
+		return WIFI_ROAM_ACTION_NONE;
+
+	rssi = wifi_roam_policy_rssi(policy, &predicted);
+	level = predicted < rssi ? predicted : rssi;
+
+	if (level < config->roam_threshold &&
+		(!policy->roamed || now - policy->last_roam_ms >= config->hold_down_ms)) {
+		for (i = 0; i < policy->n_candidates; i++) {
+			const wifi_roam_candidate_t *c = &policy->candidates[i];
+			int score = c->rssi + (c->pmksa ? WIFI_ROAM_PMKSA_BONUS : 0);
+
+			if (now - c->seen_ms > config->candidate_max_age_ms)
+				continue;
+			if (c->rssi < rssi + config->hysteresis)
+				continue;
+			if (!best || score > best_score) {
+				best = c;
+				best_score = score;
+			}
+		}
+
+		if (best) {
+			if (target)
+				*target = best;
+			return WIFI_ROAM_ACTION_ROAM;
+		}
+	}
+
+	if (level < config->scan_threshold) {
+		interval = config->scan_interval_ms;
+		if (policy->slope_mdb < FAST_FALL_MDB)
+			interval /= 2;
+
+		if (!policy->scanned || now - policy->last_scan_ms >= interval)
+			return WIFI_ROAM_ACTION_SCAN;
+	}
+
+	return WIFI_ROAM_ACTION_NONE;
+}
+
+void wifi_roam_policy_roamed(wifi_roam_policy_t *policy, uint32_t start_ms, uint32_t now,
+							 const uint8_t *bssid, uint16_t freq)
+{
+	uint32_t latency = now - start_ms;
+	int i;
+
+	policy->roamed = true;
+	policy->last_roam_ms = now;
+
+	if (!bssid) {
+		policy->roam_failures++;
+		return;
+	}
+
+	for (i = 0; i < WIFI_ROAM_LATENCY_BUCKETS - 1; i++) {
+		if (latency <= wifi_roam_latency_bounds[i])
+			break;
+	}
+	policy->latency[i]++;
+	if (latency > policy->latency_max_ms)
+		policy->latency_max_ms = latency;
+	policy->roams++;
+
+	wifi_roam_policy_connected(policy, now, bssid, freq);
+}
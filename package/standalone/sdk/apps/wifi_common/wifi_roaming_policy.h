@@ -0,0 +1,231 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __WIFI_ROAMING_POLICY_H__
+#define __WIFI_ROAMING_POLICY_H__
+
+/*
+ * Roaming decisions, kept free of SDK calls so that they can be replayed on a
+ * host with recorded RSSI traces (see host/roaming_trace_test.c).
+ * Times are in ms from any monotonic clock, RSSI in dBm.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WIFI_ROAM_MAX_CANDIDATES	8
+#define WIFI_ROAM_TREND_SAMPLES		8
+#define WIFI_ROAM_LATENCY_BUCKETS	8
+#define WIFI_ROAM_PMKSA_MAX		4
+#define WIFI_ROAM_PMKSA_BONUS		3	/* dB credited to candidates with a PMKSA */
+#define WIFI_ROAM_FULL_SCAN_EVERY	4	/* every Nth scan covers all channels */
+
+typedef struct {
+	int8_t scan_threshold;		/* look for candidates below this */
+	int8_t roam_threshold;		/* roam below this */
+	uint8_t hysteresis;		/* dB a candidate must beat the serving AP by */
+	uint32_t horizon_ms;		/* how far ahead the RSSI trend is extrapolated */
+	uint32_t scan_interval_ms;	/* between candidate scans, halved while RSSI falls fast */
+	uint32_t candidate_max_age_ms;	/* older scan results are not roamed to */
+	uint32_t hold_down_ms;		/* between roams, against ping-pong */
+} wifi_roam_policy_config_t;
+
+#define WIFI_ROAM_POLICY_CONFIG_DEFAULT { \
+	.scan_threshold = -70, \
+	.roam_threshold = -78, \
+	.hysteresis = 6, \
+	.horizon_ms = 2000, \
+	.scan_interval_ms = 4000, \
+	.candidate_max_age_ms = 6000, \
+	.hold_down_ms = 10000, \
+}
+
+typedef enum {
+	WIFI_ROAM_ACTION_NONE,
+	WIFI_ROAM_ACTION_SCAN,
+	WIFI_ROAM_ACTION_ROAM,
+} wifi_roam_action_t;
+
+typedef struct {
+	uint8_t bssid[6];
+	uint16_t freq;			/* S1G, as in AP_INFO */
+	int8_t rssi;
+	bool pmksa;			/* roaming there skips key derivation */
+	uint32_t seen_ms;
+} wifi_roam_candidate_t;
+
+typedef struct {
+	wifi_roam_policy_config_t config;
+
+	/* serving AP */
+	bool connected;
+	uint8_t bssid[6];
+	uint16_t freq;
+	int32_t rssi_x16;		/* EWMA, 1/16 dB */
+	uint8_t snr;
+	int32_t slope_mdb;		/* RSSI trend, mdB/s */
+	struct {
+		uint32_t t;
+		int8_t rssi;
+	} samples[WIFI_ROAM_TREND_SAMPLES];
+	uint8_t n_samples;
+	uint8_t next_sample;
+
+	/* ranked, best first */
+	wifi_roam_candidate_t candidates[WIFI_ROAM_MAX_CANDIDATES];
+	uint8_t n_candidates;
+	bool pmksa_ess;			/* one PMK for the ESS (WPA2-PSK) */
+	uint8_t pmksa[WIFI_ROAM_PMKSA_MAX][6];	/* APs joined before, for SAE */
+	uint8_t n_pmksa;
+	uint8_t next_pmksa;
+
+	bool scanned;
+	uint32_t last_scan_ms;
+	uint32_t scans;
+	bool roamed;
+	uint32_t last_roam_ms;
+
+	/* roam latency, bucket i counts roams up to wifi_roam_latency_bounds[i] ms */
+	uint32_t latency[WIFI_ROAM_LATENCY_BUCKETS];
+	uint32_t latency_max_ms;
+	uint32_t roams;
+	uint32_t roam_failures;
+} wifi_roam_policy_t;
+
+extern const uint32_t wifi_roam_latency_bounds[WIFI_ROAM_LATENCY_BUCKETS];
+
+/*********************************************************************
+ * @fn wifi_roam_policy_init
+ *
+ * @brief Reset the policy state
+ *
+ * @param policy state
+ *
+ * @param configuration, NULL for WIFI_ROAM_POLICY_CONFIG_DEFAULT
+ *
+ * @param pmksa_ess: true if every AP of the ESS shares a PMK
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roam_policy_init(wifi_roam_policy_t *policy,
+						   const wifi_roam_policy_config_t *config, bool pmksa_ess);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_connected
+ *
+ * @brief Set the serving AP, the trend restarts if it changed
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roam_policy_connected(wifi_roam_policy_t *policy, uint32_t now,
+								const uint8_t *bssid, uint16_t freq);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_disconnected
+ *
+ * @brief Forget the serving AP
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roam_policy_disconnected(wifi_roam_policy_t *policy);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_link
+ *
+ * @brief Add an RSSI/SNR sample of the serving AP
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roam_policy_link(wifi_roam_policy_t *policy, uint32_t now,
+						   int8_t rssi, uint8_t snr);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_scan_freqs
+ *
+ * @brief Channels for the next candidate scan
+ *
+ * @param freqs: buffer for S1G frequencies
+ *
+ * @param max: size of freqs
+ *
+ * @return Number of frequencies, 0 for a scan of all channels
+ **********************************************************************/
+int wifi_roam_policy_scan_freqs(wifi_roam_policy_t *policy, uint16_t *freqs, int max);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_scan_start
+ *
+ * @brief Note that a candidate scan starts, ages out old candidates
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roam_policy_scan_start(wifi_roam_policy_t *policy, uint32_t now);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_candidate
+ *
+ * @brief Add or refresh a candidate of the same ESS from a scan result
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roam_policy_candidate(wifi_roam_policy_t *policy, uint32_t now,
+								const uint8_t *bssid, uint16_t freq, int8_t rssi);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_decide
+ *
+ * @brief Decide what to do next
+ *
+ * @param target: set to the candidate to roam to on WIFI_ROAM_ACTION_ROAM
+ *
+ * @return wifi_roam_action_t
+ **********************************************************************/
+wifi_roam_action_t wifi_roam_policy_decide(wifi_roam_policy_t *policy, uint32_t now,
+										   const wifi_roam_candidate_t **target);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_roamed
+ *
+ * @brief Record the outcome of a roam started at start_ms
+ *
+ * @param bssid: AP joined, NULL if the roam failed
+ *
+ * @return none
+ **********************************************************************/
+void wifi_roam_policy_roamed(wifi_roam_policy_t *policy, uint32_t start_ms, uint32_t now,
+							 const uint8_t *bssid, uint16_t freq);
+
+/*********************************************************************
+ * @fn wifi_roam_policy_rssi
+ *
+ * @brief Smoothed RSSI of the serving AP and its extrapolation
+ *
+ * @param predicted: RSSI expected in config.horizon_ms, may be NULL
+ *
+ * @return Smoothed RSSI
+ **********************************************************************/
+int wifi_roam_policy_rssi(const wifi_roam_policy_t *policy, int *predicted);
+
+#endif /* __WIFI_ROAMING_POLICY_H__ */
@@ -0,0 +1,885 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifdef WIFI_SOFTAP_SERVER_HOST
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define server_malloc	malloc
+#define server_free		free
+#define SERVER_IPV6		1
+
+static uint32_t sys_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+#else
+#include "nrc_sdk.h"
+#include "lwip/sys.h"
+#include "lwip/sockets.h"
+#include "lwip/errno.h"
+#include "lwip/etharp.h"
+
+#define server_malloc	nrc_mem_malloc
+#define server_free		nrc_mem_free
+#define SERVER_IPV6		LWIP_IPV6
+#endif
+
+#include "wifi_softap_server.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+/* lwip_sendmsg() refuses any flag but MSG_DONTWAIT and MSG_MORE, and lwIP
+ * raises no SIGPIPE anyway */
+#ifdef WIFI_SOFTAP_SERVER_HOST
+#define SENDMSG_FLAGS	MSG_NOSIGNAL
+#else
+#define SENDMSG_FLAGS	0
+#endif
+
+#define RATE_WINDOW_MS	1000
+#define RUN_POLL_MS		100
+
+/* Buffers a recvmsg() or sendmsg() spans at most */
+#define IOV_BUFS		4
+
+typedef struct server_buf {
+	struct server_buf *next;
+	uint16_t off;
+	uint16_t len;
+	uint8_t data[WIFI_SOFTAP_SERVER_BUF_SIZE];
+} server_buf_t;
+
+struct wifi_softap_client {
+	bool used;
+	bool closing;
+	int sock;				/* TCP only */
+	struct sockaddr_storage peer;
+	socklen_t peer_len;
+	server_buf_t *txq_head;
+	server_buf_t *txq_tail;
+	uint32_t backlog;
+	int32_t deficit;
+	uint32_t since_ms;
+	uint32_t last_ms;
+	uint64_t rx_bytes;
+	uint64_t tx_bytes;
+	uint32_t win_rx;
+	uint32_t win_tx;
+	uint32_t rx_kbps;
+	uint32_t tx_kbps;
+	uint32_t drops;
+};
+
+struct wifi_softap_server {
+	wifi_softap_server_config_t config;
+	wifi_softap_server_t *next;		/* list for the console command */
+	int sock;
+	volatile bool running;
+	uint16_t start;					/* client the next round starts with */
+	uint16_t clients;
+	server_buf_t *pool;
+	server_buf_t *free_list;
+	uint16_t bufs_free;
+	uint16_t bufs_min;
+	uint32_t rejected;
+	uint32_t pool_stalls;
+	uint32_t win_start;
+	wifi_softap_client_t client[WIFI_SOFTAP_SERVER_CLIENTS_MAX];
+};
+
+static const wifi_softap_server_config_t default_config = WIFI_SOFTAP_SERVER_CONFIG_DEFAULT;
+
+static wifi_softap_server_t *servers;
+
+static bool would_block(void)
+{
+	return errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR;
+}
+
+static server_buf_t *buf_get(wifi_softap_server_t *server)
+{
+	server_buf_t *b = server->free_list;
+
+	if (!b)
+		return NULL;
+
+	server->free_list = b->next;
+	if (--server->bufs_free < server->bufs_min)
+		server->bufs_min = server->bufs_free;
+
+	b->next = NULL;
+	b->off = 0;
+	b->len = 0;
+	return b;
+}
+
+static void buf_put(wifi_softap_server_t *server, server_buf_t *b)
+{
+	b->next = server->free_list;
+	server->free_list = b;
+	server->bufs_free++;
+}
+
+static void txq_push(wifi_softap_client_t *c, server_buf_t *b)
+{
+	b->next = NULL;
+	if (c->txq_tail)
+		c->txq_tail->next = b;
+	else
+		c->txq_head = b;
+	c->txq_tail = b;
+	c->backlog += b->len - b->off;
+}
+
+static wifi_softap_client_t *client_new(wifi_softap_server_t *server,
+										const struct sockaddr_storage *peer, socklen_t peer_len)
+{
+	wifi_softap_client_t *c;
+	int i;
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++) {
+		c = &server->client[i];
+		if (c->used)
+			continue;
+
+		memset(c, 0, sizeof(*c));
+		c->used = true;
+		c->sock = -1;
+		memcpy(&c->peer, peer, peer_len);
+		c->peer_len = peer_len;
+		c->since_ms = c->last_ms = sys_now();
+		server->clients++;
+		return c;
+	}
+
+	return NULL;
+}
+
+static void txq_drop(wifi_softap_server_t *server, wifi_softap_client_t *c)
+{
+	server_buf_t *b;
+
+	while ((b = c->txq_head) != NULL) {
+		c->txq_head = b->next;
+		buf_put(server, b);
+	}
+	c->txq_tail = NULL;
+	c->backlog = 0;
+}
+
+static void client_free(wifi_softap_server_t *server, wifi_softap_client_t *c)
+{
+	txq_drop(server, c);
+
+	if (c->sock >= 0) {
+		shutdown(c->sock, SHUT_RDWR);
+		close(c->sock);
+		c->sock = -1;
+	}
+
+	c->used = false;
+	server->clients--;
+}
+
+static bool peer_equal(const struct sockaddr_storage *a, const struct sockaddr_storage *b)
+{
+	if (a->ss_family != b->ss_family)
+		return false;
+
+#if SERVER_IPV6
+	if (a->ss_family == AF_INET6) {
+		const struct sockaddr_in6 *a6 = (const struct sockaddr_in6 *)a;
+		const struct sockaddr_in6 *b6 = (const struct sockaddr_in6 *)b;
+
+		return a6->sin6_port == b6->sin6_port &&
+			   memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr)) == 0;
+	}
+#endif
+
+	return ((const struct sockaddr_in *)a)->sin_port == ((const struct sockaddr_in *)b)->sin_port &&
+		   ((const struct sockaddr_in *)a)->sin_addr.s_addr ==
+		   ((const struct sockaddr_in *)b)->sin_addr.s_addr;
+}
+
+static uint16_t peer_addr(const struct sockaddr_storage *peer, char *addr)
+{
+#if SERVER_IPV6
+	if (peer->ss_family == AF_INET6) {
+		const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)peer;
+
+		inet_ntop(AF_INET6, &in6->sin6_addr, addr, WIFI_SOFTAP_SERVER_ADDR_LEN);
+		return ntohs(in6->sin6_port);
+	}
+#endif
+
+	inet_ntop(AF_INET, &((const struct sockaddr_in *)peer)->sin_addr, addr,
+			  WIFI_SOFTAP_SERVER_ADDR_LEN);
+	return ntohs(((const struct sockaddr_in *)peer)->sin_port);
+}
+
+wifi_softap_server_t *wifi_softap_server_create(const wifi_softap_server_config_t *config)
+{
+	wifi_softap_server_t *server;
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int reuse = 1;
+	int i;
+
+	server = server_malloc(sizeof(*server));
+	if (!server)
+		return NULL;
+	memset(server, 0, sizeof(*server));
+
+	server->config = config ? *config : default_config;
+	if (!server->config.quantum)
+		server->config.quantum = default_config.quantum;
+	if (!server->config.backlog_max)
+		server->config.backlog_max = default_config.backlog_max;
+
+	server->pool = server_malloc(WIFI_SOFTAP_SERVER_BUFS * sizeof(server_buf_t));
+	if (!server->pool) {
+		server_free(server);
+		return NULL;
+	}
+	for (i = 0; i < WIFI_SOFTAP_SERVER_BUFS; i++)
+		buf_put(server, &server->pool[i]);
+	server->bufs_min = server->bufs_free;
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++)
+		server->client[i].sock = -1;
+
+	memset(&addr, 0, sizeof(addr));
+#if SERVER_IPV6
+	if (server->config.ipv6) {
+		struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)&addr;
+
+		in6->sin6_family = AF_INET6;
+		in6->sin6_port = htons(server->config.port);
+		in6->sin6_addr = in6addr_any;
+		addr_len = sizeof(*in6);
+	} else
+#endif
+	{
+		struct sockaddr_in *in = (struct sockaddr_in *)&addr;
+
+		in->sin_family = AF_INET;
+		in->sin_port = htons(server->config.port);
+		in->sin_addr.s_addr = htonl(INADDR_ANY);
+		addr_len = sizeof(*in);
+	}
+
+	server->sock = socket(addr.ss_family, server->config.udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+	if (server->sock < 0)
+		goto fail;
+
+	setsockopt(server->sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	if (bind(server->sock, (struct sockaddr *)&addr, addr_len) < 0)
+		goto fail;
+	if (!server->config.udp && listen(server->sock, 8) < 0)
+		goto fail;
+	if (fcntl(server->sock, F_SETFL, O_NONBLOCK) < 0)
+		goto fail;
+
+	if (server->config.port == 0) {
+		getsockname(server->sock, (struct sockaddr *)&addr, &addr_len);
+		server->config.port = ntohs(((struct sockaddr_in *)&addr)->sin_port);
+	}
+
+	server->win_start = sys_now();
+	server->next = servers;
+	servers = server;
+
+	return server;
+
+fail:
+	if (server->sock >= 0)
+		close(server->sock);
+	server_free(server->pool);
+	server_free(server);
+	return NULL;
+}
+
+void wifi_softap_server_destroy(wifi_softap_server_t *server)
+{
+	wifi_softap_server_t **p;
+	int i;
+
+	if (!server)
+		return;
+
+	for (p = &servers; *p; p = &(*p)->next) {
+		if (*p == server) {
+			*p = server->next;
+			break;
+		}
+	}
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++) {
+		if (server->client[i].used)
+			client_free(server, &server->client[i]);
+	}
+
+	shutdown(server->sock, SHUT_RDWR);
+	close(server->sock);
+	server_free(server->pool);
+	server_free(server);
+}
+
+uint16_t wifi_softap_server_port(wifi_softap_server_t *server)
+{
+	return server->config.port;
+}
+
+static void server_accept(wifi_softap_server_t *server)
+{
+	struct sockaddr_storage peer;
+	socklen_t peer_len;
+	wifi_softap_client_t *c;
+	int sock;
+
+	for (;;) {
+		peer_len = sizeof(peer);
+		sock = accept(server->sock, (struct sockaddr *)&peer, &peer_len);
+		if (sock < 0)
+			return;
+
+		c = client_new(server, &peer, peer_len);
+		if (!c || fcntl(sock, F_SETFL, O_NONBLOCK) < 0) {
+			if (c)
+				client_free(server, c);
+			server->rejected++;
+			close(sock);
+			continue;
+		}
+		c->sock = sock;
+	}
+}
+
+static void client_deliver(wifi_softap_server_t *server, wifi_softap_client_t *c,
+						   server_buf_t *b, int len)
+{
+	bool echo = true;
+
+	b->len = len;
+	c->rx_bytes += len;
+	c->win_rx += len;
+	c->last_ms = sys_now();
+
+	if (server->config.rx)
+		echo = server->config.rx(server, c, b->data, len, server->config.arg);
+
+	if (echo && c->used && !c->closing)
+		txq_push(c, b);
+	else
+		buf_put(server, b);
+}
+
+/* Returns false when the pool ran out */
+static bool client_input(wifi_softap_server_t *server, wifi_softap_client_t *c)
+{
+	int32_t quantum = server->config.quantum;
+	server_buf_t *b[IOV_BUFS];
+	struct iovec iov[IOV_BUFS];
+	struct msghdr msg;
+	int i, n, want, len, left, part;
+
+	c->deficit += quantum;
+	if (c->deficit > quantum)
+		c->deficit = quantum;
+
+	while (c->deficit > 0 && c->backlog < server->config.backlog_max) {
+		/* one recvmsg() over as many buffers as the grant spans */
+		for (n = 0, want = 0; n < IOV_BUFS && want < c->deficit; n++) {
+			b[n] = buf_get(server);
+			if (!b[n])
+				break;
+			iov[n].iov_base = b[n]->data;
+			iov[n].iov_len = c->deficit - want < WIFI_SOFTAP_SERVER_BUF_SIZE ?
+							 c->deficit - want : WIFI_SOFTAP_SERVER_BUF_SIZE;
+			want += iov[n].iov_len;
+		}
+		if (n == 0)
+			return false;
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = n;
+		len = recvmsg(c->sock, &msg, 0);
+		if (len <= 0) {
+			for (i = 0; i < n; i++)
+				buf_put(server, b[i]);
+			c->deficit = 0;
+			if (len == 0 || !would_block())
+				c->closing = true;
+			return true;
+		}
+
+		/* the filled buffers go on, the others back to the pool */
+		for (i = 0, left = len; i < n; i++) {
+			part = left < (int)iov[i].iov_len ? left : (int)iov[i].iov_len;
+			left -= part;
+			if (part > 0 && c->used)
+				client_deliver(server, c, b[i], part);
+			else
+				buf_put(server, b[i]);
+		}
+		if (!c->used)
+			return true;
+
+		/* nothing more to read, the unused grant is not carried over */
+		if (len < want) {
+			c->deficit = 0;
+			break;
+		}
+		c->deficit -= len;
+	}
+
+	return true;
+}
+
+/* Returns false when the pool ran out */
+static bool udp_input(wifi_softap_server_t *server)
+{
+	struct sockaddr_storage peer;
+	socklen_t peer_len;
+	wifi_softap_client_t *c;
+	server_buf_t *b;
+	int i, j, len;
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++) {
+		b = buf_get(server);
+		if (!b)
+			return false;
+
+		peer_len = sizeof(peer);
+		len = recvfrom(server->sock, b->data, WIFI_SOFTAP_SERVER_BUF_SIZE, 0,
+					   (struct sockaddr *)&peer, &peer_len);
+		if (len < 0) {
+			buf_put(server, b);
+			return true;
+		}
+
+		c = NULL;
+		for (j = 0; j < WIFI_SOFTAP_SERVER_CLIENTS_MAX; j++) {
+			if (server->client[j].used && peer_equal(&server->client[j].peer, &peer)) {
+				c = &server->client[j];
+				break;
+			}
+		}
+		if (!c)
+			c = client_new(server, &peer, peer_len);
+
+		if (!c) {
+			server->rejected++;
+			buf_put(server, b);
+		} else if (c->backlog >= server->config.backlog_max) {
+			/* the longest queue drops */
+			c->rx_bytes += len;
+			c->win_rx += len;
+			c->drops++;
+			buf_put(server, b);
+		} else {
+			client_deliver(server, c, b, len);
+		}
+	}
+
+	return true;
+}
+
+/* Takes the bytes sent off the head of the queue */
+static void txq_sent(wifi_softap_server_t *server, wifi_softap_client_t *c, int len)
+{
+	server_buf_t *b;
+	int part;
+
+	c->backlog -= len;
+	while (len > 0) {
+		b = c->txq_head;
+		part = b->len - b->off < len ? b->len - b->off : len;
+		b->off += part;
+		len -= part;
+
+		if (b->off == b->len) {
+			c->txq_head = b->next;
+			if (!c->txq_head)
+				c->txq_tail = NULL;
+			buf_put(server, b);
+		}
+	}
+}
+
+static void client_output(wifi_softap_server_t *server, wifi_softap_client_t *c)
+{
+	int32_t budget = server->config.quantum;
+	struct iovec iov[IOV_BUFS];
+	struct msghdr msg;
+	server_buf_t *b;
+	int n, want, len;
+
+	while ((b = c->txq_head) != NULL && budget > 0) {
+		if (server->config.udp) {
+			/* a datagram a buffer */
+			len = sendto(server->sock, b->data + b->off, b->len - b->off, 0,
+						 (struct sockaddr *)&c->peer, c->peer_len);
+			if (len < 0) {
+				/* lwIP reports a lack of pbufs for UDP as ENOMEM */
+				if (would_block() || errno == ENOMEM)
+					break;
+				len = b->len - b->off;
+				c->drops++;
+			} else {
+				c->tx_bytes += len;
+				c->win_tx += len;
+			}
+			budget -= len;
+			txq_sent(server, c, len);
+			continue;
+		}
+
+		/* one sendmsg() of as much of the queue as the budget covers */
+		for (n = 0, want = 0; b && n < IOV_BUFS && want < budget; b = b->next, n++) {
+			iov[n].iov_base = b->data + b->off;
+			iov[n].iov_len = b->len - b->off;
+			want += iov[n].iov_len;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = n;
+		len = sendmsg(c->sock, &msg, SENDMSG_FLAGS);
+		if (len < 0) {
+			/* the queue can no longer be sent, the client is freed with it */
+			if (!would_block()) {
+				txq_drop(server, c);
+				c->closing = true;
+			}
+			return;
+		}
+
+		c->tx_bytes += len;
+		c->win_tx += len;
+		budget -= len;
+		txq_sent(server, c, len);
+
+		/* the socket is full */
+		if (len < want)
+			break;
+	}
+}
+
+static void server_rates(wifi_softap_server_t *server, uint32_t now)
+{
+	uint32_t elapsed = now - server->win_start;
+	wifi_softap_client_t *c;
+	int i;
+
+	if (elapsed < RATE_WINDOW_MS)
+		return;
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++) {
+		c = &server->client[i];
+		if (!c->used)
+			continue;
+
+		/* bytes per ms * 8 = kbit/s */
+		c->rx_kbps = (uint32_t)((uint64_t)c->win_rx * 8 / elapsed);
+		c->tx_kbps = (uint32_t)((uint64_t)c->win_tx * 8 / elapsed);
+		c->win_rx = 0;
+		c->win_tx = 0;
+
+		if (server->config.udp && server->config.idle_ms && !c->txq_head &&
+			now - c->last_ms > server->config.idle_ms)
+			client_free(server, c);
+	}
+
+	server->win_start = now;
+}
+
+int wifi_softap_server_poll(wifi_softap_server_t *server, int timeout_ms)
+{
+	fd_set rfds, wfds;
+	struct timeval tv;
+	wifi_softap_client_t *c;
+	bool can_read = server->free_list != NULL;
+	bool udp = server->config.udp;
+	bool udp_out = false;
+	int max_sd = server->sock;
+	int next_start = server->start;
+	int i, k, ret;
+
+	FD_ZERO(&rfds);
+	FD_ZERO(&wfds);
+
+	/* the listening socket is always watched, to turn away the clients in excess */
+	if (can_read || !udp)
+		FD_SET(server->sock, &rfds);
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++) {
+		c = &server->client[i];
+		if (!c->used)
+			continue;
+
+		if (udp) {
+			udp_out |= c->txq_head != NULL;
+			continue;
+		}
+
+		if (can_read && !c->closing && c->backlog < server->config.backlog_max)
+			FD_SET(c->sock, &rfds);
+		if (c->txq_head)
+			FD_SET(c->sock, &wfds);
+		if (c->sock > max_sd)
+			max_sd = c->sock;
+	}
+	if (udp_out)
+		FD_SET(server->sock, &wfds);
+
+	if (timeout_ms >= 0) {
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+	}
+
+	ret = select(max_sd + 1, &rfds, &wfds, NULL, timeout_ms >= 0 ? &tv : NULL);
+	if (ret < 0)
+		return would_block() ? 0 : -1;
+
+	if (ret > 0 && FD_ISSET(server->sock, &rfds)) {
+		if (!udp)
+			server_accept(server);
+		else if (!udp_input(server))
+			server->pool_stalls++;
+	}
+
+	for (k = 0; k < WIFI_SOFTAP_SERVER_CLIENTS_MAX; k++) {
+		i = (server->start + k) % WIFI_SOFTAP_SERVER_CLIENTS_MAX;
+		c = &server->client[i];
+		if (!c->used)
+			continue;
+
+		if (!udp && can_read && ret > 0 && FD_ISSET(c->sock, &rfds) &&
+			!client_input(server, c)) {
+			/* this client goes first when there are buffers again, the
+			 * others are still sent to and freed */
+			server->pool_stalls++;
+			next_start = i;
+			can_read = false;
+		}
+
+		if (c->txq_head)
+			client_output(server, c);
+
+		if (c->closing && !c->txq_head)
+			client_free(server, c);
+	}
+
+	server->start = can_read ? (server->start + 1) % WIFI_SOFTAP_SERVER_CLIENTS_MAX : next_start;
+
+	server_rates(server, sys_now());
+	return 0;
+}
+
+int wifi_softap_server_run(wifi_softap_server_t *server)
+{
+	int ret = 0;
+
+	server->running = true;
+	while (server->running) {
+		ret = wifi_softap_server_poll(server, RUN_POLL_MS);
+		if (ret < 0)
+			break;
+	}
+	server->running = false;
+
+	return ret;
+}
+
+void wifi_softap_server_stop(wifi_softap_server_t *server)
+{
+	server->running = false;
+}
+
+size_t wifi_softap_server_send(wifi_softap_server_t *server, wifi_softap_client_t *client,
+							   const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	server_buf_t *b;
+	size_t queued = 0;
+	size_t n;
+
+	if (!client->used || client->closing)
+		return 0;
+
+	/* UDP keeps the datagram boundaries */
+	if (server->config.udp && len > WIFI_SOFTAP_SERVER_BUF_SIZE)
+		return 0;
+
+	while (queued < len) {
+		b = buf_get(server);
+		if (!b) {
+			client->drops += len - queued;
+			break;
+		}
+
+		n = len - queued;
+		if (n > WIFI_SOFTAP_SERVER_BUF_SIZE)
+			n = WIFI_SOFTAP_SERVER_BUF_SIZE;
+		memcpy(b->data, p + queued, n);
+		b->len = n;
+		txq_push(client, b);
+		queued += n;
+	}
+
+	return queued;
+}
+
+void wifi_softap_server_close(wifi_softap_server_t *server, wifi_softap_client_t *client)
+{
+	(void)server;
+	client->closing = true;
+}
+
+static void client_stats(wifi_softap_server_t *server, int i, uint32_t now,
+						 wifi_softap_client_stats_t *s)
+{
+	wifi_softap_client_t *c = &server->client[i];
+
+	s->id = i;
+	s->port = peer_addr(&c->peer, s->addr);
+	s->rx_bytes = c->rx_bytes;
+	s->tx_bytes = c->tx_bytes;
+	s->rx_kbps = c->rx_kbps;
+	s->tx_kbps = c->tx_kbps;
+	s->backlog = c->backlog;
+	s->drops = c->drops;
+	s->connected_ms = now - c->since_ms;
+}
+
+int wifi_softap_server_stats(wifi_softap_server_t *server, wifi_softap_server_stats_t *stats,
+							 wifi_softap_client_stats_t *clients, int max)
+{
+	uint32_t now = sys_now();
+	int i, n = 0;
+
+	if (stats) {
+		stats->clients = server->clients;
+		stats->bufs_free = server->bufs_free;
+		stats->bufs_min = server->bufs_min;
+		stats->rejected = server->rejected;
+		stats->pool_stalls = server->pool_stalls;
+	}
+
+	for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX && n < max; i++) {
+		if (server->client[i].used)
+			client_stats(server, i, now, &clients[n++]);
+	}
+
+	return n;
+}
+
+#ifndef WIFI_SOFTAP_SERVER_HOST
+/* The station behind an IPv4 address, from the ARP cache of the soft AP */
+static void peer_mac(const char *addr, char *mac, size_t size)
+{
+	ip4_addr_t want;
+	int i;
+
+	snprintf(mac, size, "-");
+	if (!ip4addr_aton(addr, &want))
+		return;
+
+	for (i = 0; i < ARP_TABLE_SIZE; i++) {
+		ip4_addr_t *ip;
+		struct netif *netif;
+		struct eth_addr *ethaddr;
+
+		if (etharp_get_entry(i, &ip, &netif, &ethaddr) && ip4_addr_cmp(ip, &want)) {
+			snprintf(mac, size, "%02X:%02X:%02X:%02X:%02X:%02X",
+					 ethaddr->addr[0], ethaddr->addr[1], ethaddr->addr[2],
+					 ethaddr->addr[3], ethaddr->addr[4], ethaddr->addr[5]);
+			return;
+		}
+	}
+}
+
+static int cmd_srvsta_handler(cmd_tbl_t *t, int argc, char *argv[])
+{
+	wifi_softap_client_stats_t s;
+	wifi_softap_server_stats_t stats;
+	wifi_softap_server_t *server;
+	char mac[18];
+	int i;
+
+	if (argc > 1)
+		return CMD_RET_USAGE;
+
+	if (!servers) {
+		nrc_usr_print("no server\n");
+		return CMD_RET_FAILURE;
+	}
+
+	for (server = servers; server; server = server->next) {
+		wifi_softap_server_stats(server, &stats, NULL, 0);
+		nrc_usr_print("%s port %u: %u clients, %u/%u buffers free (min %u), %u rejected, %u pool stalls\n",
+					  server->config.udp ? "UDP" : "TCP", server->config.port,
+					  stats.clients, stats.bufs_free, WIFI_SOFTAP_SERVER_BUFS,
+					  stats.bufs_min, stats.rejected, stats.pool_stalls);
+
+		/* a client at a time, not to hold a table on the console stack */
+		for (i = 0; i < WIFI_SOFTAP_SERVER_CLIENTS_MAX; i++) {
+			if (!server->client[i].used)
+				continue;
+
+			client_stats(server, i, sys_now(), &s);
+			peer_mac(s.addr, mac, sizeof(mac));
+			nrc_usr_print("+WSTASRV:%d,\"%s\",\"%s\",%u,%llu,%llu,%u,%u,%u,%u\n",
+						  s.id, mac, s.addr, s.port, s.rx_bytes, s.tx_bytes,
+						  s.rx_kbps, s.tx_kbps, s.backlog, s.drops);
+		}
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+CMD_MAND(srvsta,
+	cmd_srvsta_handler,
+	"per station statistics of the soft AP servers",
+	"srvsta");
+#endif /* WIFI_SOFTAP_SERVER_HOST */
@@ -0,0 +1,250 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Newracom, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __WIFI_SOFTAP_SERVER_H__
+#define __WIFI_SOFTAP_SERVER_H__
+
+/*
+ * Data-plane server for the stations of a soft AP, on a TCP listening
+ * socket or a UDP socket.
+ *
+ * A single task runs wifi_softap_server_run(). All the sockets are
+ * non-blocking and the task only ever waits in one select(), for input on
+ * any of them or for room to send on those that have data queued.
+ *
+ * Data is received into buffers of a pool shared by all the clients. A
+ * buffer is handed to the rx callback, then either sent back to the client
+ * as is (echo) or released. The pool holds WIFI_SOFTAP_SERVER_BUFS buffers,
+ * two per TCP PCB by default, so that every client can have one buffer
+ * being received while another one is sent. A client is read with one
+ * recvmsg() over as many buffers as its grant spans and sent to with one
+ * sendmsg() over its queue, a few buffers at a time.
+ *
+ * The pool is allocated by wifi_softap_server_create() and takes
+ * WIFI_SOFTAP_SERVER_BUFS * (WIFI_SOFTAP_SERVER_BUF_SIZE + 8) bytes of heap:
+ * about 58 KB with the 20 TCP PCBs of most boards and 29 KB with 10, where
+ * a loop with a single buffer on its stack needs 4 KB. Define
+ * WIFI_SOFTAP_SERVER_BUFS lower to trade throughput for RAM; fewer than one
+ * buffer per client only makes the rounds stall on the pool more often.
+ *
+ * The clients are served in deficit round robin: each round, every client
+ * with input is granted 'quantum' bytes, and the round starts one client
+ * further each time. A client is not read from while it has 'backlog_max'
+ * bytes queued to it, so that a station that does not read its data back
+ * is slowed down by TCP flow control instead of holding the pool. When the
+ * pool runs out in the middle of a round, the next round starts with the
+ * first client that was left out.
+ *
+ * With UDP, the clients are the peer addresses, taken in on their first
+ * datagram, and the datagrams of a peer that has 'backlog_max' bytes queued
+ * are dropped.
+ *
+ * Each client has its throughput and backlog counted. The "srvsta" console
+ * command prints them as +WSTASRV lines, in the form of AT+WSTAINFO:
+ *
+ *   +WSTASRV:<id>,"<mac>","<ip>",<port>,<rx bytes>,<tx bytes>,<rx kbps>,<tx kbps>,<backlog>,<drops>
+ *
+ * The file has no SDK dependency other than the socket API and builds on a
+ * host with WIFI_SOFTAP_SERVER_HOST defined (see host/softap_server_bench.c).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MEMP_NUM_TCP_PCB
+#include "lwipopts.h"
+#endif
+
+/* Clients at a time, a TCP PCB each */
+#ifndef WIFI_SOFTAP_SERVER_CLIENTS_MAX
+#define WIFI_SOFTAP_SERVER_CLIENTS_MAX	MEMP_NUM_TCP_PCB
+#endif
+
+/* A full-size segment of an Ethernet MTU */
+#ifndef WIFI_SOFTAP_SERVER_BUF_SIZE
+#define WIFI_SOFTAP_SERVER_BUF_SIZE		1460
+#endif
+
+/* Buffers of the pool, heap-allocated at start */
+#ifndef WIFI_SOFTAP_SERVER_BUFS
+#define WIFI_SOFTAP_SERVER_BUFS			(2 * MEMP_NUM_TCP_PCB)
+#endif
+
+/* Longest address string, IPv6 included */
+#define WIFI_SOFTAP_SERVER_ADDR_LEN		46
+
+typedef struct wifi_softap_server wifi_softap_server_t;
+typedef struct wifi_softap_client wifi_softap_client_t;
+
+/*
+ * Called from the server task with data received from a client.
+ * Returns true to send the data back to the client as is, without a copy.
+ */
+typedef bool (*wifi_softap_server_rx_cb)(wifi_softap_server_t *server,
+										 wifi_softap_client_t *client,
+										 const uint8_t *data, size_t len, void *arg);
+
+typedef struct {
+	uint16_t port;			/* 0 for any, see wifi_softap_server_port() */
+	bool udp;
+	bool ipv6;
+	uint16_t quantum;		/* bytes granted to a client per round */
+	uint16_t backlog_max;	/* bytes queued to a client before it is paused */
+	uint32_t idle_ms;		/* UDP peers without traffic for this long are forgotten */
+	wifi_softap_server_rx_cb rx;	/* NULL to echo everything */
+	void *arg;
+} wifi_softap_server_config_t;
+
+#define WIFI_SOFTAP_SERVER_CONFIG_DEFAULT { \
+	.quantum = 2 * WIFI_SOFTAP_SERVER_BUF_SIZE, \
+	.backlog_max = 4 * WIFI_SOFTAP_SERVER_BUF_SIZE, \
+	.idle_ms = 60000, \
+}
+
+typedef struct {
+	int id;
+	char addr[WIFI_SOFTAP_SERVER_ADDR_LEN];
+	uint16_t port;
+	uint64_t rx_bytes;
+	uint64_t tx_bytes;
+	uint32_t rx_kbps;		/* over the last second or so */
+	uint32_t tx_kbps;
+	uint32_t backlog;		/* bytes queued to send */
+	uint32_t drops;			/* datagrams or bytes not echoed for lack of buffers */
+	uint32_t connected_ms;
+} wifi_softap_client_stats_t;
+
+typedef struct {
+	uint16_t clients;
+	uint16_t bufs_free;
+	uint16_t bufs_min;		/* low-water mark of the free buffers */
+	uint32_t rejected;		/* connections refused, no room for a client */
+	uint32_t pool_stalls;	/* rounds cut short by an empty pool */
+} wifi_softap_server_stats_t;
+
+/*********************************************************************
+ * @fn wifi_softap_server_create
+ *
+ * @brief Open the socket and allocate the clients and the buffer pool
+ *
+ * @param config: NULL for WIFI_SOFTAP_SERVER_CONFIG_DEFAULT, TCP on any port
+ *
+ * @return the server, NULL on failure
+ **********************************************************************/
+wifi_softap_server_t *wifi_softap_server_create(const wifi_softap_server_config_t *config);
+
+/*********************************************************************
+ * @fn wifi_softap_server_destroy
+ *
+ * @brief Close all the sockets and free the server. Not to be called
+ *        while wifi_softap_server_run() is running.
+ *
+ * @return none
+ **********************************************************************/
+void wifi_softap_server_destroy(wifi_softap_server_t *server);
+
+/*********************************************************************
+ * @fn wifi_softap_server_port
+ *
+ * @brief Port the server is bound to
+ *
+ * @return port
+ **********************************************************************/
+uint16_t wifi_softap_server_port(wifi_softap_server_t *server);
+
+/*********************************************************************
+ * @fn wifi_softap_server_poll
+ *
+ * @brief Wait for the sockets once, then serve a round
+ *
+ * @param server
+ *
+ * @param timeout_ms: longest wait, -1 for no limit
+ *
+ * @return 0, -1 on a socket error
+ **********************************************************************/
+int wifi_softap_server_poll(wifi_softap_server_t *server, int timeout_ms);
+
+/*********************************************************************
+ * @fn wifi_softap_server_run
+ *
+ * @brief Serve until wifi_softap_server_stop()
+ *
+ * @return 0, -1 on a socket error
+ **********************************************************************/
+int wifi_softap_server_run(wifi_softap_server_t *server);
+
+/*********************************************************************
+ * @fn wifi_softap_server_stop
+ *
+ * @brief Make wifi_softap_server_run() return, within 100 ms if called
+ *        from another task
+ *
+ * @return none
+ **********************************************************************/
+void wifi_softap_server_stop(wifi_softap_server_t *server);
+
+/*********************************************************************
+ * @fn wifi_softap_server_send
+ *
+ * @brief Queue data to a client, from the rx callback
+ *
+ * @param server, client
+ *
+ * @param data, len
+ *
+ * @return Bytes queued, less than len if the pool ran out
+ **********************************************************************/
+size_t wifi_softap_server_send(wifi_softap_server_t *server, wifi_softap_client_t *client,
+							   const void *data, size_t len);
+
+/*********************************************************************
+ * @fn wifi_softap_server_close
+ *
+ * @brief Close a client once its queued data is sent, from the rx
+ *        callback
+ *
+ * @return none
+ **********************************************************************/
+void wifi_softap_server_close(wifi_softap_server_t *server, wifi_softap_client_t *client);
+
+/*********************************************************************
+ * @fn wifi_softap_server_stats
+ *
+ * @brief Read the server and client statistics
+ *
+ * @param server
+ *
+ * @param stats: server totals, may be NULL
+ *
+ * @param clients, max: room for the client statistics
+ *
+ * @return Number of clients filled in
+ **********************************************************************/
+int wifi_softap_server_stats(wifi_softap_server_t *server, wifi_softap_server_stats_t *stats,
+							 wifi_softap_client_stats_t *clients, int max);
+
+#endif /* __WIFI_SOFTAP_SERVER_H__ */